@@ -23,11 +23,9 @@
 
 gboolean client_parse_server_messages(GebrCommServer *gebr_comm_server, struct server *server)
 {
-	GList *link;
 	struct gebr_comm_message *message;
 
-	while ((link = g_list_last(gebr_comm_server->socket->protocol->messages)) != NULL) {
-		message = (struct gebr_comm_message *)link->data;
+	while ((message = g_queue_peek_head(gebr_comm_server->socket->protocol->messages)) != NULL) {
 
 		if (message->hash == gebr_comm_protocol_defs.ret_def.code_hash) {
 			if (gebr_comm_server->socket->protocol->waiting_ret_hash == gebr_comm_protocol_defs.ini_def.code_hash) {
@@ -133,12 +131,11 @@ gboolean client_parse_server_messages(GebrCommServer *gebr_comm_server, struct s
 			goto err;
 		}
 
-		gebr_comm_message_free(message);
-		gebr_comm_server->socket->protocol->messages = g_list_delete_link(gebr_comm_server->socket->protocol->messages, link);
+		gebr_comm_message_free(g_queue_pop_head(gebr_comm_server->socket->protocol->messages));
 	}
 
 	return TRUE;
 
- err:	gebr_comm_message_free(message);
+ err:	gebr_comm_message_free(g_queue_pop_head(gebr_comm_server->socket->protocol->messages));
 	return FALSE;
 }
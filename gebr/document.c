@@ -23,6 +23,7 @@
 #include <time.h>
 #include <unistd.h>
 #include <stdlib.h>
+#include <sys/stat.h>
 
 #include <glib/gstdio.h>
 
@@ -32,6 +33,7 @@
 #include <libgebr/gui/gebr-gui-save-dialog.h>
 
 #include "document.h"
+#include "gebr-document-cache.h"
 #include "gebr.h"
 #include "project.h"
 #include "line.h"
@@ -40,18 +42,60 @@
 #include "ui_help.h"
 #include "gebr-report.h"
 
+/*
+ * Document cache
+ *
+ * Documents loaded or saved with the cache are kept by path, see
+ * #GebrDocumentCache. The least recently used ones are released when the
+ * cached files exceed the budget below, except the ones open in the flow
+ * browser, which document_cache_lookup() must find.
+ */
+#define DOCUMENT_CACHE_BUDGET (16 * 1024 * 1024)
+
+static GebrDocumentCache *document_cache = NULL;
+
+static GebrDocumentCache *document_cache_get(void)
+{
+	if (!document_cache)
+		document_cache = gebr_document_cache_new(DOCUMENT_CACHE_BUDGET);
+	return document_cache;
+}
+
 static GebrGeoXmlDocument *document_cache_check(const gchar *path)
 {
-	return g_hash_table_lookup(gebr.xmls_by_filename, path);
+	return gebr_document_cache_check(document_cache_get(), path);
 }
 
 static void document_cache_add(const gchar *path, GebrGeoXmlDocument * document)
 {
-	GebrGeoXmlDocument *cached = document_cache_check(path);
+	gebr_document_cache_add(document_cache_get(), path, document);
+}
 
-	g_warn_if_fail(!cached || cached == document);
+GebrGeoXmlDocument *document_cache_lookup(const gchar *filename)
+{
+	GString *path = document_get_path(filename);
+	GebrGeoXmlDocument *document = gebr_document_cache_peek(document_cache_get(), path->str);
 
-	g_hash_table_insert(gebr.xmls_by_filename, g_strdup(path), document);
+	g_string_free(path, TRUE);
+
+	return document;
+}
+
+void document_cache_hold(GebrGeoXmlDocument *document)
+{
+	gebr_document_cache_hold(document_cache_get(), document);
+}
+
+void document_cache_release(GebrGeoXmlDocument *document)
+{
+	gebr_document_cache_release(document_cache_get(), document);
+}
+
+void document_cache_clear(void)
+{
+	if (document_cache)
+		gebr_document_cache_free(document_cache);
+	document_cache = NULL;
 }
 
 GebrGeoXmlDocument *document_new(GebrGeoXmlDocumentType type)
@@ -461,6 +505,260 @@ out:	g_string_free(string, TRUE);
 	return ret;
 }
 
+/*
+ * Asynchronous loading
+ */
+
+/* Documents loaded by the threads are handed to the main loop in batches */
+#define DOCUMENT_LOADER_BATCH 16
+#define DOCUMENT_LOADER_INTERVAL 10
+
+struct _DocumentLoader {
+	DocumentLoaderFunc func;
+	DocumentLoaderDoneFunc done;
+	gpointer user_data;
+	GDestroyNotify data_destroy;
+	gboolean cache;
+
+	GThreadPool *pool;
+	GMutex *mutex;
+	GCond *cond;
+	GQueue requests;
+	guint source_id;
+	gboolean closed;
+	gboolean delivering;
+	gboolean freed;
+};
+
+typedef struct {
+	gchar *path;
+	gboolean has_parent;
+	GtkTreeIter parent;
+	gpointer data;
+
+	gboolean cached;
+
+	/* Set by the threads, protected by the mutex of the loader */
+	gboolean done;
+	GebrGeoXmlDocument *document;
+} DocumentRequest;
+
+/* Set when a flow being loaded in a thread refers to an ancient menu */
+static GStaticPrivate discard_menu_ref_pending = G_STATIC_PRIVATE_INIT;
+
+static void
+discard_menu_ref_in_thread(GebrGeoXmlProgram *program, const gchar *filename, gint index)
+{
+	/* The menu is loaded again in the main loop, where errors can be shown */
+	g_static_private_set(&discard_menu_ref_pending, GINT_TO_POINTER(TRUE), NULL);
+}
+
+static void
+document_request_free(DocumentRequest *request, DocumentLoader *loader)
+{
+	if (request->document && request->cached)
+		gebr_geoxml_document_unref(request->document);
+	else if (request->document)
+		gebr_geoxml_document_free(request->document);
+	if (loader->data_destroy && request->data)
+		loader->data_destroy(request->data);
+	g_free(request->path);
+	g_free(request);
+}
+
+static void
+document_loader_thread(DocumentRequest *request, DocumentLoader *loader)
+{
+	GebrGeoXmlDocument *document;
+
+	g_static_private_set(&discard_menu_ref_pending, NULL, NULL);
+	if (gebr_geoxml_document_load(&document, request->path, TRUE,
+				      g_str_has_suffix(request->path, ".flw") ? discard_menu_ref_in_thread : NULL))
+		document = NULL;
+	else if (g_static_private_get(&discard_menu_ref_pending)) {
+		gebr_geoxml_document_free(document);
+		document = NULL;
+	}
+
+	g_mutex_lock(loader->mutex);
+	request->document = document;
+	request->done = TRUE;
+	g_cond_signal(loader->cond);
+	g_mutex_unlock(loader->mutex);
+}
+
+static void
+document_loader_destroy(DocumentLoader *loader)
+{
+	if (loader->pool)
+		g_thread_pool_free(loader->pool, TRUE, TRUE);
+	if (loader->source_id)
+		g_source_remove(loader->source_id);
+
+	g_queue_foreach(&loader->requests, (GFunc) document_request_free, loader);
+	g_queue_clear(&loader->requests);
+	g_cond_free(loader->cond);
+	g_mutex_free(loader->mutex);
+	g_free(loader);
+}
+
+/*
+ * Hands at most @max documents to the callback of @loader, stopping at the
+ * first one still being loaded, unless @wait is TRUE.
+ */
+static void
+document_loader_deliver_ready(DocumentLoader *loader, gint max, gboolean wait)
+{
+	loader->delivering = TRUE;
+
+	for (gint n = 0; n != max && !loader->freed; n++) {
+		DocumentRequest *request = g_queue_peek_head(&loader->requests);
+		gboolean done;
+
+		if (!request)
+			break;
+
+		g_mutex_lock(loader->mutex);
+		while (wait && !request->done)
+			g_cond_wait(loader->cond, loader->mutex);
+		done = request->done;
+		g_mutex_unlock(loader->mutex);
+		if (!done)
+			break;
+
+		g_queue_pop_head(&loader->requests);
+
+		GebrGeoXmlDocument *document = request->document;
+		GtkTreeIter *parent = request->has_parent ? &request->parent : NULL;
+
+		/* A cached document is referenced by the request until it is freed */
+		if (!request->cached) {
+			request->document = NULL;
+			if (!document) {
+				/* Load it again here, so the errors are handled */
+				if (document_load_path_with_parent(&document, request->path, parent, loader->cache))
+					document = NULL;
+			} else if (loader->cache)
+				document_cache_add(request->path, document);
+		}
+
+		loader->func(loader, document, parent, request->data, loader->user_data);
+		document_request_free(request, loader);
+	}
+
+	loader->delivering = FALSE;
+}
+
+/*
+ * Frees @loader if it was cancelled while delivering or if it is finished.
+ */
+static void
+document_loader_check_finished(DocumentLoader *loader)
+{
+	if (loader->freed)
+		document_loader_destroy(loader);
+	else if (g_queue_is_empty(&loader->requests) && loader->closed) {
+		if (loader->done)
+			loader->done(loader, loader->user_data);
+		document_loader_destroy(loader);
+	}
+}
+
+static gboolean
+document_loader_deliver(DocumentLoader *loader)
+{
+	document_loader_deliver_ready(loader, DOCUMENT_LOADER_BATCH, FALSE);
+
+	if (loader->freed || g_queue_is_empty(&loader->requests)) {
+		loader->source_id = 0;
+		document_loader_check_finished(loader);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static gint
+document_loader_get_max_threads(void)
+{
+	glong n = sysconf(_SC_NPROCESSORS_ONLN);
+	return CLAMP(n, 1, 8);
+}
+
+DocumentLoader *document_loader_new(DocumentLoaderFunc func, DocumentLoaderDoneFunc done,
+				    gpointer user_data, GDestroyNotify data_destroy, gboolean cache)
+{
+	DocumentLoader *loader = g_new0(DocumentLoader, 1);
+
+	loader->func = func;
+	loader->done = done;
+	loader->user_data = user_data;
+	loader->data_destroy = data_destroy;
+	loader->cache = cache;
+	loader->mutex = g_mutex_new();
+	loader->cond = g_cond_new();
+	g_queue_init(&loader->requests);
+
+	if (g_thread_supported())
+		loader->pool = g_thread_pool_new((GFunc) document_loader_thread, loader,
+						 document_loader_get_max_threads(), FALSE, NULL);
+
+	return loader;
+}
+
+void document_loader_push(DocumentLoader *loader, const gchar *filename, GtkTreeIter *parent, gpointer data)
+{
+	DocumentRequest *request = g_new0(DocumentRequest, 1);
+	GString *path = document_get_path(filename);
+
+	request->path = g_string_free(path, FALSE);
+	request->data = data;
+	if (parent) {
+		request->has_parent = TRUE;
+		request->parent = *parent;
+	}
+	g_queue_push_tail(&loader->requests, request);
+
+	GebrGeoXmlDocument *cached = loader->cache ? document_cache_check(request->path) : NULL;
+	if (cached) {
+		request->document = gebr_geoxml_document_ref(cached);
+		request->cached = TRUE;
+		request->done = TRUE;
+	} else if (loader->pool)
+		g_thread_pool_push(loader->pool, request, NULL);
+	else
+		document_loader_thread(request, loader);
+
+	if (!loader->source_id)
+		loader->source_id = g_timeout_add(DOCUMENT_LOADER_INTERVAL, (GSourceFunc) document_loader_deliver, loader);
+}
+
+void document_loader_close(DocumentLoader *loader)
+{
+	loader->closed = TRUE;
+	if (!loader->source_id)
+		loader->source_id = g_timeout_add(DOCUMENT_LOADER_INTERVAL, (GSourceFunc) document_loader_deliver, loader);
+}
+
+void document_loader_flush(DocumentLoader *loader)
+{
+	g_return_if_fail(!loader->delivering);
+
+	document_loader_deliver_ready(loader, -1, TRUE);
+	document_loader_check_finished(loader);
+}
+
+void document_loader_free(DocumentLoader *loader)
+{
+	if (!loader)
+		return;
+
+	if (loader->delivering)
+		loader->freed = TRUE;
+	else
+		document_loader_destroy(loader);
+}
+
 gboolean document_save_at(GebrGeoXmlDocument * document, const gchar * path, gboolean set_modified_date, gboolean cache, gboolean compress)
 {
 	gboolean ret = FALSE;
@@ -489,16 +787,9 @@ gboolean document_save(GebrGeoXmlDocument * document, gboolean set_modified_date
 	return ret;
 }
 
-static void
-foreach_document_free(gpointer key, gpointer value, gpointer document)
-{
-	if (value == document)
-		g_hash_table_remove(gebr.xmls_by_filename, key);
-}
-
 void document_free(GebrGeoXmlDocument * document)
 {
-	g_hash_table_foreach(gebr.xmls_by_filename, foreach_document_free, document);
+	gebr_document_cache_remove(document_cache_get(), document);
 	gebr_geoxml_document_free(document);
 }
 
@@ -111,6 +111,98 @@ int document_load_path_with_parent(GebrGeoXmlDocument **document,
 				   GtkTreeIter         *parent,
 				   gboolean             cache);
 
+/**
+ * DocumentLoader:
+ *
+ * Loads documents in a pool of threads and hands them to the main loop in
+ * the order they were pushed, a few at each iteration.
+ */
+typedef struct _DocumentLoader DocumentLoader;
+
+/**
+ * DocumentLoaderFunc:
+ * @document: the loaded document, or %NULL if it could not be loaded
+ * @parent: the @parent given to document_loader_push()
+ * @data: the @data given to document_loader_push()
+ *
+ * Called in the main loop for each document. Documents which fail to load
+ * in a thread are loaded again with document_load_path_with_parent(), so
+ * errors are handled as usual. More documents can be pushed from here.
+ */
+typedef void (*DocumentLoaderFunc)(DocumentLoader *loader,
+				   GebrGeoXmlDocument *document,
+				   GtkTreeIter *parent,
+				   gpointer data,
+				   gpointer user_data);
+
+typedef void (*DocumentLoaderDoneFunc)(DocumentLoader *loader,
+				       gpointer user_data);
+
+/**
+ * document_loader_new:
+ * @done: called once all documents were handed, after document_loader_close()
+ * @data_destroy: frees the @data of the documents, or %NULL
+ * @cache: %TRUE to look up and add the documents in the cache
+ */
+DocumentLoader *document_loader_new(DocumentLoaderFunc func,
+				    DocumentLoaderDoneFunc done,
+				    gpointer user_data,
+				    GDestroyNotify data_destroy,
+				    gboolean cache);
+
+/**
+ * document_loader_push:
+ * @filename: the filename of a document at GêBR's data directory
+ * @parent: the iter of the parent of the document, see document_load_path_with_parent()
+ */
+void document_loader_push(DocumentLoader *loader,
+			  const gchar *filename,
+			  GtkTreeIter *parent,
+			  gpointer data);
+
+/**
+ * document_loader_close:
+ *
+ * Tells @loader no more documents will be pushed, except from its callback.
+ * It is freed after its done callback is called.
+ */
+void document_loader_close(DocumentLoader *loader);
+
+/**
+ * document_loader_flush:
+ *
+ * Waits for the documents pushed to @loader and hands them all, including
+ * the ones pushed meanwhile by its callback. If @loader is closed, it is
+ * freed before returning.
+ */
+void document_loader_flush(DocumentLoader *loader);
+
+/**
+ * document_loader_free:
+ *
+ * Cancels @loader. The documents not handed yet are freed.
+ */
+void document_loader_free(DocumentLoader *loader);
+
+/**
+ * Return the cached document with \p filename, without checking if its file changed.
+ */
+GebrGeoXmlDocument *document_cache_lookup(const gchar *filename);
+
+/**
+ * Keeps \p document in the cache while it is open, whatever its size, so
+ * document_cache_lookup() finds it. Each call is matched by a call to
+ * document_cache_release().
+ */
+void document_cache_hold(GebrGeoXmlDocument *document);
+
+void document_cache_release(GebrGeoXmlDocument *document);
+
+/**
+ * Release all documents held by the cache.
+ */
+void document_cache_clear(void);
+
 /**
  * Save \p document at \p path.  * Only set \p set_modified_date to TRUE if this save is a reflect of a explicit user action.
  * Returns TRUE on document save success or FALSE otherwise
@@ -104,6 +104,7 @@ void flow_new (void)
 
 void flow_free(void)
 {
+	line_load_flows_cancel();
 	gebr.flow = NULL;
 
 	GtkTreeIter iter, parent;
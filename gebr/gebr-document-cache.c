@@ -0,0 +1,200 @@
+/*
+ * gebr-document-cache.c
+ * This file is part of GêBR Project
+ *
+ * Copyright (C) 2012 - GêBR Core Team (www.gebrproject.com)
+ *
+ * GêBR Project is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * GêBR Project is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GêBR Project. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gebr-document-cache.h"
+
+#include <sys/stat.h>
+#include <glib/gstdio.h>
+
+typedef struct {
+	gchar *path;
+	GebrGeoXmlDocument *document;
+	time_t mtime;
+	goffset size;
+	GList *link;
+} Entry;
+
+struct _GebrDocumentCache {
+	GHashTable *entries;
+	GQueue lru;
+	goffset size;
+	goffset budget;
+
+	/* The number of holds of each open document */
+	GHashTable *open;
+};
+
+static void
+remove_entry(GebrDocumentCache *cache, Entry *entry)
+{
+	g_hash_table_remove(cache->entries, entry->path);
+	g_queue_delete_link(&cache->lru, entry->link);
+	cache->size -= entry->size;
+	gebr_geoxml_document_unref(entry->document);
+	g_free(entry->path);
+	g_free(entry);
+}
+
+GebrDocumentCache *
+gebr_document_cache_new(goffset budget)
+{
+	GebrDocumentCache *cache = g_new0(GebrDocumentCache, 1);
+
+	cache->entries = g_hash_table_new(g_str_hash, g_str_equal);
+	cache->open = g_hash_table_new(NULL, NULL);
+	cache->budget = budget;
+	g_queue_init(&cache->lru);
+
+	return cache;
+}
+
+void
+gebr_document_cache_free(GebrDocumentCache *cache)
+{
+	while (!g_queue_is_empty(&cache->lru))
+		remove_entry(cache, g_queue_peek_head(&cache->lru));
+
+	g_hash_table_destroy(cache->entries);
+	g_hash_table_destroy(cache->open);
+	g_free(cache);
+}
+
+GebrGeoXmlDocument *
+gebr_document_cache_check(GebrDocumentCache *cache,
+			  const gchar *path)
+{
+	Entry *entry = g_hash_table_lookup(cache->entries, path);
+	struct stat st;
+
+	if (!entry)
+		return NULL;
+
+	if (g_stat(path, &st) != 0 || st.st_mtime != entry->mtime || st.st_size != entry->size) {
+		remove_entry(cache, entry);
+		return NULL;
+	}
+
+	g_queue_unlink(&cache->lru, entry->link);
+	g_queue_push_head_link(&cache->lru, entry->link);
+
+	return entry->document;
+}
+
+GebrGeoXmlDocument *
+gebr_document_cache_peek(GebrDocumentCache *cache,
+			 const gchar *path)
+{
+	Entry *entry = g_hash_table_lookup(cache->entries, path);
+	return entry ? entry->document : NULL;
+}
+
+/*
+ * Releases the least recently used documents which are not open, until the
+ * cached files fit in the budget or only @keep is left.
+ */
+static void
+evict(GebrDocumentCache *cache, Entry *keep)
+{
+	GList *link = cache->lru.tail;
+
+	while (cache->size > cache->budget && link) {
+		Entry *entry = link->data;
+
+		link = link->prev;
+		if (entry != keep && !g_hash_table_lookup(cache->open, entry->document))
+			remove_entry(cache, entry);
+	}
+}
+
+void
+gebr_document_cache_add(GebrDocumentCache *cache,
+			const gchar *path,
+			GebrGeoXmlDocument *document)
+{
+	Entry *entry = g_hash_table_lookup(cache->entries, path);
+	struct stat st;
+
+	g_warn_if_fail(!entry || entry->document == document);
+
+	/* The reference is taken before the old entry releases its own */
+	gebr_geoxml_document_ref(document);
+	if (entry)
+		remove_entry(cache, entry);
+
+	if (g_stat(path, &st) != 0) {
+		gebr_geoxml_document_unref(document);
+		return;
+	}
+
+	entry = g_new(Entry, 1);
+	entry->path = g_strdup(path);
+	entry->document = document;
+	entry->mtime = st.st_mtime;
+	entry->size = st.st_size;
+	g_queue_push_head(&cache->lru, entry);
+	entry->link = cache->lru.head;
+	cache->size += entry->size;
+	g_hash_table_insert(cache->entries, entry->path, entry);
+
+	evict(cache, entry);
+}
+
+void
+gebr_document_cache_remove(GebrDocumentCache *cache,
+			   GebrGeoXmlDocument *document)
+{
+	GList *link = cache->lru.head;
+
+	while (link) {
+		Entry *entry = link->data;
+
+		link = link->next;
+		if (entry->document == document)
+			remove_entry(cache, entry);
+	}
+
+	g_hash_table_remove(cache->open, document);
+}
+
+void
+gebr_document_cache_hold(GebrDocumentCache *cache,
+			 GebrGeoXmlDocument *document)
+{
+	guint holds = GPOINTER_TO_UINT(g_hash_table_lookup(cache->open, document));
+	g_hash_table_insert(cache->open, document, GUINT_TO_POINTER(holds + 1));
+}
+
+void
+gebr_document_cache_release(GebrDocumentCache *cache,
+			    GebrGeoXmlDocument *document)
+{
+	guint holds = GPOINTER_TO_UINT(g_hash_table_lookup(cache->open, document));
+
+	/* Already dropped by gebr_document_cache_remove() */
+	if (!holds)
+		return;
+
+	if (holds > 1)
+		g_hash_table_insert(cache->open, document, GUINT_TO_POINTER(holds - 1));
+	else {
+		g_hash_table_remove(cache->open, document);
+		evict(cache, NULL);
+	}
+}
@@ -0,0 +1,91 @@
+/*
+ * gebr-document-cache.h
+ * This file is part of GêBR Project
+ *
+ * Copyright (C) 2012 - GêBR Core Team (www.gebrproject.com)
+ *
+ * GêBR Project is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * GêBR Project is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GêBR Project. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GEBR_DOCUMENT_CACHE_H__
+#define __GEBR_DOCUMENT_CACHE_H__
+
+#include <libgebr/geoxml/geoxml.h>
+
+G_BEGIN_DECLS
+
+/**
+ * GebrDocumentCache:
+ *
+ * Documents by path, along with the modification time and size of their
+ * file, so a file changed since it was cached is loaded again. The cache
+ * holds a reference to each document, released by the least recently used
+ * ones when the total size of the cached files exceeds a budget. Documents
+ * held open, see gebr_document_cache_hold(), are never released.
+ */
+typedef struct _GebrDocumentCache GebrDocumentCache;
+
+GebrDocumentCache *gebr_document_cache_new(goffset budget);
+
+void gebr_document_cache_free(GebrDocumentCache *cache);
+
+/**
+ * gebr_document_cache_check:
+ *
+ * Returns: the document cached for @path, or %NULL if there is none or if the
+ * file changed since it was cached.
+ */
+GebrGeoXmlDocument *gebr_document_cache_check(GebrDocumentCache *cache,
+					      const gchar *path);
+
+/**
+ * gebr_document_cache_peek:
+ *
+ * Returns: the document cached for @path, without checking its file.
+ */
+GebrGeoXmlDocument *gebr_document_cache_peek(GebrDocumentCache *cache,
+					     const gchar *path);
+
+/**
+ * gebr_document_cache_add:
+ *
+ * Caches @document, just loaded from or saved to @path.
+ */
+void gebr_document_cache_add(GebrDocumentCache *cache,
+			     const gchar *path,
+			     GebrGeoXmlDocument *document);
+
+/**
+ * gebr_document_cache_remove:
+ *
+ * Drops @document from @cache, as it is being freed.
+ */
+void gebr_document_cache_remove(GebrDocumentCache *cache,
+				GebrGeoXmlDocument *document);
+
+/**
+ * gebr_document_cache_hold:
+ *
+ * Keeps @document in @cache while it is open, until as many calls to
+ * gebr_document_cache_release() are made, or until it is removed.
+ */
+void gebr_document_cache_hold(GebrDocumentCache *cache,
+			      GebrGeoXmlDocument *document);
+
+void gebr_document_cache_release(GebrDocumentCache *cache,
+				 GebrGeoXmlDocument *document);
+
+G_END_DECLS
+
+#endif /* __GEBR_DOCUMENT_CACHE_H__ */
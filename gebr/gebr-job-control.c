@@ -32,6 +32,7 @@
 #include "gebr-job-control.h"
 #include "gebr.h"
 #include "gebr-job.h"
+#include "gebr-output-view.h"
 
 typedef struct {
 	GebrJob *job;
@@ -54,8 +55,7 @@ struct _GebrJobControlPriv {
 	GtkListStore *server_filter;
 	GtkListStore *status_model;
 	GtkListStore *store;
-	GtkTextBuffer *text_buffer;
-	GtkTextMark *text_mark;
+	GebrOutputView *output_view;
 	GtkListStore *flow_filter;
 	GList *cmd_views;
 	GtkWidget *filter_info_bar;
@@ -165,6 +165,7 @@ static GtkMenu *job_control_popup_menu(GtkWidget * widget, GebrJobControl *job_c
 static void job_control_fill_servers_info(GebrJobControl *jc);
 
 static void job_control_disconnect_signals(GebrJobControl *jc);
+static void job_control_release_output(GebrJobControl *jc);
 
 static void gebr_job_control_info_set_visible(GebrJobControl *jc,
 					      gboolean visible,
@@ -237,6 +238,7 @@ on_select_non_single_job(GebrJobControl *jc,
 	}
 
 	job_control_disconnect_signals(jc);
+	job_control_release_output(jc);
 	update_control_buttons(jc, can_close, can_kill, can_save);
 	jc->priv->last_selection.job = NULL;
 
@@ -858,12 +860,7 @@ on_job_output(GebrJob *job,
 	      const gchar *output,
 	      GebrJobControl *jc)
 {
-	GtkTextIter end;
-
-	gtk_text_buffer_get_end_iter(jc->priv->text_buffer, &end);
-	gtk_text_buffer_insert(jc->priv->text_buffer, &end, output, strlen(output));
-	if (gebr.config.job_log_auto_scroll)
-		gtk_text_view_scroll_to_mark(GTK_TEXT_VIEW(jc->priv->text_view), jc->priv->text_mark, 0, FALSE, 0, 0);
+	gebr_output_view_update(jc->priv->output_view, gebr.config.job_log_auto_scroll);
 }
 
 static void
@@ -1091,9 +1088,19 @@ job_control_fill_servers_info(GebrJobControl *jc)
 		else
 			server = servers[i];
 
+		/* Show how many loop steps each node executed */
+		gchar *text;
+		if (total_procs > 1 && g_strcmp0(gebr_job_get_run_type(job), "mpi") != 0)
+			text = g_strdup_printf(_("%s (%d of %d steps)"), server,
+					       (gint) round(jc->priv->servers_info.percentages[i] * acc),
+					       total_procs);
+		else
+			text = g_strdup(server);
+
 		Color *color = g_new(Color, 1);
 		GtkWidget *hbox = gtk_hbox_new(FALSE, 5);
-		GtkWidget *label = gtk_label_new(server);
+		GtkWidget *label = gtk_label_new(text);
+		g_free(text);
 		GtkWidget *square = gtk_drawing_area_new();
 
 		gtk_widget_set_size_request(square, 15, 10);
@@ -1124,6 +1131,24 @@ job_control_disconnect_signals(GebrJobControl *jc)
 	}
 }
 
+/*
+ * Tells Maestro the output of the job displayed until now is no longer
+ * needed.
+ */
+static void
+job_control_release_output(GebrJobControl *jc)
+{
+	GebrJob *job = jc->priv->last_selection.job;
+
+	if (!job)
+		return;
+
+	const gchar *maddr = gebr_job_get_maestro_address(job);
+	GebrMaestroServer *maestro = gebr_maestro_controller_get_maestro_for_address(gebr.maestro_controller, maddr);
+	if (maestro)
+		gebr_maestro_server_release_job_output(maestro, job);
+}
+
 static void
 job_control_on_cursor_changed(GtkTreeSelection *selection,
 			      GebrJobControl *jc)
@@ -1162,6 +1187,8 @@ job_control_on_cursor_changed(GtkTreeSelection *selection,
 
 	if (has_job) {
 		job_control_disconnect_signals(jc);
+		if (old_job != job)
+			job_control_release_output(jc);
 
 		jc->priv->last_selection.job = job;
 		jc->priv->last_selection.sig_output =
@@ -1173,6 +1200,12 @@ job_control_on_cursor_changed(GtkTreeSelection *selection,
 		jc->priv->last_selection.sig_cmd_line =
 				g_signal_connect(job, "cmd-line-received", G_CALLBACK(on_job_cmd_line), jc);
 
+		/* Output is only sent by Maestro when the job is displayed */
+		const gchar *maddr = gebr_job_get_maestro_address(job);
+		GebrMaestroServer *maestro = gebr_maestro_controller_get_maestro_for_address(gebr.maestro_controller, maddr);
+		if (maestro)
+			gebr_maestro_server_request_job_output(maestro, job);
+
 		gebr_job_control_load_details(jc, job);
 	}
 
@@ -1580,8 +1613,6 @@ gebr_job_control_load_details(GebrJobControl *jc,
 {
 	g_return_if_fail(job != NULL);
 
-	GString *info = g_string_new("");
-	GtkTextIter end_iter;
 	GtkImage *info_button_image;
 	GtkLabel *input_file, *output_file, *log_file, *job_group;
 	gchar *input_file_str, *output_file_str, *log_file_str;
@@ -1667,20 +1698,11 @@ gebr_job_control_load_details(GebrJobControl *jc,
 	gtk_label_set_ellipsize(label, PANGO_ELLIPSIZE_END);
 	g_free (markup);
 
-	gtk_text_buffer_set_text(jc->priv->text_buffer, "", 0);
-
 	gebr_job_control_include_cmd_line(jc, job);
 
-	/* output */
-	g_string_append(info, gebr_job_get_output(job));
-
-	gtk_text_buffer_get_end_iter(jc->priv->text_buffer, &end_iter);
-	gtk_text_buffer_insert(jc->priv->text_buffer, &end_iter, info->str, info->len);
-	if (gebr.config.job_log_auto_scroll)
-		gtk_text_view_scroll_to_iter(GTK_TEXT_VIEW(jc->priv->text_view), &end_iter,
-					     0, FALSE, 0, 0);
-
-	g_string_free(info, TRUE);
+	/* output, only its last lines are put in the text view */
+	gebr_output_view_set_text(jc->priv->output_view, G_OBJECT(job), gebr_job_peek_output(job));
+	gebr_output_view_update(jc->priv->output_view, gebr.config.job_log_auto_scroll);
 }
 
 static gboolean
@@ -1838,11 +1860,89 @@ autoscroll_toggled(GtkCheckMenuItem * check_menu_item)
 	gebr.config.job_log_auto_scroll = gtk_check_menu_item_get_active(check_menu_item);
 }
 
+enum {
+	FIND_RESPONSE_PREVIOUS = 1,
+	FIND_RESPONSE_NEXT
+};
+
+static void
+on_find_dialog_response(GtkDialog *dialog,
+			gint response,
+			GebrJobControl *jc)
+{
+	if (response != FIND_RESPONSE_PREVIOUS && response != FIND_RESPONSE_NEXT) {
+		gtk_widget_destroy(GTK_WIDGET(dialog));
+		return;
+	}
+
+	GtkEntry *entry = g_object_get_data(G_OBJECT(dialog), "entry");
+	GtkToggleButton *match_case = g_object_get_data(G_OBJECT(dialog), "match-case");
+	GtkLabel *status = g_object_get_data(G_OBJECT(dialog), "status");
+	const gchar *needle = gtk_entry_get_text(entry);
+
+	if (!*needle)
+		return;
+
+	if (gebr_output_view_search(jc->priv->output_view, needle,
+				    response == FIND_RESPONSE_NEXT,
+				    gtk_toggle_button_get_active(match_case)))
+		gtk_label_set_text(status, "");
+	else {
+		gtk_label_set_text(status, _("Not found"));
+		gtk_widget_error_bell(GTK_WIDGET(dialog));
+	}
+}
+
+static void
+on_find_activate(GtkMenuItem *item,
+		 GebrJobControl *jc)
+{
+	GtkWidget *dialog = gtk_dialog_new_with_buttons(_("Find in output"),
+							GTK_WINDOW(gebr.window),
+							GTK_DIALOG_DESTROY_WITH_PARENT,
+							GTK_STOCK_GO_BACK, FIND_RESPONSE_PREVIOUS,
+							GTK_STOCK_GO_FORWARD, FIND_RESPONSE_NEXT,
+							GTK_STOCK_CLOSE, GTK_RESPONSE_CLOSE,
+							NULL);
+	GtkWidget *vbox = gtk_dialog_get_content_area(GTK_DIALOG(dialog));
+	GtkWidget *entry = gtk_entry_new();
+	GtkWidget *match_case = gtk_check_button_new_with_mnemonic(_("_Match case"));
+	GtkWidget *status = gtk_label_new(NULL);
+
+	gtk_entry_set_activates_default(GTK_ENTRY(entry), TRUE);
+	gtk_dialog_set_default_response(GTK_DIALOG(dialog), FIND_RESPONSE_NEXT);
+	gtk_misc_set_alignment(GTK_MISC(status), 0, 0.5);
+
+	gtk_container_set_border_width(GTK_CONTAINER(vbox), 5);
+	gtk_box_set_spacing(GTK_BOX(vbox), 5);
+	gtk_box_pack_start(GTK_BOX(vbox), entry, FALSE, FALSE, 0);
+	gtk_box_pack_start(GTK_BOX(vbox), match_case, FALSE, FALSE, 0);
+	gtk_box_pack_start(GTK_BOX(vbox), status, FALSE, FALSE, 0);
+
+	g_object_set_data(G_OBJECT(dialog), "entry", entry);
+	g_object_set_data(G_OBJECT(dialog), "match-case", match_case);
+	g_object_set_data(G_OBJECT(dialog), "status", status);
+	g_signal_connect(dialog, "response", G_CALLBACK(on_find_dialog_response), jc);
+
+	gtk_widget_show_all(dialog);
+}
+
 static void
 on_text_view_populate_popup(GtkTextView * text_view, GtkMenu * menu, GebrJobControl *jc)
 {
 	GtkWidget *menu_item;
 
+	if (GTK_WIDGET(text_view) == jc->priv->text_view) {
+		menu_item = gtk_separator_menu_item_new();
+		gtk_widget_show(menu_item);
+		gtk_menu_shell_append(GTK_MENU_SHELL(menu), menu_item);
+
+		menu_item = gtk_image_menu_item_new_from_stock(GTK_STOCK_FIND, NULL);
+		gtk_widget_show(menu_item);
+		gtk_menu_shell_append(GTK_MENU_SHELL(menu), menu_item);
+		g_signal_connect(menu_item, "activate", G_CALLBACK(on_find_activate), jc);
+	}
+
 	menu_item = gtk_separator_menu_item_new();
 	gtk_widget_show(menu_item);
 	gtk_menu_shell_append(GTK_MENU_SHELL(menu), menu_item);
@@ -2465,19 +2565,14 @@ gebr_job_control_new(void)
 		gtk_widget_hide(GTK_WIDGET(show_issues));
 
 	GtkWidget *text_view;
-	GtkTextIter iter_end;
 	
 	GtkToggleButton *details = GTK_TOGGLE_BUTTON(gtk_builder_get_object(jc->priv->builder, "more_details"));
 	g_signal_connect(details, "toggled", G_CALLBACK(on_toggled_more_details), jc->priv->builder);
 	gtk_toggle_button_set_active(details, FALSE);
 
 	/* Text view of output*/
-	jc->priv->text_buffer = gtk_text_buffer_new(NULL);
-	gtk_text_buffer_get_end_iter(jc->priv->text_buffer, &iter_end);
-	jc->priv->text_mark = gtk_text_buffer_create_mark(jc->priv->text_buffer, "end", &iter_end, FALSE);
-
 	text_view = GTK_WIDGET(gtk_builder_get_object(jc->priv->builder, "textview_output"));
-	gtk_text_view_set_buffer(GTK_TEXT_VIEW(text_view), jc->priv->text_buffer);
+	jc->priv->output_view = gebr_output_view_new(GTK_TEXT_VIEW(text_view));
 	g_object_set(text_view, "wrap-mode", gebr.config.job_log_word_wrap ? GTK_WRAP_WORD : GTK_WRAP_NONE, NULL);
 
 	g_object_set(G_OBJECT(text_view), "editable", FALSE, "cursor-visible", FALSE, NULL);
@@ -2504,6 +2599,7 @@ gebr_job_control_new(void)
 void
 gebr_job_control_free(GebrJobControl *jc)
 {
+	gebr_output_view_free(jc->priv->output_view);
 	g_object_unref(jc->priv->builder);
 	g_free(jc->priv->servers_info.percentages);
 	g_free(jc->priv);
@@ -2598,13 +2694,144 @@ gebr_job_control_find(GebrJobControl *jc, const gchar *rid)
 	return data.job;
 }
 
+/* How long the output of the jobs to save is waited for, in milliseconds */
+#define SAVE_OUTPUT_TIMEOUT 30000
+#define SAVE_OUTPUT_INTERVAL 100
+
+typedef struct {
+	GebrJobControl *jc;
+	gchar *fname;
+	GList *jobs;
+	gint waited;
+} SaveData;
+
+static GebrMaestroServer *
+job_control_get_maestro(GebrJob *job)
+{
+	const gchar *maddr = gebr_job_get_maestro_address(job);
+	return gebr_maestro_controller_get_maestro_for_address(gebr.maestro_controller, maddr);
+}
+
+static gboolean
+job_output_loaded(GebrJob *job)
+{
+	GebrMaestroServer *maestro = job_control_get_maestro(job);
+	return maestro && gebr_maestro_server_job_output_loaded(maestro, job);
+}
+
+/*
+ * Writes the report of @job to @fp. Its output is said partial unless all
+ * of it was loaded from Maestro.
+ */
+static void
+job_control_write_report(FILE *fp,
+			 GebrJob *job)
+{
+	gchar * title;
+	title = g_strdup_printf("---------- %s ---------\n", gebr_job_get_title(job));
+	fputs(title, fp);
+	g_free(title);
+
+	/* Start and Finish dates */
+	const gchar *start_date = gebr_job_get_start_date(job);
+	const gchar *finish_date = gebr_job_get_finish_date(job);
+	gchar *dates;
+	dates = g_strdup_printf(_("\nStart date: %s\nFinish date: %s\n"), start_date? gebr_localized_date(start_date): _("(None)"),
+				finish_date? gebr_localized_date(finish_date) : _("(None)"));
+	fputs(dates, fp);
+	g_free(dates);
+
+	/* Issues */
+	gchar *issues;
+	gchar *job_issue = gebr_job_get_issues(job);
+	issues = g_strdup_printf(_("\nIssues:\n%s"), job_issue? job_issue : _("(None)\n"));
+	fputs(issues, fp);
+	g_free(issues);
+	g_free(job_issue);
+
+	/* Input, output and log files */
+	gchar *io, *input, *output, *log;
+	gebr_job_get_io(job, &input, &output, &log);
+	io = g_strdup_printf(_("\nInput File: %s\nOutput File: %s\nLog File: %s\n"), input? input : "(None)",
+			     output? output : "(None)", log? log : "(None)");
+	fputs(io, fp);
+	g_free(io);
+	g_free(input);
+	g_free(output);
+	g_free(log);
+
+	/* Command line */
+	gchar *cmd_line;
+	gchar *command = gebr_job_get_command_line(job);
+	cmd_line = g_strdup_printf("\n%s\n", strlen(command)? command : "(None)");
+	fputs(cmd_line, fp);
+	g_free(cmd_line);
+	g_free(command);
+
+	/* Output */
+	gchar *text;
+	gchar *output_text = gebr_job_get_output(job);
+	if (job_output_loaded(job))
+		text = g_strdup_printf(_("Output:\n%s\n\n"), strlen(output_text)? output_text : "(None)");
+	else
+		text = g_strdup_printf(_("Output (partial, it could not be loaded from Maestro):\n%s\n\n"),
+				       strlen(output_text)? output_text : "(None)");
+	fputs(text, fp);
+	g_free(text);
+	g_free(output_text);
+}
+
+/*
+ * Writes the reports once the output of all jobs arrived, or the wait timed
+ * out, and stops the updates of the output of the jobs not displayed.
+ */
+static gboolean
+job_control_save_when_loaded(SaveData *data)
+{
+	gboolean loaded = TRUE;
+	FILE *fp;
+
+	for (GList *i = data->jobs; i && loaded; i = i->next)
+		loaded = job_output_loaded(i->data);
+
+	data->waited += SAVE_OUTPUT_INTERVAL;
+	if (!loaded && data->waited < SAVE_OUTPUT_TIMEOUT)
+		return TRUE;
+
+	fp = fopen(data->fname, "w");
+	if (fp == NULL)
+		gebr_message(GEBR_LOG_ERROR, TRUE, TRUE, _("Could not write file."));
+
+	for (GList *i = data->jobs; i; i = i->next) {
+		GebrJob *job = i->data;
+		GebrMaestroServer *maestro = job_control_get_maestro(job);
+
+		if (fp)
+			job_control_write_report(fp, job);
+
+		if (maestro && job != data->jc->priv->last_selection.job)
+			gebr_maestro_server_release_job_output(maestro, job);
+		g_object_unref(job);
+	}
+
+	if (fp) {
+		fclose(fp);
+		gebr_message(GEBR_LOG_INFO, TRUE, TRUE, _("Saved job information at \"%s\"."), data->fname);
+	}
+
+	g_list_free(data->jobs);
+	g_free(data->fname);
+	g_free(data);
+
+	return FALSE;
+}
+
 gboolean
 gebr_job_control_save_selected(GebrJobControl *jc)
 {
 	GtkWidget *chooser_dialog;
 	GtkFileFilter *filefilter;
 	gchar *fname;
-	FILE *fp;
 
 	/* run file chooser */
 	chooser_dialog = gebr_gui_save_dialog_new(_("Choose filename to save"), GTK_WINDOW(gebr.window));
@@ -2620,20 +2847,17 @@ gebr_job_control_save_selected(GebrJobControl *jc)
 	if (!fname)
 		return TRUE;
 
-	/* save to file */
-	fp = fopen(fname, "w");
-	if (fp == NULL) {
-		gebr_message(GEBR_LOG_ERROR, TRUE, TRUE, _("Could not write file."));
-		g_free(fname);
-		return TRUE;
-	}
-
 	GtkTreeIter iter;
 	GtkTreeModel *model;
 	GebrJob *job;
+	SaveData *data = g_new0(SaveData, 1);
 
+	data->jc = jc;
+	data->fname = fname;
 	model = gtk_tree_view_get_model(GTK_TREE_VIEW(jc->priv->view));
 
+	/* Maestro only sends the output of the jobs displayed, so the output
+	 * missing of the others is fetched before the reports are written */
 	gebr_gui_gtk_tree_view_foreach_selected(&iter, jc->priv->view) {
 		gboolean control;
 		gtk_tree_model_get(model, &iter,
@@ -2644,60 +2868,15 @@ gebr_job_control_save_selected(GebrJobControl *jc)
 		if (control)
 			continue;
 
-		gchar * title;
-		title = g_strdup_printf("---------- %s ---------\n", gebr_job_get_title(job));
-		fputs(title, fp);
-		g_free(title);
-
-		/* Start and Finish dates */
-		const gchar *start_date = gebr_job_get_start_date(job);
-		const gchar *finish_date = gebr_job_get_finish_date(job);
-		gchar *dates;
-		dates = g_strdup_printf(_("\nStart date: %s\nFinish date: %s\n"), start_date? gebr_localized_date(start_date): _("(None)"),
-					finish_date? gebr_localized_date(finish_date) : _("(None)"));
-		fputs(dates, fp);
-		g_free(dates);
-
-		/* Issues */
-		gchar *issues;
-		gchar *job_issue = gebr_job_get_issues(job);
-		issues = g_strdup_printf(_("\nIssues:\n%s"), job_issue? job_issue : _("(None)\n"));
-		fputs(issues, fp);
-		g_free(issues);
-		g_free(job_issue);
-
-		/* Input, output and log files */
-		gchar *io, *input, *output, *log;
-		gebr_job_get_io(job, &input, &output, &log);
-		io = g_strdup_printf(_("\nInput File: %s\nOutput File: %s\nLog File: %s\n"), input? input : "(None)",
-				     output? output : "(None)", log? log : "(None)");
-		fputs(io, fp);
-		g_free(io);
-		g_free(input);
-		g_free(output);
-		g_free(log);
-
-		/* Command line */
-		gchar *cmd_line;
-		gchar *command = gebr_job_get_command_line(job);
-		cmd_line = g_strdup_printf("\n%s\n", strlen(command)? command : "(None)");
-		fputs(cmd_line, fp);
-		g_free(cmd_line);
-		g_free(command);
-
-		/* Output */
-		gchar *text;
-		gchar *output_text = gebr_job_get_output(job);
-		text = g_strdup_printf(_("Output:\n%s\n\n"), strlen(output_text)? output_text : "(None)");
-		fputs(text, fp);
-		g_free(text);
-		g_free(output_text);
-
-		gebr_message(GEBR_LOG_INFO, TRUE, TRUE, _("Saved job information at \"%s\"."), fname);
+		GebrMaestroServer *maestro = job_control_get_maestro(job);
+		if (maestro)
+			gebr_maestro_server_request_job_output(maestro, job);
+		data->jobs = g_list_append(data->jobs, g_object_ref(job));
 	}
-	
-	fclose(fp);
-	g_free(fname);
+
+	if (job_control_save_when_loaded(data))
+		g_timeout_add(SAVE_OUTPUT_INTERVAL, (GSourceFunc) job_control_save_when_loaded, data);
+
 	return TRUE;
 }
 
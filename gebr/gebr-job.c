@@ -60,7 +60,7 @@ struct _GebrJobPriv {
 	gchar *snapshot_title;
 	gchar *snapshot_id;
 	gchar *gebrjob_id;
-	const gchar *server_list;
+	gchar *server_list;
 
 	gboolean is_fake;
 
@@ -71,6 +71,7 @@ struct _GebrJobPriv {
 	/* Task info */
 	GebrJobTask *tasks;
 	gint n_servers;
+	GString *output;
 };
 
 enum {
@@ -109,6 +110,8 @@ gebr_job_finalize(GObject *object)
 	g_free(job->priv->snapshot_title);
 	g_free(job->priv->snapshot_id);
 	g_free(job->priv->gebrjob_id);
+	g_free(job->priv->server_list);
+	g_string_free(job->priv->output, TRUE);
 
 	G_OBJECT_CLASS(gebr_job_parent_class)->finalize(object);
 }
@@ -258,6 +261,7 @@ gebr_job_new_with_id(const gchar *rid,
 	job->priv->runid = g_strdup(rid);
 	job->priv->run_type = g_strdup(run_type);
 	job->priv->n_servers = 0;
+	job->priv->output = g_string_new(NULL);
 	job->priv->mpi_flavor = g_strdup("");
 	job->priv->snapshot_id = g_strdup("");
 	job->priv->server_list = NULL;
@@ -269,36 +273,42 @@ void
 gebr_job_set_servers(GebrJob *job,
 		     const gchar *servers)
 {
-	if (job->priv->tasks)
-		return;
-
 	gchar **split = g_strsplit(servers, ",", 0);
 
 	if (!split)
 		return;
 
-	while (split[job->priv->n_servers])
-		job->priv->n_servers++;
-
-	job->priv->n_servers /= 2;
+	/* Jobs with dynamic scheduling get a new task for each chunk of the
+	 * loop sent to a node, so the list only grows */
+	gint n = g_strv_length(split) / 2;
+	if (n <= job->priv->n_servers) {
+		g_strfreev(split);
+		return;
+	}
 
-	job->priv->tasks = g_new0(GebrJobTask, job->priv->n_servers);
+	job->priv->tasks = g_renew(GebrJobTask, job->priv->tasks, n);
 
-	for (int i = 0; i < job->priv->n_servers; i++) {
-		job->priv->tasks[i].server = split[i*2];
+	for (int i = job->priv->n_servers; i < n; i++) {
+		job->priv->tasks[i].server = g_strdup(split[i*2]);
 		job->priv->tasks[i].percentage = g_strtod(split[i*2 + 1], NULL);
 		job->priv->tasks[i].cmd_line = NULL;
 		job->priv->tasks[i].frac = i+1;
-		job->priv->tasks[i].output = g_string_new("");
+		job->priv->tasks[i].output_len = 0;
 	}
+
+	job->priv->n_servers = n;
+	g_strfreev(split);
 }
 
 void
 gebr_job_set_server_list (GebrJob *job,
 		     const gchar *servers)
 {
-	if(!job->priv->server_list && servers && *servers)
-		job->priv->server_list = g_strdup(servers);
+	if (!servers || !*servers || g_strcmp0(job->priv->server_list, servers) == 0)
+		return;
+
+	g_free(job->priv->server_list);
+	job->priv->server_list = g_strdup(servers);
 }
 
 void
@@ -385,26 +395,54 @@ gebr_job_get_iter(GebrJob *job)
 	return &job->priv->iter;
 }
 
+/*
+ * group_tasks_by_server:
+ *
+ * A node may run several tasks of the same job. Sums the percentages of
+ * the tasks of each node, in the order the nodes first appear.
+ *
+ * Returns: the number of nodes.
+ */
+static gint
+group_tasks_by_server(GebrJob *job,
+		      gchar ***servers,
+		      gdouble **percentages)
+{
+	gint ntasks, n = 0;
+	GebrJobTask *tasks = gebr_job_get_tasks(job, &ntasks);
+
+	*servers = g_new0(gchar*, ntasks+1);
+	*percentages = g_new0(gdouble, ntasks);
+
+	for (gint i = 0; i < ntasks; i++) {
+		gint j;
+
+		if (tasks[i].percentage <= 0)
+			continue;
+
+		for (j = 0; j < n; j++)
+			if (g_strcmp0((*servers)[j], tasks[i].server) == 0)
+				break;
+
+		if (j == n)
+			(*servers)[n++] = g_strdup(tasks[i].server);
+		(*percentages)[j] += tasks[i].percentage;
+	}
+
+	return n;
+}
+
 gchar **
 gebr_job_get_servers(GebrJob *job, gint *n)
 {
 	g_return_val_if_fail(n != NULL, NULL);
 	g_return_val_if_fail(job != NULL, NULL);
 
-	gint j = 0;
-	GebrJobTask *tasks = gebr_job_get_tasks(job, n);
-
-	gchar **servers = g_new0(gchar*, *n+1);
-
-	for (gint i = 0; i < *n; i++) {
-		if (tasks[i].percentage > 0) {
-			servers[i] = g_strdup(tasks[i].server);
-			j++;
-		}
-	}
+	gchar **servers;
+	gdouble *percs;
 
-	servers[*n] = NULL;
-	*n = j;
+	*n = group_tasks_by_server(job, &servers, &percs);
+	g_free(percs);
 
 	return servers;
 }
@@ -436,11 +474,13 @@ gdouble *
 gebr_job_get_percentages(GebrJob *job, gint *n)
 {
 	g_return_val_if_fail(n!= NULL, NULL);
-	GebrJobTask *tasks = gebr_job_get_tasks(job, n);
-	gdouble *percs = g_new(gdouble, *n);
-	for (int i=0; i < *n; i++){
-		percs[i] = tasks[i].percentage;
-	}
+
+	gchar **servers;
+	gdouble *percs;
+
+	*n = group_tasks_by_server(job, &servers, &percs);
+	g_strfreev(servers);
+
 	return percs;
 }
 
@@ -458,10 +498,13 @@ gebr_job_get_command_line(GebrJob *job)
 gchar *
 gebr_job_get_output(GebrJob *job)
 {
-	GString *output = g_string_new("");
-	for (int i = 0; i < job->priv->n_servers; i++)
-		g_string_append(output, job->priv->tasks[i].output->str);
-	return g_string_free(output, FALSE);
+	return g_strndup(job->priv->output->str, job->priv->output->len);
+}
+
+GString *
+gebr_job_peek_output(GebrJob *job)
+{
+	return job->priv->output;
 }
 
 const gchar *
@@ -805,6 +848,8 @@ gebr_job_set_submit_date(GebrJob *job,
 void
 gebr_job_set_cmd_line(GebrJob *job, gint frac, const gchar *cmd_line)
 {
+	g_return_if_fail(frac >= 0 && frac < job->priv->n_servers);
+
 	if (job->priv->tasks[frac].cmd_line)
 		g_free(job->priv->tasks[frac].cmd_line);
 	job->priv->tasks[frac].cmd_line = g_strdup(cmd_line);
@@ -824,10 +869,23 @@ void
 gebr_job_append_output(GebrJob *job, gint frac,
 		       const gchar *output)
 {
-	g_string_append(job->priv->tasks[frac].output, output);
+	g_return_if_fail(frac >= 0 && frac < job->priv->n_servers);
+
+	gsize len = strlen(output);
+
+	g_string_append_len(job->priv->output, output, len);
+	job->priv->tasks[frac].output_len += len;
 	g_signal_emit(job, signals[OUTPUT], 0, frac, output);
 }
 
+gsize
+gebr_job_get_output_length(GebrJob *job, gint frac)
+{
+	g_return_val_if_fail(frac >= 0 && frac < job->priv->n_servers, 0);
+
+	return job->priv->tasks[frac].output_len;
+}
+
 void
 gebr_job_set_maestro_address(GebrJob *job, const gchar *address)
 {
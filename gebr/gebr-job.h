@@ -72,7 +72,7 @@ typedef struct {
 	gchar *server;
 	gchar *cmd_line;
 	gdouble percentage;
-	GString *output;
+	gsize output_len;
 } GebrJobTask;
 
 GType gebr_job_get_type() G_GNUC_CONST;
@@ -131,6 +131,14 @@ gchar *gebr_job_get_command_line(GebrJob *job);
 
 gchar *gebr_job_get_output(GebrJob *job);
 
+/**
+ * gebr_job_peek_output:
+ *
+ * Returns: The output of all tasks of @job, in the order it was received,
+ * owned by @job. It is only appended to.
+ */
+GString *gebr_job_peek_output(GebrJob *job);
+
 const gchar *gebr_job_get_last_run_date(GebrJob *job);
 
 const gchar *gebr_job_get_start_date(GebrJob *job);
@@ -216,6 +224,14 @@ void gebr_job_set_issues(GebrJob *job, const gchar *issues);
 
 void gebr_job_append_output(GebrJob *job, gint frac, const gchar *output);
 
+/**
+ * gebr_job_get_output_length:
+ *
+ * Returns: The number of bytes of output received for task @frac, that is,
+ * the offset of the next piece of output expected from Maestro.
+ */
+gsize gebr_job_get_output_length(GebrJob *job, gint frac);
+
 void gebr_job_set_maestro_address(GebrJob *job, const gchar *address);
 
 const gchar *gebr_job_get_maestro_address(GebrJob *job);
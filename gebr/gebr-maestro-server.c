@@ -42,6 +42,13 @@ struct _GebrMaestroServerPriv {
 	GtkTreeModel *filter;
 	GHashTable *jobs;
 	GHashTable *temp_jobs;
+
+	/* Job synchronization, see gebr_maestro_server_request_sync() */
+	gchar *sync_cursor;
+	GHashTable *stale_jobs;
+	GHashTable *watched_jobs;
+	GHashTable *output_requests;
+
 	gchar *address;
 	gchar *error_type;
 	gchar *error_msg;
@@ -124,6 +131,8 @@ static gchar *gebr_maestro_server_get_home_uri(GebrMaestroInfo *iface);
 
 static void gebr_maestro_server_set_nfs_label_for_jobs(GebrMaestroServer *maestro);
 
+static void gebr_maestro_server_request_sync(GebrMaestroServer *maestro);
+
 static const struct gebr_comm_server_ops maestro_ops = {
 	.log_message      = log_message,
 	.state_changed    = state_changed,
@@ -327,6 +336,7 @@ state_changed(GebrCommServer *comm_server,
 
 	if (state == SERVER_STATE_DISCONNECTED) {
 		gtk_list_store_clear(maestro->priv->groups_store);
+		g_hash_table_remove_all(maestro->priv->output_requests);
 
 		if (!gebr.quit)
 			gebr_project_line_show(gebr.ui_project_line);
@@ -539,17 +549,155 @@ gebr_maestro_server_set_nfs_label_for_jobs(GebrMaestroServer *maestro)
 	gebr_job_control_update_servers_model(gebr.job_control);
 }
 
+/*
+ * Removes job @id, closed by Maestro or unknown to it.
+ */
+static void
+forget_job(GebrMaestroServer *maestro, const gchar *id)
+{
+	gpointer key, job;
+
+	if (!g_hash_table_lookup_extended(maestro->priv->jobs, id, &key, &job))
+		return;
+
+	g_hash_table_remove(maestro->priv->watched_jobs, id);
+	g_hash_table_steal(maestro->priv->jobs, id);
+	gebr_job_remove(job);
+	g_free(key);
+}
+
+static void
+sync_begin(GebrMaestroServer *maestro, gboolean reset)
+{
+	if (maestro->priv->stale_jobs)
+		g_hash_table_unref(maestro->priv->stale_jobs);
+	maestro->priv->stale_jobs = NULL;
+
+	if (!reset)
+		return;
+
+	/* Every job still known by Maestro comes next */
+	GHashTableIter iter;
+	gpointer id;
+
+	maestro->priv->stale_jobs = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	g_hash_table_iter_init(&iter, maestro->priv->jobs);
+	while (g_hash_table_iter_next(&iter, &id, NULL))
+		g_hash_table_insert(maestro->priv->stale_jobs, g_strdup(id), GINT_TO_POINTER(TRUE));
+}
+
+static void
+sync_end(GebrMaestroServer *maestro, const gchar *cursor)
+{
+	GHashTableIter iter;
+	gpointer id;
+
+	g_free(maestro->priv->sync_cursor);
+	maestro->priv->sync_cursor = g_strdup(cursor);
+
+	if (maestro->priv->stale_jobs) {
+		g_hash_table_iter_init(&iter, maestro->priv->stale_jobs);
+		while (g_hash_table_iter_next(&iter, &id, NULL))
+			forget_job(maestro, id);
+		g_hash_table_unref(maestro->priv->stale_jobs);
+		maestro->priv->stale_jobs = NULL;
+	}
+
+	/* This connection must watch again the output being displayed */
+	GList *watched = g_hash_table_get_keys(maestro->priv->watched_jobs);
+	for (GList *i = watched; i; i = i->next) {
+		GebrJob *job = g_hash_table_lookup(maestro->priv->jobs, i->data);
+		if (job)
+			gebr_maestro_server_request_job_output(maestro, job);
+	}
+	g_list_free(watched);
+}
+
+static void
+request_output_page(GebrMaestroServer *maestro,
+		    const gchar *id,
+		    gint frac,
+		    gsize offset)
+{
+	gchar *key = g_strdup_printf("%s:%d", id, frac);
+
+	if (g_hash_table_lookup(maestro->priv->output_requests, key)) {
+		g_free(key);
+		return;
+	}
+
+	gsize *requested = g_new(gsize, 1);
+	*requested = offset;
+	g_hash_table_insert(maestro->priv->output_requests, key, requested);
+
+	GebrCommUri *uri = gebr_comm_uri_new();
+	gchar *frac_str = g_strdup_printf("%d", frac);
+	gchar *offset_str = g_strdup_printf("%"G_GSIZE_FORMAT, offset);
+	gebr_comm_uri_set_prefix(uri, "/output");
+	gebr_comm_uri_add_param(uri, "id", id);
+	gebr_comm_uri_add_param(uri, "frac", frac_str);
+	gebr_comm_uri_add_param(uri, "offset", offset_str);
+	gchar *url = gebr_comm_uri_to_string(uri);
+	gebr_comm_uri_free(uri);
+
+	gebr_comm_protocol_socket_send_request(maestro->priv->server->socket,
+					       GEBR_COMM_HTTP_METHOD_PUT,
+					       url, NULL);
+	g_free(url);
+	g_free(frac_str);
+	g_free(offset_str);
+}
+
+/*
+ * Handles an output message: @output starts at byte @offset of the output of
+ * task @frac, which had @total bytes when Maestro sent it. Pages already
+ * received are skipped, and missing ones requested.
+ */
+static void
+receive_output(GebrMaestroServer *maestro,
+	       const gchar *id,
+	       gint frac,
+	       gsize offset,
+	       gsize total,
+	       const gchar *output,
+	       gsize len)
+{
+	gint ntasks;
+	GebrJob *job = g_hash_table_lookup(maestro->priv->jobs, id);
+
+	if (!job)
+		return;
+
+	gebr_job_get_tasks(job, &ntasks);
+	if (frac < 1 || frac > ntasks)
+		return;
+
+	gchar *key = g_strdup_printf("%s:%d", id, frac);
+	gsize *requested = g_hash_table_lookup(maestro->priv->output_requests, key);
+	if (requested && *requested == offset) {
+		g_hash_table_remove(maestro->priv->output_requests, key);
+		requested = NULL;
+	}
+	g_free(key);
+
+	gsize have = gebr_job_get_output_length(job, frac - 1);
+	if (offset <= have && offset + len > have)
+		gebr_job_append_output(job, frac - 1, output + (have - offset));
+
+	have = gebr_job_get_output_length(job, frac - 1);
+	if (!requested && have < total)
+		request_output_page(maestro, id, frac, have);
+}
+
 void
 parse_messages(GebrCommServer *comm_server,
 	       gpointer user_data)
 {
-	GList *link;
 	struct gebr_comm_message *message;
 
 	GebrMaestroServer *maestro = user_data;
 
-	while ((link = g_list_last(comm_server->socket->protocol->messages)) != NULL) {
-		message = (struct gebr_comm_message *)link->data;
+	while ((message = g_queue_peek_head(comm_server->socket->protocol->messages)) != NULL) {
 		if (message->hash == gebr_comm_protocol_defs.ret_def.code_hash) {
 			guint ret_hash = GPOINTER_TO_UINT(g_queue_pop_head(comm_server->socket->protocol->waiting_ret_hashs));
 			if (ret_hash == gebr_comm_protocol_defs.ini_def.code_hash) {
@@ -561,8 +709,11 @@ parse_messages(GebrCommServer *comm_server,
 				GString *clocks_diff = g_list_nth_data(arguments, 0);
 
 				gebr_maestro_server_set_clocks_diff(maestro, atoi(clocks_diff->str));
+				gebr_comm_protocol_socket_set_framing(comm_server->socket,
+								      gebr_comm_protocol_socket_oldmsg_peer_framing(message->argument, 1));
 
 				gebr_comm_server_set_logged(comm_server);
+				gebr_maestro_server_request_sync(maestro);
 
 				gboolean use_key = gebr_comm_server_get_use_public_key(comm_server);
 				if (use_key) {
@@ -703,6 +854,9 @@ parse_messages(GebrCommServer *comm_server,
 			GebrJob *job = g_hash_table_lookup(maestro->priv->jobs, id->str);
 			gboolean prev_exist = FALSE;
 
+			if (maestro->priv->stale_jobs)
+				g_hash_table_remove(maestro->priv->stale_jobs, id->str);
+
 			if (!job) {
 				job = g_hash_table_lookup(maestro->priv->temp_jobs, temp_id->str);
 				if (job) {
@@ -768,6 +922,10 @@ parse_messages(GebrCommServer *comm_server,
 
 			update_queues_model(maestro, job);
 
+			/* New tasks may have been defined */
+			if (g_hash_table_lookup(maestro->priv->watched_jobs, id->str))
+				gebr_maestro_server_request_job_output(maestro, job);
+
 			gebr_comm_protocol_socket_oldmsg_split_free(arguments);
 		}
 		else if (message->hash == gebr_comm_protocol_defs.iss_def.code_hash) {
@@ -779,8 +937,10 @@ parse_messages(GebrCommServer *comm_server,
 			GString *id = g_list_nth_data(arguments, 0);
 			GString *issues = g_list_nth_data(arguments, 1);
 
+			/* Jobs unknown here are sent on synchronization */
 			GebrJob *job = g_hash_table_lookup(maestro->priv->jobs, id->str);
-			gebr_job_set_issues(job, issues->str);
+			if (job)
+				gebr_job_set_issues(job, issues->str);
 
 			gebr_comm_protocol_socket_oldmsg_split_free(arguments);
 		}
@@ -795,24 +955,22 @@ parse_messages(GebrCommServer *comm_server,
 			GString *cmd = g_list_nth_data(arguments, 2);
 
 			GebrJob *job = g_hash_table_lookup(maestro->priv->jobs, id->str);
-			gebr_job_set_cmd_line(job, atoi(frac->str) - 1, cmd->str);
+			if (job)
+				gebr_job_set_cmd_line(job, atoi(frac->str) - 1, cmd->str);
 
 			gebr_comm_protocol_socket_oldmsg_split_free(arguments);
 		}
 		else if (message->hash == gebr_comm_protocol_defs.out_def.code_hash) {
-			GList *arguments;
+			struct gebr_comm_slice arguments[5];
 
-			if ((arguments = gebr_comm_protocol_socket_oldmsg_split(message->argument, 3)) == NULL)
+			/* output bursts are frequent, don't copy them */
+			if (!gebr_comm_protocol_socket_oldmsg_split_slices(message->argument, 5, arguments))
 				goto err;
 
-			GString *id = g_list_nth_data(arguments, 0);
-			GString *frac = g_list_nth_data(arguments, 1);
-			GString *output = g_list_nth_data(arguments, 2);
-
-			GebrJob *job = g_hash_table_lookup(maestro->priv->jobs, id->str);
-			gebr_job_append_output(job, atoi(frac->str) - 1, output->str);
-
-			gebr_comm_protocol_socket_oldmsg_split_free(arguments);
+			receive_output(maestro, arguments[0].str, atoi(arguments[1].str),
+				       g_ascii_strtoull(arguments[2].str, NULL, 10),
+				       g_ascii_strtoull(arguments[3].str, NULL, 10),
+				       arguments[4].str, arguments[4].len);
 		}
 		else if (message->hash == gebr_comm_protocol_defs.sta_def.code_hash) {
 			GList *arguments;
@@ -826,9 +984,10 @@ parse_messages(GebrCommServer *comm_server,
 			GString *parameter = g_list_nth_data(arguments, 2);
 
 			GebrJob *job = g_hash_table_lookup(maestro->priv->jobs, id->str);
-			gebr_job_set_status(job, gebr_comm_job_get_status_from_string(status->str), parameter->str);
-
-			update_queues_model(maestro, job);
+			if (job) {
+				gebr_job_set_status(job, gebr_comm_job_get_status_from_string(status->str), parameter->str);
+				update_queues_model(maestro, job);
+			}
 
 			gebr_comm_protocol_socket_oldmsg_split_free(arguments);
 		}
@@ -841,9 +1000,23 @@ parse_messages(GebrCommServer *comm_server,
 
 			GString *id = g_list_nth_data(arguments, 0);
 
-			GebrJob *job = g_hash_table_lookup(maestro->priv->jobs, id->str);
+			forget_job(maestro, id->str);
+
+			gebr_comm_protocol_socket_oldmsg_split_free(arguments);
+		}
+		else if (message->hash == gebr_comm_protocol_defs.syn_def.code_hash) {
+			GList *arguments;
+
+			if ((arguments = gebr_comm_protocol_socket_oldmsg_split(message->argument, 2)) == NULL)
+				goto err;
+
+			GString *mark = g_list_nth_data(arguments, 0);
+			GString *value = g_list_nth_data(arguments, 1);
 
-			gebr_job_remove(job);
+			if (g_strcmp0(mark->str, "begin") == 0)
+				sync_begin(maestro, atoi(value->str));
+			else
+				sync_end(maestro, value->str);
 
 			gebr_comm_protocol_socket_oldmsg_split_free(arguments);
 		}
@@ -1065,15 +1238,13 @@ parse_messages(GebrCommServer *comm_server,
 			gebr_comm_protocol_socket_oldmsg_split_free(arguments);
 		}
 
-		gebr_comm_message_free(message);
-		comm_server->socket->protocol->messages = g_list_delete_link(comm_server->socket->protocol->messages, link);
+		gebr_comm_message_free(g_queue_pop_head(comm_server->socket->protocol->messages));
 	}
 
 	return;
 
 err:
-	gebr_comm_message_free(message);
-	comm_server->socket->protocol->messages = g_list_delete_link(comm_server->socket->protocol->messages, link);
+	gebr_comm_message_free(g_queue_pop_head(comm_server->socket->protocol->messages));
 	gebr_comm_server_disconnect(comm_server);
 }
 
@@ -1126,6 +1297,11 @@ gebr_maestro_server_finalize(GObject *object)
 	g_object_unref(maestro->priv->store);
 	g_hash_table_unref(maestro->priv->jobs);
 	g_hash_table_unref(maestro->priv->temp_jobs);
+	g_hash_table_unref(maestro->priv->watched_jobs);
+	g_hash_table_unref(maestro->priv->output_requests);
+	if (maestro->priv->stale_jobs)
+		g_hash_table_unref(maestro->priv->stale_jobs);
+	g_free(maestro->priv->sync_cursor);
 	g_free(maestro->priv->nfsid);
 	g_free(maestro->priv->home);
 	unmount_gvfs(maestro, FALSE);
@@ -1298,6 +1474,10 @@ gebr_maestro_server_init(GebrMaestroServer *maestro)
 	maestro->priv->store = gtk_list_store_new(1, G_TYPE_POINTER);
 	maestro->priv->jobs = g_hash_table_new(g_str_hash, g_str_equal);
 	maestro->priv->temp_jobs = g_hash_table_new(g_str_hash, g_str_equal);
+	maestro->priv->watched_jobs = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	maestro->priv->output_requests = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+	maestro->priv->stale_jobs = NULL;
+	maestro->priv->sync_cursor = NULL;
 	maestro->priv->queues_model = gtk_list_store_new(1, GEBR_TYPE_JOB);
 	maestro->priv->has_connected_daemon = FALSE;
 	maestro->priv->window = NULL;
@@ -1605,6 +1785,102 @@ gebr_maestro_server_add_temporary_job(GebrMaestroServer *maestro,
 			    g_strdup(gebr_job_get_id(job)), job);
 }
 
+/*
+ * Asks Maestro for the jobs changed since the last synchronization, or for
+ * all of them if there was none. The output of the tasks is not sent, see
+ * gebr_maestro_server_request_job_output().
+ */
+static void
+gebr_maestro_server_request_sync(GebrMaestroServer *maestro)
+{
+	GebrCommUri *uri = gebr_comm_uri_new();
+	gebr_comm_uri_set_prefix(uri, "/sync");
+	if (maestro->priv->sync_cursor)
+		gebr_comm_uri_add_param(uri, "cursor", maestro->priv->sync_cursor);
+	gchar *url = gebr_comm_uri_to_string(uri);
+	gebr_comm_uri_free(uri);
+
+	gebr_comm_protocol_socket_send_request(maestro->priv->server->socket,
+					       GEBR_COMM_HTTP_METHOD_PUT,
+					       url, NULL);
+	g_free(url);
+}
+
+void
+gebr_maestro_server_request_job_output(GebrMaestroServer *maestro,
+				       GebrJob *job)
+{
+	gint ntasks;
+	const gchar *id = gebr_job_get_id(job);
+
+	g_return_if_fail(GEBR_IS_MAESTRO_SERVER(maestro));
+
+	if (!g_hash_table_lookup(maestro->priv->jobs, id))
+		return;
+
+	if (!g_hash_table_lookup(maestro->priv->watched_jobs, id))
+		g_hash_table_insert(maestro->priv->watched_jobs, g_strdup(id), GINT_TO_POINTER(TRUE));
+
+	if (!gebr_comm_server_is_logged(maestro->priv->server))
+		return;
+
+	gebr_job_get_tasks(job, &ntasks);
+	for (gint i = 0; i < ntasks; i++)
+		request_output_page(maestro, id, i + 1, gebr_job_get_output_length(job, i));
+}
+
+gboolean
+gebr_maestro_server_job_output_loaded(GebrMaestroServer *maestro,
+				      GebrJob *job)
+{
+	gint ntasks;
+	const gchar *id = gebr_job_get_id(job);
+
+	g_return_val_if_fail(GEBR_IS_MAESTRO_SERVER(maestro), FALSE);
+
+	/* The requests pending are dropped on disconnection */
+	if (!gebr_comm_server_is_logged(maestro->priv->server))
+		return FALSE;
+
+	gebr_job_get_tasks(job, &ntasks);
+	for (gint i = 0; i < ntasks; i++) {
+		gchar *key = g_strdup_printf("%s:%d", id, i + 1);
+		gboolean pending = g_hash_table_lookup(maestro->priv->output_requests, key) != NULL;
+
+		g_free(key);
+		if (pending)
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+void
+gebr_maestro_server_release_job_output(GebrMaestroServer *maestro,
+				       GebrJob *job)
+{
+	const gchar *id = gebr_job_get_id(job);
+
+	g_return_if_fail(GEBR_IS_MAESTRO_SERVER(maestro));
+
+	if (!g_hash_table_remove(maestro->priv->watched_jobs, id))
+		return;
+
+	if (!gebr_comm_server_is_logged(maestro->priv->server))
+		return;
+
+	GebrCommUri *uri = gebr_comm_uri_new();
+	gebr_comm_uri_set_prefix(uri, "/unwatch");
+	gebr_comm_uri_add_param(uri, "id", id);
+	gchar *url = gebr_comm_uri_to_string(uri);
+	gebr_comm_uri_free(uri);
+
+	gebr_comm_protocol_socket_send_request(maestro->priv->server->socket,
+					       GEBR_COMM_HTTP_METHOD_PUT,
+					       url, NULL);
+	g_free(url);
+}
+
 void
 gebr_maestro_server_add_tag_to(GebrMaestroServer *maestro,
 			       GebrDaemonServer *daemon,
@@ -156,6 +156,34 @@ void gebr_maestro_server_connect(GebrMaestroServer *maestro);
 
 void gebr_maestro_server_add_temporary_job(GebrMaestroServer *maestro, GebrJob *job);
 
+/**
+ * gebr_maestro_server_request_job_output:
+ *
+ * Fetches, page by page, the output of @job missing here, and keeps it
+ * updated from then on. Maestro only forwards the output of such jobs.
+ */
+void gebr_maestro_server_request_job_output(GebrMaestroServer *maestro,
+					    GebrJob *job);
+
+/**
+ * gebr_maestro_server_job_output_loaded:
+ *
+ * Returns: %TRUE if the pages of the output of @job requested with
+ * gebr_maestro_server_request_job_output() all arrived, so it holds all the
+ * output Maestro had when it answered.
+ */
+gboolean gebr_maestro_server_job_output_loaded(GebrMaestroServer *maestro,
+					       GebrJob *job);
+
+/**
+ * gebr_maestro_server_release_job_output:
+ *
+ * Stops the updates of the output of @job, which is no longer displayed. The
+ * output received so far is kept, see gebr_maestro_server_request_job_output().
+ */
+void gebr_maestro_server_release_job_output(GebrMaestroServer *maestro,
+					    GebrJob *job);
+
 void gebr_maestro_server_add_tag_to(GebrMaestroServer *maestro,
 				    GebrDaemonServer *daemon,
 				    const gchar *tag);
@@ -0,0 +1,196 @@
+/*
+ * gebr-output-store.c
+ * This file is part of GêBR Project
+ *
+ * Copyright (C) 2012 - GêBR Core Team (www.gebrproject.com)
+ *
+ * GêBR Project is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * GêBR Project is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GêBR Project. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gebr-output-store.h"
+
+#include <string.h>
+
+/* lines between two offsets kept in the index */
+#define LINES_PER_CHECKPOINT 256
+
+struct _GebrOutputStore {
+	/* The text is not owned, only the first length bytes are indexed */
+	GString *text;
+	gsize length;
+
+	/* checkpoints[k] is the offset of line k * LINES_PER_CHECKPOINT */
+	GArray *checkpoints;
+	guint n_breaks;
+	gsize last_line_start;
+};
+
+static GString empty = { "", 0, 0 };
+
+GebrOutputStore *
+gebr_output_store_new(void)
+{
+	GebrOutputStore *store = g_new(GebrOutputStore, 1);
+
+	store->checkpoints = g_array_new(FALSE, FALSE, sizeof(gsize));
+	gebr_output_store_set_text(store, NULL);
+
+	return store;
+}
+
+void
+gebr_output_store_free(GebrOutputStore *store)
+{
+	g_array_free(store->checkpoints, TRUE);
+	g_free(store);
+}
+
+void
+gebr_output_store_set_text(GebrOutputStore *store,
+			   GString *text)
+{
+	gsize zero = 0;
+
+	store->text = text ? text : &empty;
+	store->length = 0;
+	g_array_set_size(store->checkpoints, 0);
+	g_array_append_val(store->checkpoints, zero);
+	store->n_breaks = 0;
+	store->last_line_start = 0;
+}
+
+void
+gebr_output_store_update(GebrOutputStore *store)
+{
+	const gchar *p = store->text->str + store->length;
+	const gchar *end = store->text->str + store->text->len;
+	const gchar *nl;
+
+	while ((nl = memchr(p, '\n', end - p))) {
+		p = nl + 1;
+		store->last_line_start = p - store->text->str;
+		if (++store->n_breaks % LINES_PER_CHECKPOINT == 0)
+			g_array_append_val(store->checkpoints, store->last_line_start);
+	}
+
+	store->length = store->text->len;
+}
+
+gsize
+gebr_output_store_get_length(GebrOutputStore *store)
+{
+	return store->length;
+}
+
+const gchar *
+gebr_output_store_peek(GebrOutputStore *store,
+		       gsize offset)
+{
+	return store->text->str + MIN(offset, store->length);
+}
+
+guint
+gebr_output_store_get_n_lines(GebrOutputStore *store)
+{
+	return store->n_breaks + (store->length > store->last_line_start ? 1 : 0);
+}
+
+gsize
+gebr_output_store_get_line_offset(GebrOutputStore *store,
+				  guint line)
+{
+	if (line > store->n_breaks)
+		return store->length;
+	if (line == store->n_breaks)
+		return store->last_line_start;
+
+	gsize offset = g_array_index(store->checkpoints, gsize, line / LINES_PER_CHECKPOINT);
+	for (guint i = 0; i < line % LINES_PER_CHECKPOINT; i++) {
+		const gchar *nl = memchr(store->text->str + offset, '\n', store->length - offset);
+		offset = nl - store->text->str + 1;
+	}
+
+	return offset;
+}
+
+guint
+gebr_output_store_get_line_at_offset(GebrOutputStore *store,
+				     gsize offset)
+{
+	guint lo = 0, hi = store->checkpoints->len - 1;
+
+	offset = MIN(offset, store->length);
+
+	/* The last checkpoint at or before offset */
+	while (lo < hi) {
+		guint mid = (lo + hi + 1) / 2;
+		if (g_array_index(store->checkpoints, gsize, mid) <= offset)
+			lo = mid;
+		else
+			hi = mid - 1;
+	}
+
+	guint line = lo * LINES_PER_CHECKPOINT;
+	const gchar *p = store->text->str + g_array_index(store->checkpoints, gsize, lo);
+	const gchar *end = store->text->str + offset;
+	const gchar *nl;
+
+	while ((nl = memchr(p, '\n', end - p))) {
+		line++;
+		p = nl + 1;
+	}
+
+	return line;
+}
+
+gboolean
+gebr_output_store_search(GebrOutputStore *store,
+			 const gchar *needle,
+			 gsize from,
+			 gboolean forward,
+			 gboolean case_sensitive,
+			 gsize *match)
+{
+	const gchar *text = store->text->str;
+	gsize len = store->length;
+	gsize n = strlen(needle);
+
+	if (!n || n > len)
+		return FALSE;
+
+	from = MIN(from, len);
+
+	/* Candidates start between first and last */
+	gsize first = forward ? from : 0;
+	gsize last = forward ? len - n : (from >= n ? from - n : 0);
+	if (first > last || (!forward && from < n))
+		return FALSE;
+
+	for (gsize i = 0; i <= last - first; i++) {
+		gsize pos = forward ? first + i : last - i;
+
+		if (case_sensitive) {
+			if (text[pos] == needle[0] && memcmp(text + pos, needle, n) == 0) {
+				*match = pos;
+				return TRUE;
+			}
+		} else if (g_ascii_tolower(text[pos]) == g_ascii_tolower(needle[0])
+			   && g_ascii_strncasecmp(text + pos, needle, n) == 0) {
+			*match = pos;
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
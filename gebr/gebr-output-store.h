@@ -0,0 +1,113 @@
+/*
+ * gebr-output-store.h
+ * This file is part of GêBR Project
+ *
+ * Copyright (C) 2012 - GêBR Core Team (www.gebrproject.com)
+ *
+ * GêBR Project is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * GêBR Project is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GêBR Project. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GEBR_OUTPUT_STORE_H__
+#define __GEBR_OUTPUT_STORE_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/**
+ * GebrOutputStore:
+ *
+ * An index of the lines of the output of a job, as shown by the job
+ * control. The text itself is the buffer kept by the job, see
+ * gebr_output_store_set_text(). Only the offset of every few lines is kept;
+ * the index grows as output is appended, scanning only the new text.
+ */
+typedef struct _GebrOutputStore GebrOutputStore;
+
+GebrOutputStore *gebr_output_store_new(void);
+
+void gebr_output_store_free(GebrOutputStore *store);
+
+/**
+ * gebr_output_store_set_text:
+ * @text: the text to index, or %NULL for none
+ *
+ * Makes @store index @text, which is not copied. It must only be appended
+ * to, and outlive @store or the next call to this function. Nothing is
+ * indexed until gebr_output_store_update() is called.
+ */
+void gebr_output_store_set_text(GebrOutputStore *store,
+				GString *text);
+
+/**
+ * gebr_output_store_update:
+ *
+ * Indexes the text appended since the last update. Until then, @store only
+ * covers the text it had.
+ */
+void gebr_output_store_update(GebrOutputStore *store);
+
+gsize gebr_output_store_get_length(GebrOutputStore *store);
+
+/**
+ * gebr_output_store_peek:
+ *
+ * Returns: The text from byte @offset to the end, valid until the next
+ * change of @store.
+ */
+const gchar *gebr_output_store_peek(GebrOutputStore *store,
+				    gsize offset);
+
+/**
+ * gebr_output_store_get_n_lines:
+ *
+ * Returns: The number of lines, counting a last one without a line break.
+ */
+guint gebr_output_store_get_n_lines(GebrOutputStore *store);
+
+/**
+ * gebr_output_store_get_line_offset:
+ *
+ * Returns: The offset where @line starts, or the length of @store if @line
+ * is past its end.
+ */
+gsize gebr_output_store_get_line_offset(GebrOutputStore *store,
+					guint line);
+
+/**
+ * gebr_output_store_get_line_at_offset:
+ *
+ * Returns: The line containing byte @offset.
+ */
+guint gebr_output_store_get_line_at_offset(GebrOutputStore *store,
+					   gsize offset);
+
+/**
+ * gebr_output_store_search:
+ * @from: where the search starts; a backward search finds matches ending
+ * before it
+ * @match: the offset of the match found
+ *
+ * Returns: %TRUE if @needle was found.
+ */
+gboolean gebr_output_store_search(GebrOutputStore *store,
+				  const gchar *needle,
+				  gsize from,
+				  gboolean forward,
+				  gboolean case_sensitive,
+				  gsize *match);
+
+G_END_DECLS
+
+#endif /* __GEBR_OUTPUT_STORE_H__ */
@@ -0,0 +1,412 @@
+/*
+ * gebr-output-view.c
+ * This file is part of GêBR Project
+ *
+ * Copyright (C) 2012 - GêBR Core Team (www.gebrproject.com)
+ *
+ * GêBR Project is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * GêBR Project is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GêBR Project. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gebr-output-view.h"
+
+#include <string.h>
+
+#include "gebr-output-store.h"
+
+/* lines loaded at a time when scrolling */
+#define PAGE_LINES		1000
+/* lines kept in the text buffer */
+#define MAX_WINDOW_LINES	(4 * PAGE_LINES)
+
+struct _GebrOutputView {
+	GebrOutputStore *store;
+	GObject *owner;
+	GtkTextView *view;
+	GtkTextBuffer *buffer;
+	GtkAdjustment *vadj;
+	GtkTextMark *end_mark;
+
+	/* The text buffer holds the output from line first up to byte end */
+	guint first;
+	gsize end;
+
+	guint check_source;
+	gboolean updating;
+};
+
+/* Store and buffer positions {{{1 */
+/*
+ * Lines in the buffer are the lines of the store, without the '\r's, which
+ * GtkTextBuffer would take as line breaks.
+ */
+static void
+iter_at_offset(GebrOutputView *ov, GtkTextIter *iter, gsize offset)
+{
+	guint line = gebr_output_store_get_line_at_offset(ov->store, offset);
+	gsize start = gebr_output_store_get_line_offset(ov->store, line);
+	const gchar *text = gebr_output_store_peek(ov->store, start);
+	gint index = 0;
+
+	for (gsize i = 0; i < offset - start; i++)
+		if (text[i] != '\r')
+			index++;
+
+	gtk_text_buffer_get_iter_at_line_index(ov->buffer, iter, line - ov->first, index);
+}
+
+static gsize
+offset_at_iter(GebrOutputView *ov, GtkTextIter *iter)
+{
+	gsize offset = gebr_output_store_get_line_offset(ov->store, ov->first + gtk_text_iter_get_line(iter));
+	const gchar *text = gebr_output_store_peek(ov->store, offset);
+	gsize len = gebr_output_store_get_length(ov->store) - offset;
+	gint index = gtk_text_iter_get_line_index(iter);
+	gsize i = 0;
+
+	for (gint n = 0; i < len && n < index; i++)
+		if (text[i] != '\r')
+			n++;
+
+	return offset + i;
+}
+
+static guint
+end_line(GebrOutputView *ov)
+{
+	guint line = gebr_output_store_get_line_at_offset(ov->store, ov->end);
+
+	/* A line cut by the end of the window counts as shown */
+	if (ov->end > gebr_output_store_get_line_offset(ov->store, line))
+		line++;
+
+	return line;
+}
+
+/* Buffer changes {{{1 */
+static void
+insert_range(GebrOutputView *ov, GtkTextIter *iter, gsize from, gsize to)
+{
+	const gchar *text = gebr_output_store_peek(ov->store, from);
+	GString *chunk = g_string_sized_new(to - from);
+
+	for (gsize i = 0; i < to - from; i++)
+		if (text[i] != '\r')
+			g_string_append_c(chunk, text[i]);
+
+	/* GtkTextBuffer only takes UTF-8 */
+	const gchar *valid_end;
+	gchar *p = chunk->str;
+	while (!g_utf8_validate(p, chunk->str + chunk->len - p, &valid_end)) {
+		p = (gchar *) valid_end;
+		*p++ = '?';
+	}
+
+	gtk_text_buffer_insert(ov->buffer, iter, chunk->str, chunk->len);
+	g_string_free(chunk, TRUE);
+}
+
+static void
+reset_window(GebrOutputView *ov, guint first, gsize end)
+{
+	GtkTextIter iter;
+
+	gtk_text_buffer_set_text(ov->buffer, "", 0);
+	gtk_text_buffer_get_start_iter(ov->buffer, &iter);
+	insert_range(ov, &iter, gebr_output_store_get_line_offset(ov->store, first), end);
+	ov->first = first;
+	ov->end = end;
+}
+
+static void
+drop_lines_before(GebrOutputView *ov, guint line)
+{
+	GtkTextIter start, iter;
+
+	if (line <= ov->first)
+		return;
+
+	gtk_text_buffer_get_start_iter(ov->buffer, &start);
+	gtk_text_buffer_get_iter_at_line(ov->buffer, &iter, line - ov->first);
+	gtk_text_buffer_delete(ov->buffer, &start, &iter);
+	ov->first = line;
+}
+
+static void
+drop_lines_from(GebrOutputView *ov, guint line)
+{
+	GtkTextIter iter, end;
+
+	if (line >= end_line(ov))
+		return;
+
+	gtk_text_buffer_get_iter_at_line(ov->buffer, &iter, line - ov->first);
+	gtk_text_buffer_get_end_iter(ov->buffer, &end);
+	gtk_text_buffer_delete(ov->buffer, &iter, &end);
+	ov->end = gebr_output_store_get_line_offset(ov->store, line);
+}
+
+static GtkTextMark *
+mark_top_line(GebrOutputView *ov)
+{
+	GtkTextIter iter;
+
+	gtk_text_view_get_line_at_y(ov->view, &iter, (gint) gtk_adjustment_get_value(ov->vadj), NULL);
+	return gtk_text_buffer_create_mark(ov->buffer, NULL, &iter, TRUE);
+}
+
+static void
+scroll_to_top_mark(GebrOutputView *ov, GtkTextMark *mark)
+{
+	gtk_text_view_scroll_to_mark(ov->view, mark, 0, TRUE, 0, 0);
+	gtk_text_buffer_delete_mark(ov->buffer, mark);
+}
+
+/* Paging {{{1 */
+static void
+load_previous_page(GebrOutputView *ov)
+{
+	GtkTextIter iter;
+	guint first = ov->first > PAGE_LINES ? ov->first - PAGE_LINES : 0;
+
+	/* Right gravity: it stays on the line which was at the top */
+	gtk_text_buffer_get_start_iter(ov->buffer, &iter);
+	GtkTextMark *mark = gtk_text_buffer_create_mark(ov->buffer, NULL, &iter, FALSE);
+
+	insert_range(ov, &iter, gebr_output_store_get_line_offset(ov->store, first),
+		     gebr_output_store_get_line_offset(ov->store, ov->first));
+	ov->first = first;
+	drop_lines_from(ov, first + MAX_WINDOW_LINES);
+
+	scroll_to_top_mark(ov, mark);
+}
+
+static void
+load_next_page(GebrOutputView *ov)
+{
+	GtkTextIter iter;
+	guint line = gebr_output_store_get_line_at_offset(ov->store, ov->end);
+	gsize end = gebr_output_store_get_line_offset(ov->store, line + PAGE_LINES);
+	GtkTextMark *mark = mark_top_line(ov);
+
+	gtk_text_buffer_get_end_iter(ov->buffer, &iter);
+	insert_range(ov, &iter, ov->end, end);
+	ov->end = end;
+
+	guint last = end_line(ov);
+	if (last - ov->first > MAX_WINDOW_LINES) {
+		drop_lines_before(ov, last - MAX_WINDOW_LINES);
+		scroll_to_top_mark(ov, mark);
+	} else
+		gtk_text_buffer_delete_mark(ov->buffer, mark);
+}
+
+static gboolean
+check_window(GebrOutputView *ov)
+{
+	ov->check_source = 0;
+
+	if (!ov->vadj)
+		return FALSE;
+
+	gdouble value = gtk_adjustment_get_value(ov->vadj);
+	gdouble lower = gtk_adjustment_get_lower(ov->vadj);
+	gdouble upper = gtk_adjustment_get_upper(ov->vadj);
+	gdouble page = gtk_adjustment_get_page_size(ov->vadj);
+
+	ov->updating = TRUE;
+	if (value - lower < page && ov->first > 0)
+		load_previous_page(ov);
+	else if (upper - value - page < page && ov->end < gebr_output_store_get_length(ov->store))
+		load_next_page(ov);
+	ov->updating = FALSE;
+
+	return FALSE;
+}
+
+static void
+on_adjustment_changed(GtkAdjustment *adj, GebrOutputView *ov)
+{
+	if (!ov->updating && !ov->check_source)
+		ov->check_source = g_idle_add((GSourceFunc) check_window, ov);
+}
+
+static void
+set_vadjustment(GebrOutputView *ov, GtkAdjustment *vadj)
+{
+	if (ov->vadj) {
+		g_signal_handlers_disconnect_by_func(ov->vadj, on_adjustment_changed, ov);
+		g_object_unref(ov->vadj);
+	}
+
+	ov->vadj = vadj;
+
+	if (vadj) {
+		g_object_ref(vadj);
+		g_signal_connect(vadj, "value-changed", G_CALLBACK(on_adjustment_changed), ov);
+		g_signal_connect(vadj, "changed", G_CALLBACK(on_adjustment_changed), ov);
+	}
+}
+
+/* The view gets new adjustments when it is reparented */
+static void
+on_set_scroll_adjustments(GtkTextView *view,
+			  GtkAdjustment *hadj,
+			  GtkAdjustment *vadj,
+			  GebrOutputView *ov)
+{
+	set_vadjustment(ov, vadj);
+}
+
+/* Public methods {{{1 */
+GebrOutputView *
+gebr_output_view_new(GtkTextView *view)
+{
+	GebrOutputView *ov = g_new0(GebrOutputView, 1);
+	GtkTextIter iter;
+
+	ov->store = gebr_output_store_new();
+	ov->view = view;
+	ov->buffer = gtk_text_view_get_buffer(view);
+
+	gtk_text_buffer_get_end_iter(ov->buffer, &iter);
+	ov->end_mark = gtk_text_buffer_create_mark(ov->buffer, NULL, &iter, FALSE);
+
+	set_vadjustment(ov, view->vadjustment);
+	g_signal_connect_after(view, "set-scroll-adjustments",
+			       G_CALLBACK(on_set_scroll_adjustments), ov);
+
+	return ov;
+}
+
+void
+gebr_output_view_free(GebrOutputView *ov)
+{
+	if (ov->check_source)
+		g_source_remove(ov->check_source);
+	g_signal_handlers_disconnect_by_func(ov->view, on_set_scroll_adjustments, ov);
+	set_vadjustment(ov, NULL);
+	if (ov->owner)
+		g_object_unref(ov->owner);
+	gebr_output_store_free(ov->store);
+	g_free(ov);
+}
+
+void
+gebr_output_view_set_text(GebrOutputView *ov,
+			  GObject *owner,
+			  GString *text)
+{
+	if (owner)
+		g_object_ref(owner);
+	if (ov->owner)
+		g_object_unref(ov->owner);
+	ov->owner = owner;
+
+	gebr_output_store_set_text(ov->store, text);
+	gtk_text_buffer_set_text(ov->buffer, "", 0);
+	ov->first = 0;
+	ov->end = 0;
+}
+
+void
+gebr_output_view_update(GebrOutputView *ov,
+			gboolean follow)
+{
+	gboolean at_end = ov->end == gebr_output_store_get_length(ov->store);
+
+	gebr_output_store_update(ov->store);
+
+	/* The window is not at the end, the new text is loaded when scrolled to */
+	if (!at_end)
+		return;
+
+	gsize end = gebr_output_store_get_length(ov->store);
+	if (!follow) {
+		gsize max = gebr_output_store_get_line_offset(ov->store, ov->first + MAX_WINDOW_LINES);
+		end = MAX(ov->end, MIN(end, max));
+	}
+	if (end == ov->end)
+		return;
+
+	ov->updating = TRUE;
+
+	guint last = gebr_output_store_get_line_at_offset(ov->store, end);
+	if (end > gebr_output_store_get_line_offset(ov->store, last))
+		last++;
+
+	if (last - ov->first > MAX_WINDOW_LINES) {
+		guint first = last - MAX_WINDOW_LINES;
+		if (gebr_output_store_get_line_offset(ov->store, first) >= ov->end)
+			reset_window(ov, first, end);
+		else {
+			GtkTextIter iter;
+			gtk_text_buffer_get_end_iter(ov->buffer, &iter);
+			insert_range(ov, &iter, ov->end, end);
+			ov->end = end;
+			drop_lines_before(ov, first);
+		}
+	} else {
+		GtkTextIter iter;
+		gtk_text_buffer_get_end_iter(ov->buffer, &iter);
+		insert_range(ov, &iter, ov->end, end);
+		ov->end = end;
+	}
+
+	if (follow)
+		gtk_text_view_scroll_to_mark(ov->view, ov->end_mark, 0, FALSE, 0, 0);
+
+	ov->updating = FALSE;
+}
+
+gboolean
+gebr_output_view_search(GebrOutputView *ov,
+			const gchar *needle,
+			gboolean forward,
+			gboolean case_sensitive)
+{
+	GtkTextIter start, end;
+	gsize from, match;
+
+	if (!gtk_text_buffer_get_selection_bounds(ov->buffer, &start, &end)) {
+		gtk_text_buffer_get_iter_at_mark(ov->buffer, &start,
+						 gtk_text_buffer_get_insert(ov->buffer));
+		end = start;
+	}
+	from = offset_at_iter(ov, forward ? &end : &start);
+
+	if (!gebr_output_store_search(ov->store, needle, from, forward, case_sensitive, &match))
+		return FALSE;
+
+	gsize match_end = match + strlen(needle);
+	guint line = gebr_output_store_get_line_at_offset(ov->store, match);
+
+	ov->updating = TRUE;
+
+	/* Load the pages around the match */
+	if (line < ov->first || match_end > ov->end) {
+		guint last = gebr_output_store_get_line_at_offset(ov->store, match_end);
+		reset_window(ov, line > PAGE_LINES ? line - PAGE_LINES : 0,
+			     gebr_output_store_get_line_offset(ov->store, last + PAGE_LINES));
+	}
+
+	iter_at_offset(ov, &start, match);
+	iter_at_offset(ov, &end, match_end);
+	gtk_text_buffer_select_range(ov->buffer, &start, &end);
+	gtk_text_view_scroll_to_mark(ov->view, gtk_text_buffer_get_insert(ov->buffer),
+				     0.1, FALSE, 0, 0);
+
+	ov->updating = FALSE;
+
+	return TRUE;
+}
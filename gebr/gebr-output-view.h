@@ -0,0 +1,79 @@
+/*
+ * gebr-output-view.h
+ * This file is part of GêBR Project
+ *
+ * Copyright (C) 2012 - GêBR Core Team (www.gebrproject.com)
+ *
+ * GêBR Project is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * GêBR Project is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GêBR Project. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GEBR_OUTPUT_VIEW_H__
+#define __GEBR_OUTPUT_VIEW_H__
+
+#include <gtk/gtk.h>
+
+G_BEGIN_DECLS
+
+/**
+ * GebrOutputView:
+ *
+ * Shows a #GebrOutputStore in a #GtkTextView. Only a window of a few
+ * thousand lines is kept in the text buffer; older or newer pages are
+ * loaded as the view is scrolled near its edges, and pages far from the
+ * visible ones are dropped. Carriage returns are not shown.
+ */
+typedef struct _GebrOutputView GebrOutputView;
+
+GebrOutputView *gebr_output_view_new(GtkTextView *view);
+
+void gebr_output_view_free(GebrOutputView *ov);
+
+/**
+ * gebr_output_view_set_text:
+ * @owner: the object keeping @text, referenced while it is shown, or %NULL
+ * @text: the output to show, or %NULL to show nothing
+ *
+ * Shows @text, which is not copied. Call gebr_output_view_update() to load
+ * it, and again whenever output is appended to it.
+ */
+void gebr_output_view_set_text(GebrOutputView *ov,
+			       GObject *owner,
+			       GString *text);
+
+/**
+ * gebr_output_view_update:
+ * @follow: whether the view scrolls to show the end of the output
+ *
+ * Takes in the output appended since the last update. It is only put in
+ * the text buffer if the view shows the end of the output.
+ */
+void gebr_output_view_update(GebrOutputView *ov,
+			     gboolean follow);
+
+/**
+ * gebr_output_view_search:
+ *
+ * Searches the whole output for @needle, starting at the selection, and
+ * selects the match.
+ *
+ * Returns: %TRUE if @needle was found.
+ */
+gboolean gebr_output_view_search(GebrOutputView *ov,
+				 const gchar *needle,
+				 gboolean forward,
+				 gboolean case_sensitive);
+
+G_END_DECLS
+
+#endif /* __GEBR_OUTPUT_VIEW_H__ */
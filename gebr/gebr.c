@@ -33,6 +33,7 @@
 #include <libgebr/date.h>
 #include <libgebr/gebr-validator.h>
 #include <libgebr/gui/gebr-gui-utils.h>
+#include <libgebr/comm/gebr-comm-transport-pool.h>
 
 #include "gebr.h"
 #include "project.h"
@@ -40,6 +41,7 @@
 #include "callbacks.h"
 #include "document.h"
 #include "flow.h"
+#include "line.h"
 #include "ui_project_line.h"
 #include "gebr-maestro-server.h"
 
@@ -111,7 +113,6 @@ gebr_init(gboolean has_config)
 	gebr.tmpfiles = NULL;
 
 	gebr.help_edit_windows = g_hash_table_new_full(NULL, NULL, (GDestroyNotify)gebr_geoxml_document_unref, g_object_unref);
-	gebr.xmls_by_filename = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
 
 	gebr.validator = gebr_validator_new((GebrGeoXmlDocument**)&gebr.flow,
 	                                    (GebrGeoXmlDocument**)&gebr.line,
@@ -168,7 +169,7 @@ gboolean gebr_quit(gboolean save_config)
 	}
 
 	g_hash_table_destroy(gebr.help_edit_windows);
-	g_hash_table_destroy(gebr.xmls_by_filename);
+	project_list_populate_cancel();
 
 	if (gebr.validator) {
 		gebr_validator_free(gebr.validator);
@@ -181,6 +182,7 @@ gboolean gebr_quit(gboolean save_config)
 	gtk_tree_view_set_model(GTK_TREE_VIEW(gebr.ui_flow_browse->view), NULL);
 	flow_free();
 	project_line_free();
+	document_cache_clear();
 
 	if (gebr.ui_flow_browse->graph_process)
 		gebr_comm_process_kill(gebr.ui_flow_browse->graph_process);
@@ -205,6 +207,9 @@ gboolean gebr_quit(gboolean save_config)
 	/* Free maestro structure */
 	gebr_maestro_settings_free(gebr.config.maestro_set);
 
+	/* Close the ssh sessions to the maestros */
+	gebr_comm_transport_pool_free_default();
+
 	/* remove temporaries files */
 	g_slist_foreach(gebr.tmpfiles, (GFunc) g_unlink, NULL);
 	g_slist_foreach(gebr.tmpfiles, (GFunc) g_free, NULL);
@@ -377,6 +382,8 @@ restore_project_line_flow_selection(void)
 	GtkTreeIter iter;
 	gboolean project_line_selected;
 
+	project_list_populate_finish();
+
 	if (gebr_g_key_file_has_key(gebr.config.key_file, "general", "notebook")) {
 		GString *project_line_string = gebr_g_key_file_load_string_key(gebr.config.key_file, "general", "project_line_string", "");
 		project_line_selected = (project_line_string->len &&
@@ -391,6 +398,7 @@ restore_project_line_flow_selection(void)
 
 	if (project_line_selected) {
 		project_line_select_iter(&iter);
+		line_load_flows_finish();
 		GtkTreeIter flow_iter;
 
 		if (gebr.config.flow_treepath_string->len &&
@@ -631,16 +639,14 @@ void gebr_remove_help_edit_window(GebrGeoXmlDocument * document)
 		GebrGeoXmlProject *project = GEBR_GEOXML_PROJECT(document);
 		GebrGeoXmlSequence * i;
 		for (gebr_geoxml_project_get_line(project, &i, 0); i != NULL; gebr_geoxml_sequence_next(&i))
-			gebr_remove_help_edit_window(g_hash_table_lookup(gebr.xmls_by_filename, 
-									 gebr_geoxml_project_get_line_source(GEBR_GEOXML_PROJECT_LINE(i))));
+			gebr_remove_help_edit_window(document_cache_lookup(gebr_geoxml_project_get_line_source(GEBR_GEOXML_PROJECT_LINE(i))));
 		remove_window(document);
 		break;
 	} case GEBR_GEOXML_DOCUMENT_TYPE_LINE: {
 		GebrGeoXmlLine *line = GEBR_GEOXML_LINE(document);
 		GebrGeoXmlSequence * i;
 		for (gebr_geoxml_line_get_flow(line, &i, 0); i != NULL; gebr_geoxml_sequence_next(&i))
-			remove_window(g_hash_table_lookup(gebr.xmls_by_filename, 
-							  gebr_geoxml_line_get_flow_source(GEBR_GEOXML_LINE_FLOW(i))));
+			remove_window(document_cache_lookup(gebr_geoxml_line_get_flow_source(GEBR_GEOXML_LINE_FLOW(i))));
 		remove_window(document);
 		break;
 	} case GEBR_GEOXML_DOCUMENT_TYPE_FLOW:
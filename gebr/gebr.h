@@ -80,7 +80,6 @@ struct gebr {
 	GtkWidget *invisible;			
 
 	GHashTable * help_edit_windows;
-	GHashTable * xmls_by_filename;
 
 	GebrValidator *validator;
 
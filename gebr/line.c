@@ -804,38 +804,74 @@ GtkTreeIter line_append_flow_iter(GebrGeoXmlFlow * flow, GebrGeoXmlLineFlow * li
 	return iter;
 }
 
+static DocumentLoader *flows_loader = NULL;
+static gboolean flows_load_error;
+
+static void on_flow_loaded(DocumentLoader *loader,
+			   GebrGeoXmlDocument *flow,
+			   GtkTreeIter *parent,
+			   gpointer line_flow,
+			   gpointer user_data)
+{
+	if (!flow) {
+		flows_load_error = TRUE;
+		return;
+	}
+
+	line_append_flow_iter(GEBR_GEOXML_FLOW(flow), GEBR_GEOXML_LINE_FLOW(line_flow));
+}
+
+static void on_flows_loaded(DocumentLoader *loader,
+			    gpointer user_data)
+{
+	GtkTreeIter iter;
+
+	flows_loader = NULL;
+
+	flow_browse_revalidate_flows(gebr.ui_flow_browse,
+	                             FALSE);
+
+	if (!flows_load_error)
+		gebr_message(GEBR_LOG_INFO, TRUE, FALSE, _("Flows loaded."));
+
+	if (gtk_tree_model_get_iter_first(GTK_TREE_MODEL(gebr.ui_flow_browse->store), &iter) == TRUE)
+		flow_browse_select_iter(&iter);
+}
+
 void line_load_flows(void)
 {
 	GebrGeoXmlSequence *line_flow;
 	GtkTreeIter iter;
-	gboolean error = FALSE;
 
 	flow_free();
 	project_line_get_selected(&iter, DontWarnUnselection);
 
+	flows_load_error = FALSE;
+	flows_loader = document_loader_new(on_flow_loaded, on_flows_loaded, NULL,
+					   gebr_geoxml_object_unref, TRUE);
+
 	/* iterate over its flows */
 	gebr_geoxml_line_get_flow(gebr.line, &line_flow, 0);
 	for (; line_flow; gebr_geoxml_sequence_next(&line_flow)) {
-		GebrGeoXmlFlow *flow;
-
 		const gchar *filename = gebr_geoxml_line_get_flow_source(GEBR_GEOXML_LINE_FLOW(line_flow));
-		int ret = document_load_with_parent((GebrGeoXmlDocument**)(&flow), filename, &iter, TRUE);
-		if (ret) {
-			error = TRUE;
-			continue;
-		}
 
-		line_append_flow_iter(flow, GEBR_GEOXML_LINE_FLOW(line_flow));
+		gebr_geoxml_object_ref(line_flow);
+		document_loader_push(flows_loader, filename, &iter, line_flow);
 	}
 
-	flow_browse_revalidate_flows(gebr.ui_flow_browse,
-	                             FALSE);
+	document_loader_close(flows_loader);
+}
 
-	if (!error)
-		gebr_message(GEBR_LOG_INFO, TRUE, FALSE, _("Flows loaded."));
+void line_load_flows_finish(void)
+{
+	if (flows_loader)
+		document_loader_flush(flows_loader);
+}
 
-	if (gtk_tree_model_get_iter_first(GTK_TREE_MODEL(gebr.ui_flow_browse->store), &iter) == TRUE)
-		flow_browse_select_iter(&iter);
+void line_load_flows_cancel(void)
+{
+	document_loader_free(flows_loader);
+	flows_loader = NULL;
 }
 
 void line_move_flow_top(void)
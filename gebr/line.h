@@ -91,9 +91,21 @@ GtkTreeIter line_append_flow_iter(GebrGeoXmlFlow * flow, GebrGeoXmlLineFlow * li
 /** 
  * Load flows associated to the selected line.
  * Called only by project_line_load.
+ * The flows are loaded in threads and appended to the flow browse as they
+ * are loaded, after this function returns.
  */
 void line_load_flows(void);
 
+/**
+ * Wait for the flows being loaded by #line_load_flows.
+ */
+void line_load_flows_finish(void);
+
+/**
+ * Stop loading the flows of #line_load_flows. Called by #flow_free.
+ */
+void line_load_flows_cancel(void);
+
 /** 
  * Move flow top
  */
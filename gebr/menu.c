@@ -61,10 +61,6 @@ static const gchar * directory_list_demos[] = {
  * Prototypes
  */
 
-static void menu_scan_directory(const gchar * directory, GKeyFile * menu_key_file, GKeyFile * category_key_file);
-
-static gboolean menu_compare_times(const gchar * directory, time_t index_time, gboolean recursive);
-
 void __menu_list_populate(const gchar *path, const gchar *index_menu, const gchar *index_category, GHashTable *categories_hash);
 /*
  * Public functions
@@ -132,54 +128,6 @@ menu_path_has_index(const gchar *path,
 	return FALSE;
 }
 
-static gboolean
-menu_path_internal_index_is_valid(const gchar *path,
-				  const gchar *local_folder,
-				  gchar **index_menu,
-				  gchar **index_category)
-{
-	gboolean need = FALSE;
-	GString *filename_menu = g_string_new(path);
-	gchar *local_filename_menu;
-	gchar *local_filename_cat;
-
-	gebr_g_string_replace(filename_menu, "/", "_");
-	if (filename_menu->str[filename_menu->len] != '_')
-		g_string_append_c(filename_menu, '_');
-
-	GString *filename_cat = g_string_new(filename_menu->str);
-
-	filename_menu = g_string_append(filename_menu, "menus.idx2");
-	filename_cat = g_string_append(filename_cat, "categories.idx2");
-
-	local_filename_menu = g_build_filename(local_folder, filename_menu->str, NULL);
-	local_filename_cat = g_build_filename(local_folder, filename_cat->str, NULL);
-
-	struct stat menu_info, categ_info;
-
-	g_stat(local_filename_menu, &menu_info);
-	g_stat(local_filename_cat, &categ_info);
-
-	gboolean file_exists = g_file_test(local_filename_menu, G_FILE_TEST_EXISTS) &&
-		g_file_test(local_filename_cat, G_FILE_TEST_EXISTS);
-	gboolean need_update = menu_compare_times(path, menu_info.st_mtime, TRUE) || menu_compare_times(path, categ_info.st_mtime, TRUE);
-
-	if (!file_exists || (file_exists && need_update))
-			need = TRUE;
-
-	g_string_free(filename_menu, TRUE);
-	g_string_free(filename_cat, TRUE);
-
-	if (!need) {
-		if (index_menu)
-			*index_menu = local_filename_menu;
-		if (index_category)
-			*index_category = local_filename_cat;
-	}
-
-	return need;
-}
-
 typedef struct {
 	gchar *path;
 	gchar *index_menu;
@@ -201,8 +149,6 @@ menu_list_populate(void)
 	gchar *index_menu = NULL;
 	gchar *index_category = NULL;
 	gchar *filename;
-	gchar *gebr_home = g_build_filename(g_get_home_dir(), ".gebr", "gebr", NULL);
-
 	GList *insert_menus = NULL;
 
 	static gboolean first_time = TRUE;
@@ -218,15 +164,16 @@ menu_list_populate(void)
 		gebr_directory_foreach_file(filename, directory) {
 			gchar *path = g_build_filename(directory, filename, NULL);
 			if (g_file_test(path, G_FILE_TEST_IS_DIR)) {
-				if (!menu_path_has_index(path, &index_menu, &index_category)) {
-					if (menu_path_internal_index_is_valid(path, gebr_home, &index_menu, &index_category)) {
-						need_update = TRUE;
-						if (!menu_list_create_index(path, &index_menu, &index_category, FALSE)) {
-							g_warning("Could not create index for %s", path);
-							continue;
-						}
-					}
+				gboolean changed = FALSE;
+
+				if (!menu_path_has_index(path, &index_menu, &index_category)
+				    && !menu_list_create_index(path, &index_menu, &index_category, FALSE, &changed)) {
+					g_warning("Could not create index for %s", path);
+					g_free(path);
+					continue;
 				}
+				if (changed)
+					need_update = TRUE;
 				if (need_update || first_time) {
 					if (!clear_model) {
 						gebr_menu_view_clear_model(gebr.menu_view);
@@ -242,6 +189,7 @@ menu_list_populate(void)
 
 				g_free(index_menu);
 				g_free(index_category);
+				index_menu = index_category = NULL;
 			}
 			g_free(path);
 		}
@@ -253,10 +201,7 @@ menu_list_populate(void)
 	GString *path = g_string_new(NULL);
 	g_string_printf(path, "%s/.gebr/gebr/menus", g_get_home_dir());
 
-	if (menu_path_internal_index_is_valid(path->str, gebr_home, &index_menu, &index_category)) {
-		need_update = TRUE;
-		menu_list_create_index(path->str, &index_menu, &index_category, FALSE);
-	}
+	menu_list_create_index(path->str, &index_menu, &index_category, FALSE, &need_update);
 	if (need_update || first_time) {
 		if (!clear_model) {
 			gebr_menu_view_clear_model(gebr.menu_view);
@@ -271,15 +216,13 @@ menu_list_populate(void)
 
 	g_free(index_menu);
 	g_free(index_category);
+	index_menu = index_category = NULL;
 	g_string_free(path, TRUE);
 
 	/* Scan user's folder and create index */
 
 	need_update = FALSE;
-	if (menu_path_internal_index_is_valid(gebr.config.usermenus->str, gebr_home, &index_menu, &index_category)) {
-		need_update = TRUE;
-		menu_list_create_index(gebr.config.usermenus->str, &index_menu, &index_category, FALSE);
-	}
+	menu_list_create_index(gebr.config.usermenus->str, &index_menu, &index_category, FALSE, &need_update);
 	if (need_update || first_time || gebr.update_usermenus) {
 		if (!clear_model) {
 			gebr_menu_view_clear_model(gebr.menu_view);
@@ -306,7 +249,6 @@ menu_list_populate(void)
 	g_free(index_menu);
 	g_free(index_category);
 
-	g_free(gebr_home);
 	g_hash_table_unref(categories_hash);
 }
 
@@ -334,22 +276,26 @@ void __menu_list_populate(const gchar *path,
 	for (int i = 0; category_list[i]; i++) {
 		gchar ** menus_list;
 		gsize menus_list_length;
+		gchar *category = gebr_geoxml_menu_index_unescape_group(category_list[i]);
 		menus_list = g_key_file_get_string_list(category_key_file, category_list[i], "menus", &menus_list_length, NULL);
-		iter = gebr_menu_view_find_or_add_category(category_list[i], categories_hash, gebr.menu_view);
+		iter = gebr_menu_view_find_or_add_category(category, categories_hash, gebr.menu_view);
+		g_free(category);
 		for (int j = 0; menus_list[j]; j++) {
 			gchar *title;
 			gchar *desc;
 			gchar *file;
+			gchar *group = gebr_geoxml_menu_index_escape_group(menus_list[j]);
 			if (*menus_list[j] == '.') {
 				file = g_strconcat(path, (menus_list[j] + 1), NULL);
 			} else {
 				file = g_strdup(menus_list[j]);
 			}
-			title = g_key_file_get_string(menu_key_file, menus_list[j], "title", NULL);
-			desc = g_key_file_get_string(menu_key_file, menus_list[j], "description", NULL);
+			title = g_key_file_get_string(menu_key_file, group, "title", NULL);
+			desc = g_key_file_get_string(menu_key_file, group, "description", NULL);
 
 			gebr_menu_view_add_menu(&iter, title, desc, file, gebr.menu_view);
 
+			g_free(group);
 			g_free(title);
 			g_free(desc);
 			g_free(file);
@@ -362,87 +308,79 @@ out:	g_key_file_free(menu_key_file);
 	g_key_file_free(category_key_file);
 }
 
+static gboolean
+menu_index_save(const gchar *filename,
+		GKeyFile *key_file)
+{
+	gsize length;
+	gchar *data = g_key_file_to_data(key_file, &length, NULL);
+	gboolean ret = g_file_set_contents(filename, data, length, NULL);
+
+	if (!ret)
+		gebr_message(GEBR_LOG_ERROR, TRUE, FALSE, _("Unable to write Menus' index."));
+
+	g_free(data);
+	return ret;
+}
+
 gboolean menu_list_create_index(const gchar *path,
                                 gchar **index_menu,
                                 gchar **index_category,
-                                gboolean use_default)
+                                gboolean use_default,
+                                gboolean *changed)
 {
 	GKeyFile *menu_key_file;
 	GKeyFile *category_key_file;
-	FILE *menu_fp;
-	FILE *category_fp;
-	gchar *key_file_data;
-	gboolean ret;
-	gsize key_file_length;
-
-	ret = TRUE;
-
+	GKeyFile *previous = NULL;
+	gboolean need_update;
+	gboolean ret = TRUE;
 	gchar *imenu, *icat;
 
 	if (use_default) {
 		imenu = g_build_filename(path, "menus.idx2", NULL);
-		if (index_menu)
-			*index_menu = g_strdup(imenu);
-
 		icat = g_build_filename(path, "categories.idx2", NULL);
-		if (index_category)
-			*index_category = g_strdup(icat);
 	} else {
-		GString *menu_name = g_string_new(path);
-		gebr_g_string_replace(menu_name, "/", "_");
-		gchar *mname = g_strdup_printf("%s_menus.idx2", menu_name->str);
+		GString *name = g_string_new(path);
+		gebr_g_string_replace(name, "/", "_");
+		gchar *mname = g_strdup_printf("%s_menus.idx2", name->str);
+		gchar *cname = g_strdup_printf("%s_categories.idx2", name->str);
 		imenu = g_build_filename(g_get_home_dir(), ".gebr", "gebr", mname, NULL);
-		if (index_menu)
-			*index_menu = g_strdup(imenu);
-		g_free(mname);
-		g_string_free(menu_name, FALSE);
-
-		GString *cat_name = g_string_new(path);
-		gebr_g_string_replace(cat_name, "/", "_");
-		gchar *cname = g_strdup_printf("%s_categories.idx2", cat_name->str);
 		icat = g_build_filename(g_get_home_dir(), ".gebr", "gebr", cname, NULL);
-		if (index_category)
-			*index_category = g_strdup(icat);
+		g_free(mname);
 		g_free(cname);
-		g_string_free(cat_name, FALSE);
+		g_string_free(name, TRUE);
+	}
+
+	/* Menus whose files did not change since the last index are not read again */
+	if (g_file_test(icat, G_FILE_TEST_EXISTS)) {
+		previous = g_key_file_new();
+		if (!g_key_file_load_from_file(previous, imenu, G_KEY_FILE_NONE, NULL)) {
+			g_key_file_free(previous);
+			previous = NULL;
+		}
 	}
 
 	menu_key_file = g_key_file_new();
 	category_key_file = g_key_file_new();
 
-	menu_scan_directory(path, menu_key_file, category_key_file);
+	need_update = gebr_geoxml_menu_index_update(path, previous, menu_key_file, category_key_file);
+	if (need_update)
+		ret = menu_index_save(imenu, menu_key_file) && menu_index_save(icat, category_key_file);
 
-	/* Create menu index for @path */
-	if ((menu_fp = fopen(imenu, "w")) == NULL) {
-		gebr_message(GEBR_LOG_ERROR, TRUE, FALSE, _("Unable to write Menus' index."));
-		ret = FALSE;
-		goto out;
-	}
-	g_free(imenu);
+	if (changed)
+		*changed = need_update;
 
-	key_file_data = g_key_file_to_data(menu_key_file, &key_file_length, NULL);
-	fwrite(key_file_data, sizeof(gchar), key_file_length, menu_fp);
-	g_free(key_file_data);
+	if (ret && index_menu)
+		*index_menu = g_strdup(imenu);
+	if (ret && index_category)
+		*index_category = g_strdup(icat);
 
-	fclose(menu_fp);
-	
-	/* Create category index for @path */
-	if ((category_fp = fopen(icat, "w")) == NULL) {
-		gebr_message(GEBR_LOG_ERROR, TRUE, FALSE, _("Unable to write Menus' index."));
-		ret = FALSE;
-		goto out;
-	}
+	if (previous)
+		g_key_file_free(previous);
+	g_key_file_free(menu_key_file);
+	g_key_file_free(category_key_file);
+	g_free(imenu);
 	g_free(icat);
-	
-	key_file_data = g_key_file_to_data(category_key_file, &key_file_length, NULL);
-	fwrite(key_file_data, sizeof(gchar), key_file_length, category_fp);
-	g_free(key_file_data);
-
-	fclose(category_fp);
-
- out:
-	 g_key_file_free(menu_key_file);
-	 g_key_file_free(category_key_file);
 
 	return ret;
 }
@@ -456,117 +394,6 @@ const gchar ** menu_get_global_directories(void)
  * Private functions
  */
 
-/**
- * \internal
- * Compares the modification time of all menu files in \p directory with \p index_time and determines if the directory
- * was changed.
- * \return TRUE if refresh is needed, ie, \p directory time is greater than \p index_time.
- */
-static gboolean menu_compare_times(const gchar * directory, time_t index_time, gboolean recursive)
-{
-	gchar *filename;
-	GString *path;
-	gboolean refresh_needed;
-	struct stat info;
-
-	stat(directory, &info);
-	if (index_time < info.st_mtime)
-		return TRUE;
-
-	refresh_needed = FALSE;
-	path = g_string_new(NULL);
-	gebr_directory_foreach_file(filename, directory) {
-		g_string_printf(path, "%s/%s", directory, filename);
-		if (recursive && g_file_test(path->str, G_FILE_TEST_IS_DIR)) {
-			if (menu_compare_times(path->str, index_time, TRUE)) {
-				refresh_needed = TRUE;
-				goto out;
-			}
-		}
-		if (fnmatch("*.mnu", filename, 1))
-			continue;
-
-		stat(path->str, &info);
-		if (index_time < info.st_mtime) {
-			refresh_needed = TRUE;
-			goto out;
-		}
-	}
-
- out:	g_string_free(path, TRUE);
-	return refresh_needed;
-}
-
-/**
- * \internal
- * Scans \p directory for menus files.
- */
-static void menu_scan_directory(const gchar * directory, GKeyFile * menu_key_file, GKeyFile * category_key_file)
-{
-	gchar *filename;
-	gchar **category_list;
-	glong categories_number;
-	GString *path;
-
-	path = g_string_new(NULL);
-	gebr_directory_foreach_file(filename, directory) {
-		int i;
-		GebrGeoXmlDocument *menu;
-		GebrGeoXmlSequence *category;
-
-		g_string_printf(path, "%s/%s", directory, filename);
-		if (g_file_test(path->str, G_FILE_TEST_IS_DIR)) {
-			menu_scan_directory(path->str, menu_key_file, category_key_file);
-			continue;
-		}
-		if (fnmatch("*.mnu", filename, 1))
-			continue;
-
-		if (document_load_path((GebrGeoXmlDocument**)(&menu), path->str))
-			continue;
-
-		gebr_geoxml_flow_get_category(GEBR_GEOXML_FLOW(menu), &category, 0);
-
-		categories_number = gebr_geoxml_flow_get_categories_number(GEBR_GEOXML_FLOW(menu));
-		category_list = g_new(gchar *, categories_number+1);
-
-		for (i = 0; category != NULL; gebr_geoxml_sequence_next(&category), i++) {
-			gchar **menus_list;
-			gsize menus_list_length;
-			category_list[i] = g_strdup(gebr_geoxml_value_sequence_get(GEBR_GEOXML_VALUE_SEQUENCE(category)));
-			menus_list = g_key_file_get_string_list(category_key_file, category_list[i], "menus", &menus_list_length, NULL);
-
-			if (menus_list) {
-				gchar **menus_cpy = g_new(gchar*, menus_list_length+2);
-				for (int j = 0; j < menus_list_length; j++)
-					menus_cpy[j] = g_strdup(menus_list[j]);
-				menus_cpy[menus_list_length] = g_strdup(path->str);
-				menus_cpy[menus_list_length+1] = NULL;
-				g_strfreev(menus_list);
-				menus_list = menus_cpy;
-				menus_list_length++;
-			} else {
-				menus_list = g_new(gchar *, 2);
-				menus_list[0] = g_strdup(path->str);
-				menus_list[1] = NULL;
-				menus_list_length = 1;
-			}
-			g_key_file_set_string_list(category_key_file, category_list[i], "menus", (const gchar * const *)menus_list, menus_list_length);
-			g_strfreev(menus_list);
-		}
-		category_list[i] = NULL;
-
-		g_key_file_set_string_list(menu_key_file, path->str, "category", (const gchar * const *)category_list, categories_number);
-		g_key_file_set_string(menu_key_file, path->str, "title", gebr_geoxml_document_get_title(menu));
-		g_key_file_set_string(menu_key_file, path->str, "description", gebr_geoxml_document_get_description(menu));
-
-		g_strfreev(category_list);
-		document_free(menu);
-	}
-
-	g_string_free(path, TRUE);
-}
-
 static gchar *canonize_name(const gchar *path)
 {
 	GFile *file = g_file_new_for_path(path);
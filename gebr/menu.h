@@ -55,14 +55,17 @@ gboolean menu_refresh_needed(void);
 void menu_list_populate(void);
 
 /**
- * Creates the indexes files for folders listed in \ref directory_list.
+ * Updates the indexes files for the menus in \p path. Only the menus changed
+ * since the last index are read again. \p changed is set to TRUE if the
+ * indexes were rewritten.
  *
- * \return TRUE if successfully scanned all directories.
+ * \return TRUE if the indexes are up to date.
  */
 gboolean menu_list_create_index(const gchar *path,
                                 gchar **index_menu,
                                 gchar **index_category,
-                                gboolean use_default);
+                                gboolean use_default,
+                                gboolean *changed);
 
 /*
  *
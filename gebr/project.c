@@ -133,6 +133,39 @@ GtkTreeIter project_append_line_iter(GtkTreeIter * project_iter, GebrGeoXmlLine
 	return iter;
 }
 
+/*
+ * Sets the maestro of @line to the current one, if it has none, and makes
+ * sure it has a HOME path.
+ */
+static void project_line_setup_maestro(GebrGeoXmlLine *line)
+{
+	gchar *line_maestro = gebr_geoxml_line_get_maestro(line);
+	if (g_strcmp0(line_maestro, "") == 0) {
+		GebrMaestroServer *maestro = gebr_maestro_controller_get_maestro(gebr.maestro_controller);
+		if (maestro) {
+			const gchar *actual_maestro_nfsid = gebr_maestro_server_get_nfsid(maestro);
+			gebr_geoxml_line_set_maestro(line, actual_maestro_nfsid);
+
+			const gchar *maestro_home = gebr_maestro_server_get_home_dir(maestro);
+			gebr_geoxml_line_append_path(line, "HOME", maestro_home);
+		}
+		document_save(GEBR_GEOXML_DOC(line), TRUE,FALSE);
+	} else {
+		gchar *line_home = gebr_geoxml_line_get_path_by_name(line, "HOME");
+		if (!line_home) {
+			GebrMaestroServer *maestro = gebr_maestro_controller_get_maestro_for_address(gebr.maestro_controller,
+			                                                                             line_maestro);
+			if (maestro) {
+				const gchar *maestro_home = gebr_maestro_server_get_home_dir(maestro);
+				gebr_geoxml_line_append_path(line, "HOME", maestro_home);
+			}
+		} else {
+			g_free(line_home);
+		}
+	}
+	g_free(line_maestro);
+}
+
 GtkTreeIter project_load_with_lines(GebrGeoXmlProject *project)
 {
 	GtkTreeIter project_iter;
@@ -150,34 +183,11 @@ GtkTreeIter project_load_with_lines(GebrGeoXmlProject *project)
 
 		line_source = gebr_geoxml_project_get_line_source(GEBR_GEOXML_PROJECT_LINE(project_line));
 		int ret = document_load_with_parent((GebrGeoXmlDocument**)(&line), line_source, &project_iter, FALSE);
-		gchar *line_maestro = gebr_geoxml_line_get_maestro(line);
-		if (g_strcmp0(line_maestro, "") == 0) {
-			GebrMaestroServer *maestro = gebr_maestro_controller_get_maestro(gebr.maestro_controller);
-			if (maestro) {
-				const gchar *actual_maestro_nfsid = gebr_maestro_server_get_nfsid(maestro);
-				gebr_geoxml_line_set_maestro(line, actual_maestro_nfsid);
-
-				const gchar *maestro_home = gebr_maestro_server_get_home_dir(maestro);
-				gebr_geoxml_line_append_path(line, "HOME", maestro_home);
-			}
-			document_save(GEBR_GEOXML_DOC(line), TRUE,FALSE);
-		} else {
-			gchar *line_home = gebr_geoxml_line_get_path_by_name(line, "HOME");
-			if (!line_home) {
-				GebrMaestroServer *maestro = gebr_maestro_controller_get_maestro_for_address(gebr.maestro_controller,
-				                                                                             line_maestro);
-				if (maestro) {
-					const gchar *maestro_home = gebr_maestro_server_get_home_dir(maestro);
-					gebr_geoxml_line_append_path(line, "HOME", maestro_home);
-				}
-			} else {
-				g_free(line_home);
-			}
-		}
 		if (ret) {
 			project_line = next;
 			continue;
 		}
+		project_line_setup_maestro(line);
 		project_append_line_iter(&project_iter, line);
 
 		project_line = next;
@@ -186,13 +196,47 @@ GtkTreeIter project_load_with_lines(GebrGeoXmlProject *project)
 	return project_iter;
 }
 
+static DocumentLoader *project_list_loader = NULL;
+
+static void on_project_list_document_loaded(DocumentLoader *loader,
+					    GebrGeoXmlDocument *document,
+					    GtkTreeIter *parent,
+					    gpointer data,
+					    gpointer user_data)
+{
+	if (!document)
+		return;
+
+	if (gebr_geoxml_document_get_type(document) == GEBR_GEOXML_DOCUMENT_TYPE_LINE) {
+		project_line_setup_maestro(GEBR_GEOXML_LINE(document));
+		project_append_line_iter(parent, GEBR_GEOXML_LINE(document));
+		return;
+	}
+
+	/* The lines follow all projects, as they are pushed after them */
+	GtkTreeIter project_iter = project_append_iter(GEBR_GEOXML_PROJECT(document));
+	GebrGeoXmlSequence *project_line;
+
+	gebr_geoxml_project_get_line(GEBR_GEOXML_PROJECT(document), &project_line, 0);
+	for (; project_line; gebr_geoxml_sequence_next(&project_line))
+		document_loader_push(loader,
+				     gebr_geoxml_project_get_line_source(GEBR_GEOXML_PROJECT_LINE(project_line)),
+				     &project_iter, NULL);
+}
+
+static void on_project_list_loaded(DocumentLoader *loader,
+				   gpointer user_data)
+{
+	project_list_loader = NULL;
+	project_line_info_update();
+}
+
 void project_list_populate(void)
 {
 	gchar *filename;
 	gsize length;
 	gchar **key_array;
 	GError *error = NULL;
-	GebrGeoXmlProject *project;
 
 	/* free previous selection path */
 	gtk_tree_store_clear(gebr.ui_project_line->store);
@@ -200,6 +244,12 @@ void project_list_populate(void)
 
 	project_line_free();
 
+	/* Documents are parsed in threads and rows are appended as they arrive */
+	project_list_populate_cancel();
+	project_list_loader = document_loader_new(on_project_list_document_loaded,
+						  on_project_list_loaded,
+						  NULL, NULL, FALSE);
+
 	key_array = g_key_file_get_keys(gebr.config.key_file, "projects", &length, &error);
 
 	if (!key_array) {
@@ -211,13 +261,7 @@ void project_list_populate(void)
 			continue;
 
 		filename = g_key_file_get_string (gebr.config.key_file, "projects", key_array[i], &error);
-
-		if (document_load((GebrGeoXmlDocument**)(&project), filename, FALSE)){
-			g_free(filename);
-			continue;
-		}
-
-		project_load_with_lines(project);
+		document_loader_push(project_list_loader, filename, NULL, NULL);
 		g_free(filename);
 	}
 
@@ -238,16 +282,26 @@ void project_list_populate(void)
 			g_free(filename_loaded);
 		}
 
-		if (already_loaded || document_load((GebrGeoXmlDocument**)(&project), filename, FALSE))
-			continue;
-
-		project_load_with_lines(project);
+		if (!already_loaded)
+			document_loader_push(project_list_loader, filename, NULL, NULL);
 	}
 
-	project_line_info_update();
+	document_loader_close(project_list_loader);
 	g_strfreev(key_array);
 }
 
+void project_list_populate_finish(void)
+{
+	if (project_list_loader)
+		document_loader_flush(project_list_loader);
+}
+
+void project_list_populate_cancel(void)
+{
+	document_loader_free(project_list_loader);
+	project_list_loader = NULL;
+}
+
 void project_line_move(const gchar * src_project, const gchar * src_line,
 		       const gchar * dst_project, const gchar * dst_line, gboolean before)
 {
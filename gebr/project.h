@@ -52,9 +52,21 @@ GtkTreeIter project_load_with_lines(GebrGeoXmlProject *project);
 
 /**
  * Reload the projets from the data directory.
+ * The documents are loaded in threads and the rows are appended as they are
+ * loaded, after this function returns.
  */
 void project_list_populate(void);
 
+/**
+ * Wait for the rows being loaded by #project_list_populate.
+ */
+void project_list_populate_finish(void);
+
+/**
+ * Stop loading the rows of #project_list_populate.
+ */
+void project_list_populate_cancel(void);
+
 /**
  * Moves \p src_line to \p dest_project before or after \p position, depending on \p before flag.
  */
@@ -0,0 +1,179 @@
+/*
+ * test-document-cache.c
+ * This file is part of GêBR Project
+ *
+ * Copyright (C) 2012 - GêBR Core Team (www.gebrproject.com)
+ *
+ * GêBR Project is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * GêBR Project is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GêBR Project. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../gebr-document-cache.h"
+
+#define N_DOCUMENTS 3
+
+static gchar *dir;
+static gchar *paths[N_DOCUMENTS];
+static GebrGeoXmlDocument *documents[N_DOCUMENTS];
+static goffset sizes[N_DOCUMENTS];
+
+static void
+setup(void)
+{
+	for (gint i = 0; i < N_DOCUMENTS; i++) {
+		gchar *name = g_strdup_printf("flow%d.flw", i);
+		struct stat st;
+
+		documents[i] = GEBR_GEOXML_DOCUMENT(gebr_geoxml_flow_new());
+		paths[i] = g_build_filename(dir, name, NULL);
+		g_assert_cmpint(gebr_geoxml_document_save(documents[i], paths[i], FALSE), ==, 0);
+		g_assert_cmpint(g_stat(paths[i], &st), ==, 0);
+		sizes[i] = st.st_size;
+		g_free(name);
+	}
+}
+
+static void
+teardown(void)
+{
+	for (gint i = 0; i < N_DOCUMENTS; i++) {
+		gebr_geoxml_document_unref(documents[i]);
+		g_unlink(paths[i]);
+		g_free(paths[i]);
+	}
+}
+
+/* A budget for the first @n documents */
+static goffset
+budget_for(gint n)
+{
+	goffset budget = 0;
+
+	for (gint i = 0; i < n; i++)
+		budget += sizes[i];
+	return budget;
+}
+
+static void
+test_document_cache_check(void)
+{
+	GebrDocumentCache *cache;
+
+	setup();
+	cache = gebr_document_cache_new(budget_for(N_DOCUMENTS));
+
+	g_assert(gebr_document_cache_check(cache, paths[0]) == NULL);
+	gebr_document_cache_add(cache, paths[0], documents[0]);
+	g_assert(gebr_document_cache_check(cache, paths[0]) == documents[0]);
+
+	/* A file changed since it was cached */
+	gebr_geoxml_document_set_title(documents[1], "A longer title than before");
+	g_assert_cmpint(gebr_geoxml_document_save(documents[1], paths[0], FALSE), ==, 0);
+	g_assert(gebr_document_cache_check(cache, paths[0]) == NULL);
+	g_assert(gebr_document_cache_peek(cache, paths[0]) == NULL);
+
+	gebr_document_cache_free(cache);
+	teardown();
+}
+
+static void
+test_document_cache_evict(void)
+{
+	GebrDocumentCache *cache;
+
+	setup();
+	cache = gebr_document_cache_new(budget_for(2));
+
+	gebr_document_cache_add(cache, paths[0], documents[0]);
+	gebr_document_cache_add(cache, paths[1], documents[1]);
+
+	/* The first one is the least recently used after this */
+	g_assert(gebr_document_cache_check(cache, paths[1]) == documents[1]);
+	gebr_document_cache_add(cache, paths[2], documents[2]);
+
+	g_assert(gebr_document_cache_peek(cache, paths[0]) == NULL);
+	g_assert(gebr_document_cache_peek(cache, paths[1]) == documents[1]);
+	g_assert(gebr_document_cache_peek(cache, paths[2]) == documents[2]);
+
+	gebr_document_cache_free(cache);
+	teardown();
+}
+
+static void
+test_document_cache_hold(void)
+{
+	GebrDocumentCache *cache;
+
+	setup();
+	cache = gebr_document_cache_new(budget_for(1));
+
+	/* Open documents are kept over the budget */
+	gebr_document_cache_add(cache, paths[0], documents[0]);
+	gebr_document_cache_hold(cache, documents[0]);
+	gebr_document_cache_hold(cache, documents[0]);
+	gebr_document_cache_add(cache, paths[1], documents[1]);
+	gebr_document_cache_add(cache, paths[2], documents[2]);
+	g_assert(gebr_document_cache_peek(cache, paths[0]) == documents[0]);
+	g_assert(gebr_document_cache_peek(cache, paths[1]) == NULL);
+	g_assert(gebr_document_cache_peek(cache, paths[2]) == documents[2]);
+
+	/* Until released as many times as held */
+	gebr_document_cache_release(cache, documents[0]);
+	g_assert(gebr_document_cache_peek(cache, paths[0]) == documents[0]);
+	gebr_document_cache_release(cache, documents[0]);
+	g_assert(gebr_document_cache_peek(cache, paths[0]) == NULL);
+	g_assert(gebr_document_cache_peek(cache, paths[2]) == documents[2]);
+
+	/* Removing a document drops its holds */
+	gebr_document_cache_hold(cache, documents[1]);
+	gebr_document_cache_add(cache, paths[1], documents[1]);
+	gebr_document_cache_remove(cache, documents[1]);
+	g_assert(gebr_document_cache_peek(cache, paths[1]) == NULL);
+	gebr_document_cache_release(cache, documents[1]);
+	gebr_document_cache_add(cache, paths[1], documents[1]);
+	g_assert(gebr_document_cache_peek(cache, paths[1]) == documents[1]);
+	g_assert(gebr_document_cache_peek(cache, paths[2]) == NULL);
+
+	gebr_document_cache_free(cache);
+	teardown();
+}
+
+int
+main(int argc, char *argv[])
+{
+	gchar *name = g_strdup_printf("gebr-test-document-cache-%d", (gint) getpid());
+	gint ret;
+
+	g_test_init(&argc, &argv, NULL);
+	gebr_geoxml_init();
+	dir = g_build_filename(g_get_tmp_dir(), name, NULL);
+	g_mkdir_with_parents(dir, 0700);
+
+	g_test_add_func("/gebr/document-cache/check", test_document_cache_check);
+	g_test_add_func("/gebr/document-cache/evict", test_document_cache_evict);
+	g_test_add_func("/gebr/document-cache/hold", test_document_cache_hold);
+
+	ret = g_test_run();
+
+	g_rmdir(dir);
+	g_free(dir);
+	g_free(name);
+	gebr_geoxml_finalize();
+
+	return ret;
+}
@@ -0,0 +1,144 @@
+/*
+ * test-output-store.c
+ * This file is part of GêBR Project
+ *
+ * Copyright (C) 2012 - GêBR Core Team (www.gebrproject.com)
+ *
+ * GêBR Project is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * GêBR Project is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GêBR Project. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <glib.h>
+#include <string.h>
+
+#include "../gebr-output-store.h"
+
+static void
+test_output_store_lines(void)
+{
+	GebrOutputStore *store = gebr_output_store_new();
+	GString *text = g_string_new(NULL);
+
+	g_assert_cmpuint(gebr_output_store_get_n_lines(store), ==, 0);
+
+	gebr_output_store_set_text(store, text);
+	g_string_append(text, "foo\nba");
+	g_assert_cmpuint(gebr_output_store_get_length(store), ==, 0);
+	gebr_output_store_update(store);
+	g_assert_cmpuint(gebr_output_store_get_n_lines(store), ==, 2);
+	g_string_append(text, "r\n");
+	gebr_output_store_update(store);
+	g_assert_cmpuint(gebr_output_store_get_n_lines(store), ==, 2);
+
+	g_assert_cmpuint(gebr_output_store_get_line_offset(store, 0), ==, 0);
+	g_assert_cmpuint(gebr_output_store_get_line_offset(store, 1), ==, 4);
+	g_assert_cmpuint(gebr_output_store_get_line_offset(store, 2), ==, 8);
+	g_assert_cmpuint(gebr_output_store_get_line_offset(store, 9), ==, 8);
+	g_assert_cmpstr(gebr_output_store_peek(store, 4), ==, "bar\n");
+
+	g_assert_cmpuint(gebr_output_store_get_line_at_offset(store, 3), ==, 0);
+	g_assert_cmpuint(gebr_output_store_get_line_at_offset(store, 4), ==, 1);
+
+	/* Indexed again from the start */
+	gebr_output_store_set_text(store, text);
+	gebr_output_store_update(store);
+	g_assert_cmpuint(gebr_output_store_get_n_lines(store), ==, 2);
+
+	gebr_output_store_set_text(store, NULL);
+	g_assert_cmpuint(gebr_output_store_get_length(store), ==, 0);
+	g_assert_cmpuint(gebr_output_store_get_n_lines(store), ==, 0);
+
+	gebr_output_store_free(store);
+	g_string_free(text, TRUE);
+}
+
+static void
+test_output_store_index(void)
+{
+	GebrOutputStore *store = gebr_output_store_new();
+	GString *text = g_string_new(NULL);
+	GString *line = g_string_new(NULL);
+	gsize *offsets = g_new(gsize, 2001);
+
+	gebr_output_store_set_text(store, text);
+
+	/* Lines of different lengths, appended in pieces */
+	for (guint i = 0; i < 2000; i++) {
+		offsets[i] = gebr_output_store_get_length(store);
+		g_string_printf(line, "line %u%*s\n", i, i % 7, "");
+		g_string_append_len(text, line->str, 3);
+		gebr_output_store_update(store);
+		g_string_append_len(text, line->str + 3, line->len - 3);
+		gebr_output_store_update(store);
+	}
+	offsets[2000] = gebr_output_store_get_length(store);
+
+	g_assert_cmpuint(gebr_output_store_get_n_lines(store), ==, 2000);
+	for (guint i = 0; i <= 2000; i++) {
+		g_assert_cmpuint(gebr_output_store_get_line_offset(store, i), ==, offsets[i]);
+		if (i < 2000) {
+			g_assert_cmpuint(gebr_output_store_get_line_at_offset(store, offsets[i]), ==, i);
+			g_assert_cmpuint(gebr_output_store_get_line_at_offset(store, offsets[i + 1] - 1), ==, i);
+		}
+	}
+
+	g_string_free(line, TRUE);
+	g_free(offsets);
+	gebr_output_store_free(store);
+	g_string_free(text, TRUE);
+}
+
+static void
+test_output_store_search(void)
+{
+	GebrOutputStore *store = gebr_output_store_new();
+	GString *output = g_string_new("Error here\nok\nerror there\n");
+	const gchar *text = output->str;
+	gsize match;
+
+	gebr_output_store_set_text(store, output);
+	gebr_output_store_update(store);
+
+	g_assert(gebr_output_store_search(store, "error", 0, TRUE, TRUE, &match));
+	g_assert_cmpuint(match, ==, 14);
+	g_assert(gebr_output_store_search(store, "error", 0, TRUE, FALSE, &match));
+	g_assert_cmpuint(match, ==, 0);
+	g_assert(gebr_output_store_search(store, "ERROR", 1, TRUE, FALSE, &match));
+	g_assert_cmpuint(match, ==, 14);
+	g_assert(!gebr_output_store_search(store, "error", 15, TRUE, TRUE, &match));
+
+	/* Backwards, the match must end before the start */
+	g_assert(gebr_output_store_search(store, "error", strlen(text), FALSE, FALSE, &match));
+	g_assert_cmpuint(match, ==, 14);
+	g_assert(gebr_output_store_search(store, "error", 18, FALSE, FALSE, &match));
+	g_assert_cmpuint(match, ==, 0);
+	g_assert(!gebr_output_store_search(store, "error", 4, FALSE, FALSE, &match));
+
+	g_assert(!gebr_output_store_search(store, "", 0, TRUE, TRUE, &match));
+	g_assert(!gebr_output_store_search(store, "missing", 0, TRUE, TRUE, &match));
+
+	gebr_output_store_free(store);
+	g_string_free(output, TRUE);
+}
+
+int
+main(int argc, char *argv[])
+{
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add_func("/output-store/lines", test_output_store_lines);
+	g_test_add_func("/output-store/index", test_output_store_index);
+	g_test_add_func("/output-store/search", test_output_store_search);
+
+	return g_test_run();
+}
@@ -17,6 +17,7 @@
 
 #include "ui_flow.h"
 
+#include "document.h"
 #include "gebr.h"
 #include "line.h"
 
@@ -39,6 +40,8 @@ static void
 gebr_ui_flow_finalize(GObject *object)
 {
 	GebrUiFlow *ui_flow = GEBR_UI_FLOW(object);
+
+	document_cache_release(GEBR_GEOXML_DOCUMENT(ui_flow->priv->flow));
 	G_OBJECT_CLASS(gebr_ui_flow_parent_class)->finalize(object);
 
 	g_free(ui_flow->priv->filename);
@@ -72,6 +75,7 @@ gebr_ui_flow_new(GebrGeoXmlFlow *flow,
 
 	ui_flow->priv->flow = flow;
 	ui_flow->priv->line_flow = line_flow;
+	document_cache_hold(GEBR_GEOXML_DOCUMENT(flow));
 	ui_flow->priv->filename = g_strdup(gebr_geoxml_document_get_filename(GEBR_GEOXML_DOCUMENT(flow)));
 	ui_flow->priv->selected = FALSE;
 	ui_flow->priv->has_error = FALSE;
@@ -38,6 +38,7 @@ struct _GebrUiFlowExecutionPriv {
 	GtkComboBox *server_combo;
 	GtkComboBox *queue_combo;
 	GtkToggleButton *parallelism_button;
+	GtkToggleButton *static_split_button;
 	GtkToggleButton *save_default_button;
 	GtkWidget *window;
 	GtkLabel *number_cores_label;
@@ -245,6 +246,12 @@ run_flow(GebrUiFlowExecution *ui_flow_execution,
 		niceness =  gebr_interface_get_niceness();
 
 
+	/* Loop steps are handed to the nodes as they finish, unless the user
+	 * asked to split them before the execution */
+	const gchar *scheduling = "dynamic";
+	if (is_detailed && gtk_toggle_button_get_active(ui_flow_execution->priv->static_split_button))
+		scheduling = "static";
+
 	gchar *speed_str = g_strdup_printf("%lf", speed);
 	gchar *nice =  g_strdup_printf("%d", niceness);
 
@@ -376,6 +383,7 @@ run_flow(GebrUiFlowExecution *ui_flow_execution,
 	gebr_comm_uri_add_param(uri, "flow_id", flow_id);
 	gebr_comm_uri_add_param(uri, "speed", speed_str);
 	gebr_comm_uri_add_param(uri, "nice", nice);
+	gebr_comm_uri_add_param(uri, "scheduling", scheduling);
 	gebr_comm_uri_add_param(uri, "name", name);
 
 	if (host)
@@ -1145,6 +1153,7 @@ gebr_ui_flow_execution_details_setup_ui(gboolean slider_sensitiviness,
 	ui_flow_execution->priv->save_default_button = GTK_TOGGLE_BUTTON(gtk_builder_get_object(builder, "save_default_button"));
 	ui_flow_execution->priv->nice_button_high = GTK_WIDGET(gtk_builder_get_object(builder, "high_priority_button")); 
 	ui_flow_execution->priv->parallelism_button = GTK_TOGGLE_BUTTON(gtk_builder_get_object(builder, "simultaneous_button"));
+	ui_flow_execution->priv->static_split_button = GTK_TOGGLE_BUTTON(gtk_builder_get_object(builder, "static_split_button"));
 	ui_flow_execution->priv->number_cores_label = GTK_LABEL(gtk_builder_get_object(builder, "number_cores_label")); 
 
 	gtk_window_set_title(GTK_WINDOW(main_dialog), _("Run"));
@@ -1277,6 +1277,96 @@ parse_line(GebrGeoXmlDocument * _line, GebrGeoXmlDocument *proj, GString *tmpdir
 	document_free(GEBR_GEOXML_DOCUMENT(line));
 }
 
+typedef struct {
+	GebrTar *tar;
+	const gchar *root_dir;
+	GtkWidget *dialog;
+	GtkWidget *progress;
+	volatile gint permille;
+	volatile gint finished;
+	gboolean ret;
+} ExportProgress;
+
+static void
+on_export_progress(GebrTar *tar,
+		   guint64 done,
+		   guint64 total,
+		   ExportProgress *data)
+{
+	g_atomic_int_set(&data->permille, total ? done * 1000 / total : 0);
+}
+
+static gpointer
+export_compact_thread(ExportProgress *data)
+{
+	data->ret = gebr_tar_compact(data->tar, data->root_dir);
+	g_atomic_int_set(&data->finished, 1);
+	return NULL;
+}
+
+static gboolean
+export_update_progress(ExportProgress *data)
+{
+	gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(data->progress),
+				      g_atomic_int_get(&data->permille) / 1000.0);
+
+	if (g_atomic_int_get(&data->finished))
+		gtk_dialog_response(GTK_DIALOG(data->dialog), GTK_RESPONSE_OK);
+
+	return TRUE;
+}
+
+static void
+on_export_level_changed(GtkComboBox *combo,
+			gint *level)
+{
+	static const gint levels[] = { 1, GEBR_TAR_DEFAULT_LEVEL, 9 };
+	gint active = gtk_combo_box_get_active(combo);
+
+	if (active >= 0)
+		*level = levels[active];
+}
+
+/*
+ * Compacts @tar in a thread while a dialog shows the progress, so the export
+ * can be cancelled. Returns %FALSE if it failed or was cancelled.
+ */
+static gboolean
+project_line_export_compact(GebrTar *tar,
+			    const gchar *root_dir)
+{
+	ExportProgress data;
+	GThread *thread;
+	guint timeout;
+
+	data.tar = tar;
+	data.root_dir = root_dir;
+	data.permille = 0;
+	data.finished = 0;
+	data.ret = FALSE;
+
+	data.dialog = gtk_dialog_new_with_buttons(_("Exporting"), GTK_WINDOW(gebr.window),
+						  GTK_DIALOG_MODAL | GTK_DIALOG_NO_SEPARATOR,
+						  GTK_STOCK_CANCEL, GTK_RESPONSE_CANCEL, NULL);
+	data.progress = gtk_progress_bar_new();
+	gtk_container_set_border_width(GTK_CONTAINER(data.dialog), 5);
+	gtk_box_pack_start(GTK_BOX(GTK_DIALOG(data.dialog)->vbox), data.progress, FALSE, TRUE, 5);
+	gtk_widget_show_all(data.dialog);
+
+	gebr_tar_set_progress_func(tar, (GebrTarProgressFunc) on_export_progress, &data);
+	thread = g_thread_create((GThreadFunc) export_compact_thread, &data, TRUE, NULL);
+	timeout = gdk_threads_add_timeout(100, (GSourceFunc) export_update_progress, &data);
+
+	if (gtk_dialog_run(GTK_DIALOG(data.dialog)) != GTK_RESPONSE_OK)
+		gebr_tar_cancel(tar);
+
+	g_source_remove(timeout);
+	g_thread_join(thread);
+	gtk_widget_destroy(data.dialog);
+
+	return data.ret;
+}
+
 void project_line_export(void)
 {
 	GebrTar *tar;
@@ -1357,7 +1447,17 @@ void project_line_export(void)
 	}
 
 	GtkWidget *box;
-	box = gtk_vbox_new(FALSE, 5);
+	GtkWidget *level_combo;
+	gint level = GEBR_TAR_DEFAULT_LEVEL;
+	box = gtk_hbox_new(FALSE, 5);
+	level_combo = gtk_combo_box_new_text();
+	gtk_combo_box_append_text(GTK_COMBO_BOX(level_combo), _("Fast"));
+	gtk_combo_box_append_text(GTK_COMBO_BOX(level_combo), _("Normal"));
+	gtk_combo_box_append_text(GTK_COMBO_BOX(level_combo), _("Best"));
+	g_signal_connect(level_combo, "changed", G_CALLBACK(on_export_level_changed), &level);
+	gtk_combo_box_set_active(GTK_COMBO_BOX(level_combo), 1);
+	gtk_box_pack_start(GTK_BOX(box), gtk_label_new(_("Compression:")), FALSE, TRUE, 0);
+	gtk_box_pack_start(GTK_BOX(box), level_combo, FALSE, TRUE, 0);
 	/* run file chooser */
 
 	chooser_dialog = gebr_gui_save_dialog_new(_("Choose filename to save"), GTK_WINDOW(gebr.window));
@@ -1425,9 +1525,12 @@ void project_line_export(void)
 	}
 
 	tar = gebr_tar_create (tmp);
+	gebr_tar_set_level (tar, level);
 
-	if (gebr_tar_compact (tar, tmpdir->str))
+	if (project_line_export_compact (tar, tmpdir->str))
 		gebr_message(GEBR_LOG_INFO, TRUE, TRUE, _("Export succesful."));
+	else if (gebr_tar_is_cancelled (tar))
+		gebr_message(GEBR_LOG_INFO, TRUE, TRUE, _("Export cancelled."));
 	else
 		gebr_message(GEBR_LOG_ERROR, TRUE, TRUE, _("Could not export."));
 	g_list_free(lines);
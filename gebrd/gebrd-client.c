@@ -68,6 +68,7 @@ void client_add(GebrCommProtocolSocket * client)
 	c->display = g_string_new(NULL);
 
 	gebrd_user_set_connection(gebrd->user, c);
+	gebrd_orphan_update();
 
 	g_signal_connect(c->socket, "disconnected",
 			 G_CALLBACK(client_disconnected), c);
@@ -86,12 +87,39 @@ void client_free(struct client *client)
 	g_free(client);
 }
 
+void client_send_load(struct client *client,
+		      const gchar *delta)
+{
+	gebr_comm_protocol_socket_oldmsg_send(client->socket, FALSE,
+					      gebr_comm_protocol_defs.lod_def, 1,
+					      delta);
+}
+
+static gboolean
+client_release_socket(GebrCommProtocolSocket *socket)
+{
+	g_object_unref(socket);
+	return FALSE;
+}
+
 void
 client_disconnected(GebrCommProtocolSocket * socket,
 		    struct client *client)
 {
 	gebrd_message(GEBR_LOG_DEBUG, "client_disconnected");
-	gebrd_quit();
+
+	if (!job_has_running_jobs()) {
+		gebrd_quit();
+		return;
+	}
+
+	/* Keep the jobs running for the next maestro, which lists them. The
+	 * socket is still emitting this signal, so it is released later. */
+	g_signal_handlers_disconnect_matched(socket, G_SIGNAL_MATCH_DATA,
+					     0, 0, NULL, NULL, client);
+	g_idle_add((GSourceFunc)client_release_socket, g_object_ref(socket));
+	gebrd_user_set_connection(gebrd->user, NULL);
+	gebrd_orphan_update();
 }
 
 static void client_process_request(GebrCommProtocolSocket * socket, GebrCommHttpMsg * request, struct client *client)
@@ -261,11 +289,9 @@ get_mpi_flavors(GebrdMpiConfig *mpi_config, GString *mpi_flavors) {
 
 static void client_old_parse_messages(GebrCommProtocolSocket * socket, struct client *client)
 {
-	GList *link;
 	struct gebr_comm_message *message;
 
-	while ((link = g_list_last(client->socket->protocol->messages)) != NULL) {
-		message = (struct gebr_comm_message *)link->data;
+	while ((message = g_queue_peek_head(client->socket->protocol->messages)) != NULL) {
 
 		/* check login */
 		if (message->hash == gebr_comm_protocol_defs.ini_def.code_hash) {
@@ -321,9 +347,11 @@ static void client_old_parse_messages(GebrCommProtocolSocket * socket, struct cl
 			cpu_clock = gebrd_cpu_info_get (cpuinfo, 0, "cpu MHz");
 			total_memory = gebrd_mem_info_get (meminfo, "MemTotal");
 			gchar *ncores = g_strdup_printf("%d", gebrd_cpu_info_n_procs(cpuinfo));
+			gint framing = gebr_comm_protocol_socket_oldmsg_peer_framing(message->argument, 2);
+			gchar *framing_str = g_strdup_printf("%d", framing);
 
 			gebr_comm_protocol_socket_oldmsg_send(client->socket, FALSE,
-							      gebr_comm_protocol_defs.ret_def, 11,
+							      gebr_comm_protocol_defs.ret_def, 12,
 							      gebrd->hostname,
 							      server_type,
 							      accounts_list->str,
@@ -334,9 +362,19 @@ static void client_old_parse_messages(GebrCommProtocolSocket * socket, struct cl
 							      cpu_clock,
 							      gebrd_user_get_daemon_id(gebrd->user),
 							      g_get_home_dir(),
-							      mpi_flavors->str);
+							      mpi_flavors->str,
+							      framing_str);
+			gebr_comm_protocol_socket_set_framing(client->socket, framing);
+			g_free(framing_str);
 			gebrd_cpu_info_free(cpuinfo);
 			gebrd_mem_info_free(meminfo);
+
+			/* From now on only the changes are pushed */
+			gchar *sample = gebrd->sampler ? gebrd_sampler_sync(gebrd->sampler) : NULL;
+			if (sample)
+				client_send_load(client, sample);
+			g_free(sample);
+
 			gebr_comm_protocol_socket_oldmsg_split_free(arguments);
 			g_string_free(accounts_list, TRUE);
 			g_string_free(queue_list, TRUE);
@@ -390,7 +428,15 @@ static void client_old_parse_messages(GebrCommProtocolSocket * socket, struct cl
 			gebr_comm_message_free(message);
 			return;
 		} else if (message->hash == gebr_comm_protocol_defs.lst_def.code_hash) {
-			job_list(client);
+			GList *arguments;
+
+			if ((arguments = gebr_comm_protocol_socket_oldmsg_split(message->argument, 1)) == NULL)
+				goto err;
+
+			GString *offsets = g_list_nth_data(arguments, 0);
+			job_list(client, offsets->str);
+
+			gebr_comm_protocol_socket_oldmsg_split_free(arguments);
 		} else if (message->hash == gebr_comm_protocol_defs.run_def.code_hash) {
 			GList *arguments;
 			GebrdJob *job;
@@ -581,13 +627,11 @@ static void client_old_parse_messages(GebrCommProtocolSocket * socket, struct cl
 			/* unknown message! */
 			goto err;
 		}
-		gebr_comm_message_free(message);
-		client->socket->protocol->messages = g_list_delete_link(client->socket->protocol->messages, link);
+		gebr_comm_message_free(g_queue_pop_head(client->socket->protocol->messages));
 	}
 
 	return;
 
-err:	gebr_comm_message_free(message);
-	client->socket->protocol->messages = g_list_delete_link(client->socket->protocol->messages, link);
+err:	gebr_comm_message_free(g_queue_pop_head(client->socket->protocol->messages));
 	client_disconnected(socket, client);
 }
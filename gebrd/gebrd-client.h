@@ -38,6 +38,17 @@ void client_add(GebrCommProtocolSocket *client);
 
 void client_free(struct client *client);
 
+/**
+ * client_send_load:
+ * @delta: the changes of the resources of this machine, see
+ * gebrd_sample_diff()
+ *
+ * Pushes @delta to the maestro, which keeps the last sample to score this
+ * daemon without asking for it on every job.
+ */
+void client_send_load(struct client *client,
+		      const gchar *delta);
+
 void client_disconnected(GebrCommProtocolSocket * socket,
                          struct client *client);
 
@@ -15,13 +15,15 @@
  *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-#define OUTPUT_FLUSH_TIMEOUT 0
-
 #define _XOPEN_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 #include <unistd.h>
+#include <sys/wait.h>
 
 #include <glib.h>
 #include <glib/gstdio.h>
@@ -34,8 +36,10 @@
 #include <libgebr/utils.h>
 #include <libgebr/date.h>
 #include <libgebr/geoxml/gebr-geo-types.h>
+#include <libgebr/gebr-bc.h>
 
 #include "gebrd-job.h"
+#include "gebrd-job_p.h"
 #include "gebrd.h"
 #include "gebrd-mpi-implementations.h"
 
@@ -67,6 +71,7 @@ static void gebrd_job_init(GebrdJob * job)
 	job->gid = g_string_new(NULL);
 	job->paths = g_string_new(NULL);
 	job->mpi_servers = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	job->string_vars = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
 }
 
 static void gebrd_job_class_init(GebrdJobClass * klass)
@@ -79,6 +84,20 @@ static void job_send_signal_on_moab(const char * signal, GebrdJob * job);
 static GebrdMpiInterface *job_get_mpi_impl(const gchar * mpi_name, const gchar *np, GHashTable *mpi_servers);
 static gchar *escape_quote_and_slash(const gchar *str);
 static gchar *replace_quotes(gchar *str);
+static void job_loop_signal(GebrdJob *job, void (*signal_func)(GebrCommProcess *));
+static void job_clear_dictionary_table(GebrdJob *job);
+static void job_report_stages(GebrdJob *job, gint fd, gint step);
+
+/**
+ * \internal
+ * A process slot of a loop run by gebrd, see job_loop_run().
+ */
+typedef struct {
+	GebrdJob *job;
+	GebrCommProcess *process;
+	gint step;	/* loop step running on this slot, -1 when idle */
+	gint status_fd;	/* status of the programs of a step run without bash, or -1 */
+} GebrdJobSlot;
 
 /**
  * \internal
@@ -107,57 +126,197 @@ static void job_send_clients_output(GebrdJob *job, GString * output)
 		return;
 
 	struct client *client = gebrd_user_get_connection(gebrd->user);
+	if (!client)
+		return;
+
 	gebr_comm_protocol_socket_oldmsg_send(client->socket, FALSE,
 					      gebr_comm_protocol_defs.out_def, 4, job->parent.jid->str, output->str,
 					      job->parent.run_id->str, job->frac->str);
 }
 
+/*
+ * Output of the processes is batched: it waits in job->output_pending until
+ * OUTPUT_FLUSH_INTERVAL passes or OUTPUT_FLUSH_SIZE bytes pile up, and is sent
+ * as a single OUT message. Each job may send OUTPUT_RATE_LIMIT bytes per
+ * second, with bursts up to OUTPUT_RATE_BURST (see gebrd-job_p.h); what
+ * exceeds it is dropped and replaced by a marker.
+ */
+#define OUTPUT_FLUSH_INTERVAL	250		/* milliseconds */
+#define OUTPUT_FLUSH_SIZE	(32 << 10)
+/* output held while the connection to the maestro is congested */
+#define OUTPUT_MAX_PENDING	(4 << 20)
+
 /**
  * \internal
+ * Replaces the bytes of \p str which are not UTF-8, starting at \p from, by
+ * '?'. Unless \p final, an incomplete character at the end is left alone, as
+ * the rest of it may still be read.
+ *
+ * \return The length of the validated prefix of \p str.
  */
-static void job_process_add_output(GebrdJob *job, GString * destination, GString * output)
+gsize job_output_sanitize(GString *str, gsize from, gboolean final)
 {
-	GString *final_output;
-
-	final_output = g_string_new(NULL);
-	/* ensure UTF-8 encoding */
-	if (g_utf8_validate(output->str, -1, NULL) == FALSE) {
-		gchar *converted;
-
-		/* TODO: what else should be tried? */
-		converted = gebr_locale_to_utf8(output->str);
-		if (converted == NULL) {
-			g_string_assign(final_output, converted);
-			gebrd_message(GEBR_LOG_ERROR, _("Job '%s' sent output not in UTF-8."), job->parent.title->str);
-		} else {
-			g_string_assign(final_output, converted);
-			g_free(converted);
+	gchar *p = str->str + from;
+	gchar *end = str->str + str->len;
+
+	while (p < end) {
+		const gchar *valid_end;
+
+		/* This also stops at NULs, which would end the message */
+		if (g_utf8_validate(p, end - p, &valid_end))
+			break;
+
+		/* A NUL is never the start of a character, though newer GLibs
+		 * report it as an incomplete one */
+		p = (gchar *)valid_end;
+		if (!final && *p && g_utf8_get_char_validated(p, end - p) == (gunichar)-2)
+			return p - str->str;
+
+		*p++ = '?';
+	}
+
+	return str->len;
+}
+
+/**
+ * \internal
+ * Collapses the progress updates written with carriage returns between \p
+ * from and \p to to their last state: only the text after the last '\\r' of
+ * each line is kept. A '\\r' ending a line is kept, it is overwritten by the
+ * text read next.
+ *
+ * \return The new position of \p to.
+ */
+gsize job_output_collapse_cr(GString *str, gsize from, gsize to)
+{
+	gchar *s = str->str;
+	gsize w = from;
+	gsize line = from;
+
+	while (line < to) {
+		gchar *nl = memchr(s + line, '\n', to - line);
+		gsize line_end = nl ? nl - s + 1 : to;
+		gsize keep = line;
+
+		/* Ignore the '\r' of a CRLF, or the one ending the text */
+		gsize last = nl ? line_end - 1 : line_end;
+		if (last > line && s[last - 1] == '\r')
+			last--;
+		for (gsize i = last; i > line; i--) {
+			if (s[i - 1] == '\r') {
+				keep = i;
+				break;
+			}
 		}
-	} else
-		g_string_assign(final_output, output->str);
 
-	g_string_append(destination, final_output->str);
-	job_send_clients_output(job, final_output);
+		memmove(s + w, s + keep, line_end - keep);
+		w += line_end - keep;
+		line = line_end;
+	}
 
-	g_string_free(final_output, TRUE);
+	g_string_erase(str, w, to - w);
+	return w;
 }
 
-#define OUTBUF 0
-#define ERRBUF 1
+/**
+ * \internal
+ * Sends what is pending in \p job's output, as much as its rate allows. If
+ * \p final, the output is sent even if the connection is congested, along
+ * with any incomplete UTF-8 character. While no maestro is connected the
+ * output is only kept in the job, see job_list().
+ */
+void job_output_flush(GebrdJob *job, gboolean final)
+{
+	struct client *client = gebrd_user_get_connection(gebrd->user);
 
-static void
-append_output_and_send(GebrCommProcess * process, GebrdJob *job, GString *output, gint buf)
+	if (!final && client && gebr_comm_protocol_socket_is_congested(client->socket))
+		return;
+
+	if (final)
+		job->output_valid = job_output_sanitize(job->output_pending, job->output_valid, TRUE);
+	if (!job->output_valid && !job->output_dropped)
+		return;
+
+	GTimeVal now;
+	g_get_current_time(&now);
+	gdouble elapsed = (now.tv_sec - job->output_refill.tv_sec)
+		+ (now.tv_usec - job->output_refill.tv_usec) / 1e6;
+	job->output_refill = now;
+	job->output_allowance = MIN(OUTPUT_RATE_BURST,
+				    job->output_allowance + elapsed * OUTPUT_RATE_LIMIT);
+
+	gsize n = job->output_valid;
+	if (n > job->output_allowance) {
+		/* Cut the output at a line break, or at least a character */
+		gchar *cut = job->output_pending->str + (gsize)job->output_allowance;
+		gchar *p = g_strrstr_len(job->output_pending->str, cut - job->output_pending->str, "\n");
+		if (p)
+			cut = p + 1;
+		else if (cut > job->output_pending->str)
+			cut = g_utf8_find_prev_char(job->output_pending->str, cut + 1);
+		n = cut - job->output_pending->str;
+		job->output_dropped += job->output_valid - n;
+	}
+
+	GString *message = g_string_new_len(job->output_pending->str, n);
+	g_string_erase(job->output_pending, 0, job->output_valid);
+	job->output_valid = 0;
+	job->output_allowance -= n;
+
+	if (job->output_dropped) {
+		gchar *size = g_format_size_for_display(job->output_dropped);
+		if (message->len && message->str[message->len - 1] != '\n')
+			g_string_append_c(message, '\n');
+		g_string_append_printf(message, _("[%s of output dropped]\n"), size);
+		job->output_dropped = 0;
+		g_free(size);
+	}
+
+	if (message->len) {
+		g_string_append_len(job->parent.output, message->str, message->len);
+		job_send_clients_output(job, message);
+	}
+	g_string_free(message, TRUE);
+}
+
+static gboolean job_output_flush_timeout(GebrdJob *job)
 {
-	GTimeVal tv;
+	job_output_flush(job, FALSE);
 
-	g_string_append(job->buf[buf], output->str);
-	g_get_current_time(&tv);
+	/* An incomplete character waits for the next read */
+	if (job->output_valid || job->output_dropped)
+		return TRUE;
 
-	if (tv.tv_sec - job->timeout[buf] >= OUTPUT_FLUSH_TIMEOUT) {
-		job_process_add_output(job, job->parent.output, job->buf[buf]);
-		g_string_assign(job->buf[buf], "");
-		job->timeout[buf] = tv.tv_sec;
+	job->output_source = 0;
+	return FALSE;
+}
+
+/**
+ * \internal
+ * Queues \p len bytes of output of \p job, see job_output_flush().
+ */
+void job_output_append(GebrdJob *job, const gchar *data, gsize len)
+{
+	if (job->output_pending->len + len > OUTPUT_MAX_PENDING) {
+		job->output_dropped += len;
+		return;
 	}
+
+	/* Progress updates can only span from the start of the last line */
+	gsize line = job->output_valid;
+	while (line > 0 && job->output_pending->str[line - 1] != '\n')
+		line--;
+
+	g_string_append_len(job->output_pending, data, len);
+	gsize valid = job_output_sanitize(job->output_pending, job->output_valid, FALSE);
+	job->output_valid = job_output_collapse_cr(job->output_pending, line, valid);
+
+	if (job->output_valid >= OUTPUT_FLUSH_SIZE)
+		job_output_flush(job, FALSE);
+
+	if (!job->output_source && (job->output_valid || job->output_dropped))
+		job->output_source = g_timeout_add(OUTPUT_FLUSH_INTERVAL,
+						   (GSourceFunc)job_output_flush_timeout, job);
 }
 
 static void
@@ -165,7 +324,7 @@ job_process_read_stdout(GebrCommProcess * process, GebrdJob *job)
 {
 	GString *output;
 	output = gebr_comm_process_read_stdout_string_all(process);
-	append_output_and_send(process, job, output, OUTBUF);
+	job_output_append(job, output->str, output->len);
 	g_string_free(output, TRUE);
 }
 
@@ -174,7 +333,7 @@ job_process_read_stderr(GebrCommProcess * process, GebrdJob *job)
 {
 	GString *output;
 	output = gebr_comm_process_read_stderr_string_all(process);
-	append_output_and_send(process, job, output, ERRBUF);
+	job_output_append(job, output->str, output->len);
 	g_string_free(output, TRUE);
 }
 
@@ -221,9 +380,7 @@ static void job_status_notify_finished(GebrdJob *job)
 			gsize length = 0;
 			g_io_channel_read_to_end(file, &buffer, &length, &error);
 			if (length > 0) {
-				GString *buffer_gstring = g_string_new(buffer);
-				job_process_add_output(job, job->parent.output, buffer_gstring);
-				g_string_free(buffer_gstring, TRUE);
+				job_output_append(job, buffer, length);
 				g_free(buffer);
 			}
 		}
@@ -241,6 +398,11 @@ static void job_status_notify_finished(GebrdJob *job)
  */
 static void job_process_finished(GebrCommProcess * process, gint status, GebrdJob *job)
 {
+	if (job->status_fd != -1) {
+		job_report_stages(job, job->status_fd, -1);
+		job->status_fd = -1;
+	}
+
 	if (WEXITSTATUS(status) == 0)
 		job_status_notify_finished(job);
 	else
@@ -398,10 +560,22 @@ job_new(GebrdJob **_job,
 	job->critical_error = FALSE;
 	job->user_finished = FALSE;
 	job->children = NULL;
-	job->buf[0] = g_string_new(NULL);
-	job->buf[1] = g_string_new(NULL);
-	job->timeout[0] = 0;
-	job->timeout[1] = 0;
+	job->output_pending = g_string_new(NULL);
+	job->output_valid = 0;
+	job->output_source = 0;
+	job->output_allowance = OUTPUT_RATE_BURST;
+	g_get_current_time(&job->output_refill);
+	job->output_dropped = 0;
+	job->server_loop = FALSE;
+	job->loop_steps = 0;
+	job->next_step = 0;
+	job->running_steps = 0;
+	job->slots = NULL;
+	job->steps_status = NULL;
+	job->dict_table = NULL;
+	job->dict_file = NULL;
+	job->pipeline = NULL;
+	job->status_fd = -1;
 
 	g_string_assign(job->gid, gid->str);
 	g_string_assign(job->parent.client_hostname, client->socket->protocol->hostname->str);
@@ -471,13 +645,31 @@ void job_free(GebrdJob *job)
 
 	/* free data */
 	gebr_comm_process_free(job->process);
+	if (job->slots) {
+		for (guint i = 0; i < job->slots->len; i++) {
+			GebrdJobSlot *slot = g_ptr_array_index(job->slots, i);
+			gebr_comm_process_free(slot->process);
+			if (slot->status_fd != -1)
+				close(slot->status_fd);
+			g_free(slot);
+		}
+		g_ptr_array_free(job->slots, TRUE);
+	}
+	if (job->steps_status)
+		g_array_free(job->steps_status, TRUE);
+	job_clear_dictionary_table(job);
+	gebrd_pipeline_free(job->pipeline);
+	g_hash_table_destroy(job->string_vars);
+	if (job->status_fd != -1)
+		close(job->status_fd);
 	if (gebrd_get_server_type() == GEBR_COMM_SERVER_TYPE_MOAB)
 		if (job->tail_process != NULL)
 			gebr_comm_process_free(job->tail_process);
 	if (job->flow)
 		gebr_geoxml_document_free(GEBR_GEOXML_DOC(job->flow));
-	g_string_free(job->buf[0], TRUE);
-	g_string_free(job->buf[1], TRUE);
+	if (job->output_source)
+		g_source_remove(job->output_source);
+	g_string_free(job->output_pending, TRUE);
 	g_string_free(job->frac, TRUE);
 	g_string_free(job->server_list, TRUE);
 	g_string_free(job->server_group_name, TRUE);
@@ -532,35 +724,35 @@ void job_status_notify(GebrdJob *job, GebrCommJobStatus status, const gchar *_pa
 	gchar *parameter = g_strdup_vprintf(_parameter, argp);
 	va_end(argp);
 
+	/* The output must arrive before the job is seen as stopped */
+	if (status == JOB_STATUS_FINISHED || status == JOB_STATUS_FAILED || status == JOB_STATUS_CANCELED)
+		job_output_flush(job, TRUE);
+
 	job_status_set(job, status);
 
 	/* warn all clients of the new status */
 	struct client *client = gebrd_user_get_connection(gebrd->user);
 
-	gebr_comm_protocol_socket_oldmsg_send(client->socket, TRUE,
-					      gebr_comm_protocol_defs.sta_def, 5,
-					      job->parent.jid->str, status_enum_to_string(status),
-					      parameter, job->parent.run_id->str, job->frac->str);
+	if (client)
+		gebr_comm_protocol_socket_oldmsg_send(client->socket, TRUE,
+						      gebr_comm_protocol_defs.sta_def, 5,
+						      job->parent.jid->str, status_enum_to_string(status),
+						      parameter, job->parent.run_id->str, job->frac->str);
+	else
+		gebrd_orphan_update();
 
 	g_free(parameter);
 }
 
-void job_run_flow(GebrdJob *job)
+/**
+ * \internal
+ * Returns \p script in the filename encoding, exporting the X display
+ * forwarded for \p job, if any.
+ */
+static gchar *job_build_script(GebrdJob *job, const gchar *script)
 {
-	GString *cmd_line;
-
-	/* initialization */
-	cmd_line = g_string_new(NULL);
-
-	if (job->critical_error == TRUE)
-		goto err;
-
-	/*
-	 * First program
-	 */
-	/* command-line */
 	gsize bytes_written;
-	gchar *localized_cmd_line = g_filename_from_utf8(job->parent.cmd_line->str, -1, NULL, &bytes_written, NULL);
+	gchar *localized_cmd_line = g_filename_from_utf8(script, -1, NULL, &bytes_written, NULL);
 	guint16 display_port = GPOINTER_TO_UINT(g_hash_table_lookup(gebrd->display_ports, job->gid->str));
 	g_debug("Looking for display port for gid %s: %d", job->gid->str, display_port);
 	if (display_port != 0) {
@@ -572,28 +764,369 @@ void job_run_flow(GebrdJob *job)
 			g_string_printf(to_quote, "export DISPLAY=:%d; export XAUTHORITY=%s; %s",
 					display_port, xauth_file, localized_cmd_line);
 			g_debug("I will run a flow on DISPLAY=:%d", display_port);
-			gchar * quoted = g_shell_quote(to_quote->str);
-			g_string_printf(cmd_line, "bash -l -c %s", quoted);
-			g_free(quoted);
 		} else {
 			g_string_printf(to_quote, "export DISPLAY=127.0.0.1:%d; export XAUTHORITY=%s; ",
 					display_port, xauth_file);
 			g_debug("Environment variables: %s", to_quote->str);
 
 			g_string_append(to_quote, localized_cmd_line);
-			gchar * quoted = g_shell_quote(to_quote->str);
-			g_string_printf(cmd_line, "bash -l -c %s", quoted);
-			g_free(quoted);
 		}
 
-		g_string_free(to_quote, TRUE);
 		g_free(xauth_file);
-	} else {
-		gchar * quoted = g_shell_quote(localized_cmd_line);
-		g_string_printf(cmd_line, "bash -l -c %s", quoted);
-		g_free(quoted);
+		g_free(localized_cmd_line);
+		return g_string_free(to_quote, FALSE);
+	}
+	return localized_cmd_line;
+}
+
+/**
+ * \internal
+ * Builds in \p cmd_line the login shell invocation that runs \p script.
+ */
+static void job_build_bash_cmd_line(GebrdJob *job, const gchar *script, GString *cmd_line)
+{
+	gchar *localized = job_build_script(job, script);
+	gchar *quoted = g_shell_quote(localized);
+
+	g_string_printf(cmd_line, "bash -l -c %s", quoted);
+	g_free(quoted);
+	g_free(localized);
+}
+
+/**
+ * \internal
+ * Starts \p script of \p job on \p process. The launcher already has the
+ * login environment; without it, a login shell is started for the job.
+ */
+static gboolean job_start_process(GebrdJob *job, GebrCommProcess *process, const gchar *script)
+{
+	gboolean started = FALSE;
+
+	if (gebrd->launcher) {
+		gchar *localized = job_build_script(job, script);
+		started = gebrd_launcher_spawn(gebrd->launcher, process, localized);
+		g_free(localized);
+	}
+
+	if (!started) {
+		GString *cmd_line = g_string_new(NULL);
+		job_build_bash_cmd_line(job, script, cmd_line);
+		started = gebr_comm_process_start(process, cmd_line);
+		g_string_free(cmd_line, TRUE);
+	}
+
+	return started;
+}
+
+/**
+ * \internal
+ * Creates the directories of the line, as the command line does with mkdir.
+ */
+static void job_create_paths(GebrdJob *job)
+{
+	gchar **paths = g_strsplit(job->paths->str, ",", 0);
+
+	for (gint i = 0; paths[i]; i++)
+		if (*paths[i] && g_mkdir_with_parents(paths[i], 0777) == -1)
+			job_issue(job, _("Cannot create directory '%s': %s.\n"), paths[i], g_strerror(errno));
+
+	g_strfreev(paths);
+}
+
+/**
+ * \internal
+ * Returns job->pipeline with the variables of loop \p step (0 without loop)
+ * replaced, or NULL if the flow must be run by bash for that step.
+ */
+static GebrdPipeline *job_resolve_pipeline(GebrdJob *job, gint step)
+{
+	GebrdPipeline *resolved;
+	gchar **values = NULL;
+
+	if (!job->pipeline || !gebrd->launcher)
+		return NULL;
+
+	/* The forwarded display is exported by the script */
+	if (g_hash_table_lookup(gebrd->display_ports, job->gid->str))
+		return NULL;
+
+	if (job->dict_table && step < (gint) job->dict_table->len)
+		values = g_strsplit(g_ptr_array_index(job->dict_table, step), " ", -1);
+
+	resolved = gebrd_pipeline_resolve(job->pipeline, job->string_vars, values);
+	g_strfreev(values);
+
+	return resolved;
+}
+
+/**
+ * \internal
+ * Starts the \p resolved programs of \p job on \p process, without bash, and
+ * frees them; the launcher runs \p script instead if it cannot. The status of
+ * each program is to be read from \p status_fd once \p process finishes, see
+ * job_report_stages().
+ */
+static gboolean job_start_pipeline(GebrdJob *job, GebrCommProcess *process, GebrdPipeline *resolved,
+				   const gchar *script, gint *status_fd)
+{
+	gchar *localized = job_build_script(job, script);
+	gboolean started = gebrd_launcher_run(gebrd->launcher, process, resolved, localized, status_fd);
+
+	g_free(localized);
+	gebrd_pipeline_free(resolved);
+	return started;
+}
+
+/**
+ * \internal
+ * Reads the status of each program of a run of job->pipeline from \p fd,
+ * which is closed, and reports the programs that failed. \p step is the
+ * loop step of the run, or -1.
+ */
+static void job_report_stages(GebrdJob *job, gint fd, gint step)
+{
+	GString *buf = g_string_new(NULL);
+	gchar chunk[512];
+	gchar **lines;
+	ssize_t n;
+
+	/* The programs are done, so is everything they wrote */
+	fcntl(fd, F_SETFL, O_NONBLOCK);
+	while ((n = read(fd, chunk, sizeof(chunk))) > 0 || (n == -1 && errno == EINTR))
+		if (n > 0)
+			g_string_append_len(buf, chunk, n);
+	close(fd);
+
+	lines = g_strsplit(buf->str, "\n", -1);
+	for (gint i = 0; lines[i] && job->pipeline && !job->user_finished; i++) {
+		guint stage;
+		gint status, exit_status;
+		const gchar *title;
+
+		if (sscanf(lines[i], "%u %d", &stage, &status) != 2 || stage >= job->pipeline->stages->len)
+			continue;
+
+		/* A later program stopped reading, which bash does not report either */
+		if (WIFSIGNALED(status) && WTERMSIG(status) == SIGPIPE)
+			continue;
+
+		exit_status = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+		if (exit_status == 0)
+			continue;
+
+		title = ((GebrdStage *) g_ptr_array_index(job->pipeline->stages, stage))->title;
+		if (step == -1)
+			job_issue(job, _("Program '%s' exited with status %d.\n"), title, exit_status);
+		else
+			job_issue(job, _("Program '%s' of loop step %d exited with status %d.\n"),
+				  title, step, exit_status);
+	}
+
+	g_strfreev(lines);
+	g_string_free(buf, TRUE);
+}
+
+/**
+ * \internal
+ * Checks that every loop step can run without bash, and if so does once what
+ * the command line does for its first step: creating the directories and
+ * truncating the output files that the steps append to.
+ */
+static void job_loop_prepare_pipeline(GebrdJob *job)
+{
+	GebrdPipeline *first = job_resolve_pipeline(job, 0);
+
+	if (!first) {
+		gebrd_pipeline_free(job->pipeline);
+		job->pipeline = NULL;
+		return;
+	}
+
+	job_create_paths(job);
+
+	for (guint i = 0; i < first->stages->len; i++) {
+		GebrdStage *stage = g_ptr_array_index(first->stages, i);
+		const gchar *files[] = {
+			stage->out && stage->out_append && !gebr_geoxml_flow_io_get_output_append(job->flow) ? stage->out : NULL,
+			stage->err && stage->err_append && !gebr_geoxml_flow_io_get_error_append(job->flow) ? stage->err : NULL,
+		};
+
+		for (guint j = 0; j < G_N_ELEMENTS(files); j++) {
+			gint fd;
+			if (files[j] && (fd = g_open(files[j], O_WRONLY | O_CREAT | O_TRUNC, 0666)) != -1)
+				close(fd);
+		}
+	}
+
+	gebrd_pipeline_free(first);
+}
+
+/**
+ * \internal
+ * Sends \p signal_func to every slot process of a loop run by job_loop_run().
+ */
+static void job_loop_signal(GebrdJob *job, void (*signal_func)(GebrCommProcess *))
+{
+	for (guint i = 0; i < job->slots->len; i++) {
+		GebrdJobSlot *slot = g_ptr_array_index(job->slots, i);
+		if (slot->step != -1)
+			signal_func(slot->process);
+	}
+}
+
+/**
+ * \internal
+ * Changes the job status once all loop steps ended or the user stopped it.
+ * The job fails if any step exited with non-zero status or could not be started.
+ */
+static void job_loop_check_finished(GebrdJob *job)
+{
+	if (job->running_steps > 0)
+		return;
+	if (!job->user_finished && job->next_step < job->loop_steps)
+		return;
+
+	if (job->user_finished) {
+		job_status_notify_finished(job);
+		return;
+	}
+
+	for (gint i = 0; i < job->loop_steps; i++)
+		if (g_array_index(job->steps_status, gint, i) != 0) {
+			job_status_notify(job, JOB_STATUS_FAILED, gebr_iso_date());
+			return;
+		}
+	job_status_notify_finished(job);
+}
+
+/**
+ * \internal
+ * Starts the next pending loop step on \p slot, leaving it idle if there is none.
+ */
+static void job_loop_start_step(GebrdJobSlot *slot)
+{
+	GebrdJob *job = slot->job;
+	GebrGeoXmlSequence *program;
+	GebrdPipeline *resolved;
+	GString *script;
+	gboolean started = FALSE;
+
+	slot->step = -1;
+	if (job->user_finished || job->next_step >= job->loop_steps)
+		return;
+
+	script = g_string_new(NULL);
+	g_string_printf(script, "counter=%d\n", job->next_step);
+	if (job->dict_table)
+		g_string_append_printf(script, "V=(%s)\n",
+				       (gchar *) g_ptr_array_index(job->dict_table, job->next_step));
+	g_string_append(script, job->parent.cmd_line->str);
+
+	resolved = job_resolve_pipeline(job, job->next_step);
+	if (resolved)
+		started = job_start_pipeline(job, slot->process, resolved, script->str, &slot->status_fd);
+	if (!started)
+		started = job_start_process(job, slot->process, script->str);
+
+	if (!started) {
+		job_issue(job, _("Cannot start loop step %d, the remaining steps will not be run.\n"),
+			  job->next_step);
+		job->next_step = job->loop_steps;
+		goto out;
+	}
+
+	slot->step = job->next_step++;
+	job->running_steps++;
+
+	/* for program that waits stdin EOF (like sfmath) */
+	gebr_geoxml_flow_get_program(job->flow, &program, 0);
+	if (gebr_geoxml_program_get_stdin(GEBR_GEOXML_PROGRAM(program)) == FALSE)
+		gebr_comm_process_close_stdin(slot->process);
+
+out:
+	g_string_free(script, TRUE);
+}
+
+/**
+ * \internal
+ * Keeps the exit status of the step that ran on \p slot and reuses the slot
+ * for the next pending step.
+ */
+static void job_loop_step_finished(GebrCommProcess *process, gint status, GebrdJobSlot *slot)
+{
+	GebrdJob *job = slot->job;
+	gint exit_status;
+
+	exit_status = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+	g_array_index(job->steps_status, gint, slot->step) = exit_status;
+	job->running_steps--;
+
+	if (slot->status_fd != -1) {
+		job_report_stages(job, slot->status_fd, slot->step);
+		slot->status_fd = -1;
+	}
+
+	if (exit_status != 0 && !job->user_finished)
+		job_issue(job, _("Loop step %d exited with status %d.\n"), slot->step, exit_status);
+
+	job_loop_start_step(slot);
+	job_loop_check_finished(job);
+}
+
+/**
+ * \internal
+ * Runs the steps of a parallelizable loop on job->numproc slots. Unlike a
+ * batch of background processes waited together, a new step is started as
+ * soon as any slot is free, so a slow step does not hold the other cores.
+ */
+void job_loop_run(GebrdJob *job)
+{
+	gint n_slots = CLAMP(job->numproc, 1, MAX(job->loop_steps, 1));
+	gint not_run = -1;
+
+	job->next_step = 0;
+	job->running_steps = 0;
+	job->steps_status = g_array_sized_new(FALSE, FALSE, sizeof(gint), job->loop_steps);
+	for (gint i = 0; i < job->loop_steps; i++)
+		g_array_append_val(job->steps_status, not_run);
+
+	job->slots = g_ptr_array_sized_new(n_slots);
+	for (gint i = 0; i < n_slots; i++) {
+		GebrdJobSlot *slot = g_new(GebrdJobSlot, 1);
+		slot->job = job;
+		slot->step = -1;
+		slot->status_fd = -1;
+		slot->process = gebr_comm_process_new();
+		g_signal_connect(slot->process, "ready-read-stdout", G_CALLBACK(job_process_read_stdout), job);
+		g_signal_connect(slot->process, "ready-read-stderr", G_CALLBACK(job_process_read_stderr), job);
+		g_signal_connect(slot->process, "finished", G_CALLBACK(job_loop_step_finished), slot);
+		g_ptr_array_add(job->slots, slot);
 	}
-	g_free(localized_cmd_line);
+
+	g_string_assign(job->parent.start_date, gebr_iso_date());
+	job_status_notify(job, JOB_STATUS_RUNNING, job->parent.start_date->str);
+
+	job_loop_prepare_pipeline(job);
+	for (guint i = 0; i < job->slots->len; i++)
+		job_loop_start_step(g_ptr_array_index(job->slots, i));
+	job_loop_check_finished(job);
+}
+
+void job_run_flow(GebrdJob *job)
+{
+	GString *cmd_line;
+
+	/* initialization */
+	cmd_line = g_string_new(NULL);
+
+	if (job->critical_error == TRUE)
+		goto err;
+
+	/*
+	 * First program
+	 */
+	/* command-line */
+	job_build_bash_cmd_line(job, job->parent.cmd_line->str, cmd_line);
 
 	if (gebrd_get_server_type() == GEBR_COMM_SERVER_TYPE_MOAB) {
 		if (!g_find_program_in_path("msub")) {
@@ -646,8 +1179,11 @@ void job_run_flow(GebrdJob *job)
 
 		/* pool for moab status */
 		g_timeout_add(1000, (GSourceFunc)job_moab_checkjob_pooling, job); 
+	} else if (job->server_loop) {
+		job_loop_run(job);
 	} else {
 		GebrGeoXmlSequence *program;
+		GebrdPipeline *resolved;
 
 		g_signal_connect(job->process, "ready-read-stdout", G_CALLBACK(job_process_read_stdout), job);
 		g_signal_connect(job->process, "ready-read-stderr", G_CALLBACK(job_process_read_stderr), job);
@@ -655,7 +1191,14 @@ void job_run_flow(GebrdJob *job)
 
 		g_string_assign(job->parent.start_date, gebr_iso_date());
 		job_status_notify(job, JOB_STATUS_RUNNING, job->parent.start_date->str);
-		gebr_comm_process_start(job->process, cmd_line);
+
+		/* The command line is still what the client shows */
+		resolved = job_resolve_pipeline(job, 0);
+		if (resolved)
+			job_create_paths(job);
+		if (!resolved || !job_start_pipeline(job, job->process, resolved, job->parent.cmd_line->str,
+						     &job->status_fd))
+			job_start_process(job, job->process, job->parent.cmd_line->str);
 
 		/* for program that waits stdin EOF (like sfmath) */
 		gebr_geoxml_flow_get_program(job->flow, &program, 0);
@@ -691,7 +1234,10 @@ void job_end(GebrdJob *job)
 			job_status_notify(job, JOB_STATUS_CANCELED, job->parent.finish_date->str);
 		} else {
 			job->user_finished = TRUE;
-			gebr_comm_process_terminate(job->process);
+			if (job->slots)
+				job_loop_signal(job, gebr_comm_process_terminate);
+			else
+				gebr_comm_process_terminate(job->process);
 		}
 	} else if (gebrd_get_server_type() == GEBR_COMM_SERVER_TYPE_MOAB)
 		job_send_signal_on_moab("SIGTERM", job);
@@ -705,7 +1251,10 @@ void job_kill(GebrdJob *job)
 			job_status_notify(job, JOB_STATUS_CANCELED, job->parent.finish_date->str);
 		} else {
 			job->user_finished = TRUE;
-			gebr_comm_process_kill(job->process);
+			if (job->slots)
+				job_loop_signal(job, gebr_comm_process_kill);
+			else
+				gebr_comm_process_kill(job->process);
 		}
 	} else if (gebrd_get_server_type() == GEBR_COMM_SERVER_TYPE_MOAB)
 		job_send_signal_on_moab("SIGKILL", job);
@@ -722,12 +1271,65 @@ void job_notify(GebrdJob *job, struct client *client)
 					      job->parent.moab_jid->str);
 }
 
-void job_list(struct client *client)
+/**
+ * \internal
+ * Parses the lines "<offset> <frac> <run id>" of the LST message into a table
+ * of offsets by "<run id> <frac>".
+ */
+static GHashTable *job_list_parse_offsets(const gchar *offsets)
 {
+	GHashTable *table = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+	gchar **lines = g_strsplit(offsets, "\n", -1);
+
+	for (gint i = 0; lines[i]; i++) {
+		gchar **fields = g_strsplit(lines[i], " ", 3);
+
+		if (g_strv_length(fields) == 3) {
+			guint64 offset = g_ascii_strtoull(fields[0], NULL, 10);
+			g_hash_table_insert(table, g_strconcat(fields[2], " ", fields[1], NULL),
+					    g_memdup(&offset, sizeof(offset)));
+		}
+		g_strfreev(fields);
+	}
+	g_strfreev(lines);
+
+	return table;
+}
+
+void job_list(struct client *client, const gchar *offsets)
+{
+	GHashTable *known = job_list_parse_offsets(offsets);
+
 	for (GList *link = gebrd->user->jobs; link != NULL; link = g_list_next(link)) {
 		GebrdJob *job = (GebrdJob *)link->data;
 		job_notify(job, client);
+
+		/* Send again what the maestro missed while it was away */
+		gchar *key = g_strconcat(job->parent.run_id->str, " ", job->frac->str, NULL);
+		guint64 *offset = g_hash_table_lookup(known, key);
+		if (offset && *offset < job->parent.output->len) {
+			GString *missed = g_string_new(job->parent.output->str + *offset);
+			job_send_clients_output(job, missed);
+			g_string_free(missed, TRUE);
+		}
+		g_free(key);
+
+		/* The job may have stopped while no maestro was connected */
+		GebrCommJobStatus status = job->parent.status;
+		if (status == JOB_STATUS_FINISHED || status == JOB_STATUS_FAILED || status == JOB_STATUS_CANCELED)
+			gebr_comm_protocol_socket_oldmsg_send(client->socket, FALSE,
+							      gebr_comm_protocol_defs.sta_def, 5,
+							      job->parent.jid->str, status_enum_to_string(status),
+							      job->parent.finish_date->str, job->parent.run_id->str,
+							      job->frac->str);
 	}
+
+	/* An empty task ends the list */
+	gebr_comm_protocol_socket_oldmsg_send(client->socket, FALSE,
+					      gebr_comm_protocol_defs.tsk_def, 5,
+					      "", "", "", "", "");
+
+	g_hash_table_destroy(known);
 }
 
 gboolean
@@ -1077,7 +1679,7 @@ guint gebrd_bc_hash_func(gconstpointer a)
 	return g_str_hash(a);
 }
 
-static gchar* define_bc_variables(GebrdJob *job, GString *expr_buf, GString *str_buf, gsize *n_vars, guint *issue_number)
+static gchar* define_bc_variables(GebrdJob *job, GString *expr_buf, GString *str_buf, GHashTable *str_vars, gsize *n_vars, guint *issue_number)
 {
 	gsize j = 0;
 	const gchar *value;
@@ -1170,6 +1772,7 @@ static gchar* define_bc_variables(GebrdJob *job, GString *expr_buf, GString *str
 				bash_var = g_strdup_printf("${%s}", keyword);
 				gebr_validator_change_value(gebrd_get_validator(gebrd), param, bash_var, NULL, NULL);
 				g_string_append_printf(str_buf, "%s=\"%s\"\t# %s\n", keyword, result, replace_quotes(label));
+				g_hash_table_insert(str_vars, g_strdup(keyword), g_strdup(result));
 				g_free(bash_var);
 				g_free(result);
 				break;
@@ -1185,20 +1788,151 @@ static gchar* define_bc_variables(GebrdJob *job, GString *expr_buf, GString *str
 	return result;
 }
 
+#define BC_FUNCTIONS \
+	"\tdefine min(a,b){ if(a<b) {return a;} else {return b;}}\n" \
+	"\tdefine max(a,b){ if(a>b) {return a;} else {return b;}}\n" \
+	"\tdefine round(x){ auto s; s = scale; if(x>0) x+=0.5 else x-=0.5; scale = 0; x/=1; scale = s; return (x);}\n"
+
+/*
+ * job_precompute_dictionary:
+ *
+ * Evaluates the bc program in @expr_buf for each of the @steps loop steps
+ * with the in-process interpreter, instead of letting each step pipe it into
+ * bc. Each element of the returned array holds the values of V for the step
+ * of the same index, separated by spaces.
+ *
+ * Returns: %NULL if some step could not be evaluated, in which case the
+ * program must be left to bc.
+ */
+GPtrArray *job_precompute_dictionary(GebrdJob *job, const gchar *expr_buf, gint steps)
+{
+	GebrBc *bc;
+	GString *program;
+	GString *output;
+	GPtrArray *table;
+	gchar **parts;
+	gsize n_values = job->n_vars + job->expr_count;
+
+	if (steps <= 0 || n_values == 0)
+		return NULL;
+
+	bc = gebr_bc_new(TRUE);
+	if (!gebr_bc_run(bc, BC_FUNCTIONS, NULL, NULL)) {
+		gebr_bc_free(bc);
+		return NULL;
+	}
+
+	/* $counter is the only value spliced by the shell into the program */
+	parts = g_strsplit(expr_buf, "'\"$counter\"'", -1);
+	program = g_string_new(NULL);
+	output = g_string_new(NULL);
+	table = g_ptr_array_new_with_free_func(g_free);
+
+	for (gint step = 0; step < steps; step++) {
+		gsize lines = 0;
+
+		g_string_assign(program, "scale=5\n");
+		for (gint i = 0; parts[i]; i++) {
+			if (i > 0)
+				g_string_append_printf(program, "%d", step);
+			g_string_append(program, parts[i]);
+		}
+
+		g_string_truncate(output, 0);
+		gebr_bc_reset(bc);
+		if (!gebr_bc_run(bc, program->str, output, NULL))
+			goto err;
+
+		for (gsize i = 0; i < output->len; i++)
+			if (output->str[i] == '\n') {
+				output->str[i] = ' ';
+				lines++;
+			}
+		if (lines != n_values)
+			goto err;
+
+		g_ptr_array_add(table, g_strndup(output->str, output->len - 1));
+	}
+	goto out;
+
+err:
+	g_ptr_array_free(table, TRUE);
+	table = NULL;
+out:
+	g_strfreev(parts);
+	g_string_free(program, TRUE);
+	g_string_free(output, TRUE);
+	gebr_bc_free(bc);
+	return table;
+}
+
+/*
+ * job_write_dictionary_table:
+ *
+ * Writes the precomputed table, one step per line, into a temporary file
+ * that the generated loop loads once with mapfile.
+ *
+ * Returns: the file name or %NULL on error.
+ */
+static gchar *job_write_dictionary_table(GebrdJob *job)
+{
+	gchar *filename;
+	GString *contents;
+	GError *error = NULL;
+	gint fd;
+
+	fd = g_file_open_tmp("gebrd-dict-XXXXXX", &filename, &error);
+	if (fd == -1) {
+		gebrd_message(GEBR_LOG_WARNING, "Cannot create dictionary table: %s", error->message);
+		g_error_free(error);
+		return NULL;
+	}
+	close(fd);
+
+	contents = g_string_new(NULL);
+	for (guint i = 0; i < job->dict_table->len; i++)
+		g_string_append_printf(contents, "%s\n", (gchar *) g_ptr_array_index(job->dict_table, i));
+
+	if (!g_file_set_contents(filename, contents->str, contents->len, &error)) {
+		gebrd_message(GEBR_LOG_WARNING, "Cannot write dictionary table: %s", error->message);
+		g_error_free(error);
+		g_unlink(filename);
+		g_free(filename);
+		filename = NULL;
+	}
+	g_string_free(contents, TRUE);
+
+	return filename;
+}
+
+/*
+ * job_clear_dictionary_table:
+ *
+ * Frees the table of precomputed dictionary values and removes its file.
+ */
+static void job_clear_dictionary_table(GebrdJob *job)
+{
+	if (job->dict_table) {
+		g_ptr_array_free(job->dict_table, TRUE);
+		job->dict_table = NULL;
+	}
+	if (job->dict_file) {
+		g_unlink(job->dict_file);
+		g_free(job->dict_file);
+		job->dict_file = NULL;
+	}
+}
+
 /*
  * assemble_bc_cmd_line:
  */
-static void assemble_bc_cmd_line (GString *expr_buf)
+void assemble_bc_cmd_line (GString *expr_buf)
 {
 	// If there are no expressions, don't bother creating the command line!
 	if (expr_buf->len == 0)
 		return;
 
-	 g_string_prepend(expr_buf,
-			  "V=($(echo 'scale=5\n"
-	                  "\tdefine min(a,b){ if(a<b) {return a;} else {return b;}}\n"
-	                  "\tdefine max(a,b){ if(a>b) {return a;} else {return b;}}\n"
-	                  "\tdefine round(x){ auto s; s = scale; if(x>0) x+=0.5 else x-=0.5; scale = 0; x/=1; scale = s; return (x);}\n");
+	 g_string_prepend(expr_buf, "V=($(echo 'scale=5\n" BC_FUNCTIONS);
 
          g_string_prepend(expr_buf, _("\n# Dictionary\n"));
 	// Pipe into bc
@@ -1224,8 +1958,24 @@ static void job_assembly_cmdline(GebrdJob *job)
 	GString *expr_buf = g_string_new("");
 	GString *str_buf = g_string_new("");
 	GString *mpi_cmd = g_string_new(NULL);
+	GebrdPipeline *pipeline;
+	GebrdStage *stage;
+	gboolean native;
+	gsize start;
 
 	job->expr_count = 0;
+	job->server_loop = FALSE;
+	job->loop_steps = 0;
+	job_clear_dictionary_table(job);
+
+	/* Recorded along the command line, to run the flow without bash if it
+	 * only needs bash for the variables */
+	gebrd_pipeline_free(job->pipeline);
+	job->pipeline = NULL;
+	g_hash_table_remove_all(job->string_vars);
+	pipeline = gebrd_pipeline_new(job->niceness);
+	native = gebrd_get_server_type() == GEBR_COMM_SERVER_TYPE_REGULAR
+		&& !strpbrk(job->paths->str, "$`");
 
 	if (job->flow == NULL) 
 		goto err;
@@ -1274,7 +2024,7 @@ static void job_assembly_cmdline(GebrdJob *job)
 	}
 
 	// define variables on bc, to use on stdin, stdout, stderr and expressions
-	n = define_bc_variables(job, expr_buf, str_buf, &job->n_vars, &issue_number);
+	n = define_bc_variables(job, expr_buf, str_buf, job->string_vars, &job->n_vars, &issue_number);
 
 	/* Configure MPI */
 	const gchar * mpiname;
@@ -1295,19 +2045,23 @@ static void job_assembly_cmdline(GebrdJob *job)
 	/* Binary followed by an space */
 	const gchar * binary;
 	binary = gebr_geoxml_program_get_binary(GEBR_GEOXML_PROGRAM(program));
-	if (mpi == NULL)
-		g_string_append_printf(job->parent.cmd_line, "%s%s ",
-				       "$exec ",
-				       binary);
-	else {
+	if (mpi == NULL) {
+		g_string_append(job->parent.cmd_line, "$exec ");
+		start = job->parent.cmd_line->len;
+		g_string_append_printf(job->parent.cmd_line, "%s ", binary);
+	} else {
 		gchar * mpicmd;
 		mpicmd = gebrd_mpi_interface_build_comand(mpi, binary);
 		g_string_append_printf(job->parent.cmd_line, "%s ", mpicmd);
 		g_free(mpicmd);
+		start = job->parent.cmd_line->len;
+		native = FALSE;
 	}
 
 	if (job_add_program_parameters(job, GEBR_GEOXML_PROGRAM(program), expr_buf) == FALSE)
 		goto err;
+	stage = gebrd_pipeline_add_stage(pipeline, gebr_geoxml_program_get_title(GEBR_GEOXML_PROGRAM(program)),
+					 job->parent.cmd_line->str + start);
 
 	/*
 	 * First program
@@ -1329,6 +2083,7 @@ static void job_assembly_cmdline(GebrdJob *job)
 		if (!error) {
 			gchar *escaped = escape_quote_and_slash(result);
 			g_string_append_printf(job->parent.cmd_line, "<\"%s\" ", escaped);
+			stage->in = g_strdup(escaped);
 			g_free(result);
 			g_free(escaped);
 		} else {
@@ -1363,8 +2118,10 @@ static void job_assembly_cmdline(GebrdJob *job)
 		if (!error) {
 			stderr_use_iter = gebr_output_use_var_iter(job, error_expr);
 			stderr_parsed = escape_quote_and_slash(result);
-			if(gebr_geoxml_flow_io_get_error_append(job->flow) ||
-			   (has_control && !stderr_use_iter))
+			stage->err = g_strdup(stderr_parsed);
+			stage->err_append = gebr_geoxml_flow_io_get_error_append(job->flow) ||
+				(has_control && !stderr_use_iter);
+			if (stage->err_append)
 				g_string_append_printf(job->parent.cmd_line, "2>> \"%s\" ", stderr_parsed);
 			else
 				g_string_append_printf(job->parent.cmd_line, "2> \"%s\" ", stderr_parsed);
@@ -1442,20 +2199,24 @@ static void job_assembly_cmdline(GebrdJob *job)
 		const gchar * binary;
 
 		binary = gebr_geoxml_program_get_binary(GEBR_GEOXML_PROGRAM(program));
-		if (mpi == NULL)
-			g_string_append_printf(job->parent.cmd_line, "%s %s%s ",
-					       sep,
-					       "$exec ",
-					       binary);
-		else {
+		if (mpi == NULL) {
+			g_string_append_printf(job->parent.cmd_line, "%s %s", sep, "$exec ");
+			start = job->parent.cmd_line->len;
+			g_string_append_printf(job->parent.cmd_line, "%s ", binary);
+		} else {
 			gchar * mpicmd;
 			mpicmd = gebrd_mpi_interface_build_comand(mpi, binary);
 			g_string_append_printf(job->parent.cmd_line, "%s %s ", sep, mpicmd);
 			g_free(mpicmd);
+			start = job->parent.cmd_line->len;
+			native = FALSE;
 		}
 
 		if (job_add_program_parameters(job, GEBR_GEOXML_PROGRAM(program), expr_buf) == FALSE)
 			goto err;
+		stage->pipe_to_next = chain_option == 3;
+		stage = gebrd_pipeline_add_stage(pipeline, gebr_geoxml_program_get_title(GEBR_GEOXML_PROGRAM(program)),
+						 job->parent.cmd_line->str + start);
 
 		previous_stdout = gebr_geoxml_program_get_stdout(GEBR_GEOXML_PROGRAM(program));
 		gebr_geoxml_sequence_next(&program);
@@ -1474,9 +2235,11 @@ static void job_assembly_cmdline(GebrdJob *job)
 			if (!error) {
 				stdout_use_iter = gebr_output_use_var_iter(job, output_expr);
 				stdout_parsed = escape_quote_and_slash(result);
+				stage->out = g_strdup(stdout_parsed);
+				stage->out_append = gebr_geoxml_flow_io_get_output_append(job->flow) ||
+					(has_control && !stdout_use_iter);
 
-				if (gebr_geoxml_flow_io_get_output_append(job->flow) ||
-				    (has_control && !stdout_use_iter))
+				if (stage->out_append)
 					g_string_append_printf(job->parent.cmd_line, ">> \"%s\" ", stdout_parsed);
 				else
 					g_string_append_printf(job->parent.cmd_line, "> \"%s\" ", stdout_parsed);
@@ -1500,11 +2263,52 @@ static void job_assembly_cmdline(GebrdJob *job)
 	if (has_control && n) {
 		gchar *prefix;
 		gchar *remove;
+		gchar *load_table = g_strdup("");
 		gint nprocs, nice;
 
-		assemble_bc_cmd_line (expr_buf);
+		job->loop_steps = atoi(n);
+		if (gebrd_get_server_type() == GEBR_COMM_SERVER_TYPE_REGULAR)
+			job->dict_table = job_precompute_dictionary(job, expr_buf->str, job->loop_steps);
+		if (job->dict_table && !job->is_parallelizable) {
+			job->dict_file = job_write_dictionary_table(job);
+			if (job->dict_file == NULL) {
+				g_ptr_array_free(job->dict_table, TRUE);
+				job->dict_table = NULL;
+			}
+		}
 
-		if (job->is_parallelizable) {
+		if (job->dict_table) {
+			g_string_assign(expr_buf, _("\n# Dictionary (computed by the server for each step)\n"));
+			if (job->dict_file) {
+				gchar *escaped = escape_quote_and_slash(job->dict_file);
+				g_free(load_table);
+				load_table = g_strdup_printf("mapfile -t _V < \"%s\"\n", escaped);
+				g_string_append(expr_buf, "V=(${_V[$counter]})\n");
+				g_free(escaped);
+			}
+		} else
+			assemble_bc_cmd_line (expr_buf);
+
+		if (job->is_parallelizable && gebrd_get_server_type() == GEBR_COMM_SERVER_TYPE_REGULAR) {
+			/* The loop itself is run by job_loop_run(), which sets $counter for each step */
+			gchar *fcomm, *scomm, *ffcomm;
+			job->server_loop = TRUE;
+			nprocs = job->numproc;
+			nice = job->niceness;
+			fcomm = g_strdup_printf(_("\n# Loop steps run simultaneously by the server \n"));
+			scomm = g_strdup_printf(_("# Command Line"));
+			ffcomm = g_strdup_printf(_("\n# Setting the niceness of the process \n"));
+			prefix = g_strdup_printf("%s"
+						 "PROC=%d\n"
+						 "%s"
+						 "NICE=%d\n"
+						 "exec=\"nice -n $NICE\"\n"
+						 "%s\n%s \n%s\n",
+						 fcomm, nprocs, ffcomm, nice, expr_buf->str, str_buf->str, scomm);
+			g_free(fcomm);
+			g_free(scomm);
+			g_free(ffcomm);
+		} else if (job->is_parallelizable) {
 			nprocs = job->numproc;
 			nice = job->niceness;
 			gchar *fcomm, *scomm, *ffcomm;
@@ -1535,8 +2339,9 @@ static void job_assembly_cmdline(GebrdJob *job)
 			prefix = g_strdup_printf("%s"
 						 "NICE=%d\n"
 						 "exec=\"nice -n $NICE\"\n"
+						 "%s"
 						 "for (( counter=0; counter<%s; counter++ ))\ndo\n%s\n%s \n# Command Line \n",
-						 tcomm,nice, n, expr_buf->str, str_buf->str);
+						 tcomm,nice, load_table, n, expr_buf->str, str_buf->str);
 			g_free(tcomm);
 		}
 		if (!gebr_geoxml_flow_io_get_output_append(job->flow) && !stdout_use_iter &&
@@ -1552,17 +2357,22 @@ static void job_assembly_cmdline(GebrdJob *job)
 			g_free(remove);
 		}
 		g_string_prepend(job->parent.cmd_line, prefix);
-		if (job->is_parallelizable)
-			g_string_append_printf(job->parent.cmd_line, "\n"
-					       "  done\n"
-					       "  wait $PIDS\n");
-		g_string_append(job->parent.cmd_line, "\ndone");
+		if (!job->server_loop) {
+			if (job->is_parallelizable)
+				g_string_append_printf(job->parent.cmd_line, "\n"
+						       "  done\n"
+						       "  wait $PIDS\n");
+			g_string_append(job->parent.cmd_line, "\ndone");
+		}
 		g_free(prefix);
+		g_free(load_table);
 		g_free(n);
 	} else {
 		gchar *fcomm,*sxcomm;
 		fcomm = g_strdup_printf(_("\n# Setting the niceness of the process \n"));
 		sxcomm = g_strdup_printf(_("# Command Line \n"));
+		if (native)
+			job->dict_table = job_precompute_dictionary(job, expr_buf->str, 1);
 		assemble_bc_cmd_line (expr_buf);
 		gchar *prefix = g_strdup_printf("%s"
 						"NICE=%d\n"
@@ -1587,11 +2397,18 @@ static void job_assembly_cmdline(GebrdJob *job)
 	g_string_prepend(job->parent.cmd_line, mkdir->str);
 	g_string_free(mkdir, TRUE);
 
+	/* A loop run by bash keeps its counter in the shell */
+	if (native && (!has_control || job->server_loop))
+		job->pipeline = pipeline;
+	else
+		gebrd_pipeline_free(pipeline);
+
 	job->critical_error = FALSE;
 	g_string_free(expr_buf, TRUE);
 	g_string_free(str_buf, TRUE);
 	return;
 err:	
+	gebrd_pipeline_free(pipeline);
 	g_string_free(expr_buf, TRUE);
 	g_string_assign(job->parent.cmd_line, "");
 	job->critical_error = TRUE;
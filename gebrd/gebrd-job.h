@@ -24,6 +24,7 @@
 #include <libgebr/gebr-validator.h>
 
 #include "gebrd-client.h"
+#include "gebrd-pipeline.h"
 
 G_BEGIN_DECLS
 
@@ -73,8 +74,33 @@ struct _GebrdJob {
 
 	GHashTable *mpi_servers;
 
-	GString *buf[2];
-	gint timeout[2];
+	/* Output not sent yet; only its first output_valid bytes are
+	 * sanitized, the rest is an incomplete UTF-8 character */
+	GString *output_pending;
+	gsize output_valid;
+	guint output_source;
+	gdouble output_allowance;
+	GTimeVal output_refill;
+	guint64 output_dropped;
+
+	/* Loop steps run by gebrd itself on numproc slots */
+	gboolean server_loop;
+	gint loop_steps;
+	gint next_step;
+	gint running_steps;
+	GPtrArray *slots;
+	GArray *steps_status;
+
+	/* Values of V for each loop step, or for the single run of a flow
+	 * without loop, computed once per job */
+	GPtrArray *dict_table;
+	gchar *dict_file;
+
+	/* The programs of the flow, run without bash when it is only needed
+	 * for the variables; %NULL if the command line must be run by bash */
+	GebrdPipeline *pipeline;
+	GHashTable *string_vars;
+	gint status_fd;
 };
 
 struct _GebrdJobClass {
@@ -138,8 +164,14 @@ void job_kill(GebrdJob *job);
  */
 void job_notify(GebrdJob *job, struct client *client);
 /**
+ * Sends a TSK message for each job to \p client, and the status of the
+ * stopped ones. An empty TSK message ends the list.
+ *
+ * \p offsets has a line "<offset> <frac> <run id>" for each task the maestro
+ * knows of, with the length of the output it has. The output after it is sent
+ * again, as it was produced while no maestro was connected.
  */
-void job_list(struct client *client);
+void job_list(struct client *client, const gchar *offsets);
 
 /**
  */
@@ -0,0 +1,66 @@
+/*   GeBR Daemon - Process and control execution of flows
+ *   Copyright (C) 2007-2012 GeBR core team (http://www.gebrproject.com/)
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __JOB_P_H
+#define __JOB_P_H
+
+#include "gebrd-job.h"
+
+G_BEGIN_DECLS
+
+/*
+ * The relay of the output of the processes of a job, the loops run by gebrd
+ * and their dictionary, exported for the tests and benchmarks only; see
+ * gebrd-job.c.
+ */
+
+/**
+ * Bytes each job may send per second, and in a burst.
+ */
+#define OUTPUT_RATE_LIMIT	(256 << 10)
+#define OUTPUT_RATE_BURST	(1 << 20)
+
+gsize job_output_sanitize(GString *str, gsize from, gboolean final);
+
+gsize job_output_collapse_cr(GString *str, gsize from, gsize to);
+
+void job_output_flush(GebrdJob *job, gboolean final);
+
+void job_output_append(GebrdJob *job, const gchar *data, gsize len);
+
+/**
+ * Runs the \p job->loop_steps steps of a loop on \p job->numproc process
+ * slots, each step with its $counter, and sets the status of \p job once they
+ * all ended.
+ */
+void job_loop_run(GebrdJob *job);
+
+/**
+ * Evaluates the bc program in \p expr_buf for \p steps loop steps in
+ * process, returning the values of V of each step separated by spaces, or
+ * NULL if it must be left to bc.
+ */
+GPtrArray *job_precompute_dictionary(GebrdJob *job, const gchar *expr_buf, gint steps);
+
+/**
+ * Wraps the bc program in \p expr_buf into the shell lines that set V by
+ * piping it into bc.
+ */
+void assemble_bc_cmd_line(GString *expr_buf);
+
+G_END_DECLS
+#endif /* __JOB_P_H */
@@ -0,0 +1,854 @@
+/*   GeBR Daemon - Process and control execution of flows
+ *   Copyright (C) 2007-2012 GeBR core team (http://www.gebrproject.com/)
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "gebrd-launcher.h"
+#include "gebrd-pipeline.h"
+
+extern char **environ;
+
+/* Printed by the login shell before its environment, so whatever the profile
+ * prints is skipped */
+#define ENV_MARKER "\ngebrd-launcher-environment\n"
+
+enum {
+	MSG_SPAWN,	/* to the launcher: run the script, with its 3 descriptors */
+	MSG_RUN,	/* to the launcher: run the serialized pipeline, with its 3
+			   descriptors and the one for the status of its stages,
+			   or the script following it if it can not */
+	MSG_SPAWNED,	/* to the daemon: the pid, or -1 and errno in status */
+	MSG_EXITED,	/* to the daemon: the pid and its status from waitpid() */
+};
+
+#define MAX_FDS 4
+
+typedef struct {
+	gint32 type;
+	gint32 pid;
+	gint32 status;
+	guint32 len;	/* of the script or pipeline following the message */
+	guint32 run_len;	/* of the pipeline before the script of MSG_RUN */
+} LauncherMsg;
+
+typedef struct {
+	GPid pid;
+	gint status;
+	GebrCommProcess *process;	/* if not started, or NULL to look it up */
+} LauncherExit;
+
+struct _GebrdLauncher {
+	GPid pid;
+	gint fd;
+	GIOChannel *channel;
+	guint watch_id;
+
+	/* Processes started and not finished, by pid */
+	GHashTable *processes;
+
+	/* Processes whose request was not answered yet, in the order sent;
+	 * NULL once finalized */
+	GQueue *requests;
+
+	/* Exits not reported yet */
+	GQueue *exited;
+	guint exited_source;
+};
+
+/* Messages {{{1 */
+
+static gboolean
+write_all(gint fd, const void *buf, gsize len)
+{
+	const gchar *p = buf;
+
+	while (len) {
+		ssize_t n = write(fd, p, len);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return FALSE;
+		p += n;
+		len -= n;
+	}
+
+	return TRUE;
+}
+
+static gboolean
+read_all(gint fd, void *buf, gsize len)
+{
+	gchar *p = buf;
+
+	while (len) {
+		ssize_t n = read(fd, p, len);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return FALSE;
+		p += n;
+		len -= n;
+	}
+
+	return TRUE;
+}
+
+/*
+ * send_msg:
+ *
+ * Sends @msg and the @nfds descriptors of @fds through the unix socket @fd.
+ */
+static gboolean
+send_msg(gint fd, LauncherMsg *msg, gint *fds, gint nfds)
+{
+	struct iovec iov = { msg, sizeof(*msg) };
+	struct msghdr hdr;
+	gchar control[CMSG_SPACE(MAX_FDS * sizeof(gint))];
+	ssize_t n;
+
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.msg_iov = &iov;
+	hdr.msg_iovlen = 1;
+
+	if (nfds) {
+		struct cmsghdr *cmsg;
+
+		hdr.msg_control = control;
+		hdr.msg_controllen = CMSG_SPACE(nfds * sizeof(gint));
+		cmsg = CMSG_FIRSTHDR(&hdr);
+		cmsg->cmsg_level = SOL_SOCKET;
+		cmsg->cmsg_type = SCM_RIGHTS;
+		cmsg->cmsg_len = CMSG_LEN(nfds * sizeof(gint));
+		memcpy(CMSG_DATA(cmsg), fds, nfds * sizeof(gint));
+	}
+
+	do
+		n = sendmsg(fd, &hdr, 0);
+	while (n < 0 && errno == EINTR);
+
+	return n == sizeof(*msg);
+}
+
+/*
+ * recv_msg:
+ *
+ * Receives a message from the unix socket @fd, and up to %MAX_FDS descriptors
+ * in @fds, if not %NULL.
+ *
+ * Returns: %FALSE if the other end was closed.
+ */
+static gboolean
+recv_msg(gint fd, LauncherMsg *msg, gint *fds, gint *nfds)
+{
+	struct iovec iov = { msg, sizeof(*msg) };
+	struct msghdr hdr;
+	gchar control[CMSG_SPACE(MAX_FDS * sizeof(gint))];
+	ssize_t n;
+
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.msg_iov = &iov;
+	hdr.msg_iovlen = 1;
+	hdr.msg_control = control;
+	hdr.msg_controllen = sizeof(control);
+
+	do
+		n = recvmsg(fd, &hdr, 0);
+	while (n < 0 && errno == EINTR);
+
+	if (n <= 0)
+		return FALSE;
+
+	if (nfds) {
+		struct cmsghdr *cmsg = CMSG_FIRSTHDR(&hdr);
+
+		*nfds = 0;
+		if (cmsg && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+			*nfds = MIN((cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(gint), MAX_FDS);
+			memcpy(fds, CMSG_DATA(cmsg), *nfds * sizeof(gint));
+		}
+	}
+
+	return read_all(fd, (gchar *) msg + n, sizeof(*msg) - n);
+}
+
+/* Launcher process {{{1 */
+
+static volatile sig_atomic_t refresh_requested;
+static gint wakeup_pipe[2];
+
+/* The pipes between the stages of each pipeline running, by pid, and their
+ * sum, to size the pipes of the next one */
+static GHashTable *run_pipes;
+static guint open_pipes;
+
+static void
+on_signal(int sig)
+{
+	gint saved_errno = errno;
+
+	if (sig == SIGHUP)
+		refresh_requested = 1;
+	if (write(wakeup_pipe[1], "", 1) < 0)
+		; /* the pipe is full, it will wake up anyway */
+
+	errno = saved_errno;
+}
+
+/*
+ * read_environment:
+ *
+ * Runs a login shell once to read the environment it sets up.
+ *
+ * Returns: the environment, or %NULL if the shell could not be run.
+ */
+static gchar **
+read_environment(void)
+{
+	gint out[2];
+	gint status;
+	GPid pid;
+	GByteArray *output;
+	gchar buf[4096];
+	ssize_t n;
+	gchar **env = NULL;
+
+	if (pipe(out) == -1)
+		return NULL;
+
+	pid = fork();
+	if (pid == -1) {
+		close(out[0]);
+		close(out[1]);
+		return NULL;
+	}
+	if (pid == 0) {
+		gint null = open("/dev/null", O_RDWR);
+		close(out[0]);
+		dup2(null, 0);
+		dup2(out[1], 1);
+		dup2(null, 2);
+		execlp("bash", "bash", "-l", "-c", "printf '" ENV_MARKER "'; env -0", NULL);
+		_exit(127);
+	}
+
+	close(out[1]);
+	output = g_byte_array_new();
+	while ((n = read(out[0], buf, sizeof(buf))) != 0) {
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n < 0)
+			break;
+		g_byte_array_append(output, (guint8 *) buf, n);
+	}
+	close(out[0]);
+	while (waitpid(pid, &status, 0) == -1 && errno == EINTR);
+
+	const gchar *start = g_strstr_len((gchar *) output->data, output->len, ENV_MARKER);
+	if (WIFEXITED(status) && WEXITSTATUS(status) == 0 && start) {
+		const gchar *end = (gchar *) output->data + output->len;
+		GPtrArray *vars = g_ptr_array_new();
+
+		for (start += strlen(ENV_MARKER); start < end; start += strlen(start) + 1)
+			if (strchr(start, '='))
+				g_ptr_array_add(vars, g_strdup(start));
+		g_ptr_array_add(vars, NULL);
+		env = (gchar **) g_ptr_array_free(vars, FALSE);
+	}
+
+	g_byte_array_free(output, TRUE);
+	return env;
+}
+
+/*
+ * launcher_fork:
+ *
+ * Forks the leader of a new process group, with @fds as its standard input,
+ * output and error. The descriptors after them are left open in the child.
+ *
+ * Returns: the pid, 0 in the child, or -1.
+ */
+static GPid
+launcher_fork(gint fd, gint *fds)
+{
+	GPid pid = fork();
+
+	if (pid == 0) {
+		setpgid(0, 0);
+
+		dup2(fds[0], 0);
+		dup2(fds[1], 1);
+		dup2(fds[2], 2);
+		for (gint i = 0; i < 3; i++)
+			if (fds[i] > 2)
+				close(fds[i]);
+		close(fd);
+		close(wakeup_pipe[0]);
+		close(wakeup_pipe[1]);
+
+		signal(SIGCHLD, SIG_DFL);
+		signal(SIGHUP, SIG_DFL);
+		signal(SIGPIPE, SIG_DFL);
+
+		return 0;
+	}
+
+	/* Avoids a race with a signal sent to the group before it exists */
+	if (pid > 0)
+		setpgid(pid, pid);
+
+	return pid;
+}
+
+/*
+ * launcher_spawn:
+ *
+ * Starts @script in a new process group, see launcher_fork().
+ */
+static GPid
+launcher_spawn(gint fd, gchar **env, const gchar *script, gint *fds)
+{
+	GPid pid = launcher_fork(fd, fds);
+
+	if (pid == 0) {
+		/* Without the login environment, fall back to a login shell */
+		if (env) {
+			environ = env;
+			execlp("bash", "bash", "-c", script, NULL);
+		} else
+			execlp("bash", "bash", "-l", "-c", script, NULL);
+		_exit(127);
+	}
+
+	return pid;
+}
+
+/*
+ * launcher_run:
+ *
+ * Runs @pipeline in a new process group, see launcher_fork(). The stages are
+ * waited for by the group leader, which writes their status to the fourth
+ * descriptor of @fds.
+ */
+static GPid
+launcher_run(gint fd, gchar **env, GebrdPipeline *pipeline, gint *fds)
+{
+	GPid pid = launcher_fork(fd, fds);
+
+	if (pid == 0) {
+		environ = env;
+		_exit(gebrd_pipeline_run(pipeline, fds[3]));
+	}
+
+	return pid;
+}
+
+static void
+launcher_reap(gint fd)
+{
+	LauncherMsg msg = { MSG_EXITED, 0, 0, 0, 0 };
+	gint status;
+	GPid pid;
+
+	while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+		open_pipes -= GPOINTER_TO_UINT(g_hash_table_lookup(run_pipes, GINT_TO_POINTER(pid)));
+		g_hash_table_remove(run_pipes, GINT_TO_POINTER(pid));
+
+		msg.pid = pid;
+		msg.status = status;
+		send_msg(fd, &msg, NULL, 0);
+	}
+}
+
+/*
+ * launcher_main:
+ *
+ * The loop of the launcher process, which serves the requests of the daemon
+ * through @fd until it is closed.
+ */
+static void
+launcher_main(gint fd)
+{
+	struct sigaction act;
+	sigset_t mask;
+	gchar **env;
+
+	/* The handlers of the daemon were inherited */
+	memset(&act, 0, sizeof(act));
+	act.sa_handler = SIG_DFL;
+	sigaction(SIGTERM, &act, NULL);
+	sigaction(SIGINT, &act, NULL);
+	sigaction(SIGSEGV, &act, NULL);
+	act.sa_handler = SIG_IGN;
+	sigaction(SIGPIPE, &act, NULL);
+
+	if (pipe(wakeup_pipe) == -1)
+		_exit(1);
+	fcntl(wakeup_pipe[0], F_SETFL, O_NONBLOCK);
+	fcntl(wakeup_pipe[1], F_SETFL, O_NONBLOCK);
+
+	/* Not to be inherited by the login shells reading the environment, or
+	 * what their profile leaves in background would keep the socket open
+	 * after the launcher exits */
+	fcntl(fd, F_SETFD, FD_CLOEXEC);
+	fcntl(wakeup_pipe[0], F_SETFD, FD_CLOEXEC);
+	fcntl(wakeup_pipe[1], F_SETFD, FD_CLOEXEC);
+
+	act.sa_handler = on_signal;
+	act.sa_flags = SA_NOCLDSTOP;
+	sigaction(SIGCHLD, &act, NULL);
+	sigaction(SIGHUP, &act, NULL);
+
+	sigemptyset(&mask);
+	sigprocmask(SIG_SETMASK, &mask, NULL);
+
+	env = read_environment();
+	run_pipes = g_hash_table_new(NULL, NULL);
+
+	for (;;) {
+		struct pollfd fds[2] = {
+			{ fd, POLLIN, 0 },
+			{ wakeup_pipe[0], POLLIN, 0 },
+		};
+
+		launcher_reap(fd);
+
+		if (poll(fds, 2, -1) == -1)
+			continue;
+
+		if (fds[1].revents) {
+			gchar buf[64];
+			while (read(wakeup_pipe[0], buf, sizeof(buf)) > 0);
+		}
+
+		/* Checked after waking up, so a refresh asked for right before a
+		 * request already applies to it */
+		if (refresh_requested) {
+			refresh_requested = 0;
+			g_strfreev(env);
+			env = read_environment();
+		}
+
+		if (!fds[0].revents)
+			continue;
+
+		LauncherMsg msg;
+		gint job_fds[MAX_FDS];
+		gint nfds;
+
+		if (!recv_msg(fd, &msg, job_fds, &nfds))
+			_exit(0);
+
+		gchar *script = g_malloc(msg.len + 1);
+		if (!read_all(fd, script, msg.len))
+			_exit(0);
+		script[msg.len] = '\0';
+
+		LauncherMsg reply = { MSG_SPAWNED, -1, EINVAL, 0, 0 };
+		if (msg.type == MSG_SPAWN && nfds == 3) {
+			reply.pid = launcher_spawn(fd, env, script, job_fds);
+			reply.status = reply.pid == -1 ? errno : 0;
+		} else if (msg.type == MSG_RUN && nfds == 4 && msg.run_len <= msg.len) {
+			/* Without the login environment, bash is left to run it */
+			GebrdPipeline *pipeline = env ? gebrd_pipeline_deserialize(script, msg.run_len) : NULL;
+			if (pipeline) {
+				guint npipes = gebrd_pipeline_count_pipes(pipeline);
+
+				pipeline->pipe_size = gebrd_pipeline_pipe_size(open_pipes + npipes);
+				reply.pid = launcher_run(fd, env, pipeline, job_fds);
+				if (reply.pid > 0 && npipes) {
+					g_hash_table_insert(run_pipes, GINT_TO_POINTER(reply.pid), GUINT_TO_POINTER(npipes));
+					open_pipes += npipes;
+				}
+				gebrd_pipeline_free(pipeline);
+			} else {
+				/* No status is written for the script */
+				close(job_fds[3]);
+				job_fds[3] = -1;
+				reply.pid = launcher_spawn(fd, env, script + msg.run_len, job_fds);
+			}
+			reply.status = reply.pid == -1 ? errno : 0;
+		}
+		for (gint i = 0; i < nfds; i++)
+			if (job_fds[i] != -1)
+				close(job_fds[i]);
+		g_free(script);
+
+		send_msg(fd, &reply, NULL, 0);
+	}
+}
+
+/* Daemon side {{{1 */
+
+static gboolean
+is_process(gpointer pid, gpointer process, gpointer finalized)
+{
+	return process == finalized;
+}
+
+static void
+forget_exit(LauncherExit *ex, GObject *finalized)
+{
+	if (ex->process == (GebrCommProcess *) finalized)
+		ex->process = NULL;
+}
+
+static void
+on_process_finalized(GebrdLauncher *launcher,
+		     GObject *finalized)
+{
+	GList *request;
+
+	g_hash_table_foreach_remove(launcher->processes, is_process, finalized);
+	while ((request = g_queue_find(launcher->requests, finalized)) != NULL)
+		request->data = NULL;
+	g_queue_foreach(launcher->exited, (GFunc) forget_exit, finalized);
+}
+
+static gboolean
+dispatch_exited(GebrdLauncher *launcher)
+{
+	LauncherExit *ex;
+
+	launcher->exited_source = 0;
+
+	while ((ex = g_queue_pop_head(launcher->exited)) != NULL) {
+		GebrCommProcess *process = ex->process;
+
+		if (!process && ex->pid > 0) {
+			process = g_hash_table_lookup(launcher->processes, GINT_TO_POINTER(ex->pid));
+			g_hash_table_remove(launcher->processes, GINT_TO_POINTER(ex->pid));
+		}
+		if (process) {
+			g_object_weak_unref(G_OBJECT(process), (GWeakNotify) on_process_finalized, launcher);
+			gebr_comm_process_adopted_finished(process, ex->status);
+		}
+		g_free(ex);
+	}
+
+	return FALSE;
+}
+
+/*
+ * queue_exited:
+ * @process: the process which did not start, or %NULL for the one of @pid
+ *
+ * Reports the exit of a process from the main loop, so the "finished"
+ * signal is not emitted from within a request.
+ */
+static void
+queue_exited(GebrdLauncher *launcher, GPid pid, gint status, GebrCommProcess *process)
+{
+	LauncherExit *ex = g_new(LauncherExit, 1);
+
+	ex->pid = pid;
+	ex->status = status;
+	ex->process = process;
+	g_queue_push_tail(launcher->exited, ex);
+
+	if (!launcher->exited_source)
+		launcher->exited_source = g_idle_add((GSourceFunc) dispatch_exited, launcher);
+}
+
+static void
+kill_process(gpointer pid, gpointer process, GebrdLauncher *launcher)
+{
+	killpg(GPOINTER_TO_INT(pid), SIGKILL);
+	queue_exited(launcher, GPOINTER_TO_INT(pid), SIGKILL, NULL);
+}
+
+/*
+ * launcher_died:
+ *
+ * Kills the processes whose exit could not be reported anymore, as they can
+ * not be waited for, and makes the next jobs start without the launcher.
+ * The processes not started yet, or whose pid was not received, end as if
+ * killed.
+ */
+static void
+launcher_died(GebrdLauncher *launcher)
+{
+	GebrCommProcess *process;
+
+	g_warning("The job launcher exited, jobs will be started by login shells");
+
+	if (launcher->watch_id) {
+		g_source_remove(launcher->watch_id);
+		launcher->watch_id = 0;
+	}
+	close(launcher->fd);
+	launcher->fd = -1;
+
+	g_hash_table_foreach(launcher->processes, (GHFunc) kill_process, launcher);
+	while (!g_queue_is_empty(launcher->requests))
+		if ((process = g_queue_pop_head(launcher->requests)) != NULL)
+			queue_exited(launcher, 0, SIGKILL, process);
+}
+
+/*
+ * launcher_spawned:
+ *
+ * Handles the reply to the oldest request: the process gets its @pid, or
+ * ends as bash does for a command it can not run.
+ */
+static void
+launcher_spawned(GebrdLauncher *launcher, GPid pid, gint error)
+{
+	GebrCommProcess *process;
+
+	if (g_queue_is_empty(launcher->requests))
+		return;
+
+	/* If it was finalized, the job is left running */
+	process = g_queue_pop_head(launcher->requests);
+	if (!process)
+		return;
+
+	if (pid == -1) {
+		g_warning("The job launcher could not start a job: %s", g_strerror(error));
+		queue_exited(launcher, 0, 127 << 8, process);
+		return;
+	}
+
+	gebr_comm_process_adopted_started(process, pid);
+	g_hash_table_insert(launcher->processes, GINT_TO_POINTER(pid), process);
+}
+
+static gboolean
+on_launcher_read(GIOChannel *channel,
+		 GIOCondition condition,
+		 GebrdLauncher *launcher)
+{
+	LauncherMsg msg;
+
+	if (!recv_msg(launcher->fd, &msg, NULL, NULL)) {
+		launcher->watch_id = 0;
+		launcher_died(launcher);
+		return FALSE;
+	}
+
+	/* The exit of a process is always sent after its pid */
+	if (msg.type == MSG_SPAWNED)
+		launcher_spawned(launcher, msg.pid, msg.status);
+	else if (msg.type == MSG_EXITED)
+		queue_exited(launcher, msg.pid, msg.status, NULL);
+
+	return TRUE;
+}
+
+GebrdLauncher *
+gebrd_launcher_new(void)
+{
+	GebrdLauncher *launcher;
+	gint sv[2];
+	GPid pid;
+
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == -1) {
+		g_warning("Could not start the job launcher: %s", g_strerror(errno));
+		return NULL;
+	}
+
+	pid = fork();
+	if (pid == -1) {
+		g_warning("Could not start the job launcher: %s", g_strerror(errno));
+		close(sv[0]);
+		close(sv[1]);
+		return NULL;
+	}
+	if (pid == 0) {
+		close(sv[0]);
+		launcher_main(sv[1]);
+	}
+
+	close(sv[1]);
+	fcntl(sv[0], F_SETFD, FD_CLOEXEC);
+
+	launcher = g_new0(GebrdLauncher, 1);
+	launcher->pid = pid;
+	launcher->fd = sv[0];
+	launcher->processes = g_hash_table_new(NULL, NULL);
+	launcher->requests = g_queue_new();
+	launcher->exited = g_queue_new();
+	launcher->channel = g_io_channel_unix_new(launcher->fd);
+	launcher->watch_id = g_io_add_watch(launcher->channel, G_IO_IN | G_IO_HUP | G_IO_ERR,
+					    (GIOFunc) on_launcher_read, launcher);
+
+	return launcher;
+}
+
+/*
+ * launcher_request:
+ * @run_len: the length of the pipeline before the script of %MSG_RUN
+ * @status_fd: if not %NULL, a pipe is sent as the fourth descriptor and its
+ * read end is returned here
+ *
+ * Sends a request to start a job, with @len bytes of @data, and adopts the
+ * job in @process. Its pid is set when the launcher replies, see
+ * launcher_spawned(), so the daemon is not held while the launcher reads
+ * the environment again.
+ */
+static gboolean
+launcher_request(GebrdLauncher *launcher,
+		 GebrCommProcess *process,
+		 gint type,
+		 const gchar *data,
+		 gsize len,
+		 gsize run_len,
+		 gint *status_fd)
+{
+	gint in[2], out[2], err[2], status[2] = { -1, -1 };
+	LauncherMsg msg = { type, 0, 0, len, run_len };
+	gboolean sent;
+
+	if (launcher->fd == -1)
+		return FALSE;
+
+	if (status_fd && pipe(status) == -1)
+		return FALSE;
+
+	if (pipe(in) == -1) {
+		close(status[0]);
+		close(status[1]);
+		return FALSE;
+	}
+	if (pipe(out) == -1) {
+		close(status[0]);
+		close(status[1]);
+		close(in[0]);
+		close(in[1]);
+		return FALSE;
+	}
+	if (pipe(err) == -1) {
+		close(status[0]);
+		close(status[1]);
+		close(in[0]);
+		close(in[1]);
+		close(out[0]);
+		close(out[1]);
+		return FALSE;
+	}
+
+	gint fds[MAX_FDS] = { in[0], out[1], err[1], status[1] };
+	sent = send_msg(launcher->fd, &msg, fds, status_fd ? 4 : 3) && write_all(launcher->fd, data, len);
+	close(in[0]);
+	close(out[1]);
+	close(err[1]);
+	if (status_fd)
+		close(status[1]);
+
+	if (!sent) {
+		launcher_died(launcher);
+		close(in[1]);
+		close(out[0]);
+		close(err[0]);
+		if (status_fd)
+			close(status[0]);
+		return FALSE;
+	}
+
+	if (status_fd)
+		*status_fd = status[0];
+	gebr_comm_process_adopt(process, 0, in[1], out[0], err[0]);
+	g_queue_push_tail(launcher->requests, process);
+	g_object_weak_ref(G_OBJECT(process), (GWeakNotify) on_process_finalized, launcher);
+
+	return TRUE;
+}
+
+gboolean
+gebrd_launcher_spawn(GebrdLauncher *launcher,
+		     GebrCommProcess *process,
+		     const gchar *script)
+{
+	return launcher_request(launcher, process, MSG_SPAWN, script, strlen(script), 0, NULL);
+}
+
+gboolean
+gebrd_launcher_run(GebrdLauncher *launcher,
+		   GebrCommProcess *process,
+		   GebrdPipeline *pipeline,
+		   const gchar *script,
+		   gint *status_fd)
+{
+	GString *buf = g_string_new(NULL);
+	gsize run_len;
+	gboolean started;
+
+	gebrd_pipeline_serialize(pipeline, buf);
+	run_len = buf->len;
+	g_string_append(buf, script);
+	started = launcher_request(launcher, process, MSG_RUN, buf->str, buf->len, run_len, status_fd);
+	g_string_free(buf, TRUE);
+
+	return started;
+}
+
+void
+gebrd_launcher_refresh(GebrdLauncher *launcher)
+{
+	kill(launcher->pid, SIGHUP);
+}
+
+static void
+unref_process(gpointer pid, GObject *process, GebrdLauncher *launcher)
+{
+	g_object_weak_unref(process, (GWeakNotify) on_process_finalized, launcher);
+}
+
+static void
+unref_request(GebrCommProcess *process, GebrdLauncher *launcher)
+{
+	if (process)
+		g_object_weak_unref(G_OBJECT(process), (GWeakNotify) on_process_finalized, launcher);
+}
+
+static void
+free_exit(LauncherExit *ex, GebrdLauncher *launcher)
+{
+	unref_request(ex->process, launcher);
+	g_free(ex);
+}
+
+void
+gebrd_launcher_free(GebrdLauncher *launcher)
+{
+	/* The launcher exits once its socket is closed */
+	if (launcher->watch_id)
+		g_source_remove(launcher->watch_id);
+	if (launcher->fd != -1)
+		close(launcher->fd);
+	g_io_channel_unref(launcher->channel);
+
+	if (launcher->exited_source)
+		g_source_remove(launcher->exited_source);
+	g_queue_foreach(launcher->exited, (GFunc) free_exit, launcher);
+	g_queue_free(launcher->exited);
+	g_queue_foreach(launcher->requests, (GFunc) unref_request, launcher);
+	g_queue_free(launcher->requests);
+
+	g_hash_table_foreach(launcher->processes, (GHFunc) unref_process, launcher);
+	g_hash_table_destroy(launcher->processes);
+	g_free(launcher);
+}
@@ -0,0 +1,99 @@
+/*   GeBR Daemon - Process and control execution of flows
+ *   Copyright (C) 2007-2012 GeBR core team (http://www.gebrproject.com/)
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GEBRD_LAUNCHER_H__
+#define __GEBRD_LAUNCHER_H__
+
+#include <glib.h>
+#include <libgebr/comm/gebr-comm-process.h>
+
+#include "gebrd-pipeline.h"
+
+G_BEGIN_DECLS
+
+/**
+ * GebrdLauncher:
+ *
+ * A process forked by the daemon which reads the login environment of the
+ * user once and starts the jobs with it, instead of a login shell for each
+ * of them. The environment is only read again on gebrd_launcher_refresh().
+ */
+typedef struct _GebrdLauncher GebrdLauncher;
+
+/**
+ * gebrd_launcher_new:
+ *
+ * Forks the launcher. Must be called before any thread is started.
+ *
+ * Returns: the launcher, or %NULL if it could not be started.
+ */
+GebrdLauncher *gebrd_launcher_new(void);
+
+/**
+ * gebrd_launcher_spawn:
+ * @script: a bash script
+ *
+ * Runs @script, in a new process group, with the environment of the launcher
+ * and watches it with @process. The request is not waited for: @process is
+ * running from now on, and gets its pid once the launcher started it. The
+ * "finished" signal of @process is emitted when the launcher reports its
+ * exit, with the status 127 if it could not be started.
+ *
+ * Returns: %FALSE if the request could not be sent, in which case
+ * gebr_comm_process_start() should be used instead.
+ */
+gboolean gebrd_launcher_spawn(GebrdLauncher *launcher,
+			      GebrCommProcess *process,
+			      const gchar *script);
+
+/**
+ * gebrd_launcher_run:
+ * @pipeline: a resolved pipeline, see gebrd_pipeline_resolve()
+ * @script: the bash script run instead if the launcher can not run @pipeline
+ * @status_fd: returns the read end of a pipe with the status of each stage,
+ * in the format of gebrd_pipeline_run(), which the caller closes
+ *
+ * Runs @pipeline without a shell, like gebrd_launcher_spawn() would run
+ * @script. Nothing is written to @status_fd if @script is run.
+ *
+ * Returns: %FALSE if the request could not be sent, see
+ * gebrd_launcher_spawn().
+ */
+gboolean gebrd_launcher_run(GebrdLauncher *launcher,
+			    GebrCommProcess *process,
+			    GebrdPipeline *pipeline,
+			    const gchar *script,
+			    gint *status_fd);
+
+/**
+ * gebrd_launcher_refresh:
+ *
+ * Makes @launcher read the login environment again, for the jobs started
+ * from now on. Safe to call from a signal handler.
+ */
+void gebrd_launcher_refresh(GebrdLauncher *launcher);
+
+/**
+ * gebrd_launcher_free:
+ *
+ * Stops @launcher. The jobs it started keep running.
+ */
+void gebrd_launcher_free(GebrdLauncher *launcher);
+
+G_END_DECLS
+
+#endif /* __GEBRD_LAUNCHER_H__ */
@@ -50,6 +50,8 @@ int main(int argc, char **argv)
 	GOptionContext *context;
 
 	g_type_init();
+	if (!g_thread_supported())
+		g_thread_init(NULL);
 
 	gebr_libinit(GETTEXT_PACKAGE);
 	gebr_geoxml_init();
@@ -0,0 +1,577 @@
+/*   GeBR Daemon - Process and control execution of flows
+ *   Copyright (C) 2007-2012 GeBR core team (http://www.gebrproject.com/)
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "gebrd-pipeline.h"
+
+/* The size asked for the pipes between the stages while few are open, 16
+ * times the default on Linux, so a stage writing in bursts stalls less on a
+ * slower reader. It is the largest size an unprivileged process gets by
+ * default. */
+#define PIPE_SIZE (1024 * 1024)
+#define PIPE_DEFAULT_SIZE (64 * 1024)
+
+/* What the enlarged pipes of all runs may take together. Once the pipes of a
+ * user take 64 MiB (pipe-user-pages-soft), Linux refuses to enlarge them and
+ * gives new ones a single page, so a quarter of it is left to the runs. */
+#define PIPE_BUDGET (16 * 1024 * 1024)
+
+/* How deep a string variable may refer to other string variables */
+#define MAX_DEPTH 16
+
+/* Characters bash would interpret outside of quotes */
+#define SHELL_SPECIAL "$`\\*?[]~;&|<>(){}#!\n"
+
+GebrdPipeline *
+gebrd_pipeline_new(gint nice)
+{
+	GebrdPipeline *pipeline = g_new(GebrdPipeline, 1);
+
+	pipeline->stages = g_ptr_array_new();
+	pipeline->nice = nice;
+	pipeline->pipe_size = 0;
+
+	return pipeline;
+}
+
+GebrdStage *
+gebrd_pipeline_add_stage(GebrdPipeline *pipeline,
+			 const gchar *title,
+			 const gchar *words)
+{
+	GebrdStage *stage = g_new0(GebrdStage, 1);
+
+	stage->title = g_strdup(title);
+	stage->words = g_strdup(words);
+	g_ptr_array_add(pipeline->stages, stage);
+
+	return stage;
+}
+
+static void
+stage_free(GebrdStage *stage)
+{
+	g_free(stage->title);
+	g_free(stage->words);
+	g_strfreev(stage->argv);
+	g_free(stage->in);
+	g_free(stage->out);
+	g_free(stage->err);
+	g_free(stage);
+}
+
+void
+gebrd_pipeline_free(GebrdPipeline *pipeline)
+{
+	if (!pipeline)
+		return;
+
+	g_ptr_array_foreach(pipeline->stages, (GFunc) stage_free, NULL);
+	g_ptr_array_free(pipeline->stages, TRUE);
+	g_free(pipeline);
+}
+
+/* Resolution {{{1 */
+
+/*
+ * substitute:
+ *
+ * Returns: @str with its `${name}' and `${V[i]}' replaced by their values, or
+ * %NULL if a variable is unknown or its value would be reinterpreted by the
+ * quotes around it.
+ */
+static gchar *
+substitute(const gchar *str, GHashTable *vars, gchar **values, gint depth)
+{
+	GString *buf;
+
+	if (depth > MAX_DEPTH)
+		return NULL;
+
+	buf = g_string_new(NULL);
+	while (*str) {
+		if (str[0] != '$' || str[1] != '{') {
+			g_string_append_c(buf, *str++);
+			continue;
+		}
+
+		const gchar *end = strchr(str, '}');
+		if (!end)
+			goto err;
+
+		gchar *name = g_strndup(str + 2, end - str - 2);
+		const gchar *value = NULL;
+		gchar *tail;
+
+		if (g_str_has_prefix(name, "V[")) {
+			guint64 i = g_ascii_strtoull(name + 2, &tail, 10);
+			if (tail != name + 2 && g_strcmp0(tail, "]") == 0
+			    && values && i < g_strv_length(values))
+				value = values[i];
+		} else if (vars)
+			value = g_hash_table_lookup(vars, name);
+		g_free(name);
+
+		if (!value || strpbrk(value, "\"'\\`"))
+			goto err;
+
+		gchar *expanded = substitute(value, vars, values, depth + 1);
+		if (!expanded)
+			goto err;
+		g_string_append(buf, expanded);
+		g_free(expanded);
+
+		str = end + 1;
+	}
+
+	return g_string_free(buf, FALSE);
+
+err:
+	g_string_free(buf, TRUE);
+	return NULL;
+}
+
+/*
+ * split_words:
+ *
+ * Splits @words into arguments, if it has nothing but quotes for bash to
+ * interpret.
+ *
+ * Returns: the arguments, or %NULL.
+ */
+static gchar **
+split_words(const gchar *words)
+{
+	gchar quote = 0;
+	gchar **argv;
+
+	for (const gchar *p = words; *p; p++) {
+		if (quote == '\'') {
+			if (*p == '\'')
+				quote = 0;
+		} else if (quote == '"') {
+			if (*p == '"')
+				quote = 0;
+			else if (*p == '$' || *p == '`')
+				return NULL;
+			else if (*p == '\\' && p[1])
+				p++;
+		} else if (*p == '\'' || *p == '"')
+			quote = *p;
+		else if (strchr(SHELL_SPECIAL, *p))
+			return NULL;
+	}
+
+	if (quote || !g_shell_parse_argv(words, NULL, &argv, NULL))
+		return NULL;
+
+	return argv;
+}
+
+/*
+ * resolve_file:
+ *
+ * Sets @resolved to the name of a file written in double quotes on the command
+ * line, with its variables replaced, or to %NULL if @file is %NULL.
+ *
+ * Returns: %FALSE if the name needs bash.
+ */
+static gboolean
+resolve_file(const gchar *file, GHashTable *vars, gchar **values, gchar **resolved)
+{
+	gchar *str, *words;
+	gchar **argv;
+
+	*resolved = NULL;
+	if (!file)
+		return TRUE;
+
+	str = substitute(file, vars, values, 0);
+	if (!str)
+		return FALSE;
+	words = g_strdup_printf("\"%s\"", str);
+	argv = split_words(words);
+	g_free(words);
+	g_free(str);
+
+	if (!argv || g_strv_length(argv) != 1) {
+		g_strfreev(argv);
+		return FALSE;
+	}
+
+	*resolved = g_strdup(argv[0]);
+	g_strfreev(argv);
+	return TRUE;
+}
+
+GebrdPipeline *
+gebrd_pipeline_resolve(GebrdPipeline *pipeline,
+		       GHashTable *vars,
+		       gchar **values)
+{
+	GebrdPipeline *resolved = gebrd_pipeline_new(pipeline->nice);
+
+	for (guint i = 0; i < pipeline->stages->len; i++) {
+		GebrdStage *stage = g_ptr_array_index(pipeline->stages, i);
+		GebrdStage *copy = gebrd_pipeline_add_stage(resolved, stage->title, NULL);
+		gchar *words = substitute(stage->words, vars, values, 0);
+
+		copy->out_append = stage->out_append;
+		copy->err_append = stage->err_append;
+		copy->pipe_to_next = stage->pipe_to_next;
+
+		if (words)
+			copy->argv = split_words(words);
+		g_free(words);
+
+		if (!copy->argv || !copy->argv[0]
+		    || !resolve_file(stage->in, vars, values, &copy->in)
+		    || !resolve_file(stage->out, vars, values, &copy->out)
+		    || !resolve_file(stage->err, vars, values, &copy->err)) {
+			gebrd_pipeline_free(resolved);
+			return NULL;
+		}
+	}
+
+	return resolved;
+}
+
+/* Serialization {{{1 */
+
+static void
+append_field(GString *buf, const gchar *str)
+{
+	g_string_append(buf, str);
+	g_string_append_c(buf, '\0');
+}
+
+/* Optional strings are prefixed by '+', or are just '-' if unset */
+static void
+append_optional(GString *buf, const gchar *str)
+{
+	g_string_append_c(buf, str ? '+' : '-');
+	append_field(buf, str ? str : "");
+}
+
+void
+gebrd_pipeline_serialize(GebrdPipeline *pipeline,
+			 GString *buf)
+{
+	gchar *num;
+
+	num = g_strdup_printf("%d", pipeline->nice);
+	append_field(buf, num);
+	g_free(num);
+
+	num = g_strdup_printf("%u", pipeline->stages->len);
+	append_field(buf, num);
+	g_free(num);
+
+	for (guint i = 0; i < pipeline->stages->len; i++) {
+		GebrdStage *stage = g_ptr_array_index(pipeline->stages, i);
+		guint argc = g_strv_length(stage->argv);
+
+		append_field(buf, stage->title ? stage->title : "");
+		append_optional(buf, stage->in);
+		append_optional(buf, stage->out);
+		append_optional(buf, stage->err);
+
+		num = g_strdup_printf("%d%d%d%u", stage->out_append ? 1 : 0, stage->err_append ? 1 : 0,
+				      stage->pipe_to_next ? 1 : 0, argc);
+		append_field(buf, num);
+		g_free(num);
+
+		for (guint j = 0; j < argc; j++)
+			append_field(buf, stage->argv[j]);
+	}
+}
+
+typedef struct {
+	const gchar *p;
+	const gchar *end;
+} Reader;
+
+static const gchar *
+read_field(Reader *reader)
+{
+	const gchar *field = reader->p;
+	const gchar *nul;
+
+	if (!field || field >= reader->end)
+		return NULL;
+
+	nul = memchr(field, '\0', reader->end - field);
+	reader->p = nul ? nul + 1 : NULL;
+
+	return nul ? field : NULL;
+}
+
+static gboolean
+read_optional(Reader *reader, gchar **str)
+{
+	const gchar *field = read_field(reader);
+
+	if (!field || (*field != '+' && *field != '-'))
+		return FALSE;
+	*str = *field == '+' ? g_strdup(field + 1) : NULL;
+
+	return TRUE;
+}
+
+GebrdPipeline *
+gebrd_pipeline_deserialize(const gchar *data,
+			   gsize len)
+{
+	Reader reader = { data, data + len };
+	GebrdPipeline *pipeline;
+	const gchar *field;
+	guint n;
+
+	if (!(field = read_field(&reader)))
+		return NULL;
+	pipeline = gebrd_pipeline_new(atoi(field));
+
+	if (!(field = read_field(&reader)))
+		goto err;
+	n = strtoul(field, NULL, 10);
+
+	for (guint i = 0; i < n; i++) {
+		if (!(field = read_field(&reader)))
+			goto err;
+
+		GebrdStage *stage = gebrd_pipeline_add_stage(pipeline, field, NULL);
+
+		if (!read_optional(&reader, &stage->in)
+		    || !read_optional(&reader, &stage->out)
+		    || !read_optional(&reader, &stage->err))
+			goto err;
+
+		if (!(field = read_field(&reader)) || strlen(field) < 4)
+			goto err;
+		stage->out_append = field[0] == '1';
+		stage->err_append = field[1] == '1';
+		stage->pipe_to_next = field[2] == '1';
+
+		guint argc = strtoul(field + 3, NULL, 10);
+		if (!argc)
+			goto err;
+		stage->argv = g_new0(gchar *, argc + 1);
+		for (guint j = 0; j < argc; j++) {
+			if (!(field = read_field(&reader)))
+				goto err;
+			stage->argv[j] = g_strdup(field);
+		}
+	}
+
+	return pipeline;
+
+err:
+	gebrd_pipeline_free(pipeline);
+	return NULL;
+}
+
+/* Execution {{{1 */
+
+static void
+redirect(const gchar *file, gint flags, gint target)
+{
+	gint fd = open(file, flags, 0666);
+
+	if (fd == -1) {
+		fprintf(stderr, "%s: %s\n", file, strerror(errno));
+		_exit(1);
+	}
+	if (fd != target) {
+		dup2(fd, target);
+		close(fd);
+	}
+}
+
+static gint
+write_flags(gboolean append)
+{
+	return O_WRONLY | O_CREAT | (append ? O_APPEND : O_TRUNC);
+}
+
+/*
+ * start_stage:
+ * @in: the read end of the pipe from the previous stage, or -1
+ * @out: the write end of the pipe to the next stage, or -1
+ * @unused: the read end of the pipe to the next stage, or -1
+ *
+ * Returns: the pid, or -1.
+ */
+static GPid
+start_stage(GebrdPipeline *pipeline, GebrdStage *stage,
+	    gint in, gint out, gint unused, gint status_fd)
+{
+	GPid pid = fork();
+
+	if (pid != 0)
+		return pid;
+
+	if (in != -1)
+		dup2(in, 0);
+	else if (stage->in)
+		redirect(stage->in, O_RDONLY, 0);
+	if (out != -1)
+		dup2(out, 1);
+	else if (stage->out)
+		redirect(stage->out, write_flags(stage->out_append), 1);
+	if (stage->err)
+		redirect(stage->err, write_flags(stage->err_append), 2);
+
+	gint fds[] = { in, out, unused, status_fd };
+	for (guint i = 0; i < G_N_ELEMENTS(fds); i++)
+		if (fds[i] > 2)
+			close(fds[i]);
+
+	if (pipeline->nice && nice(pipeline->nice) == -1)
+		; /* runs with the niceness it has */
+
+	execvp(stage->argv[0], stage->argv);
+	fprintf(stderr, "%s: %s\n", stage->argv[0], strerror(errno));
+	_exit(errno == ENOENT ? 127 : 126);
+}
+
+static void
+report_status(gint status_fd, guint stage, gint status)
+{
+	gchar line[32];
+	gint len;
+
+	if (status_fd == -1)
+		return;
+
+	len = snprintf(line, sizeof(line), "%u %d\n", stage, status);
+	while (write(status_fd, line, len) == -1 && errno == EINTR);
+}
+
+gint
+gebrd_pipeline_run(GebrdPipeline *pipeline,
+		   gint status_fd)
+{
+	guint n = pipeline->stages->len;
+	GPid *pids = g_new(GPid, n);
+	gint (*pipes)[2] = g_new(gint[2], n);
+	gint no_pipe[2] = { -1, -1 };
+	gint code = 0;
+	guint first = 0;
+
+	while (first < n) {
+		guint last = first;
+		gint in = -1;
+
+		while (last + 1 < n && ((GebrdStage *) g_ptr_array_index(pipeline->stages, last))->pipe_to_next)
+			last++;
+
+		/* All pipes are created first, so no stage is left without its
+		 * reader or writer. They are closed on exec, so each stage only
+		 * keeps the ends it was given. */
+		for (guint i = first; i < last; i++) {
+			if (pipe(pipes[i]) == -1) {
+				perror("pipe");
+				while (i-- > first) {
+					close(pipes[i][0]);
+					close(pipes[i][1]);
+				}
+				report_status(status_fd, first, 126 << 8);
+				code = 126;
+				goto out;
+			}
+			fcntl(pipes[i][0], F_SETFD, FD_CLOEXEC);
+			fcntl(pipes[i][1], F_SETFD, FD_CLOEXEC);
+#ifdef F_SETPIPE_SZ
+			if (pipeline->pipe_size)
+				fcntl(pipes[i][1], F_SETPIPE_SZ, pipeline->pipe_size);
+#endif
+		}
+
+		for (guint i = first; i <= last; i++) {
+			GebrdStage *stage = g_ptr_array_index(pipeline->stages, i);
+			gint *p = i < last ? pipes[i] : no_pipe;
+
+			pids[i] = start_stage(pipeline, stage, in, p[1], p[0], status_fd);
+			if (pids[i] == -1)
+				perror("fork");
+
+			if (in != -1)
+				close(in);
+			if (p[1] != -1)
+				close(p[1]);
+			in = p[0];
+		}
+
+		for (guint i = first; i <= last; i++) {
+			gint status = 127 << 8;
+
+			if (pids[i] != -1)
+				while (waitpid(pids[i], &status, 0) == -1 && errno == EINTR);
+			report_status(status_fd, i, status);
+
+			if (WIFEXITED(status))
+				code = WEXITSTATUS(status);
+			else if (WIFSIGNALED(status))
+				code = 128 + WTERMSIG(status);
+		}
+
+		first = last + 1;
+	}
+
+out:
+	g_free(pipes);
+	g_free(pids);
+	return code;
+}
+
+guint
+gebrd_pipeline_count_pipes(GebrdPipeline *pipeline)
+{
+	guint n = 0;
+
+	for (guint i = 0; i + 1 < pipeline->stages->len; i++)
+		if (((GebrdStage *) g_ptr_array_index(pipeline->stages, i))->pipe_to_next)
+			n++;
+
+	return n;
+}
+
+gint
+gebrd_pipeline_pipe_size(guint open_pipes)
+{
+	gsize size = open_pipes ? PIPE_BUDGET / open_pipes : PIPE_SIZE;
+	gsize rounded = PIPE_DEFAULT_SIZE;
+
+	if (size >= PIPE_SIZE)
+		return PIPE_SIZE;
+
+	/* Linux rounds the size up to a power of two pages */
+	while (rounded * 2 <= size)
+		rounded *= 2;
+
+	return rounded > PIPE_DEFAULT_SIZE ? rounded : 0;
+}
@@ -0,0 +1,152 @@
+/*   GeBR Daemon - Process and control execution of flows
+ *   Copyright (C) 2007-2012 GeBR core team (http://www.gebrproject.com/)
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GEBRD_PIPELINE_H__
+#define __GEBRD_PIPELINE_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/**
+ * GebrdStage:
+ * @title: the title of the program, for messages
+ * @words: the program and its parameters as shell words, which may refer to
+ * the variables of the dictionary, see gebrd_pipeline_resolve()
+ * @argv: the resolved arguments
+ * @in: a file for the standard input, or %NULL
+ * @out: a file for the standard output, or %NULL
+ * @out_append: whether @out is appended to instead of truncated
+ * @err: a file for the standard error, or %NULL
+ * @err_append: whether @err is appended to instead of truncated
+ * @pipe_to_next: whether the standard output goes to the next stage, or the
+ * next stage only starts after this one exited
+ *
+ * A program of a flow. The file names may refer to the dictionary too.
+ */
+typedef struct {
+	gchar *title;
+	gchar *words;
+	gchar **argv;
+	gchar *in;
+	gchar *out;
+	gboolean out_append;
+	gchar *err;
+	gboolean err_append;
+	gboolean pipe_to_next;
+} GebrdStage;
+
+/**
+ * GebrdPipeline:
+ * @stages: the #GebrdStage of each program, in order
+ * @nice: the niceness added to every program
+ * @pipe_size: the size asked for the pipes between the stages, or 0 to keep
+ * the default; see gebrd_pipeline_pipe_size()
+ *
+ * The programs of a flow, run without a shell.
+ */
+typedef struct {
+	GPtrArray *stages;
+	gint nice;
+	gint pipe_size;
+} GebrdPipeline;
+
+GebrdPipeline *gebrd_pipeline_new(gint nice);
+
+/**
+ * gebrd_pipeline_add_stage:
+ *
+ * Returns: a new stage at the end of @pipeline, whose fields are set by the
+ * caller with newly allocated strings.
+ */
+GebrdStage *gebrd_pipeline_add_stage(GebrdPipeline *pipeline,
+				     const gchar *title,
+				     const gchar *words);
+
+/**
+ * gebrd_pipeline_resolve:
+ * @vars: the values of the string variables, by name, referred as `${name}'
+ * @values: the values of the numeric variables, referred as `${V[i]}'
+ *
+ * Replaces the variables in the words and file names of @pipeline and splits
+ * the words into arguments, as bash would.
+ *
+ * Returns: a new pipeline, or %NULL if @pipeline needs more than variables
+ * and quotes from the shell, in which case it must be run by bash.
+ */
+GebrdPipeline *gebrd_pipeline_resolve(GebrdPipeline *pipeline,
+				      GHashTable *vars,
+				      gchar **values);
+
+/**
+ * gebrd_pipeline_serialize:
+ *
+ * Appends the resolved @pipeline to @buf, see gebrd_pipeline_deserialize().
+ */
+void gebrd_pipeline_serialize(GebrdPipeline *pipeline,
+			      GString *buf);
+
+/**
+ * gebrd_pipeline_deserialize:
+ *
+ * Returns: the pipeline serialized in the @len bytes of @data, or %NULL if
+ * they are malformed.
+ */
+GebrdPipeline *gebrd_pipeline_deserialize(const gchar *data,
+					  gsize len);
+
+/**
+ * gebrd_pipeline_run:
+ * @status_fd: where a line with the index and waitpid() status of each stage
+ * is written when it exits, or -1
+ *
+ * Runs the resolved @pipeline and waits for it. The stages are connected by
+ * pipes of @pipeline->pipe_size bytes and inherit the standard streams not
+ * redirected to files. Must only be called in a process forked to run it.
+ *
+ * If the pipes of a group of chained stages cannot be created, none of them
+ * is started and the run is aborted, with the status of the first stage of
+ * the group set to 126.
+ *
+ * Returns: the exit code of the last stage, as bash would return it.
+ */
+gint gebrd_pipeline_run(GebrdPipeline *pipeline,
+			gint status_fd);
+
+/**
+ * gebrd_pipeline_count_pipes:
+ *
+ * Returns: the number of pipes between the stages of @pipeline.
+ */
+guint gebrd_pipeline_count_pipes(GebrdPipeline *pipeline);
+
+/**
+ * gebrd_pipeline_pipe_size:
+ * @open_pipes: the pipes of all runs, counting the new one
+ *
+ * Splits among @open_pipes the room that the enlarged pipes of the runs of
+ * the user may take before Linux shrinks or refuses them.
+ *
+ * Returns: the size for the pipes of a new run, or 0 to keep the default.
+ */
+gint gebrd_pipeline_pipe_size(guint open_pipes);
+
+void gebrd_pipeline_free(GebrdPipeline *pipeline);
+
+G_END_DECLS
+
+#endif /* __GEBRD_PIPELINE_H__ */
@@ -0,0 +1,487 @@
+/*   GeBR Daemon - Process and control execution of flows
+ *   Copyright (C) 2007-2012 GeBR core team (http://www.gebrproject.com/)
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gebrd-sampler.h"
+
+/* Samples kept by the sampler */
+#define RING_SIZE 16
+
+/* Seconds after which a sample is pushed even if nothing changed, so the
+ * maestro knows it is fresh */
+#define HEARTBEAT 5
+
+/* Least changes of a field for it to be pushed */
+#define CPU_DELTA	5.0	/* percent points */
+#define IOWAIT_DELTA	5.0	/* percent points */
+#define RUN_QUEUE_DELTA	1	/* processes */
+#define MEM_DELTA	0.05	/* fraction of the memory pushed */
+#define PSI_DELTA	5.0	/* percent points */
+#define LOAD_DELTA	0.25	/* 1 minute load average */
+
+/* Reading {{{1 */
+
+static gchar *
+read_proc_file(const gchar *proc_dir, const gchar *name)
+{
+	gchar *path = g_build_filename(proc_dir, name, NULL);
+	gchar *contents = NULL;
+
+	if (!g_file_get_contents(path, &contents, NULL, NULL))
+		contents = NULL;
+
+	g_free(path);
+	return contents;
+}
+
+/*
+ * get_field:
+ *
+ * Returns: the position after the first @key in @contents which is at the
+ * beginning of a line, or %NULL.
+ */
+static const gchar *
+get_field(const gchar *contents, const gchar *key)
+{
+	gsize len = strlen(key);
+
+	for (const gchar *line = contents; line; line = strchr(line, '\n')) {
+		if (*line == '\n')
+			line++;
+		if (strncmp(line, key, len) == 0)
+			return line + len;
+	}
+
+	return NULL;
+}
+
+static gboolean
+read_stat(const gchar *proc_dir,
+	  GebrdCpuTimes *times,
+	  GebrdSample *sample)
+{
+	guint64 user, nice, system, idle, iowait, irq, softirq, steal = 0;
+	gchar *contents = read_proc_file(proc_dir, "stat");
+	const gchar *procs;
+
+	if (!contents)
+		return FALSE;
+
+	if (sscanf(contents, "cpu %" G_GUINT64_FORMAT " %" G_GUINT64_FORMAT " %" G_GUINT64_FORMAT
+		   " %" G_GUINT64_FORMAT " %" G_GUINT64_FORMAT " %" G_GUINT64_FORMAT
+		   " %" G_GUINT64_FORMAT " %" G_GUINT64_FORMAT,
+		   &user, &nice, &system, &idle, &iowait, &irq, &softirq, &steal) < 7) {
+		g_free(contents);
+		return FALSE;
+	}
+
+	guint64 busy = user + nice + system + irq + softirq + steal;
+	guint64 total = busy + idle + iowait;
+
+	if (total > times->total) {
+		gdouble elapsed = total - times->total;
+		sample->cpu = 100 * (busy - times->busy) / elapsed;
+		sample->iowait = 100 * (iowait - times->iowait) / elapsed;
+	} else {
+		sample->cpu = 0;
+		sample->iowait = 0;
+	}
+
+	times->busy = busy;
+	times->iowait = iowait;
+	times->total = total;
+
+	procs = get_field(contents, "procs_running ");
+	sample->run_queue = procs ? atoi(procs) : 0;
+
+	g_free(contents);
+	return TRUE;
+}
+
+static gboolean
+read_loadavg(const gchar *proc_dir,
+	     GebrdSample *sample)
+{
+	gchar *contents = read_proc_file(proc_dir, "loadavg");
+	gchar *end;
+
+	if (!contents)
+		return FALSE;
+
+	/* /proc is not localized */
+	end = contents;
+	for (gint i = 0; i < 3; i++) {
+		gchar *start = end;
+		sample->load[i] = g_ascii_strtod(start, &end);
+		if (end == start) {
+			g_free(contents);
+			return FALSE;
+		}
+	}
+
+	g_free(contents);
+	return TRUE;
+}
+
+static gboolean
+read_meminfo(const gchar *proc_dir,
+	     GebrdSample *sample)
+{
+	gchar *contents = read_proc_file(proc_dir, "meminfo");
+	const gchar *value;
+
+	if (!contents)
+		return FALSE;
+
+	/* Kernels older than 3.14 do not estimate the available memory */
+	if ((value = get_field(contents, "MemAvailable:")) != NULL) {
+		sample->mem_available = g_ascii_strtoull(value, NULL, 10);
+	} else if ((value = get_field(contents, "MemFree:")) != NULL) {
+		sample->mem_available = g_ascii_strtoull(value, NULL, 10);
+		if ((value = get_field(contents, "Buffers:")) != NULL)
+			sample->mem_available += g_ascii_strtoull(value, NULL, 10);
+		if ((value = get_field(contents, "Cached:")) != NULL)
+			sample->mem_available += g_ascii_strtoull(value, NULL, 10);
+	} else {
+		g_free(contents);
+		return FALSE;
+	}
+
+	g_free(contents);
+	return TRUE;
+}
+
+/*
+ * read_pressure:
+ *
+ * Returns: the "some avg10" of the pressure file @name, or -1 if the kernel
+ * does not provide it.
+ */
+static gdouble
+read_pressure(const gchar *proc_dir,
+	      const gchar *name)
+{
+	gchar *path = g_build_filename("pressure", name, NULL);
+	gchar *contents = read_proc_file(proc_dir, path);
+	const gchar *value;
+	gdouble pressure = -1;
+
+	if (contents && (value = get_field(contents, "some avg10=")) != NULL)
+		pressure = g_ascii_strtod(value, NULL);
+
+	g_free(contents);
+	g_free(path);
+	return pressure;
+}
+
+gboolean
+gebrd_sample_read(const gchar *proc_dir,
+		  GebrdCpuTimes *times,
+		  GebrdSample *sample)
+{
+	GTimeVal now;
+
+	if (!read_stat(proc_dir, times, sample)
+	    || !read_loadavg(proc_dir, sample)
+	    || !read_meminfo(proc_dir, sample))
+		return FALSE;
+
+	sample->psi_cpu = read_pressure(proc_dir, "cpu");
+	sample->psi_mem = read_pressure(proc_dir, "memory");
+	sample->psi_io = read_pressure(proc_dir, "io");
+
+	g_get_current_time(&now);
+	sample->time = (gint64) now.tv_sec * G_USEC_PER_SEC + now.tv_usec;
+
+	return TRUE;
+}
+
+/* Deltas {{{1 */
+
+static void
+append_key(GString *delta, const gchar *key)
+{
+	if (delta->len)
+		g_string_append_c(delta, ' ');
+	g_string_append_printf(delta, "%s=", key);
+}
+
+static void
+append_double(GString *delta, const gchar *key, gdouble value)
+{
+	gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+
+	append_key(delta, key);
+	g_string_append(delta, g_ascii_formatd(buf, sizeof(buf), "%.1f", value));
+}
+
+static void
+diff_percent(GString *delta,
+	     const gchar *key,
+	     gdouble *pushed,
+	     gdouble value,
+	     gdouble threshold,
+	     gboolean full)
+{
+	if (value < 0)
+		return;
+
+	if (full || ABS(value - *pushed) >= threshold) {
+		append_double(delta, key, value);
+		*pushed = value;
+	}
+}
+
+gchar *
+gebrd_sample_diff(GebrdSample *pushed,
+		  const GebrdSample *sample,
+		  gboolean full)
+{
+	GString *delta = g_string_new(NULL);
+
+	diff_percent(delta, "cpu", &pushed->cpu, sample->cpu, CPU_DELTA, full);
+	diff_percent(delta, "iow", &pushed->iowait, sample->iowait, IOWAIT_DELTA, full);
+
+	if (full || ABS(sample->run_queue - pushed->run_queue) >= RUN_QUEUE_DELTA) {
+		append_key(delta, "rq");
+		g_string_append_printf(delta, "%d", sample->run_queue);
+		pushed->run_queue = sample->run_queue;
+	}
+
+	if (full || ABS((gdouble) sample->mem_available - pushed->mem_available)
+	    > MEM_DELTA * pushed->mem_available) {
+		append_key(delta, "mem");
+		g_string_append_printf(delta, "%" G_GUINT64_FORMAT, sample->mem_available);
+		pushed->mem_available = sample->mem_available;
+	}
+
+	diff_percent(delta, "psc", &pushed->psi_cpu, sample->psi_cpu, PSI_DELTA, full);
+	diff_percent(delta, "psm", &pushed->psi_mem, sample->psi_mem, PSI_DELTA, full);
+	diff_percent(delta, "psi", &pushed->psi_io, sample->psi_io, PSI_DELTA, full);
+
+	if (full || ABS(sample->load[0] - pushed->load[0]) >= LOAD_DELTA) {
+		gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+
+		append_key(delta, "ld");
+		for (gint i = 0; i < 3; i++) {
+			if (i)
+				g_string_append_c(delta, ',');
+			g_string_append(delta, g_ascii_formatd(buf, sizeof(buf), "%.2f", sample->load[i]));
+			pushed->load[i] = sample->load[i];
+		}
+	}
+
+	return g_string_free(delta, FALSE);
+}
+
+/* Sampler {{{1 */
+
+struct _GebrdSampler {
+	gchar *proc_dir;
+	guint interval;
+	GebrdSamplerFunc func;
+	gpointer user_data;
+
+	GThread *thread;
+	GMutex *mutex;
+	GCond *cond;
+
+	/* Protected by mutex */
+	gboolean quit;
+	GebrdSample ring[RING_SIZE];
+	guint head;
+	guint length;
+
+	/* What the maestro knows, and when it was last told */
+	gboolean synced;
+	gboolean full_pending;
+	GebrdSample pushed;
+	gint64 push_time;
+	guint push_source;
+};
+
+static const GebrdSample *
+get_newest(GebrdSampler *sampler)
+{
+	return &sampler->ring[(sampler->head + RING_SIZE - 1) % RING_SIZE];
+}
+
+/*
+ * sampler_push:
+ *
+ * Calls the function of @sampler, in the main loop, with the changes of the
+ * newest sample.
+ */
+static gboolean
+sampler_push(GebrdSampler *sampler)
+{
+	const GebrdSample *newest;
+	gchar *delta;
+
+	g_mutex_lock(sampler->mutex);
+	newest = get_newest(sampler);
+	delta = gebrd_sample_diff(&sampler->pushed, newest, sampler->full_pending);
+	sampler->push_time = newest->time;
+	sampler->full_pending = FALSE;
+	sampler->push_source = 0;
+	g_mutex_unlock(sampler->mutex);
+
+	sampler->func(sampler, delta, sampler->user_data);
+
+	g_free(delta);
+	return FALSE;
+}
+
+/* Called with the mutex locked */
+static void
+sampler_add(GebrdSampler *sampler,
+	    const GebrdSample *sample)
+{
+	gboolean push;
+
+	sampler->ring[sampler->head] = *sample;
+	sampler->head = (sampler->head + 1) % RING_SIZE;
+	sampler->length = MIN(sampler->length + 1, RING_SIZE);
+
+	if (!sampler->synced || sampler->push_source)
+		return;
+
+	if (sampler->full_pending
+	    || sample->time - sampler->push_time >= HEARTBEAT * G_USEC_PER_SEC) {
+		push = TRUE;
+	} else {
+		GebrdSample pushed = sampler->pushed;
+		gchar *delta = gebrd_sample_diff(&pushed, sample, FALSE);
+		push = *delta != '\0';
+		g_free(delta);
+	}
+
+	if (push)
+		sampler->push_source = g_idle_add((GSourceFunc) sampler_push, sampler);
+}
+
+static gpointer
+sampler_thread(GebrdSampler *sampler)
+{
+	GebrdCpuTimes times = { 0, };
+	GebrdSample sample;
+	gboolean primed = FALSE;
+
+	g_mutex_lock(sampler->mutex);
+	while (!sampler->quit) {
+		GTimeVal deadline;
+
+		g_mutex_unlock(sampler->mutex);
+		gboolean ok = gebrd_sample_read(sampler->proc_dir, &times, &sample);
+		g_mutex_lock(sampler->mutex);
+
+		/* The first utilization is the average since boot */
+		if (ok && primed)
+			sampler_add(sampler, &sample);
+		primed = ok;
+
+		g_get_current_time(&deadline);
+		g_time_val_add(&deadline, (glong) sampler->interval * 1000);
+		while (!sampler->quit && g_cond_timed_wait(sampler->cond, sampler->mutex, &deadline));
+	}
+	g_mutex_unlock(sampler->mutex);
+
+	return NULL;
+}
+
+GebrdSampler *
+gebrd_sampler_new(const gchar *proc_dir,
+		  guint interval,
+		  GebrdSamplerFunc func,
+		  gpointer user_data)
+{
+	GebrdSampler *sampler = g_new0(GebrdSampler, 1);
+	GError *error = NULL;
+
+	sampler->proc_dir = g_strdup(proc_dir);
+	sampler->interval = interval;
+	sampler->func = func;
+	sampler->user_data = user_data;
+	sampler->mutex = g_mutex_new();
+	sampler->cond = g_cond_new();
+
+	sampler->thread = g_thread_create((GThreadFunc) sampler_thread, sampler, TRUE, &error);
+	if (!sampler->thread) {
+		g_warning("Could not start the resource sampler: %s", error->message);
+		g_error_free(error);
+	}
+
+	return sampler;
+}
+
+guint
+gebrd_sampler_get_samples(GebrdSampler *sampler,
+			  GebrdSample *samples,
+			  guint n)
+{
+	g_mutex_lock(sampler->mutex);
+	n = MIN(n, sampler->length);
+	for (guint i = 0; i < n; i++)
+		samples[i] = sampler->ring[(sampler->head + RING_SIZE - 1 - i) % RING_SIZE];
+	g_mutex_unlock(sampler->mutex);
+
+	return n;
+}
+
+gchar *
+gebrd_sampler_sync(GebrdSampler *sampler)
+{
+	gchar *delta = NULL;
+
+	g_mutex_lock(sampler->mutex);
+	sampler->synced = TRUE;
+	if (sampler->length) {
+		const GebrdSample *newest = get_newest(sampler);
+		delta = gebrd_sample_diff(&sampler->pushed, newest, TRUE);
+		sampler->push_time = newest->time;
+		sampler->full_pending = FALSE;
+	} else {
+		sampler->full_pending = TRUE;
+	}
+	g_mutex_unlock(sampler->mutex);
+
+	return delta;
+}
+
+void
+gebrd_sampler_free(GebrdSampler *sampler)
+{
+	if (sampler->thread) {
+		g_mutex_lock(sampler->mutex);
+		sampler->quit = TRUE;
+		g_cond_signal(sampler->cond);
+		g_mutex_unlock(sampler->mutex);
+		g_thread_join(sampler->thread);
+	}
+
+	if (sampler->push_source)
+		g_source_remove(sampler->push_source);
+
+	g_mutex_free(sampler->mutex);
+	g_cond_free(sampler->cond);
+	g_free(sampler->proc_dir);
+	g_free(sampler);
+}
@@ -0,0 +1,150 @@
+/*   GeBR Daemon - Process and control execution of flows
+ *   Copyright (C) 2007-2012 GeBR core team (http://www.gebrproject.com/)
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GEBRD_SAMPLER_H__
+#define __GEBRD_SAMPLER_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/**
+ * GebrdSample:
+ * @time: when the sample was taken, in microseconds since the epoch
+ * @cpu: percent of the time of all processors spent running since the
+ * previous sample
+ * @iowait: percent of the time of all processors spent idle waiting for I/O
+ * since the previous sample
+ * @run_queue: processes running or ready to run
+ * @mem_available: memory available for new processes, in kB
+ * @psi_cpu: percent of the last 10 seconds in which some task waited for a
+ * processor, or a negative value if the kernel has no pressure information
+ * @psi_mem: same as @psi_cpu, for tasks stalled on memory
+ * @psi_io: same as @psi_cpu, for tasks stalled on I/O
+ * @load: the 1, 5 and 15 minutes load averages
+ */
+typedef struct {
+	gint64 time;
+	gdouble cpu;
+	gdouble iowait;
+	gint run_queue;
+	guint64 mem_available;
+	gdouble psi_cpu;
+	gdouble psi_mem;
+	gdouble psi_io;
+	gdouble load[3];
+} GebrdSample;
+
+/**
+ * GebrdCpuTimes:
+ *
+ * Processor times, in jiffies, of the first line of `/proc/stat', kept
+ * between samples to compute the utilization in the meantime.
+ */
+typedef struct {
+	guint64 busy;
+	guint64 iowait;
+	guint64 total;
+} GebrdCpuTimes;
+
+/**
+ * gebrd_sample_read:
+ * @proc_dir: the mount point of proc, usually `/proc'
+ * @times: the processor times of the previous sample, all zeros for the
+ * first one; updated to the current times
+ * @sample: where the sample is stored
+ *
+ * Returns: %TRUE if `stat', `loadavg' and `meminfo' of @proc_dir could be
+ * read. The pressure files are optional.
+ */
+gboolean gebrd_sample_read(const gchar *proc_dir,
+			   GebrdCpuTimes *times,
+			   GebrdSample *sample);
+
+/**
+ * gebrd_sample_diff:
+ * @pushed: the sample as known by the maestro
+ * @sample: a newer sample
+ * @full: whether to write all fields, as for a maestro that knows nothing
+ *
+ * Writes the fields of @sample that changed significantly from @pushed as
+ * space separated `key=value' pairs, and updates them in @pushed.
+ *
+ * Returns: the pairs, empty if nothing changed. Free with g_free().
+ */
+gchar *gebrd_sample_diff(GebrdSample *pushed,
+			 const GebrdSample *sample,
+			 gboolean full);
+
+typedef struct _GebrdSampler GebrdSampler;
+
+/**
+ * GebrdSamplerFunc:
+ * @delta: the changes since the last call, see gebrd_sample_diff()
+ *
+ * Called in the main loop when the samples changed significantly, or every
+ * few seconds otherwise so the receiver knows they are fresh.
+ */
+typedef void (*GebrdSamplerFunc) (GebrdSampler *sampler,
+				  const gchar *delta,
+				  gpointer user_data);
+
+/**
+ * gebrd_sampler_new:
+ * @proc_dir: the mount point of proc, usually `/proc'
+ * @interval: milliseconds between samples
+ *
+ * Starts a thread that samples the resources of this machine every
+ * @interval and keeps the last samples. @func is only called after
+ * gebrd_sampler_sync().
+ */
+GebrdSampler *gebrd_sampler_new(const gchar *proc_dir,
+				guint interval,
+				GebrdSamplerFunc func,
+				gpointer user_data);
+
+/**
+ * gebrd_sampler_get_samples:
+ * @samples: an array of @n samples
+ *
+ * Copies the last @n samples, newest first, into @samples.
+ *
+ * Returns: the number of samples copied.
+ */
+guint gebrd_sampler_get_samples(GebrdSampler *sampler,
+				GebrdSample *samples,
+				guint n);
+
+/**
+ * gebrd_sampler_sync:
+ *
+ * Returns: all fields of the newest sample, to be sent to a maestro which
+ * will receive only the changes from now on, or %NULL if there is no
+ * sample yet. Free with g_free().
+ */
+gchar *gebrd_sampler_sync(GebrdSampler *sampler);
+
+/**
+ * gebrd_sampler_free:
+ *
+ * Stops the thread of @sampler and frees it.
+ */
+void gebrd_sampler_free(GebrdSampler *sampler);
+
+G_END_DECLS
+
+#endif /* __GEBRD_SAMPLER_H__ */
@@ -151,6 +151,13 @@ gebrd_on_sigsegvt(int sig)
 	exit(1);
 }
 
+static void
+gebrd_on_sighup(int sig)
+{
+	if (gebrd->launcher)
+		gebrd_launcher_refresh(gebrd->launcher);
+}
+
 /*
  * Public
  */
@@ -213,6 +220,10 @@ gboolean server_init(void)
 	act.sa_sigaction = (typeof(act.sa_sigaction)) & gebrd_on_sigsegvt;
 	sigemptyset(&act.sa_mask);
 	sigaction(SIGSEGV, &act, NULL);
+	/* Jobs get the changes of the login environment from now on */
+	act.sa_sigaction = (typeof(act.sa_sigaction)) & gebrd_on_sighup;
+	sigemptyset(&act.sa_mask);
+	sigaction(SIGHUP, &act, NULL);
 
 	/* success, send port */
 	gebrd_message(GEBR_LOG_START, _("Server started at %u port"),
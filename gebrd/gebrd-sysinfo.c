@@ -166,3 +166,21 @@ void gebrd_mem_info_free (GebrdMemInfo *self)
 	g_hash_table_unref (self->props);
 	g_free (self);
 }
+
+gchar *
+gebrd_sys_load_get (void)
+{
+	gchar *content;
+	gdouble load1, load5, load15;
+
+	if (!g_file_get_contents ("/proc/loadavg", &content, NULL, NULL))
+		return NULL;
+
+	if (sscanf (content, "%lf %lf %lf", &load1, &load5, &load15) != 3) {
+		g_free (content);
+		return NULL;
+	}
+
+	g_free (content);
+	return g_strdup_printf ("%f %f %f", load1, load5, load15);
+}
@@ -93,4 +93,13 @@ const gchar *gebrd_mem_info_get (GebrdMemInfo *self,
  */
 void gebrd_mem_info_free (GebrdMemInfo *self);
 
+/**
+ * gebrd_sys_load_get:
+ *
+ * Returns: the 1, 5 and 15 minutes load averages separated by spaces, as
+ * read from `/proc/loadavg', or %NULL if it can not be read. Free with
+ * g_free().
+ */
+gchar *gebrd_sys_load_get (void);
+
 #endif /* __GEBRD_SYSINFO_H__ */
@@ -32,6 +32,7 @@
 #include "gebrd-job.h"
 #include "gebrd-server.h"
 #include "gebrd-client.h"
+#include "gebrd-sysinfo.h"
 
 /* GOBJECT STUFF */
 enum {
@@ -103,14 +104,14 @@ gebrd_user_get_property(GObject * object, guint property_id, GValue * value, GPa
 		g_value_set_string(value, self->fs_nickname->str);
 		break;
 	case PROP_SYS_LOAD: {
+		GebrdSample sample;
 		gchar *loads;
-		gchar *content;
-		if (g_file_get_contents("/proc/loadavg", &content, NULL, NULL)) {
-			gdouble load1, load5, load15;
-			sscanf(content, "%lf %lf %lf", &load1, &load5, &load15);
-			loads = g_strdup_printf("%f %f %f", load1, load5, load15);
-		} else
-			loads = NULL;
+
+		/* The sampler already has it, do not read /proc again */
+		if (gebrd->sampler && gebrd_sampler_get_samples(gebrd->sampler, &sample, 1))
+			loads = g_strdup_printf("%f %f %f", sample.load[0], sample.load[1], sample.load[2]);
+		else
+			loads = gebrd_sys_load_get();
 		g_value_set_string(value, loads);
 
 		g_free(loads);
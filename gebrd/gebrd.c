@@ -38,6 +38,13 @@
 
 #define GEBRD_CONF_FILE "/etc/gebr/gebrd.conf"
 
+/* Milliseconds between samples of the resources of this machine */
+#define GEBRD_SAMPLE_INTERVAL 1000
+
+/* How long the results of jobs which stopped while no maestro was connected
+ * are kept, in seconds */
+#define GEBRD_ORPHAN_TIMEOUT 3600
+
 GebrdApp *gebrd = NULL;
 
 /* GOBJECT STUFF */
@@ -179,14 +186,52 @@ static void close_open_fds(int lowfd, int highfd)
 #endif /* defined(HAVE_DIRFD) && defined(HAVE_PROC_PID) */
 }
 
+/*
+ * on_sample:
+ *
+ * Pushes the changes of the resources of this machine to the maestro.
+ */
+static void
+on_sample(GebrdSampler *sampler,
+	  const gchar *delta,
+	  gpointer user_data)
+{
+	struct client *client = gebrd_user_get_connection(gebrd->user);
+
+	if (client)
+		client_send_load(client, delta);
+}
+
+/*
+ * run_main_loop:
+ *
+ * Runs the main loop with the launcher and the sampler started. They are only
+ * started here because the daemon closes its descriptors after the fork, and
+ * the launcher must be forked before the sampler thread.
+ */
+static void
+run_main_loop(void)
+{
+	gebrd->launcher = gebrd_launcher_new();
+	gebrd->sampler = gebrd_sampler_new("/proc", gebrd->sample_interval, on_sample, NULL);
+
+	gebrd->main_loop = g_main_loop_new(NULL, FALSE);
+	g_main_loop_run(gebrd->main_loop);
+	g_main_loop_unref(gebrd->main_loop);
+
+	gebrd_sampler_free(gebrd->sampler);
+	gebrd->sampler = NULL;
+	if (gebrd->launcher) {
+		gebrd_launcher_free(gebrd->launcher);
+		gebrd->launcher = NULL;
+	}
+}
+
 void gebrd_init(void)
 {
 	if (gebrd->options.foreground) {
-		if (server_init() == TRUE) {
-			gebrd->main_loop = g_main_loop_new(NULL, FALSE);
-			g_main_loop_run(gebrd->main_loop);
-			g_main_loop_unref(gebrd->main_loop);
-		}
+		if (server_init() == TRUE)
+			run_main_loop();
 	} else {
 		if (pipe(gebrd->finished_starting_pipe) == -1)
 			g_warning("%s:%d: Error when creating pipe with error code %d",
@@ -211,9 +256,7 @@ void gebrd_init(void)
 
 			if (server_init()) {
 				close_open_fds(0, 3);
-				gebrd->main_loop = g_main_loop_new(NULL, FALSE);
-				g_main_loop_run(gebrd->main_loop);
-				g_main_loop_unref(gebrd->main_loop);
+				run_main_loop();
 			}
 		} else {
 			/* wait for server_init sign that it finished */
@@ -234,6 +277,27 @@ void gebrd_init(void)
 	}
 }
 
+static gboolean
+orphan_timeout(gpointer data)
+{
+	gebrd->orphan_source = 0;
+	gebrd_message(GEBR_LOG_INFO, _("No maestro came back for the jobs."));
+	gebrd_quit();
+	return FALSE;
+}
+
+void gebrd_orphan_update(void)
+{
+	gboolean orphan = !gebrd_user_get_connection(gebrd->user) && !job_has_running_jobs();
+
+	if (orphan && !gebrd->orphan_source)
+		gebrd->orphan_source = g_timeout_add_seconds(GEBRD_ORPHAN_TIMEOUT, orphan_timeout, NULL);
+	else if (!orphan && gebrd->orphan_source) {
+		g_source_remove(gebrd->orphan_source);
+		gebrd->orphan_source = 0;
+	}
+}
+
 void gebrd_quit(void)
 {
 	gebrd_message(GEBR_LOG_END, _("Server quit."));
@@ -387,6 +451,7 @@ void gebrd_config_load(void)
 
 	err1 = err2 = NULL;
 	gebrd->mpi_flavors = NULL;
+	gebrd->sample_interval = GEBRD_SAMPLE_INTERVAL;
 	config_path = g_strdup_printf("%s/.gebr/gebrd/gebrd.conf", g_get_home_dir());
 	key_file = g_key_file_new();
 
@@ -425,6 +490,11 @@ void gebrd_config_load(void)
 		g_string_free(end_cmd, TRUE);
 	}
 
+	gebrd->sample_interval = gebr_g_key_file_load_int_key(key_file, "sampler", "interval",
+							      GEBRD_SAMPLE_INTERVAL);
+	if (gebrd->sample_interval < 100)
+		gebrd->sample_interval = 100;
+
 out:
 	mpi_fallback();
 
@@ -24,7 +24,9 @@
 #include <libgebr/comm/gebr-comm-server.h>
 #include <libgebr/gebr-validator.h>
 
+#include "gebrd-launcher.h"
 #include "gebrd-mpi-interface.h"
+#include "gebrd-sampler.h"
 #include "gebrd-user.h"
 
 G_BEGIN_DECLS
@@ -84,6 +86,22 @@ struct _GebrdApp {
 	GHashTable *display_ports;
 
 	gint nprocs;
+
+	/**
+	 * Samples the resources of this machine, see gebrd.conf
+	 */
+	GebrdSampler *sampler;
+	guint sample_interval;
+
+	/**
+	 * Starts the jobs with the login environment read once
+	 */
+	GebrdLauncher *launcher;
+
+	/**
+	 * Quits when no maestro came back for the jobs, see gebrd_orphan_update()
+	 */
+	guint orphan_source;
 };
 
 struct _GebrdAppClass {
@@ -103,6 +121,13 @@ void gebrd_init(void);
  */
 void gebrd_quit(void);
 
+/**
+ * Quits after a while if no maestro is connected and no job is running. The
+ * jobs keep running when the maestro disconnects, and a maestro connecting
+ * again lists them.
+ */
+void gebrd_orphan_update(void);
+
 /**
  * Log a message in the gebrd log file and to standand output.
  * The message in only shown in the stdout if gebrd is running in interative mode.
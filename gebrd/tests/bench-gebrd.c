@@ -0,0 +1,168 @@
+/*   GeBR Daemon - Process and control execution of flows
+ *   Copyright (C) 2007-2012 GeBR core team (http://www.gebrproject.com/)
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <glib.h>
+#include <string.h>
+#include <gebr-bench.h>
+#include <libgebr/geoxml/geoxml.h>
+#include <libgebr/comm/gebr-comm-protocol-socket.h>
+
+#include "../gebrd.h"
+#include "../gebrd-job.h"
+#include "../gebrd-job_p.h"
+
+#define TEST_FLOW FLOW_DIR"/promo035.flw"
+#define LOOP_STEPS "1000"
+
+/* Output read from the processes by each relay */
+#define OUTPUT_SIZE (512 << 10)
+#define CHUNK_SIZE 4096
+
+/* {{{1 Job assembly */
+
+typedef struct {
+	struct client client;
+	GString *empty;
+	GString *id;
+	GString *numproc;
+	GString *nice;
+	GString *flow_xml;
+} JobData;
+
+static GebrdJob *
+job_data_assemble(JobData *d)
+{
+	GebrdJob *job;
+
+	job_new(&job, &d->client, d->empty, d->id, d->empty, d->numproc,
+		d->nice, d->flow_xml, d->empty, d->empty, d->empty);
+	if (job->critical_error)
+		g_error("Could not assemble the command line of %s", TEST_FLOW);
+
+	return job;
+}
+
+static void
+bench_job_assemble(gpointer data)
+{
+	job_free(job_data_assemble(data));
+}
+
+/*
+ * The flow of promo035.flw inside a loop of LOOP_STEPS steps, as sent by
+ * the maestro to be run on 4 cores.
+ */
+static JobData *
+job_data_new(void)
+{
+	JobData *d = g_new(JobData, 1);
+	GebrGeoXmlDocument *flow, *loop;
+	GebrGeoXmlProgram *prog_loop;
+	gchar *xml;
+
+	if (gebr_geoxml_document_load(&flow, TEST_FLOW, FALSE, NULL) != GEBR_GEOXML_RETV_SUCCESS)
+		g_error("Could not load %s", TEST_FLOW);
+	if (gebr_geoxml_document_load(&loop, FLOW_DIR"/forloop.mnu", FALSE, NULL) != GEBR_GEOXML_RETV_SUCCESS)
+		g_error("Could not load the loop menu");
+	gebr_geoxml_flow_get_program(GEBR_GEOXML_FLOW(loop), (GebrGeoXmlSequence **) &prog_loop, 0);
+	gebr_geoxml_program_set_status(prog_loop, GEBR_GEOXML_PROGRAM_STATUS_CONFIGURED);
+	gebr_geoxml_program_control_set_n(prog_loop, "1", "1", LOOP_STEPS);
+	gebr_geoxml_flow_add_flow(GEBR_GEOXML_FLOW(flow), GEBR_GEOXML_FLOW(loop));
+	gebr_geoxml_object_unref(prog_loop);
+	gebr_geoxml_document_free(loop);
+	gebr_geoxml_flow_update_iter_dict_value(GEBR_GEOXML_FLOW(flow));
+	gebr_geoxml_flow_io_set_output(GEBR_GEOXML_FLOW(flow), "");
+
+	gebr_geoxml_document_to_string(flow, &xml);
+	gebr_geoxml_document_free(flow);
+
+	d->client.socket = gebr_comm_protocol_socket_new();
+	d->client.server_location = GEBR_COMM_SERVER_LOCATION_LOCAL;
+	d->client.display = g_string_new(":0");
+	d->client.display_port = 0;
+	d->empty = g_string_new("");
+	d->id = g_string_new("bench-job");
+	d->numproc = g_string_new("4");
+	d->nice = g_string_new("0");
+	d->flow_xml = g_string_new(xml);
+	g_free(xml);
+
+	return d;
+}
+
+/* {{{1 Output relay */
+
+typedef struct {
+	GebrdJob *job;
+	GString *output;
+} RelayData;
+
+static void
+bench_output_relay(gpointer data)
+{
+	RelayData *d = data;
+
+	/* Always within the burst allowed, so nothing is dropped */
+	d->job->output_allowance = OUTPUT_RATE_BURST;
+	for (gsize i = 0; i < d->output->len; i += CHUNK_SIZE)
+		job_output_append(d->job, d->output->str + i, MIN(CHUNK_SIZE, d->output->len - i));
+	job_output_flush(d->job, TRUE);
+	g_string_truncate(d->job->parent.output, 0);
+}
+
+/*
+ * Output of a program reporting its progress with carriage returns, in
+ * Portuguese, so chunks end in the middle of lines and of characters.
+ */
+static RelayData *
+relay_data_new(JobData *job_data)
+{
+	RelayData *d = g_new(RelayData, 1);
+
+	d->job = job_data_assemble(job_data);
+	d->output = g_string_sized_new(OUTPUT_SIZE);
+	for (gint i = 0; d->output->len < OUTPUT_SIZE; i++) {
+		g_string_append_printf(d->output, "Iteração %d: traço %d de 2000\r", i, i % 2000);
+		if (i % 100 == 99)
+			g_string_append_printf(d->output, "\nConcluída a seção %d\n", i / 100);
+	}
+
+	return d;
+}
+
+/* {{{1 Main */
+
+int
+main(int argc, char *argv[])
+{
+	gebr_bench_init(&argc, &argv, "gebrd");
+	gebr_geoxml_init();
+	gebr_geoxml_document_set_dtd_dir(DTD_DIR);
+	gebrd = gebrd_app_new();
+
+	JobData *job = job_data_new();
+	RelayData *relay = relay_data_new(job);
+
+	gebr_bench_add("job/assemble-loop", bench_job_assemble, job, job->flow_xml->len);
+	gebr_bench_add("output/relay", bench_output_relay, relay, relay->output->len);
+
+	gint ret = gebr_bench_run();
+
+	job_free(relay->job);
+	gebr_geoxml_finalize();
+
+	return ret;
+}
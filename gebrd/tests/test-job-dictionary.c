@@ -0,0 +1,134 @@
+/*   GeBR Daemon - Process and control execution of flows
+ *   Copyright (C) 2007-2012 GeBR core team (http://www.gebrproject.com/)
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <glib.h>
+#include <glib-object.h>
+#include <string.h>
+
+#include "../gebrd.h"
+#include "../gebrd-job.h"
+#include "../gebrd-job_p.h"
+
+#define STEPS 12
+
+/*
+ * The dictionary of a loop as written by define_bc_variables() and the
+ * expressions of the parameters of its programs, with $counter spliced by
+ * the shell.
+ */
+static const gchar *variables =
+	"\titer = ((1) + (0.5) * '\"$counter\"') ; iter\t# V[0]: Iteration\n"
+	"\tw = (iter / 3) ; w\t# V[1]: Width\n"
+	"\tn = (7) ; n\t# V[2]: Samples\n";
+
+static const gchar *expressions =
+	"\tround(w * n) # V[3]: Traces\n"
+	"\tmin(10,max(0,sqrt(iter))) # V[4]: Offset\n"
+	"\ts(iter) + e(1) # V[5]: Angle\n"
+	"\tmax(-1,w - 2) # V[6]: Shift\n"
+	"\tround(-w) # V[7]: Negative\n"
+	"\tn / (iter * 1000) # V[8]: Small\n";
+
+/* The values of V set by the shell lines piping the dictionary into bc */
+static gchar *
+bc_values(const gchar *expr_buf, gint step)
+{
+	gchar *script;
+	gchar *out = NULL;
+	gint status;
+	gchar *argv[] = { "bash", "-c", NULL, NULL };
+	GError *error = NULL;
+
+	script = g_strdup_printf("counter=%d\n%s\necho \"${V[*]}\"\n", step, expr_buf);
+	argv[2] = script;
+	if (!g_spawn_sync(NULL, argv, NULL, G_SPAWN_SEARCH_PATH, NULL, NULL,
+			  &out, NULL, &status, &error))
+		g_error("Could not run bc: %s", error->message);
+	g_assert_cmpint(status, ==, 0);
+	g_strchomp(out);
+	g_free(script);
+
+	return out;
+}
+
+static void
+test_job_dictionary_bc(void)
+{
+	GebrdJob *job;
+	GPtrArray *table;
+	GString *expr_buf;
+	gchar *bc;
+
+	if (!(bc = g_find_program_in_path("bc"))) {
+		g_test_message("bc not found, skipping");
+		return;
+	}
+	g_free(bc);
+
+	job = GEBRD_JOB(g_object_new(GEBRD_JOB_TYPE, NULL));
+	job->n_vars = 3;
+	job->expr_count = 6;
+
+	expr_buf = g_string_new(variables);
+	g_string_append(expr_buf, expressions);
+	table = job_precompute_dictionary(job, expr_buf->str, STEPS);
+	g_assert(table != NULL);
+	g_assert_cmpuint(table->len, ==, STEPS);
+
+	assemble_bc_cmd_line(expr_buf);
+	for (gint i = 0; i < STEPS; i++) {
+		gchar *values = bc_values(expr_buf->str, i);
+		g_assert_cmpstr(g_ptr_array_index(table, i), ==, values);
+		g_free(values);
+	}
+
+	g_ptr_array_free(table, TRUE);
+	g_string_free(expr_buf, TRUE);
+	g_object_unref(job);
+}
+
+static void
+test_job_dictionary_fallback(void)
+{
+	GebrdJob *job = GEBRD_JOB(g_object_new(GEBRD_JOB_TYPE, NULL));
+
+	/* A runtime error leaves the program to bc */
+	job->n_vars = 1;
+	job->expr_count = 1;
+	g_assert(job_precompute_dictionary(job,
+		"\tx = (1 / ('\"$counter\"' - 2)) ; x\t# V[0]: x\n"
+		"\tx * 2 # V[1]: y\n", 4) == NULL);
+
+	/* As does a count of values other than the expected */
+	job->expr_count = 2;
+	g_assert(job_precompute_dictionary(job,
+		"\tx = (1) ; x\t# V[0]: x\n"
+		"\tx * 2 # V[1]: y\n", 4) == NULL);
+
+	g_object_unref(job);
+}
+
+int main(int argc, char * argv[])
+{
+	g_type_init();
+	g_test_init(&argc, &argv, NULL);
+	gebrd = gebrd_app_new();
+
+	g_test_add_func("/gebrd/job/dictionary/bc", test_job_dictionary_bc);
+	g_test_add_func("/gebrd/job/dictionary/fallback", test_job_dictionary_fallback);
+
+	return g_test_run();
+}
@@ -0,0 +1,164 @@
+/*   GeBR Daemon - Process and control execution of flows
+ *   Copyright (C) 2007-2012 GeBR core team (http://www.gebrproject.com/)
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <glib.h>
+#include <glib-object.h>
+#include <glib/gstdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../gebrd.h"
+#include "../gebrd-job.h"
+#include "../gebrd-job_p.h"
+
+static gchar *dir;
+
+/* A job of a loop of @steps steps running @script on @numproc slots */
+static GebrdJob *
+loop_job_new(gint steps, gint numproc, const gchar *script)
+{
+	GebrdJob *job = GEBRD_JOB(g_object_new(GEBRD_JOB_TYPE, NULL));
+	GebrGeoXmlProgram *program;
+
+	job->process = gebr_comm_process_new();
+	job->output_pending = g_string_new(NULL);
+	job->output_allowance = OUTPUT_RATE_BURST;
+	g_get_current_time(&job->output_refill);
+	job->status_fd = -1;
+
+	job->flow = gebr_geoxml_flow_new();
+	program = gebr_geoxml_flow_append_program(job->flow);
+	gebr_geoxml_program_set_stdin(program, FALSE);
+	gebr_geoxml_object_unref(program);
+
+	job->server_loop = TRUE;
+	job->loop_steps = steps;
+	job->numproc = numproc;
+	g_string_assign(job->parent.cmd_line, script);
+	gebrd->user->jobs = g_list_append(gebrd->user->jobs, job);
+
+	return job;
+}
+
+static void
+loop_job_wait(GebrdJob *job)
+{
+	while (job->parent.status != JOB_STATUS_FINISHED
+	       && job->parent.status != JOB_STATUS_FAILED
+	       && job->parent.status != JOB_STATUS_CANCELED)
+		g_main_context_iteration(NULL, TRUE);
+}
+
+static void
+assert_steps_status(GebrdJob *job, const gint *expected)
+{
+	g_assert_cmpuint(job->steps_status->len, ==, job->loop_steps);
+	for (gint i = 0; i < job->loop_steps; i++)
+		g_assert_cmpint(g_array_index(job->steps_status, gint, i), ==, expected[i]);
+}
+
+static void
+test_job_loop_slots(void)
+{
+	const gint status[] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+	gchar *script = g_strdup_printf("sleep 0.$((counter %% 3)); touch '%s'/$counter", dir);
+	GebrdJob *job = loop_job_new(8, 3, script);
+
+	/* Only as many steps as slots are started at first */
+	job_loop_run(job);
+	g_assert_cmpuint(job->slots->len, ==, 3);
+	g_assert_cmpint(job->running_steps, ==, 3);
+	g_assert_cmpint(job->next_step, ==, 3);
+	g_assert(job->parent.status == JOB_STATUS_RUNNING);
+
+	/* The slots are reused for the remaining steps as they get free */
+	loop_job_wait(job);
+	g_assert(job->parent.status == JOB_STATUS_FINISHED);
+	g_assert_cmpuint(job->slots->len, ==, 3);
+	g_assert_cmpint(job->running_steps, ==, 0);
+	g_assert_cmpint(job->next_step, ==, 8);
+	assert_steps_status(job, status);
+	for (gint i = 0; i < 8; i++) {
+		gchar *name = g_strdup_printf("%d", i);
+		gchar *path = g_build_filename(dir, name, NULL);
+		g_assert(g_file_test(path, G_FILE_TEST_EXISTS));
+		g_unlink(path);
+		g_free(path);
+		g_free(name);
+	}
+
+	job_free(job);
+	g_free(script);
+}
+
+static void
+test_job_loop_few_steps(void)
+{
+	const gint status[] = { 0, 0 };
+	GebrdJob *job = loop_job_new(2, 8, "true");
+
+	job_loop_run(job);
+	g_assert_cmpuint(job->slots->len, ==, 2);
+	loop_job_wait(job);
+	g_assert(job->parent.status == JOB_STATUS_FINISHED);
+	assert_steps_status(job, status);
+
+	job_free(job);
+}
+
+static void
+test_job_loop_status(void)
+{
+	const gint status[] = { 0, 0, 3, 0, 128 + 9 };
+	GebrdJob *job = loop_job_new(5, 2,
+				     "case $counter in 2) exit 3;; 4) kill -KILL $$;; esac");
+
+	/* The other steps run even though some fail */
+	job_loop_run(job);
+	loop_job_wait(job);
+	g_assert(job->parent.status == JOB_STATUS_FAILED);
+	g_assert_cmpint(job->next_step, ==, 5);
+	assert_steps_status(job, status);
+	g_assert(strstr(job->parent.issues->str, "Loop step 2 exited with status 3") != NULL);
+	g_assert(strstr(job->parent.issues->str, "Loop step 4 exited with status 137") != NULL);
+
+	job_free(job);
+}
+
+int main(int argc, char * argv[])
+{
+	gchar *name = g_strdup_printf("gebrd-test-job-loop-%d", (gint) getpid());
+	gint ret;
+
+	dir = g_build_filename(g_get_tmp_dir(), name, NULL);
+	g_mkdir_with_parents(dir, 0700);
+	g_type_init();
+	g_test_init(&argc, &argv, NULL);
+	gebr_geoxml_init();
+	gebrd = gebrd_app_new();
+
+	g_test_add_func("/gebrd/job/loop/slots", test_job_loop_slots);
+	g_test_add_func("/gebrd/job/loop/few-steps", test_job_loop_few_steps);
+	g_test_add_func("/gebrd/job/loop/status", test_job_loop_status);
+
+	ret = g_test_run();
+
+	g_rmdir(dir);
+	g_free(dir);
+	g_free(name);
+
+	return ret;
+}
@@ -0,0 +1,192 @@
+/*   GeBR Daemon - Process and control execution of flows
+ *   Copyright (C) 2007-2012 GeBR core team (http://www.gebrproject.com/)
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <glib.h>
+#include <glib-object.h>
+#include <string.h>
+
+#include "../gebrd.h"
+#include "../gebrd-job.h"
+#include "../gebrd-job_p.h"
+
+/* No maestro is connected, so the output flushed is only kept in the job */
+static GebrdJob *
+output_job_new(void)
+{
+	GebrdJob *job = GEBRD_JOB(g_object_new(GEBRD_JOB_TYPE, NULL));
+
+	job->output_pending = g_string_new(NULL);
+	job->output_valid = 0;
+	job->output_source = 0;
+	job->output_allowance = OUTPUT_RATE_BURST;
+	g_get_current_time(&job->output_refill);
+	job->output_dropped = 0;
+
+	return job;
+}
+
+static void
+output_job_free(GebrdJob *job)
+{
+	if (job->output_source)
+		g_source_remove(job->output_source);
+	g_string_free(job->output_pending, TRUE);
+	g_object_unref(job);
+}
+
+static void
+append(GebrdJob *job, const gchar *data)
+{
+	job_output_append(job, data, strlen(data));
+}
+
+static void
+assert_sanitized(const gchar *data, gsize len, gboolean final,
+		 const gchar *expected, gsize valid)
+{
+	GString *str = g_string_new_len(data, len);
+
+	g_assert_cmpuint(job_output_sanitize(str, 0, final), ==, valid);
+	g_assert_cmpuint(str->len, ==, len);
+	g_assert(memcmp(str->str, expected, len) == 0);
+	g_string_free(str, TRUE);
+}
+
+static void
+test_job_output_sanitize(void)
+{
+	/* "ç" is "\xc3\xa7" */
+	assert_sanitized("a\xc3\xa7", 3, FALSE, "a\xc3\xa7", 3);
+	assert_sanitized("a\xff" "b", 3, FALSE, "a?b", 3);
+	assert_sanitized("a\xa7" "b", 3, FALSE, "a?b", 3);
+	assert_sanitized("a\0b", 3, FALSE, "a?b", 3);
+	assert_sanitized("a\xc3" "b", 3, FALSE, "a?b", 3);
+
+	/* Unless final, the rest of a character may still be read */
+	assert_sanitized("ab\xc3", 3, FALSE, "ab\xc3", 2);
+	assert_sanitized("ab\xc3", 3, TRUE, "ab?", 3);
+	assert_sanitized("\xff" "b\xe2\x82", 4, FALSE, "?b\xe2\x82", 2);
+	assert_sanitized("\xff" "b\xe2\x82", 4, TRUE, "?b??", 4);
+}
+
+static void
+assert_collapsed(const gchar *data, const gchar *expected)
+{
+	GString *str = g_string_new(data);
+
+	g_assert_cmpuint(job_output_collapse_cr(str, 0, str->len), ==, strlen(expected));
+	g_assert_cmpstr(str->str, ==, expected);
+	g_string_free(str, TRUE);
+}
+
+static void
+test_job_output_collapse_cr(void)
+{
+	assert_collapsed("10%\r20%\r30%\n", "30%\n");
+	assert_collapsed("a\r\nb\r\n", "a\r\nb\r\n");
+	assert_collapsed("1\r2\n3\r4\r", "2\n4\r");
+	assert_collapsed("\r\r\n", "\r\n");
+	assert_collapsed("no progress\n", "no progress\n");
+}
+
+static void
+test_job_output_chunks(void)
+{
+	GebrdJob *job = output_job_new();
+
+	/* Progress updates spanning several reads */
+	append(job, "Start\n10%");
+	append(job, "\r20%\r");
+	append(job, "30");
+	append(job, "%\r40%\n");
+	g_assert_cmpstr(job->output_pending->str, ==, "Start\n40%\n");
+	g_assert(job->output_source != 0);
+
+	/* A character split between two reads is kept whole */
+	append(job, "Se\xc3");
+	g_assert_cmpuint(job->output_valid, ==, job->output_pending->len - 1);
+	append(job, "\xa7\xc3\xa3o 1\r");
+	append(job, "Se\xc3\xa7\xc3\xa3o 2\n");
+
+	job_output_flush(job, TRUE);
+	g_assert_cmpstr(job->parent.output->str, ==, "Start\n40%\nSe\xc3\xa7\xc3\xa3o 2\n");
+	g_assert_cmpuint(job->output_pending->len, ==, 0);
+
+	/* What is still incomplete when the process ends is replaced */
+	append(job, "end\xe2\x82");
+	job_output_flush(job, TRUE);
+	g_assert(g_str_has_suffix(job->parent.output->str, "end??"));
+
+	output_job_free(job);
+}
+
+static void
+test_job_output_rate(void)
+{
+	GebrdJob *job = output_job_new();
+	GString *input = g_string_new(NULL);
+	gchar *marker;
+
+	for (gint i = 0; input->len < 20000; i++)
+		g_string_append_printf(input, "%08d%091d\n", i, 0);
+
+	/* The allowance refilled in the meantime is far less than the input */
+	job->output_allowance = 1000;
+	g_get_current_time(&job->output_refill);
+	append(job, input->str);
+	job_output_flush(job, FALSE);
+
+	/* Only whole lines are sent, followed by the marker */
+	marker = strstr(job->parent.output->str, "[");
+	g_assert(marker != NULL);
+	g_assert(marker > job->parent.output->str);
+	g_assert_cmpint(marker[-1], ==, '\n');
+	g_assert_cmpuint(marker - job->parent.output->str, <, input->len);
+	g_assert(strncmp(job->parent.output->str, input->str, marker - job->parent.output->str) == 0);
+	g_assert(g_str_has_suffix(marker, " of output dropped]\n"));
+	g_assert_cmpuint(job->output_pending->len, ==, 0);
+	g_assert_cmpuint(job->output_dropped, ==, 0);
+
+	/* Output held past the limit while congested is dropped as well */
+	g_string_truncate(job->parent.output, 0);
+	g_string_set_size(input, (4 << 20) + 1);
+	memset(input->str, 'x', input->len);
+	job_output_append(job, input->str, input->len);
+	g_assert_cmpuint(job->output_pending->len, ==, 0);
+	g_assert_cmpuint(job->output_dropped, ==, input->len);
+
+	job_output_flush(job, TRUE);
+	g_assert(job->parent.output->str[0] == '[');
+	g_assert(g_str_has_suffix(job->parent.output->str, " of output dropped]\n"));
+	g_assert_cmpuint(job->output_dropped, ==, 0);
+
+	g_string_free(input, TRUE);
+	output_job_free(job);
+}
+
+int main(int argc, char * argv[])
+{
+	g_type_init();
+	g_test_init(&argc, &argv, NULL);
+	gebrd = gebrd_app_new();
+
+	g_test_add_func("/gebrd/job/output/sanitize", test_job_output_sanitize);
+	g_test_add_func("/gebrd/job/output/collapse_cr", test_job_output_collapse_cr);
+	g_test_add_func("/gebrd/job/output/chunks", test_job_output_chunks);
+	g_test_add_func("/gebrd/job/output/rate", test_job_output_rate);
+
+	return g_test_run();
+}
@@ -0,0 +1,164 @@
+/*   GeBR Daemon - Process and control execution of flows
+ *   Copyright (C) 2007-2012 GeBR core team (http://www.gebrproject.com/)
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <glib.h>
+#include <glib-object.h>
+#include <glib/gstdio.h>
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "../gebrd-launcher.h"
+
+typedef struct {
+	GString *output;
+	gint status;
+	gboolean finished;
+} Job;
+
+static void
+on_stdout(GebrCommProcess *process, Job *job)
+{
+	GString *output = gebr_comm_process_read_stdout_string_all(process);
+	g_string_append(job->output, output->str);
+	g_string_free(output, TRUE);
+}
+
+static void
+on_finished(GebrCommProcess *process, gint status, Job *job)
+{
+	job->status = status;
+	job->finished = TRUE;
+}
+
+static GebrCommProcess *
+job_new(Job *job)
+{
+	GebrCommProcess *process = gebr_comm_process_new();
+
+	job->output = g_string_new(NULL);
+	job->finished = FALSE;
+	g_signal_connect(process, "ready-read-stdout", G_CALLBACK(on_stdout), job);
+	g_signal_connect(process, "finished", G_CALLBACK(on_finished), job);
+
+	return process;
+}
+
+static void
+job_wait(Job *job)
+{
+	GTimer *timer = g_timer_new();
+
+	while (!job->finished && g_timer_elapsed(timer, NULL) < 10)
+		if (!g_main_context_iteration(NULL, FALSE))
+			g_usleep(1000);
+
+	g_timer_destroy(timer);
+	g_assert(job->finished);
+}
+
+static void
+test_launcher_spawn(void)
+{
+	GebrdLauncher *launcher;
+	GebrCommProcess *process;
+	gchar *name = g_strdup_printf("gebrd-test-launcher-%d", (gint) getpid());
+	gchar *home = g_build_filename(g_get_tmp_dir(), name, NULL);
+	gchar *profile = g_build_filename(home, ".bash_profile", NULL);
+	gchar *saved_home = g_strdup(g_getenv("HOME"));
+	GTimer *timer;
+	Job job;
+
+	/* The login environment comes from the profile in this home */
+	g_mkdir_with_parents(home, 0700);
+	g_assert(g_file_set_contents(profile, "export GEBRD_TEST_PROFILE=first\n", -1, NULL));
+	g_setenv("HOME", home, TRUE);
+	g_setenv("GEBRD_TEST_LAUNCHER", "inherited", TRUE);
+	launcher = gebrd_launcher_new();
+	g_assert(launcher != NULL);
+
+	process = job_new(&job);
+	g_assert(gebrd_launcher_spawn(launcher, process,
+				      "echo $GEBRD_TEST_LAUNCHER $GEBRD_TEST_PROFILE; exit 3"));
+	job_wait(&job);
+	g_assert(strstr(job.output->str, "inherited first\n") != NULL);
+	g_assert(WIFEXITED(job.status));
+	g_assert_cmpint(WEXITSTATUS(job.status), ==, 3);
+	g_string_free(job.output, TRUE);
+
+	/* The profile changed, which the next job sees after a refresh. The
+	 * same process is used again, as by the loop steps. The daemon does not
+	 * wait for the slow profile to be read again. */
+	g_assert(g_file_set_contents(profile, "sleep 2\nexport GEBRD_TEST_PROFILE=second\n", -1, NULL));
+	gebrd_launcher_refresh(launcher);
+	job.output = g_string_new(NULL);
+	job.finished = FALSE;
+	timer = g_timer_new();
+	g_assert(gebrd_launcher_spawn(launcher, process, "echo $GEBRD_TEST_PROFILE"));
+	g_assert_cmpfloat(g_timer_elapsed(timer, NULL), <, 1);
+	g_timer_destroy(timer);
+	job_wait(&job);
+	g_assert_cmpstr(job.output->str, ==, "second\n");
+	g_assert_cmpint(WEXITSTATUS(job.status), ==, 0);
+	g_string_free(job.output, TRUE);
+
+	gebr_comm_process_free(process);
+	gebrd_launcher_free(launcher);
+
+	if (saved_home)
+		g_setenv("HOME", saved_home, TRUE);
+	g_unlink(profile);
+	g_rmdir(home);
+	g_free(saved_home);
+	g_free(profile);
+	g_free(home);
+	g_free(name);
+}
+
+static void
+test_launcher_kill(void)
+{
+	GebrdLauncher *launcher = gebrd_launcher_new();
+	GebrCommProcess *process;
+	Job job;
+
+	process = job_new(&job);
+	g_assert(gebrd_launcher_spawn(launcher, process, "sleep 30 | cat"));
+	g_assert(gebr_comm_process_is_running(process));
+
+	/* The whole group is killed */
+	gebr_comm_process_kill(process);
+	job_wait(&job);
+	g_assert(WIFSIGNALED(job.status));
+	g_assert_cmpint(WTERMSIG(job.status), ==, SIGKILL);
+	g_assert(!gebr_comm_process_is_running(process));
+
+	g_string_free(job.output, TRUE);
+	gebr_comm_process_free(process);
+	gebrd_launcher_free(launcher);
+}
+
+int main(int argc, char * argv[])
+{
+	g_type_init();
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add_func("/gebrd/launcher/spawn", test_launcher_spawn);
+	g_test_add_func("/gebrd/launcher/kill", test_launcher_kill);
+
+	return g_test_run();
+}
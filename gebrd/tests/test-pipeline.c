@@ -0,0 +1,315 @@
+/*   GeBR Daemon - Process and control execution of flows
+ *   Copyright (C) 2007-2012 GeBR core team (http://www.gebrproject.com/)
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#include "../gebrd-pipeline.h"
+
+static GHashTable *
+vars_new(void)
+{
+	GHashTable *vars = g_hash_table_new(g_str_hash, g_str_equal);
+
+	g_hash_table_insert(vars, "name", "a b");
+	g_hash_table_insert(vars, "ref", "${V[1]}");
+	g_hash_table_insert(vars, "cmd", "$(ls)");
+
+	return vars;
+}
+
+static GebrdStage *
+stage(GebrdPipeline *pipeline, guint i)
+{
+	return g_ptr_array_index(pipeline->stages, i);
+}
+
+static void
+test_pipeline_resolve(void)
+{
+	gchar *values[] = { "1.5", "2", NULL };
+	GHashTable *vars = vars_new();
+	GebrdPipeline *pipeline = gebrd_pipeline_new(19);
+	GebrdPipeline *resolved;
+	GebrdStage *s;
+
+	s = gebrd_pipeline_add_stage(pipeline, "First", "prog -n\"${name}\" -v\"${V[0]}\" \"${ref}\" 'a$b' ");
+	s->in = g_strdup("in-${V[1]}");
+	s->pipe_to_next = TRUE;
+	s = gebrd_pipeline_add_stage(pipeline, "Second", "cat ");
+	s->out = g_strdup("${name}.out");
+	s->out_append = TRUE;
+
+	resolved = gebrd_pipeline_resolve(pipeline, vars, values);
+	g_assert(resolved != NULL);
+	g_assert_cmpint(resolved->nice, ==, 19);
+	g_assert_cmpuint(resolved->stages->len, ==, 2);
+
+	s = stage(resolved, 0);
+	g_assert_cmpstr(s->title, ==, "First");
+	g_assert_cmpuint(g_strv_length(s->argv), ==, 5);
+	g_assert_cmpstr(s->argv[0], ==, "prog");
+	g_assert_cmpstr(s->argv[1], ==, "-na b");
+	g_assert_cmpstr(s->argv[2], ==, "-v1.5");
+	g_assert_cmpstr(s->argv[3], ==, "2");
+	g_assert_cmpstr(s->argv[4], ==, "a$b");
+	g_assert_cmpstr(s->in, ==, "in-2");
+	g_assert(s->pipe_to_next);
+
+	s = stage(resolved, 1);
+	g_assert_cmpstr(s->out, ==, "a b.out");
+	g_assert(s->out_append);
+	g_assert(!s->pipe_to_next);
+
+	gebrd_pipeline_free(resolved);
+	gebrd_pipeline_free(pipeline);
+	g_hash_table_destroy(vars);
+}
+
+static void
+test_pipeline_needs_bash(void)
+{
+	const gchar *words[] = {
+		"prog \"${cmd}\"",	/* command substitution in a variable */
+		"prog \"${V[7]}\"",	/* no such value */
+		"prog \"${unknown}\"",
+		"prog \"$HOME\"",
+		"prog *.su",
+		"prog ~/data",
+		"prog > out",
+		"prog \"unterminated",
+	};
+	gchar *values[] = { "1", NULL };
+	GHashTable *vars = vars_new();
+
+	for (guint i = 0; i < G_N_ELEMENTS(words); i++) {
+		GebrdPipeline *pipeline = gebrd_pipeline_new(0);
+
+		gebrd_pipeline_add_stage(pipeline, "Program", words[i]);
+		g_assert(gebrd_pipeline_resolve(pipeline, vars, values) == NULL);
+		gebrd_pipeline_free(pipeline);
+	}
+
+	g_hash_table_destroy(vars);
+}
+
+static void
+test_pipeline_serialize(void)
+{
+	GebrdPipeline *pipeline = gebrd_pipeline_new(0);
+	GebrdPipeline *resolved, *copy;
+	GString *buf = g_string_new(NULL);
+	GebrdStage *s;
+
+	s = gebrd_pipeline_add_stage(pipeline, "First", "prog 'with space' ''");
+	s->err = g_strdup("err.log");
+	s->err_append = TRUE;
+	s->pipe_to_next = TRUE;
+	gebrd_pipeline_add_stage(pipeline, "Second", "cat");
+	resolved = gebrd_pipeline_resolve(pipeline, NULL, NULL);
+
+	gebrd_pipeline_serialize(resolved, buf);
+	copy = gebrd_pipeline_deserialize(buf->str, buf->len);
+	g_assert(copy != NULL);
+	g_assert_cmpuint(copy->stages->len, ==, 2);
+
+	s = stage(copy, 0);
+	g_assert_cmpstr(s->title, ==, "First");
+	g_assert_cmpuint(g_strv_length(s->argv), ==, 3);
+	g_assert_cmpstr(s->argv[1], ==, "with space");
+	g_assert_cmpstr(s->argv[2], ==, "");
+	g_assert(s->in == NULL);
+	g_assert_cmpstr(s->err, ==, "err.log");
+	g_assert(s->err_append);
+	g_assert(s->pipe_to_next);
+	g_assert_cmpstr(stage(copy, 1)->argv[0], ==, "cat");
+
+	/* Truncated data */
+	g_assert(gebrd_pipeline_deserialize(buf->str, buf->len - 2) == NULL);
+
+	gebrd_pipeline_free(copy);
+	gebrd_pipeline_free(resolved);
+	gebrd_pipeline_free(pipeline);
+	g_string_free(buf, TRUE);
+}
+
+static gchar *
+run(GebrdPipeline *pipeline, gint *code)
+{
+	GebrdPipeline *resolved = gebrd_pipeline_resolve(pipeline, NULL, NULL);
+	GString *status = g_string_new(NULL);
+	gchar buf[256];
+	gint fds[2];
+	ssize_t n;
+
+	g_assert(resolved != NULL);
+	g_assert(pipe(fds) == 0);
+	*code = gebrd_pipeline_run(resolved, fds[1]);
+	close(fds[1]);
+	while ((n = read(fds[0], buf, sizeof(buf))) > 0)
+		g_string_append_len(status, buf, n);
+	close(fds[0]);
+
+	gebrd_pipeline_free(resolved);
+	return g_string_free(status, FALSE);
+}
+
+static void
+test_pipeline_run(void)
+{
+	gchar *out, *contents, *status;
+	gchar **lines;
+	GebrdPipeline *pipeline;
+	GebrdStage *s;
+	gint code;
+
+	close(g_file_open_tmp("gebrd-pipeline-XXXXXX", &out, NULL));
+
+	/* Chained by a pipe, into a file */
+	pipeline = gebrd_pipeline_new(0);
+	s = gebrd_pipeline_add_stage(pipeline, "Print", "printf 'a\\nb\\nc\\n'");
+	s->pipe_to_next = TRUE;
+	s = gebrd_pipeline_add_stage(pipeline, "Count", "wc -l");
+	s->out = g_strdup(out);
+
+	status = run(pipeline, &code);
+	g_assert_cmpint(code, ==, 0);
+	g_assert_cmpstr(status, ==, "0 0\n1 0\n");
+	g_assert(g_file_get_contents(out, &contents, NULL, NULL));
+	g_assert_cmpint(atoi(contents), ==, 3);
+	g_free(contents);
+	g_free(status);
+
+	/* Appended to */
+	s->out_append = TRUE;
+	g_free(run(pipeline, &code));
+	g_assert(g_file_get_contents(out, &contents, NULL, NULL));
+	lines = g_strsplit(contents, "\n", -1);
+	g_assert_cmpuint(g_strv_length(lines), ==, 3);
+	g_assert_cmpint(atoi(lines[1]), ==, 3);
+	g_strfreev(lines);
+	g_free(contents);
+	gebrd_pipeline_free(pipeline);
+
+	/* One after the other, the last one gives the exit code */
+	pipeline = gebrd_pipeline_new(0);
+	gebrd_pipeline_add_stage(pipeline, "Fails", "false");
+	gebrd_pipeline_add_stage(pipeline, "Missing", "gebrd-test-no-such-program");
+
+	status = run(pipeline, &code);
+	g_assert_cmpint(code, ==, 127);
+	g_assert_cmpstr(status, ==, "0 256\n1 32512\n");
+	g_free(status);
+	gebrd_pipeline_free(pipeline);
+
+	g_unlink(out);
+	g_free(out);
+}
+
+static void
+test_pipeline_pipe_failure(void)
+{
+	gchar *out, *contents, *status;
+	GebrdPipeline *pipeline;
+	GebrdStage *s;
+	struct rlimit saved, limit;
+	gint fds[64];
+	gint nfds = 0;
+	gint code;
+
+	close(g_file_open_tmp("gebrd-pipeline-XXXXXX", &out, NULL));
+
+	pipeline = gebrd_pipeline_new(0);
+	s = gebrd_pipeline_add_stage(pipeline, "Print", "echo a");
+	s->pipe_to_next = TRUE;
+	s = gebrd_pipeline_add_stage(pipeline, "Copy", "cat");
+	s->out = g_strdup(out);
+	s = gebrd_pipeline_add_stage(pipeline, "After", "echo b");
+	s->out = g_strdup(out);
+	s->out_append = TRUE;
+
+	/* Leaves room for the pipe of the status only */
+	g_assert(getrlimit(RLIMIT_NOFILE, &saved) == 0);
+	limit = saved;
+	limit.rlim_cur = G_N_ELEMENTS(fds);
+	g_assert(setrlimit(RLIMIT_NOFILE, &limit) == 0);
+	while (nfds < (gint) G_N_ELEMENTS(fds) && (fds[nfds] = dup(0)) != -1)
+		nfds++;
+	g_assert_cmpint(nfds, >=, 2);
+	close(fds[--nfds]);
+	close(fds[--nfds]);
+
+	status = run(pipeline, &code);
+
+	while (nfds)
+		close(fds[--nfds]);
+	g_assert(setrlimit(RLIMIT_NOFILE, &saved) == 0);
+
+	/* No stage was started */
+	g_assert_cmpint(code, ==, 126);
+	g_assert_cmpstr(status, ==, "0 32256\n");
+	g_assert(g_file_get_contents(out, &contents, NULL, NULL));
+	g_assert_cmpstr(contents, ==, "");
+
+	g_free(contents);
+	g_free(status);
+	gebrd_pipeline_free(pipeline);
+	g_unlink(out);
+	g_free(out);
+}
+
+static void
+test_pipeline_pipe_size(void)
+{
+	GebrdPipeline *pipeline = gebrd_pipeline_new(0);
+	GebrdStage *s;
+
+	s = gebrd_pipeline_add_stage(pipeline, "First", "true");
+	s->pipe_to_next = TRUE;
+	s = gebrd_pipeline_add_stage(pipeline, "Second", "true");
+	s->pipe_to_next = TRUE;
+	gebrd_pipeline_add_stage(pipeline, "Third", "true");
+	s = gebrd_pipeline_add_stage(pipeline, "Last", "true");
+	s->pipe_to_next = TRUE;
+	g_assert_cmpuint(gebrd_pipeline_count_pipes(pipeline), ==, 2);
+	gebrd_pipeline_free(pipeline);
+
+	/* Enlarged while few pipes are open, then less, then not at all */
+	g_assert_cmpint(gebrd_pipeline_pipe_size(1), ==, 1024 * 1024);
+	g_assert_cmpint(gebrd_pipeline_pipe_size(16), ==, 1024 * 1024);
+	g_assert_cmpint(gebrd_pipeline_pipe_size(17), ==, 512 * 1024);
+	g_assert_cmpint(gebrd_pipeline_pipe_size(100), ==, 128 * 1024);
+	g_assert_cmpint(gebrd_pipeline_pipe_size(256), ==, 0);
+	g_assert_cmpint(gebrd_pipeline_pipe_size(4096), ==, 0);
+}
+
+int main(int argc, char * argv[])
+{
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add_func("/gebrd/pipeline/resolve", test_pipeline_resolve);
+	g_test_add_func("/gebrd/pipeline/needs-bash", test_pipeline_needs_bash);
+	g_test_add_func("/gebrd/pipeline/serialize", test_pipeline_serialize);
+	g_test_add_func("/gebrd/pipeline/run", test_pipeline_run);
+	g_test_add_func("/gebrd/pipeline/pipe-failure", test_pipeline_pipe_failure);
+	g_test_add_func("/gebrd/pipeline/pipe-size", test_pipeline_pipe_size);
+
+	return g_test_run();
+}
@@ -0,0 +1,118 @@
+/*   GeBR Daemon - Process and control execution of flows
+ *   Copyright (C) 2007-2012 GeBR core team (http://www.gebrproject.com/)
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <glib.h>
+#include <string.h>
+
+#include "../gebrd-sampler.h"
+
+static void
+test_sample_read(void)
+{
+	GebrdCpuTimes times = { 4000, 400, 9000 };
+	GebrdSample sample;
+
+	g_assert(gebrd_sample_read(TEST_DIR"/proc", &times, &sample));
+	g_assert_cmpfloat(sample.cpu, ==, 50);
+	g_assert_cmpfloat(sample.iowait, ==, 10);
+	g_assert_cmpint(sample.run_queue, ==, 3);
+	g_assert_cmpuint(sample.mem_available, ==, 2500000);
+	g_assert_cmpfloat(sample.psi_cpu, ==, 12.5);
+	g_assert_cmpfloat(sample.psi_mem, ==, 0);
+	g_assert_cmpfloat(sample.psi_io, ==, 3.25);
+	g_assert_cmpfloat(sample.load[1], ==, 1.25);
+	g_assert_cmpuint(times.total, ==, 10000);
+
+	g_assert(!gebrd_sample_read(TEST_DIR"/none", &times, &sample));
+}
+
+static void
+test_sample_diff(void)
+{
+	GebrdSample pushed = { 0, };
+	GebrdSample sample = { 0, 50, 10, 3, 2500000, 12.5, -1, 3.5, { 0.52, 1.25, 2 } };
+	gchar *delta;
+
+	delta = gebrd_sample_diff(&pushed, &sample, TRUE);
+	g_assert_cmpstr(delta, ==, "cpu=50.0 iow=10.0 rq=3 mem=2500000 psc=12.5 psi=3.5 ld=0.52,1.25,2.00");
+	g_free(delta);
+
+	/* Small changes are not pushed */
+	sample.cpu = 52;
+	sample.mem_available = 2400000;
+	delta = gebrd_sample_diff(&pushed, &sample, FALSE);
+	g_assert_cmpstr(delta, ==, "");
+	g_free(delta);
+
+	sample.cpu = 56;
+	sample.mem_available = 2000000;
+	sample.load[0] = 0.8;
+	delta = gebrd_sample_diff(&pushed, &sample, FALSE);
+	g_assert_cmpstr(delta, ==, "cpu=56.0 mem=2000000 ld=0.80,1.25,2.00");
+	g_assert_cmpfloat(pushed.cpu, ==, 56);
+	g_free(delta);
+}
+
+static void
+on_sample(GebrdSampler *sampler, const gchar *delta, gchar **received)
+{
+	g_free(*received);
+	*received = g_strdup(delta);
+}
+
+static void
+test_sampler_sync(void)
+{
+	gchar *received = NULL;
+	GebrdSample samples[4];
+	GebrdSampler *sampler = gebrd_sampler_new(TEST_DIR"/proc", 10,
+						  (GebrdSamplerFunc) on_sample, &received);
+	gchar *delta = gebrd_sampler_sync(sampler);
+
+	/* Without samples at the sync, the first one is pushed in full */
+	if (!delta) {
+		GTimer *timer = g_timer_new();
+		while (!received && g_timer_elapsed(timer, NULL) < 5)
+			if (!g_main_context_iteration(NULL, FALSE))
+				g_usleep(1000);
+		g_timer_destroy(timer);
+		delta = received;
+		received = NULL;
+	}
+
+	g_assert(delta != NULL);
+	g_assert(strstr(delta, "rq=3") != NULL);
+	g_assert(strstr(delta, "mem=2500000") != NULL);
+	g_free(delta);
+
+	g_assert_cmpuint(gebrd_sampler_get_samples(sampler, samples, 4), >=, 1);
+	g_assert_cmpint(samples[0].run_queue, ==, 3);
+
+	gebrd_sampler_free(sampler);
+	g_free(received);
+}
+
+int main(int argc, char * argv[])
+{
+	g_thread_init(NULL);
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add_func("/gebrd/sampler/sample_read", test_sample_read);
+	g_test_add_func("/gebrd/sampler/sample_diff", test_sample_diff);
+	g_test_add_func("/gebrd/sampler/sync", test_sampler_sync);
+
+	return g_test_run();
+}
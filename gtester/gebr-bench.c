@@ -0,0 +1,207 @@
+/*   GeBR - An environment for seismic processing.
+ *   Copyright (C) 2007-2012 GeBR core team (http://www.gebrproject.com/)
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gebr-bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <glib/gstdio.h>
+
+/* Calls of a sample are doubled until this fraction of the minimum time */
+#define CALIBRATION_FRACTION 0.5
+
+typedef struct {
+	gchar *name;
+	GebrBenchFunc func;
+	gpointer data;
+	gsize bytes;
+} Bench;
+
+static gchar *suite_name;
+static GList *benchs;
+
+static gint n_samples = 5;
+static gdouble min_time = 0.1;
+static gchar *output_file;
+static gchar *filter;
+static gboolean list_only;
+
+static GOptionEntry entries[] = {
+	{"samples", 0, 0, G_OPTION_ARG_INT, &n_samples, "Timed samples of each benchmark", "N"},
+	{"min-time", 0, 0, G_OPTION_ARG_DOUBLE, &min_time, "Minimum duration of a sample", "SECS"},
+	{"output", 0, 0, G_OPTION_ARG_FILENAME, &output_file, "Append the results to FILE", "FILE"},
+	{"filter", 'p', 0, G_OPTION_ARG_STRING, &filter, "Run only the benchmarks starting with NAME", "NAME"},
+	{"list", 'l', 0, G_OPTION_ARG_NONE, &list_only, "List the benchmarks", NULL},
+	{NULL}
+};
+
+static void
+log_func(const gchar *log_domain,
+	 GLogLevelFlags log_level,
+	 const gchar *message,
+	 gpointer user_data)
+{
+	/* Debug messages of the code being measured would be timed too */
+	if (log_level & (G_LOG_LEVEL_DEBUG | G_LOG_LEVEL_INFO))
+		return;
+	g_log_default_handler(log_domain, log_level, message, user_data);
+}
+
+void
+gebr_bench_init(gint *argc,
+		gchar ***argv,
+		const gchar *suite)
+{
+	GOptionContext *context;
+	GError *error = NULL;
+
+	g_type_init();
+	if (!g_thread_supported())
+		g_thread_init(NULL);
+
+	context = g_option_context_new(NULL);
+	g_option_context_add_main_entries(context, entries, NULL);
+	if (!g_option_context_parse(context, argc, argv, &error)) {
+		g_printerr("%s\n", error->message);
+		exit(1);
+	}
+	g_option_context_free(context);
+
+	n_samples = MAX(n_samples, 1);
+	suite_name = g_strdup(suite);
+	g_log_set_default_handler(log_func, NULL);
+}
+
+void
+gebr_bench_add(const gchar *name,
+	       GebrBenchFunc func,
+	       gpointer data,
+	       gsize bytes)
+{
+	Bench *bench = g_new(Bench, 1);
+
+	bench->name = g_strdup(name);
+	bench->func = func;
+	bench->data = data;
+	bench->bytes = bytes;
+	benchs = g_list_append(benchs, bench);
+}
+
+static gdouble
+time_calls(Bench *bench, gulong iterations)
+{
+	GTimer *timer = g_timer_new();
+	gdouble elapsed;
+
+	for (gulong i = 0; i < iterations; i++)
+		bench->func(bench->data);
+
+	elapsed = g_timer_elapsed(timer, NULL);
+	g_timer_destroy(timer);
+
+	return elapsed;
+}
+
+static gint
+compare_doubles(gconstpointer a,
+		gconstpointer b)
+{
+	gdouble x = *(const gdouble *) a;
+	gdouble y = *(const gdouble *) b;
+	return x < y ? -1 : x > y;
+}
+
+static gchar *
+run_bench(Bench *bench)
+{
+	gdouble *samples = g_new(gdouble, n_samples);
+	gulong iterations = 1;
+	GString *result;
+	gdouble median;
+
+	/* Warm up caches and lazy initializations */
+	bench->func(bench->data);
+
+	while (time_calls(bench, iterations) < min_time * CALIBRATION_FRACTION)
+		iterations *= 2;
+
+	for (gint i = 0; i < n_samples; i++)
+		samples[i] = time_calls(bench, iterations) * 1e9 / iterations;
+
+	qsort(samples, n_samples, sizeof(gdouble), compare_doubles);
+	median = n_samples % 2 ? samples[n_samples / 2]
+		: (samples[n_samples / 2 - 1] + samples[n_samples / 2]) / 2;
+
+	gchar *suite = g_strescape(suite_name, NULL);
+	gchar *name = g_strescape(bench->name, NULL);
+
+	result = g_string_new(NULL);
+	g_string_printf(result, "{\"suite\": \"%s\", \"name\": \"%s\", "
+			"\"iterations\": %lu, \"samples\": %d, "
+			"\"min_ns\": %.1f, \"median_ns\": %.1f, \"max_ns\": %.1f",
+			suite, name, iterations, n_samples,
+			samples[0], median, samples[n_samples - 1]);
+	if (bench->bytes)
+		g_string_append_printf(result, ", \"bytes\": %" G_GSIZE_FORMAT ", \"mb_per_s\": %.2f",
+				       bench->bytes, bench->bytes * 1e3 / median);
+	g_string_append(result, "}\n");
+
+	g_free(suite);
+	g_free(name);
+	g_free(samples);
+
+	return g_string_free(result, FALSE);
+}
+
+gint
+gebr_bench_run(void)
+{
+	FILE *output = stdout;
+	gint ret = 0;
+
+	if (output_file && !list_only && (output = g_fopen(output_file, "a")) == NULL) {
+		g_printerr("Could not open %s\n", output_file);
+		return 1;
+	}
+
+	for (GList *i = benchs; i; i = i->next) {
+		Bench *bench = i->data;
+
+		if (filter && !g_str_has_prefix(bench->name, filter))
+			continue;
+
+		if (list_only) {
+			g_print("%s/%s\n", suite_name, bench->name);
+			continue;
+		}
+
+		gchar *result = run_bench(bench);
+
+		if (output != stdout)
+			g_printerr("%s/%s\n", suite_name, bench->name);
+		if (fputs(result, output) == EOF)
+			ret = 1;
+		fflush(output);
+		g_free(result);
+	}
+
+	if (output != stdout && fclose(output) != 0)
+		ret = 1;
+
+	return ret;
+}
@@ -0,0 +1,83 @@
+/*   GeBR - An environment for seismic processing.
+ *   Copyright (C) 2007-2012 GeBR core team (http://www.gebrproject.com/)
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GEBR_BENCH_H__
+#define __GEBR_BENCH_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/**
+ * GebrBenchFunc:
+ * @data: the data given to gebr_bench_add()
+ *
+ * Runs the measured operation once.
+ */
+typedef void (*GebrBenchFunc) (gpointer data);
+
+/**
+ * gebr_bench_init:
+ * @argc: address of the argc of main()
+ * @argv: address of the argv of main()
+ * @suite: the name of the group of benchmarks, as in the results
+ *
+ * Parses the benchmark options from the command line:
+ *
+ *   --samples=N	number of timed samples of each benchmark (5)
+ *   --min-time=SECS	minimum duration of a sample (0.1)
+ *   --output=FILE	appends the results to FILE instead of printing them
+ *   -p, --filter=NAME	runs only the benchmarks whose name starts with NAME
+ *   -l, --list		lists the benchmarks and quits
+ */
+void gebr_bench_init(gint *argc,
+		     gchar ***argv,
+		     const gchar *suite);
+
+/**
+ * gebr_bench_add:
+ * @name: the name of the benchmark, like "protocol/receive"
+ * @func: the operation to measure
+ * @data: data to pass to @func calls
+ * @bytes: the amount of bytes processed by each call of @func, or 0
+ *
+ * Registers a benchmark. If @bytes is not 0, the throughput is reported too.
+ */
+void gebr_bench_add(const gchar *name,
+		    GebrBenchFunc func,
+		    gpointer data,
+		    gsize bytes);
+
+/**
+ * gebr_bench_run:
+ *
+ * Runs the benchmarks in the order they were added. Each one is run once to
+ * warm up, then the number of calls that lasts the minimum sample time is
+ * found and that many calls are timed for each sample.
+ *
+ * The results are written as JSON, one object per line, with the "suite",
+ * the "name", the "iterations" of each sample, the "samples", and the
+ * "min_ns", "median_ns" and "max_ns" per call. Benchmarks with a size
+ * also have "bytes" and the "mb_per_s" of the median.
+ *
+ * Returns: 0, or 1 if the results could not be written.
+ */
+gint gebr_bench_run(void);
+
+G_END_DECLS
+
+#endif /* __GEBR_BENCH_H__ */
@@ -68,3 +68,43 @@ gebr_comm_daemon_get_flavors(GebrCommDaemon *daemon)
 {
 	return GEBR_COMM_DAEMON_GET_IFACE(daemon)->get_flavors(daemon);
 }
+
+const gchar *
+gebr_comm_daemon_get_load(GebrCommDaemon *daemon)
+{
+	return GEBR_COMM_DAEMON_GET_IFACE(daemon)->get_load(daemon);
+}
+
+void
+gebr_comm_daemon_reserve_cores(GebrCommDaemon *daemon, gint ncores)
+{
+	GEBR_COMM_DAEMON_GET_IFACE(daemon)->reserve_cores(daemon, ncores);
+}
+
+gdouble
+gebr_comm_daemon_get_reserved_cores(GebrCommDaemon *daemon)
+{
+	return GEBR_COMM_DAEMON_GET_IFACE(daemon)->get_reserved_cores(daemon);
+}
+
+gdouble
+gebr_comm_daemon_get_busy_cores(GebrCommDaemon *daemon)
+{
+	GebrCommDaemonIface *iface = GEBR_COMM_DAEMON_GET_IFACE(daemon);
+
+	if (!iface->get_busy_cores)
+		return -1;
+
+	return iface->get_busy_cores(daemon);
+}
+
+gdouble
+gebr_comm_daemon_get_stall(GebrCommDaemon *daemon)
+{
+	GebrCommDaemonIface *iface = GEBR_COMM_DAEMON_GET_IFACE(daemon);
+
+	if (!iface->get_stall)
+		return 0;
+
+	return iface->get_stall(daemon);
+}
@@ -50,6 +50,16 @@ struct _GebrCommDaemonIface {
 	gboolean  (*can_execute) (GebrCommDaemon *daemon);
 
 	const gchar * (*get_flavors) (GebrCommDaemon *daemon);
+
+	const gchar * (*get_load) (GebrCommDaemon *daemon);
+
+	void (*reserve_cores) (GebrCommDaemon *daemon, gint ncores);
+
+	gdouble (*get_reserved_cores) (GebrCommDaemon *daemon);
+
+	gdouble (*get_busy_cores) (GebrCommDaemon *daemon);
+
+	gdouble (*get_stall) (GebrCommDaemon *daemon);
 };
 
 GType gebr_comm_daemon_get_type(void) G_GNUC_CONST;
@@ -66,4 +76,45 @@ gboolean gebr_comm_daemon_can_execute(GebrCommDaemon *daemon);
 
 const gchar *gebr_comm_daemon_get_flavors(GebrCommDaemon *daemon);
 
+/**
+ * gebr_comm_daemon_get_load:
+ *
+ * Returns: the last load averages pushed by @daemon, in the format of
+ * `/proc/loadavg', or %NULL if there is no recent sample.
+ */
+const gchar *gebr_comm_daemon_get_load(GebrCommDaemon *daemon);
+
+/**
+ * gebr_comm_daemon_reserve_cores:
+ *
+ * Reserves @ncores of @daemon for a task that was just sent to it, until its
+ * load averages account for the new processes.
+ */
+void gebr_comm_daemon_reserve_cores(GebrCommDaemon *daemon, gint ncores);
+
+/**
+ * gebr_comm_daemon_get_reserved_cores:
+ *
+ * Returns: the number of cores reserved by gebr_comm_daemon_reserve_cores()
+ * which are not yet reflected by the samples or load averages of @daemon.
+ */
+gdouble gebr_comm_daemon_get_reserved_cores(GebrCommDaemon *daemon);
+
+/**
+ * gebr_comm_daemon_get_busy_cores:
+ *
+ * Returns: how many cores of @daemon are busy right now, from its last
+ * resource sample, or a negative value if there is no recent sample and only
+ * the load averages can be used.
+ */
+gdouble gebr_comm_daemon_get_busy_cores(GebrCommDaemon *daemon);
+
+/**
+ * gebr_comm_daemon_get_stall:
+ *
+ * Returns: the fraction, from 0 to 1, of the time the tasks of @daemon are
+ * stalled waiting for memory or I/O, or 0 if it is not known.
+ */
+gdouble gebr_comm_daemon_get_stall(GebrCommDaemon *daemon);
+
 #endif /* __GEBR_COMM_DAEMON_H__ */
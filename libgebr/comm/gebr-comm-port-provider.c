@@ -24,6 +24,7 @@
 #include <string.h>
 #include <sys/wait.h>
 #include "gebr-comm-ssh.h"
+#include "gebr-comm-transport-pool.h"
 #include <libgebr/utils.h>
 #include "gebr-comm-terminalprocess.h"
 
@@ -33,7 +34,9 @@
 #include "gebr-comm-utils.h"
 
 struct _GebrCommPortForward {
-	GebrCommSsh *ssh;
+	GebrCommTransportPool *pool;
+	gchar *address;
+	gchar *forward;
 };
 
 struct _GebrCommPortProviderPriv {
@@ -42,15 +45,10 @@ struct _GebrCommPortProviderPriv {
 	gchar *address;
 	gchar *sftp_address;
 	guint display;
-	GebrCommSsh *ssh_forward;
+	GebrCommSsh *session;
 	GebrCommPortForward *forward;
 };
 
-static gchar *get_local_forward_command(GebrCommPortProvider *self,
-					guint *port,
-					const gchar *addr,
-					guint remote_port);
-
 static gboolean get_port_from_command_output(GebrCommPortProvider *self,
                                              const gchar *buffer,
                                              guint *port);
@@ -340,7 +338,7 @@ start(GebrCommPortProvider *self, struct PortProviderVirtualMethods *vmethods)
 
 /* Set our own error*/
 static void
-transform_spawn_sync_error(GError *error, GError **local_error)
+transform_spawn_error(GError *error, GError **local_error)
 {
 	if (!error)
 		return;
@@ -358,12 +356,61 @@ transform_spawn_sync_error(GError *error, GError **local_error)
 		    error_msg);
 }
 
+typedef struct {
+	GebrCommPortProvider *self;
+	gchar *forward;
+	guint port;
+} PendingForward;
+
 static void
-set_forward(GebrCommPortProvider *self, GebrCommSsh *ssh)
+on_forward_ready(GebrCommTransportPool *pool,
+		 const gchar *address,
+		 GError *error,
+		 PendingForward *pending)
+{
+	GebrCommPortProvider *self = pending->self;
+
+	if (error) {
+		GError *local_error = NULL;
+		g_set_error(&local_error, GEBR_COMM_PORT_PROVIDER_ERROR,
+			    GEBR_COMM_PORT_PROVIDER_ERROR_SSH,
+			    "%s", error->message);
+		emit_signals(self, 0, local_error);
+		g_error_free(local_error);
+		g_free(pending->forward);
+	} else {
+		self->priv->forward = g_new0(GebrCommPortForward, 1);
+		self->priv->forward->pool = pool;
+		self->priv->forward->address = g_strdup(address);
+		self->priv->forward->forward = pending->forward;
+		emit_signals(self, pending->port, NULL);
+	}
+
+	g_object_unref(self);
+	g_free(pending);
+}
+
+/*
+ * add_forward:
+ *
+ * Adds @forward to the session of the address of @self, keeping it in the
+ * #GebrCommPortForward of @self so it can be closed later, and emits @port
+ * once it is ready.
+ */
+static void
+add_forward(GebrCommPortProvider *self, const gchar *forward, guint port)
 {
+	GebrCommTransportPool *pool = gebr_comm_transport_pool_get_default();
+	PendingForward *pending;
+
 	g_return_if_fail(self->priv->forward == NULL);
-	self->priv->forward = g_new0(GebrCommPortForward, 1);
-	self->priv->forward->ssh = ssh;
+
+	pending = g_new(PendingForward, 1);
+	pending->self = g_object_ref(self);
+	pending->forward = g_strdup(forward);
+	pending->port = port;
+	gebr_comm_transport_pool_forward(pool, self->priv->address, forward,
+					 (GebrCommTransportReadyFunc) on_forward_ready, pending);
 }
 
 static guint
@@ -381,34 +428,115 @@ get_port(GebrCommPortProvider *self)
 }
 
 /* Local port provider implementation {{{ */
+/*
+ * LocalLaunch:
+ *
+ * The gebrm or gebrd being started in this machine. It prints its port and
+ * exits, leaving the server in background; the port is only read when both
+ * its output was closed and it exited.
+ */
+typedef struct {
+	GebrCommPortProvider *self;
+	GString *output;
+	gboolean eof;
+	gboolean exited;
+	gint status;
+} LocalLaunch;
+
 static void
-local_get_port(GebrCommPortProvider *self, gboolean maestro)
+local_launch_finish(LocalLaunch *launch)
 {
-	const gchar *binary = maestro ? "gebrm":"gebrd";
-	gchar *output = NULL;
-	gchar *err = NULL;
-	gint status;
+	GebrCommPortProvider *self = launch->self;
 	GError *error = NULL;
+	guint port = 0;
 
-	g_spawn_command_line_sync(binary, &output, &err, &status, &error);
+	if (!launch->eof || !launch->exited)
+		return;
 
-	GError *local_error = NULL;
+	if (!WIFEXITED(launch->status) || WEXITSTATUS(launch->status) != 0)
+		g_set_error(&error, GEBR_COMM_PORT_PROVIDER_ERROR,
+			    GEBR_COMM_PORT_PROVIDER_ERROR_SPAWN,
+			    "Error in the process execution");
+	else if (!get_port_from_command_output(self, launch->output->str, &port))
+		goto out;
 
-	guint port;
+	emit_signals(self, port, error);
+	if (error)
+		g_error_free(error);
 
-	if (error || (WIFEXITED(status) && WEXITSTATUS(status) != 0)) {
-		transform_spawn_sync_error(error, &local_error);
-		g_clear_error(&error);
-	} else if (output) {
-		if (!get_port_from_command_output(self, output, &port))
-			return;
-	} else {
-		g_warn_if_reached();
+out:
+	g_string_free(launch->output, TRUE);
+	g_free(launch);
+	g_object_unref(self);
+}
+
+static gboolean
+on_local_launch_output(GIOChannel *channel,
+		       GIOCondition condition,
+		       LocalLaunch *launch)
+{
+	gchar buffer[1024];
+	gsize len = 0;
+	GIOStatus status;
+
+	status = g_io_channel_read_chars(channel, buffer, sizeof(buffer), &len, NULL);
+	if (len)
+		g_string_append_len(launch->output, buffer, len);
+
+	if (status == G_IO_STATUS_NORMAL || status == G_IO_STATUS_AGAIN)
+		return TRUE;
+
+	launch->eof = TRUE;
+	local_launch_finish(launch);
+	return FALSE;
+}
+
+static void
+on_local_launch_exit(GPid pid,
+		     gint status,
+		     LocalLaunch *launch)
+{
+	g_spawn_close_pid(pid);
+	launch->exited = TRUE;
+	launch->status = status;
+	local_launch_finish(launch);
+}
+
+static void
+local_get_port(GebrCommPortProvider *self, gboolean maestro)
+{
+	gchar *argv[] = { maestro ? "gebrm" : "gebrd", NULL };
+	GError *error = NULL;
+	GError *local_error = NULL;
+	GIOChannel *channel;
+	gint out_fd;
+	GPid pid;
+
+	if (!g_spawn_async_with_pipes(NULL, argv, NULL,
+				      G_SPAWN_SEARCH_PATH | G_SPAWN_DO_NOT_REAP_CHILD
+				      | G_SPAWN_STDERR_TO_DEV_NULL,
+				      NULL, NULL, &pid, NULL, &out_fd, NULL, &error)) {
+		transform_spawn_error(error, &local_error);
+		emit_signals(self, 0, local_error);
+		g_error_free(local_error);
+		g_error_free(error);
+		return;
 	}
 
-	emit_signals(self, port, error);
+	/* Released when the port is read or on error */
+	LocalLaunch *launch = g_new0(LocalLaunch, 1);
+	launch->self = g_object_ref(self);
+	launch->output = g_string_new(NULL);
 
-	g_free(output);
+	channel = g_io_channel_unix_new(out_fd);
+	g_io_channel_set_close_on_unref(channel, TRUE);
+	g_io_channel_set_encoding(channel, NULL, NULL);
+	g_io_channel_set_flags(channel, G_IO_FLAG_NONBLOCK, NULL);
+	g_io_add_watch(channel, G_IO_IN | G_IO_HUP | G_IO_ERR,
+		       (GIOFunc) on_local_launch_output, launch);
+	g_io_channel_unref(channel);
+
+	g_child_watch_add(pid, (GChildWatchFunc) on_local_launch_exit, launch);
 }
 
 void
@@ -454,40 +582,12 @@ on_ssh_question(GebrCommSsh *ssh, const gchar *question, GebrCommPortProvider *s
 	g_signal_emit(self, signals[QUESTION], 0, ssh, question);
 }
 
-static void
-on_ssh_error(GebrCommSsh *ssh, const gchar *msg, GebrCommPortProvider *self)
-{
-	GError *error = NULL;
-	g_set_error(&error, GEBR_COMM_PORT_PROVIDER_ERROR,
-		    GEBR_COMM_PORT_PROVIDER_ERROR_SSH,
-		    "%s", msg);
-	emit_signals(self, 0, error);
-}
-
 static void
 on_ssh_key(GebrCommSsh *ssh, gboolean accepts_key, GebrCommPortProvider *self)
 {
 	g_signal_emit(self, signals[ACCEPTS_KEY], 0, accepts_key);
 }
 
-struct TunnelPollData {
-	GebrCommPortProvider *self;
-	guint port;
-};
-
-static gboolean
-tunnel_poll_port(gpointer user_data)
-{
-	struct TunnelPollData *data = user_data;
-
-	if (gebr_comm_listen_socket_is_local_port_available(data->port))
-		return TRUE;
-
-	emit_signals(data->self, data->port, NULL);
-	g_free(data);
-	return FALSE;
-}
-
 static gboolean
 get_port_from_command_output(GebrCommPortProvider *self,
                              const gchar *buffer,
@@ -521,85 +621,103 @@ get_port_from_command_output(GebrCommPortProvider *self,
 	return TRUE;
 }
 
+/*
+ * get_local_forward:
+ *
+ * Returns the ssh specification to forward a free local port, stored in
+ * @port, to @remote_port of @addr as seen by the remote host.
+ */
+static gchar *
+get_local_forward(GebrCommPortProvider *self,
+		  guint *port,
+		  const gchar *addr,
+		  guint remote_port)
+{
+	*port = get_port(self);
+	return g_strdup_printf("-L %d:%s:%d", *port, addr, remote_port);
+}
+
+static gboolean
+unref_in_idle(gpointer object)
+{
+	g_object_unref(object);
+	return FALSE;
+}
+
+/*
+ * launch_finish:
+ *
+ * Releases the @ssh that launched the daemon or maestro. It is emitting a
+ * signal, so it is only freed in the next iteration of the main loop.
+ */
+static void
+launch_finish(GebrCommSsh *ssh, GebrCommPortProvider *self)
+{
+	g_signal_handlers_disconnect_matched(ssh, G_SIGNAL_MATCH_DATA, 0, 0, NULL, NULL, self);
+	g_idle_add(unref_in_idle, ssh);
+	g_object_unref(self);
+}
+
 static void
-on_ssh_stdout(GebrCommSsh *_ssh, const GString *buffer, GebrCommPortProvider *self)
+on_ssh_stdout(GebrCommSsh *ssh, const GString *buffer, GebrCommPortProvider *self)
 {
 	guint port = 2125;
 	guint remote_port;
 
 	if (!get_port_from_command_output(self, buffer->str, &remote_port))
-		return;
+		goto out;
 
-	gchar *command = get_local_forward_command(self, &port, "127.0.0.1", remote_port);
-
-	GebrCommSsh *ssh = gebr_comm_ssh_new();
-	g_signal_connect(ssh, "ssh-password", G_CALLBACK(on_ssh_password), self);
-	g_signal_connect(ssh, "ssh-question", G_CALLBACK(on_ssh_question), self);
-	g_signal_connect(ssh, "ssh-error", G_CALLBACK(on_ssh_error), self);
-	gebr_comm_ssh_set_command(ssh, command);
-	set_forward(self, ssh);
-	gebr_comm_ssh_run(ssh);
-	g_free(command);
+	gchar *forward = get_local_forward(self, &port, "127.0.0.1", remote_port);
+	add_forward(self, forward, port);
+	g_free(forward);
 
-	struct TunnelPollData *data = g_new(struct TunnelPollData, 1);
-	data->self = self;
-	data->port = port;
-	g_timeout_add(200, tunnel_poll_port, data);
+out:
+	launch_finish(ssh, self);
 }
 
-static gchar *
-get_launch_command(GebrCommPortProvider *self, gboolean is_maestro)
+static void
+on_launch_error(GebrCommSsh *ssh, const gchar *msg, GebrCommPortProvider *self)
 {
-	const gchar *binary = is_maestro ? "gebrm" : "gebrd";
-
-	gchar *ssh_cmd = gebr_comm_get_ssh_command_with_key();
-
-	GString *cmd_line = g_string_new(NULL);
-	g_string_printf(cmd_line, "%s -v -x %s \"bash -l -c '%s >&3' 3>&1 >/dev/null 2>&1\"",
-	                ssh_cmd, self->priv->address, binary);
-	gchar *cmd = g_shell_quote(cmd_line->str);
-
-	g_string_printf(cmd_line, "bash -c %s", cmd);
-
-	g_free(cmd);
-	g_free(ssh_cmd);
+	GError *error = NULL;
+	g_set_error(&error, GEBR_COMM_PORT_PROVIDER_ERROR,
+		    GEBR_COMM_PORT_PROVIDER_ERROR_SSH,
+		    "%s", msg);
+	emit_signals(self, 0, error);
+	g_error_free(error);
 
-	return g_string_free(cmd_line, FALSE);
+	launch_finish(ssh, self);
 }
 
-void
-remote_get_port(GebrCommPortProvider *self, gboolean is_maestro)
+static void
+launch(GebrCommPortProvider *self, gboolean is_maestro)
 {
+	GebrCommTransportPool *pool = gebr_comm_transport_pool_get_default();
+	const gchar *binary = is_maestro ? "gebrm" : "gebrd";
+
+	gchar *remote = g_strdup_printf("\"bash -l -c '%s >&3' 3>&1 >/dev/null 2>&1\"", binary);
+	gchar *ssh_cmd = gebr_comm_transport_pool_get_command(pool, self->priv->address, "-v -x", remote);
+	gchar *quoted = g_shell_quote(ssh_cmd);
+	gchar *command = g_strdup_printf("bash -c %s", quoted);
+
+	/* Released when the port is read or on error */
 	GebrCommSsh *ssh = gebr_comm_ssh_new();
-	g_signal_connect(ssh, "ssh-password", G_CALLBACK(on_ssh_password), self);
-	g_signal_connect(ssh, "ssh-question", G_CALLBACK(on_ssh_question), self);
-	g_signal_connect(ssh, "ssh-error", G_CALLBACK(on_ssh_error), self);
+	g_object_ref(self);
+	g_signal_connect(ssh, "ssh-error", G_CALLBACK(on_launch_error), self);
 	g_signal_connect(ssh, "ssh-stdout", G_CALLBACK(on_ssh_stdout), self);
-	g_signal_connect(ssh, "ssh-key", G_CALLBACK(on_ssh_key), self);
-	gchar *command = get_launch_command(self, is_maestro);
 	gebr_comm_ssh_set_command(ssh, command);
 	gebr_comm_ssh_run(ssh);
-	g_free(command);
-}
-
-void
-remote_get_maestro_port(GebrCommPortProvider *self)
-{
-	remote_get_port(self, TRUE);
-}
 
-void
-remote_get_daemon_port(GebrCommPortProvider *self)
-{
-	remote_get_port(self, FALSE);
+	g_free(command);
+	g_free(quoted);
+	g_free(ssh_cmd);
+	g_free(remote);
 }
 
-static gchar *
-get_x11_command(GebrCommPortProvider *self, guint *x11_port)
+static void
+forward_x11(GebrCommPortProvider *self)
 {
-	gchar *ssh_cmd;
+	static guint x11_port = 6010;
 	guint16 display_number = 0;
-	GString *cmd_line;
 	GString *display_host = g_string_new(NULL);
 
 	gchar *display = getenv("DISPLAY");
@@ -611,79 +729,128 @@ get_x11_command(GebrCommPortProvider *self, guint *x11_port)
 		GString *tmp = g_string_new(strchr(display, ':'));
 		if (sscanf(tmp->str, ":%hu.", &display_number) != 1)
 			display_number = 0;
+		g_string_free(tmp, TRUE);
 	}
 
 	if (!display_host->len)
 		g_string_assign(display_host, "127.0.0.1");
 
 	if (!display_number)
-		*x11_port = get_port(self);
+		x11_port = get_port(self);
 	else
-		*x11_port = display_number + 6000;
+		x11_port = display_number + 6000;
 
-	ssh_cmd = gebr_comm_get_ssh_command_with_key();
-	cmd_line = g_string_new(NULL);
-	g_string_printf(cmd_line, "%s -x -R %d:%s:%d %s -N", ssh_cmd, self->priv->display,
-			display_host->str, *x11_port, self->priv->address);
+	gchar *forward = g_strdup_printf("-R %d:%s:%d", self->priv->display,
+					 display_host->str, x11_port);
+	add_forward(self, forward, x11_port);
 
-	g_free(ssh_cmd);
-
-	return g_string_free(cmd_line, FALSE);
+	g_free(forward);
+	g_string_free(display_host, TRUE);
 }
 
-void
-remote_get_x11_port(GebrCommPortProvider *self)
+static void
+forward_sftp(GebrCommPortProvider *self)
 {
-	static guint x11_port = 6010;
-	GebrCommSsh *ssh = gebr_comm_ssh_new();
-	g_signal_connect(ssh, "ssh-password", G_CALLBACK(on_ssh_password), self);
-	g_signal_connect(ssh, "ssh-question", G_CALLBACK(on_ssh_question), self);
-	g_signal_connect(ssh, "ssh-error", G_CALLBACK(on_ssh_error), self);
-	gchar *command = get_x11_command(self, &x11_port);
-	gebr_comm_ssh_set_command(ssh, command);
-	set_forward(self, ssh);
-	gebr_comm_ssh_run(ssh);
-	g_free(command);
-	emit_signals(self, x11_port, NULL);
+	guint port = 2000;
+	gchar *forward = get_local_forward(self, &port, self->priv->sftp_address, 22);
+
+	add_forward(self, forward, port);
+
+	g_free(forward);
 }
 
-static gchar *
-get_local_forward_command(GebrCommPortProvider *self,
-			  guint *port,
-			  const gchar *addr,
-			  guint remote_port)
-{
-	gchar *ssh_cmd = gebr_comm_get_ssh_command_with_key();
-	GString *string = g_string_new(NULL);
+/*
+ * on_transport_ready:
+ *
+ * Called when the session with the address of @self is up, in which case
+ * the request of @self is carried by the session.
+ */
+static void
+on_transport_ready(GebrCommTransportPool *pool,
+		   const gchar *address,
+		   GError *error,
+		   GebrCommPortProvider *self)
+{
+	if (self->priv->session) {
+		g_signal_handlers_disconnect_matched(self->priv->session, G_SIGNAL_MATCH_DATA,
+						     0, 0, NULL, NULL, self);
+		self->priv->session = NULL;
+	}
 
-	*port = get_port(self);
+	if (error) {
+		GError *local_error = NULL;
+		g_set_error(&local_error, GEBR_COMM_PORT_PROVIDER_ERROR,
+			    GEBR_COMM_PORT_PROVIDER_ERROR_SSH,
+			    "%s", error->message);
+		emit_signals(self, 0, local_error);
+		g_error_free(local_error);
+	} else {
+		switch (self->priv->type)
+		{
+		case GEBR_COMM_PORT_TYPE_MAESTRO:
+			launch(self, TRUE);
+			break;
+		case GEBR_COMM_PORT_TYPE_DAEMON:
+			launch(self, FALSE);
+			break;
+		case GEBR_COMM_PORT_TYPE_X11:
+			forward_x11(self);
+			break;
+		case GEBR_COMM_PORT_TYPE_SFTP:
+			forward_sftp(self);
+			break;
+		}
+	}
 
-	g_string_printf(string, "%s -x -L %d:%s:%d %s -N", ssh_cmd, *port,
-			addr, remote_port, self->priv->address);
+	g_object_unref(self);
+}
 
-	g_free(ssh_cmd);
+/*
+ * acquire_transport:
+ *
+ * Waits for the session with the address of @self. If this request opens
+ * the session, its password and questions are asked through @self.
+ */
+static void
+acquire_transport(GebrCommPortProvider *self)
+{
+	GebrCommTransportPool *pool = gebr_comm_transport_pool_get_default();
+	GebrCommSsh *session;
+
+	g_object_ref(self);
+	session = gebr_comm_transport_pool_acquire(pool, self->priv->address,
+						   (GebrCommTransportReadyFunc) on_transport_ready,
+						   self);
+	if (session) {
+		self->priv->session = session;
+		g_signal_connect(session, "ssh-password", G_CALLBACK(on_ssh_password), self);
+		g_signal_connect(session, "ssh-question", G_CALLBACK(on_ssh_question), self);
+		g_signal_connect(session, "ssh-key", G_CALLBACK(on_ssh_key), self);
+	}
+}
 
-	return g_string_free(string, FALSE);
+void
+remote_get_maestro_port(GebrCommPortProvider *self)
+{
+	acquire_transport(self);
 }
 
 void
-remote_get_sftp_port(GebrCommPortProvider *self)
+remote_get_daemon_port(GebrCommPortProvider *self)
 {
-	guint port = 2000;
-	GebrCommSsh *ssh = gebr_comm_ssh_new();
-	g_signal_connect(ssh, "ssh-password", G_CALLBACK(on_ssh_password), self);
-	g_signal_connect(ssh, "ssh-question", G_CALLBACK(on_ssh_question), self);
-	g_signal_connect(ssh, "ssh-error", G_CALLBACK(on_ssh_error), self);
-	gchar *command = get_local_forward_command(self, &port, self->priv->sftp_address, 22);
-	gebr_comm_ssh_set_command(ssh, command);
-	set_forward(self, ssh);
-	gebr_comm_ssh_run(ssh);
-	g_free(command);
+	acquire_transport(self);
+}
 
-	struct TunnelPollData *data = g_new(struct TunnelPollData, 1);
-	data->self = self;
-	data->port = port;
-	g_timeout_add(200, tunnel_poll_port, data);
+void
+remote_get_x11_port(GebrCommPortProvider *self)
+{
+	acquire_transport(self);
+}
+
+void
+remote_get_sftp_port(GebrCommPortProvider *self)
+{
+	acquire_transport(self);
 }
 
 /* Authentication keys methods*/
@@ -748,16 +915,20 @@ gebr_comm_port_forward_close(GebrCommPortForward *port_forward)
 {
 	g_return_if_fail(port_forward != NULL);
 
-	if (port_forward->ssh) {
-		gebr_comm_ssh_kill(port_forward->ssh);
-		g_object_unref(port_forward->ssh);
-		port_forward->ssh = NULL;
+	if (port_forward->forward) {
+		gebr_comm_transport_pool_cancel_forward(port_forward->pool,
+							port_forward->address,
+							port_forward->forward);
+		g_free(port_forward->forward);
+		port_forward->forward = NULL;
 	}
 }
 
 void
 gebr_comm_port_forward_free(GebrCommPortForward *port_forward)
 {
+	g_free(port_forward->address);
+	g_free(port_forward->forward);
 	g_free(port_forward);
 }
 /* }}} */
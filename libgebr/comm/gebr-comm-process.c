@@ -193,6 +193,40 @@ static void __gebr_comm_process_finished_watch(GPid pid, gint status, GebrCommPr
 	g_signal_emit(process, object_signals[FINISHED], 0, status);
 }
 
+/*
+ * Creates the io channels of the pipes of a started process and watches them.
+ */
+static void __gebr_comm_process_watch_fds(GebrCommProcess * process, gint stdin_fd, gint stdout_fd, gint stderr_fd)
+{
+	GError *error = NULL;
+
+	process->is_running = TRUE;
+	/* create io channels */
+	process->stdin_io_channel = g_io_channel_unix_new(stdin_fd);
+	process->stdout_io_channel = g_io_channel_unix_new(stdout_fd);
+	process->stderr_io_channel = g_io_channel_unix_new(stderr_fd);
+	/* watches */
+	process->stdout_watch_id = g_io_add_watch(process->stdout_io_channel,
+						  G_IO_IN | G_IO_PRI | G_IO_HUP | G_IO_ERR | G_IO_NVAL,
+						  (GIOFunc) __gebr_comm_process_read_stdout_watch, process);
+	process->stderr_watch_id = g_io_add_watch(process->stderr_io_channel,
+						  G_IO_IN | G_IO_PRI | G_IO_HUP | G_IO_ERR | G_IO_NVAL,
+						  (GIOFunc) __gebr_comm_process_read_stderr_watch, process);
+	/* nonblock operations */
+	g_io_channel_set_flags(process->stdin_io_channel,
+			       g_io_channel_get_flags(process->stdin_io_channel) | G_IO_FLAG_NONBLOCK, &error);
+	g_io_channel_set_flags(process->stdout_io_channel,
+			       g_io_channel_get_flags(process->stdout_io_channel) | G_IO_FLAG_NONBLOCK, &error);
+	g_io_channel_set_flags(process->stderr_io_channel,
+			       g_io_channel_get_flags(process->stderr_io_channel) | G_IO_FLAG_NONBLOCK, &error);
+
+	/* there is already something available now? */
+	if (gebr_comm_process_stdout_bytes_available(process))
+		g_signal_emit(process, object_signals[READY_READ_STDOUT], 0);
+	if (gebr_comm_process_stderr_bytes_available(process))
+		g_signal_emit(process, object_signals[READY_READ_STDERR], 0);
+}
+
 static GByteArray *__gebr_comm_process_read(GIOChannel * io_channel, gsize max_size)
 {
 	guint8 buffer[max_size];
@@ -260,7 +294,6 @@ gboolean gebr_comm_process_start(GebrCommProcess * process, GString * cmd_line)
 	gboolean ret;
 	gchar **argv;
 	gint argc;
-	gint stdin_fd, stdout_fd, stderr_fd;
 	int stdin_pipe[2], stdout_pipe[2], stderr_pipe[2];
 	GError *error;
 
@@ -302,43 +335,43 @@ gboolean gebr_comm_process_start(GebrCommProcess * process, GString * cmd_line)
 	close(stdin_pipe[0]);
 	close(stdout_pipe[1]);
 	close(stderr_pipe[1]);
-	stdin_fd = stdin_pipe[1];
-	stdout_fd = stdout_pipe[0];
-	stderr_fd = stderr_pipe[0];
 
-	process->is_running = TRUE;
 	process->finish_watch_id =
 	    g_child_watch_add(process->pid, (GChildWatchFunc) __gebr_comm_process_finished_watch, process);
-	/* create io channels */
-	process->stdin_io_channel = g_io_channel_unix_new(stdin_fd);
-	process->stdout_io_channel = g_io_channel_unix_new(stdout_fd);
-	process->stderr_io_channel = g_io_channel_unix_new(stderr_fd);
-	/* watches */
-	process->stdout_watch_id = g_io_add_watch(process->stdout_io_channel,
-						  G_IO_IN | G_IO_PRI | G_IO_HUP | G_IO_ERR | G_IO_NVAL,
-						  (GIOFunc) __gebr_comm_process_read_stdout_watch, process);
-	process->stderr_watch_id = g_io_add_watch(process->stderr_io_channel,
-						  G_IO_IN | G_IO_PRI | G_IO_HUP | G_IO_ERR | G_IO_NVAL,
-						  (GIOFunc) __gebr_comm_process_read_stderr_watch, process);
-	/* nonblock operations */
-	g_io_channel_set_flags(process->stdin_io_channel,
-			       g_io_channel_get_flags(process->stdin_io_channel) | G_IO_FLAG_NONBLOCK, &error);
-	g_io_channel_set_flags(process->stdout_io_channel,
-			       g_io_channel_get_flags(process->stdout_io_channel) | G_IO_FLAG_NONBLOCK, &error);
-	g_io_channel_set_flags(process->stderr_io_channel,
-			       g_io_channel_get_flags(process->stderr_io_channel) | G_IO_FLAG_NONBLOCK, &error);
-
-	/* there is already something available now? */
-	if (gebr_comm_process_stdout_bytes_available(process))
-		g_signal_emit(process, object_signals[READY_READ_STDOUT], 0);
-	if (gebr_comm_process_stderr_bytes_available(process))
-		g_signal_emit(process, object_signals[READY_READ_STDERR], 0);
+	__gebr_comm_process_watch_fds(process, stdin_pipe[1], stdout_pipe[0], stderr_pipe[0]);
 
 	ret = TRUE;
  out:	g_strfreev(argv);
 	return ret;
 }
 
+void gebr_comm_process_adopt(GebrCommProcess * process, GPid pid, gint stdin_fd, gint stdout_fd, gint stderr_fd)
+{
+	g_return_if_fail(GEBR_COMM_IS_PROCESS(process));
+
+	__gebr_comm_process_free(process);
+	process->pid = pid;
+	process->pending_signal = 0;
+	__gebr_comm_process_watch_fds(process, stdin_fd, stdout_fd, stderr_fd);
+}
+
+void gebr_comm_process_adopted_started(GebrCommProcess * process, GPid pid)
+{
+	g_return_if_fail(GEBR_COMM_IS_PROCESS(process));
+
+	process->pid = pid;
+	if (process->pending_signal)
+		killpg(pid, process->pending_signal);
+	process->pending_signal = 0;
+}
+
+void gebr_comm_process_adopted_finished(GebrCommProcess * process, gint status)
+{
+	g_return_if_fail(GEBR_COMM_IS_PROCESS(process));
+
+	__gebr_comm_process_finished_watch(process->pid, status, process);
+}
+
 GPid gebr_comm_process_get_pid(GebrCommProcess * process)
 {
 	g_return_val_if_fail(GEBR_COMM_IS_PROCESS(process), 0);
@@ -350,8 +383,12 @@ void gebr_comm_process_kill(GebrCommProcess * process)
 {
 	g_return_if_fail(GEBR_COMM_IS_PROCESS(process));
 
-	if (!process->pid)
+	if (!process->pid) {
+		/* Adopted, but not started yet */
+		if (process->is_running)
+			process->pending_signal = SIGKILL;
 		return;
+	}
 	killpg(process->pid, SIGKILL);
 }
 
@@ -359,8 +396,12 @@ void gebr_comm_process_terminate(GebrCommProcess * process)
 {
 	g_return_if_fail(GEBR_COMM_IS_PROCESS(process));
 
-	if (!process->pid)
+	if (!process->pid) {
+		/* Adopted, but not started yet */
+		if (process->is_running && process->pending_signal != SIGKILL)
+			process->pending_signal = SIGTERM;
 		return;
+	}
 	killpg(process->pid, SIGTERM);
 }
 
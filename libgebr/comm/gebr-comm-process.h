@@ -57,6 +57,9 @@ struct _GebrCommProcess {
 	guint stdout_watch_id;
 	guint stderr_watch_id;
 	guint finish_watch_id;
+
+	/* Signal sent to an adopted process once its pid is known */
+	gint pending_signal;
 };
 struct _GebrCommProcessClass {
 	GObjectClass parent;
@@ -82,6 +85,27 @@ gboolean gebr_comm_process_is_running(GebrCommProcess *);
 
 gboolean gebr_comm_process_start(GebrCommProcess *, GString *);
 
+/**
+ * Watches the pipes of \p pid, a process group leader started by another
+ * process of the same user, as if it were started by gebr_comm_process_start().
+ * As \p pid cannot be waited for, its exit must be reported with
+ * gebr_comm_process_adopted_finished().
+ */
+void gebr_comm_process_adopt(GebrCommProcess *, GPid pid, gint stdin_fd, gint stdout_fd, gint stderr_fd);
+
+/**
+ * Sets the \p pid of a process adopted with a pid of 0, as it was not known
+ * yet, and sends it the signal asked for by gebr_comm_process_kill() or
+ * gebr_comm_process_terminate() meanwhile.
+ */
+void gebr_comm_process_adopted_started(GebrCommProcess *, GPid pid);
+
+/**
+ * Emits the "finished" signal of a process watched with
+ * gebr_comm_process_adopt(), with the \p status returned by waitpid().
+ */
+void gebr_comm_process_adopted_finished(GebrCommProcess *, gint status);
+
 GPid gebr_comm_process_get_pid(GebrCommProcess *);
 
 void gebr_comm_process_kill(GebrCommProcess *);
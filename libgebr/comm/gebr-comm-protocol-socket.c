@@ -16,6 +16,7 @@
  */
 
 #include <stdarg.h>
+#include <stdlib.h>
 
 #include <libgebr/utils.h>
 #include <libgebr/comm/gebr-comm-streamsocket.h>
@@ -103,45 +104,79 @@ parse_http_msg(GebrCommProtocolSocket * self, GString *data)
 }
 
 static gboolean
-parse_old_msg(GebrCommProtocolSocket * self, GString *data)
+starts_with_http(struct gebr_comm_protocol *protocol)
 {
-	/* old non-rest protocol */
-	//TODO: emit data received with raw string data
+	gchar prefix[10];
+
+	prefix[gebr_comm_protocol_peek(protocol, prefix, sizeof(prefix) - 1)] = '\0';
+
+	return g_str_has_prefix(prefix, "HTTP/1.1 ") ||
+		g_str_has_prefix(prefix, "GET ") ||
+		g_str_has_prefix(prefix, "PUT ") ||
+		g_str_has_prefix(prefix, "POST ") ||
+		g_str_has_prefix(prefix, "DELETE ");
+}
+
+/*
+ * The HTTP parser works on strings, so copy the pending bytes out of the
+ * receive buffer and skip the ones it consumed.
+ */
+static gboolean
+parse_http_pending(GebrCommProtocolSocket * self)
+{
+	gsize pending = gebr_comm_protocol_pending(self->protocol);
+	GString *data = g_string_sized_new(pending);
 	gboolean ret;
-	if ((ret = gebr_comm_protocol_receive_data(self->protocol, data)))
-		g_signal_emit(self, object_signals[OLD_PARSE_MESSAGES], 0);
+
+	g_string_set_size(data, pending);
+	gebr_comm_protocol_peek(self->protocol, data->str, pending);
+	ret = parse_http_msg(self, data);
+	gebr_comm_protocol_skip(self->protocol, ret ? pending - data->len : pending);
+	g_string_free(data, TRUE);
 
 	return ret;
 }
 
 static void gebr_comm_protocol_socket_read(GebrCommStreamSocket *socket, GebrCommProtocolSocket * self)
 {
-	GString *data = gebr_comm_socket_read_string_all(GEBR_COMM_SOCKET(socket));
-
-	if (!data)
-		return;
-
-
-	while (data->len) {
-		gboolean ret;
-		if (self->protocol->message->hash)
-			ret = parse_old_msg(self, data);
-		else if (self->priv->incoming_msg != NULL)
-			ret = parse_http_msg(self, data);
-		else if (g_str_has_prefix(data->str, "HTTP/1.1 ") ||
-			 g_str_has_prefix(data->str, "GET ") ||
-			 g_str_has_prefix(data->str, "PUT ") ||
-			 g_str_has_prefix(data->str, "POST ") ||
-			 g_str_has_prefix(data->str, "DELETE "))
-			ret = parse_http_msg(self, data);
-		else
-			ret = parse_old_msg(self, data);
-
-		if (!ret)
+	gulong available = gebr_comm_socket_bytes_available(GEBR_COMM_SOCKET(socket));
+	gboolean old_messages = FALSE;
+
+	/* read straight into the receive buffer of the old protocol */
+	while (available) {
+		gsize size;
+		gchar *buffer = gebr_comm_protocol_receive_buffer(self->protocol, available, &size);
+		gssize read = gebr_comm_socket_read_buffer(GEBR_COMM_SOCKET(socket), buffer, MIN(size, available));
+
+		if (read <= 0)
+			return;
+		gebr_comm_protocol_received(self->protocol, read);
+		available -= read;
+	}
+
+	while (gebr_comm_protocol_pending(self->protocol)) {
+		if (!gebr_comm_protocol_receiving(self->protocol)
+		    && (self->priv->incoming_msg != NULL || starts_with_http(self->protocol))) {
+			/* keep the messages order */
+			if (old_messages) {
+				g_signal_emit(self, object_signals[OLD_PARSE_MESSAGES], 0);
+				old_messages = FALSE;
+			}
+			if (!parse_http_pending(self))
+				break;
+			continue;
+		}
+
+		/* old non-rest protocol */
+		//TODO: emit data received with raw string data
+		gint ret = gebr_comm_protocol_receive_data(self->protocol);
+		if (ret <= 0)
 			break;
+		old_messages = TRUE;
 	}
 
-	g_string_free(data, TRUE);
+	if (old_messages)
+		g_signal_emit(self, object_signals[OLD_PARSE_MESSAGES], 0);
 }
 static void gebr_comm_protocol_socket_error(GebrCommProtocolSocket * self, enum GebrCommSocketError error)
 {
@@ -305,7 +340,10 @@ void gebr_comm_protocol_socket_oldmsg_send(GebrCommProtocolSocket * self, gboole
 	gebr_comm_return_if_not_connected(self);
 
 	va_start(ap, n_params);
-	message = gebr_comm_protocol_build_messagev(gebr_comm_message_def, n_params, ap);
+	if (self->protocol->framing >= 2)
+		message = gebr_comm_protocol_build_framev(gebr_comm_message_def, TRUE, n_params, ap);
+	else
+		message = gebr_comm_protocol_build_messagev(gebr_comm_message_def, n_params, ap);
 
 	/* does this message need return? */
 	if (gebr_comm_message_def.returns)
@@ -328,4 +366,30 @@ void gebr_comm_protocol_socket_oldmsg_split_free(GList * split)
 {
 	gebr_comm_protocol_split_free(split);
 }
+gint gebr_comm_protocol_socket_oldmsg_peer_framing(GString * arguments, guint parts)
+{
+	GList *split = gebr_comm_protocol_split_new(arguments, parts + 1);
+	gint framing = 1;
+
+	if (split) {
+		GString *peer = g_list_nth_data(split, parts);
+		framing = CLAMP(atoi(peer->str), 1, GEBR_COMM_PROTOCOL_FRAMING);
+		gebr_comm_protocol_split_free(split);
+	}
+
+	return framing;
+}
+void gebr_comm_protocol_socket_set_framing(GebrCommProtocolSocket * self, gint framing)
+{
+	self->protocol->framing = framing;
+}
+gboolean gebr_comm_protocol_socket_oldmsg_split_slices(GString * arguments, guint parts,
+						       struct gebr_comm_slice *slices)
+{
+	return gebr_comm_protocol_split_slices(arguments, parts, slices);
+}
+gboolean gebr_comm_protocol_socket_is_congested(GebrCommProtocolSocket * self)
+{
+	return gebr_comm_socket_is_congested(GEBR_COMM_SOCKET(self->priv->socket));
+}
 
@@ -74,6 +74,28 @@ void gebr_comm_protocol_socket_oldmsg_send(GebrCommProtocolSocket * self, gboole
 					   struct gebr_comm_message_def gebr_comm_message_def, guint n_params, ...);
 GList *gebr_comm_protocol_socket_oldmsg_split(GString * arguments, guint parts);
 void gebr_comm_protocol_socket_oldmsg_split_free(GList * split);
+/*
+ * Peers which understand binary frames append the highest framing they
+ * support after the @parts arguments of INI and of its RET. Returns the
+ * framing to use with the peer that sent @arguments; 1 for old peers.
+ */
+gint gebr_comm_protocol_socket_oldmsg_peer_framing(GString * arguments, guint parts);
+/*
+ * Sets the framing of the messages sent from now on, see
+ * gebr_comm_protocol_socket_oldmsg_peer_framing().
+ */
+void gebr_comm_protocol_socket_set_framing(GebrCommProtocolSocket * self, gint framing);
+/*
+ * Splits @arguments into @parts slices without copying; the slices are NUL
+ * terminated but @arguments is modified and can't be split again.
+ */
+gboolean gebr_comm_protocol_socket_oldmsg_split_slices(GString * arguments, guint parts,
+						       struct gebr_comm_slice *slices);
+/*
+ * Returns %TRUE while more than the high-water mark of the underlying socket
+ * is waiting to be written, see gebr_comm_socket_set_high_water_mark().
+ */
+gboolean gebr_comm_protocol_socket_is_congested(GebrCommProtocolSocket * self);
 
 G_END_DECLS
 #endif				//__GEBR_COMM_PROTOCOL_SOCKET_H
@@ -20,6 +20,7 @@
 #include <errno.h>
 #include <stdarg.h>
 #include <stdio.h>
+#include <zlib.h>
 
 #include "gebr-comm-protocol.h"
 #include "gebr-comm-protocol_p.h"
@@ -31,6 +32,72 @@
 
 struct gebr_comm_protocol_defs gebr_comm_protocol_defs;
 
+/* initial size of the receive buffer, must be a power of two */
+#define PROTOCOL_BUFFER_SIZE 4096
+
+enum {
+	PARSE_CODE,
+	PARSE_SIZE,
+	PARSE_ARGUMENT,
+	PARSE_END,
+	PARSE_FRAME_HEADER,
+	PARSE_FRAME_ARGUMENT,
+};
+
+/*
+ * Binary frames (framing 2). The header has GEBR_COMM_PROTOCOL_FRAME_HEADER_SIZE
+ * bytes:
+ *
+ *   magic (1) | flags (1) | code, NUL padded (4) | payload length, big endian (4)
+ *
+ * The payload starts with FRAME_ARGUMENTS, followed by each argument as its
+ * length (4 bytes, big endian), its bytes and a NUL. A compressed payload is
+ * its uncompressed length (4 bytes, big endian) followed by the zlib stream.
+ */
+#define FRAME_MAGIC		0xFB
+#define FRAME_CODE_SIZE		4
+#define FRAME_COMPRESSED	0x01
+#define FRAME_ARGUMENTS		0x02
+/* smaller payloads are not worth compressing */
+#define FRAME_COMPRESS_MIN	1024
+/* best ratio zlib can reach, used to reject bogus lengths */
+#define FRAME_INFLATE_MAX_RATIO	1032
+
+static void
+append_uint32(GString *string, guint32 value)
+{
+	gchar bytes[4] = {
+		(value >> 24) & 0xff,
+		(value >> 16) & 0xff,
+		(value >> 8) & 0xff,
+		value & 0xff,
+	};
+	g_string_append_len(string, bytes, 4);
+}
+
+static guint32
+read_uint32(const gchar *str)
+{
+	const guchar *bytes = (const guchar *)str;
+	return ((guint32)bytes[0] << 24) | (bytes[1] << 16) | (bytes[2] << 8) | bytes[3];
+}
+
+static void
+reset_message(struct gebr_comm_protocol *protocol)
+{
+	protocol->state = PARSE_CODE;
+	protocol->code_len = 0;
+	protocol->header_len = 0;
+
+	if (!protocol->message)
+		protocol->message = gebr_comm_message_new();
+	else {
+		protocol->message->hash = 0;
+		protocol->message->argument_size = 0;
+		g_string_set_size(protocol->message->argument, 0);
+	}
+}
+
 void gebr_comm_protocol_split_free_each(GString * string)
 {
 	g_string_free(string, TRUE);
@@ -47,7 +114,7 @@ void gebr_comm_protocol_init(void)
 	gebr_comm_protocol_defs.err_def  = gebr_comm_message_def_create("ERR", FALSE,  1);
 	gebr_comm_protocol_defs.ini_def  = gebr_comm_message_def_create("INI", TRUE,   6);
 	gebr_comm_protocol_defs.qut_def  = gebr_comm_message_def_create("QUT", FALSE,  0);
-	gebr_comm_protocol_defs.lst_def  = gebr_comm_message_def_create("LST", FALSE,  0); /* return JOBs, not RET */
+	gebr_comm_protocol_defs.lst_def  = gebr_comm_message_def_create("LST", FALSE,  1); /* return JOBs, not RET */
 	gebr_comm_protocol_defs.job_def  = gebr_comm_message_def_create("JOB", FALSE, 18);
 	gebr_comm_protocol_defs.run_def  = gebr_comm_message_def_create("RUN", FALSE,   5);
 	gebr_comm_protocol_defs.rnq_def  = gebr_comm_message_def_create("RNQ", FALSE,  2);
@@ -75,8 +142,10 @@ void gebr_comm_protocol_init(void)
 	gebr_comm_protocol_defs.agrp_def  = gebr_comm_message_def_create("AGRP", FALSE, 1);
 	gebr_comm_protocol_defs.dgrp_def  = gebr_comm_message_def_create("GGRP", FALSE, 1);
 	gebr_comm_protocol_defs.tsk_def   = gebr_comm_message_def_create("TSK", FALSE, 1);
+	gebr_comm_protocol_defs.lod_def   = gebr_comm_message_def_create("LOD", FALSE, 1);
 	gebr_comm_protocol_defs.iss_def   = gebr_comm_message_def_create("ISS", FALSE, 1);
 	gebr_comm_protocol_defs.cmd_def   = gebr_comm_message_def_create("CMD", FALSE, 1);
+	gebr_comm_protocol_defs.syn_def   = gebr_comm_message_def_create("SYN", FALSE, 2);
 	gebr_comm_protocol_defs.pss_def   = gebr_comm_message_def_create("PSS", FALSE, 1);
 	gebr_comm_protocol_defs.qst_def   = gebr_comm_message_def_create("QST", FALSE, 3);
 	gebr_comm_protocol_defs.harakiri_def = gebr_comm_message_def_create("HRK", FALSE, 0);
@@ -112,8 +181,10 @@ void gebr_comm_protocol_init(void)
 	g_hash_table_insert(gebr_comm_protocol_defs.hash_table, (gpointer)gebr_comm_protocol_defs.agrp_def.code, &gebr_comm_protocol_defs.agrp_def);
 	g_hash_table_insert(gebr_comm_protocol_defs.hash_table, (gpointer)gebr_comm_protocol_defs.dgrp_def.code, &gebr_comm_protocol_defs.dgrp_def);
 	g_hash_table_insert(gebr_comm_protocol_defs.hash_table, (gpointer)gebr_comm_protocol_defs.tsk_def.code, &gebr_comm_protocol_defs.tsk_def);
+	g_hash_table_insert(gebr_comm_protocol_defs.hash_table, (gpointer)gebr_comm_protocol_defs.lod_def.code, &gebr_comm_protocol_defs.lod_def);
 	g_hash_table_insert(gebr_comm_protocol_defs.hash_table, (gpointer)gebr_comm_protocol_defs.iss_def.code, &gebr_comm_protocol_defs.iss_def);
 	g_hash_table_insert(gebr_comm_protocol_defs.hash_table, (gpointer)gebr_comm_protocol_defs.cmd_def.code, &gebr_comm_protocol_defs.cmd_def);
+	g_hash_table_insert(gebr_comm_protocol_defs.hash_table, (gpointer)gebr_comm_protocol_defs.syn_def.code, &gebr_comm_protocol_defs.syn_def);
 	g_hash_table_insert(gebr_comm_protocol_defs.hash_table, (gpointer)gebr_comm_protocol_defs.pss_def.code, &gebr_comm_protocol_defs.pss_def);
 	g_hash_table_insert(gebr_comm_protocol_defs.hash_table, (gpointer)gebr_comm_protocol_defs.qst_def.code, &gebr_comm_protocol_defs.qst_def);
 	g_hash_table_insert(gebr_comm_protocol_defs.hash_table, (gpointer)gebr_comm_protocol_defs.harakiri_def.code, &gebr_comm_protocol_defs.harakiri_def);
@@ -149,9 +220,10 @@ struct gebr_comm_protocol *gebr_comm_protocol_new(void)
 	struct gebr_comm_protocol *protocol;
 
 	protocol = g_new(struct gebr_comm_protocol, 1);
-	protocol->data = g_string_new(NULL);
+	protocol->buffer_size = PROTOCOL_BUFFER_SIZE;
+	protocol->buffer = g_malloc(protocol->buffer_size);
 	protocol->message = NULL;
-	protocol->messages = NULL;
+	protocol->messages = g_queue_new();
 	protocol->hostname = g_string_new(NULL);
 	protocol->waiting_ret_hashs = g_queue_new();
 
@@ -162,97 +234,266 @@ struct gebr_comm_protocol *gebr_comm_protocol_new(void)
 
 void gebr_comm_protocol_reset(struct gebr_comm_protocol *protocol)
 {
-	g_string_assign(protocol->data, "");
+	protocol->head = protocol->tail = 0;
 	protocol->logged = FALSE;
+	protocol->framing = 1;
 
-	gebr_comm_message_free(protocol->message);
-	protocol->message = gebr_comm_message_new();
+	reset_message(protocol);
 
-	g_list_foreach(protocol->messages, (GFunc)gebr_comm_message_free, NULL);
-	g_list_free(protocol->messages);
-	protocol->messages = NULL;
+	while (!g_queue_is_empty(protocol->messages))
+		gebr_comm_message_free(g_queue_pop_head(protocol->messages));
 }
 
 void gebr_comm_protocol_free(struct gebr_comm_protocol *protocol)
 {
-	g_string_free(protocol->data, TRUE);
+	g_free(protocol->buffer);
 	gebr_comm_message_free(protocol->message);
-	g_list_foreach(protocol->messages, (GFunc)gebr_comm_message_free, NULL);
-	g_list_free(protocol->messages);
+	while (!g_queue_is_empty(protocol->messages))
+		gebr_comm_message_free(g_queue_pop_head(protocol->messages));
+	g_queue_free(protocol->messages);
 	g_string_free(protocol->hostname, TRUE);
 	g_queue_free(protocol->waiting_ret_hashs);
 	g_free(protocol);
 }
 
-gboolean gebr_comm_protocol_receive_data(struct gebr_comm_protocol *protocol, GString * data)
+/*
+ * Receive buffer {{{1
+ */
+
+gsize gebr_comm_protocol_pending(struct gebr_comm_protocol *protocol)
+{
+	return protocol->tail - protocol->head;
+}
+
+/*
+ * Makes room for at least @len more bytes, doubling the buffer if needed.
+ * The pending bytes are unwrapped to the start of the new buffer.
+ */
+static void
+buffer_reserve(struct gebr_comm_protocol *protocol, gsize len)
 {
-	gchar **splits;
-	gboolean reached_end = FALSE;
+	gsize pending = gebr_comm_protocol_pending(protocol);
+	gsize size = protocol->buffer_size;
 
-	while (!reached_end && data->len) {
-		gsize missing;
+	if (size - pending >= len)
+		return;
 
-		/* if so, this is a new message; otherwise, another part
-		 * of the argument of protocol->message
-		 */
-		if (!protocol->message->hash) {
-			gint erase_len;
-			gchar *strtol_endptr;
+	while (size - pending < len)
+		size *= 2;
 
-			splits = g_strsplit(data->str, " ", 3);
-			gint n_tokens = g_strv_length(splits);
-			if (n_tokens < 2)
-				goto err;
+	gchar *buffer = g_malloc(size);
+	gebr_comm_protocol_peek(protocol, buffer, pending);
+	g_free(protocol->buffer);
+	protocol->buffer = buffer;
+	protocol->buffer_size = size;
+	protocol->head = 0;
+	protocol->tail = pending;
+}
 
-			/* code */
-			if (g_hash_table_lookup(gebr_comm_protocol_defs.hash_table, splits[0]) == NULL) {
-				g_string_assign(data, "");
-				goto err;
-			}
-			protocol->message->hash = g_str_hash(splits[0]);
-			/* argument size */
-			strtol_endptr = NULL;
-			protocol->message->argument_size = strtol(splits[1], &strtol_endptr, 10);
-			if (errno == ERANGE)
-				goto err;
+/*
+ * Returns the contiguous free region of the buffer after making room for
+ * @len bytes. *@size is set to its length, which is smaller than @len when the
+ * free space wraps around; call again after gebr_comm_protocol_received().
+ */
+gchar *gebr_comm_protocol_receive_buffer(struct gebr_comm_protocol *protocol, gsize len, gsize *size)
+{
+	buffer_reserve(protocol, len);
+
+	gsize mask = protocol->buffer_size - 1;
+	gsize offset = protocol->tail & mask;
+	gsize free_space = protocol->buffer_size - gebr_comm_protocol_pending(protocol);
+
+	*size = MIN(free_space, protocol->buffer_size - offset);
+	return protocol->buffer + offset;
+}
+
+void gebr_comm_protocol_received(struct gebr_comm_protocol *protocol, gsize len)
+{
+	protocol->tail += len;
+}
 
-			/* the missing bytes to complete the read of argument */
-			missing = protocol->message->argument_size;
-			/* erase code and size from data */
-			erase_len = strlen(splits[0]) + 1 + strlen(splits[1]) + ((n_tokens == 2) ? 0 : 1);
-			g_string_erase(data, 0, erase_len);
+void gebr_comm_protocol_feed(struct gebr_comm_protocol *protocol, const gchar *data, gsize len)
+{
+	while (len) {
+		gsize size;
+		gchar *buffer = gebr_comm_protocol_receive_buffer(protocol, len, &size);
+
+		size = MIN(size, len);
+		memcpy(buffer, data, size);
+		gebr_comm_protocol_received(protocol, size);
+		data += size;
+		len -= size;
+	}
+}
+
+/*
+ * Copies at most @len pending bytes to @data without consuming them.
+ */
+gsize gebr_comm_protocol_peek(struct gebr_comm_protocol *protocol, gchar *data, gsize len)
+{
+	gsize mask = protocol->buffer_size - 1;
+	gsize offset = protocol->head & mask;
+
+	len = MIN(len, gebr_comm_protocol_pending(protocol));
+
+	gsize first = MIN(len, protocol->buffer_size - offset);
+	memcpy(data, protocol->buffer + offset, first);
+	memcpy(data + first, protocol->buffer, len - first);
+
+	return len;
+}
+
+void gebr_comm_protocol_skip(struct gebr_comm_protocol *protocol, gsize len)
+{
+	protocol->head += MIN(len, gebr_comm_protocol_pending(protocol));
+}
+
+/*
+ * Parser {{{1
+ */
+
+gboolean gebr_comm_protocol_receiving(struct gebr_comm_protocol *protocol)
+{
+	return protocol->state != PARSE_CODE || protocol->code_len > 0;
+}
 
-			g_strfreev(splits);
-		} else {
-			missing = protocol->message->argument_size - protocol->message->argument->len;
+/*
+ * Checks the code of the frame just received and inflates its payload.
+ */
+static gboolean
+finish_frame(struct gebr_comm_protocol *protocol)
+{
+	struct gebr_comm_message *message = protocol->message;
+	guchar flags = protocol->header[1];
+
+	memcpy(protocol->code, protocol->header + 2, FRAME_CODE_SIZE);
+	protocol->code[FRAME_CODE_SIZE] = '\0';
+	if (g_hash_table_lookup(gebr_comm_protocol_defs.hash_table, protocol->code) == NULL)
+		return FALSE;
+	message->hash = g_str_hash(protocol->code);
+
+	if (flags & FRAME_COMPRESSED) {
+		GString *argument = message->argument;
+
+		if (argument->len < 4)
+			return FALSE;
+
+		uLongf len = read_uint32(argument->str);
+		if (len / FRAME_INFLATE_MAX_RATIO > argument->len)
+			return FALSE;
+
+		GString *inflated = g_string_sized_new(len);
+		if (uncompress((Bytef *)inflated->str, &len, (Bytef *)argument->str + 4, argument->len - 4) != Z_OK) {
+			g_string_free(inflated, TRUE);
+			return FALSE;
+		}
+		g_string_set_size(inflated, len);
+
+		g_string_free(argument, TRUE);
+		message->argument = inflated;
+		message->argument_size = len;
+	}
+
+	return message->argument->len == 0 || (guchar)message->argument->str[0] == FRAME_ARGUMENTS;
+}
+
+/*
+ * Parses at most one message from the pending bytes, reading each byte only
+ * once. The header of a message may be split between any number of calls.
+ *
+ * Returns: 1 if a message was completed and queued in protocol->messages, 0 if
+ * more data is needed and -1 if the data is not a valid message; in this case
+ * all pending data is discarded.
+ */
+gint gebr_comm_protocol_receive_data(struct gebr_comm_protocol *protocol)
+{
+	gsize mask = protocol->buffer_size - 1;
+	struct gebr_comm_message *message = protocol->message;
+
+	while (protocol->head != protocol->tail) {
+		if (protocol->state == PARSE_ARGUMENT || protocol->state == PARSE_FRAME_ARGUMENT) {
+			gsize missing = message->argument_size - message->argument->len;
+			gsize offset = protocol->head & mask;
+			gsize len = MIN(missing, gebr_comm_protocol_pending(protocol));
+			len = MIN(len, protocol->buffer_size - offset);
+
+			g_string_append_len(message->argument, protocol->buffer + offset, len);
+			protocol->head += len;
+			if (message->argument->len < message->argument_size)
+				continue;
+			if (protocol->state == PARSE_ARGUMENT) {
+				protocol->state = PARSE_END;
+				continue;
+			}
+			if (!finish_frame(protocol))
+				goto err;
+			goto queue;
 		}
 
-		/* if so, protocol->message has now received its
-		 * argument entirely using > because there must be a line feed.
-		 */
-		reached_end = data->len > missing; 
-		if (reached_end) {
-			struct gebr_comm_message *queued;
-
-			g_string_append_len(protocol->message->argument, data->str, missing);
-			g_string_erase(data, 0, missing + 1);
-
-			/* add to the list of messages */
-			queued = protocol->message;
-			protocol->messages = g_list_prepend(protocol->messages, queued);
-			protocol->message = gebr_comm_message_new();
-		} else {
-			g_string_append(protocol->message->argument, data->str);
-			g_string_erase(data, 0, -1);
+		gchar c = protocol->buffer[protocol->head & mask];
+		protocol->head++;
+
+		switch (protocol->state) {
+		case PARSE_FRAME_HEADER:
+			protocol->header[protocol->header_len++] = c;
+			if (protocol->header_len < GEBR_COMM_PROTOCOL_FRAME_HEADER_SIZE)
+				break;
+			message->argument_size = read_uint32((gchar *)protocol->header + 2 + FRAME_CODE_SIZE);
+			protocol->state = PARSE_FRAME_ARGUMENT;
+			if (message->argument_size)
+				break;
+			if (!finish_frame(protocol))
+				goto err;
+			goto queue;
+		case PARSE_CODE:
+			if (protocol->code_len == 0 && (guchar)c == FRAME_MAGIC) {
+				protocol->header[protocol->header_len++] = c;
+				protocol->state = PARSE_FRAME_HEADER;
+				break;
+			}
+			if (c != ' ') {
+				if (protocol->code_len == GEBR_COMM_PROTOCOL_CODE_MAX)
+					goto err;
+				protocol->code[protocol->code_len++] = c;
+				break;
+			}
+			protocol->code[protocol->code_len] = '\0';
+			if (g_hash_table_lookup(gebr_comm_protocol_defs.hash_table, protocol->code) == NULL)
+				goto err;
+			message->hash = g_str_hash(protocol->code);
+			message->argument_size = 0;
+			protocol->state = PARSE_SIZE;
+			break;
+		case PARSE_SIZE:
+			if (c == ' ') {
+				protocol->state = message->argument_size ? PARSE_ARGUMENT : PARSE_END;
+				break;
+			}
+			if (!g_ascii_isdigit(c) || message->argument_size > (G_MAXSIZE - 9) / 10)
+				goto err;
+			message->argument_size = message->argument_size * 10 + (c - '0');
+			break;
+		case PARSE_END:
+			if (c != '\n')
+				goto err;
+			goto queue;
 		}
 	}
 
-	return TRUE;
+	return 0;
+
+queue:	g_queue_push_tail(protocol->messages, message);
+	protocol->message = NULL;
+	reset_message(protocol);
+	return 1;
 
- err:	g_strfreev(splits);
-	return FALSE;
+err:	protocol->head = protocol->tail;
+	reset_message(protocol);
+	return -1;
 }
 
+/* }}} */
+
 GString * gebr_comm_protocol_build_messagev(struct gebr_comm_message_def msg_def, guint n_params, va_list ap)
 {
 	GString * data;
@@ -284,49 +525,182 @@ GString * gebr_comm_protocol_build_message(struct gebr_comm_message_def msg_def,
 	return gebr_comm_protocol_build_messagev(msg_def, n_params, ap);
 }
 
-GList *gebr_comm_protocol_split_new(GString * arguments, guint parts)
+/*
+ * Builds a binary frame (framing 2). If @compress is TRUE, large payloads are
+ * compressed when it makes them smaller.
+ */
+GString * gebr_comm_protocol_build_framev(struct gebr_comm_message_def msg_def, gboolean compress, guint n_params, va_list ap)
 {
-	gchar *iarg;
-	GList *split;
+	GString *payload;
+	GString *frame;
+	guchar flags = 0;
+	gchar code[FRAME_CODE_SIZE] = { 0 };
 
-	/* TODO: use static array instead of a GList */
+	g_return_val_if_fail(strlen(msg_def.code) <= FRAME_CODE_SIZE, NULL);
 
-	iarg = arguments->str;
-	split = NULL;
-	for (guint i = 0; i < parts; ++i) {
-		GString *arg;
-		gchar *sep;
-		gsize arg_size;
+	payload = g_string_new(NULL);
+	g_string_append_c(payload, FRAME_ARGUMENTS);
+	for (guint i = 1; i <= n_params; ++i) {
+		const gchar *param = va_arg(ap, char *);
+		if (!param)
+			param = "";
+		gsize len = strlen(param);
+		append_uint32(payload, len);
+		g_string_append_len(payload, param, len + 1);
+	}
+	va_end(ap);
 
-		/* get the argument size */
-		if (sscanf(iarg, "%zu|", &arg_size) == EOF)
-			goto err;
+	if (compress && payload->len >= FRAME_COMPRESS_MIN) {
+		uLongf len = compressBound(payload->len);
+		GString *deflated = g_string_sized_new(len + 4);
+
+		append_uint32(deflated, payload->len);
+		if (compress2((Bytef *)deflated->str + 4, &len, (Bytef *)payload->str, payload->len, Z_BEST_SPEED) == Z_OK
+		    && len + 4 < payload->len) {
+			g_string_set_size(deflated, len + 4);
+			g_string_free(payload, TRUE);
+			payload = deflated;
+			flags |= FRAME_COMPRESSED;
+		} else
+			g_string_free(deflated, TRUE);
+	}
 
-		/* discover the position of separator and get arg, data */
-		sep = strchr(iarg, '|') + sizeof(gchar);
-		if (strlen(sep) < arg_size)
-			goto err;
-		arg = g_string_new("");
-		g_string_append_len(arg, sep, arg_size);
+	memcpy(code, msg_def.code, strlen(msg_def.code));
+
+	frame = g_string_sized_new(GEBR_COMM_PROTOCOL_FRAME_HEADER_SIZE + payload->len);
+	g_string_append_c(frame, FRAME_MAGIC);
+	g_string_append_c(frame, flags);
+	g_string_append_len(frame, code, FRAME_CODE_SIZE);
+	append_uint32(frame, payload->len);
+	g_string_append_len(frame, payload->str, payload->len);
+	g_string_free(payload, TRUE);
+
+	return frame;
+}
+
+GString * gebr_comm_protocol_build_frame(struct gebr_comm_message_def msg_def, gboolean compress, guint n_params, ...)
+{
+	va_list ap;
+	va_start(ap, n_params);
+	return gebr_comm_protocol_build_framev(msg_def, compress, n_params, ap);
+}
+
+/*
+ * Reads the argument at @iarg, which has the format "SIZE|DATA", where @end is
+ * the end of the arguments. Returns the start of the next argument.
+ */
+static const gchar *
+split_next(const gchar *iarg, const gchar *end, struct gebr_comm_slice *slice)
+{
+	gsize arg_size = 0;
+
+	if (iarg == end || !g_ascii_isdigit(*iarg))
+		return NULL;
+
+	for (; iarg < end && g_ascii_isdigit(*iarg); iarg++) {
+		if (arg_size > (G_MAXSIZE - 9) / 10)
+			return NULL;
+		arg_size = arg_size * 10 + (*iarg - '0');
+	}
+
+	if (iarg == end || *iarg != '|' || (gsize)(end - iarg - 1) < arg_size)
+		return NULL;
+
+	slice->str = iarg + 1;
+	slice->len = arg_size;
+
+	return slice->str + arg_size;
+}
+
+/*
+ * Like split_next(), for the arguments of a binary frame.
+ */
+static const gchar *
+split_next_frame(const gchar *iarg, const gchar *end, struct gebr_comm_slice *slice)
+{
+	if (end - iarg < 4)
+		return NULL;
+
+	gsize arg_size = read_uint32(iarg);
+	iarg += 4;
+	if ((gsize)(end - iarg) <= arg_size || iarg[arg_size] != '\0')
+		return NULL;
+
+	slice->str = iarg;
+	slice->len = arg_size;
+
+	return iarg + arg_size + 1;
+}
+
+static gboolean
+is_frame_arguments(GString *arguments)
+{
+	return arguments->len && (guchar)arguments->str[0] == FRAME_ARGUMENTS;
+}
+
+/*
+ * Fills @slices with the @parts arguments of @arguments. Each slice points
+ * inside @arguments, and the spaces separating them are replaced by NUL, so
+ * slice->str is also a valid C string. Therefore @arguments can't be split
+ * again afterwards.
+ */
+gboolean gebr_comm_protocol_split_slices(GString * arguments, guint parts, struct gebr_comm_slice *slices)
+{
+	const gchar *iarg = arguments->str;
+	const gchar *end = arguments->str + arguments->len;
+
+	if (is_frame_arguments(arguments)) {
+		/* already NUL terminated */
+		++iarg;
+		for (guint i = 0; i < parts; ++i)
+			if (!(iarg = split_next_frame(iarg, end, &slices[i])))
+				return FALSE;
+		return TRUE;
+	}
 
-		/* add to list */
-		split = g_list_append(split, arg);
+	for (guint i = 0; i < parts; ++i) {
+		if (!(iarg = split_next(iarg, end, &slices[i])))
+			return FALSE;
 
-		/* go to the next */
-		iarg = sep + arg_size;
 		if (i != parts-1) {
 			/* jump space between args */
-			if (!strlen(iarg))
-				goto err;
+			if (end - iarg < 2)
+				return FALSE;
+			*(gchar *)iarg++ = '\0';
+		}
+	}
 
-			++iarg;
+	return TRUE;
+}
+
+GList *gebr_comm_protocol_split_new(GString * arguments, guint parts)
+{
+	const gchar *iarg = arguments->str;
+	const gchar *end = arguments->str + arguments->len;
+	gboolean frame = is_frame_arguments(arguments);
+	GList *split = NULL;
+
+	if (frame)
+		++iarg;
+
+	for (guint i = 0; i < parts; ++i) {
+		struct gebr_comm_slice slice;
 
-			if (!strlen(iarg))
+		iarg = frame ? split_next_frame(iarg, end, &slice) : split_next(iarg, end, &slice);
+		if (!iarg)
+			goto err;
+
+		split = g_list_prepend(split, g_string_new_len(slice.str, slice.len));
+
+		if (!frame && i != parts-1) {
+			/* jump space between args */
+			if (end - iarg < 2)
 				goto err;
+			++iarg;
 		}
 	}
 
-	return split;
+	return g_list_reverse(split);
 
 err:	gebr_comm_protocol_split_free(split);
 	return NULL;
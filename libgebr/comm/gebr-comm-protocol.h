@@ -79,6 +79,7 @@ struct gebr_comm_protocol_defs {
 
 	struct gebr_comm_message_def run_def;   // Run request          Maestro -> Daemon
 	struct gebr_comm_message_def tsk_def;   // Task definition      Daemon  -> Maestro
+	struct gebr_comm_message_def lod_def;   // System load sample   Daemon  -> Maestro
 
 	struct gebr_comm_message_def jcl_def;   // Job Close 		Maestro -> GeBR
 	struct gebr_comm_message_def job_def;   // Job definition       Maestro -> GeBR
@@ -86,6 +87,7 @@ struct gebr_comm_protocol_defs {
 	struct gebr_comm_message_def srm_def;   // Server remove	Maestro -> GeBR
 	struct gebr_comm_message_def cmd_def;   // Command line         Maestro -> GeBR
 	struct gebr_comm_message_def iss_def;   // Issues               Maestro -> GeBR
+	struct gebr_comm_message_def syn_def;   // Job sync begin/end   Maestro -> GeBR
 
 	struct gebr_comm_message_def qst_def;   // Question request     Maestro -> GeBR
 	struct gebr_comm_message_def pss_def;   // Password request     Maestro -> GeBR
@@ -102,12 +104,36 @@ struct gebr_comm_message {
 	GString *argument;
 };
 
+/* longest message code accepted by the parser */
+#define GEBR_COMM_PROTOCOL_CODE_MAX 8
+
+/*
+ * Message framings: 1 is the text format "CODE size len|arg len|arg\n" and 2
+ * is the binary format built by gebr_comm_protocol_build_framev(). Both are
+ * always understood; framing 2 is only sent to peers which announced it in
+ * the INI handshake.
+ */
+#define GEBR_COMM_PROTOCOL_FRAMING 2
+#define GEBR_COMM_PROTOCOL_FRAME_HEADER_SIZE 10
+
 struct gebr_comm_protocol {
-	/* the data being received is forming message(s) */
-	GString *data;
+	/* ring buffer with the received bytes not parsed yet;
+	 * head and tail run freely and are masked by size - 1 */
+	gchar *buffer;
+	gsize buffer_size;
+	gsize head;
+	gsize tail;
+	/* header of the message being received */
+	gint state;
+	gchar code[GEBR_COMM_PROTOCOL_CODE_MAX + 1];
+	gsize code_len;
+	guchar header[GEBR_COMM_PROTOCOL_FRAME_HEADER_SIZE];
+	gsize header_len;
+	/* framing used to send messages to the peer */
+	gint framing;
 	struct gebr_comm_message *message;
-	/* received messages to be parsed */
-	GList *messages;
+	/* received messages to be parsed, oldest first */
+	GQueue *messages;
 	/* waiting for return of message with "hash"; 0 if it is not waiting responses */
 	GQueue *waiting_ret_hashs;
 	/* logged in with INI and RET? */
@@ -116,6 +142,12 @@ struct gebr_comm_protocol {
 	GString *hostname;
 };
 
+/* a view into the argument of a message, see gebr_comm_protocol_split_slices() */
+struct gebr_comm_slice {
+	const gchar *str;
+	gsize len;
+};
+
 void gebr_comm_protocol_reset(struct gebr_comm_protocol *protocol);
 
 void gebr_comm_message_free(struct gebr_comm_message *message);
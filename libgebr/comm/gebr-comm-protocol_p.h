@@ -37,15 +37,35 @@ struct gebr_comm_protocol *gebr_comm_protocol_new(void);
 
 void gebr_comm_protocol_free(struct gebr_comm_protocol *protocol);
 
-gboolean gebr_comm_protocol_receive_data(struct gebr_comm_protocol *protocol, GString * data);
+gchar *gebr_comm_protocol_receive_buffer(struct gebr_comm_protocol *protocol, gsize len, gsize *size);
+
+void gebr_comm_protocol_received(struct gebr_comm_protocol *protocol, gsize len);
+
+void gebr_comm_protocol_feed(struct gebr_comm_protocol *protocol, const gchar *data, gsize len);
+
+gsize gebr_comm_protocol_pending(struct gebr_comm_protocol *protocol);
+
+gsize gebr_comm_protocol_peek(struct gebr_comm_protocol *protocol, gchar *data, gsize len);
+
+void gebr_comm_protocol_skip(struct gebr_comm_protocol *protocol, gsize len);
+
+gboolean gebr_comm_protocol_receiving(struct gebr_comm_protocol *protocol);
+
+gint gebr_comm_protocol_receive_data(struct gebr_comm_protocol *protocol);
 
 GString *gebr_comm_protocol_build_messagev(struct gebr_comm_message_def msg_def, guint n_params, va_list ap);
 
 GString *gebr_comm_protocol_build_message(struct gebr_comm_message_def msg_def, guint n_params, ...);
 
+GString *gebr_comm_protocol_build_framev(struct gebr_comm_message_def msg_def, gboolean compress, guint n_params, va_list ap);
+
+GString *gebr_comm_protocol_build_frame(struct gebr_comm_message_def msg_def, gboolean compress, guint n_params, ...);
+
 GList *gebr_comm_protocol_split_new(GString * arguments, guint parts);
 
 void gebr_comm_protocol_split_free(GList * split);
 
+gboolean gebr_comm_protocol_split_slices(GString * arguments, guint parts, struct gebr_comm_slice *slices);
+
 G_END_DECLS
 #endif				//__GEBR_COMM_PROTOCOL_P_H
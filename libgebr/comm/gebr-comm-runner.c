@@ -19,6 +19,7 @@
  */
 
 #include "gebr-comm-runner.h"
+#include "gebr-comm-runner_p.h"
 
 #include <libgebr/utils.h>
 #include <libgebr/geoxml/geoxml.h>
@@ -47,6 +48,8 @@ struct _GebrCommRunnerPriv {
 	gint requests;
 	gint responses;
 	GList *cores_scores;
+	GList *cached_servers; /* Daemons scored from their pushed load */
+	GTimeVal submit_time;
 
 	gint total;
 	gchar *ncores;
@@ -60,6 +63,15 @@ struct _GebrCommRunnerPriv {
 	gchar *mpi_owner;
 	gchar *mpi_flavor;
 
+	/* Dynamic scheduling of loop steps */
+	GebrCommRunnerScheduling scheduling;
+	gint loop_ini;
+	gint loop_step;
+	gint nsteps;
+	gint next_step; /* First loop step not sent to any daemon */
+	gint total_np;
+	GArray *finished_chunks; /* gboolean for each chunk sent */
+
 	void (*ran_func) (GebrCommRunner *runner,
 			  gpointer data);
 	gpointer user_data;
@@ -159,6 +171,7 @@ gebr_comm_runner_new(GebrGeoXmlDocument *flow,
 	self->priv->cores_scores = NULL;
 	self->priv->mpi_owner = g_strdup("");
 	self->priv->mpi_flavor = g_strdup("");
+	g_get_current_time(&self->priv->submit_time);
 
 	self->priv->servers = g_list_copy(submit_servers);
 
@@ -179,6 +192,10 @@ gebr_comm_runner_free(GebrCommRunner *self)
 	g_free(self->priv->mpi_flavor);
 	g_free(self->priv->weights);
 	g_free(self->priv->numprocs);
+	g_free(self->priv->servers_list);
+	g_list_free(self->priv->cached_servers);
+	if (self->priv->finished_chunks)
+		g_array_free(self->priv->finished_chunks, TRUE);
 }
 
 /*
@@ -251,7 +268,16 @@ calculate_server_score(GebrCommDaemon *daemon, const gchar *load, gint ncores, g
 	points = g_list_prepend(points, p5);
 	points = g_list_prepend(points, p15);
 
-	gdouble current_load = predict_current_load(points, delay);
+	/* The sampled busy cores are current, the load averages lag behind */
+	gdouble current_load = gebr_comm_daemon_get_busy_cores(daemon);
+	if (current_load < 0)
+		current_load = predict_current_load(points, delay);
+
+	/* Tasks sent to this daemon recently are not sampled yet */
+	current_load += gebr_comm_daemon_get_reserved_cores(daemon);
+
+	/* More processes do not help a daemon stalled on memory or I/O */
+	gdouble stall = CLAMP(gebr_comm_daemon_get_stall(daemon), 0, 0.9);
 
 	GList *score = NULL;
 	gdouble base = floor(current_load/ncores);
@@ -278,7 +304,7 @@ calculate_server_score(GebrCommDaemon *daemon, const gchar *load, gint ncores, g
 			n_jobs = 0;
 		}
 
-		sc->score = (cpu_clock/(sc->score + 1)) * pow(factor_correction, n_jobs);
+		sc->score = (cpu_clock/(sc->score + 1)) * pow(factor_correction, n_jobs) * (1 - stall);
 
 		score = g_list_prepend(score, sc);
 
@@ -466,6 +492,151 @@ set_servers_execution_info(GebrCommRunner *self)
 	self->priv->distributed_n = distributed_n;
 }
 
+/*
+ * finish_dispatch:
+ *
+ * Called when all tasks of the job were sent to the daemons.
+ */
+static void
+finish_dispatch(GebrCommRunner *self)
+{
+	GTimeVal now;
+	g_get_current_time(&now);
+	g_debug("Job %s dispatched %.3lf seconds after submission", self->priv->id,
+		(now.tv_sec - self->priv->submit_time.tv_sec)
+		+ (now.tv_usec - self->priv->submit_time.tv_usec) / 1e6);
+
+	if (self->priv->ran_func)
+		self->priv->ran_func(self, self->priv->user_data);
+}
+
+static gint
+get_daemon_numprocs(GebrCommRunner *self,
+		    GebrCommDaemon *daemon)
+{
+	gint k = 0;
+	for (GList *i = self->priv->servers; i; i = i->next, k++)
+		if (i->data == daemon)
+			return self->priv->numprocs[k];
+	return 0;
+}
+
+gint
+gebr_comm_runner_chunk_size(gint remaining,
+			    gint np,
+			    gint total_np)
+{
+	gint size = (remaining * np + total_np - 1) / total_np;
+
+	return MIN(MAX(size, np), remaining);
+}
+
+/*
+ * send_chunk:
+ *
+ * Sends the next chunk of loop steps to @daemon as a new task.
+ */
+static void
+send_chunk(GebrCommRunner *self,
+	   GebrCommDaemon *daemon,
+	   gint np)
+{
+	GebrCommServer *server = gebr_comm_daemon_get_server(daemon);
+	const gchar *hostname = gebr_comm_daemon_get_hostname(daemon);
+	gint size = gebr_comm_runner_chunk_size(self->priv->nsteps - self->priv->next_step,
+						np, self->priv->total_np);
+	gboolean finished = FALSE;
+
+	GebrGeoXmlDocument *chunk = gebr_geoxml_document_clone(self->priv->flow);
+	GebrGeoXmlProgram *loop = gebr_geoxml_flow_get_control_program(GEBR_GEOXML_FLOW(chunk));
+	gchar *step = g_strdup_printf("%d", self->priv->loop_step);
+	gchar *ini = g_strdup_printf("%d", self->priv->loop_ini + self->priv->next_step * self->priv->loop_step);
+	gchar *n = g_strdup_printf("%d", size);
+	gebr_geoxml_program_control_set_n(loop, step, ini, n);
+	gebr_geoxml_object_unref(loop);
+
+	gchar *flow_xml = strip_flow(self->priv->validator, GEBR_GEOXML_FLOW(chunk));
+	gebr_geoxml_document_free(chunk);
+
+	self->priv->next_step += size;
+	self->priv->total++;
+	g_array_append_val(self->priv->finished_chunks, finished);
+
+	gchar *frac_str = g_strdup_printf("%d", self->priv->total);
+	gchar *numproc = g_strdup_printf("%d", MIN(np, size));
+
+	gebr_comm_daemon_add_task(daemon);
+	gebr_comm_daemon_reserve_cores(daemon, MIN(np, size));
+	gebr_comm_protocol_socket_oldmsg_send(server->socket, FALSE,
+					      gebr_comm_protocol_defs.run_def, 9,
+					      self->priv->gid,
+					      self->priv->id,
+					      frac_str,
+					      numproc,
+					      self->priv->nice,
+					      flow_xml,
+					      self->priv->paths,
+
+					      /* Moab and MPI settings */
+					      self->priv->account ? self->priv->account : "",
+					      "");
+
+	gchar *servers_list;
+	if (self->priv->servers_list)
+		servers_list = g_strdup_printf("%s,%s,%d", self->priv->servers_list, hostname, size);
+	else
+		servers_list = g_strdup_printf("%s,%d", hostname, size);
+	g_free(self->priv->servers_list);
+	self->priv->servers_list = servers_list;
+
+	g_free(step);
+	g_free(ini);
+	g_free(n);
+	g_free(frac_str);
+	g_free(numproc);
+	g_free(flow_xml);
+}
+
+/*
+ * divide_and_run_chunks:
+ *
+ * Sends the first chunk of the loop to each daemon. The remaining steps are
+ * sent by gebr_comm_runner_task_finished().
+ */
+static void
+divide_and_run_chunks(GebrCommRunner *self)
+{
+	gchar *step, *ini;
+	gchar *eval_step, *eval_ini;
+	GebrGeoXmlProgram *loop = gebr_geoxml_flow_get_control_program(GEBR_GEOXML_FLOW(self->priv->flow));
+
+	g_free(gebr_geoxml_program_control_get_n(loop, &step, &ini));
+	gebr_validator_evaluate(self->priv->validator, step, GEBR_GEOXML_PARAMETER_TYPE_INT, GEBR_GEOXML_DOCUMENT_TYPE_LINE, &eval_step, NULL);
+	gebr_validator_evaluate(self->priv->validator, ini, GEBR_GEOXML_PARAMETER_TYPE_INT, GEBR_GEOXML_DOCUMENT_TYPE_LINE, &eval_ini, NULL);
+
+	self->priv->loop_step = (gint) g_strtod(eval_step, NULL);
+	self->priv->loop_ini = (gint) g_strtod(eval_ini, NULL);
+	self->priv->nsteps = gebr_geoxml_program_control_get_eval_n(loop, self->priv->validator);
+	self->priv->next_step = 0;
+	self->priv->total = 0;
+	self->priv->finished_chunks = g_array_new(FALSE, FALSE, sizeof(gboolean));
+
+	gebr_geoxml_object_unref(loop);
+	g_free(step);
+	g_free(ini);
+	g_free(eval_step);
+	g_free(eval_ini);
+
+	gint k = 0;
+	for (GList *i = self->priv->servers; i; i = i->next, k++) {
+		if (!gebr_comm_runner_has_pending_steps(self))
+			break;
+		send_chunk(self, i->data, self->priv->numprocs[k]);
+	}
+
+	finish_dispatch(self);
+}
+
 static void
 divide_and_run_flows(GebrCommRunner *self)
 {
@@ -476,11 +647,6 @@ divide_and_run_flows(GebrCommRunner *self)
 	                                        self->priv->validator))
 		parallel = FALSE;
 
-	GList *flows = gebr_geoxml_flow_divide_flows(GEBR_GEOXML_FLOW(self->priv->flow),
-	                                             self->priv->validator,
-	                                             self->priv->distributed_n,
-	                                             n);
-
 	gint max_cores = 0;
 	for (gint k = 0; k < n; k++)
 		max_cores += self->priv->numprocs[k];
@@ -490,6 +656,17 @@ divide_and_run_flows(GebrCommRunner *self)
 	else
 		self->priv->ncores = g_strdup("1");
 
+	if (parallel && self->priv->scheduling == GEBR_COMM_RUNNER_SCHEDULING_DYNAMIC) {
+		self->priv->total_np = max_cores;
+		divide_and_run_chunks(self);
+		return;
+	}
+
+	GList *flows = gebr_geoxml_flow_divide_flows(GEBR_GEOXML_FLOW(self->priv->flow),
+	                                             self->priv->validator,
+	                                             self->priv->distributed_n,
+	                                             n);
+
 
 	GString *server_list = g_string_new("");
 
@@ -505,6 +682,7 @@ divide_and_run_flows(GebrCommRunner *self)
 		const gchar *hostname = gebr_comm_daemon_get_hostname(daemon);
 
 		gebr_comm_daemon_add_task(daemon);
+		gebr_comm_daemon_reserve_cores(daemon, self->priv->numprocs[k]);
 
 		g_string_append_printf(server_list, "%s,%d,",
 				       hostname, self->priv->weights[k]);
@@ -533,15 +711,13 @@ divide_and_run_flows(GebrCommRunner *self)
 	g_string_erase(server_list, server_list->len-1, 1);
 	self->priv->servers_list = g_string_free(server_list, FALSE);
 
-	if (self->priv->ran_func)
-		self->priv->ran_func(self, self->priv->user_data);
+	finish_dispatch(self);
 }
 
 static gboolean
 call_ran_func(GebrCommRunner *self)
 {
-	if (self->priv->ran_func)
-		self->priv->ran_func(self, self->priv->user_data);
+	finish_dispatch(self);
 
 	return FALSE;
 }
@@ -779,6 +955,65 @@ server_score_comp_func(ServerScore *a, ServerScore *b)
 }
 
 
+static GList *
+add_server_score(GList *scores,
+		 GebrCommDaemon *daemon,
+		 const gchar *load)
+{
+	GebrCommServer *server = gebr_comm_daemon_get_server(daemon);
+	gint running_jobs = gebr_comm_daemon_get_n_running_jobs(daemon);
+
+	return g_list_concat(scores, calculate_server_score(daemon,
+	                                                    load,
+	                                                    server->ncores,
+	                                                    server->clock_cpu,
+	                                                    running_jobs));
+}
+
+GList *
+gebr_comm_runner_score_daemons(GList *scores,
+			       GList *daemons)
+{
+	for (GList *i = daemons; i; i = i->next) {
+		GebrCommDaemon *daemon = i->data;
+		const gchar *load = gebr_comm_daemon_get_load(daemon);
+		scores = add_server_score(scores, daemon, load ? load : "0 0 0");
+	}
+
+	return g_list_sort(scores, (GCompareFunc)server_score_comp_func);
+}
+
+/*
+ * run_with_scores:
+ *
+ * Called once the load of every daemon is known. Daemons whose load was
+ * pushed to the maestro are scored only now, so the cores reserved by jobs
+ * dispatched in the meantime are taken into account.
+ */
+static void
+run_with_scores(GebrCommRunner *self)
+{
+	self->priv->cores_scores = gebr_comm_runner_score_daemons(self->priv->cores_scores,
+								  self->priv->cached_servers);
+	set_servers_execution_info(self);
+
+	GebrGeoXmlProgram *mpi_prog = gebr_geoxml_flow_get_first_mpi_program(GEBR_GEOXML_FLOW(self->priv->flow));
+	gboolean mpi = mpi_prog != NULL;
+	gebr_geoxml_object_unref(mpi_prog);
+
+	if (mpi)
+		mpi_run_flow(self);
+	else
+		divide_and_run_flows(self);
+}
+
+static gboolean
+run_with_scores_idle(GebrCommRunner *self)
+{
+	run_with_scores(self);
+	return FALSE;
+}
+
 static void
 on_response_received(GebrCommHttpMsg *request,
 		     GebrCommHttpMsg *response,
@@ -789,7 +1024,6 @@ on_response_received(GebrCommHttpMsg *request,
 	GebrCommJsonContent *json = gebr_comm_json_content_new(response->content->str);
 	GString *value = gebr_comm_json_content_to_gstring(json);
 	GebrCommDaemon *daemon = g_object_get_data(G_OBJECT(request), "current-server");
-	GebrCommServer *server = gebr_comm_daemon_get_server(daemon);
 
 	GebrGeoXmlProgram *loop = gebr_geoxml_flow_get_control_program(GEBR_GEOXML_FLOW(self->priv->flow));
 
@@ -804,29 +1038,11 @@ on_response_received(GebrCommHttpMsg *request,
 		gebr_geoxml_object_unref(loop);
 	}
 
-	gint running_jobs = gebr_comm_daemon_get_n_running_jobs(GEBR_COMM_DAEMON(daemon));
-
-	self->priv->cores_scores = g_list_concat(self->priv->cores_scores,
-	                                         calculate_server_score(daemon,
-	                                                                value->str,
-	                                                                server->ncores,
-	                                                                server->clock_cpu,
-	                                                                running_jobs));
+	self->priv->cores_scores = add_server_score(self->priv->cores_scores, daemon, value->str);
 
 	self->priv->responses++;
-	if (self->priv->responses == self->priv->requests) {
-		self->priv->cores_scores = g_list_sort(self->priv->cores_scores, (GCompareFunc)server_score_comp_func);
-		set_servers_execution_info(self);
-
-		GebrGeoXmlProgram *mpi_prog = gebr_geoxml_flow_get_first_mpi_program(GEBR_GEOXML_FLOW(self->priv->flow));
-		gboolean mpi = mpi_prog != NULL;
-		gebr_geoxml_object_unref(mpi_prog);
-
-		if (mpi)
-			mpi_run_flow(self);
-		else
-			divide_and_run_flows(self);
-	}
+	if (self->priv->responses == self->priv->requests)
+		run_with_scores(self);
 }
 
 void
@@ -839,11 +1055,54 @@ gebr_comm_runner_set_ran_func(GebrCommRunner *self,
 	self->priv->user_data = data;
 }
 
+void
+gebr_comm_runner_set_scheduling(GebrCommRunner *self,
+				GebrCommRunnerScheduling scheduling)
+{
+	self->priv->scheduling = scheduling;
+}
+
+gboolean
+gebr_comm_runner_has_pending_steps(GebrCommRunner *self)
+{
+	return self->priv->next_step < self->priv->nsteps;
+}
+
+gboolean
+gebr_comm_runner_task_finished(GebrCommRunner *self,
+			       GebrCommDaemon *daemon,
+			       gint frac)
+{
+	if (!self->priv->finished_chunks
+	    || frac < 1 || frac > self->priv->finished_chunks->len)
+		return FALSE;
+
+	/* A task may report its status more than once, e.g. when a daemon
+	 * reconnects. Only its first completion takes a new chunk. */
+	gboolean *finished = &g_array_index(self->priv->finished_chunks, gboolean, frac - 1);
+	if (*finished)
+		return FALSE;
+	*finished = TRUE;
+
+	if (!gebr_comm_runner_has_pending_steps(self)
+	    || !gebr_comm_daemon_can_execute(daemon))
+		return FALSE;
+
+	gint np = get_daemon_numprocs(self, daemon);
+	if (!np)
+		return FALSE;
+
+	send_chunk(self, daemon, np);
+	return TRUE;
+}
+
 gboolean
 gebr_comm_runner_run_async(GebrCommRunner *self)
 {
 	self->priv->requests = 0;
 	self->priv->responses = 0;
+	g_list_free(self->priv->cached_servers);
+	self->priv->cached_servers = NULL;
 	gboolean has_connected = FALSE;
 
 	GList *i = self->priv->servers;
@@ -857,6 +1116,14 @@ gebr_comm_runner_run_async(GebrCommRunner *self)
 			continue;
 		}
 
+		/* The daemon pushes its load periodically, no need to ask it */
+		if (gebr_comm_daemon_get_load(daemon)) {
+			self->priv->cached_servers = g_list_prepend(self->priv->cached_servers, daemon);
+			has_connected = TRUE;
+			i = i->next;
+			continue;
+		}
+
 		GebrCommHttpMsg *request;
 		GebrCommServer *server = gebr_comm_daemon_get_server(daemon);
 		GebrCommUri *uri = gebr_comm_uri_new();
@@ -884,6 +1151,9 @@ gebr_comm_runner_run_async(GebrCommRunner *self)
 		i = i->next;
 	}
 
+	if (has_connected && self->priv->requests == 0)
+		g_idle_add((GSourceFunc)run_with_scores_idle, self);
+
 	return has_connected;
 }
 
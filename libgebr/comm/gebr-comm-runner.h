@@ -21,6 +21,7 @@
 #include <glib.h>
 #include <libgebr/gebr-validator.h>
 #include <libgebr/comm/gebr-comm-server.h>
+#include <libgebr/comm/gebr-comm-daemon.h>
 
 G_BEGIN_DECLS
 
@@ -31,6 +32,18 @@ struct _GebrCommRunner {
 	GebrCommRunnerPriv *priv;
 };
 
+/**
+ * GebrCommRunnerScheduling:
+ * @GEBR_COMM_RUNNER_SCHEDULING_STATIC: The loop steps are split among the
+ * daemons once, proportionally to their scores, before the job starts.
+ * @GEBR_COMM_RUNNER_SCHEDULING_DYNAMIC: The loop steps are kept in a queue
+ * and handed to the daemons in chunks as they finish the previous ones.
+ */
+typedef enum {
+	GEBR_COMM_RUNNER_SCHEDULING_STATIC,
+	GEBR_COMM_RUNNER_SCHEDULING_DYNAMIC,
+} GebrCommRunnerScheduling;
+
 /**
  * gebr_comm_runner_new:
  *
@@ -59,6 +72,39 @@ void gebr_comm_runner_set_ran_func(GebrCommRunner *self,
 						 gpointer data),
 				   gpointer data);
 
+/**
+ * gebr_comm_runner_set_scheduling:
+ *
+ * Chooses how the steps of a parallelizable loop are distributed among the
+ * daemons. The default is %GEBR_COMM_RUNNER_SCHEDULING_STATIC. Flows without
+ * a parallelizable loop and MPI flows are always sent as a whole.
+ */
+void gebr_comm_runner_set_scheduling(GebrCommRunner *self,
+				     GebrCommRunnerScheduling scheduling);
+
+/**
+ * gebr_comm_runner_has_pending_steps:
+ *
+ * Returns: %TRUE if some loop steps were not sent to any daemon yet. This
+ * only happens with %GEBR_COMM_RUNNER_SCHEDULING_DYNAMIC.
+ */
+gboolean gebr_comm_runner_has_pending_steps(GebrCommRunner *self);
+
+/**
+ * gebr_comm_runner_task_finished:
+ * @daemon: the daemon which executed the task
+ * @frac: the task fraction, starting from 1
+ *
+ * Tells @self that the chunk @frac finished in @daemon. If there are pending
+ * loop steps, the next chunk is sent to @daemon with fraction
+ * gebr_comm_runner_get_total() and the servers list is updated.
+ *
+ * Returns: %TRUE if a new chunk was sent.
+ */
+gboolean gebr_comm_runner_task_finished(GebrCommRunner *self,
+					GebrCommDaemon *daemon,
+					gint frac);
+
 /**
  * gebr_comm_runner_free:
  */
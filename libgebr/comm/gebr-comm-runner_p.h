@@ -0,0 +1,51 @@
+/*   libgebr - GeBR Library
+ *   Copyright (C) 2007-2012 GeBR core team (http://www.gebrproject.com/)
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GEBR_COMM_RUNNER_P_H
+#define __GEBR_COMM_RUNNER_P_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/*
+ * gebr_comm_runner_score_daemons:
+ * @scores: a list of scores, or %NULL
+ * @daemons: a list of #GebrCommDaemon
+ *
+ * Appends the score of each core of @daemons to @scores, using the last load
+ * sent by each daemon, and sorts the list with the best scores first. The
+ * elements are allocated with g_new() and hold the daemon and its score.
+ */
+GList *gebr_comm_runner_score_daemons(GList *scores, GList *daemons);
+
+/*
+ * gebr_comm_runner_chunk_size:
+ * @remaining: loop steps not sent to any daemon yet
+ * @np: cores of the daemon taking the chunk
+ * @total_np: cores of all daemons running the loop
+ *
+ * Guided self-scheduling: a daemon with @np cores takes its share of the
+ * steps still in the queue, so chunks start large and shrink as the queue
+ * drains. A chunk has at least @np steps, to keep all cores busy.
+ *
+ * Returns: the number of steps of the next chunk.
+ */
+gint gebr_comm_runner_chunk_size(gint remaining, gint np, gint total_np);
+
+G_END_DECLS
+#endif				//__GEBR_COMM_RUNNER_P_H
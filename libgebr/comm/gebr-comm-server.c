@@ -41,6 +41,9 @@
  * Declarations
  */
 
+/* seconds a machine has to answer the handshake, by default */
+#define CONNECT_TIMEOUT 60
+
 typedef enum {
 	ISTATE_NONE,
 	ISTATE_PASS,
@@ -65,6 +68,14 @@ struct _GebrCommServerPriv {
 	GHashTable *qa_cache;
 
 	GList *pending_connections;
+
+	/* Bootstrap of the machine, from gebr_comm_server_connect() to the
+	 * login */
+	GebrCommPortProvider *port_provider;
+	GTimer *startup_timer;
+	gdouble startup_time;
+	guint connect_timeout;
+	guint connect_timeout_source;
 };
 
 G_DEFINE_TYPE(GebrCommServer, gebr_comm_server, G_TYPE_OBJECT);
@@ -110,6 +121,8 @@ static void	gebr_comm_server_free_x11_forward(GebrCommServer *server);
 
 static void	gebr_comm_server_free_for_reuse	(GebrCommServer *server);
 
+static void	gebr_comm_server_stop_bootstrap	(GebrCommServer *server);
+
 
 static void
 gebr_comm_server_init(GebrCommServer *server)
@@ -121,6 +134,11 @@ gebr_comm_server_init(GebrCommServer *server)
 	server->priv->istate = ISTATE_NONE;
 	server->priv->is_interactive = FALSE;
 	server->priv->pending_connections = NULL;
+	server->priv->port_provider = NULL;
+	server->priv->startup_timer = g_timer_new();
+	server->priv->startup_time = -1;
+	server->priv->connect_timeout = CONNECT_TIMEOUT;
+	server->priv->connect_timeout_source = 0;
 }
 
 static void
@@ -227,7 +245,9 @@ void
 gebr_comm_server_free(GebrCommServer *server)
 {
 	g_string_free(server->last_error, TRUE);
+	gebr_comm_server_stop_bootstrap(server);
 	gebr_comm_server_free_for_reuse(server);
+	g_timer_destroy(server->priv->startup_timer);
 	g_string_free(server->address, TRUE);
 	g_free(server->password);
 	g_free(server->memory);
@@ -331,8 +351,10 @@ on_comm_ssh_password(GebrCommSsh *ssh,
 
 		server->priv->pending_connections = g_list_append(server->priv->pending_connections, ssh);
 	} else {
+		server->priv->istate = ISTATE_PASS;
 		password = server->ops->ssh_login(server, _("SSH login:"), string->str,
 						  server->user_data);
+		server->priv->istate = ISTATE_NONE;
 		if (password == NULL) {
 			g_free(server->password);
 			server->password = NULL;
@@ -384,9 +406,11 @@ on_comm_ssh_question(GebrCommSsh *ssh,
 		gboolean answer;
 
 		if (!cached_answer) {
+			server->priv->istate = ISTATE_QUESTION;
 			answer = server->ops->ssh_question(server,
 							   _("SSH host key question:"),
 							   question, server->user_data);
+			server->priv->istate = ISTATE_NONE;
 
 			g_hash_table_insert(server->priv->qa_cache,
 					    g_strdup(question),
@@ -421,6 +445,35 @@ on_comm_port_accepts_key(GebrCommPortProvider *self,
 	server->priv->accepts_key = accepts_key;
 }
 
+/*
+ * on_connect_timeout:
+ *
+ * Gives up a machine that did not log in within its connect timeout. While
+ * the user is asked for a password or a question, the machine is given
+ * another period.
+ */
+static gboolean
+on_connect_timeout(GebrCommServer *server)
+{
+	if (server->priv->istate != ISTATE_NONE)
+		return TRUE;
+
+	server->priv->connect_timeout_source = 0;
+	gebr_comm_server_log_message(server, GEBR_LOG_WARNING,
+				     _("Machine '%s' did not answer in %u seconds."),
+				     server->address->str, server->priv->connect_timeout);
+
+	/* Not a disconnection, the machine never logged in */
+	g_signal_handlers_block_by_func(server->socket, gebr_comm_server_socket_disconnected, server);
+	gebr_comm_protocol_socket_disconnect(server->socket);
+	g_signal_handlers_unblock_by_func(server->socket, gebr_comm_server_socket_disconnected, server);
+
+	gebr_comm_server_disconnected_state(server, SERVER_ERROR_CONNECT,
+					    _("Machine did not answer in %u seconds."),
+					    server->priv->connect_timeout);
+	return FALSE;
+}
+
 void gebr_comm_server_connect(GebrCommServer *server,
 			      gboolean maestro)
 {
@@ -433,7 +486,15 @@ void gebr_comm_server_connect(GebrCommServer *server,
 	gebr_comm_server_disconnected_state(server, SERVER_ERROR_NONE, "");
 	gebr_comm_server_change_state(server, SERVER_STATE_RUN);
 
+	g_timer_start(server->priv->startup_timer);
+	server->priv->startup_time = -1;
+	if (server->priv->connect_timeout)
+		server->priv->connect_timeout_source =
+			g_timeout_add_seconds(server->priv->connect_timeout,
+					      (GSourceFunc) on_connect_timeout, server);
+
 	server->tried_existant_pass = FALSE;
+	server->priv->istate = ISTATE_NONE;
 	server->priv->is_maestro = maestro;
 
 	if (maestro)
@@ -449,6 +510,7 @@ void gebr_comm_server_connect(GebrCommServer *server,
 	g_signal_connect(port_provider, "password", G_CALLBACK(on_comm_port_password), server);
 	g_signal_connect(port_provider, "question", G_CALLBACK(on_comm_port_question), server);
 	g_signal_connect(port_provider, "accepts-key", G_CALLBACK(on_comm_port_accepts_key), server);
+	server->priv->port_provider = port_provider;
 	gebr_comm_port_provider_start(port_provider);
 }
 
@@ -469,9 +531,30 @@ void
 gebr_comm_server_set_logged(GebrCommServer *server)
 {
 	server->socket->protocol->logged = TRUE;
+
+	if (server->priv->startup_time < 0) {
+		server->priv->startup_time = g_timer_elapsed(server->priv->startup_timer, NULL);
+		gebr_comm_server_log_message(server, GEBR_LOG_INFO, _("Machine '%s' logged in %.2lf seconds."),
+					     server->address->str, server->priv->startup_time);
+	}
+	gebr_comm_server_stop_bootstrap(server);
+
 	gebr_comm_server_change_state(server, SERVER_STATE_LOGGED);
 }
 
+gdouble
+gebr_comm_server_get_startup_time(GebrCommServer *server)
+{
+	return server->priv->startup_time;
+}
+
+void
+gebr_comm_server_set_connect_timeout(GebrCommServer *server,
+				     guint seconds)
+{
+	server->priv->connect_timeout = seconds;
+}
+
 gboolean gebr_comm_server_is_local(GebrCommServer *server)
 {
 	return strcmp(server->address->str, "127.0.0.1") == 0 ? TRUE : strcmp(server->address->str, "localhost") == 0 ? TRUE : FALSE;
@@ -594,6 +677,7 @@ static void gebr_comm_server_disconnected_state(GebrCommServer *server,
 
 	/* take care not to free the process here cause this function
 	 * maybe be used by Process's read callback */
+	gebr_comm_server_stop_bootstrap(server);
 	server->port = 0;
 	server->socket->protocol->logged = FALSE;
 	gebr_comm_server_change_state(server, SERVER_STATE_DISCONNECTED);
@@ -683,14 +767,15 @@ gebr_comm_server_socket_connected(GebrCommProtocolSocket * socket,
 		               gchar *daemon_location = g_find_program_in_path("daemon");
 
 			       gebr_comm_protocol_socket_oldmsg_send(server->socket, FALSE,
-								     gebr_comm_protocol_defs.ini_def, 7,
+								     gebr_comm_protocol_defs.ini_def, 8,
 								     g_get_host_name(),
 								     gebr_version(),
 								     mcookie_str,
 								     server->priv->gebr_id,
 								     gebr_time_iso,
 								     maestro_location ? "1" : "0",
-								     daemon_location ? "1" : "0");
+								     daemon_location ? "1" : "0",
+								     G_STRINGIFY(GEBR_COMM_PROTOCOL_FRAMING));
 
 			       g_free(maestro_location);
 			       g_free(daemon_location);
@@ -699,9 +784,10 @@ gebr_comm_server_socket_connected(GebrCommProtocolSocket * socket,
 		g_free(gebr_time_iso);
 	} else {
 		gebr_comm_protocol_socket_oldmsg_send(server->socket, FALSE,
-						      gebr_comm_protocol_defs.ini_def, 2,
+						      gebr_comm_protocol_defs.ini_def, 3,
 						      gebr_comm_protocol_get_version(),
-						      hostname);
+						      hostname,
+						      G_STRINGIFY(GEBR_COMM_PROTOCOL_FRAMING));
 	}
 
 }
@@ -739,6 +825,26 @@ gebr_comm_server_socket_old_parse_messages(GebrCommProtocolSocket *socket,
 	server->ops->parse_messages(server, server->user_data);
 }
 
+/**
+ * \internal
+ * Stops the connect timeout and forgets the port provider of the last
+ * gebr_comm_server_connect(), so a port it finds late is ignored.
+ */
+static void gebr_comm_server_stop_bootstrap(GebrCommServer *server)
+{
+	if (server->priv->connect_timeout_source) {
+		g_source_remove(server->priv->connect_timeout_source);
+		server->priv->connect_timeout_source = 0;
+	}
+
+	if (server->priv->port_provider) {
+		g_signal_handlers_disconnect_matched(server->priv->port_provider, G_SIGNAL_MATCH_DATA,
+						     0, 0, NULL, NULL, server);
+		g_object_unref(server->priv->port_provider);
+		server->priv->port_provider = NULL;
+	}
+}
+
 /**
  * \internal
  * Free (if necessary) server->x11_forward_process for reuse
@@ -805,6 +911,7 @@ void
 gebr_comm_server_set_password(GebrCommServer *server, const gchar *pass)
 {
 	server->password = g_strdup(pass);
+	server->priv->istate = ISTATE_NONE;
 
 	for (GList *i = server->priv->pending_connections; i; i = i->next)
 		gebr_comm_ssh_set_password(i->data, server->password);
@@ -817,6 +924,8 @@ void
 gebr_comm_server_answer_question(GebrCommServer *server,
 				 gboolean response)
 {
+	server->priv->istate = ISTATE_NONE;
+
 	for (GList *i = server->priv->pending_connections; i; i = i->next)
 		gebr_comm_ssh_answer_question(i->data, response);
 
@@ -185,6 +185,23 @@ gboolean gebr_comm_server_is_logged(GebrCommServer *gebr_comm_server);
 
 void gebr_comm_server_set_logged(GebrCommServer *server);
 
+/**
+ * gebr_comm_server_get_startup_time:
+ *
+ * Returns: the seconds @server took from gebr_comm_server_connect() to the
+ * login, or a negative value if it is not logged since it was last connected.
+ */
+gdouble gebr_comm_server_get_startup_time(GebrCommServer *server);
+
+/**
+ * gebr_comm_server_set_connect_timeout:
+ *
+ * Sets the @seconds @server has to log in after gebr_comm_server_connect()
+ * before it is disconnected with %SERVER_ERROR_CONNECT. Zero waits forever.
+ */
+void gebr_comm_server_set_connect_timeout(GebrCommServer *server,
+					  guint seconds);
+
 gboolean gebr_comm_server_is_local(GebrCommServer *gebr_comm_server);
 
 void gebr_comm_server_kill(GebrCommServer *gebr_comm_server);
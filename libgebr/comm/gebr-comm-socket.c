@@ -22,6 +22,7 @@
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <sys/ioctl.h>
+#include <sys/uio.h>
 #include <netdb.h>
 #include <netinet/in.h>
 #include <netinet/ip.h>
@@ -32,6 +33,32 @@
 #include "gebr-comm-socketprivate.h"
 #include "gebr-comm-socketaddressprivate.h"
 
+/* default of gebr_comm_socket_set_high_water_mark() */
+#define HIGH_WATER_MARK		(1 << 20)
+/* small writes are appended to the last queued chunk, when possible */
+#define CHUNK_SIZE		(16 << 10)
+/* chunks given to each sendmsg() */
+#define WRITE_IOV_MAX		64
+
+#ifdef MSG_NOSIGNAL
+# define SEND_FLAGS (MSG_DONTWAIT | MSG_NOSIGNAL)
+#else
+# define SEND_FLAGS MSG_DONTWAIT
+#endif
+
+struct _GebrCommSocketChunk {
+	gint ref_count;
+	gsize len;
+	gsize size;
+	gchar *data;
+};
+
+/* a chunk in the write queue of a socket */
+typedef struct {
+	GebrCommSocketChunk *chunk;
+	GTimeVal queued;
+} QueuedChunk;
+
 /*
  * gobject stuff
  */
@@ -40,6 +67,7 @@ enum {
 	READY_READ,
 	READY_WRITE,
 	ERROR,
+	HIGH_WATER,
 	LAST_SIGNAL
 };
 static guint object_signals[LAST_SIGNAL];
@@ -58,6 +86,8 @@ static void gebr_comm_socket_class_init(GebrCommSocketClass * class)
 						   g_cclosure_marshal_VOID__VOID, G_TYPE_NONE, 0);
 	object_signals[ERROR] = g_signal_new("error", GEBR_COMM_SOCKET_TYPE, (GSignalFlags) (G_SIGNAL_RUN_LAST | G_SIGNAL_ACTION), G_STRUCT_OFFSET(GebrCommSocketClass, error), NULL, NULL,	/* acumulators */
 					     g_cclosure_marshal_VOID__INT, G_TYPE_NONE, 1, G_TYPE_INT);
+	object_signals[HIGH_WATER] = g_signal_new("high-water", GEBR_COMM_SOCKET_TYPE, (GSignalFlags) (G_SIGNAL_RUN_LAST | G_SIGNAL_ACTION), G_STRUCT_OFFSET(GebrCommSocketClass, high_water), NULL, NULL,	/* acumulators */
+						  g_cclosure_marshal_VOID__BOOLEAN, G_TYPE_NONE, 1, G_TYPE_BOOLEAN);
 }
 
 static void gebr_comm_socket_init(GebrCommSocket * socket)
@@ -128,25 +158,124 @@ static gboolean __gebr_comm_socket_read(GIOChannel * source, GIOCondition condit
 	return TRUE;
 }
 
+static void
+queued_chunk_free(QueuedChunk *queued)
+{
+	gebr_comm_socket_chunk_unref(queued->chunk);
+	g_free(queued);
+}
+
+static void
+update_congestion(GebrCommSocket * socket)
+{
+	gboolean congested;
+
+	if (socket->stats.queued_bytes > socket->high_water_mark)
+		congested = TRUE;
+	else if (socket->stats.queued_bytes < socket->high_water_mark / 2)
+		congested = FALSE;
+	else
+		return;
+
+	if (congested != socket->congested) {
+		socket->congested = congested;
+		g_signal_emit(socket, object_signals[HIGH_WATER], 0, congested);
+	}
+}
+
+static void
+enqueue_chunk(GebrCommSocket * socket, GebrCommSocketChunk *chunk)
+{
+	QueuedChunk *queued = g_new(QueuedChunk, 1);
+
+	queued->chunk = chunk;
+	g_get_current_time(&queued->queued);
+	g_queue_push_tail(socket->write_queue, queued);
+
+	socket->stats.queued_bytes += chunk->len;
+	socket->stats.max_queued_bytes = MAX(socket->stats.max_queued_bytes, socket->stats.queued_bytes);
+	update_congestion(socket);
+}
+
+/*
+ * Drops @written bytes from the head of the write queue.
+ */
+static void
+consume_queue(GebrCommSocket * socket, gsize written)
+{
+	GTimeVal now;
+
+	g_get_current_time(&now);
+	socket->stats.queued_bytes -= written;
+	socket->stats.sent_bytes += written;
+
+	while (written) {
+		QueuedChunk *queued = g_queue_peek_head(socket->write_queue);
+		gsize left = queued->chunk->len - socket->write_offset;
+
+		if (written < left) {
+			socket->write_offset += written;
+			break;
+		}
+
+		written -= left;
+		socket->write_offset = 0;
+		socket->stats.last_flush_latency = (now.tv_sec - queued->queued.tv_sec)
+			+ (now.tv_usec - queued->queued.tv_usec) / 1e6;
+		socket->stats.max_flush_latency = MAX(socket->stats.max_flush_latency,
+						      socket->stats.last_flush_latency);
+		queued_chunk_free(g_queue_pop_head(socket->write_queue));
+	}
+
+	update_congestion(socket);
+}
+
+/*
+ * Writes the queued chunks, gathering many of them in each call, until the
+ * queue is empty or the socket can't take more data without blocking.
+ */
 void __gebr_comm_socket_write_queue(GebrCommSocket * socket)
 {
 	g_return_if_fail(socket->state == GEBR_COMM_SOCKET_STATE_CONNECTED);
-	/* write queud bytes */
-	if (socket->queue_write_bytes->len) {
-		ssize_t written_bytes;
 
-		_gebr_comm_socket_enable_write_watch(socket);
+	while (!g_queue_is_empty(socket->write_queue)) {
+		struct iovec iov[WRITE_IOV_MAX];
+		struct msghdr msg;
+		gsize offset = socket->write_offset;
+		gint n = 0;
+
+		for (GList *i = socket->write_queue->head; i && n < WRITE_IOV_MAX; i = i->next, n++) {
+			QueuedChunk *queued = i->data;
+			iov[n].iov_base = queued->chunk->data + offset;
+			iov[n].iov_len = queued->chunk->len - offset;
+			offset = 0;
+		}
+
+		memset(&msg, 0, sizeof(msg));
+		msg.msg_iov = iov;
+		msg.msg_iovlen = n;
 
-		written_bytes = send(_gebr_comm_socket_get_fd(socket), socket->queue_write_bytes->data,
-				     socket->queue_write_bytes->len > 4096 ? 4096 : socket->queue_write_bytes->len, 0);
+		ssize_t written_bytes = sendmsg(_gebr_comm_socket_get_fd(socket), &msg, SEND_FLAGS);
+		if (written_bytes == -1) {
+			if (errno == EINTR)
+				continue;
+			/* EAGAIN, or an error reported by the watches */
+			break;
+		}
 
-		if (written_bytes != -1)
-			g_byte_array_remove_range(socket->queue_write_bytes, 0, written_bytes);
+		consume_queue(socket, written_bytes);
 	}
+
+	if (!g_queue_is_empty(socket->write_queue))
+		_gebr_comm_socket_enable_write_watch(socket);
 }
 
 static gboolean __gebr_comm_socket_write(GIOChannel * source, GIOCondition condition, GebrCommSocket * socket)
 {
+	/* this watch is always removed, __gebr_comm_socket_write_queue() adds
+	 * another one if needed */
+	socket->write_watch_id = 0;
+
 	if (condition & G_IO_NVAL) {
 		/* probably a fd change */
 		goto out;
@@ -157,6 +286,7 @@ static gboolean __gebr_comm_socket_write(GIOChannel * source, GIOCondition condi
 			_gebr_comm_socket_emit_error(socket, GEBR_COMM_SOCKET_ERROR_CONNECTION_REFUSED);
 			break;
 		case EINPROGRESS:
+			socket->write_watch_id = g_source_get_id(g_main_current_source());
 			return TRUE;
 		case 0:
 			return FALSE;
@@ -187,6 +317,10 @@ static gboolean __gebr_comm_socket_write(GIOChannel * source, GIOCondition condi
 			socket->state = GEBR_COMM_SOCKET_STATE_CONNECTED;
 			if (klass->connected != NULL)
 				klass->connected(socket);
+			/* flush what was written while connecting */
+			if (socket->state == GEBR_COMM_SOCKET_STATE_CONNECTED && socket->write_queue
+			    && !g_queue_is_empty(socket->write_queue))
+				__gebr_comm_socket_write_queue(socket);
 			break;
 		default:
 			break;
@@ -221,8 +355,12 @@ void _gebr_comm_socket_init(GebrCommSocket * socket, int fd, enum GebrCommSocket
 	socket->io_channel = g_io_channel_unix_new(fd);
 	g_io_channel_set_encoding(socket->io_channel, NULL, &error);
 	g_io_channel_set_close_on_unref(socket->io_channel, TRUE);
-	/* byte array */
-	socket->queue_write_bytes = g_byte_array_new();
+	/* write queue */
+	socket->write_queue = g_queue_new();
+	socket->write_offset = 0;
+	socket->high_water_mark = HIGH_WATER_MARK;
+	socket->congested = FALSE;
+	memset(&socket->stats, 0, sizeof(socket->stats));
 }
 
 void _gebr_comm_socket_close(GebrCommSocket * socket)
@@ -232,14 +370,18 @@ void _gebr_comm_socket_close(GebrCommSocket * socket)
 
 		if (socket->write_watch_id)
 			g_source_remove(socket->write_watch_id);
+		socket->write_watch_id = 0;
 
 		if (socket->read_watch_id)
 			g_source_remove(socket->read_watch_id);
+		socket->read_watch_id = 0;
 
 		error = NULL;
 		g_io_channel_unref(socket->io_channel);
 		socket->io_channel = NULL;
-		g_byte_array_free(socket->queue_write_bytes, TRUE);
+		g_queue_foreach(socket->write_queue, (GFunc)queued_chunk_free, NULL);
+		g_queue_free(socket->write_queue);
+		socket->write_queue = NULL;
 	}
 }
 
@@ -256,6 +398,8 @@ void _gebr_comm_socket_enable_read_watch(GebrCommSocket * socket)
 
 void _gebr_comm_socket_enable_write_watch(GebrCommSocket * socket)
 {
+	if (socket->write_watch_id)
+		return;
 	socket->write_watch_id = g_io_add_watch(socket->io_channel, G_IO_OUT | G_IO_HUP | G_IO_ERR | G_IO_NVAL,
 						(GIOFunc) __gebr_comm_socket_write, socket);
 }
@@ -356,7 +500,7 @@ gulong gebr_comm_socket_bytes_to_write(GebrCommSocket * socket)
 {
 	g_return_val_if_fail(GEBR_COMM_IS_SOCKET(socket), 0);
 
-	return socket->queue_write_bytes->len;
+	return socket->stats.queued_bytes;
 }
 
 GByteArray *gebr_comm_socket_read(GebrCommSocket * socket, gsize max_size)
@@ -402,6 +546,20 @@ GString *gebr_comm_socket_read_string(GebrCommSocket * socket, gsize max_size)
 	return string;
 }
 
+/*
+ * Reads at most @max_size bytes straight into @buffer, without intermediate
+ * copies. Returns the number of bytes read or -1 on error.
+ */
+gssize gebr_comm_socket_read_buffer(GebrCommSocket * socket, gchar *buffer, gsize max_size)
+{
+	g_return_val_if_fail(GEBR_COMM_IS_SOCKET(socket), -1);
+
+	if (socket->state != GEBR_COMM_SOCKET_STATE_CONNECTED)
+		return -1;
+
+	return recv(_gebr_comm_socket_get_fd(socket), buffer, max_size, 0);
+}
+
 GByteArray *gebr_comm_socket_read_all(GebrCommSocket * socket)
 {
 	g_return_val_if_fail(GEBR_COMM_IS_SOCKET(socket), NULL);
@@ -418,11 +576,41 @@ GString *gebr_comm_socket_read_string_all(GebrCommSocket * socket)
 	return gebr_comm_socket_read_string(socket, gebr_comm_socket_bytes_available(socket));
 }
 
+/*
+ * Queues a copy of @data, appending it to the last queued chunk if there is
+ * room for it there.
+ */
+static void
+queue_data(GebrCommSocket * socket, const guint8 *data, gsize len)
+{
+	QueuedChunk *tail = g_queue_peek_tail(socket->write_queue);
+
+	if (!len)
+		return;
+
+	if (tail && tail->chunk->ref_count == 1 && tail->chunk->size - tail->chunk->len >= len) {
+		memcpy(tail->chunk->data + tail->chunk->len, data, len);
+		tail->chunk->len += len;
+		socket->stats.queued_bytes += len;
+		socket->stats.max_queued_bytes = MAX(socket->stats.max_queued_bytes, socket->stats.queued_bytes);
+		update_congestion(socket);
+		return;
+	}
+
+	GebrCommSocketChunk *chunk = g_new(GebrCommSocketChunk, 1);
+	chunk->ref_count = 1;
+	chunk->len = len;
+	chunk->size = MAX(len, CHUNK_SIZE);
+	chunk->data = g_malloc(chunk->size);
+	memcpy(chunk->data, data, len);
+	enqueue_chunk(socket, chunk);
+}
+
 void gebr_comm_socket_write(GebrCommSocket * socket, GByteArray * byte_array)
 {
 	g_return_if_fail(GEBR_COMM_IS_SOCKET(socket));
 
-	g_byte_array_append(socket->queue_write_bytes, byte_array->data, byte_array->len);
+	queue_data(socket, byte_array->data, byte_array->len);
 	_gebr_comm_socket_enable_write_watch(socket);
 }
 
@@ -430,7 +618,7 @@ void gebr_comm_socket_write_immediately(GebrCommSocket * socket, GByteArray * by
 {
 	g_return_if_fail(GEBR_COMM_IS_SOCKET(socket));
 
-	g_byte_array_append(socket->queue_write_bytes, byte_array->data, byte_array->len);
+	queue_data(socket, byte_array->data, byte_array->len);
 	__gebr_comm_socket_write_queue(socket);
 }
 
@@ -457,3 +645,61 @@ void gebr_comm_socket_write_string_immediately(GebrCommSocket * socket, GString
 
 	gebr_comm_socket_write_immediately(socket, &byte_array);
 }
+
+GebrCommSocketChunk *gebr_comm_socket_chunk_new(const gchar *data, gsize len)
+{
+	GebrCommSocketChunk *chunk = g_new(GebrCommSocketChunk, 1);
+
+	chunk->ref_count = 1;
+	chunk->len = chunk->size = len;
+	chunk->data = g_memdup(data, len);
+
+	return chunk;
+}
+
+GebrCommSocketChunk *gebr_comm_socket_chunk_ref(GebrCommSocketChunk *chunk)
+{
+	g_atomic_int_inc(&chunk->ref_count);
+	return chunk;
+}
+
+void gebr_comm_socket_chunk_unref(GebrCommSocketChunk *chunk)
+{
+	if (!g_atomic_int_dec_and_test(&chunk->ref_count))
+		return;
+	g_free(chunk->data);
+	g_free(chunk);
+}
+
+void gebr_comm_socket_write_chunk(GebrCommSocket * socket, GebrCommSocketChunk *chunk)
+{
+	g_return_if_fail(GEBR_COMM_IS_SOCKET(socket));
+
+	if (!chunk->len)
+		return;
+
+	enqueue_chunk(socket, gebr_comm_socket_chunk_ref(chunk));
+	_gebr_comm_socket_enable_write_watch(socket);
+}
+
+void gebr_comm_socket_set_high_water_mark(GebrCommSocket * socket, gsize bytes)
+{
+	g_return_if_fail(GEBR_COMM_IS_SOCKET(socket));
+
+	socket->high_water_mark = bytes;
+	update_congestion(socket);
+}
+
+gboolean gebr_comm_socket_is_congested(GebrCommSocket * socket)
+{
+	g_return_val_if_fail(GEBR_COMM_IS_SOCKET(socket), FALSE);
+
+	return socket->congested;
+}
+
+void gebr_comm_socket_get_stats(GebrCommSocket * socket, GebrCommSocketStats *stats)
+{
+	g_return_if_fail(GEBR_COMM_IS_SOCKET(socket));
+
+	*stats = socket->stats;
+}
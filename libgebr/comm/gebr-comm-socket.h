@@ -58,13 +58,42 @@ enum GebrCommSocketState {
 	GEBR_COMM_SOCKET_STATE_LISTENING,
 };
 
+/**
+ * GebrCommSocketChunk:
+ *
+ * A reference counted piece of data to be written. The same chunk can be
+ * queued in several sockets without being copied.
+ */
+typedef struct _GebrCommSocketChunk GebrCommSocketChunk;
+
+/**
+ * GebrCommSocketStats:
+ * @queued_bytes: bytes waiting to be written
+ * @max_queued_bytes: the largest @queued_bytes seen
+ * @sent_bytes: bytes written since the socket was initialized
+ * @last_flush_latency: seconds between queueing and writing the last chunk
+ * @max_flush_latency: the largest @last_flush_latency seen
+ */
+typedef struct {
+	gsize queued_bytes;
+	gsize max_queued_bytes;
+	guint64 sent_bytes;
+	gdouble last_flush_latency;
+	gdouble max_flush_latency;
+} GebrCommSocketStats;
+
 struct _GebrCommSocket {
 	GObject parent;
 
 	GIOChannel *io_channel;
 	guint write_watch_id;
 	guint read_watch_id;
-	GByteArray *queue_write_bytes;
+	/* chunks waiting to be written and bytes of the head one already written */
+	GQueue *write_queue;
+	gsize write_offset;
+	gsize high_water_mark;
+	gboolean congested;
+	GebrCommSocketStats stats;
 
 	enum GebrCommSocketAddressType address_type;
 	enum GebrCommSocketState state;
@@ -81,6 +110,7 @@ struct _GebrCommSocketClass {
 	void (*ready_read) (GebrCommSocket * self);
 	void (*ready_write) (GebrCommSocket * self);
 	void (*error) (GebrCommSocket * self, enum GebrCommSocketError error);
+	void (*high_water) (GebrCommSocket * self, gboolean congested);
 };
 
 /*
@@ -111,6 +141,8 @@ GByteArray *gebr_comm_socket_read_all(GebrCommSocket *);
 
 GString *gebr_comm_socket_read_string_all(GebrCommSocket *);
 
+gssize gebr_comm_socket_read_buffer(GebrCommSocket *, gchar *, gsize);
+
 void gebr_comm_socket_write(GebrCommSocket *, GByteArray *);
 
 void gebr_comm_socket_write_string(GebrCommSocket *, GString *);
@@ -119,5 +151,36 @@ void gebr_comm_socket_write_immediately(GebrCommSocket *, GByteArray *);
 
 void gebr_comm_socket_write_string_immediately(GebrCommSocket *, GString *);
 
+GebrCommSocketChunk *gebr_comm_socket_chunk_new(const gchar *data, gsize len);
+
+GebrCommSocketChunk *gebr_comm_socket_chunk_ref(GebrCommSocketChunk *chunk);
+
+void gebr_comm_socket_chunk_unref(GebrCommSocketChunk *chunk);
+
+/**
+ * gebr_comm_socket_write_chunk:
+ *
+ * Queues a reference to @chunk, without copying its data.
+ */
+void gebr_comm_socket_write_chunk(GebrCommSocket *, GebrCommSocketChunk *chunk);
+
+/**
+ * gebr_comm_socket_set_high_water_mark:
+ *
+ * The "high-water" signal is emitted with %TRUE when more than @bytes are
+ * queued for writing, and with %FALSE when the queue drains below half of
+ * it. Producers can use it to throttle or coalesce what they write.
+ */
+void gebr_comm_socket_set_high_water_mark(GebrCommSocket *, gsize bytes);
+
+/**
+ * gebr_comm_socket_is_congested:
+ *
+ * Returns: %TRUE between the "high-water" signals with %TRUE and %FALSE.
+ */
+gboolean gebr_comm_socket_is_congested(GebrCommSocket *);
+
+void gebr_comm_socket_get_stats(GebrCommSocket *, GebrCommSocketStats *stats);
+
 G_END_DECLS
 #endif				//__GEBR_COMM_SOCKET_H
@@ -35,6 +35,7 @@
 #define ACCEPTS_PUBLIC_KEY "Authentications that can continue:"
 #define SSH_ERROR_PREFIX "ssh: "
 #define SENDING_COMMAND "Sending command: "
+#define MUX_SESSION "master session id: "
 
 
 G_DEFINE_TYPE(GebrCommSsh, gebr_comm_ssh, G_TYPE_OBJECT);
@@ -271,8 +272,14 @@ static void
 ssh_process_finished(GebrCommTerminalProcess *process,
 		     GebrCommSsh *self)
 {
+	/* The output of a multiplexed session is not followed by a debug line */
+	if (self->priv->out_state == SSH_OUT_STATE_COMMAND_OUTPUT && self->priv->out_buffer->len) {
+		g_signal_emit(self, signals[SSH_STDOUT], 0, self->priv->out_buffer);
+		self->priv->out_state = SSH_OUT_STATE_INIT;
+	}
+
 	self->priv->state = GEBR_COMM_SSH_STATE_FINISHED;
-	gebr_comm_terminal_process_free(process);
+	g_signal_emit(self, signals[SSH_FINISHED], 0, NULL);
 }
 
 static gchar *
@@ -343,7 +350,7 @@ process_ssh_line(GebrCommSsh *self,
 			self->priv->state = GEBR_COMM_SSH_STATE_ERROR;
 			g_signal_emit(self, signals[SSH_ERROR], 0, line + strlen(SSH_ERROR_PREFIX));
 		}
-		else if (strstr(line, SENDING_COMMAND)) {
+		else if (strstr(line, SENDING_COMMAND) || strstr(line, MUX_SESSION)) {
 			self->priv->out_state = SSH_OUT_STATE_COMMAND_OUTPUT;
 		}
 	} else if (self->priv->out_state == SSH_OUT_STATE_COMMAND_OUTPUT) {
@@ -0,0 +1,822 @@
+/*
+ * gebr-comm-transport-pool.c
+ * This file is part of GêBR Project
+ *
+ * Copyright (C) 2012 - GêBR Core Team (www.gebrproject.com)
+ *
+ * GêBR Project is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * GêBR Project is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GêBR Project. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gebr-comm-transport-pool.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <glib/gstdio.h>
+#include "gebr-comm-utils.h"
+
+/* Interval to check if a session being opened is up, in milliseconds */
+#define POLL_INTERVAL 200
+
+/* Interval between the health checks of the sessions, in seconds */
+#define HEALTH_CHECK_INTERVAL 30
+
+/* Keep-alive of the ssh sessions: a session is closed by ssh after
+ * SERVER_ALIVE_COUNT unanswered probes, sent every SERVER_ALIVE_INTERVAL
+ * seconds of silence */
+#define SERVER_ALIVE_INTERVAL 15
+#define SERVER_ALIVE_COUNT 3
+
+typedef struct _Check Check;
+
+typedef struct {
+	GebrCommTransportPool *pool;
+	gchar *address;
+	gchar *control_path;
+	GebrCommTransportState state;
+	GebrCommSsh *master;
+	GebrCommSsh *opening;
+	GList *waiters;
+	guint poll_id;
+	Check *check;
+} Session;
+
+/*
+ * A "check" control command running in the background. A check outliving
+ * its session is detached from it and only reaped.
+ */
+struct _Check {
+	Session *session;
+	void (*done) (Session *session, gboolean alive);
+};
+
+typedef struct {
+	GebrCommTransportReadyFunc func;
+	gpointer user_data;
+} Waiter;
+
+/*
+ * A "forward" or "cancel" control command running in the background. Its
+ * callback is not called if the pool is freed first.
+ */
+typedef struct {
+	GebrCommTransportPool *pool;
+	gchar *address;
+	gint err_fd;
+	GebrCommTransportReadyFunc func;
+	gpointer user_data;
+} Control;
+
+/*
+ * TransportMethods:
+ *
+ * The command lines of a kind of transport. The session command must keep
+ * running while the session is up; the control commands, "check", "exit",
+ * "forward" and "cancel", must exit with status 0 on success.
+ */
+struct TransportMethods {
+	gchar *(*get_session_command) (Session *session);
+	gchar *(*get_command)         (Session *session, const gchar *flags, const gchar *remote_command);
+	gchar *(*get_control_command) (Session *session, const gchar *operation, const gchar *forward);
+};
+
+struct _GebrCommTransportPool {
+	struct TransportMethods *methods;
+	gchar *control_dir;
+	GHashTable *sessions;
+	GList *controls;
+	guint health_check_id;
+};
+
+GQuark
+gebr_comm_transport_pool_error_quark(void)
+{
+	return g_quark_from_static_string("gebr-comm-transport-pool-error-quark");
+}
+
+/* ssh transport {{{ */
+static gchar *
+ssh_get_base_command(Session *session)
+{
+	gchar *ssh_cmd = gebr_comm_get_ssh_command_with_key();
+	gchar *path = g_shell_quote(session->control_path);
+	gchar *cmd = g_strdup_printf("%s -o ControlPath=%s -o ServerAliveInterval=%d -o ServerAliveCountMax=%d",
+				     ssh_cmd, path, SERVER_ALIVE_INTERVAL, SERVER_ALIVE_COUNT);
+	g_free(ssh_cmd);
+	g_free(path);
+	return cmd;
+}
+
+static gchar *
+ssh_get_session_command(Session *session)
+{
+	gchar *base = ssh_get_base_command(session);
+	gchar *cmd = g_strdup_printf("%s -o ControlMaster=yes -v -x -N %s", base, session->address);
+	g_free(base);
+	return cmd;
+}
+
+static gchar *
+ssh_get_command(Session *session,
+		const gchar *flags,
+		const gchar *remote_command)
+{
+	gchar *base = ssh_get_base_command(session);
+	gchar *cmd = g_strdup_printf("%s -o ControlMaster=no %s %s %s", base,
+				     flags ? flags : "", session->address, remote_command);
+	g_free(base);
+	return cmd;
+}
+
+static gchar *
+ssh_get_control_command(Session *session,
+			const gchar *operation,
+			const gchar *forward)
+{
+	gchar *base = ssh_get_base_command(session);
+	gchar *cmd = g_strdup_printf("%s -O %s %s %s", base, operation,
+				     forward ? forward : "", session->address);
+	g_free(base);
+	return cmd;
+}
+
+static struct TransportMethods ssh_methods = {
+	.get_session_command = ssh_get_session_command,
+	.get_command         = ssh_get_command,
+	.get_control_command = ssh_get_control_command,
+};
+/* }}} */
+
+/* Loopback transport {{{ */
+/*
+ * The session is a local process that writes its pid to the control path.
+ * Commands run in the local machine, printing the same lines as `ssh -v'
+ * around their output, so they can be parsed by #GebrCommSsh.
+ */
+static gchar *
+loopback_get_session_command(Session *session)
+{
+	gchar *path = g_shell_quote(session->control_path);
+	gchar *cmd = g_strdup_printf("sh -c 'echo $$ > \"$0\" && exec cat' %s", path);
+	g_free(path);
+	return cmd;
+}
+
+static gchar *
+loopback_get_command(Session *session,
+		     const gchar *flags,
+		     const gchar *remote_command)
+{
+	return g_strdup_printf("sh -c 'echo \"debug1: Sending command: $0\"; eval \"$0\"; "
+			       "echo \"debug1: Exit status $?\"' %s", remote_command);
+}
+
+static gchar *
+loopback_get_control_command(Session *session,
+			     const gchar *operation,
+			     const gchar *forward)
+{
+	gchar *path = g_shell_quote(session->control_path);
+	gchar *cmd;
+
+	/* Forwards are not needed, the ports are already local */
+	if (g_strcmp0(operation, "check") == 0)
+		cmd = g_strdup_printf("sh -c 'kill -0 $(cat \"$0\")' %s", path);
+	else if (g_strcmp0(operation, "exit") == 0)
+		cmd = g_strdup_printf("sh -c 'kill $(cat \"$0\") && rm -f \"$0\"' %s", path);
+	else
+		cmd = g_strdup("true");
+
+	g_free(path);
+	return cmd;
+}
+
+static struct TransportMethods loopback_methods = {
+	.get_session_command = loopback_get_session_command,
+	.get_command         = loopback_get_command,
+	.get_control_command = loopback_get_control_command,
+};
+/* }}} */
+
+/* Sessions {{{ */
+/*
+ * Runs the @operation control command, "check" or "exit", and waits for it.
+ */
+static gboolean
+run_control(Session *session,
+	    const gchar *operation)
+{
+	gchar *cmd = session->pool->methods->get_control_command(session, operation, NULL);
+	gint status;
+	gboolean ok;
+
+	ok = g_spawn_command_line_sync(cmd, NULL, NULL, &status, NULL)
+		&& WIFEXITED(status) && WEXITSTATUS(status) == 0;
+	g_free(cmd);
+
+	return ok;
+}
+
+static void
+on_check_exited(GPid pid,
+		gint status,
+		gpointer user_data)
+{
+	Check *check = user_data;
+	Session *session = check->session;
+	void (*done) (Session *, gboolean) = check->done;
+
+	g_spawn_close_pid(pid);
+	g_free(check);
+
+	if (!session)
+		return;
+
+	session->check = NULL;
+	done(session, WIFEXITED(status) && WEXITSTATUS(status) == 0);
+}
+
+/*
+ * Runs the "check" control command without blocking the main loop, calling
+ * @done with its result. Does nothing if a check of @session is running.
+ *
+ * Returns: %FALSE if the command could not be run.
+ */
+static gboolean
+run_check_async(Session *session,
+		void (*done) (Session *session, gboolean alive))
+{
+	gchar *cmd;
+	gchar **argv;
+	GPid pid;
+
+	if (session->check)
+		return TRUE;
+
+	cmd = session->pool->methods->get_control_command(session, "check", NULL);
+	if (g_shell_parse_argv(cmd, NULL, &argv, NULL)) {
+		if (g_spawn_async(NULL, argv, NULL,
+				  G_SPAWN_SEARCH_PATH | G_SPAWN_DO_NOT_REAP_CHILD |
+				  G_SPAWN_STDOUT_TO_DEV_NULL | G_SPAWN_STDERR_TO_DEV_NULL,
+				  NULL, NULL, &pid, NULL)) {
+			session->check = g_new(Check, 1);
+			session->check->session = session;
+			session->check->done = done;
+			g_child_watch_add(pid, on_check_exited, session->check);
+		}
+		g_strfreev(argv);
+	}
+	g_free(cmd);
+
+	return session->check != NULL;
+}
+
+static void
+on_control_exited(GPid pid,
+		  gint status,
+		  gpointer user_data)
+{
+	Control *control = user_data;
+	GString *err = g_string_new(NULL);
+	GError *error = NULL;
+	gchar buf[512];
+	ssize_t n;
+
+	g_spawn_close_pid(pid);
+
+	/* What the command wrote is all in the pipe by now */
+	while ((n = read(control->err_fd, buf, sizeof(buf))) > 0 || (n == -1 && errno == EINTR))
+		if (n > 0)
+			g_string_append_len(err, buf, n);
+	close(control->err_fd);
+
+	if (control->pool) {
+		control->pool->controls = g_list_remove(control->pool->controls, control);
+		if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+			g_set_error(&error, GEBR_COMM_TRANSPORT_POOL_ERROR,
+				    GEBR_COMM_TRANSPORT_POOL_ERROR_FORWARD,
+				    "%s", g_strstrip(err->str));
+		if (control->func)
+			control->func(control->pool, control->address, error, control->user_data);
+	}
+
+	g_clear_error(&error);
+	g_string_free(err, TRUE);
+	g_free(control->address);
+	g_free(control);
+}
+
+/*
+ * Runs the @operation control command, "forward" or "cancel", without
+ * blocking the main loop, calling @func, if not %NULL, with its result.
+ */
+static void
+run_control_async(Session *session,
+		  const gchar *operation,
+		  const gchar *forward,
+		  GebrCommTransportReadyFunc func,
+		  gpointer user_data)
+{
+	GebrCommTransportPool *pool = session->pool;
+	gchar *cmd = pool->methods->get_control_command(session, operation, forward);
+	gchar **argv = NULL;
+	Control *control;
+	GError *error = NULL;
+	GPid pid;
+	gint err_fd;
+
+	if (!g_shell_parse_argv(cmd, NULL, &argv, &error)
+	    || !g_spawn_async_with_pipes(NULL, argv, NULL,
+					 G_SPAWN_SEARCH_PATH | G_SPAWN_DO_NOT_REAP_CHILD |
+					 G_SPAWN_STDOUT_TO_DEV_NULL,
+					 NULL, NULL, &pid, NULL, NULL, &err_fd, &error)) {
+		if (func) {
+			GError *forward_error = NULL;
+			g_set_error(&forward_error, GEBR_COMM_TRANSPORT_POOL_ERROR,
+				    GEBR_COMM_TRANSPORT_POOL_ERROR_FORWARD,
+				    "%s", error->message);
+			func(pool, session->address, forward_error, user_data);
+			g_error_free(forward_error);
+		}
+		g_error_free(error);
+		g_strfreev(argv);
+		g_free(cmd);
+		return;
+	}
+
+	fcntl(err_fd, F_SETFL, O_NONBLOCK);
+
+	control = g_new(Control, 1);
+	control->pool = pool;
+	control->address = g_strdup(session->address);
+	control->err_fd = err_fd;
+	control->func = func;
+	control->user_data = user_data;
+	pool->controls = g_list_prepend(pool->controls, control);
+	g_child_watch_add(pid, on_control_exited, control);
+
+	g_strfreev(argv);
+	g_free(cmd);
+}
+
+static gboolean
+unref_in_idle(gpointer object)
+{
+	g_object_unref(object);
+	return FALSE;
+}
+
+/*
+ * Forgets the session process. The process may be emitting a signal, so it
+ * is only released in the next iteration of the main loop.
+ */
+static void
+session_drop(Session *session)
+{
+	if (session->poll_id) {
+		g_source_remove(session->poll_id);
+		session->poll_id = 0;
+	}
+
+	if (session->check) {
+		session->check->session = NULL;
+		session->check = NULL;
+	}
+
+	/* Not run, as the session was being adopted */
+	if (session->opening) {
+		g_signal_handlers_disconnect_matched(session->opening, G_SIGNAL_MATCH_DATA,
+						     0, 0, NULL, NULL, session);
+		g_idle_add(unref_in_idle, session->opening);
+		session->opening = NULL;
+	}
+
+	if (session->master) {
+		g_signal_handlers_disconnect_matched(session->master, G_SIGNAL_MATCH_DATA,
+						     0, 0, NULL, NULL, session);
+		gebr_comm_ssh_kill(session->master);
+		g_idle_add(unref_in_idle, session->master);
+		session->master = NULL;
+
+		/* A killed ssh master leaves its socket behind */
+		g_unlink(session->control_path);
+	}
+
+	session->state = GEBR_COMM_TRANSPORT_STATE_DOWN;
+}
+
+static void
+session_notify(Session *session,
+	       GError *error)
+{
+	GList *waiters = session->waiters;
+
+	session->waiters = NULL;
+
+	for (GList *i = waiters; i; i = i->next) {
+		Waiter *waiter = i->data;
+		waiter->func(session->pool, session->address, error, waiter->user_data);
+		g_free(waiter);
+	}
+	g_list_free(waiters);
+}
+
+static void
+session_fail(Session *session,
+	     const gchar *message)
+{
+	GError *error = NULL;
+
+	g_set_error(&error, GEBR_COMM_TRANSPORT_POOL_ERROR,
+		    GEBR_COMM_TRANSPORT_POOL_ERROR_CONNECT,
+		    "%s", message);
+	session_drop(session);
+	session_notify(session, error);
+	g_error_free(error);
+}
+
+/*
+ * The result of the periodic check of an up session, or of the one made when
+ * it is acquired, which answers the requests waiting for it.
+ */
+static void
+on_health_checked(Session *session,
+		  gboolean alive)
+{
+	gchar *msg;
+
+	if (session->state != GEBR_COMM_TRANSPORT_STATE_UP)
+		return;
+
+	if (alive) {
+		session_notify(session, NULL);
+		return;
+	}
+
+	msg = g_strdup_printf("Connection to %s is not responding", session->address);
+	g_debug("%s", msg);
+	session_fail(session, msg);
+	g_free(msg);
+}
+
+static gboolean
+health_check(gpointer user_data)
+{
+	GebrCommTransportPool *pool = user_data;
+	GHashTableIter iter;
+	Session *session;
+
+	g_hash_table_iter_init(&iter, pool->sessions);
+	while (g_hash_table_iter_next(&iter, NULL, (gpointer *) &session))
+		if (session->state == GEBR_COMM_TRANSPORT_STATE_UP)
+			run_check_async(session, on_health_checked);
+
+	return TRUE;
+}
+
+static void
+session_up(Session *session)
+{
+	GebrCommTransportPool *pool = session->pool;
+
+	session->state = GEBR_COMM_TRANSPORT_STATE_UP;
+	if (!pool->health_check_id)
+		pool->health_check_id = g_timeout_add_seconds(HEALTH_CHECK_INTERVAL, health_check, pool);
+	session_notify(session, NULL);
+}
+
+static void
+on_poll_checked(Session *session,
+		gboolean alive)
+{
+	if (!alive || session->state != GEBR_COMM_TRANSPORT_STATE_CONNECTING)
+		return;
+
+	if (session->poll_id) {
+		g_source_remove(session->poll_id);
+		session->poll_id = 0;
+	}
+	session_up(session);
+}
+
+static gboolean
+session_poll(gpointer user_data)
+{
+	run_check_async(user_data, on_poll_checked);
+	return TRUE;
+}
+
+static void
+on_session_error(GebrCommSsh *ssh,
+		 const gchar *msg,
+		 Session *session)
+{
+	session_fail(session, msg);
+}
+
+static void
+on_session_finished(GebrCommSsh *ssh,
+		    gpointer data,
+		    Session *session)
+{
+	if (session->state == GEBR_COMM_TRANSPORT_STATE_CONNECTING) {
+		gchar *msg = g_strdup_printf("Could not connect to %s", session->address);
+		session_fail(session, msg);
+		g_free(msg);
+	} else {
+		g_debug("Connection to %s was closed", session->address);
+		session_drop(session);
+	}
+}
+
+/*
+ * Runs the master prepared by session_prepare().
+ */
+static void
+session_open(Session *session)
+{
+	g_unlink(session->control_path);
+
+	session->master = session->opening;
+	session->opening = NULL;
+	gebr_comm_ssh_run(session->master);
+	session->poll_id = g_timeout_add(POLL_INTERVAL, session_poll, session);
+}
+
+static void
+on_adopt_checked(Session *session,
+		 gboolean alive)
+{
+	if (session->state != GEBR_COMM_TRANSPORT_STATE_CONNECTING || !session->opening)
+		return;
+
+	if (!alive) {
+		session_open(session);
+		return;
+	}
+
+	/* A session left by other process of this user is used instead */
+	g_signal_handlers_disconnect_matched(session->opening, G_SIGNAL_MATCH_DATA,
+					     0, 0, NULL, NULL, session);
+	g_idle_add(unref_in_idle, session->opening);
+	session->opening = NULL;
+	session_up(session);
+}
+
+/*
+ * Creates the master of @session, which is only run if no other process
+ * left a session to @address up, so its password and questions can be
+ * answered meanwhile.
+ */
+static void
+session_prepare(Session *session)
+{
+	gchar *cmd = session->pool->methods->get_session_command(session);
+
+	session->state = GEBR_COMM_TRANSPORT_STATE_CONNECTING;
+	session->opening = gebr_comm_ssh_new();
+	g_signal_connect(session->opening, "ssh-error", G_CALLBACK(on_session_error), session);
+	g_signal_connect(session->opening, "ssh-finished", G_CALLBACK(on_session_finished), session);
+	gebr_comm_ssh_set_command(session->opening, cmd);
+
+	if (!run_check_async(session, on_adopt_checked))
+		session_open(session);
+
+	g_free(cmd);
+}
+
+static void
+session_free(Session *session)
+{
+	session_drop(session);
+	g_free(session->address);
+	g_free(session->control_path);
+	g_free(session);
+}
+
+static Session *
+get_session(GebrCommTransportPool *pool,
+	    const gchar *address)
+{
+	Session *session = g_hash_table_lookup(pool->sessions, address);
+
+	if (!session) {
+		/* Unix socket paths are short, so the host name is hashed */
+		gchar *name = g_compute_checksum_for_string(G_CHECKSUM_MD5, address, -1);
+
+		session = g_new0(Session, 1);
+		session->pool = pool;
+		session->address = g_strdup(address);
+		session->control_path = g_build_filename(pool->control_dir, name, NULL);
+		session->state = GEBR_COMM_TRANSPORT_STATE_DOWN;
+		g_hash_table_insert(pool->sessions, session->address, session);
+		g_free(name);
+	}
+
+	return session;
+}
+/* }}} */
+
+/* Public API {{{ */
+GebrCommTransportPool *
+gebr_comm_transport_pool_new(GebrCommTransportType type,
+			     const gchar *control_dir)
+{
+	GebrCommTransportPool *pool = g_new0(GebrCommTransportPool, 1);
+
+	pool->methods = type == GEBR_COMM_TRANSPORT_SSH ? &ssh_methods : &loopback_methods;
+	pool->control_dir = g_strdup(control_dir);
+	pool->sessions = g_hash_table_new_full(g_str_hash, g_str_equal, NULL,
+					       (GDestroyNotify) session_free);
+	g_mkdir_with_parents(control_dir, 0700);
+
+	return pool;
+}
+
+/*
+ * The control sockets give access to the sessions, so their directory must
+ * belong to the user and be private.
+ */
+static gchar *
+get_default_control_dir(void)
+{
+	gchar *dir = g_strdup_printf("%s/gebr-ssh-%s", g_get_tmp_dir(), g_get_user_name());
+	struct stat st;
+
+	g_mkdir(dir, 0700);
+	if (g_lstat(dir, &st) == 0 && S_ISDIR(st.st_mode)
+	    && st.st_uid == getuid() && (st.st_mode & 077) == 0)
+		return dir;
+
+	g_free(dir);
+	dir = g_build_filename(g_get_tmp_dir(), "gebr-ssh-XXXXXX", NULL);
+	if (!mkdtemp(dir))
+		g_warning("Could not create a directory for the ssh sessions");
+
+	return dir;
+}
+
+static GebrCommTransportPool *default_pool = NULL;
+
+GebrCommTransportPool *
+gebr_comm_transport_pool_get_default(void)
+{
+	if (!default_pool) {
+		gchar *dir = get_default_control_dir();
+		default_pool = gebr_comm_transport_pool_new(GEBR_COMM_TRANSPORT_SSH, dir);
+		g_free(dir);
+	}
+
+	return default_pool;
+}
+
+void
+gebr_comm_transport_pool_free_default(void)
+{
+	if (!default_pool)
+		return;
+
+	gebr_comm_transport_pool_free(default_pool);
+	default_pool = NULL;
+}
+
+void
+gebr_comm_transport_pool_free(GebrCommTransportPool *pool)
+{
+	GHashTableIter iter;
+	Session *session;
+
+	/* Sessions adopted from other processes are still used by them */
+	g_hash_table_iter_init(&iter, pool->sessions);
+	while (g_hash_table_iter_next(&iter, NULL, (gpointer *) &session))
+		if (session->master)
+			gebr_comm_transport_pool_close(pool, session->address);
+
+	if (pool->health_check_id)
+		g_source_remove(pool->health_check_id);
+
+	for (GList *i = pool->controls; i; i = i->next)
+		((Control *) i->data)->pool = NULL;
+	g_list_free(pool->controls);
+
+	g_hash_table_destroy(pool->sessions);
+	g_rmdir(pool->control_dir);
+	g_free(pool->control_dir);
+	g_free(pool);
+}
+
+GebrCommSsh *
+gebr_comm_transport_pool_acquire(GebrCommTransportPool *pool,
+				 const gchar *address,
+				 GebrCommTransportReadyFunc func,
+				 gpointer user_data)
+{
+	Session *session = get_session(pool, address);
+	Waiter *waiter;
+
+	waiter = g_new(Waiter, 1);
+	waiter->func = func;
+	waiter->user_data = user_data;
+	session->waiters = g_list_append(session->waiters, waiter);
+
+	if (session->state == GEBR_COMM_TRANSPORT_STATE_CONNECTING)
+		return NULL;
+
+	/* An up session is checked first, see on_health_checked() */
+	if (session->state == GEBR_COMM_TRANSPORT_STATE_UP) {
+		if (!run_check_async(session, on_health_checked))
+			session_notify(session, NULL);
+		return NULL;
+	}
+
+	session_prepare(session);
+	return session->opening ? session->opening : session->master;
+}
+
+gchar *
+gebr_comm_transport_pool_get_command(GebrCommTransportPool *pool,
+				     const gchar *address,
+				     const gchar *flags,
+				     const gchar *remote_command)
+{
+	Session *session = get_session(pool, address);
+	return pool->methods->get_command(session, flags, remote_command);
+}
+
+void
+gebr_comm_transport_pool_forward(GebrCommTransportPool *pool,
+				 const gchar *address,
+				 const gchar *forward,
+				 GebrCommTransportReadyFunc func,
+				 gpointer user_data)
+{
+	Session *session = get_session(pool, address);
+	run_control_async(session, "forward", forward, func, user_data);
+}
+
+void
+gebr_comm_transport_pool_cancel_forward(GebrCommTransportPool *pool,
+					const gchar *address,
+					const gchar *forward)
+{
+	Session *session = get_session(pool, address);
+
+	if (session->state == GEBR_COMM_TRANSPORT_STATE_UP)
+		run_control_async(session, "cancel", forward, NULL, NULL);
+}
+
+gboolean
+gebr_comm_transport_pool_check(GebrCommTransportPool *pool,
+			       const gchar *address)
+{
+	Session *session = g_hash_table_lookup(pool->sessions, address);
+
+	if (!session || session->state != GEBR_COMM_TRANSPORT_STATE_UP)
+		return FALSE;
+
+	if (run_control(session, "check"))
+		return TRUE;
+
+	g_debug("Connection to %s is not responding", address);
+	session_drop(session);
+	return FALSE;
+}
+
+GebrCommTransportState
+gebr_comm_transport_pool_get_state(GebrCommTransportPool *pool,
+				   const gchar *address)
+{
+	Session *session = g_hash_table_lookup(pool->sessions, address);
+	return session ? session->state : GEBR_COMM_TRANSPORT_STATE_DOWN;
+}
+
+void
+gebr_comm_transport_pool_close(GebrCommTransportPool *pool,
+			       const gchar *address)
+{
+	Session *session = g_hash_table_lookup(pool->sessions, address);
+
+	if (!session || session->state == GEBR_COMM_TRANSPORT_STATE_DOWN)
+		return;
+
+	/* A session still being adopted may not be ours to close */
+	if (session->master || session->state == GEBR_COMM_TRANSPORT_STATE_UP)
+		run_control(session, "exit");
+	session_fail(session, "The connection was closed");
+}
+/* }}} */
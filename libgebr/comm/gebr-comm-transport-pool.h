@@ -0,0 +1,194 @@
+/*
+ * gebr-comm-transport-pool.h
+ * This file is part of GêBR Project
+ *
+ * Copyright (C) 2012 - GêBR Core Team (www.gebrproject.com)
+ *
+ * GêBR Project is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * GêBR Project is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GêBR Project. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GEBR_COMM_TRANSPORT_POOL_H__
+#define __GEBR_COMM_TRANSPORT_POOL_H__
+
+#include <glib.h>
+#include "gebr-comm-ssh.h"
+
+G_BEGIN_DECLS
+
+/**
+ * GebrCommTransportType:
+ * @GEBR_COMM_TRANSPORT_SSH: sessions are ssh masters and channels are
+ * multiplexed through their control sockets
+ * @GEBR_COMM_TRANSPORT_LOOPBACK: sessions are local processes and commands
+ * run in the local machine, for testing without ssh
+ */
+typedef enum {
+	GEBR_COMM_TRANSPORT_SSH,
+	GEBR_COMM_TRANSPORT_LOOPBACK,
+} GebrCommTransportType;
+
+typedef enum {
+	GEBR_COMM_TRANSPORT_STATE_DOWN,
+	GEBR_COMM_TRANSPORT_STATE_CONNECTING,
+	GEBR_COMM_TRANSPORT_STATE_UP,
+} GebrCommTransportState;
+
+typedef enum {
+	GEBR_COMM_TRANSPORT_POOL_ERROR_CONNECT,
+	GEBR_COMM_TRANSPORT_POOL_ERROR_FORWARD,
+} GebrCommTransportPoolError;
+
+#define GEBR_COMM_TRANSPORT_POOL_ERROR (gebr_comm_transport_pool_error_quark())
+GQuark gebr_comm_transport_pool_error_quark(void);
+
+/**
+ * GebrCommTransportPool:
+ *
+ * Keeps one authenticated session for each host. The daemon or maestro
+ * launch and the X11 and sftp forwards of a host are all carried by its
+ * session, so only the first of them pays for the key exchange and for the
+ * password. Sessions are kept alive and checked periodically, in the
+ * background; a session found dead is dropped and the next request to its
+ * host opens a new one.
+ */
+typedef struct _GebrCommTransportPool GebrCommTransportPool;
+
+/**
+ * GebrCommTransportReadyFunc:
+ * @pool: the pool
+ * @address: the host of the session
+ * @error: %NULL if the session is up, or the reason it could not be opened
+ * @user_data: the data given to gebr_comm_transport_pool_acquire() or
+ * gebr_comm_transport_pool_forward()
+ */
+typedef void (*GebrCommTransportReadyFunc) (GebrCommTransportPool *pool,
+					    const gchar *address,
+					    GError *error,
+					    gpointer user_data);
+
+/**
+ * gebr_comm_transport_pool_new:
+ * @type: how the sessions are made
+ * @control_dir: the directory of the control sockets of the sessions
+ */
+GebrCommTransportPool *gebr_comm_transport_pool_new(GebrCommTransportType type,
+						    const gchar *control_dir);
+
+/**
+ * gebr_comm_transport_pool_get_default:
+ *
+ * Returns: the ssh pool shared by the port providers of this process.
+ */
+GebrCommTransportPool *gebr_comm_transport_pool_get_default(void);
+
+/**
+ * gebr_comm_transport_pool_free_default:
+ *
+ * Frees the default pool, if it was created, closing the sessions it opened.
+ * Must be called when the process exits, since the ssh masters are not
+ * meant to outlive it.
+ */
+void gebr_comm_transport_pool_free_default(void);
+
+/**
+ * gebr_comm_transport_pool_free:
+ *
+ * Closes the sessions opened by @pool and frees it. Sessions it adopted from
+ * other processes are left up for them.
+ */
+void gebr_comm_transport_pool_free(GebrCommTransportPool *pool);
+
+/**
+ * gebr_comm_transport_pool_acquire:
+ * @pool: the pool
+ * @address: the host
+ * @func: called when the session of @address is up or failed
+ * @user_data: data passed to @func
+ *
+ * Calls @func once the session of @address is up. An up session, or one
+ * left up by other process, is checked in the background first; an up
+ * session found dead fails the request, and the next one opens a new
+ * session. Requests made while the session is being opened wait for it.
+ *
+ * Returns: the #GebrCommSsh of the session if this call started opening it,
+ * so the caller can answer its password and questions, or %NULL.
+ */
+GebrCommSsh *gebr_comm_transport_pool_acquire(GebrCommTransportPool *pool,
+					      const gchar *address,
+					      GebrCommTransportReadyFunc func,
+					      gpointer user_data);
+
+/**
+ * gebr_comm_transport_pool_get_command:
+ * @flags: ssh options of the channel, like "-x"
+ * @remote_command: the command to run in @address, quoted for the shell
+ *
+ * Returns: a command line that runs @remote_command through the session
+ * of @address, which must be up.
+ */
+gchar *gebr_comm_transport_pool_get_command(GebrCommTransportPool *pool,
+					    const gchar *address,
+					    const gchar *flags,
+					    const gchar *remote_command);
+
+/**
+ * gebr_comm_transport_pool_forward:
+ * @forward: a ssh forward specification, like "-L 2000:localhost:22"
+ * @func: called when the forward is ready, or with the reason it failed
+ * @user_data: data passed to @func
+ *
+ * Adds @forward to the session of @address, which must be up, in the
+ * background. @func is not called if @pool is freed first.
+ */
+void gebr_comm_transport_pool_forward(GebrCommTransportPool *pool,
+				      const gchar *address,
+				      const gchar *forward,
+				      GebrCommTransportReadyFunc func,
+				      gpointer user_data);
+
+/**
+ * gebr_comm_transport_pool_cancel_forward:
+ *
+ * Removes @forward, added by gebr_comm_transport_pool_forward(), from the
+ * session of @address, in the background.
+ */
+void gebr_comm_transport_pool_cancel_forward(GebrCommTransportPool *pool,
+					     const gchar *address,
+					     const gchar *forward);
+
+/**
+ * gebr_comm_transport_pool_check:
+ *
+ * Checks if the session of @address is alive, dropping it if it is not.
+ * Waits for the check, which the pool itself only makes in the background.
+ *
+ * Returns: %TRUE if the session is up.
+ */
+gboolean gebr_comm_transport_pool_check(GebrCommTransportPool *pool,
+					const gchar *address);
+
+GebrCommTransportState gebr_comm_transport_pool_get_state(GebrCommTransportPool *pool,
+							  const gchar *address);
+
+/**
+ * gebr_comm_transport_pool_close:
+ *
+ * Closes the session of @address and all channels and forwards on it.
+ */
+void gebr_comm_transport_pool_close(GebrCommTransportPool *pool,
+				    const gchar *address);
+
+G_END_DECLS
+
+#endif /* __GEBR_COMM_TRANSPORT_POOL_H__ */
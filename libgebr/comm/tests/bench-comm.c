@@ -0,0 +1,473 @@
+/*   libgebr - GeBR Library
+ *   Copyright (C) 2007-2012 GeBR core team (http://www.gebrproject.com/)
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <glib.h>
+#include <glib-object.h>
+#include <glib/gstdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <gebr-bench.h>
+#include <libgebr/geoxml/geoxml.h>
+
+#include <gebr-comm-daemon.h>
+#include <gebr-comm-http-msg.h>
+#include <gebr-comm-listensocket.h>
+#include <gebr-comm-protocol.h>
+#include <gebr-comm-protocol_p.h>
+#include <gebr-comm-protocol-socket.h>
+#include <gebr-comm-runner.h>
+#include <gebr-comm-runner_p.h>
+
+#define OUT_STREAM_SIZE (1 << 20)
+#define RECEIVE_CHUNK 4096
+#define HTTP_CONTENT_SIZE (64 << 10)
+#define N_DAEMONS 64
+#define DAEMON_CORES 8
+#define N_BURST_DAEMONS 8
+#define N_BURST_JOBS 100
+
+/* {{{1 Protocol */
+
+typedef struct {
+	GString *stream;
+	gchar *output;
+} ProtocolData;
+
+static void
+bench_protocol_build(gpointer data)
+{
+	ProtocolData *d = data;
+	GString *msg = gebr_comm_protocol_build_message(gebr_comm_protocol_defs.out_def, 4,
+							"job-id", d->output, "rid", "1");
+	g_string_free(msg, TRUE);
+}
+
+static void
+bench_protocol_receive(gpointer data)
+{
+	ProtocolData *d = data;
+	struct gebr_comm_protocol *protocol = gebr_comm_protocol_new();
+	struct gebr_comm_message *message;
+
+	/* Fed as the socket reads it */
+	for (gsize i = 0; i < d->stream->len; i += RECEIVE_CHUNK) {
+		gebr_comm_protocol_feed(protocol, d->stream->str + i,
+					MIN(RECEIVE_CHUNK, d->stream->len - i));
+		while (gebr_comm_protocol_receive_data(protocol) == 1)
+			while ((message = g_queue_pop_head(protocol->messages)) != NULL)
+				gebr_comm_message_free(message);
+	}
+
+	gebr_comm_protocol_free(protocol);
+}
+
+static ProtocolData *
+protocol_data_new(void)
+{
+	ProtocolData *d = g_new(ProtocolData, 1);
+
+	d->output = g_strdup("line 42 of the output of a program of the flow\n");
+	d->stream = g_string_new(NULL);
+
+	for (gint i = 0; d->stream->len < OUT_STREAM_SIZE; i++) {
+		gchar *output = g_strdup_printf("line %d of the output of a program of the flow\n", i);
+		GString *msg = gebr_comm_protocol_build_message(gebr_comm_protocol_defs.out_def, 4,
+								"job-id", output, "rid", "1");
+		g_string_append_len(d->stream, msg->str, msg->len);
+		g_string_free(msg, TRUE);
+		g_free(output);
+	}
+
+	return d;
+}
+
+/* {{{1 HTTP */
+
+typedef struct {
+	GString *response;
+	GString *request;
+} HttpData;
+
+static void
+parse_http(const GString *raw, gsize chunk)
+{
+	GebrCommHttpMsg *msg = NULL;
+	GString *data = g_string_new(NULL);
+
+	for (gsize i = 0; i < raw->len && (!msg || !msg->parsed); i += chunk) {
+		g_string_append_len(data, raw->str + i, MIN(chunk, raw->len - i));
+		msg = gebr_comm_http_msg_new_parsing(msg, data);
+	}
+
+	g_assert(msg && msg->parsed);
+	gebr_comm_http_msg_free(msg);
+	g_string_free(data, TRUE);
+}
+
+static void
+bench_http_parse_response(gpointer data)
+{
+	HttpData *d = data;
+	parse_http(d->response, RECEIVE_CHUNK);
+}
+
+static void
+bench_http_parse_request(gpointer data)
+{
+	HttpData *d = data;
+	parse_http(d->request, d->request->len);
+}
+
+static HttpData *
+http_data_new(void)
+{
+	HttpData *d = g_new(HttpData, 1);
+	GString *content = g_string_new("[");
+
+	for (gint i = 0; content->len < HTTP_CONTENT_SIZE; i++)
+		g_string_append_printf(content, "%s{\"id\": \"%d\", \"status\": \"running\"}",
+				       i ? ", " : "", i);
+	g_string_append(content, "]");
+
+	d->response = g_string_new(NULL);
+	g_string_printf(d->response, "HTTP/1.1 200 OK\ncontent-length:%" G_GSIZE_FORMAT "\n\n%s",
+			content->len, content->str);
+	d->request = g_string_new("GET /server-list?\ncontent-type:text/plain\n\n");
+
+	g_string_free(content, TRUE);
+	return d;
+}
+
+/* {{{1 Runner scores */
+
+/*
+ * A daemon with fixed load and cores, as seen by the maestro once the load
+ * of every server arrived.
+ */
+typedef struct {
+	GObject parent;
+	GebrCommServer *server;
+	gchar *hostname;
+	gchar *load;
+	gint running_jobs;
+	gdouble reserved;
+
+	/* If the load is pushed to the maestro, or asked with GET /sys-load */
+	gboolean pushed;
+} BenchDaemon;
+
+typedef struct {
+	GObjectClass parent;
+} BenchDaemonClass;
+
+static void bench_daemon_iface_init(GebrCommDaemonIface *iface);
+
+G_DEFINE_TYPE_WITH_CODE(BenchDaemon, bench_daemon, G_TYPE_OBJECT,
+			G_IMPLEMENT_INTERFACE(GEBR_COMM_TYPE_DAEMON,
+					      bench_daemon_iface_init));
+
+static void
+bench_daemon_class_init(BenchDaemonClass *klass)
+{
+}
+
+static void
+bench_daemon_init(BenchDaemon *daemon)
+{
+}
+
+static GebrCommServer *
+bench_daemon_get_server(GebrCommDaemon *daemon)
+{
+	return ((BenchDaemon *) daemon)->server;
+}
+
+static gint
+bench_daemon_get_n_running_jobs(GebrCommDaemon *daemon)
+{
+	return ((BenchDaemon *) daemon)->running_jobs;
+}
+
+static const gchar *
+bench_daemon_get_hostname(GebrCommDaemon *daemon)
+{
+	return ((BenchDaemon *) daemon)->hostname;
+}
+
+static void
+bench_daemon_add_task(GebrCommDaemon *daemon)
+{
+}
+
+static gboolean
+bench_daemon_can_execute(GebrCommDaemon *daemon)
+{
+	return TRUE;
+}
+
+static const gchar *
+bench_daemon_get_flavors(GebrCommDaemon *daemon)
+{
+	return "";
+}
+
+static const gchar *
+bench_daemon_get_load(GebrCommDaemon *daemon)
+{
+	BenchDaemon *d = (BenchDaemon *) daemon;
+	return d->pushed ? d->load : NULL;
+}
+
+static void
+bench_daemon_reserve_cores(GebrCommDaemon *daemon, gint ncores)
+{
+	((BenchDaemon *) daemon)->reserved += ncores;
+}
+
+static gdouble
+bench_daemon_get_reserved_cores(GebrCommDaemon *daemon)
+{
+	return ((BenchDaemon *) daemon)->reserved;
+}
+
+static void
+bench_daemon_iface_init(GebrCommDaemonIface *iface)
+{
+	iface->get_server = bench_daemon_get_server;
+	iface->get_n_running_jobs = bench_daemon_get_n_running_jobs;
+	iface->get_hostname = bench_daemon_get_hostname;
+	iface->add_task = bench_daemon_add_task;
+	iface->can_execute = bench_daemon_can_execute;
+	iface->get_flavors = bench_daemon_get_flavors;
+	iface->get_load = bench_daemon_get_load;
+	iface->reserve_cores = bench_daemon_reserve_cores;
+	iface->get_reserved_cores = bench_daemon_get_reserved_cores;
+}
+
+static void
+bench_runner_score(gpointer data)
+{
+	GList *scores = gebr_comm_runner_score_daemons(NULL, data);
+
+	g_list_foreach(scores, (GFunc) g_free, NULL);
+	g_list_free(scores);
+}
+
+static GList *
+daemons_new(gint n)
+{
+	GList *daemons = NULL;
+
+	for (gint i = 0; i < n; i++) {
+		BenchDaemon *daemon = g_object_new(bench_daemon_get_type(), NULL);
+
+		/* Only the hardware fields of the server are read by the scoring */
+		daemon->server = g_new0(GebrCommServer, 1);
+		daemon->server->ncores = DAEMON_CORES;
+		daemon->server->clock_cpu = 2000 + 100 * (i % 8);
+		daemon->hostname = g_strdup_printf("node%d", i);
+		daemon->load = g_strdup_printf("%.2lf %.2lf %.2lf", (i % 9) * 0.9,
+					       (i % 7) * 1.1, (i % 5) * 1.3);
+		daemon->running_jobs = i % 3;
+		daemon->pushed = TRUE;
+		daemons = g_list_prepend(daemons, daemon);
+	}
+
+	return daemons;
+}
+
+/* {{{1 Runner dispatch */
+
+/*
+ * The maestro side of a burst of jobs submitted at once, dispatched to fake
+ * daemons listening on a unix socket. The daemons answer GET /sys-load with
+ * their load and discard the tasks they receive.
+ */
+typedef struct {
+	GList *daemons;
+	GebrCommListenSocket *listener;
+	GList *connections;
+	gchar *path;
+
+	GebrGeoXmlDocument *flow;
+	GebrGeoXmlDocument *line;
+	GebrGeoXmlDocument *proj;
+	GebrValidator *validator;
+
+	gint dispatched;
+} BurstData;
+
+static void
+on_daemon_request(GebrCommProtocolSocket *socket,
+		  GebrCommHttpMsg *request,
+		  BurstData *d)
+{
+	/* All fake daemons have the same load */
+	BenchDaemon *daemon = d->daemons->data;
+	GebrCommJsonContent *json = gebr_comm_json_content_new_from_string(daemon->load);
+
+	gebr_comm_protocol_socket_send_response(socket, 200, json);
+	gebr_comm_json_content_free(json);
+}
+
+static void
+on_daemon_messages(GebrCommProtocolSocket *socket,
+		   BurstData *d)
+{
+	struct gebr_comm_message *message;
+
+	while ((message = g_queue_pop_head(socket->protocol->messages)) != NULL)
+		gebr_comm_message_free(message);
+}
+
+static void
+on_new_connection(GebrCommListenSocket *listener,
+		  BurstData *d)
+{
+	while (gebr_comm_listen_socket_get_has_pending_connections(listener)) {
+		GebrCommStreamSocket *stream = gebr_comm_listen_socket_get_next_pending_connection(listener);
+		GebrCommProtocolSocket *socket = gebr_comm_protocol_socket_new_from_socket(stream);
+
+		g_signal_connect(socket, "process-request", G_CALLBACK(on_daemon_request), d);
+		g_signal_connect(socket, "old-parse-messages", G_CALLBACK(on_daemon_messages), d);
+		d->connections = g_list_prepend(d->connections, socket);
+	}
+}
+
+static void
+on_runner_ran(GebrCommRunner *runner,
+	      BurstData *d)
+{
+	d->dispatched++;
+}
+
+static void
+bench_runner_dispatch(BurstData *d, gboolean pushed)
+{
+	GebrCommRunner *runners[N_BURST_JOBS];
+
+	for (GList *i = d->daemons; i; i = i->next) {
+		BenchDaemon *daemon = i->data;
+		daemon->pushed = pushed;
+		daemon->reserved = 0;
+	}
+
+	d->dispatched = 0;
+	for (gint i = 0; i < N_BURST_JOBS; i++) {
+		gchar *id = g_strdup_printf("job-%d", i);
+
+		runners[i] = gebr_comm_runner_new(d->flow, d->daemons, d->daemons, id, "group", "",
+						  "5.0", "0", "", "", d->validator);
+		gebr_comm_runner_set_ran_func(runners[i], (void (*)(GebrCommRunner *, gpointer)) on_runner_ran, d);
+		if (!gebr_comm_runner_run_async(runners[i]))
+			g_error("Job %d could not be submitted", i);
+		g_free(id);
+	}
+
+	while (d->dispatched < N_BURST_JOBS)
+		g_main_context_iteration(NULL, TRUE);
+
+	for (gint i = 0; i < N_BURST_JOBS; i++)
+		gebr_comm_runner_free(runners[i]);
+}
+
+static void
+bench_runner_dispatch_pushed(gpointer data)
+{
+	bench_runner_dispatch(data, TRUE);
+}
+
+static void
+bench_runner_dispatch_polled(gpointer data)
+{
+	bench_runner_dispatch(data, FALSE);
+}
+
+static BurstData *
+burst_data_new(void)
+{
+	BurstData *d = g_new0(BurstData, 1);
+	gchar *name = g_strdup_printf("gebr-bench-comm-%d", (gint) getpid());
+	GebrCommSocketAddress address;
+
+	d->path = g_build_filename(g_get_tmp_dir(), name, NULL);
+	address = gebr_comm_socket_address_unix(d->path);
+	d->listener = gebr_comm_listen_socket_new();
+	g_unlink(d->path);
+	if (!gebr_comm_listen_socket_listen(d->listener, &address))
+		g_error("Could not listen on %s", d->path);
+	g_signal_connect(d->listener, "new-connection", G_CALLBACK(on_new_connection), d);
+
+	d->daemons = daemons_new(N_BURST_DAEMONS);
+	for (GList *i = d->daemons; i; i = i->next) {
+		BenchDaemon *daemon = i->data;
+
+		daemon->server->socket = gebr_comm_protocol_socket_new();
+		if (!gebr_comm_protocol_socket_connect(daemon->server->socket, &address, TRUE))
+			g_error("Could not connect to %s", d->path);
+	}
+	while (g_list_length(d->connections) < N_BURST_DAEMONS)
+		g_main_context_iteration(NULL, TRUE);
+
+	d->flow = GEBR_GEOXML_DOCUMENT(gebr_geoxml_flow_new());
+	d->line = GEBR_GEOXML_DOCUMENT(gebr_geoxml_line_new());
+	d->proj = GEBR_GEOXML_DOCUMENT(gebr_geoxml_project_new());
+	d->validator = gebr_validator_new(&d->flow, &d->line, &d->proj);
+
+	g_free(name);
+	return d;
+}
+
+static void
+burst_data_free(BurstData *d)
+{
+	g_unlink(d->path);
+	g_free(d->path);
+}
+
+/* {{{1 Main */
+
+int
+main(int argc, char *argv[])
+{
+	gint ret;
+
+	gebr_bench_init(&argc, &argv, "comm");
+	gebr_comm_protocol_init();
+	gebr_geoxml_init();
+
+	ProtocolData *protocol = protocol_data_new();
+	HttpData *http = http_data_new();
+	GList *daemons = daemons_new(N_DAEMONS);
+	BurstData *burst = burst_data_new();
+
+	gebr_bench_add("protocol/build-message", bench_protocol_build, protocol, 0);
+	gebr_bench_add("protocol/receive-out-stream", bench_protocol_receive, protocol, protocol->stream->len);
+	gebr_bench_add("http/parse-response", bench_http_parse_response, http, http->response->len);
+	gebr_bench_add("http/parse-request", bench_http_parse_request, http, 0);
+	gebr_bench_add("runner/score-daemons", bench_runner_score, daemons, 0);
+
+	/* Submission to dispatch of a burst of jobs, with the load of the
+	 * daemons pushed to the maestro or asked to each of them */
+	gebr_bench_add("runner/dispatch-burst-100-pushed", bench_runner_dispatch_pushed, burst, 0);
+	gebr_bench_add("runner/dispatch-burst-100-polled", bench_runner_dispatch_polled, burst, 0);
+
+	ret = gebr_bench_run();
+	burst_data_free(burst);
+
+	return ret;
+}
@@ -16,6 +16,7 @@
  */
 
 #include <glib.h>
+#include <string.h>
 
 #include <gebr-comm-protocol.h>
 #include <gebr-comm-protocol_p.h>
@@ -32,11 +33,327 @@ void test_comm_build_message()
 	g_assert_cmpstr(message->str, ==, "FOO 14 6|teste1 3|123\n");
 }
 
+/*
+ * Feeds @data to @protocol in chunks of @chunk bytes, parsing as it goes like
+ * the protocol socket does. Returns the number of messages received.
+ */
+static gint
+feed_and_parse(struct gebr_comm_protocol *protocol, const gchar *data, gsize len, gsize chunk)
+{
+	gint n = 0;
+
+	for (gsize i = 0; i < len; i += chunk) {
+		gebr_comm_protocol_feed(protocol, data + i, MIN(chunk, len - i));
+		while (gebr_comm_protocol_receive_data(protocol) == 1)
+			n++;
+	}
+
+	return n;
+}
+
+static GString *
+build_out_stream(gsize min_len, gint *n_messages)
+{
+	GString *stream = g_string_new(NULL);
+
+	*n_messages = 0;
+	while (stream->len < min_len) {
+		gchar *output = g_strdup_printf("line %d of the program output\n", *n_messages);
+		GString *msg = gebr_comm_protocol_build_message(gebr_comm_protocol_defs.out_def, 4,
+								"job-id", output, "rid", "1");
+		g_string_append_len(stream, msg->str, msg->len);
+		g_string_free(msg, TRUE);
+		g_free(output);
+		(*n_messages)++;
+	}
+
+	return stream;
+}
+
+void test_comm_receive_data(void)
+{
+	struct gebr_comm_protocol *protocol = gebr_comm_protocol_new();
+	struct gebr_comm_message *message;
+	GString *a = gebr_comm_protocol_build_message(gebr_comm_protocol_defs.out_def, 4, "1", "out\nput", "rid", "2");
+	GString *b = gebr_comm_protocol_build_message(gebr_comm_protocol_defs.qut_def, 0);
+	GString *stream = g_string_new(a->str);
+	g_string_append(stream, b->str);
+
+	/* split at every possible position, even inside the header */
+	for (gsize chunk = 1; chunk <= stream->len; chunk++) {
+		g_assert_cmpint(feed_and_parse(protocol, stream->str, stream->len, chunk), ==, 2);
+		g_assert_cmpuint(gebr_comm_protocol_pending(protocol), ==, 0);
+		g_assert(!gebr_comm_protocol_receiving(protocol));
+
+		message = g_queue_pop_head(protocol->messages);
+		g_assert_cmpuint(message->hash, ==, gebr_comm_protocol_defs.out_def.code_hash);
+		g_assert_cmpstr(message->argument->str, ==, "1|1 7|out\nput 3|rid 1|2");
+		gebr_comm_message_free(message);
+
+		message = g_queue_pop_head(protocol->messages);
+		g_assert_cmpuint(message->hash, ==, gebr_comm_protocol_defs.qut_def.code_hash);
+		g_assert_cmpuint(message->argument->len, ==, 0);
+		gebr_comm_message_free(message);
+	}
+
+	/* unknown code */
+	gebr_comm_protocol_feed(protocol, "FOO 3 bar\n", 10);
+	g_assert_cmpint(gebr_comm_protocol_receive_data(protocol), ==, -1);
+	g_assert_cmpuint(gebr_comm_protocol_pending(protocol), ==, 0);
+
+	/* bad size */
+	gebr_comm_protocol_feed(protocol, "OUT 1x ", 7);
+	g_assert_cmpint(gebr_comm_protocol_receive_data(protocol), ==, -1);
+
+	/* parser recovers after an error */
+	g_assert_cmpint(feed_and_parse(protocol, a->str, a->len, a->len), ==, 1);
+
+	g_string_free(a, TRUE);
+	g_string_free(b, TRUE);
+	g_string_free(stream, TRUE);
+	gebr_comm_protocol_free(protocol);
+}
+
+void test_comm_split(void)
+{
+	GString *arguments = g_string_new("3|foo 0| 5|a b c");
+	struct gebr_comm_slice slices[3];
+
+	GList *split = gebr_comm_protocol_split_new(arguments, 3);
+	g_assert_cmpstr(((GString *)g_list_nth_data(split, 0))->str, ==, "foo");
+	g_assert_cmpstr(((GString *)g_list_nth_data(split, 1))->str, ==, "");
+	g_assert_cmpstr(((GString *)g_list_nth_data(split, 2))->str, ==, "a b c");
+	gebr_comm_protocol_split_free(split);
+
+	g_assert(gebr_comm_protocol_split_new(arguments, 4) == NULL);
+
+	g_assert(gebr_comm_protocol_split_slices(arguments, 3, slices));
+	g_assert_cmpstr(slices[0].str, ==, "foo");
+	g_assert_cmpuint(slices[1].len, ==, 0);
+	g_assert_cmpstr(slices[1].str, ==, "");
+	g_assert_cmpstr(slices[2].str, ==, "a b c");
+
+	g_string_assign(arguments, "9|foo");
+	g_assert(!gebr_comm_protocol_split_slices(arguments, 1, slices));
+
+	g_string_free(arguments, TRUE);
+}
+
+void test_comm_frame(void)
+{
+	struct gebr_comm_protocol *protocol = gebr_comm_protocol_new();
+	struct gebr_comm_message *message;
+	struct gebr_comm_slice slices[4];
+	GString *big = g_string_new(NULL);
+
+	while (big->len < 64 * 1024)
+		g_string_append(big, "a very repetitive line of output\n");
+
+	GString *a = gebr_comm_protocol_build_frame(gebr_comm_protocol_defs.out_def, TRUE, 4, "1", big->str, NULL, "2");
+	GString *b = gebr_comm_protocol_build_message(gebr_comm_protocol_defs.qut_def, 0);
+	GString *c = gebr_comm_protocol_build_frame(gebr_comm_protocol_defs.cfrm_def, FALSE, 1, "yes");
+	GString *stream = g_string_new(NULL);
+
+	/* compressed, since it is larger */
+	g_assert_cmpuint(a->len, <, big->len / 10);
+
+	/* frames and text messages can be mixed */
+	g_string_append_len(stream, a->str, a->len);
+	g_string_append_len(stream, b->str, b->len);
+	g_string_append_len(stream, c->str, c->len);
+
+	for (gsize chunk = 1; chunk <= stream->len; chunk = chunk * 2 + 1) {
+		g_assert_cmpint(feed_and_parse(protocol, stream->str, stream->len, chunk), ==, 3);
+
+		message = g_queue_pop_head(protocol->messages);
+		g_assert_cmpuint(message->hash, ==, gebr_comm_protocol_defs.out_def.code_hash);
+		GList *split = gebr_comm_protocol_split_new(message->argument, 4);
+		g_assert_cmpstr(((GString *)g_list_nth_data(split, 1))->str, ==, big->str);
+		g_assert_cmpstr(((GString *)g_list_nth_data(split, 2))->str, ==, "");
+		gebr_comm_protocol_split_free(split);
+		g_assert(gebr_comm_protocol_split_slices(message->argument, 4, slices));
+		g_assert_cmpstr(slices[0].str, ==, "1");
+		g_assert_cmpuint(slices[1].len, ==, big->len);
+		g_assert_cmpstr(slices[3].str, ==, "2");
+		g_assert(!gebr_comm_protocol_split_slices(message->argument, 5, slices));
+		gebr_comm_message_free(message);
+
+		message = g_queue_pop_head(protocol->messages);
+		g_assert_cmpuint(message->hash, ==, gebr_comm_protocol_defs.qut_def.code_hash);
+		gebr_comm_message_free(message);
+
+		message = g_queue_pop_head(protocol->messages);
+		g_assert_cmpuint(message->hash, ==, gebr_comm_protocol_defs.cfrm_def.code_hash);
+		g_assert(gebr_comm_protocol_split_slices(message->argument, 1, slices));
+		g_assert_cmpstr(slices[0].str, ==, "yes");
+		gebr_comm_message_free(message);
+	}
+
+	/* corrupted compressed payload */
+	a->str[a->len / 2] ^= 0x55;
+	a->str[a->len / 2 + 1] ^= 0x55;
+	gebr_comm_protocol_feed(protocol, a->str, a->len);
+	g_assert_cmpint(gebr_comm_protocol_receive_data(protocol), ==, -1);
+
+	g_string_free(a, TRUE);
+	g_string_free(b, TRUE);
+	g_string_free(c, TRUE);
+	g_string_free(big, TRUE);
+	g_string_free(stream, TRUE);
+	gebr_comm_protocol_free(protocol);
+}
+
+/*
+ * Microbenchmarks, run with `gtester -m perf test-protocol'
+ */
+
+#define PERF_STREAM_SIZE (16 << 20)
+#define PERF_READ_SIZE (64 << 10)
+
+void test_comm_perf_out_burst(void)
+{
+	struct gebr_comm_protocol *protocol = gebr_comm_protocol_new();
+	gint n_messages;
+	GString *stream = build_out_stream(PERF_STREAM_SIZE, &n_messages);
+
+	g_test_timer_start();
+	g_assert_cmpint(feed_and_parse(protocol, stream->str, stream->len, PERF_READ_SIZE), ==, n_messages);
+	for (GList *i = protocol->messages->head; i; i = i->next) {
+		struct gebr_comm_slice arguments[4];
+		struct gebr_comm_message *message = i->data;
+		g_assert(gebr_comm_protocol_split_slices(message->argument, 4, arguments));
+	}
+	gdouble elapsed = g_test_timer_elapsed();
+
+	g_test_maximized_result(stream->len / elapsed / (1 << 20),
+				"parsed %d OUT messages (%.1lf MiB) in %.3lf s",
+				n_messages, stream->len / (gdouble)(1 << 20), elapsed);
+
+	g_string_free(stream, TRUE);
+	gebr_comm_protocol_free(protocol);
+}
+
+void test_comm_perf_large_run(void)
+{
+	struct gebr_comm_protocol *protocol = gebr_comm_protocol_new();
+	GString *flow = g_string_new("<?xml version=\"1.0\"?><flow>");
+
+	while (flow->len < PERF_STREAM_SIZE)
+		g_string_append(flow, "<program><parameter><value>42</value></parameter></program>");
+	g_string_append(flow, "</flow>");
+
+	GString *stream = gebr_comm_protocol_build_message(gebr_comm_protocol_defs.run_def, 5,
+							   "1", "", "", flow->str, "");
+
+	g_test_timer_start();
+	g_assert_cmpint(feed_and_parse(protocol, stream->str, stream->len, PERF_READ_SIZE), ==, 1);
+	GList *split = gebr_comm_protocol_split_new(((struct gebr_comm_message *)g_queue_peek_head(protocol->messages))->argument, 5);
+	gdouble elapsed = g_test_timer_elapsed();
+
+	g_assert_cmpuint(((GString *)g_list_nth_data(split, 3))->len, ==, flow->len);
+	g_test_maximized_result(stream->len / elapsed / (1 << 20),
+				"parsed a RUN message of %.1lf MiB in %.3lf s",
+				stream->len / (gdouble)(1 << 20), elapsed);
+
+	gebr_comm_protocol_split_free(split);
+	g_string_free(stream, TRUE);
+	g_string_free(flow, TRUE);
+	gebr_comm_protocol_free(protocol);
+}
+
+/*
+ * Sends PERF_STREAM_SIZE bytes of output of a chatty job, in 4 KiB pieces,
+ * with @framing and parses them back. Returns the bytes on the wire.
+ */
+static gsize
+perf_output_job(GPtrArray *chunks, gint framing, gboolean compress, gdouble *elapsed)
+{
+	struct gebr_comm_protocol *protocol = gebr_comm_protocol_new();
+	GString *stream = g_string_new(NULL);
+	gint n_messages = 0;
+
+	g_test_timer_start();
+	for (gsize sent = 0; sent < PERF_STREAM_SIZE; n_messages++) {
+		const gchar *output = g_ptr_array_index(chunks, n_messages % chunks->len);
+		GString *msg;
+
+		if (framing == 1)
+			msg = gebr_comm_protocol_build_message(gebr_comm_protocol_defs.out_def, 4,
+							       "1", output, "1234567890", "1");
+		else
+			msg = gebr_comm_protocol_build_frame(gebr_comm_protocol_defs.out_def, compress, 4,
+							     "1", output, "1234567890", "1");
+		g_string_append_len(stream, msg->str, msg->len);
+		g_string_free(msg, TRUE);
+		sent += strlen(output);
+	}
+
+	g_assert_cmpint(feed_and_parse(protocol, stream->str, stream->len, PERF_READ_SIZE), ==, n_messages);
+	for (GList *i = protocol->messages->head; i; i = i->next) {
+		struct gebr_comm_slice arguments[4];
+		struct gebr_comm_message *message = i->data;
+		g_assert(gebr_comm_protocol_split_slices(message->argument, 4, arguments));
+	}
+	*elapsed = g_test_timer_elapsed();
+
+	gsize wire = stream->len;
+	g_string_free(stream, TRUE);
+	gebr_comm_protocol_free(protocol);
+
+	return wire;
+}
+
+void test_comm_perf_framing(void)
+{
+	const struct {
+		const gchar *name;
+		gint framing;
+		gboolean compress;
+	} runs[] = {
+		{ "text", 1, FALSE },
+		{ "binary", 2, FALSE },
+		{ "binary+zlib", 2, TRUE },
+	};
+
+	/* output of a solver, 4 KiB at a time */
+	GPtrArray *chunks = g_ptr_array_new();
+	GString *output = g_string_new(NULL);
+	for (gint line = 0; chunks->len < 256; line++) {
+		g_string_append_printf(output, "Iteration %d: residual = %.10e, step = %d\n",
+				       line, 1.0 / (line + 1), line * 7);
+		if (output->len >= 4096) {
+			g_ptr_array_add(chunks, g_strdup(output->str));
+			g_string_truncate(output, 0);
+		}
+	}
+
+	for (gint i = 0; i < G_N_ELEMENTS(runs); i++) {
+		gdouble elapsed;
+		gsize wire = perf_output_job(chunks, runs[i].framing, runs[i].compress, &elapsed);
+		g_test_minimized_result(elapsed, "%s framing: built and parsed %d MiB of output in %.3lf s, %.1lf MiB on the wire",
+					runs[i].name, PERF_STREAM_SIZE >> 20, elapsed, wire / (gdouble)(1 << 20));
+	}
+
+	g_ptr_array_foreach(chunks, (GFunc)g_free, NULL);
+	g_ptr_array_free(chunks, TRUE);
+	g_string_free(output, TRUE);
+}
+
 int main(int argc, char *argv[])
 {
 	g_test_init(&argc, &argv, NULL);
+	gebr_comm_protocol_init();
 
 	g_test_add_func("/comm/protocol/build-message", test_comm_build_message);
+	g_test_add_func("/comm/protocol/receive-data", test_comm_receive_data);
+	g_test_add_func("/comm/protocol/split", test_comm_split);
+	g_test_add_func("/comm/protocol/frame", test_comm_frame);
+
+	if (g_test_perf()) {
+		g_test_add_func("/comm/protocol/perf/out-burst", test_comm_perf_out_burst);
+		g_test_add_func("/comm/protocol/perf/large-run", test_comm_perf_large_run);
+		g_test_add_func("/comm/protocol/perf/framing", test_comm_perf_framing);
+	}
 
 	return g_test_run();
 }
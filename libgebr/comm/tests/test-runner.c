@@ -0,0 +1,132 @@
+/*   libgebr - GeBR Library
+ *   Copyright (C) 2007-2012 GeBR core team (http://www.gebrproject.com/)
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <glib.h>
+
+#include <gebr-comm-runner_p.h>
+
+#define MAX_DAEMONS 8
+
+/*
+ * Hands the @nsteps steps of a loop to daemons with the given cores the way
+ * the runner does: each daemon takes a chunk at start, and the next one when
+ * it finishes the previous, a step taking a core one unit of time. Checks
+ * that the chunks of each daemon shrink and that every step is run exactly
+ * once.
+ *
+ * Returns: the number of chunks sent.
+ */
+static gint
+dispatch_loop(gint nsteps,
+	      const gint *cores,
+	      gint ndaemons)
+{
+	gint total_np = 0;
+	gint next_step = 0;
+	gint nchunks = 0;
+	gint last_size[MAX_DAEMONS];
+	gdouble busy_until[MAX_DAEMONS];
+	gint *runs = g_new0(gint, nsteps);
+
+	g_assert_cmpint(ndaemons, <=, MAX_DAEMONS);
+	for (gint k = 0; k < ndaemons; k++) {
+		total_np += cores[k];
+		last_size[k] = G_MAXINT;
+		busy_until[k] = 0;
+	}
+
+	while (next_step < nsteps) {
+		gint k = 0;
+		gint size;
+
+		/* The daemon which gets free first takes the next chunk */
+		for (gint j = 1; j < ndaemons; j++)
+			if (busy_until[j] < busy_until[k])
+				k = j;
+
+		size = gebr_comm_runner_chunk_size(nsteps - next_step, cores[k], total_np);
+		g_assert_cmpint(size, >, 0);
+		g_assert_cmpint(size, <=, nsteps - next_step);
+		g_assert_cmpint(size, <=, last_size[k]);
+
+		for (gint i = next_step; i < next_step + size; i++)
+			runs[i]++;
+
+		last_size[k] = size;
+		busy_until[k] += (gdouble) size / cores[k];
+		next_step += size;
+		nchunks++;
+	}
+
+	for (gint i = 0; i < nsteps; i++)
+		g_assert_cmpint(runs[i], ==, 1);
+	g_free(runs);
+
+	return nchunks;
+}
+
+static void
+test_gebr_comm_runner_chunk_size(void)
+{
+	/* Each daemon takes its share of the queue, but at least its cores */
+	g_assert_cmpint(gebr_comm_runner_chunk_size(1000, 4, 8), ==, 500);
+	g_assert_cmpint(gebr_comm_runner_chunk_size(1000, 1, 3), ==, 334);
+	g_assert_cmpint(gebr_comm_runner_chunk_size(10, 4, 8), ==, 5);
+	g_assert_cmpint(gebr_comm_runner_chunk_size(5, 4, 8), ==, 4);
+	g_assert_cmpint(gebr_comm_runner_chunk_size(3, 4, 8), ==, 3);
+	g_assert_cmpint(gebr_comm_runner_chunk_size(1, 1, 1), ==, 1);
+
+	/* Chunks shrink as the queue drains */
+	for (gint remaining = 1000, last = G_MAXINT; remaining > 0; ) {
+		gint size = gebr_comm_runner_chunk_size(remaining, 2, 6);
+		g_assert_cmpint(size, <=, last);
+		g_assert_cmpint(size, >=, MIN(2, remaining));
+		last = size;
+		remaining -= size;
+	}
+}
+
+static void
+test_gebr_comm_runner_chunks(void)
+{
+	const gint one[] = { 1 };
+	const gint even[] = { 4, 4, 4 };
+	const gint mixed[] = { 8, 2, 1, 1 };
+	const gint many[] = { 16, 16, 16, 16, 16, 16, 16, 16 };
+
+	/* A single daemon takes the whole loop */
+	g_assert_cmpint(dispatch_loop(100, one, 1), ==, 1);
+
+	g_assert_cmpint(dispatch_loop(1000, even, 3), >, 3);
+	g_assert_cmpint(dispatch_loop(1000, mixed, 4), >, 4);
+	dispatch_loop(7, mixed, 4);
+	dispatch_loop(1, mixed, 4);
+	dispatch_loop(997, many, 8);
+
+	/* Less steps than cores */
+	dispatch_loop(50, many, 8);
+}
+
+int main(int argc, char *argv[])
+{
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add_func("/libgebr/comm/runner/chunk_size", test_gebr_comm_runner_chunk_size);
+	g_test_add_func("/libgebr/comm/runner/chunks", test_gebr_comm_runner_chunks);
+
+	return g_test_run();
+}
@@ -18,6 +18,8 @@
 #include <glib.h>
 #include <glib-object.h>
 #include <glib/gstdio.h>
+#include <string.h>
+#include <unistd.h>
 
 #include <gebr-comm-listensocket.h>
 #include <gebr-comm-channelsocket.h>
@@ -122,11 +124,253 @@ void test_comm_socket_tcpunix_channel()
 	g_byte_array_free(test_data.data_read2, TRUE);
 }
 
+/* A connection through a unix socket, whose server side reads only when
+ * asked to */
+typedef struct {
+	GebrCommStreamSocket *client;
+	GebrCommStreamSocket *server;
+	GByteArray *received;
+	gboolean reading;
+	GString *high_water;
+} Pair;
+
+static GebrCommListenSocket *listener;
+static GebrCommSocketAddress listener_address;
+static GebrCommStreamSocket *accepted;
+
+static void
+on_new_connection(GebrCommListenSocket *listen_socket)
+{
+	accepted = gebr_comm_listen_socket_get_next_pending_connection(listen_socket);
+}
+
+static void
+on_pair_read(GebrCommStreamSocket *server,
+	     Pair *pair)
+{
+	if (!pair->reading)
+		return;
+
+	GByteArray *array = gebr_comm_socket_read_all(GEBR_COMM_SOCKET(server));
+	g_byte_array_append(pair->received, array->data, array->len);
+	g_byte_array_free(array, TRUE);
+}
+
+/* Writes the "high-water" signals as "1" or "0" */
+static void
+on_high_water(GebrCommStreamSocket *client,
+	      gboolean congested,
+	      Pair *pair)
+{
+	g_string_append_c(pair->high_water, congested ? '1' : '0');
+}
+
+static Pair *
+pair_new(void)
+{
+	Pair *pair = g_new(Pair, 1);
+
+	pair->client = gebr_comm_stream_socket_new();
+	g_assert(gebr_comm_stream_socket_connect(pair->client, &listener_address, TRUE));
+	while (!accepted)
+		g_main_context_iteration(NULL, TRUE);
+	pair->server = accepted;
+	accepted = NULL;
+
+	pair->received = g_byte_array_new();
+	pair->reading = FALSE;
+	pair->high_water = g_string_new(NULL);
+	g_signal_connect(pair->server, "ready-read", G_CALLBACK(on_pair_read), pair);
+	g_signal_connect(pair->client, "high-water", G_CALLBACK(on_high_water), pair);
+
+	return pair;
+}
+
+static void
+pair_free(Pair *pair)
+{
+	gebr_comm_stream_socket_disconnect(pair->client);
+	gebr_comm_stream_socket_disconnect(pair->server);
+	g_object_unref(pair->client);
+	g_object_unref(pair->server);
+	g_byte_array_free(pair->received, TRUE);
+	g_string_free(pair->high_water, TRUE);
+	g_free(pair);
+}
+
+static void
+pair_read(Pair *pair, gsize len)
+{
+	pair->reading = TRUE;
+	while (pair->received->len < len)
+		g_main_context_iteration(NULL, TRUE);
+}
+
+static GByteArray *
+random_data(gsize len)
+{
+	GByteArray *data = g_byte_array_sized_new(len);
+
+	g_byte_array_set_size(data, len);
+	for (gsize i = 0; i < len; i++)
+		data->data[i] = g_random_int();
+
+	return data;
+}
+
+static void
+test_comm_socket_partial_writes(void)
+{
+	Pair *pair = pair_new();
+	GebrCommSocket *client = GEBR_COMM_SOCKET(pair->client);
+	GByteArray *data = random_data(4 << 20);
+	GByteArray part;
+	GebrCommSocketStats stats;
+	gsize sizes[] = { 1, 100, 70000, 3 << 20 };
+	gsize offset = 0;
+
+	/* Small and large writes, more than the kernel takes at once */
+	for (guint i = 0; i < G_N_ELEMENTS(sizes); i++) {
+		part.data = data->data + offset;
+		part.len = sizes[i];
+		gebr_comm_socket_write_immediately(client, &part);
+		offset += sizes[i];
+	}
+	part.data = data->data + offset;
+	part.len = data->len - offset;
+	gebr_comm_socket_write(client, &part);
+
+	gebr_comm_socket_get_stats(client, &stats);
+	g_assert_cmpuint(stats.queued_bytes, >, 0);
+	g_assert_cmpuint(stats.queued_bytes, ==, gebr_comm_socket_bytes_to_write(client));
+	g_assert_cmpuint(stats.sent_bytes + stats.queued_bytes, ==, data->len);
+
+	/* The rest is written in order as the other side reads */
+	pair_read(pair, data->len);
+	g_assert_cmpuint(pair->received->len, ==, data->len);
+	g_assert(memcmp(pair->received->data, data->data, data->len) == 0);
+
+	gebr_comm_socket_get_stats(client, &stats);
+	g_assert_cmpuint(stats.queued_bytes, ==, 0);
+	g_assert_cmpuint(stats.sent_bytes, ==, data->len);
+	g_assert_cmpuint(stats.max_queued_bytes, >=, data->len - offset);
+
+	g_byte_array_free(data, TRUE);
+	pair_free(pair);
+}
+
+static void
+test_comm_socket_high_water(void)
+{
+	Pair *pair = pair_new();
+	GebrCommSocket *client = GEBR_COMM_SOCKET(pair->client);
+	GByteArray *data = random_data(1 << 20);
+	GByteArray part;
+
+	gebr_comm_socket_set_high_water_mark(client, 64 << 10);
+	g_assert(!gebr_comm_socket_is_congested(client));
+
+	/* Below the mark */
+	part.data = data->data;
+	part.len = 1000;
+	gebr_comm_socket_write(client, &part);
+	g_assert_cmpstr(pair->high_water->str, ==, "");
+
+	/* Past it, reported once */
+	part.data = data->data + 1000;
+	part.len = data->len - 1000;
+	gebr_comm_socket_write(client, &part);
+	gebr_comm_socket_write_immediately(client, &part);
+	g_assert_cmpstr(pair->high_water->str, ==, "1");
+	g_assert(gebr_comm_socket_is_congested(client));
+
+	/* Drained below half of it */
+	pair_read(pair, 2 * data->len - 1000);
+	g_assert_cmpstr(pair->high_water->str, ==, "10");
+	g_assert(!gebr_comm_socket_is_congested(client));
+	g_assert(memcmp(pair->received->data, data->data, data->len) == 0);
+	g_assert(memcmp(pair->received->data + data->len, data->data + 1000, data->len - 1000) == 0);
+
+	/* A new mark takes effect at once */
+	part.len = 1000;
+	gebr_comm_socket_write(client, &part);
+	g_assert_cmpstr(pair->high_water->str, ==, "10");
+	gebr_comm_socket_set_high_water_mark(client, 100);
+	g_assert_cmpstr(pair->high_water->str, ==, "101");
+	gebr_comm_socket_set_high_water_mark(client, 1 << 30);
+	g_assert_cmpstr(pair->high_water->str, ==, "1010");
+
+	g_byte_array_free(data, TRUE);
+	pair_free(pair);
+}
+
+static void
+test_comm_socket_chunks(void)
+{
+	Pair *first = pair_new();
+	Pair *second = pair_new();
+	GByteArray *data = random_data(300 << 10);
+	GByteArray tail = { (guint8 *) "tail", 4 };
+	GebrCommSocketChunk *chunk;
+
+	/* The same data queued in both, without a copy */
+	chunk = gebr_comm_socket_chunk_new((gchar *) data->data, data->len);
+	gebr_comm_socket_write_chunk(GEBR_COMM_SOCKET(first->client), chunk);
+	gebr_comm_socket_write_chunk(GEBR_COMM_SOCKET(second->client), chunk);
+	gebr_comm_socket_chunk_unref(chunk);
+
+	/* Not appended to the shared chunk */
+	gebr_comm_socket_write(GEBR_COMM_SOCKET(first->client), &tail);
+
+	pair_read(second, data->len);
+	pair_read(first, data->len + tail.len);
+
+	g_assert_cmpuint(second->received->len, ==, data->len);
+	g_assert(memcmp(second->received->data, data->data, data->len) == 0);
+	g_assert_cmpuint(first->received->len, ==, data->len + tail.len);
+	g_assert(memcmp(first->received->data, data->data, data->len) == 0);
+	g_assert(memcmp(first->received->data + data->len, "tail", tail.len) == 0);
+
+	/* A chunk can still be used after the sockets dropped it */
+	chunk = gebr_comm_socket_chunk_new((gchar *) data->data, 10);
+	gebr_comm_socket_write_chunk(GEBR_COMM_SOCKET(first->client), chunk);
+	pair_read(first, data->len + tail.len + 10);
+	gebr_comm_socket_write_chunk(GEBR_COMM_SOCKET(second->client), chunk);
+	pair_read(second, data->len + 10);
+	g_assert(memcmp(second->received->data + data->len, data->data, 10) == 0);
+	gebr_comm_socket_chunk_unref(chunk);
+
+	g_byte_array_free(data, TRUE);
+	pair_free(first);
+	pair_free(second);
+}
+
 int main(int argc, char *argv[])
 {
+	gchar *name = g_strdup_printf("gebr-test-socket-%d", (gint) getpid());
+	gchar *path = g_build_filename(g_get_tmp_dir(), name, NULL);
+	gint ret;
+
 	g_test_init(&argc, &argv, NULL);
 	loop = g_main_loop_new(NULL, FALSE);
 	g_type_init();
+
+	g_unlink(path);
+	listener_address = gebr_comm_socket_address_unix(path);
+	listener = gebr_comm_listen_socket_new();
+	g_assert(gebr_comm_listen_socket_listen(listener, &listener_address));
+	g_signal_connect(listener, "new-connection", G_CALLBACK(on_new_connection), NULL);
+
 	//g_test_add_func("/comm/socket/tcpunix-channel", test_comm_socket_tcpunix_channel);
-	return g_test_run();
+	g_test_add_func("/comm/socket/partial-writes", test_comm_socket_partial_writes);
+	g_test_add_func("/comm/socket/high-water", test_comm_socket_high_water);
+	g_test_add_func("/comm/socket/chunks", test_comm_socket_chunks);
+	ret = g_test_run();
+
+	gebr_comm_listen_socket_free(listener);
+	g_unlink(path);
+	g_free(path);
+	g_free(name);
+
+	return ret;
 }
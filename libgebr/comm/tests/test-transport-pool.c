@@ -0,0 +1,242 @@
+/*   libgebr - GeBR Library
+ *   Copyright (C) 2007-2012 GeBR core team (http://www.gebrproject.com/)
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <glib.h>
+#include <glib-object.h>
+#include <glib/gstdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <gebr-comm-transport-pool.h>
+
+#define HOST "node1"
+
+typedef struct {
+	GebrCommTransportPool *pool;
+	gchar *dir;
+	GMainLoop *loop;
+	gint n_ready;
+	gint n_failed;
+} Fixture;
+
+static void
+fixture_setup(Fixture *fixture, gconstpointer data)
+{
+	fixture->dir = g_build_filename(g_get_tmp_dir(), "test-transport-pool-XXXXXX", NULL);
+	g_assert(mkdtemp(fixture->dir) != NULL);
+	fixture->pool = gebr_comm_transport_pool_new(GEBR_COMM_TRANSPORT_LOOPBACK, fixture->dir);
+	fixture->loop = g_main_loop_new(NULL, FALSE);
+	fixture->n_ready = 0;
+	fixture->n_failed = 0;
+}
+
+static void
+fixture_teardown(Fixture *fixture, gconstpointer data)
+{
+	gebr_comm_transport_pool_free(fixture->pool);
+	g_main_loop_unref(fixture->loop);
+	g_rmdir(fixture->dir);
+	g_free(fixture->dir);
+}
+
+static void
+on_ready(GebrCommTransportPool *pool,
+	 const gchar *address,
+	 GError *error,
+	 Fixture *fixture)
+{
+	g_assert_cmpstr(address, ==, HOST);
+
+	if (error)
+		fixture->n_failed++;
+	else
+		fixture->n_ready++;
+
+	g_main_loop_quit(fixture->loop);
+}
+
+static gboolean
+on_timeout(gpointer data)
+{
+	g_error("Timed out waiting for the session");
+	return FALSE;
+}
+
+static void
+wait_for(Fixture *fixture, gint n_ready)
+{
+	guint id = g_timeout_add_seconds(10, on_timeout, NULL);
+
+	while (fixture->n_ready + fixture->n_failed < n_ready)
+		g_main_loop_run(fixture->loop);
+
+	g_source_remove(id);
+}
+
+static gchar *
+get_control_path(Fixture *fixture)
+{
+	gchar *name = g_compute_checksum_for_string(G_CHECKSUM_MD5, HOST, -1);
+	gchar *path = g_build_filename(fixture->dir, name, NULL);
+	g_free(name);
+	return path;
+}
+
+static void
+test_transport_pool_share(Fixture *fixture, gconstpointer data)
+{
+	GebrCommSsh *session;
+
+	/* The first request opens the session, the others wait for it */
+	session = gebr_comm_transport_pool_acquire(fixture->pool, HOST, (GebrCommTransportReadyFunc) on_ready, fixture);
+	g_assert(session != NULL);
+	g_assert_cmpint(gebr_comm_transport_pool_get_state(fixture->pool, HOST), ==, GEBR_COMM_TRANSPORT_STATE_CONNECTING);
+
+	session = gebr_comm_transport_pool_acquire(fixture->pool, HOST, (GebrCommTransportReadyFunc) on_ready, fixture);
+	g_assert(session == NULL);
+
+	wait_for(fixture, 2);
+	g_assert_cmpint(fixture->n_ready, ==, 2);
+	g_assert_cmpint(gebr_comm_transport_pool_get_state(fixture->pool, HOST), ==, GEBR_COMM_TRANSPORT_STATE_UP);
+
+	/* Requests after the session is up are answered once it is checked */
+	session = gebr_comm_transport_pool_acquire(fixture->pool, HOST, (GebrCommTransportReadyFunc) on_ready, fixture);
+	g_assert(session == NULL);
+	g_assert_cmpint(fixture->n_ready, ==, 2);
+	wait_for(fixture, 3);
+	g_assert_cmpint(fixture->n_ready, ==, 3);
+
+	gchar *output = NULL;
+	gchar *cmd = gebr_comm_transport_pool_get_command(fixture->pool, HOST, "-x", "\"echo gebr-port=2125\"");
+	g_assert(g_spawn_command_line_sync(cmd, &output, NULL, NULL, NULL));
+	g_assert(strstr(output, "gebr-port=2125\n") != NULL);
+	g_free(output);
+	g_free(cmd);
+
+	/* Forwards are added in the background too */
+	gebr_comm_transport_pool_forward(fixture->pool, HOST, "-L 2000:localhost:22",
+					 (GebrCommTransportReadyFunc) on_ready, fixture);
+	g_assert_cmpint(fixture->n_ready, ==, 3);
+	wait_for(fixture, 4);
+	g_assert_cmpint(fixture->n_ready, ==, 4);
+	gebr_comm_transport_pool_cancel_forward(fixture->pool, HOST, "-L 2000:localhost:22");
+}
+
+static void
+test_transport_pool_dead(Fixture *fixture, gconstpointer data)
+{
+	gchar *path = get_control_path(fixture);
+
+	gebr_comm_transport_pool_acquire(fixture->pool, HOST, (GebrCommTransportReadyFunc) on_ready, fixture);
+	wait_for(fixture, 1);
+
+	/* A request for an up session that does not answer fails */
+	g_assert(g_file_set_contents(path, "none\n", -1, NULL));
+	g_assert(gebr_comm_transport_pool_acquire(fixture->pool, HOST, (GebrCommTransportReadyFunc) on_ready, fixture) == NULL);
+	wait_for(fixture, 2);
+	g_assert_cmpint(fixture->n_failed, ==, 1);
+	g_assert_cmpint(gebr_comm_transport_pool_get_state(fixture->pool, HOST), ==, GEBR_COMM_TRANSPORT_STATE_DOWN);
+
+	g_free(path);
+}
+
+static void
+test_transport_pool_health_check(Fixture *fixture, gconstpointer data)
+{
+	gchar *path = get_control_path(fixture);
+
+	gebr_comm_transport_pool_acquire(fixture->pool, HOST, (GebrCommTransportReadyFunc) on_ready, fixture);
+	wait_for(fixture, 1);
+	g_assert(gebr_comm_transport_pool_check(fixture->pool, HOST));
+
+	/* A session that does not answer is dropped */
+	g_assert(g_file_set_contents(path, "none\n", -1, NULL));
+	g_assert(!gebr_comm_transport_pool_check(fixture->pool, HOST));
+	g_assert_cmpint(gebr_comm_transport_pool_get_state(fixture->pool, HOST), ==, GEBR_COMM_TRANSPORT_STATE_DOWN);
+
+	/* and the next request opens a new one */
+	g_assert(gebr_comm_transport_pool_acquire(fixture->pool, HOST, (GebrCommTransportReadyFunc) on_ready, fixture) != NULL);
+	wait_for(fixture, 2);
+	g_assert_cmpint(fixture->n_ready, ==, 2);
+	g_assert(gebr_comm_transport_pool_check(fixture->pool, HOST));
+
+	gebr_comm_transport_pool_close(fixture->pool, HOST);
+	g_assert_cmpint(gebr_comm_transport_pool_get_state(fixture->pool, HOST), ==, GEBR_COMM_TRANSPORT_STATE_DOWN);
+	g_assert(!g_file_test(path, G_FILE_TEST_EXISTS));
+
+	g_free(path);
+}
+
+static void
+test_transport_pool_close_connecting(Fixture *fixture, gconstpointer data)
+{
+	gebr_comm_transport_pool_acquire(fixture->pool, HOST, (GebrCommTransportReadyFunc) on_ready, fixture);
+	gebr_comm_transport_pool_acquire(fixture->pool, HOST, (GebrCommTransportReadyFunc) on_ready, fixture);
+
+	/* Waiting requests fail if the session is closed before it is up */
+	gebr_comm_transport_pool_close(fixture->pool, HOST);
+	g_assert_cmpint(fixture->n_failed, ==, 2);
+	g_assert_cmpint(fixture->n_ready, ==, 0);
+}
+
+static void
+test_transport_pool_free(Fixture *fixture, gconstpointer data)
+{
+	gchar *path = get_control_path(fixture);
+	GebrCommTransportPool *other;
+
+	gebr_comm_transport_pool_acquire(fixture->pool, HOST, (GebrCommTransportReadyFunc) on_ready, fixture);
+	wait_for(fixture, 1);
+
+	/* Another pool adopts the session, without opening a new one */
+	other = gebr_comm_transport_pool_new(GEBR_COMM_TRANSPORT_LOOPBACK, fixture->dir);
+	gebr_comm_transport_pool_acquire(other, HOST, (GebrCommTransportReadyFunc) on_ready, fixture);
+	wait_for(fixture, 2);
+	g_assert_cmpint(fixture->n_ready, ==, 2);
+	g_assert_cmpint(gebr_comm_transport_pool_get_state(other, HOST), ==, GEBR_COMM_TRANSPORT_STATE_UP);
+
+	/* and leaves it up when freed */
+	gebr_comm_transport_pool_free(other);
+	g_assert(gebr_comm_transport_pool_check(fixture->pool, HOST));
+
+	/* The pool that opened it closes it */
+	gebr_comm_transport_pool_free(fixture->pool);
+	g_assert(!g_file_test(path, G_FILE_TEST_EXISTS));
+
+	fixture->pool = gebr_comm_transport_pool_new(GEBR_COMM_TRANSPORT_LOOPBACK, fixture->dir);
+	g_free(path);
+}
+
+int main(int argc, char *argv[])
+{
+	g_type_init();
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add("/comm/transport-pool/share", Fixture, NULL,
+		   fixture_setup, test_transport_pool_share, fixture_teardown);
+	g_test_add("/comm/transport-pool/health-check", Fixture, NULL,
+		   fixture_setup, test_transport_pool_health_check, fixture_teardown);
+	g_test_add("/comm/transport-pool/dead", Fixture, NULL,
+		   fixture_setup, test_transport_pool_dead, fixture_teardown);
+	g_test_add("/comm/transport-pool/close-connecting", Fixture, NULL,
+		   fixture_setup, test_transport_pool_close_connecting, fixture_teardown);
+	g_test_add("/comm/transport-pool/free", Fixture, NULL,
+		   fixture_setup, test_transport_pool_free, fixture_teardown);
+
+	return g_test_run();
+}
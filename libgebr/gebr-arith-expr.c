@@ -25,6 +25,7 @@
 
 #include "utils.h"
 #include "gebr-arith-expr.h"
+#include "gebr-bc.h"
 #include "gebr-iexpr.h"
 
 #define EVAL_COOKIE "GEBR-EVAL-COOKIE\n"
@@ -33,12 +34,16 @@
 
 /*
  * @vars: The hash table holding VarName -> Value
+ * @backend: Which evaluator is used, see #GebrArithExprBackend
+ * @bc: The in-process interpreter, for the native backend
  * @in_ch: Input channel for sending messages to 'bc'
  * @out_ch: Output channel for receiving messages from 'bc'
- * @out_ch: Error channel for receiving errors from 'bc'
+ * @initialized: Whether 'bc' was spawned, it is only done on first use
  */
 struct _GebrArithExprPriv {
 	GHashTable *vars;
+	GebrArithExprBackend backend;
+	GebrBc *bc;
 	GIOChannel *in_ch;
 	GIOChannel *out_ch;
 	gboolean initialized;
@@ -60,6 +65,8 @@ gebr_arith_expr_eval_impl (GebrIExpr   *self,
 
 gboolean arith_spawn_bc(GebrArithExpr *self, int *in_fd, int *out_fd);
 
+static gboolean arith_setup_backend(GebrArithExpr *self, GError **err);
+
 G_DEFINE_TYPE_WITH_CODE(GebrArithExpr, gebr_arith_expr, G_TYPE_OBJECT,
 			G_IMPLEMENT_INTERFACE(GEBR_TYPE_IEXPR,
 					      gebr_arith_expr_interface_init));
@@ -77,41 +84,19 @@ static void gebr_arith_expr_class_init(GebrArithExprClass *klass)
 
 static void gebr_arith_expr_init(GebrArithExpr *self)
 {
-	gint in_fd, out_fd;
-	GError *error = NULL;
-
 	self->priv = G_TYPE_INSTANCE_GET_PRIVATE(self,
 						 GEBR_TYPE_ARITH_EXPR,
 						 GebrArithExprPriv);
 
-	if (!arith_spawn_bc (self, &in_fd, &out_fd)) {
-		g_warning("Could not execute `bc'");
-		self->priv->initialized = FALSE;
-		return;
-	}
-
-	self->priv->in_ch = g_io_channel_unix_new (in_fd);
-	self->priv->out_ch = g_io_channel_unix_new (out_fd);
-
-	if (!configure_channel (self->priv->in_ch, &error) ||
-	    !configure_channel (self->priv->out_ch, &error))
-	{
-		g_io_channel_unref (self->priv->in_ch);
-		g_io_channel_unref (self->priv->out_ch);
-
-		g_warning("Could not create channels to listen `bc': %s",
-			  error->message);
-		g_clear_error(&error);
-		self->priv->initialized = FALSE;
-		return;
-	}
+	if (g_strcmp0(g_getenv("GEBR_ARITH_EXPR_BACKEND"), "bc") == 0)
+		self->priv->backend = GEBR_ARITH_EXPR_BACKEND_BC;
+	else
+		self->priv->backend = GEBR_ARITH_EXPR_BACKEND_NATIVE;
 
 	self->priv->vars = g_hash_table_new_full(g_str_hash,
 						 g_str_equal,
 						 g_free,
 						 NULL);
-
-	self->priv->initialized = TRUE;
 }
 
 static void gebr_arith_expr_finalize(GObject *object)
@@ -119,10 +104,14 @@ static void gebr_arith_expr_finalize(GObject *object)
 	gint exitstatus;
 	GebrArithExpr *self = GEBR_ARITH_EXPR(object);
 
-	kill(self->priv->child, SIGKILL);
-	waitpid(self->priv->child, &exitstatus, 0);
-	g_io_channel_unref (self->priv->in_ch);
-	g_io_channel_unref (self->priv->out_ch);
+	if (self->priv->initialized) {
+		kill(self->priv->child, SIGKILL);
+		waitpid(self->priv->child, &exitstatus, 0);
+		g_io_channel_unref (self->priv->in_ch);
+		g_io_channel_unref (self->priv->out_ch);
+	}
+	if (self->priv->bc)
+		gebr_bc_free(self->priv->bc);
 	g_hash_table_unref(self->priv->vars);
 
 	G_OBJECT_CLASS(gebr_arith_expr_parent_class)->finalize(object);
@@ -143,14 +132,8 @@ static gboolean gebr_arith_expr_set_var(GebrIExpr              *iface,
 	const gchar *invalid_var = NULL;
 	GebrArithExpr *self = GEBR_ARITH_EXPR(iface);
 
-	if (!self->priv->initialized) {
-		g_set_error(err,
-			    GEBR_IEXPR_ERROR,
-			    GEBR_IEXPR_ERROR_INITIALIZE,
-			    _("Error while initializing validator,"
-			      " please contact support"));
+	if (!arith_setup_backend(self, err))
 		return FALSE;
-	}
 
 	switch (type)
 	{
@@ -397,6 +380,61 @@ arith_spawn_bc(GebrArithExpr *self, int *infd, int *outfd)
 	return TRUE;
 }
 
+/*
+ * arith_setup_backend:
+ *
+ * Creates the interpreter for the native backend or spawns `bc', which is
+ * delayed until the first evaluation since most validators never need it.
+ *
+ * Returns: %FALSE and sets @err if the backend could not be started
+ */
+static gboolean
+arith_setup_backend(GebrArithExpr *self, GError **err)
+{
+	gint in_fd, out_fd;
+	GError *error = NULL;
+
+	if (self->priv->backend == GEBR_ARITH_EXPR_BACKEND_NATIVE) {
+		if (!self->priv->bc)
+			self->priv->bc = gebr_bc_new(TRUE);
+		return TRUE;
+	}
+
+	if (self->priv->initialized)
+		return TRUE;
+
+	if (!arith_spawn_bc (self, &in_fd, &out_fd)) {
+		g_warning("Could not execute `bc'");
+		goto exception;
+	}
+
+	self->priv->in_ch = g_io_channel_unix_new (in_fd);
+	self->priv->out_ch = g_io_channel_unix_new (out_fd);
+
+	if (!configure_channel (self->priv->in_ch, &error) ||
+	    !configure_channel (self->priv->out_ch, &error))
+	{
+		g_io_channel_unref (self->priv->in_ch);
+		g_io_channel_unref (self->priv->out_ch);
+
+		g_warning("Could not create channels to listen `bc': %s",
+			  error->message);
+		g_clear_error(&error);
+		goto exception;
+	}
+
+	self->priv->initialized = TRUE;
+	return TRUE;
+
+exception:
+	g_set_error(err,
+		    GEBR_IEXPR_ERROR,
+		    GEBR_IEXPR_ERROR_INITIALIZE,
+		    _("Error while initializing validator,"
+		      " please contact support"));
+	return FALSE;
+}
+
 /*
  * configure_channel:
  *
@@ -446,6 +484,69 @@ read_bc_line(GebrArithExpr *self,
 	return TRUE;
 }
 
+/*
+ * arith_eval_native:
+ *
+ * Evaluates @expr with the in-process interpreter, applying the same rules
+ * used for `bc' output: the expression must print exactly one line.
+ */
+static gboolean
+arith_eval_native(GebrArithExpr *self,
+		  const gchar   *expr,
+		  gchar        **result,
+		  GError       **err)
+{
+	GError *error = NULL;
+	GString *buffer = g_string_sized_new(70);
+	gchar *program = g_strconcat(expr, "\n", NULL);
+	gint results = 0;
+
+	gebr_bc_run(self->priv->bc, program, buffer, &error);
+	g_free(program);
+
+	if (error) {
+		g_set_error(err,
+			    GEBR_IEXPR_ERROR,
+			    error->code == GEBR_BC_ERROR_SYNTAX ?
+			    GEBR_IEXPR_ERROR_SYNTAX : GEBR_IEXPR_ERROR_RUNTIME,
+			    _("Invalid expression: %s"), error->message);
+		g_clear_error(&error);
+		g_string_free(buffer, TRUE);
+		return FALSE;
+	}
+
+	for (gsize i = 0; i < buffer->len; i++)
+		if (buffer->str[i] == '\n')
+			results++;
+	if (buffer->len && buffer->str[buffer->len - 1] != '\n')
+		results++;
+
+	if (results == 0) {
+		g_set_error(err,
+			    GEBR_IEXPR_ERROR,
+			    GEBR_IEXPR_ERROR_SYNTAX,
+			    _("Expression does not evaluate to a value"));
+		g_string_free(buffer, TRUE);
+		return FALSE;
+	}
+
+	if (results > 1) {
+		g_set_error(err,
+		            GEBR_IEXPR_ERROR,
+		            GEBR_IEXPR_ERROR_SYNTAX,
+		            _("Expression returned multiple results"));
+		g_string_free(buffer, TRUE);
+		return FALSE;
+	}
+
+	if (buffer->str[buffer->len - 1] == '\n')
+		g_string_set_size(buffer, buffer->len - 1);
+	if (result)
+		*result = buffer->str;
+	g_string_free(buffer, !result);
+	return TRUE;
+}
+
 /*
  * gebr_arith_expr_eval_internal:
  */
@@ -468,6 +569,12 @@ gebr_arith_expr_eval_internal(GebrArithExpr *self,
 		return FALSE;
 	}
 
+	if (!arith_setup_backend(self, err))
+		return FALSE;
+
+	if (self->priv->backend == GEBR_ARITH_EXPR_BACKEND_NATIVE)
+		return arith_eval_native(self, expr, result, err);
+
 	line = g_strdup_printf ("%s\n\"%s\"\n", expr, EVAL_COOKIE);
 	g_io_channel_write_chars (self->priv->in_ch, line, -1, NULL, &error);
 	g_free (line);
@@ -586,6 +693,13 @@ GebrArithExpr *gebr_arith_expr_new(void)
 	return g_object_new(GEBR_TYPE_ARITH_EXPR, NULL);
 }
 
+GebrArithExpr *gebr_arith_expr_new_with_backend(GebrArithExprBackend backend)
+{
+	GebrArithExpr *self = g_object_new(GEBR_TYPE_ARITH_EXPR, NULL);
+	self->priv->backend = backend;
+	return self;
+}
+
 
 gboolean gebr_arith_expr_eval(GebrArithExpr *self,
 			      const gchar   *expr,
@@ -594,14 +708,8 @@ gboolean gebr_arith_expr_eval(GebrArithExpr *self,
 {
 	gchar *string = NULL;
 
-	if (!self->priv->initialized) {
-		g_set_error(err,
-			    GEBR_IEXPR_ERROR,
-			    GEBR_IEXPR_ERROR_INITIALIZE,
-			    _("Error while initializing validator,"
-			      " please contact support"));
+	if (!arith_setup_backend(self, err))
 		return FALSE;
-	}
 
 	if (strchr(expr, ';')) {
 		g_set_error (err,
@@ -50,15 +50,36 @@ struct _GebrArithExprClass {
 	GObjectClass parent;
 };
 
+/**
+ * GebrArithExprBackend:
+ * @GEBR_ARITH_EXPR_BACKEND_NATIVE: Evaluate expressions in-process with #GebrBc.
+ * @GEBR_ARITH_EXPR_BACKEND_BC: Evaluate expressions with a forked `bc -l' process.
+ */
+typedef enum {
+	GEBR_ARITH_EXPR_BACKEND_NATIVE,
+	GEBR_ARITH_EXPR_BACKEND_BC,
+} GebrArithExprBackend;
+
 GType gebr_arith_expr_get_type(void) G_GNUC_CONST;
 
 /**
  * gebr_arith_expr_new:
- * 
+ *
+ * Creates an expression evaluator with the native backend, unless the
+ * environment variable GEBR_ARITH_EXPR_BACKEND is set to "bc".
+ *
  * Returns: a newly allocated #GebrArithExpr with reference count of 1.
  */
 GebrArithExpr *gebr_arith_expr_new(void);
 
+/**
+ * gebr_arith_expr_new_with_backend:
+ * @backend: the #GebrArithExprBackend used to evaluate expressions
+ *
+ * Returns: a newly allocated #GebrArithExpr with reference count of 1.
+ */
+GebrArithExpr *gebr_arith_expr_new_with_backend(GebrArithExprBackend backend);
+
 /**
  * gebr_arith_expr_eval:
  * @expr: a #GebrArithExpr
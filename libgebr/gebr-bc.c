@@ -0,0 +1,2724 @@
+/*   libgebr - GeBR Library
+ *   Copyright (C) 2011 GeBR core team (http://www.gebrproject.com/)
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#include "gebr-bc.h"
+
+#define BC_MAX_SCALE		G_MAXINT
+#define BC_MAX_DIM		65535
+#define BC_MAX_DIGITS		100000
+#define BC_MAX_CALL_DEPTH	1000
+
+/* Prototypes & Private {{{1 */
+
+/*
+ * BcNum:
+ * @neg: Whether the number is negative
+ * @len: Number of digits in the integer part, at least one
+ * @scale: Number of digits in the fractional part
+ * @d: Decimal digits, most significant first
+ *
+ * Numbers follow the representation used by GNU bc, so results (including
+ * truncation of intermediate values) are the same as the ones printed by it.
+ */
+typedef struct {
+	gboolean neg;
+	gint len;
+	gint scale;
+	guchar *d;
+} BcNum;
+
+typedef struct {
+	BcNum *value;
+	GSList *saved;
+} BcVar;
+
+typedef struct {
+	GPtrArray *values;
+	GSList *saved;
+} BcArray;
+
+typedef struct {
+	gboolean is_array;
+	gpointer slot;
+} BcLocal;
+
+typedef struct _BcNode BcNode;
+
+typedef struct {
+	gchar *name;
+	gboolean defined;
+	GPtrArray *params;
+	GPtrArray *autos;
+	BcNode *body;
+} BcFunc;
+
+typedef enum {
+	/* Expressions */
+	BC_NODE_NUMBER,
+	BC_NODE_VAR,
+	BC_NODE_ARRAY,
+	BC_NODE_SCALE,
+	BC_NODE_IBASE,
+	BC_NODE_OBASE,
+	BC_NODE_LAST,
+	BC_NODE_CALL,
+	BC_NODE_LENGTH,
+	BC_NODE_SCALE_OF,
+	BC_NODE_SQRT,
+	BC_NODE_NEGATE,
+	BC_NODE_NOT,
+	BC_NODE_AND,
+	BC_NODE_OR,
+	BC_NODE_BINARY,
+	BC_NODE_RELATION,
+	BC_NODE_ASSIGN,
+	BC_NODE_PRE_INCR,
+	BC_NODE_PRE_DECR,
+	BC_NODE_POST_INCR,
+	BC_NODE_POST_DECR,
+
+	/* Statements */
+	BC_NODE_STRING,
+	BC_NODE_EXPR_STMT,
+	BC_NODE_PRINT,
+	BC_NODE_BLOCK,
+	BC_NODE_IF,
+	BC_NODE_WHILE,
+	BC_NODE_FOR,
+	BC_NODE_BREAK,
+	BC_NODE_CONTINUE,
+	BC_NODE_RETURN,
+} BcNodeType;
+
+/*
+ * BcNode:
+ * @op: Operator of binary, relational and assignment nodes
+ * @paren: Whether the expression was written between parentheses
+ * @slot: The #BcVar, #BcArray or #BcFunc referenced by this node
+ * @a, @b, @c, @d: Children, e.g. the condition and branches of an `if'
+ * @list: Call arguments, block statements or print items
+ */
+struct _BcNode {
+	BcNodeType type;
+	gchar op;
+	gboolean paren;
+	BcNum *num;
+	gchar *str;
+	gpointer slot;
+	BcNode *a;
+	BcNode *b;
+	BcNode *c;
+	BcNode *d;
+	GPtrArray *list;
+};
+
+typedef enum {
+	BC_FLOW_NEXT,
+	BC_FLOW_BREAK,
+	BC_FLOW_CONTINUE,
+	BC_FLOW_RETURN,
+	BC_FLOW_ERROR,
+} BcFlow;
+
+struct _GebrBc {
+	GHashTable *vars;
+	GHashTable *arrays;
+	GHashTable *funcs;
+	gint scale;
+	gint ibase;
+	gint obase;
+	BcNum *last;
+	BcNum *retval;
+	GString *output;
+	GError *error;
+	gint depth;
+};
+
+enum {
+	TOK_EOF = 256,
+	TOK_NEWLINE,
+	TOK_NUMBER,
+	TOK_NAME,
+	TOK_STRING,
+	TOK_ASSIGN,
+	TOK_REL,
+	TOK_INCR,
+	TOK_DECR,
+	TOK_AND,
+	TOK_OR,
+	TOK_ERROR,
+
+	/* Keywords */
+	TOK_AUTO,
+	TOK_BREAK,
+	TOK_CONTINUE,
+	TOK_DEFINE,
+	TOK_ELSE,
+	TOK_FOR,
+	TOK_HALT,
+	TOK_IBASE,
+	TOK_IF,
+	TOK_LAST,
+	TOK_LENGTH,
+	TOK_LIMITS,
+	TOK_OBASE,
+	TOK_PRINT,
+	TOK_QUIT,
+	TOK_READ,
+	TOK_RETURN,
+	TOK_SCALE,
+	TOK_SQRT,
+	TOK_WARRANTY,
+	TOK_WHILE,
+};
+
+static const struct {
+	const gchar *word;
+	gint token;
+} keywords[] = {
+	{"auto", TOK_AUTO},
+	{"break", TOK_BREAK},
+	{"continue", TOK_CONTINUE},
+	{"define", TOK_DEFINE},
+	{"else", TOK_ELSE},
+	{"for", TOK_FOR},
+	{"halt", TOK_HALT},
+	{"ibase", TOK_IBASE},
+	{"if", TOK_IF},
+	{"last", TOK_LAST},
+	{"length", TOK_LENGTH},
+	{"limits", TOK_LIMITS},
+	{"obase", TOK_OBASE},
+	{"print", TOK_PRINT},
+	{"quit", TOK_QUIT},
+	{"read", TOK_READ},
+	{"return", TOK_RETURN},
+	{"scale", TOK_SCALE},
+	{"sqrt", TOK_SQRT},
+	{"warranty", TOK_WARRANTY},
+	{"while", TOK_WHILE},
+	{NULL, 0}
+};
+
+/*
+ * BcParser:
+ * @token: Current token type, one of the TOK_* values or a single character
+ * @op: Operator of TOK_ASSIGN and TOK_REL tokens
+ * @start: Start of the current token text
+ * @len: Length of the current token text
+ * @function: The function being defined, or %NULL for the main program
+ * @loops: How many loops enclose the statement being parsed
+ */
+typedef struct {
+	GebrBc *bc;
+	const gchar *p;
+	gint token;
+	gchar op;
+	const gchar *start;
+	gsize len;
+	gint line;
+	GError *error;
+	BcFunc *function;
+	gint loops;
+} BcParser;
+
+/*
+ * Standard math library, from the libmath.b file of GNU bc. It is loaded by
+ * gebr_bc_new() when @mathlib is %TRUE, the same way `bc -l' does.
+ */
+static const gchar *mathlib_source =
+"scale = 20\n"
+"define e(x) {\n"
+"  auto  a, b, d, e, f, i, m, n, v, z\n"
+"  b = ibase\n"
+"  ibase = A\n"
+"  if (x<0) {\n"
+"    m = 1\n"
+"    x = -x\n"
+"  }\n"
+"  z = scale;\n"
+"  n = 6 + z + .44*x;\n"
+"  scale = scale(x)+1;\n"
+"  while (x > 1) {\n"
+"    f += 1;\n"
+"    x /= 2;\n"
+"    scale += 1;\n"
+"  }\n"
+"  scale = n;\n"
+"  v = 1+x\n"
+"  a = x\n"
+"  d = 1\n"
+"  for (i=2; 1; i++) {\n"
+"    e = (a *= x) / (d *= i)\n"
+"    if (e == 0) {\n"
+"      if (f>0) while (f--)  v = v*v;\n"
+"      scale = z\n"
+"      ibase = b\n"
+"      if (m) return (1/v);\n"
+"      return (v/1);\n"
+"    }\n"
+"    v += e\n"
+"  }\n"
+"}\n"
+"define l(x) {\n"
+"  auto b, e, f, i, m, n, v, z\n"
+"  if (x <= 0) return ((1 - 10^scale)/1)\n"
+"  z = scale;\n"
+"  scale = 6 + scale;\n"
+"  f = 2;\n"
+"  i=0\n"
+"  b = ibase\n"
+"  ibase = A\n"
+"  while (x >= 2) {\n"
+"    f *= 2;\n"
+"    x = sqrt(x);\n"
+"  }\n"
+"  while (x <= .5) {\n"
+"    f *= 2;\n"
+"    x = sqrt(x);\n"
+"  }\n"
+"  v = n = (x-1)/(x+1)\n"
+"  m = n*n\n"
+"  for (i=3; 1; i+=2) {\n"
+"    e = (n *= m) / i\n"
+"    if (e == 0) {\n"
+"      v = f*v\n"
+"      scale = z\n"
+"      ibase = b\n"
+"      return (v/1)\n"
+"    }\n"
+"    v += e\n"
+"  }\n"
+"}\n"
+"define s(x) {\n"
+"  auto  b, e, i, m, n, s, v, z\n"
+"  z = scale\n"
+"  b = ibase\n"
+"  ibase = A\n"
+"  scale = 1.1*z + 2;\n"
+"  v = a(1)\n"
+"  if (x < 0) {\n"
+"    m = 1;\n"
+"    x = -x;\n"
+"  }\n"
+"  scale = 0\n"
+"  n = (x / v + 2 )/4\n"
+"  x = x - 4*n*v\n"
+"  if (n%2) x = -x\n"
+"  scale = z + 2;\n"
+"  v = e = x\n"
+"  s = -x*x\n"
+"  for (i=3; 1; i+=2) {\n"
+"    e *= s/(i*(i-1))\n"
+"    if (e == 0) {\n"
+"      scale = z\n"
+"      ibase = b\n"
+"      if (m) return (-v/1);\n"
+"      return (v/1);\n"
+"    }\n"
+"    v += e\n"
+"  }\n"
+"}\n"
+"define c(x) {\n"
+"  auto v, z\n"
+"  z = scale;\n"
+"  scale = scale*1.2;\n"
+"  v = s(x+a(1)*2);\n"
+"  scale = z;\n"
+"  return (v/1);\n"
+"}\n"
+"define a(x) {\n"
+"  auto a, b, e, f, i, m, n, s, v, z\n"
+"  m = 1;\n"
+"  if (x<0) {\n"
+"    m = -1;\n"
+"    x = -x;\n"
+"  }\n"
+"  if (x==1) {\n"
+"    if (scale <= 25) return (.7853981633974483096156608/m)\n"
+"    if (scale <= 40) return (.7853981633974483096156608458198757210492/m)\n"
+"    if (scale <= 60) \\\n"
+"      return (.785398163397448309615660845819875721049292349843776455243736/m)\n"
+"  }\n"
+"  if (x==.2) {\n"
+"    if (scale <= 25) return (.1973955598498807583700497/m)\n"
+"    if (scale <= 40) return (.1973955598498807583700497651947902934475/m)\n"
+"    if (scale <= 60) \\\n"
+"      return (.197395559849880758370049765194790293447585103787852101517688/m)\n"
+"  }\n"
+"  b = ibase\n"
+"  ibase = A\n"
+"  z = scale;\n"
+"  if (x > .2)  {\n"
+"    scale = z+5;\n"
+"    a = a(.2);\n"
+"  }\n"
+"  scale = z+3;\n"
+"  while (x > .2) {\n"
+"    f += 1;\n"
+"    x = (x-.2) / (1+x*.2);\n"
+"  }\n"
+"  v = n = x;\n"
+"  s = -x*x;\n"
+"  for (i=3; 1; i+=2) {\n"
+"    n *= s;\n"
+"    e = n / i;\n"
+"    if (e == 0) {\n"
+"      scale = z;\n"
+"      ibase = b\n"
+"      return ((f*a+v)/m);\n"
+"    }\n"
+"    v += e\n"
+"  }\n"
+"}\n"
+"define j(n,x) {\n"
+"  auto a, b, d, e, f, i, m, s, v, z\n"
+"  z = scale;\n"
+"  scale = 0;\n"
+"  n = n/1;\n"
+"  if (n<0) {\n"
+"    n = -n;\n"
+"    if (n%2 == 1) m = 1;\n"
+"  }\n"
+"  b = ibase;\n"
+"  ibase = A;\n"
+"  scale = 1.5*z;\n"
+"  a = (x^n)/2^n;\n"
+"  for (i=2; i<=n; i++) a /= i;\n"
+"  scale = 2*z;\n"
+"  v = e = 1;\n"
+"  s = -x*x/4\n"
+"  scale = 1.5*z + length(a) - scale(a);\n"
+"  for (i=1; 1; i++) {\n"
+"    e =  e * s / i / (n+i);\n"
+"    if (e == 0) {\n"
+"       ibase = b;\n"
+"       scale = z;\n"
+"       if (m) return (-a*v);\n"
+"       return (a*v);\n"
+"    }\n"
+"    v += e;\n"
+"  }\n"
+"}\n";
+
+static BcNode *parse_expr(BcParser *p);
+
+static BcNode *parse_statement(BcParser *p);
+
+static BcNum *eval(GebrBc *bc, BcNode *node);
+
+static BcFlow exec(GebrBc *bc, BcNode *node);
+
+/* Numbers {{{1 */
+static BcNum *
+num_new(gint len, gint scale)
+{
+	BcNum *n = g_new(BcNum, 1);
+	n->neg = FALSE;
+	n->len = MAX(len, 1);
+	n->scale = scale;
+	n->d = g_malloc0(n->len + scale);
+	return n;
+}
+
+static void
+num_free(BcNum *n)
+{
+	if (!n)
+		return;
+	g_free(n->d);
+	g_free(n);
+}
+
+static BcNum *
+num_copy(const BcNum *n)
+{
+	BcNum *copy = g_new(BcNum, 1);
+	*copy = *n;
+	copy->d = g_memdup(n->d, n->len + n->scale);
+	return copy;
+}
+
+static BcNum *
+num_from_long(glong value)
+{
+	gchar buf[32];
+	gint len = 0;
+	gulong abs = value < 0 ? -(gulong)value : (gulong)value;
+
+	do {
+		buf[len++] = abs % 10;
+		abs /= 10;
+	} while (abs);
+
+	BcNum *n = num_new(len, 0);
+	for (gint i = 0; i < len; i++)
+		n->d[i] = buf[len - 1 - i];
+	n->neg = value < 0;
+	return n;
+}
+
+/*
+ * Converts the integer part of @n, returning zero on overflow like bc does.
+ */
+static glong
+num_to_long(const BcNum *n)
+{
+	gulong value = 0;
+	gint i;
+
+	for (i = 0; i < n->len && value <= G_MAXLONG / 10; i++)
+		value = value * 10 + n->d[i];
+	if (i < n->len || value > G_MAXLONG)
+		return 0;
+
+	return n->neg ? -(glong) value : (glong) value;
+}
+
+static gboolean
+num_is_zero(const BcNum *n)
+{
+	for (gint i = 0; i < n->len + n->scale; i++)
+		if (n->d[i])
+			return FALSE;
+	return TRUE;
+}
+
+static void
+num_rm_leading_zeros(BcNum *n)
+{
+	gint zeros = 0;
+
+	while (zeros < n->len - 1 && n->d[zeros] == 0)
+		zeros++;
+
+	if (zeros) {
+		memmove(n->d, n->d + zeros, n->len + n->scale - zeros);
+		n->len -= zeros;
+	}
+}
+
+/*
+ * Returns the digit of @n multiplying 10^@pos.
+ */
+static inline gint
+num_digit(const BcNum *n, gint pos)
+{
+	gint i = n->len - 1 - pos;
+	return (i >= 0 && i < n->len + n->scale) ? n->d[i] : 0;
+}
+
+/*
+ * Compares @n1 and @n2, optionally ignoring their signs. When @ignore_last
+ * is %TRUE, numbers with the same scale differing only on the last digit are
+ * considered equal.
+ */
+static gint
+num_do_compare(const BcNum *n1, const BcNum *n2, gboolean use_sign, gboolean ignore_last)
+{
+	const guchar *p1, *p2;
+	gint count;
+	gint greater = (!use_sign || !n1->neg) ? 1 : -1;
+
+	if (use_sign && n1->neg != n2->neg)
+		return n1->neg ? -1 : 1;
+
+	if (n1->len != n2->len)
+		return n1->len > n2->len ? greater : -greater;
+
+	count = n1->len + MIN(n1->scale, n2->scale);
+	p1 = n1->d;
+	p2 = n2->d;
+	while (count > 0 && *p1 == *p2) {
+		p1++;
+		p2++;
+		count--;
+	}
+
+	if (ignore_last && count == 1 && n1->scale == n2->scale)
+		return 0;
+
+	if (count)
+		return *p1 > *p2 ? greater : -greater;
+
+	if (n1->scale > n2->scale) {
+		for (count = n1->scale - n2->scale; count > 0; count--)
+			if (*p1++)
+				return greater;
+	} else {
+		for (count = n2->scale - n1->scale; count > 0; count--)
+			if (*p2++)
+				return -greater;
+	}
+
+	return 0;
+}
+
+static BcNum *
+num_do_add(const BcNum *n1, const BcNum *n2, gint scale_min)
+{
+	gint scale = MAX(n1->scale, n2->scale);
+	gint len = MAX(n1->len, n2->len) + 1;
+	BcNum *sum = num_new(len, MAX(scale, scale_min));
+	gint carry = 0;
+
+	for (gint pos = -scale; pos < len; pos++) {
+		gint digit = num_digit(n1, pos) + num_digit(n2, pos) + carry;
+		carry = digit >= 10;
+		sum->d[len - 1 - pos] = carry ? digit - 10 : digit;
+	}
+
+	num_rm_leading_zeros(sum);
+	return sum;
+}
+
+/*
+ * Subtracts the magnitude of @n2 from the magnitude of @n1, which must be
+ * greater.
+ */
+static BcNum *
+num_do_sub(const BcNum *n1, const BcNum *n2, gint scale_min)
+{
+	gint scale = MAX(n1->scale, n2->scale);
+	gint len = MAX(n1->len, n2->len);
+	BcNum *diff = num_new(len, MAX(scale, scale_min));
+	gint borrow = 0;
+
+	for (gint pos = -scale; pos < len; pos++) {
+		gint digit = num_digit(n1, pos) - num_digit(n2, pos) - borrow;
+		borrow = digit < 0;
+		diff->d[len - 1 - pos] = borrow ? digit + 10 : digit;
+	}
+
+	num_rm_leading_zeros(diff);
+	return diff;
+}
+
+static BcNum *
+num_add_signed(const BcNum *n1, const BcNum *n2, gboolean n2_neg, gint scale_min)
+{
+	BcNum *sum;
+
+	if (n1->neg == n2_neg) {
+		sum = num_do_add(n1, n2, scale_min);
+		sum->neg = n1->neg;
+		return sum;
+	}
+
+	switch (num_do_compare(n1, n2, FALSE, FALSE)) {
+	case -1:
+		sum = num_do_sub(n2, n1, scale_min);
+		sum->neg = n2_neg;
+		return sum;
+	case 1:
+		sum = num_do_sub(n1, n2, scale_min);
+		sum->neg = n1->neg;
+		return sum;
+	default:
+		return num_new(1, MAX(scale_min, MAX(n1->scale, n2->scale)));
+	}
+}
+
+static BcNum *
+num_add(const BcNum *n1, const BcNum *n2, gint scale_min)
+{
+	return num_add_signed(n1, n2, n2->neg, scale_min);
+}
+
+static BcNum *
+num_sub(const BcNum *n1, const BcNum *n2, gint scale_min)
+{
+	return num_add_signed(n1, n2, !n2->neg, scale_min);
+}
+
+static BcNum *
+num_multiply(const BcNum *n1, const BcNum *n2, gint scale)
+{
+	gint len1 = n1->len + n1->scale;
+	gint len2 = n2->len + n2->scale;
+	gint full_scale = n1->scale + n2->scale;
+	gint prod_scale = MIN(full_scale, MAX(scale, MAX(n1->scale, n2->scale)));
+	guint64 *acc = g_new0(guint64, len1 + len2);
+	BcNum *prod;
+
+	for (gint i = 0; i < len1; i++) {
+		if (!n1->d[i])
+			continue;
+		for (gint j = 0; j < len2; j++)
+			acc[i + j + 1] += n1->d[i] * n2->d[j];
+	}
+	for (gint k = len1 + len2 - 1; k > 0; k--) {
+		acc[k - 1] += acc[k] / 10;
+		acc[k] %= 10;
+	}
+
+	prod = num_new(len1 + len2 - full_scale, full_scale);
+	for (gint k = 0; k < len1 + len2; k++)
+		prod->d[k] = acc[k];
+	g_free(acc);
+
+	prod->scale = prod_scale;
+	prod->neg = n1->neg != n2->neg;
+	num_rm_leading_zeros(prod);
+	if (num_is_zero(prod))
+		prod->neg = FALSE;
+
+	return prod;
+}
+
+/*
+ * Long division of the integer @num by the integer @den, which must not
+ * have leading zeros. Quotient digits are written to @quot, that must be
+ * @nlen digits long.
+ */
+static void
+digits_divide(const guchar *num, gint nlen, const guchar *den, gint dlen, guchar *quot)
+{
+	guchar *rem = g_malloc0(dlen + 1);
+
+	for (gint i = 0; i < nlen; i++) {
+		guchar q = 0;
+
+		memmove(rem, rem + 1, dlen);
+		rem[dlen] = num[i];
+
+		while (rem[0] || memcmp(rem + 1, den, dlen) >= 0) {
+			gint borrow = 0;
+			for (gint k = dlen; k >= 0; k--) {
+				gint digit = rem[k] - (k ? den[k - 1] : 0) - borrow;
+				borrow = digit < 0;
+				rem[k] = borrow ? digit + 10 : digit;
+			}
+			q++;
+		}
+		quot[i] = q;
+	}
+
+	g_free(rem);
+}
+
+/*
+ * Returns @n1 / @n2 truncated to @scale digits, or %NULL if @n2 is zero.
+ */
+static BcNum *
+num_divide(const BcNum *n1, const BcNum *n2, gint scale)
+{
+	const guchar *den = n2->d;
+	gint dlen = n2->len + n2->scale;
+	gint alen = n1->len + n1->scale;
+	gint shift, nlen;
+	guchar *num, *quot, *big_den = NULL;
+	BcNum *q;
+
+	if (num_is_zero(n2))
+		return NULL;
+
+	/* Division by one just truncates, keeping the sign even for zero */
+	if (n2->scale == 0 && n2->len == 1 && n2->d[0] == 1) {
+		q = num_new(n1->len, scale);
+		q->neg = n1->neg != n2->neg;
+		memcpy(q->d, n1->d, n1->len + MIN(n1->scale, scale));
+		return q;
+	}
+
+	while (dlen > 1 && *den == 0) {
+		den++;
+		dlen--;
+	}
+
+	/* With |n1| = A/10^s1 and |n2| = B/10^s2 the quotient digits are
+	 * A * 10^(s2 + scale - s1) / B */
+	shift = n2->scale + scale - n1->scale;
+	if (shift >= 0) {
+		nlen = alen + shift;
+		num = g_malloc0(nlen);
+		memcpy(num, n1->d, alen);
+	} else {
+		nlen = alen;
+		num = g_memdup(n1->d, alen);
+		big_den = g_malloc0(dlen - shift);
+		memcpy(big_den, den, dlen);
+		den = big_den;
+		dlen -= shift;
+	}
+
+	quot = g_malloc(nlen);
+	digits_divide(num, nlen, den, dlen, quot);
+
+	q = num_new(nlen - scale, scale);
+	memcpy(q->d + q->len + scale - nlen, quot, nlen);
+	q->neg = n1->neg != n2->neg;
+	num_rm_leading_zeros(q);
+	if (num_is_zero(q))
+		q->neg = FALSE;
+
+	g_free(num);
+	g_free(quot);
+	g_free(big_den);
+	return q;
+}
+
+/*
+ * Returns n1 - (n1 / n2) * n2, where the division is truncated to @scale
+ * digits, or %NULL if @n2 is zero.
+ */
+static BcNum *
+num_modulo(const BcNum *n1, const BcNum *n2, gint scale)
+{
+	gint rscale = MAX(n1->scale, n2->scale + scale);
+	BcNum *quot, *temp, *rem;
+
+	quot = num_divide(n1, n2, scale);
+	if (!quot)
+		return NULL;
+
+	temp = num_multiply(quot, n2, rscale);
+	rem = num_sub(n1, temp, rscale);
+	num_free(quot);
+	num_free(temp);
+	return rem;
+}
+
+static BcNum *
+num_square(BcNum *n, gint scale)
+{
+	BcNum *sq = num_multiply(n, n, scale);
+	num_free(n);
+	return sq;
+}
+
+static BcNum *
+num_raise(GebrBc *bc, const BcNum *n1, const BcNum *n2)
+{
+	glong exponent = num_to_long(n2);
+	gint64 rscale;
+	gint pwrscale, calcscale;
+	gboolean neg;
+	BcNum *power, *temp;
+
+	if (exponent == 0) {
+		if (n2->len > 1 || n2->d[0]) {
+			g_set_error(&bc->error, GEBR_BC_ERROR, GEBR_BC_ERROR_RUNTIME,
+				    "exponent too large in raise");
+			return NULL;
+		}
+		return num_from_long(1);
+	}
+
+	neg = exponent < 0;
+	if (neg)
+		exponent = -exponent;
+
+	/* bc would happily try to compute those, hanging the caller */
+	if ((gint64) (n1->len - (n1->d[0] <= 1)) * exponent > BC_MAX_DIGITS
+	    || (gint64) n1->scale * exponent > BC_MAX_DIGITS) {
+		g_set_error(&bc->error, GEBR_BC_ERROR, GEBR_BC_ERROR_RUNTIME,
+			    "exponent too large in raise");
+		return NULL;
+	}
+
+	if (neg)
+		rscale = bc->scale;
+	else
+		rscale = MIN((gint64) n1->scale * exponent, MAX(bc->scale, n1->scale));
+
+	power = num_copy(n1);
+	pwrscale = n1->scale;
+	while ((exponent & 1) == 0) {
+		pwrscale = 2 * pwrscale;
+		power = num_square(power, pwrscale);
+		exponent >>= 1;
+	}
+
+	temp = num_copy(power);
+	calcscale = pwrscale;
+	exponent >>= 1;
+
+	while (exponent > 0) {
+		pwrscale = 2 * pwrscale;
+		power = num_square(power, pwrscale);
+		if (exponent & 1) {
+			BcNum *prod;
+			calcscale = pwrscale + calcscale;
+			prod = num_multiply(temp, power, calcscale);
+			num_free(temp);
+			temp = prod;
+		}
+		exponent >>= 1;
+	}
+	num_free(power);
+
+	if (neg) {
+		BcNum *one = num_from_long(1);
+		BcNum *inv = num_divide(one, temp, rscale);
+		num_free(one);
+		num_free(temp);
+		if (!inv)
+			g_set_error(&bc->error, GEBR_BC_ERROR, GEBR_BC_ERROR_RUNTIME,
+				    "divide by zero");
+		return inv;
+	}
+
+	if (temp->scale > rscale)
+		temp->scale = rscale;
+	return temp;
+}
+
+/*
+ * Newton's method exactly as implemented by GNU bc, so the last digit
+ * matches even when the iteration stops one unit away from the truncated
+ * root. Returns %NULL for negative numbers.
+ */
+static BcNum *
+num_sqrt(GebrBc *bc, const BcNum *n)
+{
+	BcNum *zero = num_new(1, 0);
+	BcNum *one = num_from_long(1);
+	BcNum *point5 = num_new(1, 1);
+	BcNum *guess, *guess1 = NULL, *temp, *result;
+	gint cmp, rscale, cscale;
+	gboolean done = FALSE;
+
+	point5->d[1] = 5;
+
+	cmp = num_do_compare(n, zero, TRUE, FALSE);
+	if (cmp <= 0) {
+		result = cmp < 0 ? NULL : num_new(1, 0);
+		goto out;
+	}
+
+	cmp = num_do_compare(n, one, TRUE, FALSE);
+	if (cmp == 0) {
+		result = num_from_long(1);
+		goto out;
+	}
+
+	rscale = MAX(bc->scale, n->scale);
+	if (cmp < 0) {
+		guess = num_from_long(1);
+		cscale = n->scale;
+	} else {
+		BcNum *ten = num_from_long(10);
+		BcNum *len = num_from_long(n->len);
+		BcNum *half = num_multiply(len, point5, 0);
+		gint saved = bc->scale;
+
+		half->scale = 0;
+		bc->scale = 0;
+		guess = num_raise(bc, ten, half);
+		bc->scale = saved;
+		cscale = 3;
+
+		num_free(ten);
+		num_free(len);
+		num_free(half);
+	}
+
+	while (!done) {
+		num_free(guess1);
+		guess1 = num_copy(guess);
+
+		temp = num_divide(n, guess, cscale);
+		num_free(guess);
+		guess = num_add(temp, guess1, 0);
+		num_free(temp);
+		temp = num_multiply(guess, point5, cscale);
+		num_free(guess);
+		guess = temp;
+
+		if (num_do_compare(guess, guess1, FALSE, TRUE) == 0) {
+			if (cscale < rscale + 1)
+				cscale = MIN(cscale * 3, rscale + 1);
+			else
+				done = TRUE;
+		}
+	}
+
+	result = num_divide(guess, one, rscale);
+	num_free(guess);
+	num_free(guess1);
+
+out:
+	num_free(zero);
+	num_free(one);
+	num_free(point5);
+	return result;
+}
+
+static inline gint
+digit_value(gchar c)
+{
+	return g_ascii_isdigit(c) ? c - '0' : c - 'A' + 10;
+}
+
+/*
+ * Converts a number literal like bc does for ibase=10: leading zeros are
+ * dropped, every typed fractional digit counts for the scale, a single
+ * letter digit keeps its value and letters in longer numbers count as 9.
+ */
+static BcNum *
+num_from_literal(const gchar *str, gsize size)
+{
+	const gchar *end = str + size;
+	const gchar *point;
+	gint digits, scale;
+	BcNum *n;
+
+	if (size == 1 && !g_ascii_isdigit(*str))
+		return num_from_long(digit_value(*str));
+
+	while (str < end && *str == '0')
+		str++;
+
+	point = memchr(str, '.', end - str);
+	digits = point ? point - str : end - str;
+	scale = point ? end - point - 1 : 0;
+
+	n = num_new(digits, scale);
+	for (gint i = 0; i < digits; i++)
+		n->d[i] = MIN(digit_value(str[i]), 9);
+	for (gint i = 0; i < scale; i++)
+		n->d[n->len + i] = MIN(digit_value(point[i + 1]), 9);
+
+	return n;
+}
+
+static void
+num_print(const BcNum *n, GString *out)
+{
+	const guchar *p = n->d;
+
+	if (n->neg)
+		g_string_append_c(out, '-');
+
+	if (num_is_zero(n)) {
+		g_string_append_c(out, '0');
+		return;
+	}
+
+	if (n->len > 1 || *p)
+		for (gint i = 0; i < n->len; i++)
+			g_string_append_c(out, '0' + *p++);
+	else
+		p++;
+
+	if (n->scale > 0) {
+		g_string_append_c(out, '.');
+		for (gint i = 0; i < n->scale; i++)
+			g_string_append_c(out, '0' + *p++);
+	}
+}
+
+/* Symbols {{{1 */
+static BcVar *
+get_var(GebrBc *bc, const gchar *name, gsize len)
+{
+	gchar *key = g_strndup(name, len);
+	BcVar *var = g_hash_table_lookup(bc->vars, key);
+
+	if (!var) {
+		var = g_new0(BcVar, 1);
+		g_hash_table_insert(bc->vars, key, var);
+	} else
+		g_free(key);
+
+	return var;
+}
+
+static BcArray *
+get_array(GebrBc *bc, const gchar *name, gsize len)
+{
+	gchar *key = g_strndup(name, len);
+	BcArray *array = g_hash_table_lookup(bc->arrays, key);
+
+	if (!array) {
+		array = g_new0(BcArray, 1);
+		array->values = g_ptr_array_new_with_free_func((GDestroyNotify) num_free);
+		g_hash_table_insert(bc->arrays, key, array);
+	} else
+		g_free(key);
+
+	return array;
+}
+
+static BcFunc *
+get_func(GebrBc *bc, const gchar *name, gsize len)
+{
+	gchar *key = g_strndup(name, len);
+	BcFunc *func = g_hash_table_lookup(bc->funcs, key);
+
+	if (!func) {
+		func = g_new0(BcFunc, 1);
+		func->name = g_strdup(key);
+		g_hash_table_insert(bc->funcs, key, func);
+	} else
+		g_free(key);
+
+	return func;
+}
+
+static void
+var_free(BcVar *var)
+{
+	num_free(var->value);
+	g_slist_foreach(var->saved, (GFunc) num_free, NULL);
+	g_slist_free(var->saved);
+	g_free(var);
+}
+
+static void
+array_free(BcArray *array)
+{
+	g_ptr_array_unref(array->values);
+	g_slist_foreach(array->saved, (GFunc) g_ptr_array_unref, NULL);
+	g_slist_free(array->saved);
+	g_free(array);
+}
+
+static void node_free(BcNode *node);
+
+static void
+func_clear(BcFunc *func)
+{
+	if (func->params)
+		g_ptr_array_unref(func->params);
+	if (func->autos)
+		g_ptr_array_unref(func->autos);
+	node_free(func->body);
+	func->params = NULL;
+	func->autos = NULL;
+	func->body = NULL;
+	func->defined = FALSE;
+}
+
+static void
+func_free(BcFunc *func)
+{
+	func_clear(func);
+	g_free(func->name);
+	g_free(func);
+}
+
+/* Syntax tree {{{1 */
+static BcNode *
+node_new(BcNodeType type)
+{
+	BcNode *node = g_new0(BcNode, 1);
+	node->type = type;
+	return node;
+}
+
+static BcNode *
+node_new_with_children(BcNodeType type, gchar op, BcNode *a, BcNode *b)
+{
+	BcNode *node = node_new(type);
+	node->op = op;
+	node->a = a;
+	node->b = b;
+	return node;
+}
+
+static void
+node_free(BcNode *node)
+{
+	if (!node)
+		return;
+
+	num_free(node->num);
+	g_free(node->str);
+	node_free(node->a);
+	node_free(node->b);
+	node_free(node->c);
+	node_free(node->d);
+	if (node->list)
+		g_ptr_array_unref(node->list);
+	g_free(node);
+}
+
+static GPtrArray *
+node_list_new(void)
+{
+	return g_ptr_array_new_with_free_func((GDestroyNotify) node_free);
+}
+
+static gboolean
+node_is_named(BcNode *node)
+{
+	if (node->paren)
+		return FALSE;
+
+	switch (node->type) {
+	case BC_NODE_VAR:
+	case BC_NODE_ARRAY:
+	case BC_NODE_SCALE:
+	case BC_NODE_IBASE:
+	case BC_NODE_OBASE:
+	case BC_NODE_LAST:
+		return TRUE;
+	default:
+		return FALSE;
+	}
+}
+
+/* Lexer {{{1 */
+static void
+lex_error(BcParser *p, const gchar *format, ...) G_GNUC_PRINTF(2, 3);
+
+static void
+lex_error(BcParser *p, const gchar *format, ...)
+{
+	va_list args;
+	gchar *msg;
+
+	if (!p->error) {
+		va_start(args, format);
+		msg = g_strdup_vprintf(format, args);
+		va_end(args);
+		g_set_error_literal(&p->error, GEBR_BC_ERROR, GEBR_BC_ERROR_SYNTAX, msg);
+		g_free(msg);
+	}
+	p->token = TOK_ERROR;
+}
+
+static void
+syntax_error(BcParser *p)
+{
+	lex_error(p, "syntax error");
+}
+
+static void
+next_token(BcParser *p)
+{
+	const gchar *s;
+
+	if (p->token == TOK_ERROR)
+		return;
+
+	/* Skip blanks, comments and escaped new lines */
+	for (;;) {
+		if (*p->p == ' ' || *p->p == '\t' || *p->p == '\r')
+			p->p++;
+		else if (*p->p == '\\' && p->p[1] == '\n') {
+			p->p += 2;
+			p->line++;
+		} else if (*p->p == '#') {
+			while (*p->p && *p->p != '\n')
+				p->p++;
+		} else if (*p->p == '/' && p->p[1] == '*') {
+			const gchar *end = strstr(p->p + 2, "*/");
+			if (!end) {
+				lex_error(p, "EOF encountered in a comment.");
+				return;
+			}
+			for (s = p->p; s < end; s++)
+				if (*s == '\n')
+					p->line++;
+			p->p = end + 2;
+		} else
+			break;
+	}
+
+	s = p->start = p->p;
+	p->op = 0;
+
+	if (!*s) {
+		p->token = TOK_EOF;
+		p->len = 0;
+		return;
+	}
+
+	if (*s == '\n') {
+		p->token = TOK_NEWLINE;
+		p->line++;
+		p->p++;
+		p->len = 1;
+		return;
+	}
+
+	/* Numbers, where a lonely dot stands for `last' */
+	if (g_ascii_isdigit(*s) || (*s >= 'A' && *s <= 'F') || *s == '.') {
+		while (g_ascii_isdigit(*s) || (*s >= 'A' && *s <= 'F'))
+			s++;
+		if (*s == '.') {
+			s++;
+			while (g_ascii_isdigit(*s) || (*s >= 'A' && *s <= 'F'))
+				s++;
+		}
+		p->token = (s - p->start == 1 && *p->start == '.') ? TOK_LAST : TOK_NUMBER;
+		p->len = s - p->start;
+		p->p = s;
+		return;
+	}
+
+	if (g_ascii_islower(*s)) {
+		while (g_ascii_islower(*s) || g_ascii_isdigit(*s) || *s == '_')
+			s++;
+		p->len = s - p->start;
+		p->p = s;
+		p->token = TOK_NAME;
+		for (gint i = 0; keywords[i].word; i++) {
+			if (strlen(keywords[i].word) == p->len
+			    && strncmp(keywords[i].word, p->start, p->len) == 0) {
+				p->token = keywords[i].token;
+				break;
+			}
+		}
+		return;
+	}
+
+	if (*s == '"') {
+		const gchar *end = strchr(s + 1, '"');
+		if (!end) {
+			lex_error(p, "EOF encountered in a string.");
+			return;
+		}
+		for (const gchar *c = s + 1; c < end; c++)
+			if (*c == '\n')
+				p->line++;
+		p->token = TOK_STRING;
+		p->start = s + 1;
+		p->len = end - s - 1;
+		p->p = end + 1;
+		return;
+	}
+
+	p->len = 2;
+	p->p += 2;
+	switch (*s) {
+	case '+':
+	case '-':
+		if (s[1] == *s) {
+			p->token = *s == '+' ? TOK_INCR : TOK_DECR;
+			return;
+		}
+		/* fall through */
+	case '*':
+	case '/':
+	case '%':
+	case '^':
+		if (s[1] == '=') {
+			p->token = TOK_ASSIGN;
+			p->op = *s;
+			return;
+		}
+		p->token = *s;
+		break;
+	case '=':
+		if (s[1] == '=') {
+			p->token = TOK_REL;
+			p->op = 'e';
+			return;
+		}
+		p->token = TOK_ASSIGN;
+		p->op = '=';
+		break;
+	case '!':
+		if (s[1] == '=') {
+			p->token = TOK_REL;
+			p->op = 'n';
+			return;
+		}
+		p->token = '!';
+		break;
+	case '<':
+	case '>':
+		p->token = TOK_REL;
+		if (s[1] == '=') {
+			p->op = *s == '<' ? 'l' : 'g';
+			return;
+		}
+		p->op = *s;
+		break;
+	case '&':
+	case '|':
+		if (s[1] == *s) {
+			p->token = *s == '&' ? TOK_AND : TOK_OR;
+			return;
+		}
+		lex_error(p, "illegal character: %c", *s);
+		return;
+	case '(': case ')': case '[': case ']':
+	case '{': case '}': case ',': case ';':
+		p->token = *s;
+		break;
+	default:
+		lex_error(p, "illegal character: %c", *s);
+		return;
+	}
+
+	p->len = 1;
+	p->p = s + 1;
+}
+
+static gboolean
+expect(BcParser *p, gint token)
+{
+	if (p->token != token) {
+		syntax_error(p);
+		return FALSE;
+	}
+	next_token(p);
+	return TRUE;
+}
+
+static void
+skip_newline(BcParser *p)
+{
+	if (p->token == TOK_NEWLINE)
+		next_token(p);
+}
+
+/* Parser {{{1 */
+static gboolean
+starts_expr(gint token)
+{
+	switch (token) {
+	case TOK_NUMBER:
+	case TOK_NAME:
+	case TOK_INCR:
+	case TOK_DECR:
+	case TOK_SCALE:
+	case TOK_IBASE:
+	case TOK_OBASE:
+	case TOK_LAST:
+	case TOK_LENGTH:
+	case TOK_SQRT:
+	case TOK_READ:
+	case '(':
+	case '-':
+	case '!':
+		return TRUE;
+	default:
+		return FALSE;
+	}
+}
+
+static BcNode *
+parse_call(BcParser *p, const gchar *name, gsize len)
+{
+	BcNode *node = node_new(BC_NODE_CALL);
+
+	node->slot = get_func(p->bc, name, len);
+	node->list = node_list_new();
+
+	next_token(p);
+	if (p->token != ')') {
+		for (;;) {
+			BcNode *arg = parse_expr(p);
+			if (!arg)
+				goto error;
+			g_ptr_array_add(node->list, arg);
+			if (p->token != ',')
+				break;
+			next_token(p);
+		}
+	}
+	if (expect(p, ')'))
+		return node;
+
+error:
+	node_free(node);
+	return NULL;
+}
+
+static BcNode *
+parse_builtin(BcParser *p, BcNodeType type)
+{
+	BcNode *node;
+
+	next_token(p);
+	if (!expect(p, '('))
+		return NULL;
+
+	node = node_new(type);
+	node->a = parse_expr(p);
+	if (!node->a || !expect(p, ')')) {
+		node_free(node);
+		return NULL;
+	}
+	return node;
+}
+
+static BcNode *
+parse_primary(BcParser *p)
+{
+	BcNode *node;
+	const gchar *name;
+	gsize len;
+
+	switch (p->token) {
+	case TOK_NUMBER:
+		node = node_new(BC_NODE_NUMBER);
+		node->num = num_from_literal(p->start, p->len);
+		next_token(p);
+		return node;
+	case '(':
+		next_token(p);
+		node = parse_expr(p);
+		if (!node)
+			return NULL;
+		if (!expect(p, ')')) {
+			node_free(node);
+			return NULL;
+		}
+		node->paren = TRUE;
+		return node;
+	case TOK_NAME:
+		name = p->start;
+		len = p->len;
+		next_token(p);
+		if (p->token == '(')
+			return parse_call(p, name, len);
+		if (p->token != '[') {
+			node = node_new(BC_NODE_VAR);
+			node->slot = get_var(p->bc, name, len);
+			return node;
+		}
+		next_token(p);
+		node = node_new(BC_NODE_ARRAY);
+		node->slot = get_array(p->bc, name, len);
+		node->a = parse_expr(p);
+		if (!node->a || !expect(p, ']')) {
+			node_free(node);
+			return NULL;
+		}
+		return node;
+	case TOK_SCALE:
+		next_token(p);
+		if (p->token != '(')
+			return node_new(BC_NODE_SCALE);
+		next_token(p);
+		node = node_new(BC_NODE_SCALE_OF);
+		node->a = parse_expr(p);
+		if (!node->a || !expect(p, ')')) {
+			node_free(node);
+			return NULL;
+		}
+		return node;
+	case TOK_IBASE:
+		next_token(p);
+		return node_new(BC_NODE_IBASE);
+	case TOK_OBASE:
+		next_token(p);
+		return node_new(BC_NODE_OBASE);
+	case TOK_LAST:
+		next_token(p);
+		return node_new(BC_NODE_LAST);
+	case TOK_LENGTH:
+		return parse_builtin(p, BC_NODE_LENGTH);
+	case TOK_SQRT:
+		return parse_builtin(p, BC_NODE_SQRT);
+	case TOK_READ:
+		lex_error(p, "read is not supported");
+		return NULL;
+	default:
+		syntax_error(p);
+		return NULL;
+	}
+}
+
+static BcNode *parse_not(BcParser *p);
+
+static BcNode *
+parse_unary(BcParser *p)
+{
+	BcNode *node;
+
+	switch (p->token) {
+	case '-':
+		next_token(p);
+		node = parse_unary(p);
+		return node ? node_new_with_children(BC_NODE_NEGATE, 0, node, NULL) : NULL;
+	case '!':
+		next_token(p);
+		node = parse_not(p);
+		return node ? node_new_with_children(BC_NODE_NOT, 0, node, NULL) : NULL;
+	case TOK_INCR:
+	case TOK_DECR: {
+		BcNodeType type = p->token == TOK_INCR ? BC_NODE_PRE_INCR : BC_NODE_PRE_DECR;
+		next_token(p);
+		node = parse_primary(p);
+		if (!node)
+			return NULL;
+		if (!node_is_named(node)) {
+			node_free(node);
+			syntax_error(p);
+			return NULL;
+		}
+		return node_new_with_children(type, 0, node, NULL);
+	} default:
+		node = parse_primary(p);
+		if (node && node_is_named(node) && (p->token == TOK_INCR || p->token == TOK_DECR)) {
+			BcNodeType type = p->token == TOK_INCR ? BC_NODE_POST_INCR : BC_NODE_POST_DECR;
+			next_token(p);
+			return node_new_with_children(type, 0, node, NULL);
+		}
+		return node;
+	}
+}
+
+static BcNode *
+parse_power(BcParser *p)
+{
+	BcNode *base, *exponent;
+
+	base = parse_unary(p);
+	if (!base || p->token != '^')
+		return base;
+
+	next_token(p);
+	exponent = parse_power(p);
+	if (!exponent) {
+		node_free(base);
+		return NULL;
+	}
+	return node_new_with_children(BC_NODE_BINARY, '^', base, exponent);
+}
+
+static BcNode *
+parse_multiplicative(BcParser *p)
+{
+	BcNode *left, *right;
+
+	left = parse_power(p);
+	while (left && (p->token == '*' || p->token == '/' || p->token == '%')) {
+		gchar op = p->token;
+		next_token(p);
+		right = parse_power(p);
+		if (!right) {
+			node_free(left);
+			return NULL;
+		}
+		left = node_new_with_children(BC_NODE_BINARY, op, left, right);
+	}
+	return left;
+}
+
+static BcNode *
+parse_additive(BcParser *p)
+{
+	BcNode *left, *right;
+
+	left = parse_multiplicative(p);
+	while (left && (p->token == '+' || p->token == '-')) {
+		gchar op = p->token;
+		next_token(p);
+		right = parse_multiplicative(p);
+		if (!right) {
+			node_free(left);
+			return NULL;
+		}
+		left = node_new_with_children(BC_NODE_BINARY, op, left, right);
+	}
+	return left;
+}
+
+/*
+ * Assignments bind tighter than relations in bc, so `a = b < c' compares
+ * the assigned value with c.
+ */
+static BcNode *
+parse_assign(BcParser *p)
+{
+	BcNode *left, *right;
+	gchar op;
+
+	left = parse_additive(p);
+	if (!left || p->token != TOK_ASSIGN)
+		return left;
+
+	if (!node_is_named(left)) {
+		node_free(left);
+		syntax_error(p);
+		return NULL;
+	}
+
+	op = p->op;
+	next_token(p);
+	right = parse_assign(p);
+	if (!right) {
+		node_free(left);
+		return NULL;
+	}
+	return node_new_with_children(BC_NODE_ASSIGN, op, left, right);
+}
+
+static BcNode *
+parse_relation(BcParser *p)
+{
+	BcNode *left, *right;
+
+	left = parse_assign(p);
+	while (left && p->token == TOK_REL) {
+		gchar op = p->op;
+		next_token(p);
+		right = parse_assign(p);
+		if (!right) {
+			node_free(left);
+			return NULL;
+		}
+		left = node_new_with_children(BC_NODE_RELATION, op, left, right);
+	}
+	return left;
+}
+
+static BcNode *
+parse_not(BcParser *p)
+{
+	BcNode *node;
+
+	if (p->token != '!')
+		return parse_relation(p);
+
+	next_token(p);
+	node = parse_not(p);
+	return node ? node_new_with_children(BC_NODE_NOT, 0, node, NULL) : NULL;
+}
+
+static BcNode *
+parse_and(BcParser *p)
+{
+	BcNode *left, *right;
+
+	left = parse_not(p);
+	while (left && p->token == TOK_AND) {
+		next_token(p);
+		right = parse_not(p);
+		if (!right) {
+			node_free(left);
+			return NULL;
+		}
+		left = node_new_with_children(BC_NODE_AND, 0, left, right);
+	}
+	return left;
+}
+
+static BcNode *
+parse_expr(BcParser *p)
+{
+	BcNode *left, *right;
+
+	left = parse_and(p);
+	while (left && p->token == TOK_OR) {
+		next_token(p);
+		right = parse_and(p);
+		if (!right) {
+			node_free(left);
+			return NULL;
+		}
+		left = node_new_with_children(BC_NODE_OR, 0, left, right);
+	}
+	return left;
+}
+
+static gboolean
+is_statement_end(gint token)
+{
+	return token == ';' || token == TOK_NEWLINE || token == '}'
+		|| token == TOK_EOF || token == TOK_ELSE;
+}
+
+/*
+ * Parses statements separated by semicolons or new lines until a closing
+ * brace.
+ */
+static BcNode *
+parse_block(BcParser *p)
+{
+	BcNode *block = node_new(BC_NODE_BLOCK);
+
+	block->list = node_list_new();
+	while (p->token != '}') {
+		BcNode *stmt;
+
+		if (p->token == ';' || p->token == TOK_NEWLINE) {
+			next_token(p);
+			continue;
+		}
+		stmt = parse_statement(p);
+		if (!stmt)
+			goto error;
+		g_ptr_array_add(block->list, stmt);
+		if (p->token != ';' && p->token != TOK_NEWLINE && p->token != '}') {
+			syntax_error(p);
+			goto error;
+		}
+	}
+	next_token(p);
+	return block;
+
+error:
+	node_free(block);
+	return NULL;
+}
+
+static BcNode *
+parse_optional_expr(BcParser *p, gint end)
+{
+	if (p->token == end)
+		return NULL;
+	return parse_expr(p);
+}
+
+static BcNode *
+parse_statement(BcParser *p)
+{
+	BcNode *node = NULL;
+
+	switch (p->token) {
+	case '{':
+		next_token(p);
+		return parse_block(p);
+	case TOK_STRING:
+		node = node_new(BC_NODE_STRING);
+		node->str = g_strndup(p->start, p->len);
+		next_token(p);
+		return node;
+	case TOK_PRINT:
+		node = node_new(BC_NODE_PRINT);
+		node->list = node_list_new();
+		do {
+			BcNode *item;
+			next_token(p);
+			if (p->token == TOK_STRING) {
+				item = node_new(BC_NODE_STRING);
+				item->str = g_strndup(p->start, p->len);
+				next_token(p);
+			} else if (!(item = parse_expr(p)))
+				goto error;
+			g_ptr_array_add(node->list, item);
+		} while (p->token == ',');
+		return node;
+	case TOK_IF:
+		next_token(p);
+		node = node_new(BC_NODE_IF);
+		if (!expect(p, '(') || !(node->a = parse_expr(p)) || !expect(p, ')'))
+			goto error;
+		skip_newline(p);
+		if (!(node->b = parse_statement(p)))
+			goto error;
+		if (p->token == TOK_ELSE) {
+			next_token(p);
+			skip_newline(p);
+			if (!(node->c = parse_statement(p)))
+				goto error;
+		}
+		return node;
+	case TOK_WHILE:
+		next_token(p);
+		node = node_new(BC_NODE_WHILE);
+		if (!expect(p, '(') || !(node->a = parse_expr(p)) || !expect(p, ')'))
+			goto error;
+		skip_newline(p);
+		p->loops++;
+		node->b = parse_statement(p);
+		p->loops--;
+		if (!node->b)
+			goto error;
+		return node;
+	case TOK_FOR:
+		next_token(p);
+		node = node_new(BC_NODE_FOR);
+		if (!expect(p, '('))
+			goto error;
+		node->a = parse_optional_expr(p, ';');
+		if (p->error || !expect(p, ';'))
+			goto error;
+		node->b = parse_optional_expr(p, ';');
+		if (p->error || !expect(p, ';'))
+			goto error;
+		node->c = parse_optional_expr(p, ')');
+		if (p->error || !expect(p, ')'))
+			goto error;
+		skip_newline(p);
+		p->loops++;
+		node->d = parse_statement(p);
+		p->loops--;
+		if (!node->d)
+			goto error;
+		return node;
+	case TOK_BREAK:
+	case TOK_CONTINUE:
+		if (!p->loops) {
+			lex_error(p, p->token == TOK_BREAK ? "Break outside a for/while"
+				  : "Continue outside a for/while");
+			return NULL;
+		}
+		node = node_new(p->token == TOK_BREAK ? BC_NODE_BREAK : BC_NODE_CONTINUE);
+		next_token(p);
+		return node;
+	case TOK_RETURN:
+		if (!p->function) {
+			lex_error(p, "Return outside of a function.");
+			return NULL;
+		}
+		next_token(p);
+		node = node_new(BC_NODE_RETURN);
+		if (!is_statement_end(p->token) && !(node->a = parse_expr(p)))
+			goto error;
+		return node;
+	case TOK_QUIT:
+	case TOK_HALT:
+	case TOK_LIMITS:
+	case TOK_WARRANTY:
+		lex_error(p, "%.*s is not supported", (gint) p->len, p->start);
+		return NULL;
+	default:
+		if (!starts_expr(p->token)) {
+			syntax_error(p);
+			return NULL;
+		}
+		node = node_new(BC_NODE_EXPR_STMT);
+		if (!(node->a = parse_expr(p)))
+			goto error;
+		return node;
+	}
+
+error:
+	node_free(node);
+	return NULL;
+}
+
+static gboolean
+parse_locals(BcParser *p, GPtrArray *locals)
+{
+	while (p->token == TOK_NAME) {
+		BcLocal *local = g_new(BcLocal, 1);
+		const gchar *name = p->start;
+		gsize len = p->len;
+
+		next_token(p);
+		local->is_array = p->token == '[';
+		if (local->is_array) {
+			next_token(p);
+			if (!expect(p, ']')) {
+				g_free(local);
+				return FALSE;
+			}
+			local->slot = get_array(p->bc, name, len);
+		} else
+			local->slot = get_var(p->bc, name, len);
+		g_ptr_array_add(locals, local);
+
+		if (p->token != ',')
+			break;
+		next_token(p);
+		if (p->token != TOK_NAME) {
+			syntax_error(p);
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+static gboolean
+parse_function(BcParser *p)
+{
+	BcFunc *func;
+	GPtrArray *params = g_ptr_array_new_with_free_func(g_free);
+	GPtrArray *autos = g_ptr_array_new_with_free_func(g_free);
+	BcNode *body = NULL;
+	const gchar *name;
+	gsize len;
+
+	next_token(p);
+	if (p->token != TOK_NAME) {
+		syntax_error(p);
+		goto error;
+	}
+	name = p->start;
+	len = p->len;
+	next_token(p);
+
+	if (!expect(p, '(') || !parse_locals(p, params) || !expect(p, ')'))
+		goto error;
+
+	for (guint i = 0; i < params->len; i++) {
+		if (((BcLocal *) params->pdata[i])->is_array) {
+			lex_error(p, "Array parameters are not supported");
+			goto error;
+		}
+	}
+
+	skip_newline(p);
+	if (!expect(p, '{'))
+		goto error;
+	while (p->token == TOK_NEWLINE)
+		next_token(p);
+
+	if (p->token == TOK_AUTO) {
+		next_token(p);
+		if (!parse_locals(p, autos))
+			goto error;
+		if (p->token != ';' && p->token != TOK_NEWLINE) {
+			syntax_error(p);
+			goto error;
+		}
+		next_token(p);
+	}
+
+	func = get_func(p->bc, name, len);
+	p->function = func;
+	p->loops = 0;
+	body = parse_block(p);
+	p->function = NULL;
+	if (!body)
+		goto error;
+
+	func_clear(func);
+	func->params = params;
+	func->autos = autos;
+	func->body = body;
+	func->defined = TRUE;
+	return TRUE;
+
+error:
+	g_ptr_array_unref(params);
+	g_ptr_array_unref(autos);
+	return FALSE;
+}
+
+/*
+ * Parses the statements up to the end of the current line, which bc
+ * executes as soon as the line is complete.
+ */
+static GPtrArray *
+parse_line(BcParser *p)
+{
+	GPtrArray *stmts = node_list_new();
+
+	while (p->token != TOK_NEWLINE && p->token != TOK_EOF) {
+		BcNode *stmt;
+
+		if (p->token == ';') {
+			next_token(p);
+			continue;
+		}
+		stmt = parse_statement(p);
+		if (!stmt)
+			goto error;
+		g_ptr_array_add(stmts, stmt);
+		if (p->token != ';' && p->token != TOK_NEWLINE && p->token != TOK_EOF) {
+			syntax_error(p);
+			goto error;
+		}
+	}
+	return stmts;
+
+error:
+	g_ptr_array_unref(stmts);
+	return NULL;
+}
+
+/* Interpreter {{{1 */
+static void
+runtime_error(GebrBc *bc, const gchar *format, ...) G_GNUC_PRINTF(2, 3);
+
+static void
+runtime_error(GebrBc *bc, const gchar *format, ...)
+{
+	va_list args;
+	gchar *msg;
+
+	if (bc->error)
+		return;
+
+	va_start(args, format);
+	msg = g_strdup_vprintf(format, args);
+	va_end(args);
+	g_set_error_literal(&bc->error, GEBR_BC_ERROR, GEBR_BC_ERROR_RUNTIME, msg);
+	g_free(msg);
+}
+
+static const gchar *
+slot_name(GHashTable *table, gpointer slot)
+{
+	GHashTableIter iter;
+	gpointer key, value;
+
+	g_hash_table_iter_init(&iter, table);
+	while (g_hash_table_iter_next(&iter, &key, &value))
+		if (value == slot)
+			return key;
+	return "";
+}
+
+/*
+ * Evaluates the subscript of an array node, growing the array if needed.
+ * Returns -1 on error.
+ */
+static gint
+array_index(GebrBc *bc, BcNode *node)
+{
+	BcArray *array = node->slot;
+	BcNum *idx = eval(bc, node->a);
+	glong index;
+
+	if (!idx)
+		return -1;
+
+	index = num_to_long(idx);
+	num_free(idx);
+	if (index < 0 || index > BC_MAX_DIM) {
+		runtime_error(bc, "Array %s subscript out of bounds.",
+			      slot_name(bc->arrays, array));
+		return -1;
+	}
+
+	if (array->values->len <= index)
+		g_ptr_array_set_size(array->values, index + 1);
+
+	return index;
+}
+
+static BcNum *
+load(GebrBc *bc, BcNode *node, gint index)
+{
+	BcNum *value = NULL;
+
+	switch (node->type) {
+	case BC_NODE_VAR:
+		value = ((BcVar *) node->slot)->value;
+		break;
+	case BC_NODE_ARRAY:
+		value = ((BcArray *) node->slot)->values->pdata[index];
+		break;
+	case BC_NODE_SCALE:
+		return num_from_long(bc->scale);
+	case BC_NODE_IBASE:
+		return num_from_long(bc->ibase);
+	case BC_NODE_OBASE:
+		return num_from_long(bc->obase);
+	case BC_NODE_LAST:
+		value = bc->last;
+		break;
+	default:
+		g_warn_if_reached();
+	}
+
+	return value ? num_copy(value) : num_new(1, 0);
+}
+
+static gboolean
+store(GebrBc *bc, BcNode *node, gint index, const BcNum *value)
+{
+	BcArray *array;
+	BcVar *var;
+	glong number;
+
+	switch (node->type) {
+	case BC_NODE_VAR:
+		var = node->slot;
+		num_free(var->value);
+		var->value = num_copy(value);
+		break;
+	case BC_NODE_ARRAY:
+		array = node->slot;
+		if (array->values->len <= index)
+			g_ptr_array_set_size(array->values, index + 1);
+		num_free(array->values->pdata[index]);
+		array->values->pdata[index] = num_copy(value);
+		break;
+	case BC_NODE_SCALE:
+		number = num_to_long(value);
+		bc->scale = value->neg ? 0 : MIN(number, BC_MAX_SCALE);
+		break;
+	case BC_NODE_IBASE:
+	case BC_NODE_OBASE:
+		number = num_to_long(value);
+		if (number != 10) {
+			runtime_error(bc, "%s other than 10 is not supported",
+				      node->type == BC_NODE_IBASE ? "ibase" : "obase");
+			return FALSE;
+		}
+		if (node->type == BC_NODE_IBASE)
+			bc->ibase = number;
+		else
+			bc->obase = number;
+		break;
+	case BC_NODE_LAST:
+		num_free(bc->last);
+		bc->last = num_copy(value);
+		break;
+	default:
+		g_warn_if_reached();
+	}
+	return TRUE;
+}
+
+static BcNum *
+binary(GebrBc *bc, gchar op, const BcNum *n1, const BcNum *n2)
+{
+	BcNum *result = NULL;
+
+	switch (op) {
+	case '+':
+		return num_add(n1, n2, 0);
+	case '-':
+		return num_sub(n1, n2, 0);
+	case '*':
+		return num_multiply(n1, n2, bc->scale);
+	case '/':
+		if (!(result = num_divide(n1, n2, bc->scale)))
+			runtime_error(bc, "Divide by zero");
+		return result;
+	case '%':
+		if (!(result = num_modulo(n1, n2, bc->scale)))
+			runtime_error(bc, "Modulo by zero");
+		return result;
+	case '^':
+		return num_raise(bc, n1, n2);
+	default:
+		g_warn_if_reached();
+		return NULL;
+	}
+}
+
+static gboolean
+relation(gchar op, const BcNum *n1, const BcNum *n2)
+{
+	gint cmp = num_do_compare(n1, n2, TRUE, FALSE);
+
+	switch (op) {
+	case '<': return cmp < 0;
+	case '>': return cmp > 0;
+	case 'l': return cmp <= 0;
+	case 'g': return cmp >= 0;
+	case 'e': return cmp == 0;
+	case 'n': return cmp != 0;
+	default:
+		g_warn_if_reached();
+		return FALSE;
+	}
+}
+
+/*
+ * Evaluates assignments, increments and decrements of the named
+ * expression in @node->a.
+ */
+static BcNum *
+eval_update(GebrBc *bc, BcNode *node)
+{
+	BcNode *target = node->a;
+	BcNum *old, *value, *one;
+	gint index = 0;
+
+	if (target->type == BC_NODE_ARRAY && (index = array_index(bc, target)) < 0)
+		return NULL;
+
+	if (node->type == BC_NODE_ASSIGN) {
+		BcNum *right = eval(bc, node->b);
+		if (!right)
+			return NULL;
+		if (node->op == '=')
+			value = right;
+		else {
+			old = load(bc, target, index);
+			value = binary(bc, node->op, old, right);
+			num_free(old);
+			num_free(right);
+			if (!value)
+				return NULL;
+		}
+		if (!store(bc, target, index, value)) {
+			num_free(value);
+			return NULL;
+		}
+		return value;
+	}
+
+	one = num_from_long(1);
+	old = load(bc, target, index);
+	if (node->type == BC_NODE_PRE_INCR || node->type == BC_NODE_POST_INCR)
+		value = num_add(old, one, 0);
+	else
+		value = num_sub(old, one, 0);
+	num_free(one);
+
+	if (!store(bc, target, index, value)) {
+		num_free(old);
+		num_free(value);
+		return NULL;
+	}
+
+	if (node->type == BC_NODE_POST_INCR || node->type == BC_NODE_POST_DECR) {
+		num_free(value);
+		return old;
+	}
+	num_free(old);
+	return value;
+}
+
+/*
+ * Calls a user function, binding its parameters and auto variables with
+ * bc's dynamic scoping: they shadow the global ones (and the ones of the
+ * callers) until the function returns.
+ */
+static BcNum *
+eval_call(GebrBc *bc, BcNode *node)
+{
+	BcFunc *func = node->slot;
+	GPtrArray *args = node->list;
+	BcNum **values = g_new0(BcNum *, args->len + 1);
+	BcNum *result = NULL;
+	BcFlow flow;
+
+	for (guint i = 0; i < args->len; i++) {
+		if (!(values[i] = eval(bc, args->pdata[i])))
+			goto out;
+	}
+
+	if (!func->defined) {
+		runtime_error(bc, "Function %s not defined.", func->name);
+		goto out;
+	}
+	if (args->len != func->params->len) {
+		runtime_error(bc, "Parameter number mismatch");
+		goto out;
+	}
+	if (bc->depth >= BC_MAX_CALL_DEPTH) {
+		runtime_error(bc, "Function call nesting too deep");
+		goto out;
+	}
+
+	for (guint i = 0; i < func->params->len; i++) {
+		BcVar *var = ((BcLocal *) func->params->pdata[i])->slot;
+		var->saved = g_slist_prepend(var->saved, var->value);
+		var->value = values[i];
+		values[i] = NULL;
+	}
+	for (guint i = 0; i < func->autos->len; i++) {
+		BcLocal *local = func->autos->pdata[i];
+		if (local->is_array) {
+			BcArray *array = local->slot;
+			array->saved = g_slist_prepend(array->saved, array->values);
+			array->values = g_ptr_array_new_with_free_func((GDestroyNotify) num_free);
+		} else {
+			BcVar *var = local->slot;
+			var->saved = g_slist_prepend(var->saved, var->value);
+			var->value = NULL;
+		}
+	}
+
+	bc->depth++;
+	flow = exec(bc, func->body);
+	bc->depth--;
+
+	for (gint i = func->autos->len - 1; i >= 0; i--) {
+		BcLocal *local = func->autos->pdata[i];
+		if (local->is_array) {
+			BcArray *array = local->slot;
+			g_ptr_array_unref(array->values);
+			array->values = array->saved->data;
+			array->saved = g_slist_delete_link(array->saved, array->saved);
+		} else {
+			BcVar *var = local->slot;
+			num_free(var->value);
+			var->value = var->saved->data;
+			var->saved = g_slist_delete_link(var->saved, var->saved);
+		}
+	}
+	for (gint i = func->params->len - 1; i >= 0; i--) {
+		BcVar *var = ((BcLocal *) func->params->pdata[i])->slot;
+		num_free(var->value);
+		var->value = var->saved->data;
+		var->saved = g_slist_delete_link(var->saved, var->saved);
+	}
+
+	if (flow == BC_FLOW_RETURN) {
+		result = bc->retval;
+		bc->retval = NULL;
+	} else if (flow != BC_FLOW_ERROR)
+		result = num_new(1, 0);
+
+out:
+	for (guint i = 0; i < args->len; i++)
+		num_free(values[i]);
+	g_free(values);
+	return result;
+}
+
+static BcNum *
+eval(GebrBc *bc, BcNode *node)
+{
+	BcNum *n1, *n2, *result;
+	gint index = 0;
+
+	switch (node->type) {
+	case BC_NODE_NUMBER:
+		return num_copy(node->num);
+	case BC_NODE_ARRAY:
+		if ((index = array_index(bc, node)) < 0)
+			return NULL;
+		/* fall through */
+	case BC_NODE_VAR:
+	case BC_NODE_SCALE:
+	case BC_NODE_IBASE:
+	case BC_NODE_OBASE:
+	case BC_NODE_LAST:
+		return load(bc, node, index);
+	case BC_NODE_CALL:
+		return eval_call(bc, node);
+	case BC_NODE_ASSIGN:
+	case BC_NODE_PRE_INCR:
+	case BC_NODE_PRE_DECR:
+	case BC_NODE_POST_INCR:
+	case BC_NODE_POST_DECR:
+		return eval_update(bc, node);
+	default:
+		break;
+	}
+
+	if (!(n1 = eval(bc, node->a)))
+		return NULL;
+
+	switch (node->type) {
+	case BC_NODE_LENGTH:
+		if (n1->len == 1 && n1->scale != 0 && n1->d[0] == 0)
+			result = num_from_long(n1->scale);
+		else
+			result = num_from_long(n1->len + n1->scale);
+		break;
+	case BC_NODE_SCALE_OF:
+		result = num_from_long(n1->scale);
+		break;
+	case BC_NODE_SQRT:
+		if (!(result = num_sqrt(bc, n1)))
+			runtime_error(bc, "Square root of a negative number");
+		break;
+	case BC_NODE_NEGATE:
+		n2 = num_new(1, 0);
+		result = num_sub(n2, n1, 0);
+		num_free(n2);
+		break;
+	case BC_NODE_NOT:
+		result = num_from_long(num_is_zero(n1));
+		break;
+	case BC_NODE_AND:
+	case BC_NODE_OR:
+		/* Short-circuit evaluation */
+		if (num_is_zero(n1) == (node->type == BC_NODE_AND)) {
+			result = num_from_long(node->type == BC_NODE_OR);
+			break;
+		}
+		if (!(n2 = eval(bc, node->b))) {
+			result = NULL;
+			break;
+		}
+		result = num_from_long(!num_is_zero(n2));
+		num_free(n2);
+		break;
+	case BC_NODE_BINARY:
+	case BC_NODE_RELATION:
+		if (!(n2 = eval(bc, node->b))) {
+			result = NULL;
+			break;
+		}
+		if (node->type == BC_NODE_BINARY)
+			result = binary(bc, node->op, n1, n2);
+		else
+			result = num_from_long(relation(node->op, n1, n2));
+		num_free(n2);
+		break;
+	default:
+		g_warn_if_reached();
+		result = NULL;
+	}
+
+	num_free(n1);
+	return result;
+}
+
+/*
+ * Prints a string of a print statement, interpreting its escape sequences.
+ */
+static void
+print_string(GebrBc *bc, const gchar *str)
+{
+	for (; *str; str++) {
+		if (*str != '\\') {
+			g_string_append_c(bc->output, *str);
+			continue;
+		}
+		switch (*++str) {
+		case 'a': g_string_append_c(bc->output, '\a'); break;
+		case 'b': g_string_append_c(bc->output, '\b'); break;
+		case 'f': g_string_append_c(bc->output, '\f'); break;
+		case 'n': g_string_append_c(bc->output, '\n'); break;
+		case 'q': g_string_append_c(bc->output, '"'); break;
+		case 'r': g_string_append_c(bc->output, '\r'); break;
+		case 't': g_string_append_c(bc->output, '\t'); break;
+		case '\\': g_string_append_c(bc->output, '\\'); break;
+		case '\0': return;
+		default: break;
+		}
+	}
+}
+
+static BcFlow
+exec_list(GebrBc *bc, GPtrArray *list)
+{
+	for (guint i = 0; i < list->len; i++) {
+		BcFlow flow = exec(bc, list->pdata[i]);
+		if (flow != BC_FLOW_NEXT)
+			return flow;
+	}
+	return BC_FLOW_NEXT;
+}
+
+/*
+ * Evaluates the condition of a control statement, which is %TRUE when it
+ * is not zero. Returns -1 on error.
+ */
+static gint
+eval_condition(GebrBc *bc, BcNode *node)
+{
+	BcNum *value;
+	gboolean cond;
+
+	if (!node)
+		return TRUE;
+	if (!(value = eval(bc, node)))
+		return -1;
+	cond = !num_is_zero(value);
+	num_free(value);
+	return cond;
+}
+
+static BcFlow
+exec(GebrBc *bc, BcNode *node)
+{
+	BcNum *value;
+	BcFlow flow;
+	gint cond;
+
+	switch (node->type) {
+	case BC_NODE_EXPR_STMT:
+		if (!(value = eval(bc, node->a)))
+			return BC_FLOW_ERROR;
+		/* Values of plain assignments are not printed */
+		if (node->a->type == BC_NODE_ASSIGN && !node->a->paren) {
+			num_free(value);
+			return BC_FLOW_NEXT;
+		}
+		num_print(value, bc->output);
+		g_string_append_c(bc->output, '\n');
+		num_free(bc->last);
+		bc->last = value;
+		return BC_FLOW_NEXT;
+	case BC_NODE_STRING:
+		g_string_append(bc->output, node->str);
+		return BC_FLOW_NEXT;
+	case BC_NODE_PRINT:
+		for (guint i = 0; i < node->list->len; i++) {
+			BcNode *item = node->list->pdata[i];
+			if (item->type == BC_NODE_STRING) {
+				print_string(bc, item->str);
+				continue;
+			}
+			if (!(value = eval(bc, item)))
+				return BC_FLOW_ERROR;
+			num_print(value, bc->output);
+			num_free(value);
+		}
+		return BC_FLOW_NEXT;
+	case BC_NODE_BLOCK:
+		return exec_list(bc, node->list);
+	case BC_NODE_IF:
+		if ((cond = eval_condition(bc, node->a)) < 0)
+			return BC_FLOW_ERROR;
+		if (cond)
+			return exec(bc, node->b);
+		if (node->c)
+			return exec(bc, node->c);
+		return BC_FLOW_NEXT;
+	case BC_NODE_WHILE:
+		while ((cond = eval_condition(bc, node->a)) > 0) {
+			flow = exec(bc, node->b);
+			if (flow == BC_FLOW_BREAK)
+				break;
+			if (flow == BC_FLOW_RETURN || flow == BC_FLOW_ERROR)
+				return flow;
+		}
+		return cond < 0 ? BC_FLOW_ERROR : BC_FLOW_NEXT;
+	case BC_NODE_FOR:
+		if (node->a) {
+			if (!(value = eval(bc, node->a)))
+				return BC_FLOW_ERROR;
+			num_free(value);
+		}
+		while ((cond = eval_condition(bc, node->b)) > 0) {
+			flow = exec(bc, node->d);
+			if (flow == BC_FLOW_BREAK)
+				break;
+			if (flow == BC_FLOW_RETURN || flow == BC_FLOW_ERROR)
+				return flow;
+			if (node->c) {
+				if (!(value = eval(bc, node->c)))
+					return BC_FLOW_ERROR;
+				num_free(value);
+			}
+		}
+		return cond < 0 ? BC_FLOW_ERROR : BC_FLOW_NEXT;
+	case BC_NODE_BREAK:
+		return BC_FLOW_BREAK;
+	case BC_NODE_CONTINUE:
+		return BC_FLOW_CONTINUE;
+	case BC_NODE_RETURN:
+		if (node->a) {
+			if (!(value = eval(bc, node->a)))
+				return BC_FLOW_ERROR;
+		} else
+			value = num_new(1, 0);
+		num_free(bc->retval);
+		bc->retval = value;
+		return BC_FLOW_RETURN;
+	default:
+		g_warn_if_reached();
+		return BC_FLOW_ERROR;
+	}
+}
+
+/* Public functions {{{1 */
+GQuark gebr_bc_error_quark(void)
+{
+	return g_quark_from_static_string("gebr-bc-error-quark");
+}
+
+GebrBc *gebr_bc_new(gboolean mathlib)
+{
+	GebrBc *bc = g_new0(GebrBc, 1);
+
+	bc->vars = g_hash_table_new_full(g_str_hash, g_str_equal,
+					 g_free, (GDestroyNotify) var_free);
+	bc->arrays = g_hash_table_new_full(g_str_hash, g_str_equal,
+					   g_free, (GDestroyNotify) array_free);
+	bc->funcs = g_hash_table_new_full(g_str_hash, g_str_equal,
+					  g_free, (GDestroyNotify) func_free);
+	bc->ibase = 10;
+	bc->obase = 10;
+
+	if (mathlib && !gebr_bc_run(bc, mathlib_source, NULL, NULL))
+		g_warn_if_reached();
+
+	return bc;
+}
+
+void gebr_bc_free(GebrBc *bc)
+{
+	g_hash_table_unref(bc->funcs);
+	g_hash_table_unref(bc->vars);
+	g_hash_table_unref(bc->arrays);
+	num_free(bc->last);
+	num_free(bc->retval);
+	g_free(bc);
+}
+
+static void
+var_reset(gpointer key, BcVar *var)
+{
+	num_free(var->value);
+	var->value = NULL;
+}
+
+static void
+array_reset(gpointer key, BcArray *array)
+{
+	g_ptr_array_set_size(array->values, 0);
+}
+
+void gebr_bc_reset(GebrBc *bc)
+{
+	/* Parsed functions point to the slots, so only their values are dropped */
+	g_hash_table_foreach(bc->vars, (GHFunc) var_reset, NULL);
+	g_hash_table_foreach(bc->arrays, (GHFunc) array_reset, NULL);
+	num_free(bc->last);
+	bc->last = NULL;
+	bc->scale = 0;
+	bc->ibase = 10;
+	bc->obase = 10;
+}
+
+gboolean gebr_bc_run(GebrBc      *bc,
+		     const gchar *program,
+		     GString     *output,
+		     GError     **error)
+{
+	BcParser parser = { 0, };
+	GError *first = NULL;
+
+	g_return_val_if_fail(bc != NULL && program != NULL, FALSE);
+
+	parser.bc = bc;
+	parser.p = program;
+	parser.line = 1;
+	bc->output = output ? output : g_string_new(NULL);
+
+	next_token(&parser);
+	while (parser.token != TOK_EOF) {
+		GPtrArray *stmts = NULL;
+
+		if (parser.token == TOK_NEWLINE) {
+			next_token(&parser);
+			continue;
+		}
+
+		if (parser.token == TOK_DEFINE)
+			parse_function(&parser);
+		else
+			stmts = parse_line(&parser);
+
+		if (parser.error) {
+			if (!first)
+				first = parser.error;
+			else
+				g_error_free(parser.error);
+			parser.error = NULL;
+
+			/* Discard everything up to the end of the line */
+			parser.p = parser.start;
+			while (*parser.p && *parser.p != '\n')
+				parser.p++;
+			parser.token = TOK_NEWLINE;
+			continue;
+		}
+
+		if (!stmts)
+			continue;
+
+		if (exec_list(bc, stmts) == BC_FLOW_ERROR) {
+			if (!first)
+				first = bc->error;
+			else
+				g_error_free(bc->error);
+			bc->error = NULL;
+		}
+		g_ptr_array_unref(stmts);
+	}
+
+	if (!output)
+		g_string_free(bc->output, TRUE);
+	bc->output = NULL;
+
+	if (first) {
+		g_propagate_error(error, first);
+		return FALSE;
+	}
+	return TRUE;
+}
@@ -0,0 +1,97 @@
+/*   libgebr - GeBR Library
+ *   Copyright (C) 2011 GeBR core team (http://www.gebrproject.com/)
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * SECTION: gebr-bc
+ * @short_description: In-process interpreter for the subset of bc(1) used by GeBR
+ *
+ * #GebrBc parses programs written in the bc language into a syntax tree and
+ * executes them with bc's arbitrary precision decimal arithmetic, so results
+ * are printed exactly as `bc -l' would print them. Input is consumed line by
+ * line like bc does: a syntax error discards the current line and a runtime
+ * error aborts it, but the following lines are still executed.
+ *
+ * Only decimal input and output bases are supported.
+ */
+
+#ifndef __LIBGEBR_BC_H__
+#define __LIBGEBR_BC_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+#define GEBR_BC_ERROR (gebr_bc_error_quark())
+
+GQuark gebr_bc_error_quark(void);
+
+/**
+ * GebrBcError:
+ * @GEBR_BC_ERROR_SYNTAX: The program could not be parsed.
+ * @GEBR_BC_ERROR_RUNTIME: The program failed while executing, e.g. divide by zero.
+ */
+typedef enum {
+	GEBR_BC_ERROR_SYNTAX,
+	GEBR_BC_ERROR_RUNTIME,
+} GebrBcError;
+
+typedef struct _GebrBc GebrBc;
+
+/**
+ * gebr_bc_new:
+ * @mathlib: whether to load the standard math library, like `bc -l'
+ *
+ * Returns: a newly allocated interpreter, free with gebr_bc_free().
+ */
+GebrBc *gebr_bc_new(gboolean mathlib);
+
+/**
+ * gebr_bc_free:
+ */
+void gebr_bc_free(GebrBc *bc);
+
+/**
+ * gebr_bc_reset:
+ * @bc: a #GebrBc
+ *
+ * Forgets all variables and arrays and restores scale, ibase and obase to
+ * their initial values. Defined functions, including the math library, are
+ * kept, so the same program can be run again from a clean state without
+ * parsing the library again.
+ */
+void gebr_bc_reset(GebrBc *bc);
+
+/**
+ * gebr_bc_run:
+ * @bc: a #GebrBc
+ * @program: bc source code
+ * @output: return location for everything the program prints, or %NULL
+ * @error: return location for the first error found, or %NULL
+ *
+ * Executes @program, keeping variables and functions defined by it for the
+ * next calls.
+ *
+ * Returns: %FALSE if any syntax or runtime error happened.
+ */
+gboolean gebr_bc_run(GebrBc      *bc,
+		     const gchar *program,
+		     GString     *output,
+		     GError     **error);
+
+G_END_DECLS
+
+#endif /* __LIBGEBR_BC_H__ */
@@ -0,0 +1,253 @@
+/*   libgebr - GeBR Library
+ *   Copyright (C) 2007-2012 GeBR core team (http://www.gebrproject.com/)
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gebr-delta.h"
+
+#include <string.h>
+#include <zlib.h>
+
+/*
+ * A delta starts with the adler32 and the length of the base, and the
+ * length of the target (4 bytes each, big endian), followed by operations:
+ *
+ *   'C' offset length	copies length bytes of the base from offset
+ *   'I' length bytes	inserts length bytes
+ *
+ * It is compressed with zlib, after its uncompressed length, and then
+ * encoded in base64.
+ */
+#define OP_COPY		'C'
+#define OP_INSERT	'I'
+
+/* shorter copies are inserted, unless they follow the previous copy */
+#define MIN_COPY	8
+
+/* zlib does not inflate data more than about 1032 times its compressed size,
+ * so a larger uncompressed length is corrupted */
+#define MAX_INFLATE_RATIO	1032
+
+static void
+append_uint32(GString *str, guint32 value)
+{
+	guint32 be = GUINT32_TO_BE(value);
+	g_string_append_len(str, (gchar *) &be, 4);
+}
+
+static gboolean
+read_uint32(const guchar **p, const guchar *end, guint32 *value)
+{
+	guint32 be;
+
+	if (end - *p < 4)
+		return FALSE;
+	memcpy(&be, *p, 4);
+	*value = GUINT32_FROM_BE(be);
+	*p += 4;
+	return TRUE;
+}
+
+static guint
+line_hash(const gchar *line, gsize len)
+{
+	guint hash = 5381;
+
+	while (len--)
+		hash = hash * 33 + (guchar) *line++;
+
+	return hash;
+}
+
+static gsize
+line_length(const gchar *text, gsize len)
+{
+	const gchar *nl = memchr(text, '\n', len);
+	return nl ? nl - text + 1 : len;
+}
+
+static void
+flush_insert(GString *delta, const gchar *text, gsize len)
+{
+	if (!len)
+		return;
+	g_string_append_c(delta, OP_INSERT);
+	append_uint32(delta, len);
+	g_string_append_len(delta, text, len);
+}
+
+static GString *
+create_delta(const gchar *base, gsize base_len,
+	     const gchar *target, gsize target_len)
+{
+	GHashTable *lines = g_hash_table_new(g_direct_hash, g_direct_equal);
+	GString *delta = g_string_sized_new(64);
+
+	append_uint32(delta, adler32(adler32(0, NULL, 0), (const Bytef *) base, base_len));
+	append_uint32(delta, base_len);
+	append_uint32(delta, target_len);
+
+	/* First offset of each line of base, plus one */
+	for (gsize i = 0; i < base_len; ) {
+		gsize len = line_length(base + i, base_len - i);
+		gpointer key = GUINT_TO_POINTER(line_hash(base + i, len));
+
+		if (!g_hash_table_lookup(lines, key))
+			g_hash_table_insert(lines, key, GSIZE_TO_POINTER(i + 1));
+		i += len;
+	}
+
+	gsize insert_start = 0;
+	gsize expected = G_MAXSIZE;
+
+	for (gsize t = 0; t < target_len; ) {
+		gsize len = line_length(target + t, target_len - t);
+		gsize b = G_MAXSIZE;
+
+		if (len > base_len) {
+			t += len;
+			continue;
+		}
+
+		if (expected <= base_len - len && memcmp(base + expected, target + t, len) == 0)
+			b = expected;
+		else {
+			gsize found = GPOINTER_TO_SIZE(g_hash_table_lookup(lines,
+				GUINT_TO_POINTER(line_hash(target + t, len))));
+			if (found && found - 1 <= base_len - len
+			    && memcmp(base + found - 1, target + t, len) == 0
+			    && len >= MIN_COPY)
+				b = found - 1;
+		}
+
+		if (b == G_MAXSIZE) {
+			t += len;
+			continue;
+		}
+
+		/* Extend the copy over the following lines */
+		while (t + len < target_len && b + len < base_len && target[t + len] == base[b + len])
+			len++;
+
+		flush_insert(delta, target + insert_start, t - insert_start);
+		g_string_append_c(delta, OP_COPY);
+		append_uint32(delta, b);
+		append_uint32(delta, len);
+
+		t += len;
+		insert_start = t;
+		expected = b + len;
+	}
+	flush_insert(delta, target + insert_start, target_len - insert_start);
+
+	g_hash_table_destroy(lines);
+
+	return delta;
+}
+
+static gchar *
+apply_delta(const gchar *base, gsize base_len,
+	    const guchar *delta, gsize delta_len)
+{
+	const guchar *p = delta;
+	const guchar *end = delta + delta_len;
+	guint32 checksum, len, target_len;
+
+	if (!read_uint32(&p, end, &checksum) || !read_uint32(&p, end, &len) || !read_uint32(&p, end, &target_len))
+		return NULL;
+	if (len != base_len || checksum != adler32(adler32(0, NULL, 0), (const Bytef *) base, base_len))
+		return NULL;
+
+	/* The length is only a hint, it is checked after the operations */
+	GString *target = g_string_sized_new(MIN(target_len, base_len + delta_len));
+
+	while (p < end) {
+		guchar op = *p++;
+		guint32 offset;
+
+		if (op == OP_COPY) {
+			if (!read_uint32(&p, end, &offset) || !read_uint32(&p, end, &len)
+			    || offset > base_len || len > base_len - offset)
+				goto err;
+			g_string_append_len(target, base + offset, len);
+		} else if (op == OP_INSERT) {
+			if (!read_uint32(&p, end, &len) || len > end - p)
+				goto err;
+			g_string_append_len(target, (const gchar *) p, len);
+			p += len;
+		} else
+			goto err;
+	}
+
+	if (target->len != target_len)
+		goto err;
+
+	return g_string_free(target, FALSE);
+
+err:
+	g_string_free(target, TRUE);
+	return NULL;
+}
+
+gchar *
+gebr_delta_encode(const gchar *base,
+		  const gchar *target)
+{
+	g_return_val_if_fail(base != NULL && target != NULL, NULL);
+
+	GString *delta = create_delta(base, strlen(base), target, strlen(target));
+	uLongf len = compressBound(delta->len);
+	guchar *packed = g_malloc(len + 4);
+	guint32 be = GUINT32_TO_BE(delta->len);
+
+	memcpy(packed, &be, 4);
+	if (compress2(packed + 4, &len, (const Bytef *) delta->str, delta->len, Z_BEST_COMPRESSION) != Z_OK)
+		g_return_val_if_reached(NULL);
+
+	gchar *encoded = g_base64_encode(packed, len + 4);
+
+	g_free(packed);
+	g_string_free(delta, TRUE);
+
+	return encoded;
+}
+
+gchar *
+gebr_delta_decode(const gchar *base,
+		  const gchar *delta)
+{
+	g_return_val_if_fail(base != NULL && delta != NULL, NULL);
+
+	gsize packed_len;
+	guchar *packed = g_base64_decode(delta, &packed_len);
+	const guchar *p = packed;
+	guint32 len;
+	gchar *target = NULL;
+
+	if (read_uint32(&p, packed + packed_len, &len)
+	    && len / MAX_INFLATE_RATIO <= (gsize) (packed + packed_len - p)) {
+		guchar *inflated = g_malloc(len ? len : 1);
+		uLongf inflated_len = len;
+
+		if (uncompress(inflated, &inflated_len, p, packed + packed_len - p) == Z_OK
+		    && inflated_len == len)
+			target = apply_delta(base, strlen(base), inflated, len);
+		g_free(inflated);
+	}
+
+	g_free(packed);
+
+	return target;
+}
@@ -0,0 +1,52 @@
+/*   libgebr - GeBR Library
+ *   Copyright (C) 2007-2012 GeBR core team (http://www.gebrproject.com/)
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GEBR_DELTA_H__
+#define __GEBR_DELTA_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/**
+ * gebr_delta_encode:
+ * @base: the text the delta refers to
+ * @target: the text to encode
+ *
+ * Encodes @target as the differences from @base. Lines of @target found in
+ * @base are copied from it, the rest is inserted. The delta is compressed
+ * and returned in base64, so it can be kept in a XML text node.
+ *
+ * Returns: a newly allocated string with the delta.
+ */
+gchar *gebr_delta_encode(const gchar *base,
+			 const gchar *target);
+
+/**
+ * gebr_delta_decode:
+ * @base: the text given to gebr_delta_encode()
+ * @delta: a delta returned by gebr_delta_encode()
+ *
+ * Returns: a newly allocated string with the target text, or %NULL if
+ * @delta is corrupted or does not refer to @base.
+ */
+gchar *gebr_delta_decode(const gchar *base,
+			 const gchar *delta);
+
+G_END_DECLS
+
+#endif /* __GEBR_DELTA_H__ */
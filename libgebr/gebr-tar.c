@@ -15,23 +15,926 @@
  *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-#include <glib/gstdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
 #include <string.h>
+#include <unistd.h>
+#include <utime.h>
+#include <sys/stat.h>
+#include <zlib.h>
+#include <lzma.h>
+#include <glib/gstdio.h>
 
 #include "gebr-tar.h"
 #include "utils.h"
 
+/*
+ * Archives are written in the POSIX ustar format, with pax headers for names
+ * that do not fit, and compressed with xz. Both are produced and consumed as
+ * a stream, so nothing but the archive itself touches the disk.
+ */
+#define BLOCK_SIZE		512
+#define BUFFER_SIZE		65536
+#define PROGRESS_STEP		(1 << 20)
+#define MAX_ENCODER_THREADS	8
+
 struct _GebrTar {
 	gchar *tar_path;
 	gchar *extract_dir;
 	GList *files;
+
+	gint level;
+	GebrTarProgressFunc progress_func;
+	gpointer progress_data;
+	guint64 done;
+	guint64 total;
+	guint64 last_progress;
+	volatile gint cancelled;
 };
 
+typedef struct {
+	gchar name[100];
+	gchar mode[8];
+	gchar uid[8];
+	gchar gid[8];
+	gchar size[12];
+	gchar mtime[12];
+	gchar chksum[8];
+	gchar typeflag;
+	gchar linkname[100];
+	gchar magic[6];
+	gchar version[2];
+	gchar uname[32];
+	gchar gname[32];
+	gchar devmajor[8];
+	gchar devminor[8];
+	gchar prefix[155];
+	gchar pad[12];
+} TarHeader;
+
+typedef struct {
+	GebrTar *tar;
+	FILE *fp;
+	lzma_stream strm;
+	guint8 in[BUFFER_SIZE];
+	guint8 out[BUFFER_SIZE];
+} TarWriter;
+
+typedef enum {
+	COMPRESSION_NONE,
+	COMPRESSION_GZIP,
+	COMPRESSION_XZ
+} TarCompression;
+
+typedef struct {
+	GebrTar *tar;
+	FILE *fp;
+	TarCompression compression;
+	z_stream zstrm;
+	lzma_stream strm;
+	gboolean eof;
+	guint8 in[BUFFER_SIZE];
+	guint8 data[BUFFER_SIZE];
+} TarReader;
+
+/* {{{1 Common */
+
+static void
+report_progress (GebrTar *self, gboolean force)
+{
+	if (!self->progress_func)
+		return;
+	if (!force && self->done - self->last_progress < PROGRESS_STEP)
+		return;
+
+	self->last_progress = self->done;
+	self->progress_func (self, self->done, self->total, self->progress_data);
+}
+
+static gboolean
+is_cancelled (GebrTar *self)
+{
+	return g_atomic_int_get (&self->cancelled) != 0;
+}
+
+static guint64
+padding (guint64 size)
+{
+	return (BLOCK_SIZE - size % BLOCK_SIZE) % BLOCK_SIZE;
+}
+
+static guint
+header_checksum (const TarHeader *header, gint *signed_sum)
+{
+	const guchar *p = (const guchar *) header;
+	guint sum = 0;
+	gint ssum = 0;
+
+	for (gsize i = 0; i < BLOCK_SIZE; i++) {
+		gsize offset = G_STRUCT_OFFSET (TarHeader, chksum);
+		gboolean in_chksum = i >= offset && i < offset + sizeof (header->chksum);
+		sum += in_chksum ? ' ' : p[i];
+		ssum += in_chksum ? ' ' : (gint) (gchar) p[i];
+	}
+
+	if (signed_sum)
+		*signed_sum = ssum;
+	return sum;
+}
+
+/* {{{1 Writer */
+
+static void
+set_number (gchar *field, gsize size, guint64 value)
+{
+	if (value >> (3 * (size - 1)) == 0)
+		g_snprintf (field, size, "%0*" G_GINT64_MODIFIER "o", (gint) size - 1, value);
+	else {
+		/* GNU base-256 encoding for values too big for octal */
+		for (gsize i = size - 1; i > 0; i--) {
+			field[i] = value & 0xff;
+			value >>= 8;
+		}
+		field[0] = (gchar) 0x80;
+	}
+}
+
+static void
+set_string (gchar *field, gsize size, const gchar *value)
+{
+	strncpy (field, value, size);
+}
+
+static gboolean
+writer_code (TarWriter *w, const guint8 *data, gsize len, lzma_action action)
+{
+	lzma_ret ret;
+
+	w->strm.next_in = data;
+	w->strm.avail_in = len;
+
+	do {
+		gsize n;
+
+		w->strm.next_out = w->out;
+		w->strm.avail_out = sizeof (w->out);
+		ret = lzma_code (&w->strm, action);
+		if (ret != LZMA_OK && ret != LZMA_STREAM_END) {
+			g_warning ("Error compressing %s (error %d)", w->tar->tar_path, ret);
+			return FALSE;
+		}
+
+		n = sizeof (w->out) - w->strm.avail_out;
+		if (n && fwrite (w->out, 1, n, w->fp) != n) {
+			g_warning ("Error writing %s: %s", w->tar->tar_path, g_strerror (errno));
+			return FALSE;
+		}
+	} while (w->strm.avail_in > 0 || (action == LZMA_FINISH && ret != LZMA_STREAM_END));
+
+	return TRUE;
+}
+
+static gboolean
+writer_write (TarWriter *w, const void *data, gsize len)
+{
+	return writer_code (w, data, len, LZMA_RUN);
+}
+
+static gboolean
+writer_pad (TarWriter *w, guint64 size)
+{
+	static const guint8 zeros[BLOCK_SIZE];
+	return writer_write (w, zeros, padding (size));
+}
+
+static gboolean
+writer_init (TarWriter *w, gint level)
+{
+	memset (&w->strm, 0, sizeof (w->strm));
+
+#if LZMA_VERSION >= 50020002
+	lzma_mt mt;
+	guint64 limit = MAX (lzma_physmem () / 4, 256 << 20);
+
+	memset (&mt, 0, sizeof (mt));
+	mt.threads = CLAMP (lzma_cputhreads (), 1, MAX_ENCODER_THREADS);
+	mt.preset = level;
+	mt.check = LZMA_CHECK_CRC64;
+
+	while (mt.threads > 1 && lzma_stream_encoder_mt_memusage (&mt) > limit)
+		mt.threads--;
+
+	if (mt.threads > 1)
+		return lzma_stream_encoder_mt (&w->strm, &mt) == LZMA_OK;
+#endif
+
+	return lzma_easy_encoder (&w->strm, level, LZMA_CHECK_CRC64) == LZMA_OK;
+}
+
+static void
+pax_append (GString *pax, const gchar *key, const gchar *value)
+{
+	/* Each record is "<length> <key>=<value>\n", counting the length itself */
+	gsize len = strlen (key) + strlen (value) + 3;
+	gsize digits = 1;
+
+	for (gsize limit = 10; len + digits >= limit; limit *= 10)
+		digits++;
+
+	g_string_append_printf (pax, "%" G_GSIZE_FORMAT " %s=%s\n", len + digits, key, value);
+}
+
+static void
+header_init (TarHeader *header, gchar typeflag, const struct stat *st, guint64 size)
+{
+	memset (header, 0, sizeof (*header));
+	set_number (header->mode, sizeof (header->mode), st->st_mode & 07777);
+	set_number (header->uid, sizeof (header->uid), st->st_uid);
+	set_number (header->gid, sizeof (header->gid), st->st_gid);
+	set_number (header->size, sizeof (header->size), size);
+	set_number (header->mtime, sizeof (header->mtime), MAX (st->st_mtime, 0));
+	header->typeflag = typeflag;
+	memcpy (header->magic, "ustar", 6);
+	memcpy (header->version, "00", 2);
+}
+
+static gboolean
+header_write (TarWriter *w, TarHeader *header)
+{
+	g_snprintf (header->chksum, sizeof (header->chksum), "%06o", header_checksum (header, NULL));
+	header->chksum[7] = ' ';
+	return writer_write (w, header, sizeof (*header));
+}
+
+static gboolean
+split_name (TarHeader *header, const gchar *name)
+{
+	gsize len = strlen (name);
+
+	if (len <= sizeof (header->name)) {
+		set_string (header->name, sizeof (header->name), name);
+		return TRUE;
+	}
+
+	for (const gchar *slash = strchr (name, '/'); slash; slash = strchr (slash + 1, '/')) {
+		gsize prefix = slash - name;
+
+		if (prefix > sizeof (header->prefix))
+			break;
+		if (prefix == 0 || len - prefix - 1 > sizeof (header->name) || len - prefix - 1 == 0)
+			continue;
+
+		memcpy (header->prefix, name, prefix);
+		set_string (header->name, sizeof (header->name), slash + 1);
+		return TRUE;
+	}
+
+	return FALSE;
+}
+
+static gboolean
+write_entry (TarWriter *w,
+	     const gchar *name,
+	     const gchar *linkname,
+	     gchar typeflag,
+	     const struct stat *st,
+	     guint64 size)
+{
+	TarHeader header;
+	GString *pax = g_string_new (NULL);
+	gboolean ret = TRUE;
+
+	header_init (&header, typeflag, st, size);
+
+	if (!split_name (&header, name)) {
+		pax_append (pax, "path", name);
+		set_string (header.name, sizeof (header.name), name);
+	}
+	if (linkname) {
+		if (strlen (linkname) > sizeof (header.linkname))
+			pax_append (pax, "linkpath", linkname);
+		set_string (header.linkname, sizeof (header.linkname), linkname);
+	}
+
+	if (pax->len) {
+		TarHeader pax_header;
+
+		header_init (&pax_header, 'x', st, pax->len);
+		set_number (pax_header.mode, sizeof (pax_header.mode), 0644);
+		set_string (pax_header.name, sizeof (pax_header.name), "././@PaxHeader");
+		ret = header_write (w, &pax_header)
+			&& writer_write (w, pax->str, pax->len)
+			&& writer_pad (w, pax->len);
+	}
+
+	g_string_free (pax, TRUE);
+
+	return ret && header_write (w, &header);
+}
+
+static gboolean
+write_file_data (TarWriter *w, const gchar *path, guint64 size)
+{
+	gint fd = g_open (path, O_RDONLY, 0);
+	guint64 left = size;
+
+	if (fd == -1) {
+		g_warning ("Could not read %s: %s", path, g_strerror (errno));
+		return FALSE;
+	}
+
+	while (left > 0) {
+		gssize n = read (fd, w->in, MIN (left, sizeof (w->in)));
+
+		if (n == -1 && errno == EINTR)
+			continue;
+		if (n == -1) {
+			g_warning ("Could not read %s: %s", path, g_strerror (errno));
+			close (fd);
+			return FALSE;
+		}
+		if (n == 0) {
+			/* The file shrank, keep the size written in the header */
+			n = MIN (left, sizeof (w->in));
+			memset (w->in, 0, n);
+		}
+
+		if (!writer_write (w, w->in, n)) {
+			close (fd);
+			return FALSE;
+		}
+
+		left -= n;
+		w->tar->done += n;
+		report_progress (w->tar, FALSE);
+
+		if (is_cancelled (w->tar)) {
+			close (fd);
+			return FALSE;
+		}
+	}
+
+	close (fd);
+	return writer_pad (w, size);
+}
+
+static gchar *
+member_path (const gchar *root_dir, const gchar *name)
+{
+	if (g_path_is_absolute (name))
+		return g_strdup (name);
+	return g_build_filename (root_dir, name, NULL);
+}
+
+static gchar *
+member_name (const gchar *name)
+{
+	gchar *stripped;
+	gsize len;
+
+	while (*name == '/')
+		name++;
+	stripped = g_strdup (name);
+	len = strlen (stripped);
+	while (len > 1 && stripped[len - 1] == '/')
+		stripped[--len] = '\0';
+
+	return stripped;
+}
+
+static gint
+compare_names (gconstpointer a, gconstpointer b)
+{
+	return strcmp (*(const gchar **) a, *(const gchar **) b);
+}
+
+static GPtrArray *
+list_directory (const gchar *path)
+{
+	GPtrArray *children = g_ptr_array_new ();
+	const gchar *child;
+	GDir *dir;
+
+	if ((dir = g_dir_open (path, 0, NULL)) != NULL) {
+		while ((child = g_dir_read_name (dir)) != NULL)
+			g_ptr_array_add (children, g_strdup (child));
+		g_dir_close (dir);
+	}
+	g_ptr_array_sort (children, compare_names);
+
+	return children;
+}
+
+static void
+compute_size (GebrTar *self, const gchar *path)
+{
+	struct stat st;
+
+	if (g_lstat (path, &st) != 0)
+		return;
+
+	if (S_ISREG (st.st_mode))
+		self->total += st.st_size;
+	else if (S_ISDIR (st.st_mode)) {
+		GPtrArray *children = list_directory (path);
+
+		for (guint i = 0; i < children->len; i++) {
+			gchar *child = g_build_filename (path, g_ptr_array_index (children, i), NULL);
+			compute_size (self, child);
+			g_free (child);
+		}
+		g_ptr_array_foreach (children, (GFunc) g_free, NULL);
+		g_ptr_array_free (children, TRUE);
+	}
+}
+
+static gboolean
+write_member (TarWriter *w, const gchar *root_dir, const gchar *name)
+{
+	gchar *path = member_path (root_dir, name);
+	gchar *stored = member_name (name);
+	gboolean ret = TRUE;
+	struct stat st;
+
+	if (g_lstat (path, &st) != 0) {
+		g_warning ("Could not read %s: %s", path, g_strerror (errno));
+		ret = FALSE;
+	} else if (S_ISREG (st.st_mode)) {
+		ret = write_entry (w, stored, NULL, '0', &st, st.st_size)
+			&& write_file_data (w, path, st.st_size);
+	} else if (S_ISLNK (st.st_mode)) {
+		gchar *target = g_file_read_link (path, NULL);
+		ret = target && write_entry (w, stored, target, '2', &st, 0);
+		g_free (target);
+	} else if (S_ISDIR (st.st_mode)) {
+		GPtrArray *children = list_directory (path);
+		gchar *dirname = g_strconcat (stored, "/", NULL);
+
+		ret = write_entry (w, dirname, NULL, '5', &st, 0);
+		for (guint i = 0; ret && i < children->len; i++) {
+			gchar *child = g_build_filename (name, g_ptr_array_index (children, i), NULL);
+			ret = write_member (w, root_dir, child);
+			g_free (child);
+		}
+
+		g_free (dirname);
+		g_ptr_array_foreach (children, (GFunc) g_free, NULL);
+		g_ptr_array_free (children, TRUE);
+	} else
+		g_warning ("Ignoring %s: not a regular file, link or directory", path);
+
+	g_free (stored);
+	g_free (path);
+
+	return ret && !is_cancelled (w->tar);
+}
+
+/* {{{1 Reader */
+
+static gboolean
+reader_fill (TarReader *r, const guint8 **next_in, gsize *avail_in)
+{
+	gsize n;
+
+	if (r->eof)
+		return FALSE;
+
+	n = fread (r->in, 1, sizeof (r->in), r->fp);
+	r->tar->done += n;
+	report_progress (r->tar, FALSE);
+
+	*next_in = r->in;
+	*avail_in = n;
+	r->eof = n == 0;
+
+	return !r->eof;
+}
+
+static gboolean
+reader_read_gzip (TarReader *r, guint8 *buf, gsize len)
+{
+	r->zstrm.next_out = buf;
+	r->zstrm.avail_out = len;
+
+	while (r->zstrm.avail_out > 0) {
+		gint ret;
+
+		if (r->zstrm.avail_in == 0) {
+			const guint8 *next_in;
+			gsize avail_in;
+
+			if (!reader_fill (r, &next_in, &avail_in))
+				return FALSE;
+			r->zstrm.next_in = (Bytef *) next_in;
+			r->zstrm.avail_in = avail_in;
+		}
+
+		ret = inflate (&r->zstrm, Z_NO_FLUSH);
+		if (ret == Z_STREAM_END) {
+			/* Concatenated gzip members */
+			if (r->zstrm.avail_out > 0 && inflateReset (&r->zstrm) != Z_OK)
+				return FALSE;
+		} else if (ret != Z_OK)
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+static gboolean
+reader_read_xz (TarReader *r, guint8 *buf, gsize len)
+{
+	r->strm.next_out = buf;
+	r->strm.avail_out = len;
+
+	while (r->strm.avail_out > 0) {
+		lzma_ret ret;
+
+		if (r->strm.avail_in == 0)
+			reader_fill (r, &r->strm.next_in, &r->strm.avail_in);
+
+		ret = lzma_code (&r->strm, r->eof ? LZMA_FINISH : LZMA_RUN);
+		if (ret == LZMA_STREAM_END)
+			return r->strm.avail_out == 0;
+		if (ret != LZMA_OK)
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+static gboolean
+reader_read (TarReader *r, guint8 *buf, gsize len)
+{
+	switch (r->compression) {
+	case COMPRESSION_GZIP:
+		return reader_read_gzip (r, buf, len);
+	case COMPRESSION_XZ:
+		return reader_read_xz (r, buf, len);
+	default: {
+		gsize n = fread (buf, 1, len, r->fp);
+		r->tar->done += n;
+		report_progress (r->tar, FALSE);
+		return n == len;
+	}
+	}
+}
+
+static gboolean
+reader_skip (TarReader *r, guint64 size)
+{
+	while (size > 0) {
+		gsize n = MIN (size, sizeof (r->data));
+		if (!reader_read (r, r->data, n))
+			return FALSE;
+		size -= n;
+	}
+	return TRUE;
+}
+
+static gboolean
+reader_init (TarReader *r)
+{
+	guint8 magic[6];
+	gsize n = fread (magic, 1, sizeof (magic), r->fp);
+
+	rewind (r->fp);
+
+	if (n >= 2 && magic[0] == 0x1f && magic[1] == 0x8b) {
+		r->compression = COMPRESSION_GZIP;
+		/* Automatic header detection, for gzip */
+		return inflateInit2 (&r->zstrm, 15 + 32) == Z_OK;
+	}
+
+	if (n == 6 && memcmp (magic, "\xfd" "7zXZ\0", 6) == 0) {
+		r->compression = COMPRESSION_XZ;
+#if LZMA_VERSION >= 50040002
+		lzma_mt mt;
+
+		memset (&mt, 0, sizeof (mt));
+		mt.threads = CLAMP (lzma_cputhreads (), 1, MAX_ENCODER_THREADS);
+		mt.flags = LZMA_CONCATENATED;
+		mt.memlimit_threading = MAX (lzma_physmem () / 4, 256 << 20);
+		mt.memlimit_stop = UINT64_MAX;
+		return lzma_stream_decoder_mt (&r->strm, &mt) == LZMA_OK;
+#else
+		return lzma_stream_decoder (&r->strm, UINT64_MAX, LZMA_CONCATENATED) == LZMA_OK;
+#endif
+	}
+
+	r->compression = COMPRESSION_NONE;
+	return TRUE;
+}
+
+static void
+reader_end (TarReader *r)
+{
+	if (r->compression == COMPRESSION_GZIP)
+		inflateEnd (&r->zstrm);
+	else if (r->compression == COMPRESSION_XZ)
+		lzma_end (&r->strm);
+}
+
+static gboolean
+get_number (const gchar *field, gsize size, guint64 *value)
+{
+	const guchar *p = (const guchar *) field;
+
+	*value = 0;
+
+	if (p[0] & 0x80) {
+		for (gsize i = 1; i < size; i++) {
+			if (*value >> 56)
+				return FALSE;
+			*value = *value << 8 | p[i];
+		}
+		return TRUE;
+	}
+
+	gsize i = 0;
+	while (i < size && p[i] == ' ')
+		i++;
+	for (; i < size && p[i] >= '0' && p[i] <= '7'; i++)
+		*value = *value << 3 | (p[i] - '0');
+
+	return i == size || p[i] == ' ' || p[i] == '\0';
+}
+
+static gboolean
+is_zero_block (const TarHeader *header)
+{
+	const guint8 *p = (const guint8 *) header;
+
+	for (gsize i = 0; i < BLOCK_SIZE; i++)
+		if (p[i])
+			return FALSE;
+	return TRUE;
+}
+
+static gchar *
+read_long_data (TarReader *r, guint64 size)
+{
+	GString *data;
+
+	/* Long names and pax headers are small, anything else is corrupted */
+	if (size > (1 << 20))
+		return NULL;
+
+	data = g_string_sized_new (size);
+	for (guint64 left = size; left > 0; ) {
+		gsize n = MIN (left, sizeof (r->data));
+		if (!reader_read (r, r->data, n)) {
+			g_string_free (data, TRUE);
+			return NULL;
+		}
+		g_string_append_len (data, (gchar *) r->data, n);
+		left -= n;
+	}
+
+	if (!reader_skip (r, padding (size))) {
+		g_string_free (data, TRUE);
+		return NULL;
+	}
+
+	return g_string_free (data, FALSE);
+}
+
+static void
+parse_pax (const gchar *data, gchar **path, gchar **linkpath)
+{
+	const gchar *p = data;
+
+	while (*p) {
+		gchar *end;
+		guint64 len = g_ascii_strtoull (p, &end, 10);
+		const gchar *record_end = p + len;
+
+		if (end == p || *end != ' ' || len == 0 || record_end > p + strlen (p))
+			return;
+
+		const gchar *key = end + 1;
+		const gchar *equal = memchr (key, '=', record_end - key);
+
+		if (equal && record_end[-1] == '\n') {
+			gchar **target = NULL;
+
+			if (equal - key == 4 && strncmp (key, "path", 4) == 0)
+				target = path;
+			else if (equal - key == 8 && strncmp (key, "linkpath", 8) == 0)
+				target = linkpath;
+
+			if (target) {
+				g_free (*target);
+				*target = g_strndup (equal + 1, record_end - equal - 2);
+			}
+		}
+		p = record_end;
+	}
+}
+
+/*
+ * Returns a name relative to the extraction directory, or %NULL if the
+ * member would be extracted out of it.
+ */
+static gchar *
+sanitize_name (const gchar *name)
+{
+	gchar **parts;
+	gboolean valid = TRUE;
+
+	while (*name == '/')
+		name++;
+	if (!*name)
+		return NULL;
+
+	parts = g_strsplit (name, "/", -1);
+	for (gint i = 0; parts[i]; i++)
+		if (strcmp (parts[i], "..") == 0)
+			valid = FALSE;
+	g_strfreev (parts);
+
+	return valid ? g_strdup (name) : NULL;
+}
+
+static gboolean
+link_is_contained (const gchar *linkname)
+{
+	gchar *relative = sanitize_name (linkname);
+	gboolean contained = relative != NULL;
+
+	g_free (relative);
+	return contained;
+}
+
+static gboolean
+extract_file (TarReader *r, const gchar *path, guint mode, guint64 size)
+{
+	gchar *dirname = g_path_get_dirname (path);
+	gboolean ret = TRUE;
+	gint fd;
+
+	g_mkdir_with_parents (dirname, 0755);
+	g_free (dirname);
+
+	fd = g_open (path, O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW, (mode & 0777) | 0600);
+	if (fd == -1)
+		g_warning ("Could not create %s: %s", path, g_strerror (errno));
+
+	for (guint64 left = size; left > 0 && ret; ) {
+		gsize n = MIN (left, sizeof (r->data));
+
+		if (!reader_read (r, r->data, n))
+			ret = FALSE;
+		else if (fd != -1 && write (fd, r->data, n) != (gssize) n) {
+			g_warning ("Could not write %s: %s", path, g_strerror (errno));
+			ret = FALSE;
+		}
+		left -= n;
+
+		if (is_cancelled (r->tar))
+			ret = FALSE;
+	}
+
+	if (fd != -1)
+		close (fd);
+
+	return ret && fd != -1 && reader_skip (r, padding (size));
+}
+
+static gboolean
+extract_all (GebrTar *self, TarReader *r)
+{
+	gchar *long_path = NULL;
+	gchar *long_link = NULL;
+	gboolean ret = FALSE;
+	TarHeader header;
+
+	while (!is_cancelled (self)) {
+		guint64 size, mode, mtime;
+		gint signed_sum;
+		guint64 chksum;
+		gchar *name;
+		gchar *linkname;
+
+		if (!reader_read (r, (guint8 *) &header, sizeof (header)))
+			break;
+
+		if (is_zero_block (&header)) {
+			ret = TRUE;
+			break;
+		}
+
+		if (!get_number (header.chksum, sizeof (header.chksum), &chksum)
+		    || (chksum != header_checksum (&header, &signed_sum) && chksum != (guint64) signed_sum)
+		    || !get_number (header.size, sizeof (header.size), &size)) {
+			g_warning ("Invalid header in %s", self->tar_path);
+			break;
+		}
+
+		get_number (header.mode, sizeof (header.mode), &mode);
+		get_number (header.mtime, sizeof (header.mtime), &mtime);
+
+		if (header.typeflag == 'x' || header.typeflag == 'L' || header.typeflag == 'K') {
+			gchar *data = read_long_data (r, size);
+
+			if (!data)
+				break;
+			if (header.typeflag == 'x')
+				parse_pax (data, &long_path, &long_link);
+			else if (header.typeflag == 'L') {
+				g_free (long_path);
+				long_path = g_strdup (data);
+			} else {
+				g_free (long_link);
+				long_link = g_strdup (data);
+			}
+			g_free (data);
+			continue;
+		}
+
+		if (long_path)
+			name = long_path;
+		else if (memcmp (header.magic, "ustar", 6) == 0 && header.prefix[0]) {
+			gchar *prefix = g_strndup (header.prefix, sizeof (header.prefix));
+			gchar *base = g_strndup (header.name, sizeof (header.name));
+			name = g_strconcat (prefix, "/", base, NULL);
+			g_free (prefix);
+			g_free (base);
+		} else
+			name = g_strndup (header.name, sizeof (header.name));
+		linkname = long_link ? long_link : g_strndup (header.linkname, sizeof (header.linkname));
+		long_path = long_link = NULL;
+
+		gchar *relative = sanitize_name (name);
+		gchar *path = relative ? g_build_filename (self->extract_dir, relative, NULL) : NULL;
+		gboolean extracted = FALSE;
+		gboolean ok = TRUE;
+
+		switch (header.typeflag) {
+		case '0':
+		case '\0':
+		case '7':
+			if (path) {
+				ok = extract_file (r, path, mode, size);
+				extracted = TRUE;
+			} else
+				ok = reader_skip (r, size + padding (size));
+			break;
+		case '5':
+			if (path)
+				extracted = g_mkdir_with_parents (path, (mode & 0777) | 0700) == 0;
+			ok = reader_skip (r, size + padding (size));
+			break;
+		case '2':
+			/* Only links that stay inside the extraction directory */
+			if (path && !g_path_is_absolute (linkname) && link_is_contained (linkname)) {
+				gchar *dirname = g_path_get_dirname (path);
+				g_mkdir_with_parents (dirname, 0755);
+				extracted = symlink (linkname, path) == 0;
+				g_free (dirname);
+			}
+			ok = reader_skip (r, size + padding (size));
+			break;
+		default:
+			ok = reader_skip (r, size + padding (size));
+		}
+
+		if (extracted && header.typeflag != '2') {
+			struct utimbuf times = { mtime, mtime };
+			g_utime (path, &times);
+		}
+		if (extracted)
+			self->files = g_list_prepend (self->files, g_strdup (relative));
+
+		g_free (relative);
+		g_free (path);
+		g_free (name);
+		g_free (linkname);
+
+		if (!ok)
+			break;
+	}
+
+	if (!ret && !is_cancelled (self))
+		g_warning ("Error extracting %s", self->tar_path);
+
+	g_free (long_path);
+	g_free (long_link);
+
+	self->files = g_list_reverse (self->files);
+
+	return ret;
+}
+
+/* {{{1 Public API */
+
 GebrTar *gebr_tar_create (const gchar *path)
 {
 	GebrTar *self;
 	self = g_new0 (GebrTar, 1);
 	self->tar_path = g_strdup (path);
+	self->level = GEBR_TAR_DEFAULT_LEVEL;
 	return self;
 }
 
@@ -45,46 +948,86 @@ const gchar * gebr_tar_get_dir (GebrTar *self)
 	return self->extract_dir;
 }
 
+void gebr_tar_set_level (GebrTar *self, gint level)
+{
+	g_return_if_fail (level >= 0 && level <= 9);
+	self->level = level;
+}
+
+void gebr_tar_set_progress_func (GebrTar *self,
+				 GebrTarProgressFunc func,
+				 gpointer data)
+{
+	self->progress_func = func;
+	self->progress_data = data;
+}
+
+void gebr_tar_cancel (GebrTar *self)
+{
+	g_atomic_int_set (&self->cancelled, 1);
+}
+
+gboolean gebr_tar_is_cancelled (GebrTar *self)
+{
+	return is_cancelled (self);
+}
+
 gboolean gebr_tar_compact (GebrTar *self, const gchar *root_dir)
 {
-	gchar *command;
-	gchar *stderr;
-	GString *files;
-	GError *error = NULL;
-	int exit;
+	static const guint8 end[2 * BLOCK_SIZE];
+	TarWriter *w;
+	GList *files;
+	gboolean ret;
 
-	files = g_string_new ("");
-	for (GList *i = self->files; i; i = i->next) {
-		gchar *file = i->data;
-		g_string_append_printf (files, "%s ", g_shell_quote(file));
+	g_return_val_if_fail (self->tar_path != NULL, FALSE);
+
+	files = self->files ? g_list_copy (self->files) : g_list_prepend (NULL, ".");
+
+	self->done = self->last_progress = self->total = 0;
+	for (GList *i = files; i; i = i->next) {
+		gchar *path = member_path (root_dir, i->data);
+		compute_size (self, path);
+		g_free (path);
+	}
+
+	w = g_new (TarWriter, 1);
+	w->tar = self;
+
+	if ((w->fp = g_fopen (self->tar_path, "wb")) == NULL) {
+		g_warning ("Error creating compressed archive %s: %s", self->tar_path, g_strerror (errno));
+		g_list_free (files);
+		g_free (w);
+		return FALSE;
 	}
 
-	gchar *rootdir = g_shell_quote(root_dir);
-	gchar *tar_path = g_shell_quote(self->tar_path);
-	gchar *subcommand = g_strdup_printf("tar cC %s %s | xz > %s",
-	                                    rootdir,
-	                                    files->len ? files->str : ".",
-	                                    tar_path);
+	ret = writer_init (w, self->level);
+	if (!ret)
+		g_warning ("Error creating compressed archive %s", self->tar_path);
 
-	gchar *quoted_cmd = g_shell_quote(subcommand);
-	command = g_strdup_printf ("/bin/bash -c %s", quoted_cmd);
+	report_progress (self, TRUE);
 
-	g_free(rootdir);
-	g_free(tar_path);
-	g_free(subcommand);
-	g_free(quoted_cmd);
+	for (GList *i = files; ret && i; i = i->next)
+		ret = write_member (w, root_dir, i->data);
 
-	g_string_free (files, TRUE);
-	g_spawn_command_line_sync(command, NULL, &stderr, &exit, &error);
-	g_free (command);
+	ret = ret
+		&& writer_write (w, end, sizeof (end))
+		&& writer_code (w, NULL, 0, LZMA_FINISH);
 
-	if (exit || error) {
-		g_warning("Error creating compressed archive: %s", error? error->message : stderr);
-		g_free (stderr);
-		return FALSE;
+	lzma_end (&w->strm);
+	if (fclose (w->fp) != 0 && ret) {
+		g_warning ("Error writing %s: %s", self->tar_path, g_strerror (errno));
+		ret = FALSE;
 	}
 
-	return TRUE;
+	if (ret)
+		report_progress (self, TRUE);
+	else
+		g_unlink (self->tar_path);
+
+	g_list_free (files);
+	g_free (w);
+
+	return ret;
 }
 
 GebrTar *gebr_tar_new_from_file (const gchar *path)
@@ -92,6 +1035,7 @@ GebrTar *gebr_tar_new_from_file (const gchar *path)
 	GebrTar *self;
 	self = g_new0 (GebrTar, 1);
 	self->tar_path = g_strdup (path);
+	self->level = GEBR_TAR_DEFAULT_LEVEL;
 	return self;
 }
 
@@ -104,54 +1048,46 @@ gboolean gebr_tar_is_gzip (GebrTar *self)
 
 gboolean gebr_tar_extract (GebrTar *self)
 {
+	TarReader *r;
 	GString *tmp;
-	gchar *command;
-	gchar *output;
-	gchar *stderr;
-	gchar **files;
+	struct stat st;
+	gboolean ret;
 
 	g_return_val_if_fail (self->tar_path != NULL, FALSE);
 
-	if (!g_file_test (self->tar_path, G_FILE_TEST_EXISTS))
+	if (g_stat (self->tar_path, &st) != 0)
 		return FALSE;
 
-	tmp = gebr_temp_directory_create ();
-	self->extract_dir = g_string_free (tmp, FALSE);
+	r = g_new0 (TarReader, 1);
+	r->tar = self;
 
-	gchar *tar_path = g_shell_quote(self->tar_path);
-	gchar *extract_dir = g_shell_quote(self->extract_dir);
-
-	gchar *subcommand = g_strdup_printf("%s %s | tar xvC %s",
-	                                    gebr_tar_is_gzip(self) ? "zcat" : "xz -dc",
-	                                    tar_path, extract_dir);
+	if ((r->fp = g_fopen (self->tar_path, "rb")) == NULL) {
+		g_free (r);
+		return FALSE;
+	}
 
-	gchar *quoted_cmd = g_shell_quote(subcommand);
-	command = g_strdup_printf ("/bin/bash -c %s", quoted_cmd);
+	if (!reader_init (r)) {
+		fclose (r->fp);
+		g_free (r);
+		return FALSE;
+	}
 
-	g_free(tar_path);
-	g_free(extract_dir);
-	g_free(quoted_cmd);
-	g_free(subcommand);
+	tmp = gebr_temp_directory_create ();
+	self->extract_dir = g_string_free (tmp, FALSE);
 
-	GError *error = NULL;
-	int exit = 0;
+	self->done = self->last_progress = 0;
+	self->total = st.st_size;
+	report_progress (self, TRUE);
 
-	if (!g_spawn_command_line_sync (command, &output,
-					&stderr, &exit, &error)) {
-		g_free (command);
-		return FALSE;
-	}
+	ret = extract_all (self, r);
+	if (ret)
+		report_progress (self, TRUE);
 
-	files = g_strsplit (output, "\n", 0);
-	for (int i = 0; files[i]; i++)
-		self->files = g_list_prepend (self->files, files[i]);
-	self->files = g_list_reverse (self->files);
+	reader_end (r);
+	fclose (r->fp);
+	g_free (r);
 
-	g_free (files);
-	g_free (command);
-	g_free (output);
-	g_free (stderr);
-	return TRUE;
+	return ret;
 }
 
 void gebr_tar_foreach (GebrTar *self, GebrTarFunc func, gpointer data)
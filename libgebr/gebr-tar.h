@@ -25,6 +25,26 @@ G_BEGIN_DECLS
 typedef struct _GebrTar GebrTar;
 typedef void (*GebrTarFunc) (const gchar *file, gpointer data);
 
+/**
+ * GebrTarProgressFunc:
+ * @self: the #GebrTar being compacted or extracted
+ * @done: the amount of bytes processed so far
+ * @total: the amount of bytes to process
+ * @data: the data given to gebr_tar_set_progress_func()
+ *
+ * When compacting, the bytes are those of the files being archived; when
+ * extracting, those of the compressed archive.
+ */
+typedef void (*GebrTarProgressFunc) (GebrTar *self, guint64 done, guint64 total, gpointer data);
+
+/**
+ * GEBR_TAR_DEFAULT_LEVEL:
+ *
+ * The compression level used unless gebr_tar_set_level() is called, the
+ * same as the default of xz.
+ */
+#define GEBR_TAR_DEFAULT_LEVEL 6
+
 /**
  * gebr_tar_new:
  * @path: the path for a new tar file
@@ -51,14 +71,58 @@ void gebr_tar_append (GebrTar *self, const gchar *path);
  * @self: a #GebrTar created with gebr_tar_create()
  * @root_dir: the directory in which files are searched for
  *
- * Compacts the files into a gziped tar. The @root_dir specifies the directory in
+ * Compacts the files into a xz compressed tar. The @root_dir specifies the directory in
  * which files are searched for. The @root_dir is equivalent to the -C option of
- * tar command line.
+ * tar command line. If no file was appended, the whole @root_dir is compacted.
  *
- * Returns: %TRUE if compact was successful, %FALSE otherwise.
+ * The archive is written as it is compressed, using as many threads as the
+ * compression level allows for the available memory. It can be read by the
+ * tar and xz command line tools.
+ *
+ * Returns: %TRUE if compact was successful, %FALSE otherwise. The archive is
+ * removed if it could not be completed or if gebr_tar_cancel() was called.
  */
 gboolean gebr_tar_compact (GebrTar *self, const gchar *root_dir);
 
+/**
+ * gebr_tar_set_level:
+ * @self: a #GebrTar created with gebr_tar_create()
+ * @level: the compression level, from 0 (fastest) to 9 (smallest)
+ *
+ * Chooses between speed and ratio for gebr_tar_compact(). The default is
+ * %GEBR_TAR_DEFAULT_LEVEL.
+ */
+void gebr_tar_set_level (GebrTar *self, gint level);
+
+/**
+ * gebr_tar_set_progress_func:
+ * @self: a #GebrTar
+ * @func: a function called as gebr_tar_compact() or gebr_tar_extract() advance, or %NULL
+ * @data: data to pass to @func calls
+ *
+ * @func is called in the thread running the operation, when it starts, at
+ * each megabyte processed and when it finishes successfully.
+ */
+void gebr_tar_set_progress_func (GebrTar *self, GebrTarProgressFunc func, gpointer data);
+
+/**
+ * gebr_tar_cancel:
+ * @self: a #GebrTar
+ *
+ * Stops a gebr_tar_compact() or gebr_tar_extract() in progress, which will
+ * return %FALSE. It can be called from the progress function or from
+ * another thread.
+ */
+void gebr_tar_cancel (GebrTar *self);
+
+/**
+ * gebr_tar_is_cancelled:
+ * @self: a #GebrTar
+ *
+ * Returns: %TRUE if gebr_tar_cancel() was called on @self.
+ */
+gboolean gebr_tar_is_cancelled (GebrTar *self);
+
 /**
  * gebr_tar_new_from_file:
  * @path: a path for a file on the system
@@ -81,6 +145,10 @@ const gchar *gebr_tar_get_dir (GebrTar *self);
  * can extract it by calling this function on it. The extraction is done in a temporary
  * folder. To access the files you should use the gebr_tar_foreach() method.
  *
+ * Archives compressed with xz or gzip, or not compressed, are recognized by
+ * their contents. Members that would be extracted out of the temporary folder
+ * are ignored.
+ *
  * <note>
  *  <para>
  *   The temporary folder is deleted when gebr_tar_free() is called.
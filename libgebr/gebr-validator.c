@@ -19,6 +19,10 @@ struct _GebrValidator
 	GHashTable *vars;
 	// Scope of the last sync with BC
 	GebrGeoXmlDocumentType cached_scope;
+	// Results of evaluations, see cache_lookup()
+	GHashTable *cache;
+	guint cache_hits;
+	guint cache_misses;
 };
 
 typedef struct {
@@ -29,6 +33,13 @@ typedef struct {
 	GError *error[3];
 } HashData;
 
+typedef struct {
+	gboolean ok;
+	gchar *value;
+	GError *error;
+	GList *deps;
+} CacheEntry;
+
 static GebrGeoXmlDocument *cache_docs[] = { NULL, NULL, NULL};
 
 #define MAX_RESULT_LENGTH 68
@@ -65,6 +76,9 @@ static gboolean gebr_validator_evaluate_internal(GebrValidator *self,
                                                  gboolean show_interval,
                                                  GError **error);
 
+static void cache_invalidate(GebrValidator *self,
+                             const gchar *name);
+
 /* NodeData functions {{{1 */
 static HashData *
 hash_data_new_from_xml(GebrGeoXmlParameter *param)
@@ -108,6 +122,8 @@ hash_data_remove(GebrValidator *self,
 		return FALSE;
 	}
 
+	cache_invalidate(self, name);
+
 	gebr_geoxml_object_unref(data->param[scope]);
 	data->param[scope] = NULL;
 	data->weight[scope] = G_MAXDOUBLE;
@@ -706,6 +722,159 @@ gebr_validator_update_vars(GebrValidator *self,
 	return ok;
 }
 
+/* Evaluation cache {{{1 */
+static void
+cache_entry_free(gpointer p)
+{
+	CacheEntry *entry = p;
+	g_free(entry->value);
+	if (entry->error)
+		g_error_free(entry->error);
+	g_list_foreach(entry->deps, (GFunc) g_free, NULL);
+	g_list_free(entry->deps);
+	g_free(entry);
+}
+
+static gchar *
+cache_key(const gchar *name,
+	  const gchar *expr,
+	  GebrGeoXmlParameterType type,
+	  GebrGeoXmlDocumentType scope,
+	  gboolean show_interval)
+{
+	return g_strdup_printf("%d:%d:%d:%s:%s", type, scope, show_interval ? 1 : 0,
+			       name ? name : "", expr);
+}
+
+/*
+ * cache_lookup:
+ *
+ * Fetches the result of a previous evaluation stored with @key, setting
+ * @ok, @value and @error as the evaluation did.
+ *
+ * Returns: %TRUE if @key was found in the cache
+ */
+static gboolean
+cache_lookup(GebrValidator *self,
+	     const gchar *key,
+	     gboolean *ok,
+	     gchar **value,
+	     GError **error)
+{
+	CacheEntry *entry = g_hash_table_lookup(self->cache, key);
+
+	if (!entry) {
+		self->cache_misses++;
+		return FALSE;
+	}
+
+	self->cache_hits++;
+	*ok = entry->ok;
+	if (!entry->ok)
+		g_propagate_error(error, g_error_copy(entry->error));
+	else if (value)
+		*value = g_strdup(entry->value);
+	return TRUE;
+}
+
+/*
+ * cache_insert:
+ *
+ * Stores the result of evaluating @expr with the variables it references,
+ * which are used by cache_invalidate(). Takes ownership of @key.
+ */
+static void
+cache_insert(GebrValidator *self,
+	     gchar *key,
+	     const gchar *name,
+	     const gchar *expr,
+	     GebrGeoXmlParameterType type,
+	     gboolean ok,
+	     const gchar *value,
+	     const GError *error)
+{
+	CacheEntry *entry;
+
+	// Initialization failures may go away on the next try
+	if (error && error->code == GEBR_IEXPR_ERROR_INITIALIZE) {
+		g_free(key);
+		return;
+	}
+
+	entry = g_new0(CacheEntry, 1);
+	entry->ok = ok;
+	entry->value = g_strdup(value);
+	entry->error = error ? g_error_copy(error) : NULL;
+
+	if (get_validator_by_type(self, type) == GEBR_IEXPR(self->arith_expr))
+		entry->deps = gebr_iexpr_extract_vars(GEBR_IEXPR(self->arith_expr), expr);
+	else
+		translate_string_expr(self, expr, NULL, GEBR_GEOXML_DOCUMENT_TYPE_FLOW, NULL, &entry->deps, NULL);
+	if (name)
+		entry->deps = g_list_prepend(entry->deps, g_strdup(name));
+
+	g_hash_table_insert(self->cache, key, entry);
+}
+
+/*
+ * cache_invalidate:
+ *
+ * Drops cached results depending on @name, directly or through the
+ * dependencies of other variables. If @name is %NULL, drops all of them.
+ */
+static void
+cache_invalidate(GebrValidator *self,
+		 const gchar *name)
+{
+	GHashTable *affected;
+	GHashTableIter iter;
+	gpointer key, value;
+	gboolean changed = TRUE;
+
+	if (!name) {
+		g_hash_table_remove_all(self->cache);
+		return;
+	}
+
+	if (!g_hash_table_size(self->cache))
+		return;
+
+	affected = g_hash_table_new(g_str_hash, g_str_equal);
+	g_hash_table_insert(affected, (gpointer) name, GINT_TO_POINTER(1));
+
+	while (changed) {
+		changed = FALSE;
+		g_hash_table_iter_init(&iter, self->vars);
+		while (g_hash_table_iter_next(&iter, &key, &value)) {
+			HashData *data = value;
+			if (g_hash_table_lookup(affected, key))
+				continue;
+			for (int i = 0; i < 3 && !g_hash_table_lookup(affected, key); i++) {
+				for (GList *j = data->dep[i]; j; j = j->next) {
+					if (g_hash_table_lookup(affected, j->data)) {
+						g_hash_table_insert(affected, key, GINT_TO_POINTER(1));
+						changed = TRUE;
+						break;
+					}
+				}
+			}
+		}
+	}
+
+	g_hash_table_iter_init(&iter, self->cache);
+	while (g_hash_table_iter_next(&iter, &key, &value)) {
+		CacheEntry *entry = value;
+		for (GList *i = entry->deps; i; i = i->next) {
+			if (g_hash_table_lookup(affected, i->data)) {
+				g_hash_table_iter_remove(&iter);
+				break;
+			}
+		}
+	}
+
+	g_hash_table_unref(affected);
+}
+
 /* Public functions {{{1 */
 GebrValidator *
 gebr_validator_new(GebrGeoXmlDocument **flow,
@@ -727,6 +896,13 @@ gebr_validator_new(GebrGeoXmlDocument **flow,
 					   g_free,
 					   hash_data_free);
 
+	self->cache = g_hash_table_new_full(g_str_hash,
+					    g_str_equal,
+					    g_free,
+					    cache_entry_free);
+	self->cache_hits = 0;
+	self->cache_misses = 0;
+
 	gebr_arith_expr_eval_internal(self->arith_expr, "scale=5", NULL, NULL);
 	self->cached_scope = GEBR_GEOXML_DOCUMENT_TYPE_UNKNOWN;
 	gebr_validator_update(self);
@@ -863,6 +1039,8 @@ gebr_validator_rename(GebrValidator       *self,
 
 	data = g_hash_table_lookup(self->vars, name);
 	g_return_val_if_fail(data != NULL, FALSE);
+	cache_invalidate(self, name);
+	cache_invalidate(self, new_name);
 	SET_VAR_NAME(param, new_name);
 
 	new_data = g_hash_table_lookup(self->vars, new_name);
@@ -901,6 +1079,7 @@ gebr_validator_change_value(GebrValidator       *self,
 
 	name = GET_VAR_NAME(param);
 	scope = gebr_geoxml_parameter_get_scope(param);
+	cache_invalidate(self, name);
 
 	if (gebr_geoxml_program_parameter_get_required(GEBR_GEOXML_PROGRAM_PARAMETER(param)) && !*new_value) {
 		g_set_error(&err,
@@ -1131,6 +1310,7 @@ gebr_validator_clean_cache(GebrValidator *self)
 
 		if (i == GEBR_GEOXML_DOCUMENT_TYPE_PROJECT) {
 			g_hash_table_remove_all(self->vars);
+			cache_invalidate(self, NULL);
 
 			gebr_geoxml_document_unref(cache_docs[GEBR_GEOXML_DOCUMENT_TYPE_PROJECT]);
 			cache_docs[GEBR_GEOXML_DOCUMENT_TYPE_PROJECT] = NULL;
@@ -1176,6 +1356,7 @@ void gebr_validator_update(GebrValidator *self)
 void gebr_validator_force_update(GebrValidator *self)
 {
 	g_hash_table_remove_all(self->vars);
+	cache_invalidate(self, NULL);
 
 	for (int i = GEBR_GEOXML_DOCUMENT_TYPE_PROJECT; i >= GEBR_GEOXML_DOCUMENT_TYPE_FLOW; i--) {
 		GebrGeoXmlSequence *seq;
@@ -1195,6 +1376,7 @@ void gebr_validator_force_update(GebrValidator *self)
 void gebr_validator_free(GebrValidator *self)
 {
 	g_hash_table_unref(self->vars);
+	g_hash_table_unref(self->cache);
 	g_object_unref(self->arith_expr);
 	g_free(self);
 }
@@ -1239,7 +1421,7 @@ gebr_validator_use_iter(GebrValidator *self,
 	return !valid;
 }
 
-static gboolean gebr_validator_evaluate_internal(GebrValidator *self,
+static gboolean gebr_validator_evaluate_uncached(GebrValidator *self,
                                                  const gchar *name,
                                                  const gchar *expr,
                                                  GebrGeoXmlParameterType type,
@@ -1305,6 +1487,44 @@ err:
 	return FALSE;
 }
 
+/*
+ * Evaluates with gebr_validator_evaluate_uncached() only if there is no
+ * cached result, updating the error of @name as it would do.
+ */
+static gboolean gebr_validator_evaluate_internal(GebrValidator *self,
+                                                 const gchar *name,
+                                                 const gchar *expr,
+                                                 GebrGeoXmlParameterType type,
+                                                 gchar **value,
+                                                 GebrGeoXmlDocumentType scope,
+                                                 gboolean show_interval,
+                                                 GError **error)
+{
+	gboolean ok;
+	gchar *result = NULL;
+	GError *err = NULL;
+	gchar *key = cache_key(name, expr, type, scope, show_interval);
+
+	if (cache_lookup(self, key, &ok, &result, &err)) {
+		g_free(key);
+		if (!ok && err->code >= GEBR_IEXPR_ERROR_EMPTY_EXPR && err->code <= GEBR_IEXPR_ERROR_SYNTAX)
+			set_error(self, name, scope, err);
+		else
+			set_error(self, name, scope, NULL);
+	} else {
+		ok = gebr_validator_evaluate_uncached(self, name, expr, type, &result, scope, show_interval, &err);
+		cache_insert(self, key, name, expr, type, ok, result, err);
+	}
+
+	if (value)
+		*value = result;
+	else
+		g_free(result);
+	if (err)
+		g_propagate_error(error, err);
+	return ok;
+}
+
 gboolean gebr_validator_evaluate_interval(GebrValidator *self,
                                           const gchar *expr,
                                           GebrGeoXmlParameterType type,
@@ -1322,13 +1542,39 @@ gboolean gebr_validator_evaluate_interval(GebrValidator *self,
 		return TRUE;
 	}
 
-	if(!gebr_validator_update_vars(self, scope, error))
-		return FALSE;
+	// Paths are also checked against the line paths, which are not tracked
+	gboolean cacheable = type != GEBR_GEOXML_PARAMETER_TYPE_FILE;
+	gchar *key = NULL;
+	gchar *result = NULL;
+	GError *err = NULL;
+	gboolean ok;
 
-	if (!gebr_validator_validate_expr_on_scope(self, expr, type, scope, error))
+	if (cacheable) {
+		key = cache_key(NULL, expr, type, scope, show_interval);
+		if (cache_lookup(self, key, &ok, value, error)) {
+			g_free(key);
+			return ok;
+		}
+	}
+
+	if(!gebr_validator_update_vars(self, scope, error)) {
+		g_free(key);
 		return FALSE;
+	}
 
-	return gebr_validator_evaluate_internal(self, NULL, expr, type, value, scope, show_interval, error);
+	ok = gebr_validator_validate_expr_on_scope(self, expr, type, scope, &err)
+		&& gebr_validator_evaluate_uncached(self, NULL, expr, type, &result, scope, show_interval, &err);
+
+	if (cacheable)
+		cache_insert(self, key, NULL, expr, type, ok, result, err);
+
+	if (value)
+		*value = result;
+	else
+		g_free(result);
+	if (err)
+		g_propagate_error(error, err);
+	return ok;
 }
 
 gboolean gebr_validator_evaluate(GebrValidator *self,
@@ -1376,6 +1622,17 @@ gboolean gebr_validator_evaluate_param(GebrValidator *self,
 	return gebr_validator_evaluate_internal(self, name, expr, type, value, scope, TRUE, error);
 }
 
+void
+gebr_validator_get_cache_stats(GebrValidator *self,
+                               guint *hits,
+                               guint *misses)
+{
+	if (hits)
+		*hits = self->cache_hits;
+	if (misses)
+		*misses = self->cache_misses;
+}
+
 gboolean
 gebr_validator_is_var_in_scope(GebrValidator *self,
 			       const gchar *name,
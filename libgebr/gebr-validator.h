@@ -263,6 +263,19 @@ gboolean gebr_validator_evaluate_param(GebrValidator *self,
                                        gchar **value,
                                        GError **error);
 
+/**
+ * gebr_validator_get_cache_stats:
+ * @validator: The #GebrValidator to be used
+ * @hits: Return location for the number of evaluations answered by the cache, or %NULL
+ * @misses: Return location for the number of evaluations that were computed, or %NULL
+ *
+ * Results of gebr_validator_evaluate() and friends are cached until a
+ * variable they depend on, directly or not, is changed.
+ */
+void gebr_validator_get_cache_stats(GebrValidator *self,
+                                    guint *hits,
+                                    guint *misses);
+
 /**
  * gebr_validator_is_var_in_scope:
  * @validator:
@@ -27,13 +27,13 @@
 #include <stdio.h>
 #include <errno.h>
 #include <stdarg.h>
-#include <fcntl.h>
 
 #include <glib/gstdio.h>
 #include <glib/gi18n-lib.h>
 #include <gdome.h>
 #include <libxml/parser.h>
 #include <libxml/catalog.h>
+#include <libxml/xmlerror.h>
 
 #if HAVE_TIDY_TIDY_H
 # include <tidy/tidy.h>
@@ -49,6 +49,7 @@
 #include "document_p.h"
 #include "error.h"
 #include "flow.h"
+#include "flow_p.h"
 #include "line.h"
 #include "object.h"
 #include "parameter.h"
@@ -72,9 +73,9 @@
 /* global variables */
 /**
  * \internal
- * Global variable.
+ * Global variable, one for each thread.
  */
-GdomeException exception;
+__thread GdomeException exception;
 
 /**
  * \internal
@@ -101,8 +102,15 @@ GdomeDocument *clipboard_document = NULL;
 
 static const gchar *dtd_directory = GEBR_GEOXML_DTD_DIR;
 
-static gint xml_error_fd;
-static gchar *xml_err_path;
+/**
+ * \internal
+ * Checksums of the documents already validated, which were at their
+ * current version.
+ */
+static GHashTable *validated_documents = NULL;
+static guint validated_hits = 0;
+static guint validated_misses = 0;
+G_LOCK_DEFINE_STATIC(validated_documents);
 
 /**
  * \internal
@@ -116,6 +124,12 @@ static gboolean gebr_geoxml_document_is_version_valid(const gchar * version);
  */
 static gboolean gebr_geoxml_document_check_version(GebrGeoXmlDocument * document, const gchar * version);
 
+/**
+ * \internal
+ * Returns the version GeBR writes for documents of the type of \p document, or NULL.
+ */
+static const gchar *gebr_geoxml_document_get_current_version(GebrGeoXmlDocument * document);
+
 /**
  * \internal
  */
@@ -145,18 +159,14 @@ void gebr_geoxml_document_update_header(GdomeDOMImplementation *dom_implementati
                                         const gchar *name,
                                         const gchar *version);
 
-static void
-gebr_geoxml_create_xml_error_file(void)
-{
-	xml_err_path = g_build_filename(g_get_home_dir(), ".gebr", "tmp", "validate-xml.err", NULL);
-	xml_error_fd = open(xml_err_path, O_CREAT | O_RDWR, 0777);
-}
-
 void gebr_geoxml_init(void)
 {
+	/* libxml2 must be initialized once, before documents are loaded by
+	 * threads */
+	xmlInitParser();
 	gebr_geoxml_create_catalog(GEBR_GEOXML_DTD_DIR);
 
-	gebr_geoxml_create_xml_error_file();
+	validated_documents = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
 
 	GdomeDOMString *string = gdome_str_mkref("gebr-geoxml-clipboard");
 	dom_implementation = gdome_di_mkref();
@@ -171,9 +181,10 @@ void gebr_geoxml_finalize(void)
 	gdome_doc_unref(clipboard_document, &exception);
 	clipboard_document = NULL;
 
-	g_unlink(xml_err_path);
-	g_free(xml_err_path);
-	close(xml_error_fd);
+	G_LOCK(validated_documents);
+	g_hash_table_destroy(validated_documents);
+	validated_documents = NULL;
+	G_UNLOCK(validated_documents);
 }
 
 static gchar *
@@ -329,9 +340,15 @@ __port_to_new_group_semantics(GdomeElement *root_element)
 /**
  * \internal
  */
+/**
+ * \internal
+ * Upgrades \p document to the current version and fixes invalid values.
+ * \p normalized, if not NULL, is set to TRUE if a value was fixed.
+ */
 static int
 __gebr_geoxml_document_validate_doc(GdomeDocument ** document,
-				    GebrGeoXmlDiscardMenuRefCallback discard_menu_ref)
+				    GebrGeoXmlDiscardMenuRefCallback discard_menu_ref,
+				    gboolean *normalized)
 {
 	gchar *version;
 
@@ -1052,6 +1069,21 @@ __gebr_geoxml_document_validate_doc(GdomeDocument ** document,
 		}
 	}
 
+	/* 0.4.0 to 0.4.1 */
+	if (strcmp(version, "0.4.1") < 0) {
+		if (gebr_geoxml_document_get_type(GEBR_GEOXML_DOCUMENT(*document)) == GEBR_GEOXML_DOCUMENT_TYPE_FLOW) {
+			gebr_geoxml_document_update_header(dom_implementation, document, "flow", GEBR_GEOXML_FLOW_VERSION);
+
+			gdome_el_unref(root_element, &exception);
+			root_element = gebr_geoxml_document_root_element(*document);
+
+			__gebr_geoxml_set_attr_value(root_element, "version", "0.4.1");
+
+			/* revisions are kept as deltas */
+			__gebr_geoxml_flow_revisions_to_delta(GEBR_GEOXML_FLOW(*document));
+		}
+	}
+
 	/* CHECKS (may impact performance) */
 	if (gebr_geoxml_document_get_type(((GebrGeoXmlDocument *) *document)) == GEBR_GEOXML_DOCUMENT_TYPE_FLOW) {
 		GSList *elements = __gebr_geoxml_get_elements_by_tag(root_element, "flag");
@@ -1066,13 +1098,19 @@ __gebr_geoxml_document_validate_doc(GdomeDocument ** document,
 			default_value_element = __gebr_geoxml_get_first_element(element, "default");
 
 			val = __gebr_geoxml_get_element_value(value_element);
-			if (strcmp(val, "on") && strcmp(val, "off"))
+			if (strcmp(val, "on") && strcmp(val, "off")) {
 				__gebr_geoxml_set_element_value(value_element, "off", __gebr_geoxml_create_TextNode);
+				if (normalized)
+					*normalized = TRUE;
+			}
 			g_free(val);
 
 			val = __gebr_geoxml_get_element_value(default_value_element);
-			if (strcmp(val, "on") && strcmp(val, "off"))
+			if (strcmp(val, "on") && strcmp(val, "off")) {
 				__gebr_geoxml_set_element_value(default_value_element, "off", __gebr_geoxml_create_TextNode);
+				if (normalized)
+					*normalized = TRUE;
+			}
 			g_free(val);
 
 			gdome_el_unref(element, &exception);
@@ -1149,7 +1187,7 @@ static int __gebr_geoxml_document_load_buffer(GebrGeoXmlDocument ** document, co
 	/* load */
 	doc = gdome_di_createDocFromMemory(dom_implementation, (gchar *) xml, GDOME_LOAD_PARSING, &exception);
 
-	ret = __gebr_geoxml_document_validate_doc(&doc, NULL);
+	ret = __gebr_geoxml_document_validate_doc(&doc, NULL, NULL);
 	if (ret != GEBR_GEOXML_RETV_SUCCESS) {
 		gdome_doc_unref((GdomeDocument *) doc, &exception);
 		return ret;
@@ -1160,58 +1198,155 @@ static int __gebr_geoxml_document_load_buffer(GebrGeoXmlDocument ** document, co
 	return GEBR_GEOXML_RETV_SUCCESS;
 }
 
+/**
+ * \internal
+ * Collects the errors libxml2 reports while a document is parsed. libxml2
+ * keeps the handlers per thread, so documents can be loaded concurrently.
+ */
+static void
+on_xml_structured_error(void *data, xmlErrorPtr error)
+{
+	GString *errors = data;
+
+	if (error->level < XML_ERR_ERROR)
+		return;
+
+	g_string_append(errors, error->message);
+}
+
+static void
+on_xml_generic_error(void *data, const char *msg, ...)
+{
+	GString *errors = data;
+	va_list args;
+
+	va_start(args, msg);
+	g_string_append_vprintf(errors, msg, args);
+	va_end(args);
+}
+
+static gboolean
+is_document_validated(const gchar *checksum)
+{
+	gboolean validated;
+
+	G_LOCK(validated_documents);
+	validated = validated_documents && g_hash_table_lookup(validated_documents, checksum);
+	if (validated)
+		validated_hits++;
+	else
+		validated_misses++;
+	G_UNLOCK(validated_documents);
+
+	return validated;
+}
+
+static void
+set_document_validated(const gchar *checksum)
+{
+	G_LOCK(validated_documents);
+	if (validated_documents)
+		g_hash_table_insert(validated_documents, g_strdup(checksum), GINT_TO_POINTER(TRUE));
+	G_UNLOCK(validated_documents);
+}
+
+void
+__gebr_geoxml_document_get_cache_stats(guint *hits, guint *misses)
+{
+	G_LOCK(validated_documents);
+	*hits = validated_hits;
+	*misses = validated_misses;
+	G_UNLOCK(validated_documents);
+}
+
+void
+__gebr_geoxml_document_clear_cache(void)
+{
+	G_LOCK(validated_documents);
+	if (validated_documents)
+		g_hash_table_remove_all(validated_documents);
+	G_UNLOCK(validated_documents);
+}
+
+/**
+ * \internal
+ * Documents which were loaded before at their current version, and needed no
+ * fixes, are not validated against the DTD again, nor go through the upgrade
+ * chain. The DTD is still read to fill in default attributes.
+ */
 static int __gebr_geoxml_document_load(GebrGeoXmlDocument ** document, const gchar *path,
 				       gboolean validate, GebrGeoXmlDiscardMenuRefCallback discard_menu_ref)
 {
 	GdomeDocument *doc;
+	GString *contents;
+	GString *errors;
+	gchar *checksum;
+	gboolean validated;
+	xmlStructuredErrorFunc old_structured;
+	xmlGenericErrorFunc old_generic;
+	void *old_structured_data;
+	void *old_generic_data;
 	int ret;
 
-	//TODO: Try using file on memory to get XML error
-	/* Save STDERR file descriptor to restore */
-	int stderr_fd = dup(STDERR_FILENO);
-
-	/* Change STDERR to temporary file for read error after validating XML */
-	dup2(xml_error_fd, STDERR_FILENO);
-
-	GString *contents = g_string_new(NULL);
-
+	contents = g_string_new(NULL);
 	gebr_geoxml_document_fix_header(path, contents);
 
+	checksum = g_compute_checksum_for_data(G_CHECKSUM_SHA1, (guchar *) contents->str, contents->len);
+	validated = is_document_validated(checksum);
+
 	/* load */
-	doc = gdome_di_createDocFromMemory(dom_implementation, (gchar *) contents->str, GDOME_LOAD_VALIDATING, &exception);
+	errors = g_string_new(NULL);
+	old_structured = xmlStructuredError;
+	old_structured_data = xmlStructuredErrorContext;
+	old_generic = xmlGenericError;
+	old_generic_data = xmlGenericErrorContext;
+	xmlSetStructuredErrorFunc(errors, on_xml_structured_error);
+	xmlSetGenericErrorFunc(errors, on_xml_generic_error);
+
+	doc = gdome_di_createDocFromMemory(dom_implementation, (gchar *) contents->str,
+					   validated ? GDOME_LOAD_COMPLETE_ATTRS : GDOME_LOAD_VALIDATING,
+					   &exception);
 
+	xmlSetStructuredErrorFunc(old_structured_data, old_structured);
+	xmlSetGenericErrorFunc(old_generic_data, old_generic);
 	g_string_free(contents, TRUE);
 
-	/* Get the error on file */
-	gchar *error_xml;
-	g_file_get_contents(xml_err_path, &error_xml, NULL, NULL);
-
-	/* Remove file and close FD, and re-open STDERR */
-	dup2(stderr_fd ,STDERR_FILENO);
-	close(stderr_fd);
-
-	if (error_xml && strlen(error_xml) > 0) {
+	if (!doc || errors->len) {
+		g_debug("======> XML ERROR: '%s'", errors->str);
+		g_string_free(errors, TRUE);
+		if (doc)
+			gdome_doc_unref(doc, &exception);
 		ret = GEBR_GEOXML_RETV_INVALID_DOCUMENT;
-		g_debug("======> XML ERROR: '%s'", error_xml);
-		g_free(error_xml);
-		g_file_set_contents(xml_err_path, "", -1, NULL);
 		goto err;
 	}
-	g_free(error_xml);
+	g_string_free(errors, TRUE);
 
-	if (validate) {
-		ret = __gebr_geoxml_document_validate_doc(&doc, discard_menu_ref);
+	if (validate && !validated) {
+		gchar *version = gebr_geoxml_document_get_version((GebrGeoXmlDocument *) doc);
+		const gchar *current = gebr_geoxml_document_get_current_version((GebrGeoXmlDocument *) doc);
+		gboolean is_current = version && current && !strcmp(version, current);
+		gboolean normalized = FALSE;
+		g_free(version);
+
+		ret = __gebr_geoxml_document_validate_doc(&doc, discard_menu_ref, &normalized);
 		if (ret != GEBR_GEOXML_RETV_SUCCESS) {
 			gdome_doc_unref((GdomeDocument *) doc, &exception);
 			goto err;
 		}
+
+		/* A hit skips the fixes, so only documents which need none
+		 * are remembered */
+		if (is_current && !normalized)
+			set_document_validated(checksum);
 	}
+	g_free(checksum);
 
 	*document = (GebrGeoXmlDocument *) doc;
 	__gebr_geoxml_document_new_data(*document, "");
 	return GEBR_GEOXML_RETV_SUCCESS;
 
  err:
+	g_free(checksum);
 	*document = NULL;
 	return ret;
 }
@@ -1773,25 +1908,29 @@ static gboolean gebr_geoxml_document_is_version_valid(const gchar * version)
 	return sscanf(version, "%d.%d.%d", &major, &minor, &micro) == 3;
 }
 
-static gboolean gebr_geoxml_document_check_version(GebrGeoXmlDocument * document, const gchar * version)
+static const gchar *gebr_geoxml_document_get_current_version(GebrGeoXmlDocument * document)
 {
-	guint major1, minor1, micro1;
-	guint major2, minor2, micro2;
-	const gchar * doc_version;
-
 	switch (gebr_geoxml_document_get_type(document)) {
 	case GEBR_GEOXML_DOCUMENT_TYPE_FLOW:
-		doc_version = GEBR_GEOXML_FLOW_VERSION;
-		break;
+		return GEBR_GEOXML_FLOW_VERSION;
 	case GEBR_GEOXML_DOCUMENT_TYPE_LINE:
-		doc_version = GEBR_GEOXML_LINE_VERSION;
-		break;
+		return GEBR_GEOXML_LINE_VERSION;
 	case GEBR_GEOXML_DOCUMENT_TYPE_PROJECT:
-		doc_version = GEBR_GEOXML_PROJECT_VERSION;
-		break;
+		return GEBR_GEOXML_PROJECT_VERSION;
 	default:
-		return FALSE;
+		return NULL;
 	}
+}
+
+static gboolean gebr_geoxml_document_check_version(GebrGeoXmlDocument * document, const gchar * version)
+{
+	guint major1, minor1, micro1;
+	guint major2, minor2, micro2;
+	const gchar * doc_version;
+
+	doc_version = gebr_geoxml_document_get_current_version(document);
+	if (!doc_version)
+		return FALSE;
 
 	if (sscanf(version, "%d.%d.%d", &major1, &minor1, &micro1) != 3)
 		return FALSE;
@@ -84,6 +84,8 @@ void gebr_geoxml_finalize(void);
 /**
  * Load a document XML file at \p path into \p document.
  * The document is validated using the proper DTD. Invalid documents are not loaded.
+ * A document with the same contents as one already validated at its current version
+ * is not validated again. Parser errors are collected per thread, without redirecting stderr.
  * The filename is set according to \p path (see #gebr_geoxml_document_set_filename).
  *
  * Returns one of: GEBR_GEOXML_RETV_SUCCESS, GEBR_GEOXML_RETV_NO_MEMORY,
@@ -50,5 +50,19 @@ typedef struct {
 #define _gebr_geoxml_document_get_data(document) \
 	((GebrGeoXmlDocumentData*)((GdomeDocument*)document)->user_data)
 
+/**
+ * \internal
+ * The number of loads which found the contents of the document among the ones
+ * already validated, and of the ones which did not, since the process started.
+ */
+void __gebr_geoxml_document_get_cache_stats(guint *hits, guint *misses);
+
+/**
+ * \internal
+ * Forgets the documents already validated, so the next loads validate them
+ * again. For the benchmarks.
+ */
+void __gebr_geoxml_document_clear_cache(void);
+
 G_END_DECLS
 #endif				//__GEBR_GEOXML_DOCUMENT_P_H
@@ -29,10 +29,12 @@
 #include <stdlib.h>
 
 #include "../date.h"
+#include "../gebr-delta.h"
 #include "document.h"
 #include "document_p.h"
 #include "error.h"
 #include "flow.h"
+#include "flow_p.h"
 #include "line.h"
 #include "object.h"
 #include "parameter.h"
@@ -42,6 +44,7 @@
 #include "program-parameter.h"
 #include "program.h"
 #include "sequence.h"
+#include "sequence_p.h"
 #include "types.h"
 #include "value_sequence.h"
 #include "xml.h"
@@ -62,6 +65,10 @@ struct gebr_geoxml_revision {
 	GdomeElement *element;
 };
 
+/* Revisions are stored as deltas from their parent revision; every
+ * MAX_DELTA_CHAIN revisions the chain restarts from an empty flow. */
+#define MAX_DELTA_CHAIN 16
+
 /*
  *  internal
  */
@@ -153,6 +160,302 @@ get_flow_attr_property(GebrGeoXmlFlow *flow,
 
 	return prop_value;
 }
+
+/*
+ * Revisions
+ */
+
+static GdomeElement *
+revision_get_sibling(GdomeElement *revision,
+		     const gchar *id)
+{
+	GdomeElement *root = (GdomeElement *) gdome_el_parentNode(revision, &exception);
+	GdomeElement *sibling = __gebr_geoxml_get_first_element(root, "revision");
+
+	while (sibling) {
+		gchar *sibling_id = __gebr_geoxml_get_attr_value(sibling, "id");
+		gboolean found = g_strcmp0(sibling_id, id) == 0;
+
+		g_free(sibling_id);
+		if (found)
+			break;
+
+		GdomeElement *next = __gebr_geoxml_next_same_element(sibling);
+		gdome_el_unref(sibling, &exception);
+		sibling = next;
+	}
+	gdome_el_unref(root, &exception);
+
+	return sibling;
+}
+
+/*
+ * Returns the revisions stored as deltas from the revision with @id.
+ */
+static GSList *
+revision_get_dependents(GdomeElement *revision,
+			const gchar *id)
+{
+	GdomeElement *root = (GdomeElement *) gdome_el_parentNode(revision, &exception);
+	GdomeElement *sibling = __gebr_geoxml_get_first_element(root, "revision");
+	GSList *dependents = NULL;
+
+	while (id && *id && sibling) {
+		gchar *base_id = __gebr_geoxml_get_attr_value(sibling, "delta");
+		GdomeElement *next = __gebr_geoxml_next_same_element(sibling);
+
+		if (sibling != revision && g_strcmp0(base_id, id) == 0)
+			dependents = g_slist_prepend(dependents, sibling);
+		else
+			gdome_el_unref(sibling, &exception);
+
+		g_free(base_id);
+		sibling = next;
+	}
+	gdome_el_unref(sibling, &exception);
+	gdome_el_unref(root, &exception);
+
+	return g_slist_reverse(dependents);
+}
+
+/*
+ * Returns %TRUE if @revision is stored as a delta. @base_id is the id of the
+ * revision it refers to, or empty if it refers to an empty flow.
+ */
+static gboolean
+revision_get_base(GdomeElement *revision,
+		  gchar **base_id)
+{
+	GdomeDOMString *name = gdome_str_mkref("delta");
+	gboolean has_delta = gdome_el_hasAttribute(revision, name, &exception);
+
+	gdome_str_unref(name);
+	*base_id = has_delta ? __gebr_geoxml_get_attr_value(revision, "delta") : NULL;
+
+	return has_delta;
+}
+
+static gchar *
+revision_get_flow_xml(GdomeElement *revision)
+{
+	gchar *text = __gebr_geoxml_get_element_value(revision);
+	gchar *base_id;
+
+	if (!revision_get_base(revision, &base_id))
+		return text;
+
+	gchar *base_xml = NULL;
+	if (*base_id) {
+		GdomeElement *base = revision_get_sibling(revision, base_id);
+		if (base) {
+			base_xml = revision_get_flow_xml(base);
+			gdome_el_unref(base, &exception);
+		}
+	} else
+		base_xml = g_strdup("");
+
+	gchar *flow_xml = base_xml ? gebr_delta_decode(base_xml, text) : NULL;
+	if (!flow_xml) {
+		g_warning("Could not read revision based on '%s'", base_id);
+		flow_xml = g_strdup("");
+	}
+
+	g_free(base_xml);
+	g_free(base_id);
+	g_free(text);
+
+	return flow_xml;
+}
+
+/*
+ * Number of deltas decoded to read @revision.
+ */
+static guint
+revision_get_chain_length(GdomeElement *revision)
+{
+	gchar *base_id;
+	guint length = 0;
+
+	if (revision_get_base(revision, &base_id) && *base_id) {
+		GdomeElement *base = revision_get_sibling(revision, base_id);
+		if (base) {
+			length = revision_get_chain_length(base) + 1;
+			gdome_el_unref(base, &exception);
+		}
+	}
+	g_free(base_id);
+
+	return length;
+}
+
+/*
+ * Saves @flow_xml in @revision as a delta from @base_xml, the flow of the
+ * revision @base_id. If @base_id is %NULL, the whole flow is saved.
+ */
+static void
+revision_store(GdomeElement *revision,
+	       const gchar *flow_xml,
+	       const gchar *base_id,
+	       const gchar *base_xml)
+{
+	if (!base_id) {
+		__gebr_geoxml_remove_attr(revision, "delta");
+		__gebr_geoxml_set_element_value(revision, flow_xml, __gebr_geoxml_create_CDATASection);
+		return;
+	}
+
+	gchar *delta = gebr_delta_encode(base_xml, flow_xml);
+	__gebr_geoxml_set_attr_value(revision, "delta", base_id);
+	__gebr_geoxml_set_element_value(revision, delta, __gebr_geoxml_create_CDATASection);
+	g_free(delta);
+}
+
+/*
+ * Saves @flow_xml in @revision as a delta from the revision @parent_id, if
+ * it exists and its chain of deltas is not too long.
+ */
+static void
+revision_store_from_parent(GdomeElement *revision,
+			   const gchar *flow_xml,
+			   const gchar *parent_id)
+{
+	GdomeElement *parent = parent_id && *parent_id ? revision_get_sibling(revision, parent_id) : NULL;
+
+	if (parent && revision_get_chain_length(parent) + 1 < MAX_DELTA_CHAIN) {
+		gchar *parent_xml = revision_get_flow_xml(parent);
+		revision_store(revision, flow_xml, parent_id, parent_xml);
+		g_free(parent_xml);
+	} else
+		revision_store(revision, flow_xml, "", "");
+
+	gdome_el_unref(parent, &exception);
+}
+
+static guint
+revision_chain_depth(const gchar *id,
+		     GHashTable *parents,
+		     GHashTable *depths)
+{
+	gpointer depth = g_hash_table_lookup(depths, id);
+	if (depth)
+		return GPOINTER_TO_UINT(depth) - 1;
+
+	/* Breaks cycles */
+	g_hash_table_insert(depths, (gpointer) id, GUINT_TO_POINTER(1));
+
+	guint d = 0;
+	const gchar *parent_id = g_hash_table_lookup(parents, id);
+	if (parent_id && *parent_id && g_hash_table_lookup(parents, parent_id)) {
+		d = revision_chain_depth(parent_id, parents, depths) + 1;
+		if (d >= MAX_DELTA_CHAIN)
+			d = 0;
+	}
+	g_hash_table_insert(depths, (gpointer) id, GUINT_TO_POINTER(d + 1));
+
+	return d;
+}
+
+void
+__gebr_geoxml_flow_revisions_to_delta(GebrGeoXmlFlow *flow)
+{
+	GHashTable *parents = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+	/* keys of xmls and depths are owned by parents */
+	GHashTable *xmls = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, g_free);
+	GHashTable *depths = g_hash_table_new(g_str_hash, g_str_equal);
+	GebrGeoXmlSequence *seq;
+
+	/* Read all revisions before changing any of them */
+	gebr_geoxml_flow_get_revision(flow, &seq, 0);
+	for (; seq; gebr_geoxml_sequence_next(&seq)) {
+		GebrGeoXmlDocument *revdoc;
+		gchar *id = __gebr_geoxml_get_attr_value((GdomeElement *) seq, "id");
+
+		if (g_hash_table_lookup(parents, id)) {
+			g_free(id);
+			continue;
+		}
+
+		gchar *flow_xml = revision_get_flow_xml((GdomeElement *) seq);
+		gchar *parent_id = NULL;
+
+		if (gebr_geoxml_document_load_buffer(&revdoc, flow_xml) == GEBR_GEOXML_RETV_SUCCESS) {
+			parent_id = gebr_geoxml_document_get_parent_id(revdoc);
+			gebr_geoxml_document_free(revdoc);
+		}
+
+		g_hash_table_insert(parents, id, parent_id ? parent_id : g_strdup(""));
+		g_hash_table_insert(xmls, id, flow_xml);
+	}
+
+	gebr_geoxml_flow_get_revision(flow, &seq, 0);
+	for (; seq; gebr_geoxml_sequence_next(&seq)) {
+		gchar *id = __gebr_geoxml_get_attr_value((GdomeElement *) seq, "id");
+		gpointer key, parent_id;
+
+		if (g_hash_table_lookup_extended(parents, id, &key, &parent_id)) {
+			const gchar *flow_xml = g_hash_table_lookup(xmls, key);
+
+			if (revision_chain_depth(key, parents, depths) > 0)
+				revision_store((GdomeElement *) seq, flow_xml, parent_id,
+					       g_hash_table_lookup(xmls, parent_id));
+			else
+				revision_store((GdomeElement *) seq, flow_xml, "", "");
+		}
+
+		g_free(id);
+	}
+
+	g_hash_table_destroy(depths);
+	g_hash_table_destroy(xmls);
+	g_hash_table_destroy(parents);
+}
+
+void
+__gebr_geoxml_flow_revision_detach(GebrGeoXmlRevision *revision)
+{
+	GdomeElement *element = (GdomeElement *) revision;
+	gchar *id = __gebr_geoxml_get_attr_value(element, "id");
+	GSList *dependents = revision_get_dependents(element, id);
+
+	if (dependents) {
+		gchar *flow_xml = revision_get_flow_xml(element);
+		gchar *base_id;
+		gchar *base_xml = NULL;
+
+		/* The dependents take the base of revision */
+		if (!revision_get_base(element, &base_id))
+			base_id = g_strdup("");
+		if (*base_id) {
+			GdomeElement *base = revision_get_sibling(element, base_id);
+			if (base) {
+				base_xml = revision_get_flow_xml(base);
+				gdome_el_unref(base, &exception);
+			} else {
+				g_free(base_id);
+				base_id = g_strdup("");
+			}
+		}
+
+		for (GSList *i = dependents; i; i = i->next) {
+			gchar *text = __gebr_geoxml_get_element_value(i->data);
+			gchar *dependent_xml = gebr_delta_decode(flow_xml, text);
+
+			if (dependent_xml)
+				revision_store(i->data, dependent_xml, base_id, base_xml ? base_xml : "");
+			g_free(dependent_xml);
+			g_free(text);
+			gdome_el_unref(i->data, &exception);
+		}
+
+		g_free(base_xml);
+		g_free(base_id);
+		g_free(flow_xml);
+		g_slist_free(dependents);
+	}
+
+	g_free(id);
+}
+
 /*
  * library functions.
  */
@@ -477,14 +780,18 @@ gboolean gebr_geoxml_flow_change_to_revision(GebrGeoXmlFlow * flow, GebrGeoXmlRe
 		return FALSE;
 
 	gchar *revision_help;
+	gchar *revision_xml;
 	GebrGeoXmlDocument *revision_flow;
 	GebrGeoXmlSequence *first_revision;
 	GdomeElement *child;
 
 	/* load document validating it */
-	if (gebr_geoxml_document_load_buffer(&revision_flow,
-					     __gebr_geoxml_get_element_value((GdomeElement *) revision)))
+	revision_xml = revision_get_flow_xml((GdomeElement *) revision);
+	if (gebr_geoxml_document_load_buffer(&revision_flow, revision_xml)) {
+		g_free(revision_xml);
 		return FALSE;
+	}
+	g_free(revision_xml);
 
 	gchar *id;
 	gebr_geoxml_flow_get_revision_data(revision, NULL, NULL, NULL, &id);
@@ -543,7 +850,8 @@ gebr_geoxml_flow_append_revision(GebrGeoXmlFlow * flow,
 	revision_flow = GEBR_GEOXML_FLOW(gebr_geoxml_document_clone(GEBR_GEOXML_DOCUMENT(flow)));
 
 	GdomeElement * revision_root = gebr_geoxml_document_root_element(GEBR_GEOXML_DOCUMENT(revision_flow));
-	/* remove revisions from the revision flow. */
+	/* remove revisions from the revision flow, all of them, so their
+	 * deltas need not be rebased. */
 	gebr_geoxml_flow_get_revision(revision_flow, &seq, 0);
 
 	while (seq)
@@ -551,7 +859,7 @@ gebr_geoxml_flow_append_revision(GebrGeoXmlFlow * flow,
 		GebrGeoXmlSequence *aux = seq;
 		gebr_geoxml_object_ref(aux);
 		gebr_geoxml_sequence_next(&seq);
-		gebr_geoxml_sequence_remove(aux);
+		__gebr_geoxml_sequence_remove(aux);
 	}
 
 	gebr_geoxml_object_unref(revision_root);
@@ -569,8 +877,13 @@ gebr_geoxml_flow_append_revision(GebrGeoXmlFlow * flow,
 	gebr_geoxml_object_unref(root);
 	gebr_geoxml_object_unref(first_revision);
 
-	gebr_geoxml_flow_set_revision_data(revision, revision_xml, gebr_iso_date(),
+	gebr_geoxml_flow_set_revision_data(revision, NULL, gebr_iso_date(),
 					   comment, gebr_create_id_with_current_time()); 
+
+	/* save it as a delta from the revision the flow came from */
+	gchar *parent_id = gebr_geoxml_document_get_parent_id(GEBR_GEOXML_DOCUMENT(flow));
+	revision_store_from_parent((GdomeElement *) revision, revision_xml, parent_id);
+	g_free(parent_id);
 	g_free(revision_xml);
 
 	return revision;
@@ -608,14 +921,51 @@ void gebr_geoxml_flow_set_revision_data(GebrGeoXmlRevision * revision,
                                         const gchar * id)
 {
 	g_return_if_fail(revision != NULL);
-	if (flow != NULL)
-		__gebr_geoxml_set_element_value((GdomeElement *) revision, flow, __gebr_geoxml_create_CDATASection);
+
+	GdomeElement *element = (GdomeElement *) revision;
+	GSList *dependents = NULL;
+	GSList *dependents_xml = NULL;
+
+	/* Revisions stored as deltas from this one are rebuilt on its new data */
+	if (flow != NULL || id != NULL) {
+		gchar *old_id = __gebr_geoxml_get_attr_value(element, "id");
+		dependents = revision_get_dependents(element, old_id);
+		for (GSList *i = dependents; i; i = i->next)
+			dependents_xml = g_slist_append(dependents_xml, revision_get_flow_xml(i->data));
+		g_free(old_id);
+	}
+
+	if (flow != NULL) {
+		gchar *base_id;
+
+		if (revision_get_base(element, &base_id))
+			revision_store_from_parent(element, flow, base_id);
+		else
+			revision_store(element, flow, NULL, NULL);
+		g_free(base_id);
+	}
 	if (date != NULL)
-		__gebr_geoxml_set_attr_value((GdomeElement *) revision, "date", date);
+		__gebr_geoxml_set_attr_value(element, "date", date);
 	if (comment != NULL)
-		__gebr_geoxml_set_attr_value((GdomeElement *) revision, "comment", comment);
+		__gebr_geoxml_set_attr_value(element, "comment", comment);
 	if (id != NULL)
-		__gebr_geoxml_set_attr_value((GdomeElement *) revision, "id", id);
+		__gebr_geoxml_set_attr_value(element, "id", id);
+
+	if (dependents) {
+		gchar *new_id = __gebr_geoxml_get_attr_value(element, "id");
+		gchar *new_xml = revision_get_flow_xml(element);
+
+		for (GSList *i = dependents, *j = dependents_xml; i; i = i->next, j = j->next) {
+			revision_store(i->data, j->data, new_id, new_xml);
+			gdome_el_unref(i->data, &exception);
+			g_free(j->data);
+		}
+
+		g_free(new_xml);
+		g_free(new_id);
+		g_slist_free(dependents);
+		g_slist_free(dependents_xml);
+	}
 }
 
 enum GEBR_GEOXML_RETV
@@ -649,7 +999,7 @@ void gebr_geoxml_flow_get_revision_data(GebrGeoXmlRevision * revision,
 	g_return_if_fail(revision != NULL);
 
 	if (flow)
-		*flow = __gebr_geoxml_get_element_value((GdomeElement *) revision);
+		*flow = revision_get_flow_xml((GdomeElement *) revision);
 
 	if (date) {
 		gchar *date_attr = __gebr_geoxml_get_attr_value((GdomeElement *) revision, "date");
@@ -337,6 +337,7 @@ gboolean gebr_geoxml_flow_change_to_revision(GebrGeoXmlFlow * flow, GebrGeoXmlRe
  * Creates a new revision with the current time append to the list of revisions
  * An revision is a way to keep the history of the flow changes. You can then restore
  * one revision with \ref gebr_geoxml_flow_change_to_revision
+ * The revision is stored as a compressed delta from the revision \p flow came from.
  *
  * If \p flow is NULL nothing is done.
  */
@@ -375,7 +376,8 @@ gebr_geoxml_flow_get_revision(GebrGeoXmlFlow * flow,
 
 /**
  * Get information of \p revision. The flow is stored at \p flow and can be
- * loaded with gebr_geoxml_document_load_buffer. \p date receive the date of creation of \p revision.
+ * loaded with gebr_geoxml_document_load_buffer; it is rebuilt from the deltas of the
+ * revision and its ancestors, so only ask for it when needed. \p date receive the date of creation of \p revision.
  * A NULL value of \p flow or \p date or \p comment mean not set.
  * Any of the string should be freed.
  *
@@ -0,0 +1,42 @@
+/*   libgebr - GeBR Library
+ *   Copyright (C) 2007-2012 GeBR core team (http://www.gebrproject.com/)
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GEBR_GEOXML_FLOW_P_H
+#define __GEBR_GEOXML_FLOW_P_H
+
+#include <glib.h>
+
+#include "flow.h"
+
+G_BEGIN_DECLS
+
+/**
+ * \internal
+ * Stores each revision of \p flow as a delta from its parent revision.
+ * Used when upgrading flows saved with whole revisions.
+ */
+void __gebr_geoxml_flow_revisions_to_delta(GebrGeoXmlFlow *flow);
+
+/**
+ * \internal
+ * Rebases the revisions stored as deltas from \p revision, so it can be
+ * removed. Used by gebr_geoxml_sequence_remove.
+ */
+void __gebr_geoxml_flow_revision_detach(GebrGeoXmlRevision *revision);
+
+G_END_DECLS
+#endif				//__GEBR_GEOXML_FLOW_P_H
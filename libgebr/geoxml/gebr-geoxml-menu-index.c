@@ -0,0 +1,432 @@
+/*   libgebr - GeBR Library
+ *   Copyright (C) 2007-2012 GeBR core team (http://www.gebrproject.com/)
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gebr-geoxml-menu-index.h"
+
+#include <string.h>
+#include <unistd.h>
+#include <zlib.h>
+#include <sys/stat.h>
+#include <glib/gstdio.h>
+#include <libxml/parser.h>
+
+#define READ_BUFFER_SIZE 16384
+
+/* Root children that come after the categories of a menu */
+static const gchar *after_categories[] = {
+	"server", "servers", "io", "program", "revision", NULL
+};
+
+typedef struct {
+	xmlParserCtxtPtr ctxt;
+	GebrGeoXmlMenuInfo *info;
+	GPtrArray *categories;
+	GString *text;
+	gboolean reading;
+	gint depth;
+	gboolean done;
+} MenuInfoParser;
+
+typedef struct {
+	gchar *path;
+	gchar *group;
+	gchar *mtime;
+	gchar *size;
+	GebrGeoXmlMenuInfo *info;
+} MenuEntry;
+
+/* {{{1 Metadata extractor */
+
+static gboolean
+is_after_categories(const gchar *name)
+{
+	for (gint i = 0; after_categories[i]; i++)
+		if (strcmp(name, after_categories[i]) == 0)
+			return TRUE;
+	return FALSE;
+}
+
+static void
+on_start_element(void *ctx,
+		 const xmlChar *name,
+		 const xmlChar **atts)
+{
+	MenuInfoParser *parser = ctx;
+	const gchar *tag = (const gchar *) name;
+
+	parser->depth++;
+
+	if (parser->depth == 1 && strcmp(tag, "flow") != 0) {
+		xmlStopParser(parser->ctxt);
+		return;
+	}
+
+	if (parser->depth != 2)
+		return;
+
+	if (strcmp(tag, "title") == 0
+	    || strcmp(tag, "description") == 0
+	    || strcmp(tag, "category") == 0) {
+		g_string_truncate(parser->text, 0);
+		parser->reading = TRUE;
+	} else if (parser->categories->len > 0 || is_after_categories(tag)) {
+		parser->done = TRUE;
+		xmlStopParser(parser->ctxt);
+	}
+}
+
+static void
+on_end_element(void *ctx,
+	       const xmlChar *name)
+{
+	MenuInfoParser *parser = ctx;
+	const gchar *tag = (const gchar *) name;
+
+	if (parser->reading) {
+		gchar *value = g_strndup(parser->text->str, parser->text->len);
+
+		if (strcmp(tag, "category") == 0)
+			g_ptr_array_add(parser->categories, value);
+		else if (strcmp(tag, "title") == 0 && !parser->info->title)
+			parser->info->title = value;
+		else if (strcmp(tag, "description") == 0 && !parser->info->description)
+			parser->info->description = value;
+		else
+			g_free(value);
+		parser->reading = FALSE;
+	}
+
+	parser->depth--;
+}
+
+static void
+on_characters(void *ctx,
+	      const xmlChar *ch,
+	      int len)
+{
+	MenuInfoParser *parser = ctx;
+
+	if (parser->reading)
+		g_string_append_len(parser->text, (const gchar *) ch, len);
+}
+
+static void
+on_cdata_block(void *ctx,
+	       const xmlChar *value,
+	       int len)
+{
+	/* The help of the menu is not needed */
+}
+
+static void
+on_error(void *ctx,
+	 const char *msg,
+	 ...)
+{
+}
+
+GebrGeoXmlMenuInfo *
+gebr_geoxml_menu_info_new_from_file(const gchar *path)
+{
+	xmlSAXHandler sax;
+	MenuInfoParser parser;
+	gchar buffer[READ_BUFFER_SIZE];
+	gboolean valid = FALSE;
+	gzFile zfp;
+	gint len = 0;
+
+	g_return_val_if_fail(path != NULL, NULL);
+
+	if ((zfp = gzopen(path, "r")) == NULL)
+		return NULL;
+
+	memset(&sax, 0, sizeof(sax));
+	sax.startElement = on_start_element;
+	sax.endElement = on_end_element;
+	sax.characters = on_characters;
+	sax.cdataBlock = on_cdata_block;
+	sax.warning = on_error;
+	sax.error = on_error;
+	sax.fatalError = on_error;
+
+	memset(&parser, 0, sizeof(parser));
+	parser.info = g_new0(GebrGeoXmlMenuInfo, 1);
+	parser.categories = g_ptr_array_new();
+	parser.text = g_string_new(NULL);
+	parser.ctxt = xmlCreatePushParserCtxt(&sax, &parser, NULL, 0, path);
+	xmlCtxtUseOptions(parser.ctxt, XML_PARSE_NONET);
+
+	while (!parser.done && (len = gzread(zfp, buffer, sizeof(buffer))) > 0)
+		if (xmlParseChunk(parser.ctxt, buffer, len, 0) != 0)
+			break;
+
+	if (!parser.done && len == 0) {
+		xmlParseChunk(parser.ctxt, NULL, 0, 1);
+		valid = parser.ctxt->wellFormed;
+	} else
+		valid = parser.done;
+
+	xmlFreeParserCtxt(parser.ctxt);
+	gzclose(zfp);
+	g_string_free(parser.text, TRUE);
+
+	g_ptr_array_add(parser.categories, NULL);
+	parser.info->categories = (gchar **) g_ptr_array_free(parser.categories, FALSE);
+
+	if (!valid) {
+		gebr_geoxml_menu_info_free(parser.info);
+		return NULL;
+	}
+
+	if (!parser.info->title)
+		parser.info->title = g_strdup("");
+	if (!parser.info->description)
+		parser.info->description = g_strdup("");
+
+	return parser.info;
+}
+
+void
+gebr_geoxml_menu_info_free(GebrGeoXmlMenuInfo *info)
+{
+	if (!info)
+		return;
+
+	g_free(info->title);
+	g_free(info->description);
+	g_strfreev(info->categories);
+	g_free(info);
+}
+
+/* {{{1 Index */
+
+gchar *
+gebr_geoxml_menu_index_escape_group(const gchar *name)
+{
+	GString *group = g_string_new(NULL);
+
+	g_return_val_if_fail(name != NULL, NULL);
+
+	for (const gchar *p = name; *p; p++) {
+		if (*p == '[' || *p == ']' || *p == '%' || (guchar) *p < 0x20)
+			g_string_append_printf(group, "%%%02X", (guchar) *p);
+		else
+			g_string_append_c(group, *p);
+	}
+
+	return g_string_free(group, FALSE);
+}
+
+gchar *
+gebr_geoxml_menu_index_unescape_group(const gchar *group)
+{
+	gchar *name;
+
+	g_return_val_if_fail(group != NULL, NULL);
+
+	name = g_uri_unescape_string(group, NULL);
+	return name ? name : g_strdup(group);
+}
+
+static void
+menu_entry_free(MenuEntry *entry)
+{
+	g_free(entry->path);
+	g_free(entry->group);
+	g_free(entry->mtime);
+	g_free(entry->size);
+	gebr_geoxml_menu_info_free(entry->info);
+	g_free(entry);
+}
+
+static void
+menus_free(GPtrArray *menus)
+{
+	g_ptr_array_free(menus, TRUE);
+}
+
+static void
+list_menus(const gchar *directory,
+	   GPtrArray *entries)
+{
+	const gchar *filename;
+	GDir *dir;
+
+	if ((dir = g_dir_open(directory, 0, NULL)) == NULL)
+		return;
+
+	while ((filename = g_dir_read_name(dir)) != NULL) {
+		gchar *path = g_build_filename(directory, filename, NULL);
+		struct stat st;
+
+		if (g_file_test(path, G_FILE_TEST_IS_DIR))
+			list_menus(path, entries);
+		else if (g_str_has_suffix(filename, ".mnu") && g_stat(path, &st) == 0) {
+			MenuEntry *entry = g_new0(MenuEntry, 1);
+			entry->path = path;
+			entry->group = gebr_geoxml_menu_index_escape_group(path);
+			entry->mtime = g_strdup_printf("%" G_GINT64_FORMAT, (gint64) st.st_mtime);
+			entry->size = g_strdup_printf("%" G_GINT64_FORMAT, (gint64) st.st_size);
+			g_ptr_array_add(entries, entry);
+			continue;
+		}
+		g_free(path);
+	}
+
+	g_dir_close(dir);
+}
+
+static gboolean
+entry_is_unchanged(GKeyFile *previous,
+		   const gchar *group,
+		   const gchar *key,
+		   const gchar *value)
+{
+	gchar *old = g_key_file_get_string(previous, group, key, NULL);
+	gboolean equal = g_strcmp0(old, value) == 0;
+
+	g_free(old);
+	return equal;
+}
+
+static GebrGeoXmlMenuInfo *
+menu_info_from_index(GKeyFile *index,
+		     const gchar *group)
+{
+	GebrGeoXmlMenuInfo *info = g_new0(GebrGeoXmlMenuInfo, 1);
+
+	info->title = g_key_file_get_string(index, group, "title", NULL);
+	info->description = g_key_file_get_string(index, group, "description", NULL);
+	info->categories = g_key_file_get_string_list(index, group, "category", NULL, NULL);
+
+	if (!info->title)
+		info->title = g_strdup("");
+	if (!info->description)
+		info->description = g_strdup("");
+	if (!info->categories)
+		info->categories = g_new0(gchar *, 1);
+
+	return info;
+}
+
+static void
+read_menu_info(MenuEntry *entry,
+	       gpointer user_data)
+{
+	entry->info = gebr_geoxml_menu_info_new_from_file(entry->path);
+}
+
+static gint
+get_max_threads(void)
+{
+	glong n = sysconf(_SC_NPROCESSORS_ONLN);
+	return CLAMP(n, 1, 8);
+}
+
+gboolean
+gebr_geoxml_menu_index_update(const gchar *directory,
+			      GKeyFile *previous,
+			      GKeyFile *menus_index,
+			      GKeyFile *categories_index)
+{
+	GPtrArray *entries = g_ptr_array_new();
+	GThreadPool *pool = NULL;
+	gsize n_reused = 0;
+	gsize n_read = 0;
+
+	g_return_val_if_fail(directory != NULL, FALSE);
+
+	list_menus(directory, entries);
+
+	/* The parser must be initialized before it is used by the threads */
+	xmlInitParser();
+	if (g_thread_supported())
+		pool = g_thread_pool_new((GFunc) read_menu_info, NULL, get_max_threads(), FALSE, NULL);
+
+	for (guint i = 0; i < entries->len; i++) {
+		MenuEntry *entry = g_ptr_array_index(entries, i);
+
+		if (previous
+		    && entry_is_unchanged(previous, entry->group, "mtime", entry->mtime)
+		    && entry_is_unchanged(previous, entry->group, "size", entry->size)) {
+			entry->info = menu_info_from_index(previous, entry->group);
+			n_reused++;
+		} else if (pool)
+			g_thread_pool_push(pool, entry, NULL);
+		else
+			read_menu_info(entry, NULL);
+	}
+
+	if (pool)
+		g_thread_pool_free(pool, FALSE, TRUE);
+
+	GHashTable *categories = g_hash_table_new_full(g_str_hash, g_str_equal, NULL,
+						       (GDestroyNotify) menus_free);
+	GPtrArray *category_order = g_ptr_array_new();
+
+	for (guint i = 0; i < entries->len; i++) {
+		MenuEntry *entry = g_ptr_array_index(entries, i);
+		GebrGeoXmlMenuInfo *info = entry->info;
+
+		if (!info)
+			continue;
+		n_read++;
+
+		g_key_file_set_string_list(menus_index, entry->group, "category",
+					   (const gchar * const *) info->categories,
+					   g_strv_length(info->categories));
+		g_key_file_set_string(menus_index, entry->group, "title", info->title);
+		g_key_file_set_string(menus_index, entry->group, "description", info->description);
+		g_key_file_set_string(menus_index, entry->group, "mtime", entry->mtime);
+		g_key_file_set_string(menus_index, entry->group, "size", entry->size);
+
+		for (gint j = 0; info->categories[j]; j++) {
+			GPtrArray *menus = g_hash_table_lookup(categories, info->categories[j]);
+
+			if (!menus) {
+				menus = g_ptr_array_new();
+				g_hash_table_insert(categories, info->categories[j], menus);
+				g_ptr_array_add(category_order, info->categories[j]);
+			}
+			g_ptr_array_add(menus, entry->path);
+		}
+	}
+
+	for (guint i = 0; i < category_order->len; i++) {
+		const gchar *category = g_ptr_array_index(category_order, i);
+		GPtrArray *menus = g_hash_table_lookup(categories, category);
+		gchar *group = gebr_geoxml_menu_index_escape_group(category);
+
+		g_key_file_set_string_list(categories_index, group, "menus",
+					   (const gchar * const *) menus->pdata, menus->len);
+		g_free(group);
+	}
+
+	gboolean changed = !previous || n_read != n_reused;
+	if (!changed) {
+		gsize n_previous;
+		g_strfreev(g_key_file_get_groups(previous, &n_previous));
+		changed = n_previous != n_reused;
+	}
+
+	g_hash_table_destroy(categories);
+	g_ptr_array_free(category_order, TRUE);
+	g_ptr_array_foreach(entries, (GFunc) menu_entry_free, NULL);
+	g_ptr_array_free(entries, TRUE);
+
+	return changed;
+}
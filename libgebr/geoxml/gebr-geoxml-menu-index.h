@@ -0,0 +1,102 @@
+/*   libgebr - GeBR Library
+ *   Copyright (C) 2007-2012 GeBR core team (http://www.gebrproject.com/)
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GEBR_GEOXML_MENU_INDEX_H__
+#define __GEBR_GEOXML_MENU_INDEX_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/**
+ * GebrGeoXmlMenuInfo:
+ * @title: the title of the menu
+ * @description: the description of the menu
+ * @categories: a %NULL terminated vector with the categories of the menu
+ *
+ * The part of a menu shown in the menu list.
+ */
+typedef struct {
+	gchar *title;
+	gchar *description;
+	gchar **categories;
+} GebrGeoXmlMenuInfo;
+
+/**
+ * gebr_geoxml_menu_info_new_from_file:
+ * @path: the path of a menu file, compressed or not
+ *
+ * Reads the title, description and categories of the menu at @path. The
+ * file is parsed only until its categories and it is not validated, so this
+ * is much faster than loading the menu with gebr_geoxml_document_load().
+ *
+ * Returns: a newly allocated #GebrGeoXmlMenuInfo, or %NULL if @path could
+ * not be read or is not well-formed.
+ */
+GebrGeoXmlMenuInfo *gebr_geoxml_menu_info_new_from_file(const gchar *path);
+
+void gebr_geoxml_menu_info_free(GebrGeoXmlMenuInfo *info);
+
+/**
+ * gebr_geoxml_menu_index_update:
+ * @directory: the directory to look for menus, recursively
+ * @previous: the menus index of @directory built before, or %NULL
+ * @menus_index: the key file to store the menus index
+ * @categories_index: the key file to store the categories index
+ *
+ * Builds the index of the menus in @directory. The menus index has a group
+ * for each menu, named by its path, with its "title", "description" and
+ * "category" list, and the "mtime" and "size" of the file. The categories
+ * index has a group for each category with the list of the paths of its
+ * "menus". The names of the groups are escaped, see
+ * gebr_geoxml_menu_index_escape_group().
+ *
+ * The entries of @previous whose files did not change are reused; the other
+ * menus are read with gebr_geoxml_menu_info_new_from_file(), in a pool of
+ * threads if threads are initialized.
+ *
+ * Returns: %TRUE if the index differs from @previous.
+ */
+gboolean gebr_geoxml_menu_index_update(const gchar *directory,
+				       GKeyFile *previous,
+				       GKeyFile *menus_index,
+				       GKeyFile *categories_index);
+
+/**
+ * gebr_geoxml_menu_index_escape_group:
+ * @name: the path of a menu or the name of a category
+ *
+ * Escapes the characters that cannot appear in the name of a group of a
+ * #GKeyFile, brackets and control characters, and the '%' used to escape
+ * them, as "%XX".
+ *
+ * Returns: the newly allocated name of the group of @name in an index.
+ */
+gchar *gebr_geoxml_menu_index_escape_group(const gchar *name);
+
+/**
+ * gebr_geoxml_menu_index_unescape_group:
+ * @group: the name of a group of an index
+ *
+ * Returns: the newly allocated menu path or category name of @group, see
+ * gebr_geoxml_menu_index_escape_group().
+ */
+gchar *gebr_geoxml_menu_index_unescape_group(const gchar *group);
+
+G_END_DECLS
+
+#endif /* __GEBR_GEOXML_MENU_INDEX_H__ */
@@ -25,6 +25,7 @@
 #include <geoxml/enum_option.h>
 #include <geoxml/error.h>
 #include <geoxml/flow.h>
+#include <geoxml/gebr-geoxml-menu-index.h>
 #include <geoxml/gebr-geoxml-tmpl.h>
 #include <geoxml/gebr-geoxml-validate.h>
 #include <geoxml/line.h>
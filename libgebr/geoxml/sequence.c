@@ -20,6 +20,7 @@
 #include <gdome.h>
 
 #include "error.h"
+#include "flow_p.h"
 #include "parameter.h"
 #include "parameter_group.h"
 #include "parameter_p.h"
@@ -451,7 +452,8 @@ int gebr_geoxml_sequence_remove(GebrGeoXmlSequence * sequence)
 		for (GSList *i = list; i; i = i->next)
 			__gebr_geoxml_sequence_remove(GEBR_GEOXML_SEQUENCE(i->data));
 		g_slist_free(list);
-	}
+	} else if (!strcmp(tag->str, "revision"))
+		__gebr_geoxml_flow_revision_detach(GEBR_GEOXML_REVISION(sequence));
 	if (ret == GEBR_GEOXML_RETV_SUCCESS)
 		__gebr_geoxml_sequence_remove(sequence);
 
@@ -30,7 +30,7 @@ int __gebr_geoxml_sequence_previous(GebrGeoXmlSequence ** sequence);
  * \internal
  * Do operation without checks, for library use
  */
-int __gebr_geoxml_sequence_remove(GebrGeoXmlSequence * sequence);
+void __gebr_geoxml_sequence_remove(GebrGeoXmlSequence * sequence);
 
 /**
  * \internal
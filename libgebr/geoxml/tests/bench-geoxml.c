@@ -0,0 +1,204 @@
+/*   libgebr - GeBR Library
+ *   Copyright (C) 2007-2012 GeBR core team (http://www.gebrproject.com/)
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <gebr-bench.h>
+
+#include "document.h"
+#include "document_p.h"
+#include "flow.h"
+#include "line.h"
+#include "project.h"
+#include "object.h"
+#include "error.h"
+#include "parameter.h"
+#include "program.h"
+#include "program-parameter.h"
+#include "sequence.h"
+
+#define TEST_FLOW TEST_DIR"/promo035.flw"
+#define LOOP_STEPS "1000"
+#define N_PARTS 8
+
+/* {{{1 Documents */
+
+typedef struct {
+	GebrGeoXmlDocument *document;
+	gchar *path;
+	gsize size;
+} DocumentData;
+
+/*
+ * Loads a document validated before, as the warm-up already loaded it, which
+ * skips the DTD validation.
+ */
+static void
+bench_document_load(gpointer data)
+{
+	GebrGeoXmlDocument *document;
+
+	if (gebr_geoxml_document_load(&document, TEST_FLOW, TRUE, NULL) != GEBR_GEOXML_RETV_SUCCESS)
+		g_error("Could not load %s", TEST_FLOW);
+	gebr_geoxml_document_free(document);
+}
+
+/*
+ * Loads a document never validated, as the first load of each file.
+ */
+static void
+bench_document_load_uncached(gpointer data)
+{
+	__gebr_geoxml_document_clear_cache();
+	bench_document_load(data);
+}
+
+static void
+bench_document_save(gpointer data)
+{
+	DocumentData *d = data;
+
+	if (gebr_geoxml_document_save(d->document, d->path, FALSE) != GEBR_GEOXML_RETV_SUCCESS)
+		g_error("Could not save %s", d->path);
+}
+
+static void
+bench_document_save_compressed(gpointer data)
+{
+	DocumentData *d = data;
+
+	if (gebr_geoxml_document_save(d->document, d->path, TRUE) != GEBR_GEOXML_RETV_SUCCESS)
+		g_error("Could not save %s", d->path);
+}
+
+static void
+bench_document_clone(gpointer data)
+{
+	DocumentData *d = data;
+	gebr_geoxml_document_free(gebr_geoxml_document_clone(d->document));
+}
+
+static DocumentData *
+document_data_new(void)
+{
+	DocumentData *d = g_new(DocumentData, 1);
+	struct stat st;
+	gint fd;
+
+	if (gebr_geoxml_document_load(&d->document, TEST_FLOW, TRUE, NULL) != GEBR_GEOXML_RETV_SUCCESS)
+		g_error("Could not load %s", TEST_FLOW);
+
+	fd = g_file_open_tmp("bench-geoxml-XXXXXX.flw", &d->path, NULL);
+	if (fd == -1)
+		g_error("Could not create a temporary file");
+	close(fd);
+
+	d->size = g_stat(TEST_FLOW, &st) == 0 ? st.st_size : 0;
+	return d;
+}
+
+/* {{{1 Flow division */
+
+typedef struct {
+	GebrValidator *validator;
+	GebrGeoXmlDocument *flow;
+	GebrGeoXmlDocument *line;
+	GebrGeoXmlDocument *proj;
+	gint weights[N_PARTS];
+} DivideData;
+
+static void
+bench_flow_divide(gpointer data)
+{
+	DivideData *d = data;
+	GList *flows = gebr_geoxml_flow_divide_flows(GEBR_GEOXML_FLOW(d->flow), d->validator,
+						     d->weights, N_PARTS);
+
+	g_list_foreach(flows, (GFunc) gebr_geoxml_document_free, NULL);
+	g_list_free(flows);
+}
+
+/*
+ * The flow of promo035.flw inside a loop of LOOP_STEPS steps, as divided
+ * among the cores of N_PARTS servers.
+ */
+static DivideData *
+divide_data_new(void)
+{
+	DivideData *d = g_new(DivideData, 1);
+	GebrGeoXmlDocument *loop;
+	GebrGeoXmlProgram *prog_loop;
+	GebrGeoXmlParameter *iter_param;
+	gint total = atoi(LOOP_STEPS);
+
+	if (gebr_geoxml_document_load(&d->flow, TEST_FLOW, FALSE, NULL) != GEBR_GEOXML_RETV_SUCCESS)
+		g_error("Could not load %s", TEST_FLOW);
+	d->line = GEBR_GEOXML_DOCUMENT(gebr_geoxml_line_new());
+	d->proj = GEBR_GEOXML_DOCUMENT(gebr_geoxml_project_new());
+	d->validator = gebr_validator_new(&d->flow, &d->line, &d->proj);
+
+	if (gebr_geoxml_document_load(&loop, TEST_DIR"/forloop.mnu", FALSE, NULL) != GEBR_GEOXML_RETV_SUCCESS)
+		g_error("Could not load the loop menu");
+	gebr_geoxml_flow_get_program(GEBR_GEOXML_FLOW(loop), (GebrGeoXmlSequence **) &prog_loop, 0);
+	gebr_geoxml_program_set_status(prog_loop, GEBR_GEOXML_PROGRAM_STATUS_CONFIGURED);
+	gebr_geoxml_program_control_set_n(prog_loop, "1", "1", LOOP_STEPS);
+	gebr_geoxml_flow_add_flow(GEBR_GEOXML_FLOW(d->flow), GEBR_GEOXML_FLOW(loop));
+	gebr_geoxml_object_unref(prog_loop);
+	gebr_geoxml_document_free(loop);
+
+	gebr_geoxml_flow_update_iter_dict_value(GEBR_GEOXML_FLOW(d->flow));
+	iter_param = GEBR_GEOXML_PARAMETER(gebr_geoxml_document_get_dict_parameter(d->flow));
+	gebr_validator_insert(d->validator, iter_param, NULL, NULL);
+	gebr_geoxml_object_unref(iter_param);
+
+	gebr_geoxml_flow_io_set_output(GEBR_GEOXML_FLOW(d->flow), "");
+
+	for (gint i = 0; i < N_PARTS; i++)
+		d->weights[i] = total / N_PARTS + (i < total % N_PARTS);
+
+	return d;
+}
+
+/* {{{1 Main */
+
+int
+main(int argc, char *argv[])
+{
+	gebr_bench_init(&argc, &argv, "geoxml");
+	gebr_geoxml_init();
+	gebr_geoxml_document_set_dtd_dir(DTD_DIR);
+
+	DocumentData *document = document_data_new();
+	DivideData *divide = divide_data_new();
+
+	gebr_bench_add("document/load", bench_document_load_uncached, NULL, document->size);
+	gebr_bench_add("document/load-cached", bench_document_load, NULL, document->size);
+	gebr_bench_add("document/save", bench_document_save, document, document->size);
+	gebr_bench_add("document/save-compressed", bench_document_save_compressed, document, document->size);
+	gebr_bench_add("document/clone", bench_document_clone, document, 0);
+	gebr_bench_add("flow/divide-flows", bench_flow_divide, divide, 0);
+
+	gint ret = gebr_bench_run();
+
+	g_unlink(document->path);
+	gebr_geoxml_finalize();
+
+	return ret;
+}
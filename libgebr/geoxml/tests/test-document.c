@@ -16,8 +16,12 @@
  */
 
 #include <glib.h>
+#include <glib/gstdio.h>
+#include <string.h>
+#include <unistd.h>
 
 #include "document.h"
+#include "document_p.h"
 #include "parameters.h"
 #include "program.h"
 #include "program-parameter.h"
@@ -479,8 +483,175 @@ static void test_gebr_geoxml_document_merge_and_split_dicts(void)
 	gebr_geoxml_document_free(proj);
 }
 
+/*
+ * Saves a flow with a flag whose value is \p flag_value, which is set to
+ * "off" when the flow is loaded unless it is "on" or "off".
+ */
+static gchar *
+save_flow_with_flag(const gchar *title, const gchar *flag_value)
+{
+	GebrGeoXmlFlow *flow = gebr_geoxml_flow_new();
+	GebrGeoXmlProgram *program = gebr_geoxml_flow_append_program(flow);
+	GebrGeoXmlParameters *parameters = gebr_geoxml_program_get_parameters(program);
+	GebrGeoXmlParameter *flag;
+	gchar *path;
+
+	close(g_file_open_tmp("test-document-XXXXXX.flw", &path, NULL));
+
+	flag = gebr_geoxml_parameters_append_parameter(parameters, GEBR_GEOXML_PARAMETER_TYPE_FLAG);
+	gebr_geoxml_program_parameter_set_first_value(GEBR_GEOXML_PROGRAM_PARAMETER(flag), FALSE, flag_value);
+	gebr_geoxml_document_set_title(GEBR_GEOXML_DOCUMENT(flow), title);
+	g_assert_cmpint(gebr_geoxml_document_save(GEBR_GEOXML_DOCUMENT(flow), path, FALSE), ==,
+			GEBR_GEOXML_RETV_SUCCESS);
+
+	gebr_geoxml_object_unref(flag);
+	gebr_geoxml_object_unref(parameters);
+	gebr_geoxml_object_unref(program);
+	gebr_geoxml_document_free(GEBR_GEOXML_DOCUMENT(flow));
+
+	return path;
+}
+
+static gchar *
+load_flag_value(const gchar *path)
+{
+	GebrGeoXmlDocument *flow;
+	GebrGeoXmlSequence *program;
+	GebrGeoXmlParameters *parameters;
+	GebrGeoXmlSequence *flag;
+	gchar *value;
+
+	g_assert_cmpint(gebr_geoxml_document_load(&flow, path, TRUE, NULL), ==,
+			GEBR_GEOXML_RETV_SUCCESS);
+
+	gebr_geoxml_flow_get_program(GEBR_GEOXML_FLOW(flow), &program, 0);
+	parameters = gebr_geoxml_program_get_parameters(GEBR_GEOXML_PROGRAM(program));
+	gebr_geoxml_parameters_get_parameter(parameters, &flag, 0);
+	value = gebr_geoxml_program_parameter_get_first_value(GEBR_GEOXML_PROGRAM_PARAMETER(flag), FALSE);
+
+	gebr_geoxml_object_unref(flag);
+	gebr_geoxml_object_unref(parameters);
+	gebr_geoxml_object_unref(program);
+	gebr_geoxml_document_free(flow);
+
+	return value;
+}
+
+static void
+assert_cache_stats(guint hits, guint misses, guint *last_hits, guint *last_misses)
+{
+	guint h, m;
+
+	__gebr_geoxml_document_get_cache_stats(&h, &m);
+	g_assert_cmpuint(h - *last_hits, ==, hits);
+	g_assert_cmpuint(m - *last_misses, ==, misses);
+	*last_hits = h;
+	*last_misses = m;
+}
+
+void test_gebr_geoxml_document_validated_cache(void)
+{
+	gchar *path = save_flow_with_flag("Cached", "on");
+	gchar *other = save_flow_with_flag("Not cached", "on");
+	gchar *value;
+	guint hits, misses;
+
+	__gebr_geoxml_document_get_cache_stats(&hits, &misses);
+
+	/* Validated the first time only */
+	value = load_flag_value(path);
+	g_assert_cmpstr(value, ==, "on");
+	g_free(value);
+	assert_cache_stats(0, 1, &hits, &misses);
+
+	value = load_flag_value(path);
+	g_assert_cmpstr(value, ==, "on");
+	g_free(value);
+	assert_cache_stats(1, 0, &hits, &misses);
+
+	/* Other contents */
+	g_free(load_flag_value(other));
+	assert_cache_stats(0, 1, &hits, &misses);
+
+	g_unlink(path);
+	g_unlink(other);
+	g_free(path);
+	g_free(other);
+}
+
+void test_gebr_geoxml_document_validated_cache_fixes(void)
+{
+	gchar *path = save_flow_with_flag("Fixed", "yes");
+	gchar *value;
+	guint hits, misses;
+
+	__gebr_geoxml_document_get_cache_stats(&hits, &misses);
+
+	/* The flag is fixed on every load, so the document is never
+	 * remembered as validated */
+	for (gint i = 0; i < 2; i++) {
+		value = load_flag_value(path);
+		g_assert_cmpstr(value, ==, "off");
+		g_free(value);
+		assert_cache_stats(0, 1, &hits, &misses);
+	}
+
+	g_unlink(path);
+	g_free(path);
+}
+
+#define LOAD_THREADS 4
+#define LOADS_PER_THREAD 25
+
+static const gchar *load_paths[] = {
+	TEST_DIR "/dict_test_flow.flw",
+	TEST_DIR "/test2.flw",
+	TEST_DIR "/test.mnu",
+};
+
+/* Loads the documents in turn, returning the titles read, one per line */
+static gpointer
+load_documents(gpointer data)
+{
+	GString *titles = g_string_new(NULL);
+
+	for (gint i = 0; i < LOADS_PER_THREAD; i++) {
+		GebrGeoXmlDocument *document;
+		const gchar *path = load_paths[i % G_N_ELEMENTS(load_paths)];
+
+		if (gebr_geoxml_document_load(&document, path, TRUE, NULL)) {
+			g_string_append(titles, "error\n");
+			continue;
+		}
+		g_string_append_printf(titles, "%s\n", gebr_geoxml_document_get_title(document));
+		gebr_geoxml_document_free(document);
+	}
+
+	return g_string_free(titles, FALSE);
+}
+
+void test_gebr_geoxml_document_load_threads(void)
+{
+	GThread *threads[LOAD_THREADS];
+	gchar *expected = load_documents(NULL);
+
+	g_assert(strstr(expected, "error") == NULL);
+
+	for (gint i = 0; i < LOAD_THREADS; i++)
+		threads[i] = g_thread_create(load_documents, NULL, TRUE, NULL);
+
+	for (gint i = 0; i < LOAD_THREADS; i++) {
+		gchar *titles = g_thread_join(threads[i]);
+		g_assert_cmpstr(titles, ==, expected);
+		g_free(titles);
+	}
+
+	g_free(expected);
+}
+
 int main(int argc, char *argv[])
 {
+	g_thread_init(NULL);
 	g_test_init(&argc, &argv, NULL);
 	gebr_geoxml_init();
 
@@ -501,6 +672,9 @@ int main(int argc, char *argv[])
 	g_test_add_func("/libgebr/geoxml/document/get_description", test_gebr_geoxml_document_get_description);
 	g_test_add_func("/libgebr/geoxml/document/get_help", test_gebr_geoxml_document_get_help);
 	g_test_add_func("/libgebr/geoxml/document/document_canonize_dict_parameters", test_gebr_geoxml_document_canonize_dict_parameters);
+	g_test_add_func("/libgebr/geoxml/document/validated_cache", test_gebr_geoxml_document_validated_cache);
+	g_test_add_func("/libgebr/geoxml/document/validated_cache_fixes", test_gebr_geoxml_document_validated_cache_fixes);
+	g_test_add_func("/libgebr/geoxml/document/load_threads", test_gebr_geoxml_document_load_threads);
 
 	gint ret = g_test_run();
 	gebr_geoxml_finalize();
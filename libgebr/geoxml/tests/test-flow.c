@@ -17,6 +17,7 @@
 
 #include <glib.h>
 #include <glib-object.h>
+#include <gdome.h>
 #include <stdlib.h>
 
 #include "../../date.h"
@@ -29,6 +30,8 @@
 #include "program-parameter.h"
 #include "sequence.h"
 #include "program.h"
+#include "types.h"
+#include "xml.h"
 
 typedef struct {
 	GebrValidator *validator;
@@ -841,6 +844,217 @@ void test_gebr_geoxml_flow_revisions_get_root_id(void)
 	g_hash_table_destroy(hash4);
 }
 
+/* The length of the chains of deltas, as in flow.c */
+#define MAX_DELTA_CHAIN 16
+#define N_REVISIONS (MAX_DELTA_CHAIN + 4)
+
+/*
+ * Appends a revision of @flow titled after @i, with id "r<i>", and changes
+ * @flow to it, so the next revision is stored from this one.
+ */
+static GebrGeoXmlRevision *
+append_titled_revision(GebrGeoXmlFlow *flow, gint i)
+{
+	gchar *title = g_strdup_printf("Revision %d", i);
+	gchar *id = g_strdup_printf("r%d", i);
+	GebrGeoXmlRevision *revision;
+
+	gebr_geoxml_document_set_title(GEBR_GEOXML_DOCUMENT(flow), title);
+	revision = gebr_geoxml_flow_append_revision(flow, title);
+	gebr_geoxml_flow_set_revision_data(revision, NULL, NULL, NULL, id);
+	g_assert(gebr_geoxml_flow_change_to_revision(flow, revision));
+
+	g_free(title);
+	g_free(id);
+	return revision;
+}
+
+static GebrGeoXmlFlow *
+create_flow_with_revisions(GebrGeoXmlRevision **revisions, gint n)
+{
+	GebrGeoXmlFlow *flow = gebr_geoxml_flow_new();
+
+	for (gint i = 0; i < n; i++)
+		revisions[i] = append_titled_revision(flow, i);
+
+	return flow;
+}
+
+static void
+unref_revisions(GebrGeoXmlRevision **revisions, gint n)
+{
+	for (gint i = 0; i < n; i++)
+		if (revisions[i])
+			gebr_geoxml_object_unref(revisions[i]);
+}
+
+static gchar *
+revision_get_title(GebrGeoXmlRevision *revision)
+{
+	GebrGeoXmlDocument *document;
+	gchar *xml, *title;
+
+	gebr_geoxml_flow_get_revision_data(revision, &xml, NULL, NULL, NULL);
+	g_assert_cmpint(gebr_geoxml_document_load_buffer(&document, xml), ==, GEBR_GEOXML_RETV_SUCCESS);
+	title = gebr_geoxml_document_get_title(document);
+
+	gebr_geoxml_document_free(document);
+	g_free(xml);
+	return title;
+}
+
+static void
+assert_revision_title(GebrGeoXmlRevision *revision, gint i)
+{
+	gchar *expected = g_strdup_printf("Revision %d", i);
+	gchar *title = revision_get_title(revision);
+
+	g_assert_cmpstr(title, ==, expected);
+	g_free(title);
+	g_free(expected);
+}
+
+/* The revision @revision is stored from, or %NULL if it is stored whole */
+static gchar *
+revision_get_delta(GebrGeoXmlRevision *revision)
+{
+	GdomeDOMString *name = gdome_str_mkref("delta");
+	gboolean has_delta = gdome_el_hasAttribute((GdomeElement *) revision, name, &exception);
+
+	gdome_str_unref(name);
+	return has_delta ? __gebr_geoxml_get_attr_value((GdomeElement *) revision, "delta") : NULL;
+}
+
+static void
+assert_revision_delta(GebrGeoXmlRevision *revision, const gchar *base_id)
+{
+	gchar *delta = revision_get_delta(revision);
+	g_assert_cmpstr(delta, ==, base_id);
+	g_free(delta);
+}
+
+static void test_gebr_geoxml_flow_revisions_delta_chain(void)
+{
+	GebrGeoXmlRevision *revisions[N_REVISIONS];
+	GebrGeoXmlFlow *flow = create_flow_with_revisions(revisions, N_REVISIONS);
+
+	/* Each revision is stored from its parent, until the chain is too
+	 * long and starts again from an empty flow */
+	for (gint i = 0; i < N_REVISIONS; i++) {
+		gchar *base_id = i % MAX_DELTA_CHAIN ? g_strdup_printf("r%d", i - 1) : g_strdup("");
+		assert_revision_delta(revisions[i], base_id);
+		g_free(base_id);
+	}
+
+	/* and all are read back, from any revision the flow is at */
+	for (gint i = N_REVISIONS - 1; i >= 0; i--) {
+		gchar *expected = g_strdup_printf("Revision %d", i);
+		gchar *title;
+
+		assert_revision_title(revisions[i], i);
+		g_assert(gebr_geoxml_flow_change_to_revision(flow, revisions[i]));
+		title = gebr_geoxml_document_get_title(GEBR_GEOXML_DOCUMENT(flow));
+		g_assert_cmpstr(title, ==, expected);
+		g_free(expected);
+		g_free(title);
+	}
+
+	unref_revisions(revisions, N_REVISIONS);
+	gebr_geoxml_document_free(GEBR_GEOXML_DOCUMENT(flow));
+}
+
+static void test_gebr_geoxml_flow_revisions_rebase(void)
+{
+	GebrGeoXmlRevision *revisions[4];
+	GebrGeoXmlFlow *flow = create_flow_with_revisions(revisions, 4);
+	gchar *xml;
+
+	/* Changing the flow of a revision rebases the one stored from it */
+	gebr_geoxml_document_set_title(GEBR_GEOXML_DOCUMENT(flow), "Revision 10");
+	gebr_geoxml_document_to_string(GEBR_GEOXML_DOCUMENT(flow), &xml);
+	gebr_geoxml_flow_set_revision_data(revisions[1], xml, NULL, NULL, NULL);
+	g_free(xml);
+
+	assert_revision_title(revisions[1], 10);
+	assert_revision_title(revisions[2], 2);
+	assert_revision_delta(revisions[2], "r1");
+
+	/* and so does changing its id */
+	gebr_geoxml_flow_set_revision_data(revisions[1], NULL, NULL, NULL, "renamed");
+	assert_revision_delta(revisions[2], "renamed");
+	assert_revision_title(revisions[2], 2);
+	assert_revision_title(revisions[3], 3);
+
+	unref_revisions(revisions, 4);
+	gebr_geoxml_document_free(GEBR_GEOXML_DOCUMENT(flow));
+}
+
+static void test_gebr_geoxml_flow_revisions_remove(void)
+{
+	GebrGeoXmlRevision *revisions[4];
+	GebrGeoXmlFlow *flow = create_flow_with_revisions(revisions, 4);
+
+	/* The revision stored from a removed one takes its base */
+	gebr_geoxml_sequence_remove(GEBR_GEOXML_SEQUENCE(revisions[1]));
+	revisions[1] = NULL;
+	assert_revision_delta(revisions[2], "r0");
+	assert_revision_title(revisions[2], 2);
+	assert_revision_title(revisions[3], 3);
+
+	gebr_geoxml_sequence_remove(GEBR_GEOXML_SEQUENCE(revisions[0]));
+	revisions[0] = NULL;
+	assert_revision_delta(revisions[2], "");
+	assert_revision_title(revisions[2], 2);
+	assert_revision_title(revisions[3], 3);
+
+	unref_revisions(revisions, 4);
+	gebr_geoxml_document_free(GEBR_GEOXML_DOCUMENT(flow));
+}
+
+static void test_gebr_geoxml_flow_revisions_upgrade(void)
+{
+	GebrGeoXmlRevision *revisions[N_REVISIONS];
+	GebrGeoXmlFlow *flow = create_flow_with_revisions(revisions, N_REVISIONS);
+	GebrGeoXmlDocument *upgraded;
+	GebrGeoXmlSequence *seq;
+	gchar *xml, *version, **parts;
+
+	/* Revisions stored whole, as in flows of version 0.4.0; the last ones
+	 * first, so none is stored from a revision stored whole */
+	for (gint i = N_REVISIONS - 1; i >= 0; i--) {
+		gebr_geoxml_flow_get_revision_data(revisions[i], &xml, NULL, NULL, NULL);
+		__gebr_geoxml_remove_attr((GdomeElement *) revisions[i], "delta");
+		gebr_geoxml_flow_set_revision_data(revisions[i], xml, NULL, NULL, NULL);
+		assert_revision_delta(revisions[i], NULL);
+		g_free(xml);
+	}
+	unref_revisions(revisions, N_REVISIONS);
+
+	gebr_geoxml_document_to_string(GEBR_GEOXML_DOCUMENT(flow), &xml);
+	parts = g_strsplit(xml, "0.4.1", -1);
+	g_free(xml);
+	xml = g_strjoinv("0.4.0", parts);
+	g_strfreev(parts);
+
+	g_assert_cmpint(gebr_geoxml_document_load_buffer(&upgraded, xml), ==, GEBR_GEOXML_RETV_SUCCESS);
+	version = gebr_geoxml_document_get_version(upgraded);
+	g_assert_cmpstr(version, ==, "0.4.1");
+	g_free(version);
+
+	/* Stored again from their parents */
+	gebr_geoxml_flow_get_revision(GEBR_GEOXML_FLOW(upgraded), &seq, 0);
+	for (gint i = 0; seq; gebr_geoxml_sequence_next(&seq), i++) {
+		gchar *base_id = i % MAX_DELTA_CHAIN ? g_strdup_printf("r%d", i - 1) : g_strdup("");
+		assert_revision_delta(GEBR_GEOXML_REVISION(seq), base_id);
+		assert_revision_title(GEBR_GEOXML_REVISION(seq), i);
+		g_free(base_id);
+	}
+
+	g_free(xml);
+	gebr_geoxml_document_free(upgraded);
+	gebr_geoxml_document_free(GEBR_GEOXML_DOCUMENT(flow));
+}
+
 //static void test_gebr_geoxml_flow_calulate_weights(void)
 //{
 //	gdouble *weights;
@@ -880,6 +1094,10 @@ int main(int argc, char *argv[])
 //	g_test_add_func("/libgebr/geoxml/flow/change_to_revision", test_gebr_geoxml_flow_change_to_revision);
 	g_test_add_func("/libgebr/geoxml/flow/get_and_set_revision_data", test_gebr_geoxml_flow_get_and_set_revision_data);
 	g_test_add_func("/libgebr/geoxml/flow/get_revision", test_gebr_geoxml_flow_get_revision);
+	g_test_add_func("/libgebr/geoxml/flow/revisions_delta_chain", test_gebr_geoxml_flow_revisions_delta_chain);
+	g_test_add_func("/libgebr/geoxml/flow/revisions_rebase", test_gebr_geoxml_flow_revisions_rebase);
+	g_test_add_func("/libgebr/geoxml/flow/revisions_remove", test_gebr_geoxml_flow_revisions_remove);
+	g_test_add_func("/libgebr/geoxml/flow/revisions_upgrade", test_gebr_geoxml_flow_revisions_upgrade);
 	g_test_add_func("/libgebr/geoxml/flow/io_output_append", test_gebr_geoxml_flow_io_output_append);
 	g_test_add_func("/libgebr/geoxml/flow/io_output_append_default", test_gebr_geoxml_flow_io_output_append_default);
 	g_test_add_func("/libgebr/geoxml/flow/io_error_append", test_gebr_geoxml_flow_io_error_append);
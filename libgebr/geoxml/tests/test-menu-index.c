@@ -0,0 +1,157 @@
+/*   libgebr - GêBR Library
+ *   Copyright (C) 2007-2012 GeBR core team (http://www.gebrproject.com/)
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <unistd.h>
+
+#include "gebr-geoxml-menu-index.h"
+
+void test_gebr_geoxml_menu_info_new_from_file(void)
+{
+	GebrGeoXmlMenuInfo *info;
+
+	info = gebr_geoxml_menu_info_new_from_file(TEST_DIR"/z2xyz.mnu");
+	g_assert(info != NULL);
+	g_assert_cmpstr(info->title, ==, "Z to XYZ");
+	g_assert_cmpstr(info->categories[0], ==, "Import/Export");
+	g_assert_cmpstr(info->categories[1], ==, "Seismic Unix");
+	g_assert(info->categories[2] == NULL);
+	gebr_geoxml_menu_info_free(info);
+
+	// Compressed menu without categories
+	info = gebr_geoxml_menu_info_new_from_file(TEST_DIR"/test.mnu");
+	g_assert(info != NULL);
+	g_assert_cmpstr(info->title, ==, "teste");
+	g_assert_cmpstr(info->description, ==, "");
+	g_assert(info->categories[0] == NULL);
+	gebr_geoxml_menu_info_free(info);
+
+	g_assert(gebr_geoxml_menu_info_new_from_file(TEST_DIR"/nonexistent.mnu") == NULL);
+}
+
+void test_gebr_geoxml_menu_index_update(void)
+{
+	GKeyFile *menus = g_key_file_new();
+	GKeyFile *categories = g_key_file_new();
+	GKeyFile *menus2 = g_key_file_new();
+	GKeyFile *categories2 = g_key_file_new();
+	gchar **list;
+
+	g_assert(gebr_geoxml_menu_index_update(TEST_DIR, NULL, menus, categories));
+
+	list = g_key_file_get_string_list(categories, "Seismic Unix", "menus", NULL, NULL);
+	g_assert(list != NULL);
+	g_assert_cmpstr(list[0], ==, TEST_DIR"/z2xyz.mnu");
+	g_strfreev(list);
+
+	// Nothing changed, so the index is reused
+	g_assert(!gebr_geoxml_menu_index_update(TEST_DIR, menus, menus2, categories2));
+
+	gchar *title = g_key_file_get_string(menus2, TEST_DIR"/z2xyz.mnu", "title", NULL);
+	g_assert_cmpstr(title, ==, "Z to XYZ");
+	g_free(title);
+
+	g_key_file_free(menus);
+	g_key_file_free(categories);
+	g_key_file_free(menus2);
+	g_key_file_free(categories2);
+}
+
+void test_gebr_geoxml_menu_index_escape(void)
+{
+	gchar *name = g_strdup_printf("gebr-test-menu-index-%d", (gint) getpid());
+	gchar *dir = g_build_filename(g_get_tmp_dir(), name, "[old]", NULL);
+	gchar *menu = g_build_filename(dir, "100%[a].mnu", NULL);
+	GKeyFile *menus = g_key_file_new();
+	GKeyFile *categories = g_key_file_new();
+	GKeyFile *loaded = g_key_file_new();
+	gchar *data, *group, **list;
+
+	group = gebr_geoxml_menu_index_escape_group("/a b/[x]%\n.mnu");
+	g_assert_cmpstr(group, ==, "/a b/%5Bx%5D%25%0A.mnu");
+	data = gebr_geoxml_menu_index_unescape_group(group);
+	g_assert_cmpstr(data, ==, "/a b/[x]%\n.mnu");
+	g_free(data);
+	g_free(group);
+
+	g_mkdir_with_parents(dir, 0700);
+	g_assert(g_file_set_contents(menu,
+				     "<?xml version=\"1.0\"?><flow><title>Filter</title>"
+				     "<description>Bandpass</description>"
+				     "<category>Filters [beta]</category></flow>", -1, NULL));
+
+	g_assert(gebr_geoxml_menu_index_update(dir, NULL, menus, categories));
+
+	/* The groups are found after the indices are saved and loaded */
+	data = g_key_file_to_data(categories, NULL, NULL);
+	g_assert(g_key_file_load_from_data(loaded, data, -1, G_KEY_FILE_NONE, NULL));
+	g_free(data);
+	list = g_key_file_get_groups(loaded, NULL);
+	g_assert(list[0] != NULL && list[1] == NULL);
+	group = gebr_geoxml_menu_index_unescape_group(list[0]);
+	g_assert_cmpstr(group, ==, "Filters [beta]");
+	g_free(group);
+	g_strfreev(list);
+
+	group = gebr_geoxml_menu_index_escape_group("Filters [beta]");
+	list = g_key_file_get_string_list(loaded, group, "menus", NULL, NULL);
+	g_assert(list != NULL);
+	g_assert_cmpstr(list[0], ==, menu);
+	g_strfreev(list);
+	g_free(group);
+
+	data = g_key_file_to_data(menus, NULL, NULL);
+	g_assert(g_key_file_load_from_data(loaded, data, -1, G_KEY_FILE_NONE, NULL));
+	g_free(data);
+	group = gebr_geoxml_menu_index_escape_group(menu);
+	data = g_key_file_get_string(loaded, group, "title", NULL);
+	g_assert_cmpstr(data, ==, "Filter");
+	g_free(data);
+	g_free(group);
+
+	/* And reused by the next update */
+	g_key_file_free(menus);
+	g_key_file_free(categories);
+	menus = g_key_file_new();
+	categories = g_key_file_new();
+	g_assert(!gebr_geoxml_menu_index_update(dir, loaded, menus, categories));
+
+	g_unlink(menu);
+	g_rmdir(dir);
+	g_free(dir);
+	dir = g_build_filename(g_get_tmp_dir(), name, NULL);
+	g_rmdir(dir);
+
+	g_key_file_free(menus);
+	g_key_file_free(categories);
+	g_key_file_free(loaded);
+	g_free(menu);
+	g_free(dir);
+	g_free(name);
+}
+
+int main(int argc, char *argv[])
+{
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add_func("/libgebr/geoxml/menu-index/info", test_gebr_geoxml_menu_info_new_from_file);
+	g_test_add_func("/libgebr/geoxml/menu-index/update", test_gebr_geoxml_menu_index_update);
+	g_test_add_func("/libgebr/geoxml/menu-index/escape", test_gebr_geoxml_menu_index_escape);
+
+	return g_test_run();
+}
@@ -37,9 +37,10 @@ extern const int parameter_type_to_str_len;
  * The extremelly anoying and persintant GdomeException.
  * Declaring one global variable makes possible to use gdome
  * functions in defines, like groxml_document_root_element
- * Defined in document.c.
+ * Defined in document.c. Each thread has its own, so documents can be
+ * loaded by threads concurrently.
  */
-extern GdomeException exception;
+extern __thread GdomeException exception;
 
 G_END_DECLS
 #endif				// __GEBR_GEOXML_TYPES_H
@@ -0,0 +1,174 @@
+/*   libgebr - GeBR Library
+ *   Copyright (C) 2007-2012 GeBR core team (http://www.gebrproject.com/)
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <glib.h>
+#include <glib-object.h>
+#include <geoxml/geoxml.h>
+#include <gebr-bench.h>
+
+#include "../gebr-iexpr.h"
+#include "../gebr-arith-expr.h"
+#include "../gebr-validator.h"
+
+/* Variables defined in each of the project, line and flow dictionaries */
+#define VARS_PER_SCOPE 20
+
+/* {{{1 Arithmetic expressions */
+
+typedef struct {
+	GebrArithExpr *arith;
+	gchar *expr;
+} ArithData;
+
+static void
+bench_arith_eval(gpointer data)
+{
+	ArithData *d = data;
+	gdouble result;
+
+	if (!gebr_arith_expr_eval(d->arith, d->expr, &result, NULL))
+		g_error("Could not evaluate %s", d->expr);
+}
+
+static ArithData *
+arith_data_new(GebrArithExpr *arith,
+	       gint n_terms)
+{
+	ArithData *d = g_new(ArithData, 1);
+	GString *expr = g_string_new("1");
+
+	for (gint i = 1; i < n_terms; i++)
+		g_string_append_printf(expr, "+%d*(%d.5-%d)/%d", i, i, i - 1, i + 1);
+
+	d->arith = arith;
+	d->expr = g_string_free(expr, FALSE);
+	return d;
+}
+
+/* {{{1 Validator */
+
+typedef struct {
+	GebrValidator *validator;
+	GebrGeoXmlDocument *flow;
+	GebrGeoXmlDocument *line;
+	GebrGeoXmlDocument *proj;
+	GebrGeoXmlParameter *first;
+	gchar *expr;
+	gboolean toggle;
+} ValidatorData;
+
+static void
+define_float(ValidatorData *d,
+	     GebrGeoXmlDocument *doc,
+	     const gchar *name,
+	     const gchar *value)
+{
+	GError *error = NULL;
+	GebrGeoXmlParameter *param;
+
+	param = gebr_geoxml_document_set_dict_keyword(doc, GEBR_GEOXML_PARAMETER_TYPE_FLOAT, name, value);
+	if (!gebr_validator_insert(d->validator, param, NULL, &error))
+		g_error("Could not define %s: %s", name, error->message);
+
+	if (!d->first)
+		d->first = param;
+	else
+		gebr_geoxml_object_unref(param);
+}
+
+/*
+ * Each variable depends on the previous one, from the project to the flow,
+ * so changing the first project variable revalidates all of them.
+ */
+static ValidatorData *
+validator_data_new(void)
+{
+	ValidatorData *d = g_new0(ValidatorData, 1);
+	GebrGeoXmlDocument *scopes[3];
+	gint n = 0;
+
+	d->flow = GEBR_GEOXML_DOCUMENT(gebr_geoxml_flow_new());
+	d->line = GEBR_GEOXML_DOCUMENT(gebr_geoxml_line_new());
+	d->proj = GEBR_GEOXML_DOCUMENT(gebr_geoxml_project_new());
+	d->validator = gebr_validator_new(&d->flow, &d->line, &d->proj);
+
+	scopes[0] = d->proj;
+	scopes[1] = d->line;
+	scopes[2] = d->flow;
+
+	define_float(d, d->proj, "v0", "1");
+	for (guint s = 0; s < G_N_ELEMENTS(scopes); s++) {
+		for (gint i = 0; i < VARS_PER_SCOPE; i++, n++) {
+			if (n == 0)
+				continue;
+			gchar *name = g_strdup_printf("v%d", n);
+			gchar *value = g_strdup_printf("v%d*2+%d", n - 1, n);
+			define_float(d, scopes[s], name, value);
+			g_free(name);
+			g_free(value);
+		}
+	}
+
+	d->expr = g_strdup_printf("v%d/2+v%d-v0", n - 1, n / 2);
+	return d;
+}
+
+static void
+bench_validator_evaluate(gpointer data)
+{
+	ValidatorData *d = data;
+	GError *error = NULL;
+	gchar *value;
+
+	if (!gebr_validator_evaluate(d->validator, d->expr, GEBR_GEOXML_PARAMETER_TYPE_FLOAT,
+				     GEBR_GEOXML_DOCUMENT_TYPE_FLOW, &value, &error))
+		g_error("Could not evaluate %s: %s", d->expr, error->message);
+	g_free(value);
+}
+
+static void
+bench_validator_revalidate(gpointer data)
+{
+	ValidatorData *d = data;
+	GError *error = NULL;
+
+	d->toggle = !d->toggle;
+	if (!gebr_validator_change_value(d->validator, d->first, d->toggle ? "2" : "1", NULL, &error))
+		g_error("Could not change v0: %s", error->message);
+
+	/* Changing the value only invalidates, the chain is evaluated on use */
+	bench_validator_evaluate(d);
+}
+
+/* {{{1 Main */
+
+int
+main(int argc, char *argv[])
+{
+	gebr_bench_init(&argc, &argv, "libgebr");
+	gebr_geoxml_init();
+
+	GebrArithExpr *arith = gebr_arith_expr_new();
+	ValidatorData *validator = validator_data_new();
+
+	gebr_bench_add("arith-expr/eval-short", bench_arith_eval, arith_data_new(arith, 2), 0);
+	gebr_bench_add("arith-expr/eval-long", bench_arith_eval, arith_data_new(arith, 200), 0);
+	gebr_bench_add("validator/evaluate", bench_validator_evaluate, validator, 0);
+	gebr_bench_add("validator/revalidate-chain", bench_validator_revalidate, validator, 0);
+
+	return gebr_bench_run();
+}
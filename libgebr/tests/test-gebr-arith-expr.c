@@ -121,6 +121,171 @@ void test_gebr_arith_expr_extract_vars(void)
 	g_assert(g_list_find_custom(vars, "b", (GCompareFunc)g_strcmp0));
 }
 
+/*
+ * Expressions checked against both backends. Programs are sent the same way
+ * GebrValidator and gebrd do, including the functions they define.
+ */
+static const gchar *compat_exprs[] = {
+	"2*2",
+	"2*",
+	"2c*",
+	"2.718[",
+	"j=1",
+	"10/3",
+	"scale=5",
+	"10/3",
+	"-7%3",
+	"-2^2",
+	"2^-2",
+	"2^0.5",
+	"1/0",
+	"sqrt(-1)",
+	"sqrt(2)",
+	"s(1)+c(1)",
+	"a(1)*4",
+	"l(10)",
+	"e(2)",
+	"length(123.450)",
+	"scale(1.500)",
+	"0.1+0.2",
+	"1-1.00",
+	"99999999999999999999999999999999999999999999999999999999999999999999999*9",
+	"define min(a,b){ if(a<b) {return a;} else {return b;}}\n"
+	"define max(a,b){ if(a>b) {return a;} else {return b;}}\n"
+	"define round(x){ auto s; s = scale; if(x>0) x+=0.5 else x-=0.5; scale = 0; x/=1; scale = s; return (x);}\n0",
+	"min(3, 2.5)",
+	"max(-1, -1.5)",
+	"round(2.5)",
+	"round(-2.4999)",
+	"min(1)",
+	"undefined(1)",
+	"define bc_reset(iter) {\n x=x[1]=(2)\n y=y[1]=(x[1]*iter)\n return iter };0\n;iter=bc_reset(0);",
+	"y[1]",
+	";iter=bc_reset(1);y[1];iter=bc_reset(0);",
+	"y[1]",
+	"foo=(1.2);foo",
+	"foo*10",
+	"3 4",
+	"1;2",
+	"print \"a\", 1, \"\\n\"",
+	NULL
+};
+
+void test_gebr_arith_expr_compat(void)
+{
+	gchar *path = g_find_program_in_path("bc");
+	if (!path) {
+		g_test_message("bc not found, skipping");
+		return;
+	}
+	g_free(path);
+
+	GebrArithExpr *native = gebr_arith_expr_new_with_backend(GEBR_ARITH_EXPR_BACKEND_NATIVE);
+	GebrArithExpr *bc = gebr_arith_expr_new_with_backend(GEBR_ARITH_EXPR_BACKEND_BC);
+
+	for (gint i = 0; compat_exprs[i]; i++) {
+		gchar *native_result = NULL;
+		gchar *bc_result = NULL;
+		GError *native_error = NULL;
+		GError *bc_error = NULL;
+		gboolean native_ok, bc_ok;
+
+		native_ok = gebr_arith_expr_eval_internal(native, compat_exprs[i], &native_result, &native_error);
+		bc_ok = gebr_arith_expr_eval_internal(bc, compat_exprs[i], &bc_result, &bc_error);
+
+		g_test_message("%s: %s / %s", compat_exprs[i],
+			       native_ok ? native_result : native_error->message,
+			       bc_ok ? bc_result : bc_error->message);
+
+		g_assert_cmpint(native_ok, ==, bc_ok);
+		if (native_ok)
+			g_assert_cmpstr(native_result, ==, bc_result);
+		else
+			g_assert_cmpint(native_error->code, ==, bc_error->code);
+
+		g_free(native_result);
+		g_free(bc_result);
+		g_clear_error(&native_error);
+		g_clear_error(&bc_error);
+	}
+
+	g_object_unref(native);
+	g_object_unref(bc);
+}
+
+void test_gebr_arith_expr_native(void)
+{
+	gchar *result;
+	GError *error = NULL;
+	GebrArithExpr *expr = gebr_arith_expr_new_with_backend(GEBR_ARITH_EXPR_BACKEND_NATIVE);
+
+	struct {
+		const gchar *expr;
+		const gchar *result;
+	} cases[] = {
+		{"s(1)", ".84147098480789650665"},
+		{"l(2)", ".69314718055994530941"},
+		{"e(1)", "2.71828182845904523536"},
+		{"a(1)", ".78539816339744830961"},
+		{"sqrt(2)", "1.41421356237309504880"},
+		{"1/3", ".33333333333333333333"},
+		{"scale=5", NULL},
+		{"define round(x){ auto s; s = scale; if(x>0) x+=0.5 else x-=0.5; scale = 0; x/=1; scale = s; return (x);}\n0", "0"},
+		{"round(2.5)", "3"},
+		{"round(-2.5)", "-3"},
+		{"s", "0"},
+		{"2/3", ".66666"},
+		{NULL, NULL}
+	};
+
+	for (gint i = 0; cases[i].expr; i++) {
+		result = NULL;
+		if (!cases[i].result) {
+			g_assert(!gebr_arith_expr_eval_internal(expr, cases[i].expr, NULL, NULL));
+			continue;
+		}
+		g_assert(gebr_arith_expr_eval_internal(expr, cases[i].expr, &result, &error));
+		g_assert_no_error(error);
+		g_assert_cmpstr(result, ==, cases[i].result);
+		g_free(result);
+	}
+
+	g_assert(!gebr_arith_expr_eval_internal(expr, "1/0", NULL, &error));
+	g_assert_error(error, GEBR_IEXPR_ERROR, GEBR_IEXPR_ERROR_RUNTIME);
+	g_clear_error(&error);
+
+	g_object_unref(expr);
+}
+
+static void
+eval_loop(GebrArithExprBackend backend, gint n)
+{
+	gchar *result;
+	GebrArithExpr *expr = gebr_arith_expr_new_with_backend(backend);
+
+	g_assert(gebr_iexpr_set_var(GEBR_IEXPR(expr), "foo",
+				    GEBR_GEOXML_PARAMETER_TYPE_FLOAT,
+				    "1.5", NULL));
+	g_test_timer_start();
+	for (gint i = 0; i < n; i++) {
+		g_assert(gebr_arith_expr_eval_internal(expr, "foo*(3+4)/2-foo^2", &result, NULL));
+		g_free(result);
+	}
+	g_test_maximized_result(n / g_test_timer_elapsed(), "%s evaluations per second",
+				backend == GEBR_ARITH_EXPR_BACKEND_BC ? "bc" : "native");
+	g_object_unref(expr);
+}
+
+void test_gebr_arith_expr_throughput(void)
+{
+	gchar *path = g_find_program_in_path("bc");
+
+	eval_loop(GEBR_ARITH_EXPR_BACKEND_NATIVE, 100000);
+	if (path)
+		eval_loop(GEBR_ARITH_EXPR_BACKEND_BC, 10000);
+	g_free(path);
+}
+
 int main(int argc, char *argv[])
 {
 	g_type_init();
@@ -133,6 +298,10 @@ int main(int argc, char *argv[])
 	g_test_add_func("/libgebr/arith-expr/variables", test_gebr_arith_expr_variables);
 	g_test_add_func("/libgebr/arith-expr/side_effect", test_gebr_arith_expr_side_effect);
 	g_test_add_func("/libgebr/arith-expr/extrat_vars", test_gebr_arith_expr_extract_vars);
+	g_test_add_func("/libgebr/arith-expr/compat", test_gebr_arith_expr_compat);
+	g_test_add_func("/libgebr/arith-expr/native", test_gebr_arith_expr_native);
+	if (g_test_perf())
+		g_test_add_func("/libgebr/arith-expr/throughput", test_gebr_arith_expr_throughput);
 
 	gint ret = g_test_run();
 	gebr_geoxml_finalize();
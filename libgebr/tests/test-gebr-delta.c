@@ -0,0 +1,114 @@
+/*   libgebr - GêBR Library
+ *   Copyright (C) 2007-2012 GeBR core team (http://www.gebrproject.com/)
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <glib.h>
+#include <string.h>
+
+#include "../gebr-delta.h"
+
+static gchar *
+create_flow_like_text(gint lines, gint changed)
+{
+	GString *text = g_string_new(NULL);
+
+	for (gint i = 0; i < lines; i++)
+		g_string_append_printf(text, "    <parameter id=\"%d\">\n      <value>%d</value>\n    </parameter>\n",
+				       i, i % 97 ? i : i * changed);
+
+	return g_string_free(text, FALSE);
+}
+
+static void
+assert_round_trip(const gchar *base, const gchar *target)
+{
+	gchar *delta = gebr_delta_encode(base, target);
+	gchar *decoded = gebr_delta_decode(base, delta);
+
+	g_assert_cmpstr(decoded, ==, target);
+
+	g_free(decoded);
+	g_free(delta);
+}
+
+void test_gebr_delta_round_trip(void)
+{
+	assert_round_trip("", "");
+	assert_round_trip("foo\n", "");
+	assert_round_trip("", "foo");
+	assert_round_trip("same line here\n", "same line here\n");
+	assert_round_trip("first line here\nsecond line here\n",
+			  "second line here\nfirst line here\nthird");
+}
+
+void test_gebr_delta_size(void)
+{
+	gchar *base = create_flow_like_text(2000, 1);
+	gchar *target = create_flow_like_text(2050, 3);
+	gchar *delta = gebr_delta_encode(base, target);
+	gchar *decoded = gebr_delta_decode(base, delta);
+
+	g_assert_cmpstr(decoded, ==, target);
+	g_assert_cmpuint(strlen(delta), <, strlen(target) / 20);
+
+	g_free(decoded);
+	g_free(delta);
+	g_free(target);
+	g_free(base);
+}
+
+void test_gebr_delta_wrong_base(void)
+{
+	gchar *delta = gebr_delta_encode("base one\n", "target\n");
+
+	g_assert(gebr_delta_decode("base two\n", delta) == NULL);
+	g_assert(gebr_delta_decode("base one\n", "bm90IGEgZGVsdGE=") == NULL);
+
+	g_free(delta);
+}
+
+void test_gebr_delta_corrupted_length(void)
+{
+	/* An uncompressed length of 4 GiB for a few bytes of data */
+	const guchar packed[] = { 0xff, 0xff, 0xff, 0xf0, 0x78, 0xda, 0x03, 0x00 };
+	gchar *delta = g_base64_encode(packed, sizeof(packed));
+	gchar *target = g_strnfill(1 << 20, 'a');
+	gchar *encoded;
+
+	g_assert(gebr_delta_decode("", delta) == NULL);
+
+	/* The bound holds for data compressed as much as zlib can */
+	encoded = gebr_delta_encode("", target);
+	g_free(delta);
+	delta = gebr_delta_decode("", encoded);
+	g_assert_cmpstr(delta, ==, target);
+
+	g_free(encoded);
+	g_free(target);
+	g_free(delta);
+}
+
+int main(int argc, char *argv[])
+{
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add_func("/libgebr/delta/round-trip", test_gebr_delta_round_trip);
+	g_test_add_func("/libgebr/delta/size", test_gebr_delta_size);
+	g_test_add_func("/libgebr/delta/wrong-base", test_gebr_delta_wrong_base);
+	g_test_add_func("/libgebr/delta/corrupted-length", test_gebr_delta_corrupted_length);
+
+	return g_test_run();
+}
@@ -99,6 +99,32 @@ void test_gebr_tar_compact (void)
 	g_free(fname);
 }
 
+static void
+cancel_on_progress (GebrTar *tar, guint64 done, guint64 total, gpointer data)
+{
+	gint *calls = data;
+
+	(*calls)++;
+	gebr_tar_cancel (tar);
+}
+
+void test_gebr_tar_cancel (void)
+{
+	GebrTar *tar;
+	gint calls = 0;
+	const gchar *path = "/tmp/tar-cancel-test.tar.xz";
+
+	tar = gebr_tar_create (path);
+	gebr_tar_set_level (tar, 0);
+	gebr_tar_set_progress_func (tar, cancel_on_progress, &calls);
+
+	g_assert (gebr_tar_compact (tar, TEST_SRCDIR) == FALSE);
+	g_assert (gebr_tar_is_cancelled (tar) == TRUE);
+	g_assert_cmpint (calls, ==, 1);
+	g_assert (g_file_test (path, G_FILE_TEST_EXISTS) == FALSE);
+	gebr_tar_free (tar);
+}
+
 int main(int argc, char *argv[])
 {
 	g_test_init(&argc, &argv, NULL);
@@ -106,6 +132,7 @@ int main(int argc, char *argv[])
 
 	g_test_add_func("/libgebr/tar/extract", test_gebr_tar_extract);
 	g_test_add_func("/libgebr/tar/compact", test_gebr_tar_compact);
+	g_test_add_func("/libgebr/tar/cancel", test_gebr_tar_cancel);
 
 	gint ret = g_test_run();
 	gebr_geoxml_finalize();
@@ -487,6 +487,44 @@ void test_gebr_validator_change(Fixture *fixture, gconstpointer data)
 	gebr_geoxml_object_unref(pi);
 }
 
+void test_gebr_validator_cache(Fixture *fixture, gconstpointer data)
+{
+	guint hits, misses;
+	GebrGeoXmlParameter *a;
+
+	a = gebr_geoxml_document_set_dict_keyword(fixture->proj,
+						  GEBR_GEOXML_PARAMETER_TYPE_FLOAT,
+						  "a", "2");
+	g_assert(gebr_validator_insert(fixture->validator, a, NULL, NULL));
+	DEF_FLOAT(fixture->line, "b", "a*3");
+	DEF_FLOAT(fixture->line, "c", "5");
+
+	VALIDATE_FLOAT_EXPR("b+1", "7");
+	VALIDATE_FLOAT_EXPR("c", "5");
+	gebr_validator_get_cache_stats(fixture->validator, &hits, &misses);
+	g_assert_cmpuint(hits, ==, 0);
+	g_assert_cmpuint(misses, ==, 2);
+
+	VALIDATE_FLOAT_EXPR("b+1", "7");
+	VALIDATE_FLOAT_EXPR("c", "5");
+	gebr_validator_get_cache_stats(fixture->validator, &hits, NULL);
+	g_assert_cmpuint(hits, ==, 2);
+
+	// b depends on a, so only "b+1" must be evaluated again
+	g_assert(gebr_validator_change_value(fixture->validator, a, "3", NULL, NULL));
+	VALIDATE_FLOAT_EXPR("b+1", "10");
+	VALIDATE_FLOAT_EXPR("c", "5");
+	gebr_validator_get_cache_stats(fixture->validator, &hits, &misses);
+	g_assert_cmpuint(hits, ==, 3);
+	g_assert_cmpuint(misses, ==, 3);
+
+	gebr_validator_remove(fixture->validator, a, NULL, NULL);
+	VALIDATE_FLOAT_EXPR_WITH_ERROR("b+1", GEBR_IEXPR_ERROR, GEBR_IEXPR_ERROR_BAD_REFERENCE);
+	VALIDATE_FLOAT_EXPR("c", "5");
+
+	gebr_geoxml_object_unref(a);
+}
+
 void test_gebr_validator_move(Fixture *fixture, gconstpointer data)
 {
 	GebrGeoXmlDocument *line = fixture->line;
@@ -1067,6 +1105,11 @@ int main(int argc, char *argv[])
 	           test_gebr_validator_iter,
 	           fixture_teardown);
 
+	g_test_add("/libgebr/validator/cache", Fixture, NULL,
+	           fixture_setup,
+	           test_gebr_validator_cache,
+	           fixture_teardown);
+
 	gint result = g_test_run();
 	gebr_geoxml_finalize();
 	return result;
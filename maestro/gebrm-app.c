@@ -24,6 +24,9 @@
 #include "gebrm-daemon.h"
 #include "gebrm-job.h"
 #include "gebrm-client.h"
+#include "gebrm-journal.h"
+#include "gebrm-output.h"
+#include "gebrm-sync.h"
 
 #include <glib/gprintf.h>
 #include <glib/gi18n.h>
@@ -52,6 +55,8 @@ struct _GebrmAppPriv {
 	GebrMaestroSettings *settings;
 
 	gboolean connect_all;
+	GList *connect_round;
+	GTimer *connect_timer;
 
 	GQueue *job_def_queue;
 	GQueue *job_run_queue;
@@ -63,6 +68,49 @@ struct _GebrmAppPriv {
 	// Job controller
 	GHashTable *jobs;
 	GHashTable *jobs_counter;
+
+	// Client synchronization: each change of a job visible to the
+	// clients takes a new sequence number, see GebrmSync
+	GebrmSync *sync;
+
+	// Jobs journal, restored on startup. The tasks restored from it wait
+	// in unlisted_tasks until their daemons list them again
+	GebrmJournal *journal;
+	guint snapshot_source;
+	GHashTable *unlisted_tasks;
+};
+
+/* daemons launched at the same time by a /connect-daemons request */
+#define MAX_PARALLEL_CONNECTIONS 16
+/* closed jobs remembered to be removed from reconnecting clients */
+#define MAX_CLOSED_JOBS 1024
+/* largest piece of task output sent in reply to an /output request */
+#define OUTPUT_PAGE_SIZE (64 << 10)
+
+/* record types of the jobs journal */
+#define JOURNAL_JOB	'J'
+#define JOURNAL_TASK	'T'
+#define JOURNAL_CLOSE	'C'
+#define JOURNAL_OUTPUT	'O'
+
+/* fields of a JOURNAL_JOB record */
+enum {
+	JF_ID, JF_TEMP_ID, JF_TITLE, JF_DESCRIPTION, JF_FLOW_ID, JF_FLOW_TITLE,
+	JF_HOSTNAME, JF_QUEUE, JF_NICE, JF_INPUT, JF_OUTPUT, JF_ERROR,
+	JF_SUBMIT_DATE, JF_GROUP, JF_GROUP_TYPE, JF_SPEED, JF_SNAPSHOT_ID,
+	JF_SNAPSHOT_TITLE, JF_COUNTER, JF_RUN_TYPE, JF_SERVERS, JF_NPROCS,
+	JF_MPI_OWNER, JF_MPI_FLAVOR, JF_TOTAL, JF_STATUS, N_JOB_FIELDS
+};
+
+/* fields of a JOURNAL_TASK record */
+enum {
+	TF_JOB_ID, TF_FRAC, TF_DAEMON, TF_STATUS, TF_START_DATE, TF_FINISH_DATE,
+	TF_ISSUES, TF_CMD_LINE, TF_OUTPUT, N_TASK_FIELDS
+};
+
+/* fields of a JOURNAL_OUTPUT record, the output of a task on disk */
+enum {
+	OF_JOB_ID, OF_FRAC, OF_LENGTH, N_OUTPUT_FIELDS
 };
 
 typedef struct {
@@ -124,7 +172,15 @@ gboolean gebrm_config_load_servers(GebrmApp *app, const gchar *path);
 
 static void send_job_def_to_clients(GebrmApp *app, GebrmJob *job);
 
-static void send_messages_of_jobs(const gchar *id, GebrmJob *job, GebrCommProtocolSocket *protocol);
+static void send_job_metadata(const gchar *id, GebrmJob *job, GebrCommProtocolSocket *protocol);
+
+static void gebrm_app_sync_client(GebrmApp *app, GebrCommProtocolSocket *socket, const gchar *cursor);
+
+static void gebrm_app_send_output_page(GebrmApp *app, GebrmClient *client, const gchar *id,
+				       gint frac, guint64 offset);
+
+static void gebrm_app_send_output_tail(GebrmApp *app, GebrmClient *client, const gchar *id,
+				       gint frac, guint lines);
 
 static gboolean gebrm_app_increment_jobs_counter(GebrmApp *app, const gchar *flow_id);
 
@@ -137,12 +193,216 @@ gebrm_app_job_controller_find(GebrmApp *app, const gchar *id)
 	return g_hash_table_lookup(app->priv->jobs, id);
 }
 
+/* Jobs journal {{{ */
+static void
+journal_job(GebrmJournal *journal, GebrmJob *job)
+{
+	const gchar *fields[N_JOB_FIELDS];
+	gchar *input, *output, *error;
+	gchar *total = g_strdup_printf("%d", gebrm_job_get_total_tasks(job));
+
+	gebrm_job_get_io(job, &input, &output, &error);
+
+	fields[JF_ID] = gebrm_job_get_id(job);
+	fields[JF_TEMP_ID] = gebrm_job_get_temp_id(job);
+	fields[JF_TITLE] = gebrm_job_get_title(job);
+	fields[JF_DESCRIPTION] = gebrm_job_get_description(job);
+	fields[JF_FLOW_ID] = gebrm_job_get_flow_id(job);
+	fields[JF_FLOW_TITLE] = gebrm_job_get_flow_title(job);
+	fields[JF_HOSTNAME] = gebrm_job_get_hostname(job);
+	fields[JF_QUEUE] = gebrm_job_get_queue(job);
+	fields[JF_NICE] = gebrm_job_get_nice(job);
+	fields[JF_INPUT] = input;
+	fields[JF_OUTPUT] = output;
+	fields[JF_ERROR] = error;
+	fields[JF_SUBMIT_DATE] = gebrm_job_get_submit_date(job);
+	fields[JF_GROUP] = gebrm_job_get_server_group(job);
+	fields[JF_GROUP_TYPE] = gebrm_job_get_server_group_type(job);
+	fields[JF_SPEED] = gebrm_job_get_exec_speed(job);
+	fields[JF_SNAPSHOT_ID] = gebrm_job_get_snapshot_id(job);
+	fields[JF_SNAPSHOT_TITLE] = gebrm_job_get_snapshot_title(job);
+	fields[JF_COUNTER] = gebrm_job_get_job_counter(job);
+	fields[JF_RUN_TYPE] = gebrm_job_get_run_type(job);
+	fields[JF_SERVERS] = gebrm_job_get_servers_list(job);
+	fields[JF_NPROCS] = gebrm_job_get_nprocs(job);
+	fields[JF_MPI_OWNER] = gebrm_job_get_mpi_owner(job);
+	fields[JF_MPI_FLAVOR] = gebrm_job_get_mpi_flavor(job);
+	fields[JF_TOTAL] = total;
+	fields[JF_STATUS] = gebr_comm_job_get_string_from_status(gebrm_job_get_status(job));
+
+	gebrm_journal_append(journal, JOURNAL_JOB, fields, N_JOB_FIELDS);
+
+	g_free(input);
+	g_free(output);
+	g_free(error);
+	g_free(total);
+}
+
+static void
+journal_task(GebrmJournal *journal, GebrmTask *task)
+{
+	const gchar *fields[N_TASK_FIELDS];
+	gchar *frac = g_strdup_printf("%d", gebrm_task_get_fraction(task));
+	gchar *output = g_strdup_printf("%"G_GUINT64_FORMAT, gebrm_task_get_stored_output_length(task));
+
+	fields[TF_JOB_ID] = gebrm_task_get_job_id(task);
+	fields[TF_FRAC] = frac;
+	fields[TF_DAEMON] = gebrm_daemon_get_address(gebrm_task_get_daemon(task));
+	fields[TF_STATUS] = gebr_comm_job_get_string_from_status(gebrm_task_get_status(task));
+	fields[TF_START_DATE] = gebrm_task_get_start_date(task);
+	fields[TF_FINISH_DATE] = gebrm_task_get_finish_date(task);
+	fields[TF_ISSUES] = gebrm_task_get_issues(task);
+	fields[TF_CMD_LINE] = gebrm_task_get_cmd_line(task);
+	fields[TF_OUTPUT] = output;
+
+	gebrm_journal_append(journal, JOURNAL_TASK, fields, N_TASK_FIELDS);
+	g_free(frac);
+	g_free(output);
+}
+
+static void
+dump_jobs(GebrmJournal *journal, GebrmApp *app)
+{
+	GHashTableIter iter;
+	gpointer job;
+
+	g_hash_table_iter_init(&iter, app->priv->jobs);
+	while (g_hash_table_iter_next(&iter, NULL, &job)) {
+		journal_job(journal, job);
+		for (GList *i = gebrm_job_get_list_of_tasks(job); i; i = i->next)
+			journal_task(journal, i->data);
+	}
+}
+
+static gboolean
+write_snapshot(gpointer data)
+{
+	GebrmApp *app = data;
+	GError *error = NULL;
+
+	app->priv->snapshot_source = 0;
+
+	if (!gebrm_journal_write_snapshot(app->priv->journal,
+					  (GebrmJournalDumpFunc)dump_jobs, app, &error)) {
+		gebr_log(GEBR_LOG_ERROR, "Cannot compact the jobs journal: %s", error->message);
+		g_error_free(error);
+	}
+
+	return FALSE;
+}
+
+/*
+ * Compacts the journal once it grows larger than the last snapshot. This is
+ * done when idle, so a burst of changes is not interrupted.
+ */
+static void
+schedule_snapshot(GebrmApp *app)
+{
+	if (!app->priv->snapshot_source && gebrm_journal_needs_snapshot(app->priv->journal))
+		app->priv->snapshot_source = g_idle_add(write_snapshot, app);
+}
+
+static void
+gebrm_app_journal_task(GebrmApp *app, GebrmTask *task)
+{
+	if (!app->priv->journal)
+		return;
+
+	journal_task(app->priv->journal, task);
+	schedule_snapshot(app);
+}
+
+static void
+gebrm_app_job_controller_on_task_status_change(GebrmTask *task,
+					       gint old_status,
+					       gint new_status,
+					       const gchar *parameter,
+					       GebrmApp *app)
+{
+	gebrm_app_journal_task(app, task);
+}
+
+/*
+ * Records how much of the output of @task is on disk, which is restored with
+ * the task. The daemon sends again the output after it, see
+ * gebrm_daemon_list_tasks_and_forward_x().
+ */
+static void
+gebrm_app_job_controller_on_task_output_stored(GebrmTask *task,
+					       GebrmApp *app)
+{
+	if (!app->priv->journal)
+		return;
+
+	const gchar *fields[N_OUTPUT_FIELDS];
+	gchar *frac = g_strdup_printf("%d", gebrm_task_get_fraction(task));
+	gchar *length = g_strdup_printf("%"G_GUINT64_FORMAT, gebrm_task_get_stored_output_length(task));
+
+	fields[OF_JOB_ID] = gebrm_task_get_job_id(task);
+	fields[OF_FRAC] = frac;
+	fields[OF_LENGTH] = length;
+
+	gebrm_journal_append(app->priv->journal, JOURNAL_OUTPUT, fields, N_OUTPUT_FIELDS);
+	schedule_snapshot(app);
+
+	g_free(frac);
+	g_free(length);
+}
+
+static void
+gebrm_app_job_controller_connect_task(GebrmApp *app, GebrmTask *task)
+{
+	g_signal_connect(task, "status-change",
+			 G_CALLBACK(gebrm_app_job_controller_on_task_status_change), app);
+	g_signal_connect(task, "output-stored",
+			 G_CALLBACK(gebrm_app_job_controller_on_task_output_stored), app);
+}
+/* }}} */
+
+/*
+ * Marks a change of @job visible to the clients, and records its new state in
+ * the journal.
+ */
+static void
+gebrm_app_job_controller_touch(GebrmApp *app, GebrmJob *job)
+{
+	gebrm_job_set_sync_seq(job, gebrm_sync_touch(app->priv->sync));
+
+	if (app->priv->journal) {
+		journal_job(app->priv->journal, job);
+		schedule_snapshot(app);
+	}
+}
+
 static void
 gebrm_app_job_controller_add(GebrmApp *app, GebrmJob *job)
 {
 	g_hash_table_insert(app->priv->jobs,
 			    g_strdup(gebrm_job_get_id(job)),
 			    job);
+	gebrm_app_job_controller_touch(app, job);
+}
+
+static void
+gebrm_app_job_controller_remove(GebrmApp *app, const gchar *id)
+{
+	gebrm_sync_close(app->priv->sync, id);
+
+	for (GList *i = app->priv->connections; i; i = i->next)
+		gebrm_client_unwatch_job_output(i->data, id);
+
+	GebrmJob *job = gebrm_app_job_controller_find(app, id);
+	if (job)
+		for (GList *i = gebrm_job_get_list_of_tasks(job); i; i = i->next)
+			g_hash_table_remove(app->priv->unlisted_tasks, i->data);
+
+	if (app->priv->journal) {
+		const gchar *fields[] = { id };
+		gebrm_journal_append(app->priv->journal, JOURNAL_CLOSE, fields, 1);
+		schedule_snapshot(app);
+	}
+
+	g_hash_table_remove(app->priv->jobs, id);
 }
 
 // Configuration Methods {{{
@@ -302,10 +562,52 @@ gebrm_app_job_controller_on_task_def(GebrmDaemon *daemon,
 	const gchar *rid = gebrm_task_get_job_id(task);
 	GebrmJob *job = gebrm_app_job_controller_find(app, rid);
 
-	if (!job)
-		g_return_if_reached();
+	g_hash_table_remove(app->priv->unlisted_tasks, task);
 
-	gebrm_job_append_task(job, task);
+	/* The job was closed while the daemon was disconnected */
+	if (!job) {
+		g_debug("Daemon %s listed task %d of unknown job %s",
+			gebrm_daemon_get_address(daemon), gebrm_task_get_fraction(task), rid);
+		return;
+	}
+
+	/* Tasks are listed again after reconnections */
+	if (!g_list_find(gebrm_job_get_list_of_tasks(job), task)) {
+		gebrm_job_append_task(job, task);
+		gebrm_app_job_controller_connect_task(app, task);
+	}
+
+	gebrm_app_journal_task(app, task);
+}
+
+/*
+ * Fails the restored tasks @daemon did not list, it lost them while the
+ * maestro was down.
+ */
+static void
+gebrm_app_daemon_on_tasks_listed(GebrmDaemon *daemon,
+				 GebrmApp *app)
+{
+	GHashTableIter iter;
+	gpointer task;
+	GList *lost = NULL;
+
+	g_hash_table_iter_init(&iter, app->priv->unlisted_tasks);
+	while (g_hash_table_iter_next(&iter, &task, NULL)) {
+		if (gebrm_task_get_daemon(task) == daemon) {
+			lost = g_list_prepend(lost, task);
+			g_hash_table_iter_remove(&iter);
+		}
+	}
+
+	for (GList *i = lost; i; i = i->next) {
+		gebr_log(GEBR_LOG_WARNING, "Task %d of job %s was lost by %s",
+			 gebrm_task_get_fraction(i->data), gebrm_task_get_job_id(i->data),
+			 gebrm_daemon_get_address(daemon));
+		gebrm_task_emit_status_changed_signal(i->data, JOB_STATUS_FAILED, "");
+	}
+
+	g_list_free(lost);
 }
 
 static void
@@ -313,6 +615,8 @@ gebrm_app_job_controller_on_issued(GebrmJob    *job,
 				   const gchar *issues,
 				   GebrmApp    *app)
 {
+	gebrm_app_job_controller_touch(app, job);
+
 	for (GList *i = app->priv->connections; i; i = i->next) {
 		GebrCommProtocolSocket *socket = gebrm_client_get_protocol_socket(i->data);
 		gebr_comm_protocol_socket_oldmsg_send(socket, FALSE,
@@ -328,6 +632,8 @@ gebrm_app_job_controller_on_cmd_line_received(GebrmJob *job,
 					      const gchar *cmd,
 					      GebrmApp *app)
 {
+	gebrm_app_job_controller_touch(app, job);
+
 	gchar *frac;
 	for (GList *i = app->priv->connections; i; i = i->next) {
 		frac = g_strdup_printf("%d", gebrm_task_get_fraction(task));
@@ -347,16 +653,32 @@ gebrm_app_job_controller_on_output(GebrmJob *job,
 				   const gchar *output,
 				   GebrmApp *app)
 {
+	const gchar *id = gebrm_job_get_id(job);
+	gchar *frac = NULL, *offset = NULL, *total = NULL;
+
+	/* output is only appended to the task, so @output is its tail */
+	guint64 len = gebrm_task_get_output_length(task);
+
 	for (GList *i = app->priv->connections; i; i = i->next) {
-		gchar *frac = g_strdup_printf("%d", gebrm_task_get_fraction(task));
+		if (!gebrm_client_watches_job_output(i->data, id))
+			continue;
+
+		if (!frac) {
+			frac = g_strdup_printf("%d", gebrm_task_get_fraction(task));
+			offset = g_strdup_printf("%"G_GUINT64_FORMAT, len - strlen(output));
+			total = g_strdup_printf("%"G_GUINT64_FORMAT, len);
+		}
+
 		GebrCommProtocolSocket *socket = gebrm_client_get_protocol_socket(i->data);
 		gebr_comm_protocol_socket_oldmsg_send(socket, FALSE,
-						      gebr_comm_protocol_defs.out_def, 3,
-						      gebrm_job_get_id(job),
-						      frac,
+						      gebr_comm_protocol_defs.out_def, 5,
+						      id, frac, offset, total,
 						      output);
-		g_free(frac);
 	}
+
+	g_free(frac);
+	g_free(offset);
+	g_free(total);
 }
 
 static void
@@ -366,6 +688,8 @@ gebrm_app_job_controller_on_status_change(GebrmJob *job,
 					  const gchar *parameter,
 					  GebrmApp *app)
 {
+	gebrm_app_job_controller_touch(app, job);
+
 	if (new_status == JOB_STATUS_FAILED)
 		gebrm_job_kill_tasks(job);
 
@@ -402,23 +726,136 @@ gebrm_app_job_controller_on_status_change(GebrmJob *job,
 
 }
 
+static gboolean
+is_connecting(GebrmDaemon *daemon)
+{
+	GebrCommServerState state = gebrm_daemon_get_state(daemon);
+
+	return state == SERVER_STATE_RUN
+		|| state == SERVER_STATE_OPEN_TUNNEL
+		|| state == SERVER_STATE_CONNECT;
+}
+
+static gboolean
+needs_connection(GebrmDaemon *daemon)
+{
+	return gebrm_daemon_get_state(daemon) != SERVER_STATE_LOGGED
+		&& !is_connecting(daemon)
+		&& !g_strcmp0(gebrm_daemon_get_autoconnect(daemon), "on")
+		&& !gebrm_daemon_get_canceled(daemon);
+}
+
+static guint
+count_connecting(GebrmApp *app)
+{
+	guint n = 0;
+
+	for (GList *i = app->priv->daemons; i; i = i->next)
+		if (is_connecting(i->data))
+			n++;
+
+	return n;
+}
+
+/*
+ * connect_daemon:
+ *
+ * Connects @daemon as part of the current /connect-daemons request, whose
+ * startup times are logged when it finishes.
+ */
+static void
+connect_daemon(GebrmApp *app,
+	       GebrmDaemon *daemon,
+	       GebrCommProtocolSocket *socket)
+{
+	if (!g_list_find(app->priv->connect_round, daemon))
+		app->priv->connect_round = g_list_prepend(app->priv->connect_round,
+							  g_object_ref(daemon));
+	gebrm_daemon_connect(daemon, NULL, socket);
+}
+
+/*
+ * log_startup_times:
+ *
+ * Logs a histogram of the time each daemon of the finished /connect-daemons
+ * request took to log in.
+ */
+static void
+log_startup_times(GebrmApp *app)
+{
+	static const gdouble bounds[] = { 0.5, 1, 2, 5, 10, 20, G_MAXDOUBLE };
+	guint counts[G_N_ELEMENTS(bounds)] = { 0, };
+	guint n_failed = 0;
+	guint n_logged = 0;
+	guint max = 0;
+
+	for (GList *i = app->priv->connect_round; i; i = i->next) {
+		GebrCommServer *server = gebrm_daemon_get_server(i->data);
+		gdouble time = gebr_comm_server_get_startup_time(server);
+		guint j = 0;
+
+		if (time < 0) {
+			n_failed++;
+			continue;
+		}
+
+		while (time >= bounds[j])
+			j++;
+		max = MAX(max, ++counts[j]);
+		n_logged++;
+	}
+
+	gebr_log(GEBR_LOG_INFO, "Connected %u of %u daemons in %.2lf seconds",
+		 n_logged, n_logged + n_failed,
+		 g_timer_elapsed(app->priv->connect_timer, NULL));
+
+	for (guint j = 0; j < G_N_ELEMENTS(bounds); j++) {
+		if (!counts[j])
+			continue;
+
+		gchar *bar = g_strnfill(MAX(1, counts[j] * 40 / max), '#');
+		if (bounds[j] == G_MAXDOUBLE)
+			gebr_log(GEBR_LOG_INFO, "  >= %4.1lfs: %4u %s", bounds[j - 1], counts[j], bar);
+		else
+			gebr_log(GEBR_LOG_INFO, "  <  %4.1lfs: %4u %s", bounds[j], counts[j], bar);
+		g_free(bar);
+	}
+
+	if (n_failed)
+		gebr_log(GEBR_LOG_INFO, "  failed:  %4u", n_failed);
+
+	g_list_foreach(app->priv->connect_round, (GFunc) g_object_unref, NULL);
+	g_list_free(app->priv->connect_round);
+	app->priv->connect_round = NULL;
+}
+
 static void
 verify_connect_all(GebrmApp *app)
 {
 	for (GList *i = app->priv->daemons; i; i = i->next) {
 		GebrmDaemon *daemon = i->data;
 		if (gebrm_daemon_get_state(daemon) != SERVER_STATE_LOGGED &&
-		    !gebrm_daemon_get_canceled(daemon))
+		    !gebrm_daemon_get_canceled(daemon) &&
+		    !g_strcmp0(gebrm_daemon_get_autoconnect(daemon), "on"))
 			return;
 	}
 	app->priv->connect_all = FALSE;
+	log_startup_times(app);
 	return;
 }
 
+/*
+ * gebrm_app_continue_connections_of_daemons:
+ *
+ * Connects the daemons still waiting for the /connect-daemons request,
+ * keeping up to MAX_PARALLEL_CONNECTIONS of them being launched at once.
+ */
 static void
 gebrm_app_continue_connections_of_daemons(GebrmApp *app,
                                           gboolean from_append_key)
 {
+	guint n_connecting = count_connecting(app);
+
 	for(GList *i = app->priv->daemons; i; i = i->next) {
 		GebrmDaemon *d = i->data;
 
@@ -429,31 +866,19 @@ gebrm_app_continue_connections_of_daemons(GebrmApp *app,
 				return;
 		}
 
-		if (gebrm_daemon_get_state(d) != SERVER_STATE_LOGGED && !g_strcmp0(gebrm_daemon_get_autoconnect(d), "on")
-		    && !gebrm_daemon_get_canceled(d)) {
+		if (n_connecting >= MAX_PARALLEL_CONNECTIONS)
+			return;
+
+		if (needs_connection(d)) {
 			for (GList *j = app->priv->connections; j; j = j->next) {
 				GebrCommProtocolSocket *socket = gebrm_client_get_protocol_socket(j->data);
-				gebrm_daemon_connect(d, NULL, socket);
+				connect_daemon(app, d, socket);
 			}
-			if (!from_append_key)
-				return;
+			n_connecting++;
 		}
 	}
 }
 
-static gboolean
-time_out_daemon(gpointer user_data)
-{
-	g_debug("Daemon TIMEOUT");
-
-	GebrmApp *app = user_data;
-
-	gebrm_app_continue_connections_of_daemons(app, FALSE);
-	verify_connect_all(app);
-
-	return FALSE;
-}
-
 static void
 gebrm_app_daemon_on_state_change(GebrmDaemon *daemon,
 				 GebrCommServerState state,
@@ -472,14 +897,8 @@ gebrm_app_daemon_on_state_change(GebrmDaemon *daemon,
 		}
 
 		gboolean error = gebrm_daemon_get_error_type(daemon) != NULL;
-		if (error) {
-			guint timeout = gebrm_daemon_get_timeout(daemon);
-			if (timeout != -1) {
-				g_source_remove(timeout);
-				gebrm_daemon_set_timeout(daemon, -1);
-			}
+		if (error)
 			gebrm_daemon_set_canceled(daemon, TRUE);
-		}
 
 		if (gebrm_daemon_get_canceled(daemon)) {
 			if (app->priv->connect_all) {
@@ -500,20 +919,7 @@ gebrm_app_daemon_on_state_change(GebrmDaemon *daemon,
 		}
 	}
 
-	else if (state == SERVER_STATE_RUN) {
-		if (app->priv->connect_all) {
-			gebrm_daemon_set_canceled(daemon, TRUE);
-			guint timeout = g_timeout_add(6000, time_out_daemon, app);
-			gebrm_daemon_set_timeout(daemon, timeout);
-		}
-	}
-
 	else if (state == SERVER_STATE_LOGGED) {
-		guint timeout = gebrm_daemon_get_timeout(daemon);
-		if (timeout != -1) {
-			g_source_remove(timeout);
-			gebrm_daemon_set_timeout(daemon, -1);
-		}
 		gebrm_daemon_set_canceled(daemon, FALSE);
 		if (app->priv->connect_all) {
 			gebrm_app_continue_connections_of_daemons(app, FALSE);
@@ -535,9 +941,18 @@ gebrm_app_finalize(GObject *object)
 	g_list_foreach(app->priv->connections, (GFunc)g_object_unref, NULL);
 	g_list_free(app->priv->connections);
 	g_list_free(app->priv->daemons);
+	g_list_foreach(app->priv->connect_round, (GFunc)g_object_unref, NULL);
+	g_list_free(app->priv->connect_round);
+	g_timer_destroy(app->priv->connect_timer);
 	g_queue_free(app->priv->job_def_queue);
 	g_queue_free(app->priv->job_run_queue);
 	g_queue_free(app->priv->xauth_queue);
+	gebrm_sync_free(app->priv->sync);
+	if (app->priv->snapshot_source)
+		g_source_remove(app->priv->snapshot_source);
+	if (app->priv->journal)
+		gebrm_journal_free(app->priv->journal);
+	g_hash_table_unref(app->priv->unlisted_tasks);
 	G_OBJECT_CLASS(gebrm_app_parent_class)->finalize(object);
 }
 
@@ -596,7 +1011,15 @@ gebrm_app_init(GebrmApp *app)
 	app->priv->job_run_queue = g_queue_new();
 	app->priv->xauth_queue = g_queue_new();
 
+	app->priv->sync = gebrm_sync_new(MAX_CLOSED_JOBS);
+
+	app->priv->journal = NULL;
+	app->priv->snapshot_source = 0;
+	app->priv->unlisted_tasks = g_hash_table_new(NULL, NULL);
+
 	app->priv->connect_all = FALSE;
+	app->priv->connect_round = NULL;
+	app->priv->connect_timer = g_timer_new();
 
 	g_timeout_add(1000, process_xauth_queue, app);
 }
@@ -668,6 +1091,9 @@ err:
 	} else {
 		GebrCommServerState state = gebrm_daemon_get_state(daemon);
 
+		/* Reattach the tasks this daemon kept running */
+		gebrm_daemon_list_tasks_and_forward_x(daemon);
+
 		if (app->priv->home)
 			home_defined = TRUE;
 
@@ -780,6 +1206,8 @@ gebrm_add_server_to_list(GebrmApp *app,
 			 G_CALLBACK(on_daemon_ret_path), app);
 	g_signal_connect(daemon, "append-key",
 	                 G_CALLBACK(on_daemon_append_key), app);
+	g_signal_connect(daemon, "tasks-listed",
+			 G_CALLBACK(gebrm_app_daemon_on_tasks_listed), app);
 
 	gchar **tagsv = tags ? g_strsplit(tags, ",", -1) : NULL;
 	if (tagsv) {
@@ -922,6 +1350,8 @@ send_job_def_to_clients(GebrmApp *app, GebrmJob *job)
 	const gchar *snapshot_id = gebrm_job_get_snapshot_id(job);
 	const gchar *description = gebrm_job_get_description(job);
 
+	gebrm_app_job_controller_touch(app, job);
+
 	for (GList *i = app->priv->connections; i; i = i->next) {
 		GebrCommProtocolSocket *socket = gebrm_client_get_protocol_socket(i->data);
 		gebr_comm_protocol_socket_oldmsg_send(socket, FALSE,
@@ -955,6 +1385,13 @@ send_job_def_to_clients(GebrmApp *app, GebrmJob *job)
 	}
 }
 
+static void
+gebrm_app_job_controller_on_servers_changed(GebrmJob *job,
+					    GebrmApp *app)
+{
+	send_job_def_to_clients(app, job);
+}
+
 static void
 on_execution_response(GebrCommRunner *runner,
 		      gpointer data)
@@ -967,22 +1404,36 @@ on_execution_response(GebrCommRunner *runner,
 	gebrm_job_set_servers_list(aap->job, gebr_comm_runner_get_servers_list(runner));
 	gebrm_job_set_nprocs(aap->job, gebr_comm_runner_get_ncores(runner));
 
-	g_queue_pop_head(aap->app->priv->job_def_queue);
+	/* Runners are dispatched concurrently, so they may finish in any order */
+	g_queue_remove(aap->app->priv->job_def_queue, aap->job);
 	send_job_def_to_clients(aap->app, aap->job);
 
-	g_queue_pop_head(aap->app->priv->job_run_queue);
-	GebrCommRunner *next_run = g_queue_peek_head(aap->app->priv->job_run_queue);
-	if (next_run && !gebr_comm_runner_run_async(next_run)) {
-		const gchar *id = gebr_comm_runner_get_id(next_run);
-		GebrmJob *job = gebrm_app_job_controller_find(aap->app, id);
-		gebrm_job_kill_immediately(job);
-	}
+	g_queue_remove(aap->app->priv->job_run_queue, runner);
 
-	gebr_validator_free(gebr_comm_runner_get_validator(runner));
-	gebr_comm_runner_free(runner);
+	if (gebr_comm_runner_has_pending_steps(runner)) {
+		gebrm_job_set_runner(aap->job, runner);
+	} else {
+		gebr_validator_free(gebr_comm_runner_get_validator(runner));
+		gebr_comm_runner_free(runner);
+	}
 	g_free(aap);
 }
 
+static void
+gebrm_app_job_controller_connect(GebrmApp *app, GebrmJob *job)
+{
+	g_signal_connect(job, "status-change",
+			 G_CALLBACK(gebrm_app_job_controller_on_status_change), app);
+	g_signal_connect(job, "issued",
+			 G_CALLBACK(gebrm_app_job_controller_on_issued), app);
+	g_signal_connect(job, "cmd-line-received",
+			 G_CALLBACK(gebrm_app_job_controller_on_cmd_line_received), app);
+	g_signal_connect(job, "output",
+			 G_CALLBACK(gebrm_app_job_controller_on_output), app);
+	g_signal_connect(job, "servers-changed",
+			 G_CALLBACK(gebrm_app_job_controller_on_servers_changed), app);
+}
+
 static void
 gebrm_app_handle_run(GebrmApp *app, GebrCommHttpMsg *request, GebrmClient *client, GebrCommUri *uri)
 {
@@ -1001,6 +1452,7 @@ gebrm_app_handle_run(GebrmApp *app, GebrCommHttpMsg *request, GebrmClient *clien
 	const gchar *paths		= gebr_comm_uri_get_param(uri, "paths");
 	const gchar *snapshot_title	= gebr_comm_uri_get_param(uri, "snapshot_title");
 	const gchar *snapshot_id	= gebr_comm_uri_get_param(uri, "snapshot_id");
+	const gchar *scheduling		= gebr_comm_uri_get_param(uri, "scheduling");
 
 	if (temp_parent)
 		parent_id = gebrm_client_get_job_id_from_temp(client,
@@ -1060,15 +1512,7 @@ gebrm_app_handle_run(GebrmApp *app, GebrCommHttpMsg *request, GebrmClient *clien
 	GebrmJob *job = gebrm_job_new();
 
 	gebrm_client_add_temp_id(client, temp_id, gebrm_job_get_id(job));
-
-	g_signal_connect(job, "status-change",
-			 G_CALLBACK(gebrm_app_job_controller_on_status_change), app);
-	g_signal_connect(job, "issued",
-			 G_CALLBACK(gebrm_app_job_controller_on_issued), app);
-	g_signal_connect(job, "cmd-line-received",
-			 G_CALLBACK(gebrm_app_job_controller_on_cmd_line_received), app);
-	g_signal_connect(job, "output",
-			 G_CALLBACK(gebrm_app_job_controller_on_output), app);
+	gebrm_app_job_controller_connect(app, job);
 
 	gebrm_job_init_details(job, &info);
 	gebrm_app_job_controller_add(app, job);
@@ -1109,7 +1553,7 @@ gebrm_app_handle_run(GebrmApp *app, GebrCommHttpMsg *request, GebrmClient *clien
 
 		for (GList *i = app->priv->connections; i; i = i->next) {
 			GebrCommProtocolSocket *socket_client = gebrm_client_get_protocol_socket(i->data);
-			send_messages_of_jobs(gebrm_job_get_id(job), job, socket_client);
+			send_job_metadata(gebrm_job_get_id(job), job, socket_client);
 			gebr_comm_protocol_socket_oldmsg_send(socket_client, FALSE,
 							      gebr_comm_protocol_defs.iss_def, 2,
 							      gebrm_job_get_id(job),
@@ -1123,6 +1567,11 @@ gebrm_app_handle_run(GebrmApp *app, GebrCommHttpMsg *request, GebrmClient *clien
 							      gid, parent_id, speed, nice,
 							      name, paths, validator);
 
+		if (g_strcmp0(scheduling, "static") == 0)
+			gebr_comm_runner_set_scheduling(runner, GEBR_COMM_RUNNER_SCHEDULING_STATIC);
+		else
+			gebr_comm_runner_set_scheduling(runner, GEBR_COMM_RUNNER_SCHEDULING_DYNAMIC);
+
 		AppAndJob *aap = g_new(AppAndJob, 1);
 		aap->app = app;
 		aap->job = job;
@@ -1139,10 +1588,11 @@ gebrm_app_handle_run(GebrmApp *app, GebrCommHttpMsg *request, GebrmClient *clien
 
 		if (!parent || run_immediately) {
 			g_queue_push_head(app->priv->job_def_queue, job);
-			if (g_queue_is_empty(app->priv->job_run_queue)
-			    && !gebr_comm_runner_run_async(runner))
-				gebrm_job_kill_immediately(job);
 			g_queue_push_tail(app->priv->job_run_queue, runner);
+			if (!gebr_comm_runner_run_async(runner)) {
+				g_queue_remove(app->priv->job_run_queue, runner);
+				gebrm_job_kill_immediately(job);
+			}
 		} else {
 			GList *parent_on_queue = g_queue_find(app->priv->job_def_queue, parent);
 			if (parent_on_queue)
@@ -1206,7 +1656,12 @@ on_client_request(GebrCommProtocolSocket *socket,
 		}
 		else if (g_strcmp0(prefix, "/connect-daemons") == 0) {
 			gboolean has_daemons = FALSE;
-			gboolean connect_daemon = FALSE;
+			gboolean has_connected = FALSE;
+			guint n_connecting = count_connecting(app);
+
+			if (!app->priv->connect_all)
+				g_timer_start(app->priv->connect_timer);
+
 			app->priv->connect_all = TRUE;
 			for (GList *i = app->priv->daemons; i; i = i->next) {
 				has_daemons = TRUE;
@@ -1214,10 +1669,10 @@ on_client_request(GebrCommProtocolSocket *socket,
 
 				gebrm_daemon_set_canceled(daemon, FALSE);
 
-				if (!connect_daemon && gebrm_daemon_get_state(daemon) != SERVER_STATE_LOGGED &&
-				    g_strcmp0(gebrm_daemon_get_autoconnect(daemon), "on") == 0) {
-					gebrm_daemon_connect(daemon, NULL, socket);
-					connect_daemon = TRUE;
+				if (n_connecting < MAX_PARALLEL_CONNECTIONS && needs_connection(daemon)) {
+					connect_daemon(app, daemon, socket);
+					has_connected = TRUE;
+					n_connecting++;
 				}
 			}
 			if (!has_daemons) {
@@ -1228,7 +1683,7 @@ on_client_request(GebrCommProtocolSocket *socket,
 				gebrm_daemon_connect(d, NULL, socket);
 				gebrm_config_save_server(d);
 			}
-			if (!connect_daemon)
+			if (!has_connected)
 				app->priv->connect_all = FALSE;
 		}
 		else if (g_strcmp0(prefix, "/ssh-answer") == 0) {
@@ -1317,7 +1772,7 @@ on_client_request(GebrCommProtocolSocket *socket,
 			GebrmJob *job = g_hash_table_lookup(app->priv->jobs, id);
 			if (job) {
 				gebrm_job_close(job);
-				g_hash_table_remove(app->priv->jobs, id);
+				gebrm_app_job_controller_remove(app, id);
 
 				for (GList *i = app->priv->connections; i; i = i->next) {
 					GebrCommProtocolSocket *socket_client = gebrm_client_get_protocol_socket(i->data);
@@ -1367,6 +1822,28 @@ on_client_request(GebrCommProtocolSocket *socket,
 
 			gebrm_app_handle_run(app, request, client, uri);
 
+		} else if (g_strcmp0(prefix, "/sync") == 0) {
+			const gchar *cursor = gebr_comm_uri_get_param(uri, "cursor");
+			gebrm_app_sync_client(app, socket, cursor);
+		} else if (g_strcmp0(prefix, "/output") == 0) {
+			const gchar *id     = gebr_comm_uri_get_param(uri, "id");
+			const gchar *frac   = gebr_comm_uri_get_param(uri, "frac");
+			const gchar *offset = gebr_comm_uri_get_param(uri, "offset");
+			const gchar *lines  = gebr_comm_uri_get_param(uri, "lines");
+
+			if (id && frac && lines)
+				gebrm_app_send_output_tail(app, client, id, atoi(frac),
+							   strtoul(lines, NULL, 10));
+			else if (id && frac && offset)
+				gebrm_app_send_output_page(app, client, id, atoi(frac),
+							   g_ascii_strtoull(offset, NULL, 10));
+
+		} else if (g_strcmp0(prefix, "/unwatch") == 0) {
+			const gchar *id = gebr_comm_uri_get_param(uri, "id");
+
+			if (id)
+				gebrm_client_unwatch_job_output(client, id);
+
 		} else if (g_strcmp0(prefix, "/server-tags") == 0) {
 			const gchar *server = gebr_comm_uri_get_param(uri, "server");
 			const gchar *tags   = gebr_comm_uri_get_param(uri, "tags");
@@ -1443,13 +1920,11 @@ static void
 on_client_parse_messages(GebrCommProtocolSocket *socket,
 			 GebrmApp *app)
 {
-	GList *link;
 	struct gebr_comm_message *message;
 
 	GebrmClient *client = g_object_get_data(G_OBJECT(socket), "client");
 
-	while ((link = g_list_last(socket->protocol->messages)) != NULL) {
-		message = link->data;
+	while ((message = g_queue_peek_head(socket->protocol->messages)) != NULL) {
 
 		if (message->hash == gebr_comm_protocol_defs.ini_def.code_hash) {
 			GList *arguments;
@@ -1497,11 +1972,16 @@ on_client_parse_messages(GebrCommProtocolSocket *socket,
 			g_free(nfsid);
 
 			gchar *clocks_diff = g_strdup_printf("%d", diff_secs);
+			gint framing = gebr_comm_protocol_socket_oldmsg_peer_framing(message->argument, 7);
+			gchar *framing_str = g_strdup_printf("%d", framing);
 
 			gebr_comm_protocol_socket_oldmsg_send(socket, FALSE,
-							      gebr_comm_protocol_defs.ret_def, 1,
-							      clocks_diff);
+							      gebr_comm_protocol_defs.ret_def, 2,
+							      clocks_diff,
+							      framing_str);
+			gebr_comm_protocol_socket_set_framing(socket, framing);
 			g_free(clocks_diff);
+			g_free(framing_str);
 
 			for (GList *i = app->priv->daemons; i; i = i->next) {
 				GebrCommServerState state = gebrm_daemon_get_state(i->data);
@@ -1569,15 +2049,13 @@ on_client_parse_messages(GebrCommProtocolSocket *socket,
 			gebr_comm_protocol_socket_oldmsg_split_free(arguments);
 		}
 
-		gebr_comm_message_free(message);
-		socket->protocol->messages = g_list_delete_link(socket->protocol->messages, link);
+		gebr_comm_message_free(g_queue_pop_head(socket->protocol->messages));
 	}
 
 	return;
 
 err:
-	gebr_comm_message_free(message);
-	socket->protocol->messages = g_list_delete_link(socket->protocol->messages, link);
+	gebr_comm_message_free(g_queue_pop_head(socket->protocol->messages));
 	g_object_unref(client);
 }
 
@@ -1867,12 +2345,15 @@ on_client_disconnect(GebrCommProtocolSocket *socket,
 	}
 }
 
+/*
+ * Sends everything about @job but the output of its tasks, which the client
+ * requests with /output when it is displayed.
+ */
 static void
-send_messages_of_jobs(const gchar *id,
-                      GebrmJob *job,
-                      GebrCommProtocolSocket *protocol)
+send_job_metadata(const gchar *id,
+                  GebrmJob *job,
+                  GebrCommProtocolSocket *protocol)
 {
-
 	gchar *infile, *outfile, *logfile;
 
 	gebrm_job_get_io(job, &infile, &outfile, &logfile);
@@ -1912,19 +2393,8 @@ send_messages_of_jobs(const gchar *id,
 	                                      gebrm_job_get_mpi_flavor(job));
 
 	GList *tasks = gebrm_job_get_list_of_tasks(job);
-	
-	/* Output message*/
-	gchar *frac;
-	for(GList *i = tasks; i; i = i->next) {
-		frac = g_strdup_printf("%d", gebrm_task_get_fraction(i->data));
-		gebr_comm_protocol_socket_oldmsg_send(protocol, FALSE,
-						      gebr_comm_protocol_defs.out_def, 3,
-						      id,
-						      frac,
-						      gebrm_task_get_output(i->data));
 
-		g_free(frac);
-	}
+	gchar *frac;
 
 	/* Command line message */
 	for(GList *i = tasks; i; i = i->next) {
@@ -1950,6 +2420,130 @@ send_messages_of_jobs(const gchar *id,
 	g_free(logfile);
 }
 
+static void
+send_job_closed(const gchar *id,
+		gpointer socket)
+{
+	gebr_comm_protocol_socket_oldmsg_send(socket, FALSE,
+					      gebr_comm_protocol_defs.jcl_def, 1,
+					      id);
+}
+
+/*
+ * Sends to @socket the jobs changed after @cursor, as returned in the "end"
+ * SYN message of a previous synchronization. A %NULL, unknown or too old
+ * @cursor resets the client, which must forget the jobs not sent here.
+ */
+static void
+gebrm_app_sync_client(GebrmApp *app,
+		      GebrCommProtocolSocket *socket,
+		      const gchar *cursor)
+{
+	GHashTableIter iter;
+	gpointer id, job;
+	guint64 seq;
+	gboolean reset = !gebrm_sync_resume(app->priv->sync, cursor, &seq);
+
+	gebr_comm_protocol_socket_oldmsg_send(socket, FALSE,
+					      gebr_comm_protocol_defs.syn_def, 2,
+					      "begin", reset ? "1" : "0");
+
+	guint sent = 0;
+	g_hash_table_iter_init(&iter, app->priv->jobs);
+	while (g_hash_table_iter_next(&iter, &id, &job)) {
+		if (gebrm_job_get_sync_seq(job) <= seq)
+			continue;
+		send_job_metadata(id, job, socket);
+		sent++;
+	}
+
+	if (!reset)
+		gebrm_sync_foreach_closed(app->priv->sync, seq, send_job_closed, socket);
+
+	gchar *new_cursor = gebrm_sync_get_cursor(app->priv->sync);
+	gebr_comm_protocol_socket_oldmsg_send(socket, FALSE,
+					      gebr_comm_protocol_defs.syn_def, 2,
+					      "end", new_cursor);
+	g_debug("Synchronized client from %s: %u of %u jobs sent", cursor ? cursor : "scratch",
+		sent, g_hash_table_size(app->priv->jobs));
+	g_free(new_cursor);
+}
+
+/*
+ * Sends one page of the output of task @frac of job @id, starting at
+ * @offset, and starts forwarding the new output of this job to @client.
+ * The client asks for the next page while the reported total is larger than
+ * what it has.
+ */
+static void
+gebrm_app_send_output_page(GebrmApp *app,
+			   GebrmClient *client,
+			   const gchar *id,
+			   gint frac,
+			   guint64 offset)
+{
+	GebrmJob *job = gebrm_app_job_controller_find(app, id);
+	if (!job)
+		return;
+
+	GebrmTask *task = gebrm_job_get_task_from_fraction(job, frac);
+	guint64 total = task ? gebrm_task_get_output_length(task) : 0;
+	GString *page = g_string_new(NULL);
+
+	/* Read one byte more to see if the page ends in the middle of an UTF-8
+	 * character, which is then left to the next page */
+	if (task && offset < total) {
+		if (gebrm_task_read_output(task, offset, OUTPUT_PAGE_SIZE + 1, page)) {
+			if (page->len > OUTPUT_PAGE_SIZE) {
+				gsize end = OUTPUT_PAGE_SIZE;
+				while (end > 0 && (page->str[end] & 0xC0) == 0x80)
+					end--;
+				g_string_truncate(page, end ? end : OUTPUT_PAGE_SIZE);
+			}
+		} else {
+			/* Don't make the client ask again */
+			total = offset;
+		}
+	}
+
+	gebrm_client_watch_job_output(client, id);
+
+	gchar *frac_str = g_strdup_printf("%d", frac);
+	gchar *offset_str = g_strdup_printf("%"G_GUINT64_FORMAT, offset);
+	gchar *total_str = g_strdup_printf("%"G_GUINT64_FORMAT, total);
+
+	gebr_comm_protocol_socket_oldmsg_send(gebrm_client_get_protocol_socket(client), FALSE,
+					      gebr_comm_protocol_defs.out_def, 5,
+					      id, frac_str, offset_str, total_str, page->str);
+
+	g_string_free(page, TRUE);
+	g_free(frac_str);
+	g_free(offset_str);
+	g_free(total_str);
+}
+
+/*
+ * Like gebrm_app_send_output_page(), starting at the last @lines lines of
+ * the output of task @frac, so the end of a long output is shown without
+ * paging through all of it.
+ */
+static void
+gebrm_app_send_output_tail(GebrmApp *app,
+			   GebrmClient *client,
+			   const gchar *id,
+			   gint frac,
+			   guint lines)
+{
+	GebrmJob *job = gebrm_app_job_controller_find(app, id);
+	if (!job)
+		return;
+
+	GebrmTask *task = gebrm_job_get_task_from_fraction(job, frac);
+	guint64 offset = task ? gebrm_task_get_output_tail_offset(task, lines) : 0;
+
+	gebrm_app_send_output_page(app, client, id, frac, offset);
+}
+
 static void
 on_new_connection(GebrCommListenSocket *listener,
 		  GebrmApp *app)
@@ -1983,7 +2577,7 @@ on_new_connection(GebrCommListenSocket *listener,
 		g_signal_connect(socket, "old-parse-messages",
 				 G_CALLBACK(on_client_parse_messages), app);
 
-		g_hash_table_foreach(app->priv->jobs, (GHFunc)send_messages_of_jobs, socket);
+		/* jobs are sent when the client asks for /sync */
 	}
 }
 
@@ -2040,6 +2634,229 @@ gebrm_app_create_possible_daemon_list(GebrMaestroSettings *ms,
 	gebrm_add_server_to_list(app, g_get_host_name(), NULL, "");
 }
 
+/* Jobs restore {{{ */
+typedef struct {
+	gchar **fields;
+	/* fraction -> task fields */
+	GHashTable *tasks;
+} RestoredJob;
+
+static gchar **
+copy_fields(const gchar **fields, guint n_fields)
+{
+	gchar **copy = g_new(gchar *, n_fields + 1);
+
+	for (guint i = 0; i < n_fields; i++)
+		copy[i] = g_strdup(fields[i]);
+	copy[n_fields] = NULL;
+
+	return copy;
+}
+
+static void
+restored_job_free(RestoredJob *restored)
+{
+	g_strfreev(restored->fields);
+	g_hash_table_unref(restored->tasks);
+	g_free(restored);
+}
+
+/*
+ * Folds the records of the journal into @jobs, keeping only the last state
+ * of each job and task.
+ */
+static void
+on_journal_record(gchar type,
+		  const gchar **fields,
+		  guint n_fields,
+		  GHashTable *jobs)
+{
+	RestoredJob *restored;
+	gchar **task;
+
+	switch (type) {
+	case JOURNAL_JOB:
+		if (n_fields < N_JOB_FIELDS)
+			return;
+		restored = g_hash_table_lookup(jobs, fields[JF_ID]);
+		if (!restored) {
+			restored = g_new(RestoredJob, 1);
+			restored->tasks = g_hash_table_new_full(g_str_hash, g_str_equal,
+								g_free, (GDestroyNotify) g_strfreev);
+			g_hash_table_insert(jobs, g_strdup(fields[JF_ID]), restored);
+		} else
+			g_strfreev(restored->fields);
+		restored->fields = copy_fields(fields, N_JOB_FIELDS);
+		break;
+	case JOURNAL_TASK:
+		if (n_fields < N_TASK_FIELDS)
+			return;
+		restored = g_hash_table_lookup(jobs, fields[TF_JOB_ID]);
+		if (restored)
+			g_hash_table_replace(restored->tasks, g_strdup(fields[TF_FRAC]),
+					     copy_fields(fields, N_TASK_FIELDS));
+		break;
+	case JOURNAL_OUTPUT:
+		if (n_fields < N_OUTPUT_FIELDS)
+			return;
+		restored = g_hash_table_lookup(jobs, fields[OF_JOB_ID]);
+		task = restored ? g_hash_table_lookup(restored->tasks, fields[OF_FRAC]) : NULL;
+		if (task) {
+			g_free(task[TF_OUTPUT]);
+			task[TF_OUTPUT] = g_strdup(fields[OF_LENGTH]);
+		}
+		break;
+	case JOURNAL_CLOSE:
+		if (n_fields >= 1)
+			g_hash_table_remove(jobs, fields[0]);
+		break;
+	default:
+		g_warning("Unknown record '%c' in the jobs journal", type);
+	}
+}
+
+static GebrmDaemon *
+gebrm_app_find_daemon(GebrmApp *app, const gchar *address)
+{
+	for (GList *i = app->priv->daemons; i; i = i->next)
+		if (g_strcmp0(gebrm_daemon_get_address(i->data), address) == 0)
+			return i->data;
+	return NULL;
+}
+
+static void
+gebrm_app_restore_job(GebrmApp *app, RestoredJob *restored)
+{
+	gchar **f = restored->fields;
+	GebrmJobInfo info = { 0, };
+
+	info.id = f[JF_ID];
+	info.temp_id = f[JF_TEMP_ID];
+	info.title = f[JF_TITLE];
+	info.description = f[JF_DESCRIPTION];
+	info.flow_id = f[JF_FLOW_ID];
+	info.flow_title = f[JF_FLOW_TITLE];
+	info.hostname = f[JF_HOSTNAME];
+	info.parent_id = f[JF_QUEUE];
+	info.nice = f[JF_NICE];
+	info.input = f[JF_INPUT];
+	info.output = f[JF_OUTPUT];
+	info.error = f[JF_ERROR];
+	info.submit_date = f[JF_SUBMIT_DATE];
+	info.group = f[JF_GROUP];
+	info.group_type = f[JF_GROUP_TYPE];
+	info.speed = f[JF_SPEED];
+	info.snapshot_id = f[JF_SNAPSHOT_ID];
+	info.snapshot_title = f[JF_SNAPSHOT_TITLE];
+	info.job_counter = f[JF_COUNTER];
+
+	GebrmJob *job = gebrm_job_new_from_id(f[JF_ID]);
+	gebrm_job_init_details(job, &info);
+	gebrm_job_set_run_type(job, f[JF_RUN_TYPE]);
+	gebrm_job_set_servers_list(job, f[JF_SERVERS]);
+	gebrm_job_set_nprocs(job, f[JF_NPROCS]);
+	gebrm_job_set_mpi_owner(job, f[JF_MPI_OWNER]);
+	gebrm_job_set_mpi_flavor(job, f[JF_MPI_FLAVOR]);
+	gebrm_job_set_total_tasks(job, atoi(f[JF_TOTAL]));
+
+	GebrCommJobStatus status = gebr_comm_job_get_status_from_string(f[JF_STATUS]);
+	gboolean job_stopped = status == JOB_STATUS_FINISHED
+		|| status == JOB_STATUS_FAILED
+		|| status == JOB_STATUS_CANCELED;
+	gboolean waiting = FALSE;
+
+	GHashTableIter iter;
+	gpointer value;
+	g_hash_table_iter_init(&iter, restored->tasks);
+	while (g_hash_table_iter_next(&iter, NULL, &value)) {
+		gchar **t = value;
+		GebrmDaemon *daemon = gebrm_app_find_daemon(app, t[TF_DAEMON]);
+
+		if (!daemon) {
+			g_debug("Dropping task %s of job %s, daemon %s is gone",
+				t[TF_FRAC], f[JF_ID], t[TF_DAEMON]);
+			continue;
+		}
+
+		GebrCommJobStatus task_status = gebr_comm_job_get_status_from_string(t[TF_STATUS]);
+		gboolean stopped = task_status == JOB_STATUS_FINISHED
+			|| task_status == JOB_STATUS_FAILED
+			|| task_status == JOB_STATUS_CANCELED;
+
+		GebrmTask *task = gebrm_task_new(daemon, f[JF_ID], t[TF_FRAC]);
+		gebrm_task_restore(task, stopped ? task_status : JOB_STATUS_RUNNING,
+				   t[TF_START_DATE], t[TF_FINISH_DATE],
+				   t[TF_ISSUES], t[TF_CMD_LINE],
+				   g_ascii_strtoull(t[TF_OUTPUT], NULL, 10));
+		gebrm_job_restore_task(job, task);
+		gebrm_app_job_controller_connect_task(app, task);
+
+		if (!stopped) {
+			g_hash_table_insert(app->priv->unlisted_tasks, task, NULL);
+			waiting = TRUE;
+		}
+	}
+
+	/* Nothing will ever finish this job */
+	if (!job_stopped && !waiting)
+		status = JOB_STATUS_FAILED;
+	gebrm_job_set_status(job, status);
+
+	gebrm_app_job_controller_connect(app, job);
+	gebrm_app_job_controller_add(app, job);
+
+	gint *counter = g_hash_table_lookup(app->priv->jobs_counter, f[JF_FLOW_ID]);
+	gint job_counter = atoi(f[JF_COUNTER]);
+	if (!counter || *counter < job_counter) {
+		gint *new_counter = g_new(gint, 1);
+		*new_counter = job_counter;
+		g_hash_table_replace(app->priv->jobs_counter, g_strdup(f[JF_FLOW_ID]), new_counter);
+	}
+}
+
+/*
+ * Rebuilds the jobs of the previous maestro process from the journal. The
+ * tasks still running wait for their daemons to list them, see
+ * gebrm_app_daemon_on_tasks_listed().
+ */
+static void
+gebrm_app_restore_jobs(GebrmApp *app)
+{
+	GError *error = NULL;
+	GTimer *timer = g_timer_new();
+	GHashTable *jobs = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+						 (GDestroyNotify) restored_job_free);
+	const gchar *path = gebrm_app_get_jobs_journal_for_address(g_get_host_name());
+
+	GebrmJournal *journal = gebrm_journal_open(path, (GebrmJournalFunc) on_journal_record,
+						   jobs, &error);
+	if (!journal) {
+		gebr_log(GEBR_LOG_ERROR, "Jobs will not be kept across restarts: %s",
+			 error->message);
+		g_error_free(error);
+		g_hash_table_unref(jobs);
+		g_timer_destroy(timer);
+		return;
+	}
+
+	GHashTableIter iter;
+	gpointer restored;
+	g_hash_table_iter_init(&iter, jobs);
+	while (g_hash_table_iter_next(&iter, NULL, &restored))
+		gebrm_app_restore_job(app, restored);
+
+	/* Drop the history of the jobs closed before this restart */
+	app->priv->journal = journal;
+	write_snapshot(app);
+
+	gebr_log(GEBR_LOG_INFO, "Restored %u jobs in %.3fs",
+		 g_hash_table_size(jobs), g_timer_elapsed(timer, NULL));
+
+	g_hash_table_unref(jobs);
+	g_timer_destroy(timer);
+}
+/* }}} */
+
 gboolean
 gebrm_app_run(GebrmApp *app, int fd, const gchar *version)
 {
@@ -2109,6 +2926,11 @@ gebrm_app_run(GebrmApp *app, int fd, const gchar *version)
 	// Create configuration for NFS
 	app->priv->settings = gebrm_app_create_configuration();
 
+	// The restored tasks need their daemons
+	gebrm_app_create_possible_daemon_list(app->priv->settings, app);
+	gebrm_app_restore_jobs(app);
+	gebrm_output_remove_unused();
+
 	g_main_loop_run(app->priv->main_loop);
 
 	return TRUE;
@@ -2168,6 +2990,36 @@ gebrm_app_get_log_file_for_address(const gchar *addr)
 
 	return logfile;
 }
+
+const gchar *
+gebrm_app_get_jobs_journal_for_address(const gchar *addr)
+{
+	static gchar *journal = NULL;
+
+	if (!journal) {
+		gchar *last_folder = g_build_filename(addr, "jobs", NULL);
+		journal = gebrm_app_build_path(last_folder);
+		g_free(last_folder);
+	}
+
+	return journal;
+}
+
+const gchar *
+gebrm_app_get_output_dir_for_address(const gchar *addr)
+{
+	static gchar *dir = NULL;
+
+	if (!dir) {
+		gchar *last_folder = g_build_filename(addr, "output", NULL);
+		dir = gebrm_app_build_path(last_folder);
+		g_mkdir_with_parents(dir, 0700);
+		g_free(last_folder);
+	}
+
+	return dir;
+}
+
 const gchar *
 gebrm_app_get_version_file_for_addr(const gchar *addr)
 {
@@ -124,8 +124,23 @@ const gchar * gebrm_app_get_version_file(void);
 
 const gchar *gebrm_app_get_log_file_for_address(const gchar *addr);
 
+/**
+ * gebrm_app_get_jobs_journal_for_address:
+ *
+ * The journal the jobs are kept in across restarts of the maestro.
+ */
+const gchar *gebrm_app_get_jobs_journal_for_address(const gchar *addr);
+
 const gchar *gebrm_app_get_version_file_for_addr(const gchar *addr);
 
+/**
+ * gebrm_app_get_output_dir_for_address:
+ *
+ * Returns: The directory where the output of the tasks is spilled to disk,
+ * see #GebrmOutput.
+ */
+const gchar *gebrm_app_get_output_dir_for_address(const gchar *addr);
+
 const gchar *gebrm_app_get_servers_file(void);
 
 const gchar *gebrm_app_get_admin_servers_file(void);
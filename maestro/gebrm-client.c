@@ -28,6 +28,7 @@ struct _GebrmClientPriv {
 	gchar *cookie;
 	GList *forwards;
 	GHashTable *job_ids;
+	GHashTable *watched_jobs;
 	guint x11_port;
 };
 
@@ -95,6 +96,8 @@ gebrm_client_init(GebrmClient *client)
 
 	client->priv->job_ids = g_hash_table_new_full(g_str_hash, g_str_equal,
 						      g_free, g_free);
+	client->priv->watched_jobs = g_hash_table_new_full(g_str_hash, g_str_equal,
+							   g_free, NULL);
 }
 
 static void
@@ -115,6 +118,7 @@ gebrm_client_finalize(GObject *object)
 	g_object_unref(client->priv->socket);
 	g_free(client->priv->id);
 	g_hash_table_destroy(client->priv->job_ids);
+	g_hash_table_destroy(client->priv->watched_jobs);
 
 	G_OBJECT_CLASS(gebrm_client_parent_class)->finalize(object);
 }
@@ -290,6 +294,28 @@ gebrm_client_get_job_id_from_temp(GebrmClient *client,
 	return g_hash_table_lookup(client->priv->job_ids, temp_id);
 }
 
+void
+gebrm_client_watch_job_output(GebrmClient *client,
+			      const gchar *job_id)
+{
+	g_hash_table_insert(client->priv->watched_jobs,
+			    g_strdup(job_id), GINT_TO_POINTER(TRUE));
+}
+
+void
+gebrm_client_unwatch_job_output(GebrmClient *client,
+				const gchar *job_id)
+{
+	g_hash_table_remove(client->priv->watched_jobs, job_id);
+}
+
+gboolean
+gebrm_client_watches_job_output(GebrmClient *client,
+				const gchar *job_id)
+{
+	return g_hash_table_lookup(client->priv->watched_jobs, job_id) != NULL;
+}
+
 guint
 gebrm_client_get_display_port(GebrmClient *self,
 			      const gchar *addr)
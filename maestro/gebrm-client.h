@@ -102,6 +102,22 @@ void gebrm_client_add_temp_id(GebrmClient *client,
 const gchar *gebrm_client_get_job_id_from_temp(GebrmClient *client,
 					       const gchar *temp_id);
 
+/**
+ * gebrm_client_watch_job_output:
+ *
+ * Marks the output of job @job_id as being displayed by this client. Only
+ * watched jobs have their new output forwarded, the output of the other
+ * jobs is fetched page by page when the client needs it.
+ */
+void gebrm_client_watch_job_output(GebrmClient *client,
+				   const gchar *job_id);
+
+void gebrm_client_unwatch_job_output(GebrmClient *client,
+				     const gchar *job_id);
+
+gboolean gebrm_client_watches_job_output(GebrmClient *client,
+					 const gchar *job_id);
+
 /**
  * gebrm_client_get_display_port:
  *
@@ -21,6 +21,8 @@
 #include "gebrm-daemon.h"
 #include "gebrm-marshal.h"
 #include <stdlib.h>
+#include <string.h>
+#include <math.h>
 #include "gebrm-job.h"
 #include "gebrm-task.h"
 
@@ -33,8 +35,6 @@ struct _GebrmDaemonPriv {
 	gboolean is_canceled;
 	gboolean reconnnect;
 
-	guint timeout;
-
 	GHashTable *tasks;
 
 	GTree *tags;
@@ -52,8 +52,38 @@ struct _GebrmDaemonPriv {
 
 	gint uncompleted_tasks;
 	gchar *mpi_flavors;
+
+	gchar *load;
+	GTimeVal load_time;
+	GList *reservations;
+
+	/* Last resource sample pushed by the daemon, see gebrd-sampler.h */
+	gboolean has_sample;
+	gdouble cpu;
+	gdouble iowait;
+	gint run_queue;
+	gdouble psi_mem;
+	gdouble psi_io;
 };
 
+/* A load sample older than this, in seconds, is not used for scoring */
+#define LOAD_MAX_AGE 15
+
+/* Time constant, in seconds, of the 1 minute load average. A process started
+ * t seconds ago still misses exp(-t/LOAD_TIME_CONSTANT) of its weight in it. */
+#define LOAD_TIME_CONSTANT 60.0
+
+/* Seconds the processes of a task take to show up in the samples */
+#define SAMPLE_GRACE 2.0
+
+/* Seconds a daemon has to be launched and answer the handshake */
+#define DAEMON_CONNECT_TIMEOUT 30
+
+typedef struct {
+	GTimeVal time;
+	gint ncores;
+} CoreReservation;
+
 enum {
 	PROP_0,
 	PROP_ADDRESS,
@@ -70,6 +100,7 @@ enum {
 	PORT_DEFINE,
 	RET_PATH,
 	APPEND_KEY,
+	TASKS_LISTED,
 	LAST_SIGNAL
 };
 
@@ -124,6 +155,143 @@ gebrm_daemon_iface_get_flavors(GebrCommDaemon *idaemon)
 	return daemon->priv->mpi_flavors;
 }
 
+static gdouble
+seconds_since(const GTimeVal *time)
+{
+	GTimeVal now;
+	g_get_current_time(&now);
+	return (now.tv_sec - time->tv_sec) + (now.tv_usec - time->tv_usec) / 1e6;
+}
+
+const gchar *
+gebrm_daemon_iface_get_load(GebrCommDaemon *idaemon)
+{
+	GebrmDaemon *daemon = GEBRM_DAEMON(idaemon);
+
+	if (!daemon->priv->load || seconds_since(&daemon->priv->load_time) > LOAD_MAX_AGE)
+		return NULL;
+
+	return daemon->priv->load;
+}
+
+void
+gebrm_daemon_iface_reserve_cores(GebrCommDaemon *idaemon, gint ncores)
+{
+	GebrmDaemon *daemon = GEBRM_DAEMON(idaemon);
+	CoreReservation *r = g_new(CoreReservation, 1);
+
+	g_get_current_time(&r->time);
+	r->ncores = ncores;
+	daemon->priv->reservations = g_list_prepend(daemon->priv->reservations, r);
+}
+
+static gboolean
+has_recent_sample(GebrmDaemon *daemon)
+{
+	return daemon->priv->has_sample && gebrm_daemon_iface_get_load(GEBR_COMM_DAEMON(daemon)) != NULL;
+}
+
+gdouble
+gebrm_daemon_iface_get_reserved_cores(GebrCommDaemon *idaemon)
+{
+	GebrmDaemon *daemon = GEBRM_DAEMON(idaemon);
+	gdouble reserved = 0;
+	GList *i = daemon->priv->reservations;
+	gboolean sampled = has_recent_sample(daemon);
+	gdouble sample_age = seconds_since(&daemon->priv->load_time);
+
+	while (i) {
+		CoreReservation *r = i->data;
+		gdouble missing = r->ncores * exp(-seconds_since(&r->time) / LOAD_TIME_CONSTANT);
+
+		if (missing < 0.05) {
+			GList *next = i->next;
+			g_free(r);
+			daemon->priv->reservations = g_list_delete_link(daemon->priv->reservations, i);
+			i = next;
+			continue;
+		}
+
+		/* Samples are instantaneous, unlike the load averages: a task
+		 * is in them as soon as its processes started */
+		if (!sampled)
+			reserved += missing;
+		else if (seconds_since(&r->time) < sample_age + SAMPLE_GRACE)
+			reserved += r->ncores;
+		i = i->next;
+	}
+
+	return reserved;
+}
+
+gdouble
+gebrm_daemon_iface_get_busy_cores(GebrCommDaemon *idaemon)
+{
+	GebrmDaemon *daemon = GEBRM_DAEMON(idaemon);
+	gint ncores = daemon->priv->server->ncores;
+
+	if (!has_recent_sample(daemon))
+		return -1;
+
+	/* The run queue counts the sampler itself */
+	return MAX(daemon->priv->cpu * ncores / 100, daemon->priv->run_queue - 1);
+}
+
+gdouble
+gebrm_daemon_iface_get_stall(GebrCommDaemon *idaemon)
+{
+	GebrmDaemon *daemon = GEBRM_DAEMON(idaemon);
+
+	if (!has_recent_sample(daemon))
+		return 0;
+
+	/* Kernels without pressure information only tell the I/O wait */
+	if (daemon->priv->psi_mem >= 0 || daemon->priv->psi_io >= 0)
+		return MAX(daemon->priv->psi_mem, daemon->priv->psi_io) / 100;
+
+	return daemon->priv->iowait / 100;
+}
+
+/*
+ * gebrm_daemon_update_sample:
+ *
+ * Updates the sample of @daemon with the `key=value' pairs of @delta, pushed
+ * by the daemon when they changed.
+ */
+static void
+gebrm_daemon_update_sample(GebrmDaemon *daemon,
+			   const gchar *delta)
+{
+	gchar **pairs = g_strsplit(delta, " ", -1);
+
+	for (gint i = 0; pairs[i]; i++) {
+		gchar *value = strchr(pairs[i], '=');
+
+		if (!value)
+			continue;
+		*value++ = '\0';
+
+		if (!strcmp(pairs[i], "cpu"))
+			daemon->priv->cpu = g_ascii_strtod(value, NULL);
+		else if (!strcmp(pairs[i], "iow"))
+			daemon->priv->iowait = g_ascii_strtod(value, NULL);
+		else if (!strcmp(pairs[i], "rq"))
+			daemon->priv->run_queue = atoi(value);
+		else if (!strcmp(pairs[i], "psm"))
+			daemon->priv->psi_mem = g_ascii_strtod(value, NULL);
+		else if (!strcmp(pairs[i], "psi"))
+			daemon->priv->psi_io = g_ascii_strtod(value, NULL);
+		else if (!strcmp(pairs[i], "ld")) {
+			g_free(daemon->priv->load);
+			daemon->priv->load = g_strdelimit(g_strdup(value), ",", ' ');
+		}
+		/* Other keys are not used for scoring */
+	}
+
+	daemon->priv->has_sample = TRUE;
+	g_strfreev(pairs);
+}
+
 static void
 gebrm_daemon_init_iface(GebrCommDaemonIface *iface)
 {
@@ -133,6 +301,11 @@ gebrm_daemon_init_iface(GebrCommDaemonIface *iface)
 	iface->add_task = gebrm_daemon_iface_add_task;
 	iface->can_execute = gebrm_daemon_iface_can_execute;
 	iface->get_flavors = gebrm_daemon_iface_get_flavors;
+	iface->get_load = gebrm_daemon_iface_get_load;
+	iface->reserve_cores = gebrm_daemon_iface_reserve_cores;
+	iface->get_reserved_cores = gebrm_daemon_iface_get_reserved_cores;
+	iface->get_busy_cores = gebrm_daemon_iface_get_busy_cores;
+	iface->get_stall = gebrm_daemon_iface_get_stall;
 }
 
 static void
@@ -199,6 +372,11 @@ gebrm_server_op_state_changed(GebrCommServer *server,
 		}
 		daemon->priv->is_initialized = FALSE;
 		daemon->priv->uncompleted_tasks = 0;
+		g_free(daemon->priv->load);
+		daemon->priv->load = NULL;
+		daemon->priv->has_sample = FALSE;
+		daemon->priv->psi_mem = -1;
+		daemon->priv->psi_io = -1;
 	}
 	else if (server->state == SERVER_STATE_CONNECT) {
 		gebrm_daemon_set_error_type(daemon, NULL);
@@ -281,12 +459,10 @@ static void
 gebrm_server_op_parse_messages(GebrCommServer *server,
 			       gpointer user_data)
 {
-	GList *link;
 	struct gebr_comm_message *message;
 	GebrmDaemon *daemon = user_data;
 
-	while ((link = g_list_last(server->socket->protocol->messages)) != NULL) {
-		message = link->data;
+	while ((message = g_queue_peek_head(server->socket->protocol->messages)) != NULL) {
 
 
 		if (message->hash == gebr_comm_protocol_defs.ret_def.code_hash) {
@@ -310,6 +486,8 @@ gebrm_server_op_parse_messages(GebrCommServer *server,
 				GString *mpi_flavors  = g_list_nth_data (arguments, 10);
 
 				gebr_comm_server_set_logged(server);
+				gebr_comm_protocol_socket_set_framing(server->socket,
+								      gebr_comm_protocol_socket_oldmsg_peer_framing(message->argument, 11));
 
 				daemon->priv->is_initialized = TRUE;
 
@@ -398,28 +576,60 @@ gebrm_server_op_parse_messages(GebrCommServer *server,
 			GString *cmd = g_list_nth_data(arguments, 3);
 			GString *moab_jid = g_list_nth_data(arguments, 4);
 
-			GebrmTask *task = gebrm_task_new(daemon, id->str, frac->str);
-			g_signal_connect(task, "status-change",
-					 G_CALLBACK(gebrm_daemon_on_task_status_change), daemon);
-			gebrm_task_init_details(task, issues, cmd, moab_jid);
-
-			g_hash_table_insert(daemon->priv->tasks, gebrm_task_build_id(id->str, frac->str), task);
-			g_signal_emit(daemon, signals[TASK_DEFINE], 0, task);
+			if (!id->len) {
+				/* An empty task ends the reply to LST */
+				g_signal_emit(daemon, signals[TASKS_LISTED], 0);
+			} else {
+				/* Known tasks are listed again when the daemon
+				 * reconnects, or when the maestro restored them
+				 * from its journal */
+				gchar *tid = gebrm_task_build_id(id->str, frac->str);
+				GebrmTask *task = gebrm_task_find(id->str, frac->str);
+				if (!task)
+					task = gebrm_task_new(daemon, id->str, frac->str);
+
+				if (!g_hash_table_lookup(daemon->priv->tasks, tid)) {
+					g_signal_connect(task, "status-change",
+							 G_CALLBACK(gebrm_daemon_on_task_status_change), daemon);
+					g_hash_table_insert(daemon->priv->tasks, tid, task);
+				} else
+					g_free(tid);
+
+				gebrm_task_init_details(task, issues, cmd, moab_jid);
+				g_signal_emit(daemon, signals[TASK_DEFINE], 0, task);
+			}
 
 			gebr_comm_protocol_socket_oldmsg_split_free(arguments);
 		} else if (message->hash == gebr_comm_protocol_defs.out_def.code_hash) {
+			struct gebr_comm_slice arguments[4];
+
+			/* output bursts are frequent, don't copy them */
+			if (!gebr_comm_protocol_socket_oldmsg_split_slices(message->argument, 4, arguments))
+				goto err;
+
+			const gchar *output = arguments[1].str;
+			const gchar *rid = arguments[2].str;
+			const gchar *frac = arguments[3].str;
+
+			GebrmTask *task = gebrm_task_find(rid, frac);
+			gebrm_task_emit_output_signal(task, output);
+		} else if (message->hash == gebr_comm_protocol_defs.lod_def.code_hash) {
 			GList *arguments;
-			GString *output, *rid, *frac;
 
-			if ((arguments = gebr_comm_protocol_socket_oldmsg_split(message->argument, 4)) == NULL)
+			if ((arguments = gebr_comm_protocol_socket_oldmsg_split(message->argument, 1)) == NULL)
 				goto err;
 
-			output = g_list_nth_data(arguments, 1);
-			rid = g_list_nth_data(arguments, 2);
-			frac = g_list_nth_data(arguments, 3);
+			GString *load = g_list_nth_data(arguments, 0);
 
-			GebrmTask *task = gebrm_task_find(rid->str, frac->str);
-			gebrm_task_emit_output_signal(task, output->str);
+			/* Older daemons push the load averages only. An empty
+			 * sample means nothing changed. */
+			if (!load->len || strchr(load->str, '=')) {
+				gebrm_daemon_update_sample(daemon, load->str);
+			} else {
+				g_free(daemon->priv->load);
+				daemon->priv->load = g_strdup(load->str);
+			}
+			g_get_current_time(&daemon->priv->load_time);
 
 			gebr_comm_protocol_socket_oldmsg_split_free(arguments);
 		} else if (message->hash == gebr_comm_protocol_defs.sta_def.code_hash) {
@@ -434,9 +644,12 @@ gebrm_server_op_parse_messages(GebrCommServer *server,
 			rid = g_list_nth_data(arguments, 3);
 			frac = g_list_nth_data(arguments, 4);
 
+			/* Stopped tasks are listed with their status, which
+			 * may be known already */
 			GebrmTask *task = gebrm_task_find(rid->str, frac->str);
-			gebrm_task_emit_status_changed_signal(task, gebrm_task_translate_status(status),
-							      parameter->str);
+			GebrCommJobStatus new_status = gebrm_task_translate_status(status);
+			if (task && gebrm_task_get_status(task) != new_status)
+				gebrm_task_emit_status_changed_signal(task, new_status, parameter->str);
 
 			gebr_comm_protocol_socket_oldmsg_split_free(arguments);
 		}
@@ -444,14 +657,12 @@ gebrm_server_op_parse_messages(GebrCommServer *server,
 		if (gebrm_daemon_get_state(daemon) == SERVER_STATE_DISCONNECTED)
 			return;
 
-		gebr_comm_message_free(message);
-		server->socket->protocol->messages = g_list_delete_link(server->socket->protocol->messages, link);
+		gebr_comm_message_free(g_queue_pop_head(server->socket->protocol->messages));
 	}
 
 	return;
 
-err:	gebr_comm_message_free(message);
-	server->socket->protocol->messages = g_list_delete_link(server->socket->protocol->messages, link);
+err:	gebr_comm_message_free(g_queue_pop_head(server->socket->protocol->messages));
 
 	if (gebr_comm_server_is_local(server))
 		g_critical("Error communicating with the local server. Please reconnect.");
@@ -549,6 +760,7 @@ gebrm_daemon_set_property(GObject      *object,
 		g_signal_connect(daemon->priv->server, "question-request",
 				 G_CALLBACK(on_question_request), daemon);
 		gebr_comm_server_set_interactive(daemon->priv->server, TRUE);
+		gebr_comm_server_set_connect_timeout(daemon->priv->server, DAEMON_CONNECT_TIMEOUT);
 		daemon->priv->server->user_data = daemon;
 		break;
 	default:
@@ -569,6 +781,9 @@ gebrm_daemon_finalize(GObject *object)
 	g_free(daemon->priv->error_msg);
 	g_free(daemon->priv->error_type);
 	g_free(daemon->priv->mpi_flavors);
+	g_free(daemon->priv->load);
+	g_list_foreach(daemon->priv->reservations, (GFunc)g_free, NULL);
+	g_list_free(daemon->priv->reservations);
 	g_hash_table_destroy(daemon->priv->tasks);
 	if (daemon->priv->client)
 		g_object_unref(daemon->priv->client);
@@ -643,6 +858,15 @@ gebrm_daemon_class_init(GebrmDaemonClass *klass)
 			     g_cclosure_marshal_VOID__VOID,
 			     G_TYPE_NONE, 0);
 
+	signals[TASKS_LISTED] =
+		g_signal_new("tasks-listed",
+			     G_OBJECT_CLASS_TYPE (object_class),
+			     G_SIGNAL_RUN_FIRST,
+			     G_STRUCT_OFFSET(GebrmDaemonClass, tasks_listed),
+			     NULL, NULL,
+			     g_cclosure_marshal_VOID__VOID,
+			     G_TYPE_NONE, 0);
+
 	g_object_class_install_property(object_class,
 					PROP_ADDRESS,
 					g_param_spec_string("address",
@@ -696,10 +920,11 @@ gebrm_daemon_init(GebrmDaemon *daemon)
 	daemon->priv->tags = g_tree_new_full((GCompareDataFunc)g_strcmp0,
 					     NULL, g_free, NULL);
 	daemon->priv->ac = g_strdup("on");
+	daemon->priv->psi_mem = -1;
+	daemon->priv->psi_io = -1;
 	daemon->priv->is_initialized = FALSE;
 	daemon->priv->tasks = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
 	daemon->priv->mpi_flavors = NULL;
-	daemon->priv->timeout = -1;
 }
 
 GebrmDaemon *
@@ -884,8 +1109,21 @@ gebrm_daemon_get_clock(GebrmDaemon *daemon)
 void
 gebrm_daemon_list_tasks_and_forward_x(GebrmDaemon *daemon)
 {
+	GString *offsets = g_string_new(NULL);
+	GList *tasks = gebrm_task_list_for_daemon(daemon);
+
+	/* The daemon sends again the output produced after these offsets */
+	for (GList *i = tasks; i; i = i->next)
+		g_string_append_printf(offsets, "%" G_GUINT64_FORMAT " %d %s\n",
+				       gebrm_task_get_output_length(i->data),
+				       gebrm_task_get_fraction(i->data),
+				       gebrm_task_get_job_id(i->data));
+	g_list_free(tasks);
+
 	gebr_comm_protocol_socket_oldmsg_send(daemon->priv->server->socket, FALSE,
-					      gebr_comm_protocol_defs.lst_def, 0);
+					      gebr_comm_protocol_defs.lst_def, 1,
+					      offsets->str);
+	g_string_free(offsets, TRUE);
 }
 
 void
@@ -1116,16 +1354,3 @@ gebrm_daemon_get_canceled(GebrmDaemon *daemon)
 {
 	return daemon->priv->is_canceled;
 }
-
-void
-gebrm_daemon_set_timeout(GebrmDaemon *daemon,
-                         guint timeout)
-{
-	daemon->priv->timeout = timeout;
-}
-
-guint
-gebrm_daemon_get_timeout(GebrmDaemon *daemon)
-{
-	return daemon->priv->timeout;
-}
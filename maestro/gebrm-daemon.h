@@ -65,6 +65,8 @@ struct _GebrmDaemonClass {
 			     const gchar *error);
 
 	void (*append_key) (GebrmDaemon *daemon);
+
+	void (*tasks_listed) (GebrmDaemon *daemon);
 };
 
 GType gebrm_daemon_get_type(void) G_GNUC_CONST;
@@ -145,6 +147,14 @@ gint gebrm_daemon_get_ncores(GebrmDaemon *daemon);
 
 gdouble gebrm_daemon_get_clock(GebrmDaemon *daemon);
 
+/**
+ * gebrm_daemon_list_tasks_and_forward_x:
+ *
+ * Asks @daemon for all of its tasks. Each one is received as
+ * #GebrmDaemon::task-define, and #GebrmDaemon::tasks-listed is emitted after
+ * the last one. The output the tasks of @daemon produced since the maestro
+ * last received it is sent again.
+ */
 void gebrm_daemon_list_tasks_and_forward_x(GebrmDaemon *daemon);
 
 void gebrm_daeamon_answer_question(GebrmDaemon *daemon,
@@ -222,11 +232,6 @@ void gebrm_daemon_set_canceled(GebrmDaemon *daemon,
 
 gboolean gebrm_daemon_get_canceled(GebrmDaemon *daemon);
 
-void gebrm_daemon_set_timeout(GebrmDaemon *daemon,
-                              guint timeout);
-
-guint gebrm_daemon_get_timeout(GebrmDaemon *daemon);
-
 G_END_DECLS
 
 #endif /* __GEBRM_DAEMON_H__ */
@@ -41,6 +41,8 @@ struct _GebrmJobPriv {
 	gboolean has_issued;
 
 	GList *children; // A list of GebrCommRunner
+	GebrCommRunner *runner; // Dispatches the pending loop steps
+	guint64 sync_seq; // Last change sent to the clients
 };
 
 enum {
@@ -49,6 +51,7 @@ enum {
 	CMD_LINE_RECEIVED,
 	OUTPUT,
 	DISCONNECT,
+	SERVERS_CHANGED,
 	N_SIGNALS
 };
 
@@ -70,11 +73,24 @@ static void on_task_destroy(GebrmJob *job,
 G_DEFINE_TYPE(GebrmJob, gebrm_job, G_TYPE_OBJECT);
 
 /* Private methods {{{1 */
+static void
+gebrm_job_free_runner(GebrmJob *job)
+{
+	if (!job->priv->runner)
+		return;
+
+	gebr_validator_free(gebr_comm_runner_get_validator(job->priv->runner));
+	gebr_comm_runner_free(job->priv->runner);
+	job->priv->runner = NULL;
+}
+
 static void
 gebrm_job_finalize(GObject *object)
 {
 	GebrmJob *job = GEBRM_JOB(object);
 
+	gebrm_job_free_runner(job);
+
 	g_free(job->priv->info.id);
 	g_free(job->priv->info.title);
 	g_free(job->priv->info.description);
@@ -169,6 +185,15 @@ gebrm_job_class_init(GebrmJobClass *klass)
 			     g_cclosure_marshal_VOID__VOID,
 			     G_TYPE_NONE, 0);
 
+	signals[SERVERS_CHANGED] =
+		g_signal_new("servers-changed",
+			     G_OBJECT_CLASS_TYPE(gobject_class),
+			     G_SIGNAL_RUN_FIRST,
+			     G_STRUCT_OFFSET(GebrmJobClass, servers_changed),
+			     NULL, NULL,
+			     g_cclosure_marshal_VOID__VOID,
+			     G_TYPE_NONE, 0);
+
 	g_type_class_add_private(klass, sizeof(GebrmJobPriv));
 }
 
@@ -237,6 +262,17 @@ gebrm_job_change_task_status(GebrmTask *task,
 		return;
 	}
 
+	/* The daemon which finished a chunk of the loop takes the next one */
+	if (new_status == JOB_STATUS_FINISHED && job->priv->runner
+	    && gebr_comm_runner_task_finished(job->priv->runner,
+					      GEBR_COMM_DAEMON(gebrm_task_get_daemon(task)),
+					      frac)) {
+		job->priv->total = gebr_comm_runner_get_total(job->priv->runner);
+		gebrm_job_set_servers_list(job, gebr_comm_runner_get_servers_list(job->priv->runner));
+		g_signal_emit(job, signals[SERVERS_CHANGED], 0);
+		return;
+	}
+
 	/* Do not change the status if the job isn't complete.
 	 * But if the new status is Failed or Canceled, let this
 	 * change pass.
@@ -270,7 +306,15 @@ gebrm_job_change_task_status(GebrmTask *task,
 			if (gebrm_task_get_status(i->data) != JOB_STATUS_FINISHED)
 				break;
 		if (ntasks == total && i == NULL) { // If i == NULL, all tasks are finished
-			job->priv->status = JOB_STATUS_FINISHED;
+			if (job->priv->runner && gebr_comm_runner_has_pending_steps(job->priv->runner)) {
+				/* No daemon could take the remaining steps */
+				job->priv->has_issued = TRUE;
+				g_signal_emit(job, signals[ISSUED], 0,
+					      "The processing nodes were disconnected before running all loop steps.");
+				job->priv->status = JOB_STATUS_FAILED;
+			} else {
+				job->priv->status = JOB_STATUS_FINISHED;
+			}
 			g_signal_emit(job, signals[STATUS_CHANGE], 0,
 				      old, job->priv->status, parameter);
 		}
@@ -282,6 +326,9 @@ gebrm_job_change_task_status(GebrmTask *task,
 	default:
 		g_return_if_reached();
 	}
+
+	if (gebrm_job_is_stopped(job))
+		gebrm_job_free_runner(job);
 }
 
 static void
@@ -300,16 +347,26 @@ on_task_destroy(GebrmJob *job,
 }
 
 /* Public methods {{{1 */
+static gint next_id = 0;
+
 GebrmJob *
 gebrm_job_new(void)
 {
-	static gint id = 0;
-	gchar *rid = g_strdup_printf("%d", id++);
+	gchar *rid = g_strdup_printf("%d", next_id++);
 	GebrmJob *job = g_object_new(GEBRM_TYPE_JOB, NULL);
 	job->priv->info.id = rid;
 	return job;
 }
 
+GebrmJob *
+gebrm_job_new_from_id(const gchar *id)
+{
+	GebrmJob *job = g_object_new(GEBRM_TYPE_JOB, NULL);
+	job->priv->info.id = g_strdup(id);
+	next_id = MAX(next_id, atoi(id) + 1);
+	return job;
+}
+
 void
 gebrm_job_init_details(GebrmJob *job, GebrmJobInfo *info)
 {
@@ -396,7 +453,8 @@ gebrm_job_append_task(GebrmJob *job, GebrmTask *task)
 	g_object_weak_ref(G_OBJECT(task), (GWeakNotify)on_task_destroy, job);
 
 	g_signal_emit(job, signals[CMD_LINE_RECEIVED], 0, task, gebrm_task_get_cmd_line(task));
-	g_signal_emit(job, signals[OUTPUT], 0, task, gebrm_task_get_output(task));
+	/* Clients watching this job fetch the older output by range */
+	g_signal_emit(job, signals[OUTPUT], 0, task, gebrm_task_get_recent_output(task));
 
 	if (strlen(issues))
 		gebrm_job_change_task_status(task, job->priv->status,
@@ -423,6 +481,19 @@ gebrm_job_append_task(GebrmJob *job, GebrmTask *task)
 	}
 }
 
+void
+gebrm_job_restore_task(GebrmJob *job, GebrmTask *task)
+{
+	job->priv->tasks = g_list_prepend(job->priv->tasks, task);
+
+	if (*gebrm_task_get_issues(task))
+		job->priv->has_issued = TRUE;
+
+	g_signal_connect(task, "status-change", G_CALLBACK(gebrm_job_change_task_status), job);
+	g_signal_connect(task, "output", G_CALLBACK(gebrm_job_append_task_output), job);
+	g_object_weak_ref(G_OBJECT(task), (GWeakNotify)on_task_destroy, job);
+}
+
 GebrCommJobStatus
 gebrm_job_get_status(GebrmJob *job)
 {
@@ -435,17 +506,6 @@ gebrm_job_get_id(GebrmJob *job)
 	return job->priv->info.id;
 }
 
-gchar *
-gebrm_job_get_output(GebrmJob *job)
-{
-	GString *output = g_string_new(NULL);
-
-	for (GList *i = job->priv->tasks; i; i = i->next)
-		g_string_append(output, gebrm_task_get_output(i->data));
-
-	return g_string_free(output, FALSE);
-}
-
 const gchar *
 gebrm_job_get_submit_date(GebrmJob *job)
 {
@@ -539,6 +599,7 @@ gebrm_job_kill_immediately(GebrmJob *job)
 	gebrm_job_kill(job);
 
 	job->priv->status = JOB_STATUS_CANCELED;
+	gebrm_job_free_runner(job);
 	gchar *finish_date = gebr_iso_date();
 	g_signal_emit(job, signals[STATUS_CHANGE], 0,
 	              old, job->priv->status, finish_date);
@@ -663,6 +724,28 @@ gebrm_job_get_task_from_server(GebrmJob *job,
 	return NULL;
 }
 
+GebrmTask *
+gebrm_job_get_task_from_fraction(GebrmJob *job,
+				 gint frac)
+{
+	for (GList *i = job->priv->tasks; i; i = i->next)
+		if (gebrm_task_get_fraction(i->data) == frac)
+			return i->data;
+	return NULL;
+}
+
+void
+gebrm_job_set_sync_seq(GebrmJob *job, guint64 seq)
+{
+	job->priv->sync_seq = seq;
+}
+
+guint64
+gebrm_job_get_sync_seq(GebrmJob *job)
+{
+	return job->priv->sync_seq;
+}
+
 GList *
 gebrm_job_get_list_of_tasks(GebrmJob *job)
 {
@@ -686,6 +769,11 @@ gebrm_job_get_partial_status(GebrmJob *job)
 	if (ntasks == total)
 		return gebrm_job_get_status(job);
 
+	/* Finished chunks of the loop do not end the job while the next
+	 * chunks are being dispatched */
+	if (job->priv->runner && job->priv->status == JOB_STATUS_RUNNING)
+		return JOB_STATUS_RUNNING;
+
 	gint running = 0;
 	for (GList *i = job->priv->tasks; i; i = i->next) {
 		GebrCommJobStatus sta = gebrm_task_get_status(i->data);
@@ -760,6 +848,20 @@ gebrm_job_set_total_tasks(GebrmJob *job, gint total)
 	job->priv->total = total;
 }
 
+gint
+gebrm_job_get_total_tasks(GebrmJob *job)
+{
+	return job->priv->total;
+}
+
+void
+gebrm_job_set_runner(GebrmJob *job,
+		     GebrCommRunner *runner)
+{
+	gebrm_job_free_runner(job);
+	job->priv->runner = runner;
+}
+
 void
 gebrm_job_set_run_type(GebrmJob *job,
                        const gchar *type)
@@ -61,6 +61,8 @@ struct _GebrmJobClass {
 			const gchar *output);
 
 	void (*disconnect) (GebrmJob *job);
+
+	void (*servers_changed) (GebrmJob *job);
 };
 
 typedef struct {
@@ -97,6 +99,15 @@ GType gebrm_job_get_type() G_GNUC_CONST;
  */
 GebrmJob *gebrm_job_new(void);
 
+/**
+ * gebrm_job_new_from_id:
+ *
+ * Creates a job with the @id it had in a previous maestro process. The ids
+ * given by gebrm_job_new() afterwards are larger than @id, so they do not
+ * clash with the tasks the daemons still have.
+ */
+GebrmJob *gebrm_job_new_from_id(const gchar *id);
+
 void gebrm_job_init_details(GebrmJob *job,
 			    GebrmJobInfo *info);
 
@@ -117,6 +128,14 @@ gboolean gebrm_job_can_kill(GebrmJob *job);
 
 void gebrm_job_append_task(GebrmJob *job, GebrmTask *task);
 
+/**
+ * gebrm_job_restore_task:
+ *
+ * Appends @task, restored from the jobs journal, without emitting any signal
+ * or changing the status of @job.
+ */
+void gebrm_job_restore_task(GebrmJob *job, GebrmTask *task);
+
 GebrmJob *gebrm_job_find(const gchar *rid);
 
 const gchar *gebrm_job_get_title(GebrmJob *job);
@@ -139,8 +158,6 @@ GebrCommJobStatus gebrm_job_get_status(GebrmJob *job);
 
 const gchar *gebrm_job_get_id(GebrmJob *job);
 
-gchar *gebrm_job_get_output(GebrmJob *job);
-
 const gchar *gebrm_job_get_submit_date(GebrmJob *job);
 
 const gchar *gebrm_job_get_last_run_date(GebrmJob *job);
@@ -192,6 +209,20 @@ GList *gebrm_job_get_list_of_tasks(GebrmJob *job);
 GebrmTask *gebrm_job_get_task_from_server(GebrmJob *job,
 					  const gchar *server);
 
+GebrmTask *gebrm_job_get_task_from_fraction(GebrmJob *job,
+					    gint frac);
+
+/**
+ * gebrm_job_set_sync_seq:
+ *
+ * Stores the sequence number of the last change of this job visible to the
+ * clients. Clients reconnecting with an older sequence number get the job
+ * definition again.
+ */
+void gebrm_job_set_sync_seq(GebrmJob *job, guint64 seq);
+
+guint64 gebrm_job_get_sync_seq(GebrmJob *job);
+
 /**
  * gebrm_job_get_partial_status:
  *
@@ -231,6 +262,19 @@ const gchar *gebrm_job_get_servers_list(GebrmJob *job);
 
 void gebrm_job_set_total_tasks(GebrmJob *job, gint total);
 
+gint gebrm_job_get_total_tasks(GebrmJob *job);
+
+/**
+ * gebrm_job_set_runner:
+ *
+ * Gives @job the @runner which still has loop steps to dispatch, together
+ * with its validator. Each time a task of @job finishes, the next chunk of
+ * the loop is sent to the same daemon and #GebrmJob::servers-changed is
+ * emitted. @job frees @runner when it stops.
+ */
+void gebrm_job_set_runner(GebrmJob *job,
+			  GebrCommRunner *runner);
+
 void gebrm_job_set_run_type(GebrmJob *job,
                             const gchar *type);
 
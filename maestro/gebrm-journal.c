@@ -0,0 +1,292 @@
+/*
+ * gebrm-journal.c
+ * This file is part of GêBR Project
+ *
+ * Copyright (C) 2012 - GêBR Core Team (www.gebrproject.com)
+ *
+ * GêBR Project is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * GêBR Project is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GêBR Project. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gebrm-journal.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <glib/gstdio.h>
+
+/*
+ * Each record is a little-endian 32 bits length of the payload, the FNV-1a
+ * hash of the payload and the payload itself: the type character followed by
+ * the NUL-terminated fields.
+ *
+ * If the process dies after a new snapshot is renamed into place but before
+ * the journal is emptied, the records of the journal are replayed again over
+ * the snapshot. Callers must write records which describe a whole state, so
+ * replaying one twice has no effect.
+ */
+#define HEADER_SIZE		8
+/* the journal is not compacted while it is smaller than this */
+#define MIN_SNAPSHOT_SIZE	(1 << 20)
+
+struct _GebrmJournal {
+	gchar *path;
+	gchar *snapshot_path;
+
+	gint journal_fd;
+	gsize journal_size;
+	gsize snapshot_size;
+
+	/* where gebrm_journal_append() writes, the journal or a new snapshot */
+	gint fd;
+	gint write_errno;
+};
+
+static guint32
+checksum(const gchar *data, gsize len)
+{
+	guint32 hash = 2166136261U;
+
+	for (gsize i = 0; i < len; i++) {
+		hash ^= (guchar) data[i];
+		hash *= 16777619U;
+	}
+
+	return hash;
+}
+
+/*
+ * Calls @func for each record in @contents, stopping at the first one which
+ * is incomplete or corrupted.
+ *
+ * Returns: The length of the valid records.
+ */
+static gsize
+replay(const gchar *contents,
+       gsize len,
+       GebrmJournalFunc func,
+       gpointer user_data)
+{
+	GPtrArray *fields = g_ptr_array_new();
+	gsize pos = 0;
+
+	while (len - pos >= HEADER_SIZE) {
+		guint32 size, sum;
+
+		memcpy(&size, contents + pos, 4);
+		memcpy(&sum, contents + pos + 4, 4);
+		size = GUINT32_FROM_LE(size);
+		sum = GUINT32_FROM_LE(sum);
+
+		const gchar *payload = contents + pos + HEADER_SIZE;
+		if (size == 0 || size > len - pos - HEADER_SIZE
+		    || checksum(payload, size) != sum
+		    || (size > 1 && payload[size - 1] != '\0'))
+			break;
+
+		g_ptr_array_set_size(fields, 0);
+		for (const gchar *p = payload + 1; p < payload + size; p += strlen(p) + 1)
+			g_ptr_array_add(fields, (gpointer) p);
+
+		func(payload[0], (const gchar **) fields->pdata, fields->len, user_data);
+		pos += HEADER_SIZE + size;
+	}
+
+	g_ptr_array_free(fields, TRUE);
+	return pos;
+}
+
+static gsize
+replay_file(const gchar *path,
+	    GebrmJournalFunc func,
+	    gpointer user_data)
+{
+	GError *error = NULL;
+	gchar *contents;
+	gsize len;
+
+	if (!g_file_get_contents(path, &contents, &len, &error)) {
+		if (!g_error_matches(error, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+			g_warning("%s", error->message);
+		g_error_free(error);
+		return 0;
+	}
+
+	gsize valid = replay(contents, len, func, user_data);
+	if (valid < len)
+		g_warning("Discarding %"G_GSIZE_FORMAT" bytes at the end of %s",
+			  len - valid, path);
+
+	g_free(contents);
+	return valid;
+}
+
+GebrmJournal *
+gebrm_journal_open(const gchar *path,
+		   GebrmJournalFunc func,
+		   gpointer user_data,
+		   GError **error)
+{
+	GebrmJournal *journal = g_new0(GebrmJournal, 1);
+
+	journal->path = g_strdup(path);
+	journal->snapshot_path = g_strconcat(path, ".snapshot", NULL);
+	journal->snapshot_size = replay_file(journal->snapshot_path, func, user_data);
+	journal->journal_size = replay_file(path, func, user_data);
+
+	journal->journal_fd = g_open(path, O_WRONLY | O_CREAT | O_APPEND, 0600);
+	if (journal->journal_fd == -1) {
+		g_set_error(error, G_FILE_ERROR, g_file_error_from_errno(errno),
+			    "Cannot open %s: %s", path, g_strerror(errno));
+		gebrm_journal_free(journal);
+		return NULL;
+	}
+
+	/* Records appended after a broken one would not be replayed */
+	if (ftruncate(journal->journal_fd, journal->journal_size) == -1)
+		g_warning("Cannot truncate %s: %s", path, g_strerror(errno));
+
+	journal->fd = journal->journal_fd;
+	return journal;
+}
+
+void
+gebrm_journal_free(GebrmJournal *journal)
+{
+	if (journal->journal_fd != -1)
+		close(journal->journal_fd);
+	g_free(journal->path);
+	g_free(journal->snapshot_path);
+	g_free(journal);
+}
+
+static gboolean
+write_all(gint fd, const gchar *data, gsize len)
+{
+	while (len) {
+		ssize_t ret = write(fd, data, len);
+		if (ret == -1) {
+			if (errno == EINTR)
+				continue;
+			return FALSE;
+		}
+		data += ret;
+		len -= ret;
+	}
+	return TRUE;
+}
+
+void
+gebrm_journal_append(GebrmJournal *journal,
+		     gchar type,
+		     const gchar **fields,
+		     guint n_fields)
+{
+	GString *record = g_string_sized_new(256);
+	guint32 size, sum;
+
+	g_string_set_size(record, HEADER_SIZE);
+	g_string_append_c(record, type);
+	for (guint i = 0; i < n_fields; i++) {
+		if (fields[i])
+			g_string_append(record, fields[i]);
+		g_string_append_c(record, '\0');
+	}
+
+	size = GUINT32_TO_LE(record->len - HEADER_SIZE);
+	sum = GUINT32_TO_LE(checksum(record->str + HEADER_SIZE, record->len - HEADER_SIZE));
+	memcpy(record->str, &size, 4);
+	memcpy(record->str + 4, &sum, 4);
+
+	if (journal->fd != journal->journal_fd) {
+		/* Writing a snapshot, errors are reported at its end */
+		if (!journal->write_errno) {
+			if (write_all(journal->fd, record->str, record->len))
+				journal->snapshot_size += record->len;
+			else
+				journal->write_errno = errno;
+		}
+	} else if (write_all(journal->fd, record->str, record->len)) {
+		journal->journal_size += record->len;
+	} else {
+		if (!journal->write_errno)
+			g_warning("Cannot write to %s: %s", journal->path, g_strerror(errno));
+		journal->write_errno = errno;
+
+		/* Drop the partial record, so the next ones can be replayed */
+		if (ftruncate(journal->journal_fd, journal->journal_size) == -1)
+			g_warning("Cannot truncate %s: %s", journal->path, g_strerror(errno));
+	}
+
+	g_string_free(record, TRUE);
+}
+
+gboolean
+gebrm_journal_needs_snapshot(GebrmJournal *journal)
+{
+	return journal->journal_size > MAX(MIN_SNAPSHOT_SIZE, journal->snapshot_size);
+}
+
+gboolean
+gebrm_journal_write_snapshot(GebrmJournal *journal,
+			     GebrmJournalDumpFunc func,
+			     gpointer user_data,
+			     GError **error)
+{
+	gchar *tmp = g_strconcat(journal->snapshot_path, ".tmp", NULL);
+	gsize old_size = journal->snapshot_size;
+	gint fd;
+
+	fd = g_open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+	if (fd == -1) {
+		g_set_error(error, G_FILE_ERROR, g_file_error_from_errno(errno),
+			    "Cannot create %s: %s", tmp, g_strerror(errno));
+		g_free(tmp);
+		return FALSE;
+	}
+
+	journal->fd = fd;
+	journal->snapshot_size = 0;
+	journal->write_errno = 0;
+	func(journal, user_data);
+	journal->fd = journal->journal_fd;
+
+	gint saved = journal->write_errno;
+	if (!saved && fsync(fd) == -1)
+		saved = errno;
+	if (close(fd) == -1 && !saved)
+		saved = errno;
+	if (!saved && g_rename(tmp, journal->snapshot_path) == -1)
+		saved = errno;
+
+	journal->write_errno = 0;
+
+	if (saved) {
+		g_set_error(error, G_FILE_ERROR, g_file_error_from_errno(saved),
+			    "Cannot write %s: %s", tmp, g_strerror(saved));
+		g_unlink(tmp);
+		g_free(tmp);
+		journal->snapshot_size = old_size;
+		return FALSE;
+	}
+
+	/* Everything in the journal is in the snapshot now */
+	if (ftruncate(journal->journal_fd, 0) == -1)
+		g_warning("Cannot truncate %s: %s", journal->path, g_strerror(errno));
+	else
+		journal->journal_size = 0;
+
+	g_free(tmp);
+	return TRUE;
+}
@@ -0,0 +1,106 @@
+/*
+ * gebrm-journal.h
+ * This file is part of GêBR Project
+ *
+ * Copyright (C) 2012 - GêBR Core Team (www.gebrproject.com)
+ *
+ * GêBR Project is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * GêBR Project is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GêBR Project. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GEBRM_JOURNAL_H__
+#define __GEBRM_JOURNAL_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/**
+ * GebrmJournal:
+ *
+ * An append-only file of records, each one a type character and a list of
+ * strings. A snapshot file holds the records needed to rebuild the state at
+ * some point, and the journal holds the records appended since then.
+ */
+typedef struct _GebrmJournal GebrmJournal;
+
+/**
+ * GebrmJournalFunc:
+ * @type: the type given to gebrm_journal_append()
+ * @fields: the strings of the record, valid only during the call
+ */
+typedef void (*GebrmJournalFunc) (gchar type,
+				  const gchar **fields,
+				  guint n_fields,
+				  gpointer user_data);
+
+/**
+ * GebrmJournalDumpFunc:
+ *
+ * Appends to @journal the records which rebuild the current state, see
+ * gebrm_journal_write_snapshot().
+ */
+typedef void (*GebrmJournalDumpFunc) (GebrmJournal *journal,
+				      gpointer user_data);
+
+/**
+ * gebrm_journal_open:
+ * @path: the journal file, the snapshot is kept in @path.snapshot
+ * @func: called for each record of the snapshot and then of the journal
+ *
+ * Replays the records written by a previous process and opens @path for
+ * appending. A record cut by a crash ends the journal, it is discarded.
+ *
+ * Returns: The journal, or %NULL if @path can not be opened.
+ */
+GebrmJournal *gebrm_journal_open(const gchar *path,
+				 GebrmJournalFunc func,
+				 gpointer user_data,
+				 GError **error);
+
+void gebrm_journal_free(GebrmJournal *journal);
+
+/**
+ * gebrm_journal_append:
+ * @fields: the strings of the record, %NULL ones are written as empty
+ *
+ * Appends a record with a single write, so a crash loses at most the record
+ * being written.
+ */
+void gebrm_journal_append(GebrmJournal *journal,
+			  gchar type,
+			  const gchar **fields,
+			  guint n_fields);
+
+/**
+ * gebrm_journal_needs_snapshot:
+ *
+ * Returns: %TRUE if the journal grew larger than the last snapshot, so
+ * replaying it costs more than writing a new one.
+ */
+gboolean gebrm_journal_needs_snapshot(GebrmJournal *journal);
+
+/**
+ * gebrm_journal_write_snapshot:
+ *
+ * Writes a new snapshot with the records appended by @func and empties the
+ * journal. The old snapshot is only replaced once the new one is on disk.
+ */
+gboolean gebrm_journal_write_snapshot(GebrmJournal *journal,
+				      GebrmJournalDumpFunc func,
+				      gpointer user_data,
+				      GError **error);
+
+G_END_DECLS
+
+#endif /* __GEBRM_JOURNAL_H__ */
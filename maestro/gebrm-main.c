@@ -27,10 +27,12 @@
 #include <glib.h>
 #include <glib/gstdio.h>
 #include <libgebr/comm/gebr-comm.h>
+#include <libgebr/comm/gebr-comm-transport-pool.h>
 #include <libgebr/log.h>
 #include <fcntl.h>
 
 #include "gebrm-app.h"
+#include "gebrm-output.h"
 
 #include <libgebr/gebr-version.h>
 #include <libgebr/gebr-maestro-settings.h>
@@ -40,12 +42,15 @@
 static gboolean interactive;
 static gboolean show_version;
 static int output_fd = STDOUT_FILENO;
+static gint output_memory = 256;
 
 static GOptionEntry entries[] = {
 	{"interactive", 'i', 0, G_OPTION_ARG_NONE, &interactive,
 		"Run server in interactive mode, not as a daemon", NULL},
 	{"version", 'v', 0, G_OPTION_ARG_NONE, &show_version,
 		"Show GeBR daemon version", NULL},
+	{"output-memory", 0, 0, G_OPTION_ARG_INT, &output_memory,
+		"Kilobytes of output of each task kept in memory, the rest is kept on disk (default 256)", "KB"},
 	{NULL}
 };
 
@@ -113,6 +118,7 @@ gebrm_remove_lock_and_quit(int sig)
 {
 	g_unlink(gebrm_app_get_lock_file());
 	g_unlink(gebrm_app_get_version_file());
+	gebr_comm_transport_pool_free_default();
 	exit(0);
 }
 
@@ -305,6 +311,9 @@ main(int argc, char *argv[])
 	const gchar *path = gebrm_app_get_log_file_for_address(local_addr);
 	gebr_log_set_default(path);
 
+	const gchar *output_dir = gebrm_app_get_output_dir_for_address(local_addr);
+	gebrm_output_set_defaults(output_dir, MAX(output_memory, 1) << 10);
+
 	GebrmApp *app = gebrm_app_singleton_get();
 
 	if (!gebrm_app_run(app, output_fd, curr_version))
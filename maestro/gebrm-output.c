@@ -0,0 +1,421 @@
+/*
+ * gebrm-output.c
+ * This file is part of GêBR Project
+ *
+ * Copyright (C) 2012 - GêBR Core Team (www.gebrproject.com)
+ *
+ * GêBR Project is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * GêBR Project is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GêBR Project. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gebrm-output.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <glib/gstdio.h>
+
+/* largest segment file, a new one is started after it */
+#define SEGMENT_SIZE	(32 << 20)
+/* block read backwards by gebrm_output_tail_offset() */
+#define TAIL_BLOCK	(64 << 10)
+
+typedef struct {
+	guint64 start;
+	guint64 len;
+	gchar *path;
+} Segment;
+
+struct _GebrmOutput {
+	gchar *name;
+	gsize tail_size;
+
+	/* the last bytes of output, starting at offset tail_start */
+	GString *tail;
+	guint64 tail_start;
+
+	/* older bytes, in offset order; the last one is open in fd */
+	GArray *segments;
+	gint fd;
+	gboolean spill_failed;
+};
+
+static gchar *default_dir = NULL;
+static gsize default_tail_size = 256 << 10;
+
+/* names of the outputs alive, whose segment files are kept */
+static GHashTable *live_names = NULL;
+
+static const gchar *
+get_dir(void)
+{
+	return default_dir ? default_dir : g_get_tmp_dir();
+}
+
+static gchar *
+segment_path(GebrmOutput *output, guint index)
+{
+	gchar *basename = g_strdup_printf("%s-%04u.out", output->name, index);
+	gchar *path = g_build_filename(get_dir(), basename, NULL);
+
+	g_free(basename);
+	return path;
+}
+
+void
+gebrm_output_set_defaults(const gchar *dir,
+			  gsize tail_size)
+{
+	g_free(default_dir);
+	default_dir = g_strdup(dir);
+	default_tail_size = MAX(tail_size, 1);
+}
+
+GebrmOutput *
+gebrm_output_new(const gchar *name)
+{
+	GebrmOutput *output = g_new(GebrmOutput, 1);
+
+	output->name = g_strdup(name);
+	g_strdelimit(output->name, "/:", '_');
+	output->tail_size = default_tail_size;
+	output->tail = g_string_new(NULL);
+	output->tail_start = 0;
+	output->segments = g_array_new(FALSE, FALSE, sizeof(Segment));
+	output->fd = -1;
+	output->spill_failed = FALSE;
+
+	if (!live_names)
+		live_names = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	g_hash_table_insert(live_names, g_strdup(output->name), NULL);
+
+	return output;
+}
+
+void
+gebrm_output_free(GebrmOutput *output)
+{
+	if (output->fd != -1)
+		close(output->fd);
+
+	for (guint i = 0; i < output->segments->len; i++) {
+		Segment *seg = &g_array_index(output->segments, Segment, i);
+		g_unlink(seg->path);
+		g_free(seg->path);
+	}
+	g_array_free(output->segments, TRUE);
+	g_string_free(output->tail, TRUE);
+	g_hash_table_remove(live_names, output->name);
+	g_free(output->name);
+	g_free(output);
+}
+
+guint64
+gebrm_output_restore(GebrmOutput *output,
+		     guint64 length)
+{
+	g_return_val_if_fail(gebrm_output_get_length(output) == 0, 0);
+
+	for (guint i = 0; output->tail_start < length; i++) {
+		gchar *path = segment_path(output, i);
+		struct stat st;
+
+		if (g_stat(path, &st) == -1 || st.st_size == 0) {
+			g_free(path);
+			break;
+		}
+
+		Segment seg;
+		seg.start = output->tail_start;
+		seg.len = MIN((guint64) st.st_size, length - seg.start);
+		seg.path = path;
+
+		/* Bytes past @length were not recorded as written */
+		if (seg.len < (guint64) st.st_size && truncate(path, seg.len) == -1)
+			g_warning("Cannot truncate output segment %s: %s", path, g_strerror(errno));
+
+		g_array_append_val(output->segments, seg);
+		output->tail_start += seg.len;
+	}
+
+	/* Spilling goes on in the last segment */
+	if (output->segments->len) {
+		Segment *seg = &g_array_index(output->segments, Segment, output->segments->len - 1);
+		output->fd = g_open(seg->path, O_WRONLY | O_APPEND, 0);
+	}
+
+	return output->tail_start;
+}
+
+void
+gebrm_output_remove_unused(void)
+{
+	const gchar *dirname = get_dir();
+	GDir *dir = g_dir_open(dirname, 0, NULL);
+	const gchar *name;
+
+	if (!dir)
+		return;
+
+	while ((name = g_dir_read_name(dir))) {
+		const gchar *dash = strrchr(name, '-');
+
+		if (!dash || !g_str_has_suffix(name, ".out"))
+			continue;
+
+		gchar *output_name = g_strndup(name, dash - name);
+		if (!live_names || !g_hash_table_lookup_extended(live_names, output_name, NULL, NULL)) {
+			gchar *path = g_build_filename(dirname, name, NULL);
+			g_unlink(path);
+			g_free(path);
+		}
+		g_free(output_name);
+	}
+	g_dir_close(dir);
+}
+
+static Segment *
+open_segment(GebrmOutput *output)
+{
+	Segment seg;
+
+	seg.start = output->tail_start;
+	seg.len = 0;
+	seg.path = segment_path(output, output->segments->len);
+
+	if (output->fd != -1)
+		close(output->fd);
+
+	output->fd = g_open(seg.path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0600);
+	if (output->fd == -1) {
+		g_warning("Cannot create output segment %s: %s", seg.path, g_strerror(errno));
+		g_free(seg.path);
+		return NULL;
+	}
+
+	g_array_append_val(output->segments, seg);
+	return &g_array_index(output->segments, Segment, output->segments->len - 1);
+}
+
+/*
+ * Moves the first @n bytes of the tail to the segment files. If they can't
+ * be written, the output is kept in memory from then on.
+ */
+static void
+spill(GebrmOutput *output, gsize n)
+{
+	gsize written = 0;
+
+	while (written < n) {
+		Segment *seg = NULL;
+
+		if (output->segments->len)
+			seg = &g_array_index(output->segments, Segment, output->segments->len - 1);
+		if (!seg || output->fd == -1 || seg->len >= SEGMENT_SIZE)
+			seg = open_segment(output);
+		if (!seg)
+			break;
+
+		gsize chunk = MIN(n - written, SEGMENT_SIZE - seg->len);
+		ssize_t ret = write(output->fd, output->tail->str + written, chunk);
+		if (ret == -1) {
+			if (errno == EINTR)
+				continue;
+			g_warning("Cannot write output segment %s: %s", seg->path, g_strerror(errno));
+			break;
+		}
+
+		seg->len += ret;
+		written += ret;
+		output->tail_start += ret;
+	}
+
+	if (written < n)
+		output->spill_failed = TRUE;
+
+	g_string_erase(output->tail, 0, written);
+}
+
+gboolean
+gebrm_output_append(GebrmOutput *output,
+		    const gchar *data,
+		    gsize len)
+{
+	guint64 stored = output->tail_start;
+
+	g_string_append_len(output->tail, data, len);
+
+	/* Spill half of the tail at a time, so the memmove of the remaining
+	 * half is amortized over many appends */
+	if (output->tail->len > output->tail_size && !output->spill_failed)
+		spill(output, output->tail->len - output->tail_size / 2);
+
+	return output->tail_start != stored;
+}
+
+guint64
+gebrm_output_get_length(GebrmOutput *output)
+{
+	return output->tail_start + output->tail->len;
+}
+
+guint64
+gebrm_output_get_stored_length(GebrmOutput *output)
+{
+	return output->tail_start;
+}
+
+const gchar *
+gebrm_output_peek(GebrmOutput *output)
+{
+	return output->tail->str;
+}
+
+static gboolean
+read_segment(Segment *seg,
+	     guint64 offset,
+	     gsize len,
+	     GString *buffer,
+	     GError **error)
+{
+	gint fd = g_open(seg->path, O_RDONLY, 0);
+	if (fd == -1)
+		goto err;
+
+	gsize old_len = buffer->len;
+	g_string_set_size(buffer, old_len + len);
+
+	gsize done = 0;
+	while (done < len) {
+		ssize_t ret = pread(fd, buffer->str + old_len + done, len - done,
+				    offset - seg->start + done);
+		if (ret == -1 && errno == EINTR)
+			continue;
+		if (ret <= 0) {
+			gint saved = ret ? errno : EIO;
+			g_string_set_size(buffer, old_len);
+			close(fd);
+			errno = saved;
+			goto err;
+		}
+		done += ret;
+	}
+
+	close(fd);
+	return TRUE;
+
+err:
+	g_set_error(error, G_FILE_ERROR, g_file_error_from_errno(errno),
+		    "Cannot read output segment %s: %s", seg->path, g_strerror(errno));
+	return FALSE;
+}
+
+gboolean
+gebrm_output_read(GebrmOutput *output,
+		  guint64 offset,
+		  gsize len,
+		  GString *buffer,
+		  GError **error)
+{
+	guint64 total = gebrm_output_get_length(output);
+	guint64 end;
+
+	if (offset >= total)
+		return TRUE;
+	end = MIN(offset + len, total);
+
+	for (guint i = 0; i < output->segments->len && offset < MIN(end, output->tail_start); i++) {
+		Segment *seg = &g_array_index(output->segments, Segment, i);
+		guint64 seg_end = seg->start + seg->len;
+
+		if (offset >= seg_end)
+			continue;
+
+		gsize n = MIN(end, seg_end) - offset;
+		if (!read_segment(seg, offset, n, buffer, error))
+			return FALSE;
+		offset += n;
+	}
+
+	if (offset < end)
+		g_string_append_len(buffer, output->tail->str + (offset - output->tail_start),
+				    end - offset);
+
+	return TRUE;
+}
+
+gboolean
+gebrm_output_tail_offset(GebrmOutput *output,
+			 guint lines,
+			 guint64 *offset,
+			 GError **error)
+{
+	guint64 total = gebrm_output_get_length(output);
+	guint64 pos = total;
+	GString *block = g_string_sized_new(TAIL_BLOCK);
+
+	*offset = lines ? 0 : total;
+
+	/* A trailing line break does not start a new line */
+	gboolean skip_last = TRUE;
+
+	while (pos > 0 && lines) {
+		guint64 block_start = pos > TAIL_BLOCK ? pos - TAIL_BLOCK : 0;
+
+		g_string_truncate(block, 0);
+		if (!gebrm_output_read(output, block_start, pos - block_start, block, error)) {
+			g_string_free(block, TRUE);
+			return FALSE;
+		}
+
+		for (gsize i = block->len; i > 0; i--) {
+			if (block->str[i - 1] != '\n')
+				continue;
+			if (skip_last && block_start + i == total) {
+				skip_last = FALSE;
+				continue;
+			}
+			if (--lines == 0) {
+				*offset = block_start + i;
+				break;
+			}
+		}
+		skip_last = FALSE;
+		pos = block_start;
+	}
+
+	g_string_free(block, TRUE);
+	return TRUE;
+}
+
+gchar *
+gebrm_output_tail(GebrmOutput *output,
+		  guint lines,
+		  GError **error)
+{
+	guint64 start;
+	GString *buffer;
+
+	if (!gebrm_output_tail_offset(output, lines, &start, error))
+		return NULL;
+
+	buffer = g_string_new(NULL);
+	if (!gebrm_output_read(output, start, gebrm_output_get_length(output) - start, buffer, error)) {
+		g_string_free(buffer, TRUE);
+		return NULL;
+	}
+
+	return g_string_free(buffer, FALSE);
+}
@@ -0,0 +1,153 @@
+/*
+ * gebrm-output.h
+ * This file is part of GêBR Project
+ *
+ * Copyright (C) 2012 - GêBR Core Team (www.gebrproject.com)
+ *
+ * GêBR Project is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * GêBR Project is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GêBR Project. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GEBRM_OUTPUT_H__
+#define __GEBRM_OUTPUT_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/**
+ * GebrmOutput:
+ *
+ * The output of a task. Only its last bytes are kept in memory, older data is
+ * appended to segment files and read back by range when needed.
+ */
+typedef struct _GebrmOutput GebrmOutput;
+
+/**
+ * gebrm_output_set_defaults:
+ * @dir: directory of the segment files
+ * @tail_size: bytes of output kept in memory by each #GebrmOutput
+ *
+ * Sets the parameters of the outputs created afterwards.
+ */
+void gebrm_output_set_defaults(const gchar *dir,
+			       gsize tail_size);
+
+/**
+ * gebrm_output_new:
+ * @name: prefix of the segment files, unique among the outputs
+ */
+GebrmOutput *gebrm_output_new(const gchar *name);
+
+/**
+ * gebrm_output_free:
+ *
+ * Frees @output and removes its segment files.
+ */
+void gebrm_output_free(GebrmOutput *output);
+
+/**
+ * gebrm_output_restore:
+ * @length: the bytes of output known to be in the segment files
+ *
+ * Reattaches the segment files left by a previous process for the empty
+ * @output, up to @length bytes, and appends after them.
+ *
+ * Returns: The length of the output restored, less than @length if segment
+ * files are missing.
+ */
+guint64 gebrm_output_restore(GebrmOutput *output,
+			     guint64 length);
+
+/**
+ * gebrm_output_remove_unused:
+ *
+ * Removes the segment files of the outputs which do not exist, left by a
+ * previous process.
+ */
+void gebrm_output_remove_unused(void);
+
+/**
+ * gebrm_output_append:
+ *
+ * Returns: %TRUE if older output was moved to the segment files, changing
+ * gebrm_output_get_stored_length().
+ */
+gboolean gebrm_output_append(GebrmOutput *output,
+			     const gchar *data,
+			     gsize len);
+
+/**
+ * gebrm_output_get_length:
+ *
+ * Returns: The number of bytes appended to @output.
+ */
+guint64 gebrm_output_get_length(GebrmOutput *output);
+
+/**
+ * gebrm_output_get_stored_length:
+ *
+ * Returns: The number of bytes of @output in the segment files.
+ */
+guint64 gebrm_output_get_stored_length(GebrmOutput *output);
+
+/**
+ * gebrm_output_peek:
+ *
+ * Returns: The output kept in memory, which is a suffix of the whole output.
+ */
+const gchar *gebrm_output_peek(GebrmOutput *output);
+
+/**
+ * gebrm_output_read:
+ * @buffer: where the bytes read are appended
+ *
+ * Reads up to @len bytes starting at @offset. Less bytes are read if the
+ * output ends before.
+ *
+ * Returns: %FALSE if a segment could not be read, setting @error.
+ */
+gboolean gebrm_output_read(GebrmOutput *output,
+			   guint64 offset,
+			   gsize len,
+			   GString *buffer,
+			   GError **error);
+
+/**
+ * gebrm_output_tail_offset:
+ * @offset: returns where the last @lines lines of @output start
+ *
+ * Looks for the start of the last @lines lines, reading @output backwards
+ * from its end, so only those lines are read from the segment files. A
+ * line break at the very end does not start another line.
+ *
+ * Returns: %FALSE if a segment could not be read, setting @error.
+ */
+gboolean gebrm_output_tail_offset(GebrmOutput *output,
+				  guint lines,
+				  guint64 *offset,
+				  GError **error);
+
+/**
+ * gebrm_output_tail:
+ *
+ * Returns: A newly allocated string with the last @lines lines of @output,
+ * or %NULL if a segment could not be read.
+ */
+gchar *gebrm_output_tail(GebrmOutput *output,
+			 guint lines,
+			 GError **error);
+
+G_END_DECLS
+
+#endif /* __GEBRM_OUTPUT_H__ */
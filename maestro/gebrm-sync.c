@@ -0,0 +1,132 @@
+/*
+ * gebrm-sync.c
+ * This file is part of GêBR Project
+ *
+ * Copyright (C) 2012 - GêBR Core Team (www.gebrproject.com)
+ *
+ * GêBR Project is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * GêBR Project is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GêBR Project. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gebrm-sync.h"
+
+#include <string.h>
+
+typedef struct {
+	guint64 seq;
+	gchar *id;
+} ClosedJob;
+
+struct _GebrmSync {
+	gchar *epoch;
+	guint64 seq;
+	GQueue *closed;
+	guint max_closed;
+	/* sequence number of the last closed job forgotten */
+	guint64 floor;
+};
+
+GebrmSync *
+gebrm_sync_new(guint max_closed)
+{
+	GebrmSync *sync = g_new(GebrmSync, 1);
+	GTimeVal now;
+
+	g_get_current_time(&now);
+	sync->epoch = g_strdup_printf("%lx%lx", now.tv_sec, now.tv_usec);
+	sync->seq = 0;
+	sync->closed = g_queue_new();
+	sync->max_closed = max_closed;
+	sync->floor = 0;
+
+	return sync;
+}
+
+static void
+closed_job_free(ClosedJob *closed)
+{
+	g_free(closed->id);
+	g_free(closed);
+}
+
+void
+gebrm_sync_free(GebrmSync *sync)
+{
+	g_queue_foreach(sync->closed, (GFunc)closed_job_free, NULL);
+	g_queue_free(sync->closed);
+	g_free(sync->epoch);
+	g_free(sync);
+}
+
+guint64
+gebrm_sync_touch(GebrmSync *sync)
+{
+	return ++sync->seq;
+}
+
+void
+gebrm_sync_close(GebrmSync *sync,
+		 const gchar *id)
+{
+	ClosedJob *closed = g_new(ClosedJob, 1);
+
+	closed->seq = ++sync->seq;
+	closed->id = g_strdup(id);
+	g_queue_push_tail(sync->closed, closed);
+
+	if (g_queue_get_length(sync->closed) > sync->max_closed) {
+		closed = g_queue_pop_head(sync->closed);
+		sync->floor = closed->seq;
+		closed_job_free(closed);
+	}
+}
+
+gboolean
+gebrm_sync_resume(GebrmSync *sync,
+		  const gchar *cursor,
+		  guint64 *seq)
+{
+	const gchar *sep = cursor ? strrchr(cursor, ':') : NULL;
+	gchar *end;
+
+	*seq = 0;
+	if (!sep || (gsize)(sep - cursor) != strlen(sync->epoch)
+	    || strncmp(cursor, sync->epoch, sep - cursor) != 0)
+		return FALSE;
+
+	guint64 n = g_ascii_strtoull(sep + 1, &end, 10);
+	if (end == sep + 1 || *end || n < sync->floor || n > sync->seq)
+		return FALSE;
+
+	*seq = n;
+	return TRUE;
+}
+
+void
+gebrm_sync_foreach_closed(GebrmSync *sync,
+			  guint64 seq,
+			  GebrmSyncClosedFunc func,
+			  gpointer user_data)
+{
+	for (GList *i = sync->closed->head; i; i = i->next) {
+		ClosedJob *closed = i->data;
+		if (closed->seq > seq)
+			func(closed->id, user_data);
+	}
+}
+
+gchar *
+gebrm_sync_get_cursor(GebrmSync *sync)
+{
+	return g_strdup_printf("%s:%"G_GUINT64_FORMAT, sync->epoch, sync->seq);
+}
@@ -0,0 +1,102 @@
+/*
+ * gebrm-sync.h
+ * This file is part of GêBR Project
+ *
+ * Copyright (C) 2012 - GêBR Core Team (www.gebrproject.com)
+ *
+ * GêBR Project is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * GêBR Project is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GêBR Project. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GEBRM_SYNC_H__
+#define __GEBRM_SYNC_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/**
+ * GebrmSync:
+ *
+ * Sequence numbers of the changes of the jobs, so reconnecting clients only
+ * receive what changed since their cursor "<epoch>:<seq>". The epoch is new
+ * for each process, as the cursors of a previous one are not valid. The last
+ * jobs closed are remembered, so they are removed from the clients too.
+ */
+typedef struct _GebrmSync GebrmSync;
+
+/**
+ * GebrmSyncClosedFunc:
+ * @id: the id of a job closed after the cursor of a client
+ */
+typedef void (*GebrmSyncClosedFunc) (const gchar *id,
+				     gpointer user_data);
+
+/**
+ * gebrm_sync_new:
+ * @max_closed: how many closed jobs are remembered
+ */
+GebrmSync *gebrm_sync_new(guint max_closed);
+
+void gebrm_sync_free(GebrmSync *sync);
+
+/**
+ * gebrm_sync_touch:
+ *
+ * Returns: the sequence number of a new change of a job.
+ */
+guint64 gebrm_sync_touch(GebrmSync *sync);
+
+/**
+ * gebrm_sync_close:
+ *
+ * Records that the job @id was closed. The oldest closed job is forgotten
+ * past the limit given to gebrm_sync_new(), and the cursors before it are no
+ * longer valid.
+ */
+void gebrm_sync_close(GebrmSync *sync,
+		      const gchar *id);
+
+/**
+ * gebrm_sync_resume:
+ * @cursor: the cursor sent to a client, or %NULL
+ * @seq: set to the sequence number the client has seen, or to 0
+ *
+ * Returns: %TRUE if the client may be sent only the changes after @seq,
+ * %FALSE if @cursor is unknown or too old and the client must forget the jobs
+ * it has.
+ */
+gboolean gebrm_sync_resume(GebrmSync *sync,
+			   const gchar *cursor,
+			   guint64 *seq);
+
+/**
+ * gebrm_sync_foreach_closed:
+ *
+ * Calls @func for each job closed after @seq.
+ */
+void gebrm_sync_foreach_closed(GebrmSync *sync,
+			       guint64 seq,
+			       GebrmSyncClosedFunc func,
+			       gpointer user_data);
+
+/**
+ * gebrm_sync_get_cursor:
+ *
+ * Returns: the cursor of the current state, to be freed with g_free().
+ */
+gchar *gebrm_sync_get_cursor(GebrmSync *sync);
+
+G_END_DECLS
+
+#endif /* __GEBRM_SYNC_H__ */
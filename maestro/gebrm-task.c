@@ -29,10 +29,12 @@
 #include <libgebr/date.h>
 
 #include "gebrm-marshal.h"
+#include "gebrm-output.h"
 
 enum {
 	OUTPUT,
 	STATUS_CHANGE,
+	OUTPUT_STORED,
 	N_SIGNALS
 };
 
@@ -48,7 +50,7 @@ struct _GebrmTaskPriv {
 	GString *issues;
 	GString *cmd_line;
 	GString *moab_jid;
-	GString *output;
+	GebrmOutput *output;
 };
 
 G_DEFINE_TYPE(GebrmTask, gebrm_task, G_TYPE_OBJECT);
@@ -73,7 +75,8 @@ gebrm_task_free(GebrmTask *task)
 	g_string_free(task->priv->issues, TRUE);
 	g_string_free(task->priv->cmd_line, TRUE);
 	g_string_free(task->priv->moab_jid, TRUE);
-	g_string_free(task->priv->output, TRUE);
+	if (task->priv->output)
+		gebrm_output_free(task->priv->output);
 }
 
 static void
@@ -91,7 +94,7 @@ static void gebrm_task_init(GebrmTask *task)
 	                                         GebrmTaskPriv);
 
 	task->priv->status = JOB_STATUS_INITIAL;
-	task->priv->output = g_string_new(NULL);
+	task->priv->output = NULL;
 	task->priv->start_date = g_string_new(NULL);
 	task->priv->finish_date = g_string_new(NULL);
 	task->priv->issues = g_string_new(NULL);
@@ -122,6 +125,15 @@ static void gebrm_task_class_init(GebrmTaskClass *klass)
 			     gebrm_cclosure_marshal_VOID__INT_INT_STRING,
 			     G_TYPE_NONE, 3, G_TYPE_INT, G_TYPE_INT, G_TYPE_STRING);
 
+	signals[OUTPUT_STORED] =
+		g_signal_new("output-stored",
+			     G_OBJECT_CLASS_TYPE(gobject_class),
+			     G_SIGNAL_RUN_FIRST,
+			     G_STRUCT_OFFSET(GebrmTaskClass, output_stored),
+			     NULL, NULL,
+			     g_cclosure_marshal_VOID__VOID,
+			     G_TYPE_NONE, 0);
+
 	g_type_class_add_private(klass, sizeof(GebrmTaskPriv));
 }
 
@@ -153,9 +165,12 @@ gebrm_task_new(GebrmDaemon  *server,
 	task->priv->rid = g_strdup(rid);
 	task->priv->frac = atoi(frac);
 
+	gchar *id = gebrm_task_get_id(task);
+	task->priv->output = gebrm_output_new(id);
+
 	g_debug("Inserting task %s, rid %s into TASKS hash table (%s)",
-		frac, rid, gebrm_task_get_id(task));
-	g_hash_table_insert(get_tasks_map(), gebrm_task_get_id(task), task);
+		frac, rid, id);
+	g_hash_table_insert(get_tasks_map(), id, task);
 
 	return task;
 }
@@ -177,6 +192,23 @@ gebrm_task_init_details(GebrmTask *task,
 	g_string_assign(task->priv->moab_jid, moab_jid->str);
 }
 
+void
+gebrm_task_restore(GebrmTask *task,
+		   GebrCommJobStatus status,
+		   const gchar *start_date,
+		   const gchar *finish_date,
+		   const gchar *issues,
+		   const gchar *cmd_line,
+		   guint64 output_length)
+{
+	task->priv->status = status;
+	g_string_assign(task->priv->start_date, start_date);
+	g_string_assign(task->priv->finish_date, finish_date);
+	g_string_assign(task->priv->issues, issues);
+	g_string_assign(task->priv->cmd_line, cmd_line);
+	gebrm_output_restore(task->priv->output, output_length);
+}
+
 GebrCommJobStatus
 gebrm_task_translate_status(GString *status)
 {
@@ -215,6 +247,21 @@ gebrm_task_find(const gchar *rid, const gchar *frac)
 	return task;
 }
 
+GList *
+gebrm_task_list_for_daemon(GebrmDaemon *daemon)
+{
+	GHashTableIter iter;
+	GebrmTask *task;
+	GList *tasks = NULL;
+
+	g_hash_table_iter_init(&iter, get_tasks_map());
+	while (g_hash_table_iter_next(&iter, NULL, (gpointer *)&task))
+		if (task->priv->daemon == daemon)
+			tasks = g_list_prepend(tasks, task);
+
+	return tasks;
+}
+
 gint
 gebrm_task_get_fraction(GebrmTask *task)
 {
@@ -231,8 +278,10 @@ void
 gebrm_task_emit_output_signal(GebrmTask *task,
 			     const gchar *output)
 {
-	g_string_append(task->priv->output, output);
+	gboolean stored = gebrm_output_append(task->priv->output, output, strlen(output));
 	g_signal_emit(task, signals[OUTPUT], 0, output);
+	if (stored)
+		g_signal_emit(task, signals[OUTPUT_STORED], 0);
 }
 
 void
@@ -289,9 +338,66 @@ gebrm_task_get_issues(GebrmTask *task)
 	return task->priv->issues->str;
 }
 const gchar *
-gebrm_task_get_output(GebrmTask *task)
+gebrm_task_get_recent_output(GebrmTask *task)
+{
+	return gebrm_output_peek(task->priv->output);
+}
+
+guint64
+gebrm_task_get_output_length(GebrmTask *task)
+{
+	return gebrm_output_get_length(task->priv->output);
+}
+
+guint64
+gebrm_task_get_stored_output_length(GebrmTask *task)
+{
+	return gebrm_output_get_stored_length(task->priv->output);
+}
+
+gboolean
+gebrm_task_read_output(GebrmTask *task,
+		       guint64 offset,
+		       gsize len,
+		       GString *buffer)
+{
+	GError *error = NULL;
+
+	if (!gebrm_output_read(task->priv->output, offset, len, buffer, &error)) {
+		g_warning("%s", error->message);
+		g_error_free(error);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+gchar *
+gebrm_task_get_output_tail(GebrmTask *task,
+			   guint lines)
 {
-	return task->priv->output->str;
+	GError *error = NULL;
+	gchar *tail = gebrm_output_tail(task->priv->output, lines, &error);
+
+	if (!tail) {
+		g_warning("%s", error->message);
+		g_error_free(error);
+	}
+	return tail;
+}
+
+guint64
+gebrm_task_get_output_tail_offset(GebrmTask *task,
+				  guint lines)
+{
+	GError *error = NULL;
+	guint64 offset;
+
+	if (!gebrm_output_tail_offset(task->priv->output, lines, &offset, &error)) {
+		g_warning("%s", error->message);
+		g_error_free(error);
+		return 0;
+	}
+	return offset;
 }
 
 void
@@ -305,6 +411,10 @@ gebrm_task_close(GebrmTask *task, const gchar *rid)
 						      rid);
 
 	g_hash_table_remove(get_tasks_map(), tid);
+
+	/* The output of closed jobs is not requested anymore */
+	gebrm_output_free(task->priv->output);
+	task->priv->output = gebrm_output_new(tid);
 	g_free(tid);
 }
 
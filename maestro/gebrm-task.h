@@ -55,6 +55,8 @@ struct _GebrmTaskClass {
 
 	void (*output) (GebrmTask *task,
 			const gchar *output);
+
+	void (*output_stored) (GebrmTask *task);
 };
 
 GType gebrm_task_get_type(void) G_GNUC_CONST;
@@ -71,6 +73,13 @@ gchar *gebrm_task_build_id(const gchar *rid,
 GebrmTask *gebrm_task_find(const gchar *rid,
 			   const gchar *frac);
 
+/**
+ * gebrm_task_list_for_daemon:
+ *
+ * Returns: a list of the tasks of @daemon, free it with g_list_free().
+ */
+GList *gebrm_task_list_for_daemon(GebrmDaemon *daemon);
+
 /**
  * gebrm_task_new:
  *
@@ -97,6 +106,22 @@ gebrm_task_init_details(GebrmTask *task,
 			GString   *cmd_line,
 			GString   *moab_jid);
 
+/**
+ * gebrm_task_restore:
+ *
+ * @output_length: the bytes of output on disk recorded in the journal
+ *
+ * Sets the state @task had in a previous maestro process, as recorded in the
+ * jobs journal. The output it had on disk is kept, see gebrm_output_restore().
+ */
+void gebrm_task_restore(GebrmTask *task,
+			GebrCommJobStatus status,
+			const gchar *start_date,
+			const gchar *finish_date,
+			const gchar *issues,
+			const gchar *cmd_line,
+			guint64 output_length);
+
 GebrCommJobStatus gebrm_task_get_status(GebrmTask *task);
 
 void gebrm_task_emit_output_signal(GebrmTask *task,
@@ -116,7 +141,61 @@ const gchar *gebrm_task_get_finish_date(GebrmTask *task);
 
 const gchar *gebrm_task_get_issues(GebrmTask *task);
 
-const gchar *gebrm_task_get_output(GebrmTask *task);
+/**
+ * gebrm_task_get_recent_output:
+ *
+ * Returns: The last bytes of output of @task, those still kept in memory.
+ * Older output must be read with gebrm_task_read_output().
+ */
+const gchar *gebrm_task_get_recent_output(GebrmTask *task);
+
+/**
+ * gebrm_task_get_output_length:
+ *
+ * Returns: The number of bytes of output received so far. Output is only
+ * appended, so this is also the offset of the next output signal.
+ */
+guint64 gebrm_task_get_output_length(GebrmTask *task);
+
+/**
+ * gebrm_task_get_stored_output_length:
+ *
+ * Returns: The number of bytes of output of @task written to disk, which a
+ * restarted maestro can restore. The "output-stored" signal is emitted when
+ * it grows.
+ */
+guint64 gebrm_task_get_stored_output_length(GebrmTask *task);
+
+/**
+ * gebrm_task_read_output:
+ *
+ * Appends to @buffer up to @len bytes of the output of @task, starting at
+ * @offset.
+ *
+ * Returns: %FALSE if the output could not be read.
+ */
+gboolean gebrm_task_read_output(GebrmTask *task,
+				guint64 offset,
+				gsize len,
+				GString *buffer);
+
+/**
+ * gebrm_task_get_output_tail:
+ *
+ * Returns: A newly allocated string with the last @lines lines of the
+ * output of @task, or %NULL if it could not be read.
+ */
+gchar *gebrm_task_get_output_tail(GebrmTask *task,
+				  guint lines);
+
+/**
+ * gebrm_task_get_output_tail_offset:
+ *
+ * Returns: The offset where the last @lines lines of the output of @task
+ * start, or 0 if it could not be read.
+ */
+guint64 gebrm_task_get_output_tail_offset(GebrmTask *task,
+					  guint lines);
 
 void gebrm_task_close(GebrmTask *task, const gchar *rid);
 
@@ -0,0 +1,108 @@
+/*
+ * bench-journal.c
+ * This file is part of GêBR Project
+ *
+ * Copyright (C) 2012 - GêBR Core Team (www.gebrproject.com)
+ *
+ * GêBR Project is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * GêBR Project is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GêBR Project. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <unistd.h>
+#include <gebr-bench.h>
+
+#include "../gebrm-journal.h"
+
+/* Jobs in the journal read when the maestro restarts */
+#define N_JOBS 10000
+
+typedef struct {
+	gchar *path;
+	gsize size;
+	guint records;
+} JournalData;
+
+static void
+count_record(gchar type,
+	     const gchar **fields,
+	     guint n_fields,
+	     gpointer user_data)
+{
+	JournalData *d = user_data;
+	d->records++;
+}
+
+/* Records about as large as the ones of gebrm-app.c: a job, its task started
+ * and finished, and the output stored */
+static void
+write_jobs(GebrmJournal *journal)
+{
+	const gchar *job[] = { NULL, "client-id", "Flow title", "localhost",
+		"/home/user/project/line", "0", "bash", "", "1", "2012-05-30T10:00:00",
+		"", "4", "1", "finished", "" };
+	const gchar *task[] = { NULL, "0", "localhost", "finished",
+		"2012-05-30T10:00:01", "2012-05-30T10:05:00", "",
+		"cat input.su | sufilter f=10,20,30,40 | suxwigb > output.su", "4096" };
+	const gchar *output[] = { NULL, "0", "33554432" };
+
+	for (guint i = 0; i < N_JOBS; i++) {
+		gchar *id = g_strdup_printf("%u", i);
+
+		job[0] = task[0] = output[0] = id;
+		gebrm_journal_append(journal, 'J', job, G_N_ELEMENTS(job));
+		gebrm_journal_append(journal, 'T', task, G_N_ELEMENTS(task));
+		gebrm_journal_append(journal, 'O', output, G_N_ELEMENTS(output));
+		gebrm_journal_append(journal, 'T', task, G_N_ELEMENTS(task));
+		g_free(id);
+	}
+}
+
+static void
+bench_journal_replay(gpointer data)
+{
+	JournalData *d = data;
+
+	d->records = 0;
+	gebrm_journal_free(gebrm_journal_open(d->path, count_record, d, NULL));
+	if (d->records != 4 * N_JOBS)
+		g_error("Replayed %u records", d->records);
+}
+
+int
+main(int argc, char *argv[])
+{
+	gchar *name = g_strdup_printf("gebrm-bench-journal-%d.journal", (gint) getpid());
+	JournalData d = { g_build_filename(g_get_tmp_dir(), name, NULL), 0, 0 };
+	GebrmJournal *journal;
+	gchar *contents;
+	gint ret;
+
+	gebr_bench_init(&argc, &argv, "maestro");
+
+	journal = gebrm_journal_open(d.path, count_record, &d, NULL);
+	write_jobs(journal);
+	gebrm_journal_free(journal);
+	g_assert(g_file_get_contents(d.path, &contents, &d.size, NULL));
+	g_free(contents);
+
+	gebr_bench_add("journal/replay-10k-jobs", bench_journal_replay, &d, d.size);
+	ret = gebr_bench_run();
+
+	g_unlink(d.path);
+	g_free(d.path);
+	g_free(name);
+
+	return ret;
+}
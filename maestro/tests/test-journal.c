@@ -0,0 +1,285 @@
+/*
+ * test-journal.c
+ * This file is part of GêBR Project
+ *
+ * Copyright (C) 2012 - GêBR Core Team (www.gebrproject.com)
+ *
+ * GêBR Project is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * GêBR Project is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GêBR Project. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../gebrm-journal.h"
+
+static gchar *path;
+static gchar *snapshot_path;
+
+/* Writes each record replayed as "type:field,field;" */
+static void
+on_record(gchar type,
+	  const gchar **fields,
+	  guint n_fields,
+	  gpointer user_data)
+{
+	GString *log = user_data;
+
+	g_string_append_printf(log, "%c:", type);
+	for (guint i = 0; i < n_fields; i++)
+		g_string_append_printf(log, i ? ",%s" : "%s", fields[i]);
+	g_string_append_c(log, ';');
+}
+
+static GebrmJournal *
+open_journal(GString *log)
+{
+	GError *error = NULL;
+	GebrmJournal *journal;
+
+	g_string_truncate(log, 0);
+	journal = gebrm_journal_open(path, on_record, log, &error);
+	g_assert_no_error(error);
+	g_assert(journal != NULL);
+
+	return journal;
+}
+
+static void
+append(GebrmJournal *journal, gchar type, const gchar *a, const gchar *b)
+{
+	const gchar *fields[] = { a, b };
+	gebrm_journal_append(journal, type, fields, G_N_ELEMENTS(fields));
+}
+
+static gsize
+file_size(const gchar *file)
+{
+	struct stat st;
+
+	if (g_stat(file, &st) != 0)
+		return 0;
+	return st.st_size;
+}
+
+static void
+set_contents(const gchar *file, const gchar *data, gsize len)
+{
+	g_assert(g_file_set_contents(file, data, len, NULL));
+}
+
+static void
+remove_files(void)
+{
+	g_unlink(path);
+	g_unlink(snapshot_path);
+}
+
+static void
+test_journal_replay(void)
+{
+	GString *log = g_string_new(NULL);
+	GebrmJournal *journal;
+
+	journal = open_journal(log);
+	g_assert_cmpstr(log->str, ==, "");
+	append(journal, 'J', "1", "first");
+	append(journal, 'T', "1", NULL);
+	append(journal, 'C', "1", "");
+	gebrm_journal_free(journal);
+
+	journal = open_journal(log);
+	g_assert_cmpstr(log->str, ==, "J:1,first;T:1,;C:1,;");
+	gebrm_journal_free(journal);
+
+	g_string_free(log, TRUE);
+	remove_files();
+}
+
+static void
+test_journal_torn_tail(void)
+{
+	GString *log = g_string_new(NULL);
+	GebrmJournal *journal;
+	gchar *contents;
+	gsize valid, len;
+
+	journal = open_journal(log);
+	append(journal, 'J', "1", "a");
+	append(journal, 'J', "2", "b");
+	gebrm_journal_free(journal);
+	valid = file_size(path);
+
+	/* A crash in the middle of the third record */
+	journal = open_journal(log);
+	append(journal, 'J', "3", "c");
+	gebrm_journal_free(journal);
+	g_assert(g_file_get_contents(path, &contents, &len, NULL));
+	set_contents(path, contents, len - 3);
+	g_free(contents);
+
+	journal = open_journal(log);
+	g_assert_cmpstr(log->str, ==, "J:1,a;J:2,b;");
+	g_assert_cmpuint(file_size(path), ==, valid);
+
+	/* Records appended after the torn one are replayed */
+	append(journal, 'J', "4", "d");
+	gebrm_journal_free(journal);
+
+	journal = open_journal(log);
+	g_assert_cmpstr(log->str, ==, "J:1,a;J:2,b;J:4,d;");
+	gebrm_journal_free(journal);
+
+	g_string_free(log, TRUE);
+	remove_files();
+}
+
+static void
+test_journal_corrupt(void)
+{
+	GString *log = g_string_new(NULL);
+	GebrmJournal *journal;
+	gchar *contents;
+	gsize first, len;
+
+	journal = open_journal(log);
+	append(journal, 'J', "1", "a");
+	gebrm_journal_free(journal);
+	first = file_size(path);
+
+	journal = open_journal(log);
+	append(journal, 'J', "2", "b");
+	append(journal, 'J', "3", "c");
+	gebrm_journal_free(journal);
+
+	/* A flipped byte in the payload of the second record */
+	g_assert(g_file_get_contents(path, &contents, &len, NULL));
+	contents[first + 10] ^= 1;
+	set_contents(path, contents, len);
+	g_free(contents);
+
+	journal = open_journal(log);
+	g_assert_cmpstr(log->str, ==, "J:1,a;");
+	g_assert_cmpuint(file_size(path), ==, first);
+	gebrm_journal_free(journal);
+
+	g_string_free(log, TRUE);
+	remove_files();
+}
+
+static void
+dump_state(GebrmJournal *journal, gpointer user_data)
+{
+	append(journal, 'S', user_data, NULL);
+}
+
+static void
+test_journal_snapshot(void)
+{
+	GString *log = g_string_new(NULL);
+	GebrmJournal *journal;
+	gchar *old_journal;
+	gsize len;
+
+	journal = open_journal(log);
+	append(journal, 'J', "1", "a");
+	append(journal, 'J', "2", "b");
+	g_assert(g_file_get_contents(path, &old_journal, &len, NULL));
+
+	g_assert(gebrm_journal_write_snapshot(journal, dump_state, "1+2", NULL));
+	g_assert_cmpuint(file_size(path), ==, 0);
+	g_assert_cmpuint(file_size(snapshot_path), >, 0);
+
+	/* The journal is replayed on top of the snapshot */
+	append(journal, 'J', "3", "c");
+	gebrm_journal_free(journal);
+
+	journal = open_journal(log);
+	g_assert_cmpstr(log->str, ==, "S:1+2,;J:3,c;");
+	gebrm_journal_free(journal);
+
+	/* A crash after the snapshot was renamed, before the journal was
+	 * emptied: the old records are replayed again, after the snapshot */
+	set_contents(path, old_journal, len);
+	journal = open_journal(log);
+	g_assert_cmpstr(log->str, ==, "S:1+2,;J:1,a;J:2,b;");
+	gebrm_journal_free(journal);
+
+	g_free(old_journal);
+	g_string_free(log, TRUE);
+	remove_files();
+}
+
+static void
+test_journal_compaction(void)
+{
+	GString *log = g_string_new(NULL);
+	gchar *value = g_strnfill(1000, 'x');
+	GebrmJournal *journal;
+	guint i;
+
+	journal = open_journal(log);
+	for (i = 0; !gebrm_journal_needs_snapshot(journal); i++)
+		append(journal, 'J', "1", value);
+
+	/* Not before 1 MiB */
+	g_assert_cmpuint(i, >, 1000);
+	g_assert_cmpuint(file_size(path), >, 1 << 20);
+
+	g_assert(gebrm_journal_write_snapshot(journal, dump_state, "all", NULL));
+	g_assert(!gebrm_journal_needs_snapshot(journal));
+	g_assert_cmpuint(file_size(path), ==, 0);
+	gebrm_journal_free(journal);
+
+	journal = open_journal(log);
+	g_assert_cmpstr(log->str, ==, "S:all,;");
+	gebrm_journal_free(journal);
+
+	g_free(value);
+	g_string_free(log, TRUE);
+	remove_files();
+}
+
+int
+main(int argc, char *argv[])
+{
+	gchar *name = g_strdup_printf("gebrm-test-journal-%d", (gint) getpid());
+	gchar *dir = g_build_filename(g_get_tmp_dir(), name, NULL);
+	gint ret;
+
+	g_test_init(&argc, &argv, NULL);
+	/* The discarded records are reported with warnings */
+	g_log_set_always_fatal(G_LOG_FATAL_MASK | G_LOG_LEVEL_CRITICAL);
+	g_mkdir_with_parents(dir, 0700);
+	path = g_build_filename(dir, "jobs.journal", NULL);
+	snapshot_path = g_strconcat(path, ".snapshot", NULL);
+
+	g_test_add_func("/maestro/journal/replay", test_journal_replay);
+	g_test_add_func("/maestro/journal/torn-tail", test_journal_torn_tail);
+	g_test_add_func("/maestro/journal/corrupt", test_journal_corrupt);
+	g_test_add_func("/maestro/journal/snapshot", test_journal_snapshot);
+	g_test_add_func("/maestro/journal/compaction", test_journal_compaction);
+
+	ret = g_test_run();
+
+	remove_files();
+	g_rmdir(dir);
+	g_free(path);
+	g_free(snapshot_path);
+	g_free(dir);
+	g_free(name);
+
+	return ret;
+}
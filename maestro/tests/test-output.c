@@ -0,0 +1,288 @@
+/*
+ * test-output.c
+ * This file is part of GêBR Project
+ *
+ * Copyright (C) 2012 - GêBR Core Team (www.gebrproject.com)
+ *
+ * GêBR Project is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * GêBR Project is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GêBR Project. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../gebrm-output.h"
+
+#define SEGMENT_SIZE (32 << 20)
+
+static gchar *dir;
+
+/* Byte @i of the output written by append_pattern() */
+static gchar
+pattern(guint64 i)
+{
+	return 'a' + i % 23;
+}
+
+static void
+append_pattern(GebrmOutput *output, guint64 len, gsize chunk)
+{
+	gchar *buf = g_malloc(chunk);
+	guint64 start = gebrm_output_get_length(output);
+
+	for (guint64 done = 0; done < len; done += chunk) {
+		gsize n = MIN(chunk, len - done);
+		for (gsize i = 0; i < n; i++)
+			buf[i] = pattern(start + done + i);
+		gebrm_output_append(output, buf, n);
+	}
+
+	g_free(buf);
+}
+
+static void
+assert_range(GebrmOutput *output, guint64 offset, gsize len)
+{
+	GString *buf = g_string_new("x");
+	guint64 total = gebrm_output_get_length(output);
+	gsize expected = offset >= total ? 0 : MIN(len, total - offset);
+
+	g_assert(gebrm_output_read(output, offset, len, buf, NULL));
+	g_assert_cmpuint(buf->len, ==, expected + 1);
+	for (gsize i = 0; i < expected; i++)
+		if (buf->str[i + 1] != pattern(offset + i))
+			g_error("Byte %" G_GUINT64_FORMAT " differs", offset + i);
+
+	g_string_free(buf, TRUE);
+}
+
+static goffset
+segment_size(const gchar *name, guint index)
+{
+	gchar *basename = g_strdup_printf("%s-%04u.out", name, index);
+	gchar *path = g_build_filename(dir, basename, NULL);
+	struct stat st;
+	goffset size = g_stat(path, &st) == 0 ? st.st_size : -1;
+
+	g_free(basename);
+	g_free(path);
+	return size;
+}
+
+static void
+test_output_memory(void)
+{
+	gebrm_output_set_defaults(dir, 1024);
+	GebrmOutput *output = gebrm_output_new("memory");
+
+	append_pattern(output, 1000, 100);
+	g_assert_cmpuint(gebrm_output_get_length(output), ==, 1000);
+	g_assert_cmpuint(strlen(gebrm_output_peek(output)), ==, 1000);
+	g_assert_cmpint(segment_size("memory", 0), ==, -1);
+
+	assert_range(output, 0, 1000);
+	assert_range(output, 990, 100);
+	assert_range(output, 1000, 10);
+
+	gebrm_output_free(output);
+}
+
+static void
+test_output_boundary(void)
+{
+	gebrm_output_set_defaults(dir, 1024);
+	GebrmOutput *output = gebrm_output_new("boundary");
+
+	append_pattern(output, 10000, 77);
+	g_assert_cmpuint(gebrm_output_get_length(output), ==, 10000);
+
+	/* The tail in memory is a suffix, the rest is on disk */
+	gsize tail = strlen(gebrm_output_peek(output));
+	g_assert_cmpuint(tail, <=, 1024);
+	g_assert_cmpint(segment_size("boundary", 0), ==, 10000 - tail);
+
+	/* Ranges inside the segment, inside the tail and across both */
+	guint64 boundary = 10000 - tail;
+	assert_range(output, 0, 100);
+	assert_range(output, boundary - 1, 2);
+	assert_range(output, boundary - 500, 1000);
+	assert_range(output, boundary, tail);
+	assert_range(output, 0, 20000);
+	for (guint64 offset = 0; offset < 10000; offset += 333)
+		assert_range(output, offset, 700);
+
+	gebrm_output_free(output);
+	g_assert_cmpint(segment_size("boundary", 0), ==, -1);
+}
+
+static void
+test_output_rollover(void)
+{
+	gebrm_output_set_defaults(dir, 64 << 10);
+	GebrmOutput *output = gebrm_output_new("rollover");
+	guint64 len = SEGMENT_SIZE + (1 << 20);
+
+	append_pattern(output, len, 64 << 10);
+	g_assert_cmpuint(gebrm_output_get_length(output), ==, len);
+
+	gsize tail = strlen(gebrm_output_peek(output));
+	g_assert_cmpint(segment_size("rollover", 0), ==, SEGMENT_SIZE);
+	g_assert_cmpint(segment_size("rollover", 1), ==, len - tail - SEGMENT_SIZE);
+	g_assert_cmpint(segment_size("rollover", 2), ==, -1);
+
+	/* Across the two segments, and from the second one into the tail */
+	assert_range(output, SEGMENT_SIZE - 10, 20);
+	assert_range(output, SEGMENT_SIZE - 1000, 1000);
+	assert_range(output, len - tail - 10, 20);
+
+	gebrm_output_free(output);
+	g_assert_cmpint(segment_size("rollover", 0), ==, -1);
+	g_assert_cmpint(segment_size("rollover", 1), ==, -1);
+}
+
+static void
+test_output_restore(void)
+{
+	gebrm_output_set_defaults(dir, 1024);
+	GebrmOutput *old = gebrm_output_new("restore");
+
+	append_pattern(old, 5000, 100);
+	guint64 stored = 5000 - strlen(gebrm_output_peek(old));
+
+	/* A new process finds the segments of the old one, which is leaked as
+	 * if it had crashed */
+	GebrmOutput *output = gebrm_output_new("restore");
+	g_assert_cmpuint(gebrm_output_restore(output, G_MAXUINT64), ==, stored);
+	assert_range(output, 0, stored);
+	append_pattern(output, 3000, 100);
+	assert_range(output, 0, stored + 3000);
+	gebrm_output_free(output);
+
+	/* Only the bytes recorded as written are kept */
+	old = gebrm_output_new("restore");
+	append_pattern(old, 5000, 100);
+	output = gebrm_output_new("restore");
+	g_assert_cmpuint(gebrm_output_restore(output, 1000), ==, 1000);
+	g_assert_cmpuint(gebrm_output_get_length(output), ==, 1000);
+	g_assert_cmpint(segment_size("restore", 0), ==, 1000);
+	gebrm_output_free(output);
+}
+
+static void
+test_output_remove_unused(void)
+{
+	gchar *unused = g_build_filename(dir, "unused-0000.out", NULL);
+	gchar *other = g_build_filename(dir, "other.txt", NULL);
+
+	gebrm_output_set_defaults(dir, 16);
+	GebrmOutput *output = gebrm_output_new("used");
+	append_pattern(output, 100, 10);
+
+	g_assert(g_file_set_contents(unused, "x", -1, NULL));
+	g_assert(g_file_set_contents(other, "x", -1, NULL));
+
+	gebrm_output_remove_unused();
+	g_assert(!g_file_test(unused, G_FILE_TEST_EXISTS));
+	g_assert(g_file_test(other, G_FILE_TEST_EXISTS));
+	g_assert_cmpint(segment_size("used", 0), >, 0);
+	assert_range(output, 0, 100);
+
+	gebrm_output_free(output);
+	g_unlink(other);
+	g_free(unused);
+	g_free(other);
+}
+
+static void
+assert_tail(GebrmOutput *output, guint lines, const gchar *expected)
+{
+	gchar *tail = gebrm_output_tail(output, lines, NULL);
+	guint64 offset;
+
+	g_assert_cmpstr(tail, ==, expected);
+	g_assert(gebrm_output_tail_offset(output, lines, &offset, NULL));
+	g_assert_cmpuint(offset, ==, gebrm_output_get_length(output) - strlen(expected));
+	g_free(tail);
+}
+
+static void
+test_output_tail(void)
+{
+	gebrm_output_set_defaults(dir, 16);
+	GebrmOutput *output = gebrm_output_new("tail");
+
+	assert_tail(output, 3, "");
+
+	gebrm_output_append(output, "first\nsecond\nthird\n", 19);
+	assert_tail(output, 0, "");
+	assert_tail(output, 1, "third\n");
+	assert_tail(output, 2, "second\nthird\n");
+	assert_tail(output, 3, "first\nsecond\nthird\n");
+	assert_tail(output, 10, "first\nsecond\nthird\n");
+
+	/* The last line without a break counts as a line */
+	gebrm_output_append(output, "fourth", 6);
+	assert_tail(output, 1, "fourth");
+	assert_tail(output, 2, "third\nfourth");
+	gebrm_output_free(output);
+
+	/* Lines spread over the segment, in blocks read backwards, and the
+	 * tail in memory */
+	gebrm_output_set_defaults(dir, 1024);
+	output = gebrm_output_new("tail-long");
+	GString *line = g_string_new(NULL);
+	for (gint i = 0; i < 20000; i++) {
+		g_string_printf(line, "line %d\n", i);
+		gebrm_output_append(output, line->str, line->len);
+	}
+	g_assert_cmpint(segment_size("tail-long", 0), >, 64 << 10);
+
+	gchar *tail = gebrm_output_tail(output, 15000, NULL);
+	g_assert(g_str_has_prefix(tail, "line 5000\n"));
+	g_assert(g_str_has_suffix(tail, "line 19999\n"));
+	g_free(tail);
+	assert_tail(output, 1, "line 19999\n");
+
+	g_string_free(line, TRUE);
+	gebrm_output_free(output);
+}
+
+int
+main(int argc, char *argv[])
+{
+	g_test_init(&argc, &argv, NULL);
+
+	gchar *name = g_strdup_printf("gebrm-test-output-%d", (gint) getpid());
+	dir = g_build_filename(g_get_tmp_dir(), name, NULL);
+	g_mkdir_with_parents(dir, 0700);
+	g_free(name);
+
+	g_test_add_func("/maestro/output/memory", test_output_memory);
+	g_test_add_func("/maestro/output/boundary", test_output_boundary);
+	g_test_add_func("/maestro/output/rollover", test_output_rollover);
+	g_test_add_func("/maestro/output/restore", test_output_restore);
+	g_test_add_func("/maestro/output/remove-unused", test_output_remove_unused);
+	g_test_add_func("/maestro/output/tail", test_output_tail);
+
+	gint ret = g_test_run();
+
+	/* Segments left by the tests which restore outputs */
+	gebrm_output_set_defaults(dir, 1024);
+	gebrm_output_remove_unused();
+	g_rmdir(dir);
+	g_free(dir);
+
+	return ret;
+}
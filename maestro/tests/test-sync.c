@@ -0,0 +1,194 @@
+/*
+ * test-sync.c
+ * This file is part of GêBR Project
+ *
+ * Copyright (C) 2012 - GêBR Core Team (www.gebrproject.com)
+ *
+ * GêBR Project is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * GêBR Project is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GêBR Project. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <glib.h>
+#include <string.h>
+
+#include "../gebrm-sync.h"
+
+/* Writes the jobs closed as "id;" */
+static void
+on_closed(const gchar *id,
+	  gpointer user_data)
+{
+	g_string_append_printf(user_data, "%s;", id);
+}
+
+static gchar *
+closed_after(GebrmSync *sync, guint64 seq)
+{
+	GString *log = g_string_new(NULL);
+	gebrm_sync_foreach_closed(sync, seq, on_closed, log);
+	return g_string_free(log, FALSE);
+}
+
+static void
+assert_closed_after(GebrmSync *sync, guint64 seq, const gchar *expected)
+{
+	gchar *ids = closed_after(sync, seq);
+	g_assert_cmpstr(ids, ==, expected);
+	g_free(ids);
+}
+
+/* The cursor of @sync with @seq instead of its own sequence number */
+static gchar *
+cursor_with_seq(GebrmSync *sync, const gchar *seq)
+{
+	gchar *cursor = gebrm_sync_get_cursor(sync);
+	gchar *sep = strrchr(cursor, ':');
+	gchar *other;
+
+	*sep = '\0';
+	other = g_strconcat(cursor, ":", seq, NULL);
+	g_free(cursor);
+
+	return other;
+}
+
+static void
+assert_reset(GebrmSync *sync, const gchar *cursor)
+{
+	guint64 seq = 1;
+
+	g_assert(!gebrm_sync_resume(sync, cursor, &seq));
+	g_assert_cmpuint(seq, ==, 0);
+}
+
+static void
+test_sync_resume(void)
+{
+	GebrmSync *sync = gebrm_sync_new(16);
+	GebrmSync *next;
+	gchar *cursor, *other;
+	guint64 seq;
+
+	/* A new client */
+	assert_reset(sync, NULL);
+
+	g_assert_cmpuint(gebrm_sync_touch(sync), ==, 1);
+	g_assert_cmpuint(gebrm_sync_touch(sync), ==, 2);
+	cursor = gebrm_sync_get_cursor(sync);
+	g_assert(g_str_has_suffix(cursor, ":2"));
+
+	gebrm_sync_touch(sync);
+	g_assert(gebrm_sync_resume(sync, cursor, &seq));
+	g_assert_cmpuint(seq, ==, 2);
+
+	/* Cursors of another maestro process */
+	other = g_strconcat("0", cursor, NULL);
+	assert_reset(sync, other);
+	g_free(other);
+	assert_reset(sync, "2");
+
+	/* From the future, or not a number */
+	other = cursor_with_seq(sync, "4");
+	assert_reset(sync, other);
+	g_free(other);
+	other = cursor_with_seq(sync, "");
+	assert_reset(sync, other);
+	g_free(other);
+	other = cursor_with_seq(sync, "2x");
+	assert_reset(sync, other);
+	g_free(other);
+
+	/* Cursors of this process are not valid in the next one, even at
+	 * the same sequence number */
+	g_usleep(10);
+	next = gebrm_sync_new(16);
+	for (gint i = 0; i < 3; i++)
+		gebrm_sync_touch(next);
+	assert_reset(next, cursor);
+
+	g_free(cursor);
+	gebrm_sync_free(next);
+	gebrm_sync_free(sync);
+}
+
+static void
+test_sync_closed(void)
+{
+	GebrmSync *sync = gebrm_sync_new(16);
+	guint64 seq;
+	gchar *cursor;
+
+	gebrm_sync_touch(sync);
+	gebrm_sync_close(sync, "a");
+	cursor = gebrm_sync_get_cursor(sync);
+	gebrm_sync_touch(sync);
+	gebrm_sync_close(sync, "b");
+	gebrm_sync_close(sync, "c");
+
+	g_assert(gebrm_sync_resume(sync, cursor, &seq));
+	assert_closed_after(sync, seq, "b;c;");
+	assert_closed_after(sync, 0, "a;b;c;");
+	assert_closed_after(sync, 5, "");
+
+	g_free(cursor);
+	gebrm_sync_free(sync);
+}
+
+static void
+test_sync_closed_overflow(void)
+{
+	const guint max = 4;
+	GebrmSync *sync = gebrm_sync_new(max);
+	gchar *before, *first, *last;
+	guint64 seq;
+
+	before = gebrm_sync_get_cursor(sync);
+	gebrm_sync_close(sync, "0");
+	first = gebrm_sync_get_cursor(sync);
+	for (guint i = 1; i < max; i++) {
+		gchar *id = g_strdup_printf("%u", i);
+		gebrm_sync_close(sync, id);
+		g_free(id);
+	}
+
+	/* Exactly at the limit, every closed job is remembered */
+	g_assert(gebrm_sync_resume(sync, before, &seq));
+	assert_closed_after(sync, seq, "0;1;2;3;");
+
+	/* One more, and the cursors before the first one closed are too old */
+	gebrm_sync_close(sync, "4");
+	assert_reset(sync, before);
+	g_assert(gebrm_sync_resume(sync, first, &seq));
+	assert_closed_after(sync, seq, "1;2;3;4;");
+
+	last = gebrm_sync_get_cursor(sync);
+	g_assert(gebrm_sync_resume(sync, last, &seq));
+	assert_closed_after(sync, seq, "");
+
+	g_free(before);
+	g_free(first);
+	g_free(last);
+	gebrm_sync_free(sync);
+}
+
+int
+main(int argc, char *argv[])
+{
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add_func("/maestro/sync/resume", test_sync_resume);
+	g_test_add_func("/maestro/sync/closed", test_sync_closed);
+	g_test_add_func("/maestro/sync/closed-overflow", test_sync_closed_overflow);
+
+	return g_test_run();
+}